@@ -52,7 +52,8 @@
 #
 # KERNEL PARAMETERS (modprobe.d/nct6775.conf):
 #   - fan_debounce=1              enable chip debounce for signal noise
-#   - force_id=0xD42B             override detected ID (rarely needed)
+#   - force_id=0xD42B             override detected ID (rarely needed; 0xD42B is
+#                                 an NCT6798D rev 3, see scripts/nct-chip.h)
 #
 # USAGE:
 #   max-fans-advanced.sh --smartfan-7pt [--timing 800 1200 3000]
@@ -60,7 +61,9 @@
 #   max-fans-advanced.sh --dual-sensor [--primary 1 --secondary 5]
 #   max-fans-advanced.sh --electrical-mode [--dc | --pwm]
 #   max-fans-advanced.sh --tachometry [--pulses 2]
-#   max-fans-advanced.sh --verify
+#   max-fans-advanced.sh --plan [PLAN]     (compiled profile, see nct-profile.c)
+#   max-fans-advanced.sh --verify [--json]
+#   max-fans-advanced.sh --reconcile COMMAND ...   (write only drifted values)
 #
 # EXAMPLES:
 #   # 7-point curve with smooth ramps
@@ -101,7 +104,10 @@ set -o pipefail
 # CONFIGURATION
 ################################################################################
 
-readonly HWMON_PATH="/sys/class/hwmon"
+# Shared hwmon resolution: find_nct_fan, resolve_nct_hwmon, HWMON_CACHE
+# shellcheck source=scripts/nct-hwmon.sh
+source "$(dirname "$(readlink -f "${BASH_SOURCE[0]}")")/nct-hwmon.sh" || exit 1
+readonly PLAN_PATH="/var/cache/eirikr/nct-fan.plan"
 
 # Default 7-point SmartFan IV curve (conservative, gradual ramp)
 # DECISION: Wider spacing for acoustic comfort + thermal safety
@@ -125,7 +131,8 @@ declare -a DEFAULT_PWMS_7PT=(
 	255     # 100%
 )
 
-# Default timing (milliseconds)
+# Default timing (milliseconds); nct-step --capture/--analyse measures
+# the step response and suggests per-header values
 DEFAULT_STEP_UP_TIME=800      # ms before increasing duty
 DEFAULT_STEP_DOWN_TIME=1200   # ms before decreasing duty
 DEFAULT_STOP_TIME=3000        # ms below threshold before stopping
@@ -147,23 +154,34 @@ log_error() {
 }
 
 ################################################################################
-# HWMON DETECTION
+# NATIVE PROFILE APPLIER
 ################################################################################
 
-find_nct6798_hwmon() {
-	# WHAT: Locate hwmon device for NCT6798D
-	# WHY: Multiple hwmon devices may exist; must find the right one
-	# HOW: Check /sys/class/hwmon/hwmonX/name for "nct6798"
-	# RETURNS: Path to hwmon device (e.g., /sys/class/hwmon/hwmon2)
+apply_profile() {
+	# WHAT: Apply "[?|!]attribute value" lines from stdin to the hwmon device
+	# WHY: One process opens each attribute once (openat on a dirfd) instead of
+	#      forking `sudo tee` for every write
+	# HOW: nct-fan reports each failed attribute as [ERROR]/[WARN] and exits
+	#      non-zero if any required write failed; a failed gate write only
+	#      warns and skips that header, as the former `sudo tee` path did
+	# MODE: MAX_FANS_MODE=reconcile (--reconcile, max-fans-restore.service)
+	#      reads the chip first and writes only drifted attributes, without
+	#      the pwmN_enable=0 gate unless a curve attribute changed
+	# FORMAT: see the PROFILE FORMAT section in scripts/nct-fan.c
 
-	local hwmon
-	for hwmon in "$HWMON_PATH"/hwmon*; do
-		if [ -f "$hwmon/name" ] && grep -q "nct6798" "$hwmon/name" 2>/dev/null; then
-			echo "$hwmon"
-			return 0
-		fi
-	done
-	return 1
+	local hwmon="$1"
+	local nct_fan
+	nct_fan=$(find_nct_fan) || {
+		log_error "nct-fan not found (build with 'make build' or set NCT_FAN)"
+		return 1
+	}
+
+	local mode="--apply"
+	if [ "${MAX_FANS_MODE:-apply}" = "reconcile" ]; then
+		mode="--reconcile"
+	fi
+
+	sudo "$nct_fan" "$mode" - "$hwmon"
 }
 
 ################################################################################
@@ -173,7 +191,8 @@ find_nct6798_hwmon() {
 set_smartfan_7pt() {
 	# WHAT: Install 7-point SmartFan IV curves on all PWM outputs
 	# WHY: More granular control than 5 points; better thermal response
-	# HOW: Write to pwmX_auto_pointN_{temp,pwm}, set timing controls
+	# HOW: Emit pwmX_auto_pointN_{temp,pwm}, timing and enable writes as one
+	#      profile and apply it with a single nct-fan process
 	# DECISION: 7 points matches the Nuvoton family's maximum capability
 
 	local hwmon="$1"
@@ -184,64 +203,38 @@ set_smartfan_7pt() {
 	log_info "Installing 7-point SmartFan IV on all PWM outputs..."
 	log_info "  Step-up time: ${step_up}ms, Step-down time: ${step_down}ms, Stop time: ${stop_time}ms"
 
-	local pwm_fail=0
-	for pwm in {1..6}; do
-		log_info "Configuring pwm${pwm}..."
+	local point
+	for point in {1..7}; do
+		log_info "  Point $point: ${DEFAULT_TEMPS_7PT[$((point - 1))]}mC → PWM ${DEFAULT_PWMS_7PT[$((point - 1))]}"
+	done
 
-		# Disable temporarily to avoid conflicts
-		echo 0 | sudo tee "$hwmon/pwm${pwm}_enable" >/dev/null 2>&1 || {
-			log_warn "Cannot disable pwm${pwm}; skipping"
-			continue
-		}
+	local pwm
+	{
+		for pwm in {1..6}; do
+			# Disable temporarily to avoid conflicts (gate: skip header on failure)
+			echo "!pwm${pwm}_enable 0"
 
-		# Set all 7 points
-		for point in {1..7}; do
-			local temp_idx=$((point - 1))
-			local temp="${DEFAULT_TEMPS_7PT[$temp_idx]}"
-			local pwm_val="${DEFAULT_PWMS_7PT[$temp_idx]}"
+			# Set all 7 points
+			for point in {1..7}; do
+				echo "pwm${pwm}_auto_point${point}_temp ${DEFAULT_TEMPS_7PT[$((point - 1))]}"
+				echo "pwm${pwm}_auto_point${point}_pwm ${DEFAULT_PWMS_7PT[$((point - 1))]}"
+			done
 
-			echo "$temp" | sudo tee "$hwmon/pwm${pwm}_auto_point${point}_temp" >/dev/null 2>&1 || {
-				log_error "Failed to set point $point temperature"
-				((pwm_fail++))
-				continue
-			}
-			echo "$pwm_val" | sudo tee "$hwmon/pwm${pwm}_auto_point${point}_pwm" >/dev/null 2>&1 || {
-				log_error "Failed to set point $point PWM"
-				((pwm_fail++))
-				continue
-			}
+			# Set timing controls (optional: warn only)
+			echo "?pwm${pwm}_step_up_time $step_up"
+			echo "?pwm${pwm}_step_down_time $step_down"
+			echo "?pwm${pwm}_stop_time $stop_time"
 
-			log_info "  Point $point: ${temp}mC → PWM $pwm_val"
+			# Enable SmartFan IV mode (5)
+			echo "pwm${pwm}_enable 5"
 		done
-
-		# Set timing controls
-		echo "$step_up" | sudo tee "$hwmon/pwm${pwm}_step_up_time" >/dev/null 2>&1 || {
-			log_warn "Cannot set step_up_time on pwm${pwm}"
-		}
-		echo "$step_down" | sudo tee "$hwmon/pwm${pwm}_step_down_time" >/dev/null 2>&1 || {
-			log_warn "Cannot set step_down_time on pwm${pwm}"
-		}
-		echo "$stop_time" | sudo tee "$hwmon/pwm${pwm}_stop_time" >/dev/null 2>&1 || {
-			log_warn "Cannot set stop_time on pwm${pwm}"
-		}
-
-		# Enable SmartFan IV mode (5)
-		echo 5 | sudo tee "$hwmon/pwm${pwm}_enable" >/dev/null 2>&1 || {
-			log_error "Failed to enable SmartFan IV on pwm${pwm}"
-			((pwm_fail++))
-			continue
-		}
-
-		log_info "  ✓ pwm${pwm}: SmartFan IV enabled (mode 5)"
-	done
-
-	if [ $pwm_fail -eq 0 ]; then
-		log_info "✓ SmartFan 7-point: All 6 PWM outputs configured"
-		return 0
-	else
-		log_error "✗ SmartFan 7-point: $pwm_fail failures"
+	} | apply_profile "$hwmon" || {
+		log_error "✗ SmartFan 7-point: failures reported above"
 		return 1
-	fi
+	}
+
+	log_info "✓ SmartFan 7-point: All 6 PWM outputs configured"
+	return 0
 }
 
 ################################################################################
@@ -262,39 +255,20 @@ set_thermal_cruise() {
 	log_info "Configuring Thermal Cruise on pwm${pwm}..."
 	log_info "  Target: ${target_temp}mC (${tolerance}mC tolerance)"
 
-	echo 0 | sudo tee "$hwmon/pwm${pwm}_enable" >/dev/null 2>&1 || {
-		log_error "Cannot disable pwm${pwm}"
-		return 1
-	}
-
-	echo "$target_temp" | sudo tee "$hwmon/pwm${pwm}_target_temp" >/dev/null 2>&1 || {
-		log_error "Cannot set target temperature"
-		return 1
-	}
-
-	echo "$tolerance" | sudo tee "$hwmon/pwm${pwm}_temp_tolerance" >/dev/null 2>&1 || {
-		log_error "Cannot set tolerance"
-		return 1
-	}
-
-	# Set floor and ceiling
-	echo 64 | sudo tee "$hwmon/pwm${pwm}_start" >/dev/null 2>&1 || {
-		log_warn "Cannot set start PWM"
-	}
-	echo 32 | sudo tee "$hwmon/pwm${pwm}_floor" >/dev/null 2>&1 || {
-		log_warn "Cannot set floor PWM"
-	}
-
-	# Set timing
-	echo 500 | sudo tee "$hwmon/pwm${pwm}_step_up_time" >/dev/null 2>&1 || {
-		log_warn "Cannot set step_up_time"
-	}
-	echo 1000 | sudo tee "$hwmon/pwm${pwm}_step_down_time" >/dev/null 2>&1 || {
-		log_warn "Cannot set step_down_time"
-	}
-
-	# Enable Thermal Cruise (mode 2)
-	echo 2 | sudo tee "$hwmon/pwm${pwm}_enable" >/dev/null 2>&1 || {
+	# Floor/start and timing are optional; disable, target, tolerance and
+	# enable are not. The disable is a plain write, not a `!` gate: a failed
+	# gate only warns and skips the header, and with one header there would
+	# be nothing left to apply while nct-fan still exited 0
+	apply_profile "$hwmon" <<-PROFILE || {
+		pwm${pwm}_enable 0
+		pwm${pwm}_target_temp $target_temp
+		pwm${pwm}_temp_tolerance $tolerance
+		?pwm${pwm}_start 64
+		?pwm${pwm}_floor 32
+		?pwm${pwm}_step_up_time 500
+		?pwm${pwm}_step_down_time 1000
+		pwm${pwm}_enable 2
+	PROFILE
 		log_error "Failed to enable Thermal Cruise"
 		return 1
 	}
@@ -327,33 +301,24 @@ set_dual_sensor_weighting() {
 		return 1
 	fi
 
-	# Select secondary sensor
-	echo "$secondary_sensor" | sudo tee "$hwmon/pwm${pwm}_weight_temp_sel" >/dev/null 2>&1 || {
+	# weight_temp_sel:       secondary sensor selection (required)
+	# weight_temp_step:      how much secondary temp influences the curve (2 C)
+	# weight_temp_step_base: base temperature for secondary influence (50 C)
+	# weight_duty_step:      PWM adjustment per step
+	# weight_temp_step_tol:  tolerance for secondary temp (2 C)
+	# The three temperatures are millidegrees, as nct-profile compiles them;
+	# a bare 2 is rounded to 0 C by the driver
+	apply_profile "$hwmon" <<-PROFILE || {
+		pwm${pwm}_weight_temp_sel $secondary_sensor
+		?pwm${pwm}_weight_temp_step 2000
+		?pwm${pwm}_weight_temp_step_base 50000
+		?pwm${pwm}_weight_duty_step 10
+		?pwm${pwm}_weight_temp_step_tol 2000
+	PROFILE
 		log_error "Failed to select secondary sensor"
 		return 1
 	}
 
-	# Set weighting parameters
-	# weight_temp_step: how much secondary temp influences the curve
-	echo 2 | sudo tee "$hwmon/pwm${pwm}_weight_temp_step" >/dev/null 2>&1 || {
-		log_warn "Cannot set weight_temp_step"
-	}
-
-	# weight_temp_step_base: base temperature for secondary influence
-	echo 50000 | sudo tee "$hwmon/pwm${pwm}_weight_temp_step_base" >/dev/null 2>&1 || {
-		log_warn "Cannot set weight_temp_step_base"
-	}
-
-	# weight_duty_step: PWM adjustment per step
-	echo 10 | sudo tee "$hwmon/pwm${pwm}_weight_duty_step" >/dev/null 2>&1 || {
-		log_warn "Cannot set weight_duty_step"
-	}
-
-	# weight_temp_step_tol: tolerance for secondary temp
-	echo 2 | sudo tee "$hwmon/pwm${pwm}_weight_temp_step_tol" >/dev/null 2>&1 || {
-		log_warn "Cannot set weight_temp_step_tol"
-	}
-
 	log_info "✓ pwm${pwm}: Dual-sensor weighting enabled"
 	return 0
 }
@@ -379,7 +344,7 @@ set_electrical_mode() {
 
 	log_info "Setting electrical mode on pwm${pwm}: $([ $mode_val -eq 0 ] && echo "DC" || echo "PWM")"
 
-	echo "$mode_val" | sudo tee "$hwmon/pwm${pwm}_mode" >/dev/null 2>&1 || {
+	echo "pwm${pwm}_mode $mode_val" | apply_profile "$hwmon" || {
 		log_error "Failed to set electrical mode"
 		return 1
 	}
@@ -413,7 +378,7 @@ set_tachometry() {
 			;;
 	esac
 
-	echo "$pulses" | sudo tee "$hwmon/fan${fan}_pulses" >/dev/null 2>&1 || {
+	echo "fan${fan}_pulses $pulses" | apply_profile "$hwmon" || {
 		log_error "Failed to set fan${fan} pulses"
 		return 1
 	}
@@ -422,6 +387,36 @@ set_tachometry() {
 	return 0
 }
 
+################################################################################
+# COMPILED PROFILE PLAN
+################################################################################
+
+apply_plan() {
+	# WHAT: Apply a write plan compiled by `nct-profile --compile`
+	# WHY: The declarative profile (/usr/local/etc/nct-fan-profile.conf) was
+	#      validated and expanded at compile time; this is one nct-fan pass
+	#      over fixed records with no parsing
+	# HOW: nct-fan recognises the plan on stdin by its magic byte; the
+	#      reconcile mode, gates and failure reporting are the text path's
+
+	local hwmon="$1"
+	local plan="${2:-$PLAN_PATH}"
+
+	if [ ! -r "$plan" ]; then
+		log_error "No compiled plan at $plan (run: nct-profile --compile PROFILE)"
+		return 1
+	fi
+
+	log_info "Applying compiled plan $plan..."
+	apply_profile "$hwmon" <"$plan" || {
+		log_error "✗ Plan: failures reported above"
+		return 1
+	}
+
+	log_info "✓ Plan applied"
+	return 0
+}
+
 ################################################################################
 # KERNEL DEBOUNCE
 ################################################################################
@@ -456,14 +451,28 @@ enable_kernel_debounce() {
 verify_and_report() {
 	# WHAT: Comprehensive system inspection
 	# WHY: Identify which attributes are available, current state
-	# HOW: Probe all sysfs nodes, report findings
+	# HOW: `nct-fan --verify` reads every value in one process through the
+	#      hwmon dirfd; the loops below are only the fallback when nct-fan
+	#      is not built. "--json" passes through for inventory tooling
+	#      (schema: verify() in scripts/nct-fan.c)
 
+	local format="${1:-}"
 	local hwmon
-	hwmon=$(find_nct6798_hwmon) || {
+	hwmon=$(resolve_nct_hwmon) || {
 		log_error "NCT6798D device not found"
 		return 1
 	}
 
+	local nct_fan
+	if nct_fan=$(find_nct_fan); then
+		"$nct_fan" --verify "$hwmon" ${format:+"$format"}
+		return
+	fi
+	if [ "$format" = "--json" ]; then
+		log_error "--json requires nct-fan (build with 'make build' or set NCT_FAN)"
+		return 1
+	fi
+
 	log_info "Found NCT6798D at $hwmon"
 	log_info ""
 
@@ -565,12 +574,26 @@ COMMANDS:
     Set tachometry pulses-per-rev (1,2,3,4,5,8)
     Example: --tachometry 1 --pulses 4
 
+  --plan [PLAN]
+    Apply a plan compiled from a declarative profile by nct-profile
+    (default: $PLAN_PATH)
+    Example: nct-profile --compile /usr/local/etc/nct-fan-profile.conf
+             max-fans-advanced.sh --plan
+
   --debounce-enable
     Enable kernel-level fan debounce
     (persistent: add to /etc/modprobe.d/nct6775.conf)
 
-  --verify
-    Probe and report all sensor/control states
+  --verify [--json]
+    Probe and report all sensor/control states; --json prints one
+    machine-readable object (nct-fan --verify --json)
+
+  --reconcile COMMAND [OPTIONS]
+    Run COMMAND in reconcile mode: read the current chip state first and
+    write only the attributes that differ (no pwm_enable=0 blip when the
+    curve is unchanged). Same as MAX_FANS_MODE=reconcile, which
+    max-fans-restore.service sets for every command in its config
+    Example: --reconcile --smartfan-7pt --timing 800 1200 3000
 
   --help
     Show this message
@@ -595,6 +618,11 @@ EOF
 ################################################################################
 
 main() {
+	if [ $# -gt 0 ] && [ "$1" = "--reconcile" ]; then
+		export MAX_FANS_MODE="reconcile"
+		shift
+	fi
+
 	if [ $# -eq 0 ]; then
 		show_help
 		return 1
@@ -603,7 +631,7 @@ main() {
 	case "$1" in
 		--smartfan-7pt)
 			local hwmon
-			hwmon=$(find_nct6798_hwmon) || {
+			hwmon=$(resolve_nct_hwmon) || {
 				log_error "NCT6798D device not found"
 				return 1
 			}
@@ -620,6 +648,15 @@ main() {
 				step_up="$3"
 				step_down="$4"
 				stop_time="$5"
+				# nct6775 stores 100 ms units: an off-grid value reads back
+				# rounded and --reconcile would regate the header every run
+				local ms
+				for ms in "$step_up" "$step_down" "$stop_time"; do
+					if ! [[ "$ms" =~ ^[0-9]+$ ]] || ((ms < 100 || ms > 25500 || ms % 100)); then
+						log_error "--timing values must be multiples of 100 in 100-25500 ms (got $ms)"
+						return 1
+					fi
+				done
 			fi
 
 			set_smartfan_7pt "$hwmon" "$step_up" "$step_down" "$stop_time"
@@ -632,7 +669,7 @@ main() {
 			}
 
 			local hwmon
-			hwmon=$(find_nct6798_hwmon) || {
+			hwmon=$(resolve_nct_hwmon) || {
 				log_error "NCT6798D device not found"
 				return 1
 			}
@@ -660,7 +697,7 @@ main() {
 			}
 
 			local hwmon
-			hwmon=$(find_nct6798_hwmon) || {
+			hwmon=$(resolve_nct_hwmon) || {
 				log_error "NCT6798D device not found"
 				return 1
 			}
@@ -688,7 +725,7 @@ main() {
 			}
 
 			local hwmon
-			hwmon=$(find_nct6798_hwmon) || {
+			hwmon=$(resolve_nct_hwmon) || {
 				log_error "NCT6798D device not found"
 				return 1
 			}
@@ -715,7 +752,7 @@ main() {
 			}
 
 			local hwmon
-			hwmon=$(find_nct6798_hwmon) || {
+			hwmon=$(resolve_nct_hwmon) || {
 				log_error "NCT6798D device not found"
 				return 1
 			}
@@ -734,12 +771,22 @@ main() {
 			set_tachometry "$hwmon" "$fan" "$pulses"
 			;;
 
+		--plan)
+			local hwmon
+			hwmon=$(resolve_nct_hwmon) || {
+				log_error "NCT6798D device not found"
+				return 1
+			}
+
+			apply_plan "$hwmon" "${2:-}"
+			;;
+
 		--debounce-enable)
 			enable_kernel_debounce
 			;;
 
 		--verify)
-			verify_and_report
+			verify_and_report "${2:-}"
 			;;
 
 		--help|-h)
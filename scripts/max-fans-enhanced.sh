@@ -69,7 +69,9 @@ set -o pipefail
 # CONFIGURATION
 ################################################################################
 
-readonly HWMON_PATH="/sys/class/hwmon"
+# Shared hwmon resolution: find_nct_fan, resolve_nct_hwmon, HWMON_CACHE
+# shellcheck source=scripts/nct-hwmon.sh
+source "$(dirname "$(readlink -f "${BASH_SOURCE[0]}")")/nct-hwmon.sh" || exit 1
 readonly DEFAULT_PWM=255
 SCRIPT_NAME="$(basename "$0")"
 readonly SCRIPT_NAME
@@ -125,66 +127,63 @@ log_warn() {
 
 verify_nct6798d() {
 	# PURPOSE: Confirm NCT6798D is present and accessible via hwmon
-	# WHAT: Scan /sys/class/hwmon for nct6798d or asus hwmon devices
+	# WHAT: Resolve the nct67xx hwmon device (cached) and report its sensors
 	# WHY: Ensures we have the right chip before proceeding
-	# HOW: Grep device name and report temperature sensors
+	# HOW: resolve_nct_hwmon, then `nct-fan --verify` (one process, mode
+	#      names decoded); the loops below are the fallback without nct-fan
 	# RETURNS: 0 if found, 1 if not found
 
-	log_info "Searching for NCT6798D or ASUS hwmon device..."
+	log_info "Searching for NCT6798D hwmon device..."
 
-	local found_device=""
-	for hwmon_dir in "$HWMON_PATH"/hwmon*; do
-		if [[ ! -d "$hwmon_dir" ]]; then
-			continue
+	local hwmon_dir nct_fan
+	if hwmon_dir=$(resolve_nct_hwmon); then
+		if nct_fan=$(find_nct_fan); then
+			"$nct_fan" --verify "$hwmon_dir" && log_info "Device verification successful"
+			return
 		fi
 
 		local device_name="unknown"
 		if [[ -f "$hwmon_dir/name" ]]; then
-			device_name=$(cat "$hwmon_dir/name")
+			device_name=$(<"$hwmon_dir/name")
 		fi
 
-		# DECISION: Match "nct6798d", "asus", "nct67" (case-insensitive)
-		# WHY: Different board vendors expose different names
-		#      "asus" = ASUS WMI sensors (also has NCT6798D underneath)
-		#      "nct6798d" = direct kernel driver identification
-		#      "nct67" = generic match for all 679x chips
-		if [[ "$device_name" =~ ^(nct6798d|asus|nct67) ]]; then
-			found_device="$hwmon_dir"
-			log_info "  Found: $device_name at $hwmon_dir"
-
-			# Report available temperature sensors
-			local temp_count=0
-			for temp_file in "$hwmon_dir"/temp*_input; do
-				if [[ -f "$temp_file" ]]; then
-					temp_count=$((temp_count + 1))
-					local temp_label
-					local temp_val
-					temp_label=$(cat "$hwmon_dir/temp${temp_count}_label" 2>/dev/null || echo "Temp $temp_count")
-					temp_val=$(cat "$temp_file" 2>/dev/null || echo "?")
-					log_info "    $temp_label: $((temp_val / 1000))°C (raw: ${temp_val})"
-				fi
-			done
+		# DECISION: Only the nct6775-driven chip (name "nct67*")
+		# WHY: asus_wmi_sensors ("asus") is read-only and exposes no pwm
+		#      attributes; the NCT6798D underneath is the nct67* device
+		log_info "  Found: $device_name at $hwmon_dir"
+
+		# Report available temperature sensors
+		local temp_count=0
+		for temp_file in "$hwmon_dir"/temp*_input; do
+			if [[ -f "$temp_file" ]]; then
+				temp_count=$((temp_count + 1))
+				local temp_label
+				local temp_val
+				temp_label=$(cat "$hwmon_dir/temp${temp_count}_label" 2>/dev/null || echo "Temp $temp_count")
+				temp_val=$(cat "$temp_file" 2>/dev/null || echo "?")
+				log_info "    $temp_label: $((temp_val / 1000))°C (raw: ${temp_val})"
+			fi
+		done
 
-			# Report available PWM outputs
-			local pwm_count=0
-			for pwm_file in "$hwmon_dir"/pwm[0-9]; do
-				if [[ -f "$pwm_file" ]]; then
-					pwm_count=$((pwm_count + 1))
-					local pwm_val
-					local pwm_enable
-					pwm_val=$(cat "$pwm_file" 2>/dev/null || echo "?")
-					pwm_enable=$(cat "$hwmon_dir/pwm${pwm_count}_enable" 2>/dev/null || echo "?")
-					# decode enable: 0=disabled, 1=manual, 2=pwm, 4=temp, 5=SmartFan IV
-					log_info "    PWM$pwm_count: $pwm_val/255 (enable=$pwm_enable)"
-				fi
-			done
+		# Report available PWM outputs
+		local pwm_count=0
+		for pwm_file in "$hwmon_dir"/pwm[0-9]; do
+			if [[ -f "$pwm_file" ]]; then
+				pwm_count=$((pwm_count + 1))
+				local pwm_val
+				local pwm_enable
+				pwm_val=$(cat "$pwm_file" 2>/dev/null || echo "?")
+				pwm_enable=$(cat "$hwmon_dir/pwm${pwm_count}_enable" 2>/dev/null || echo "?")
+				# decode enable: 0=disabled, 1=manual, 2=pwm, 4=temp, 5=SmartFan IV
+				log_info "    PWM$pwm_count: $pwm_val/255 (enable=$pwm_enable)"
+			fi
+		done
 
-			log_info "Device verification successful"
-			return 0
-		fi
-	done
+		log_info "Device verification successful"
+		return 0
+	fi
 
-	log_error "NCT6798D/ASUS hwmon device not found"
+	log_error "NCT6798D hwmon device not found"
 	return 1
 }
 
@@ -192,6 +191,21 @@ verify_nct6798d() {
 # MANUAL PWM CONTROL
 ################################################################################
 
+apply_with_nct_fan() {
+	# PURPOSE: Apply "[?|!]attribute value" lines from stdin in one nct-fan pass
+	# WHY: With nct-broker.service running the whole batch is one broker
+	#      request, so a hand-run --manual / --smartfan cannot interleave its
+	#      pwmN_enable / pwmN writes with max-fans-restore.service or
+	#      nct-fanctl writing the same headers
+	# PARAMS:
+	#   $1 = nct-fan path, $2 = hwmon_dir
+	#   $3 = pattern of nct-fan output lines that count as a failed header
+	# RETURNS: prints the number of matching lines; nct-fan's own [ERROR] /
+	#          [WARN] lines are passed through on stderr
+
+	"$1" --apply - "$2" 2>&1 | tee /dev/stderr | grep -c -e "$3"
+}
+
 set_fan_manual() {
 	# PURPOSE: Set fans to fixed PWM (simple mode)
 	# WHAT: Write PWM value to all pwmN files
@@ -218,6 +232,21 @@ set_fan_manual() {
 	local success_count=0
 	local failed_count=0
 
+	# Native path: per header a gate (pwmN_enable=1, skips the duty if it
+	# fails) then the duty, as one nct-fan pass / broker request
+	local nct_fan pwm_file profile=""
+	if nct_fan=$(find_nct_fan); then
+		for pwm_file in "$hwmon_dir"/pwm[0-9]; do
+			[[ ! -f "$pwm_file" ]] && continue
+			pwm_count=$((pwm_count + 1))
+			profile+="!$(basename "$pwm_file")_enable 1"$'\n'"$(basename "$pwm_file") $pwm_value"$'\n'
+		done
+		failed_count=$(apply_with_nct_fan "$nct_fan" "$hwmon_dir" 'Failed to set\|; skipping pwm' <<<"$profile")
+		success_count=$((pwm_count - failed_count))
+		log_info "Manual mode: $success_count PWM outputs set, $failed_count failed"
+		[[ $success_count -gt 0 ]] && return 0 || return 1
+	fi
+
 	# Iterate all pwmN files in the hwmon device
 	for pwm_file in "$hwmon_dir"/pwm[0-9]; do
 		[[ ! -f "$pwm_file" ]] && continue
@@ -277,6 +306,25 @@ set_fan_smartfan_iv() {
 	local success_count=0
 	local failed_count=0
 
+	# Native path: points are optional writes (a point the chip lacks is a
+	# warning, as below), pwmN_enable=5 is required; one nct-fan pass
+	local nct_fan pwm_file idx profile=""
+	if nct_fan=$(find_nct_fan); then
+		for pwm_file in "$hwmon_dir"/pwm[0-9]; do
+			[[ ! -f "$pwm_file" ]] && continue
+			pwm_count=$((pwm_count + 1))
+			for idx in "${!SMARTFAN_TEMPS[@]}"; do
+				profile+="?$(basename "$pwm_file")_auto_point$((idx + 1))_temp ${SMARTFAN_TEMPS[$idx]}"$'\n'
+				profile+="?$(basename "$pwm_file")_auto_point$((idx + 1))_pwm ${SMARTFAN_PWMS[$idx]}"$'\n'
+			done
+			profile+="$(basename "$pwm_file")_enable 5"$'\n'
+		done
+		failed_count=$(apply_with_nct_fan "$nct_fan" "$hwmon_dir" 'Failed to set pwm[0-9]*_enable' <<<"$profile")
+		success_count=$((pwm_count - failed_count))
+		log_info "SmartFan IV: $success_count PWM outputs configured, $failed_count failed"
+		[[ $success_count -gt 0 ]] && return 0 || return 1
+	fi
+
 	# Iterate all pwmN files in the hwmon device
 	for pwm_file in "$hwmon_dir"/pwm[0-9]; do
 		[[ ! -f "$pwm_file" ]] && continue
@@ -408,26 +456,12 @@ main() {
 	# DECISION: Require explicit device match (not just any hwmon)
 	# WHY: Safer; avoids affecting unrelated hwmon devices
 	local found_device=""
-	for hwmon_dir in "$HWMON_PATH"/hwmon*; do
-		if [[ ! -d "$hwmon_dir" ]]; then
-			continue
-		fi
-
-		local device_name="unknown"
-		if [[ -f "$hwmon_dir/name" ]]; then
-			device_name=$(cat "$hwmon_dir/name")
-		fi
-
-		# Match against known NCT6798D / ASUS identifiers
-		if [[ "$device_name" =~ ^(nct6798d|asus|nct67) ]]; then
-			found_device="$hwmon_dir"
-			log_info "Found NCT6798D/ASUS device: $device_name at $hwmon_dir"
-			break
-		fi
-	done
+	if found_device=$(resolve_nct_hwmon); then
+		log_info "Found NCT6798D device: $(<"$found_device/name") at $found_device"
+	fi
 
 	if [[ -z "$found_device" ]]; then
-		log_error "No NCT6798D/ASUS hwmon device found"
+		log_error "No NCT6798D hwmon device found"
 		log_error "Verify kernel nct6775 driver is loaded: sudo modprobe nct6775"
 		return 1
 	fi
@@ -7,7 +7,10 @@
 
 set -u
 
-readonly HWMON_PATH="/sys/class/hwmon"
+# Shared hwmon resolution: find_nct_fan, resolve_nct_hwmon, HWMON_CACHE
+# shellcheck source=scripts/nct-hwmon.sh
+source "$(dirname "$(readlink -f "${BASH_SOURCE[0]}")")/nct-hwmon.sh" || exit 1
+
 readonly MAX_PWM=255
 readonly FANS=("pwm1" "pwm2" "pwm3" "pwm4" "pwm5" "pwm6")
 
@@ -36,29 +39,43 @@ set_fan_max() {
   return 0
 }
 
+# Write every present pwmN in one nct-fan pass. With nct-broker.service
+# running the writes are one broker request, serialized against
+# max-fans-restore.service and nct-fanctl instead of racing them.
+# Prints the number of failed writes.
+set_fans_max_native() {
+  local nct_fan="$1" hwmon_dir="$2" pwm profile=""
+
+  for pwm in "${FANS[@]}"; do
+    [[ -e "$hwmon_dir/$pwm" ]] && profile+="$pwm $MAX_PWM"$'\n'
+  done
+  "$nct_fan" --apply - "$hwmon_dir" <<< "$profile" 2>&1 >/dev/null \
+    | tee /dev/stderr | grep -c '^\[ERROR\] Failed to set'
+}
+
 main() {
   log_info "Setting all fans to maximum speed"
 
-  local hwmon_count=0
   local fans_set=0
   local fans_failed=0
 
-  # Find all hwmon devices
-  for hwmon_dir in "$HWMON_PATH"/hwmon*; do
-    if [[ ! -d "$hwmon_dir" ]]; then
-      continue
-    fi
-
-    hwmon_count=$((hwmon_count + 1))
-    local device_name="unknown"
-
-    if [[ -f "$hwmon_dir/name" ]]; then
-      device_name=$(cat "$hwmon_dir/name")
-    fi
+  local hwmon_dir
+  if ! hwmon_dir=$(resolve_nct_hwmon); then
+    log_error "No NCT67xx hwmon device found (is nct6775 loaded?)"
+    return 1
+  fi
 
-    log_info "Found hwmon device: $device_name at $hwmon_dir"
+  log_info "Found hwmon device: $(< "$hwmon_dir/name") at $hwmon_dir"
 
-    # Try to set each pwm device
+  local nct_fan pwm present=0
+  if nct_fan=$(find_nct_fan); then
+    for pwm in "${FANS[@]}"; do
+      [[ -e "$hwmon_dir/$pwm" ]] && present=$((present + 1))
+    done
+    fans_failed=$(set_fans_max_native "$nct_fan" "$hwmon_dir")
+    fans_set=$((present - fans_failed))
+  else
+    # Shell fallback (nct-fan not built): try to set each pwm device
     for pwm in "${FANS[@]}"; do
       local pwm_file="$hwmon_dir/$pwm"
 
@@ -72,9 +89,8 @@ main() {
         fans_failed=$((fans_failed + 1))
       fi
     done
-  done
+  fi
 
-  log_info "Total hwmon devices found: $hwmon_count"
   log_info "Fans set to maximum: $fans_set"
   log_info "Failed to set: $fans_failed"
 
@@ -0,0 +1,1730 @@
+/*
+ * nct-agent.c - Fleet push agent: rollups and events out, signed profiles in
+ *
+ * PURPOSE:
+ *   On every node: ship the sampler's precomputed rollups (nct-ring.h) and
+ *   agent events to a central collector in compressed batches over one
+ *   long-lived TCP connection, and apply signed compiled profiles
+ *   (nct-plan.h) the collector pushes back through the reconcile path.
+ *   The same binary is the collector (--serve) and the signing tool
+ *   (--sign). Wire format: nct-fleet.h.
+ *
+ * WHY THIS EXISTS:
+ *   Rolling a new curve across hundreds of B550 nodes meant editing
+ *   /usr/local/etc/max-fans-restore.conf on each host over SSH and waiting
+ *   for the timer, and fleet-wide thermals meant scraping every node. The
+ *   agent turns both around: nodes connect out, telemetry arrives already
+ *   aggregated (one record per bucket instead of 10 Hz samples), and a
+ *   profile reaches every connected node seconds after it is published.
+ *
+ * HOW (agent):
+ *   1. Once a second: re-attach the ring if the sampler restarted, copy
+ *      every newly closed bucket of the configured rollup windows into the
+ *      open batch, and note sampler up/down transitions as events. Alarm
+ *      transitions arrive on the local event socket (nct-fleet.h) from
+ *      nct-alarm's --exec hook and join the batch as they come
+ *   2. Every `batch` seconds: deflate the batch (zlib) into one BATCH
+ *      frame and queue it; frames leave the queue only when ACKed, so a
+ *      collector outage loses nothing until QUEUE_MAX batches pile up
+ *   3. Disconnected: reconnect with exponential backoff (1 s .. 60 s,
+ *      with jitter so a restarted collector is not hit by every node in
+ *      the same second), send HELLO, then every unacknowledged batch
+ *   4. PROFILE frame: verify the Ed25519 signature and that the generation
+ *      is newer than the last applied one, validate the plan, install it
+ *      as NCT_PLAN_PATH (so max-fans-restore.service keeps enforcing it
+ *      after a reboot), record its generation and run `nct-fan --reconcile
+ *      PLAN HWMON`; the outcome goes back as a RESULT frame and a
+ *      profile_* event. The generation follows the installed plan, not
+ *      the reconcile: a failed reconcile is retried by the restore timer
+ *      against that same plan, never by reinstalling it
+ *
+ * HOW (collector, --serve):
+ *   One poll(2) loop over every node connection. Each BATCH is inflated
+ *   and written as JSON lines (one per record) to --out, flushed, and only
+ *   then ACKed. --profile names a signed profile; it is re-read when the
+ *   file changes and pushed to every node reporting an older generation.
+ *   The output is meant to be piped into whatever stores the fleet's
+ *   metrics; the collector keeps no state of its own.
+ *
+ * CONFIG (default /usr/local/etc/nct-agent.conf; '#' comments):
+ *   collector HOST[:PORT]   collector address (port default 9799); required
+ *   node NAME               name reported in HELLO (default: hostname)
+ *   key FILE                Ed25519 public key (PEM) profiles must be signed
+ *                           with; without it every PROFILE is refused
+ *   rollups LIST            windows to ship: 1s,1m,1h (default 1m)
+ *   batch S                 seconds per batch, 5-3600 (default 60)
+ *   ring PATH               sampler ring (default /dev/shm/nct-telemetry)
+ *   plan PATH               where profiles are installed (default
+ *                           /var/cache/eirikr/nct-fan.plan)
+ *   hwmon DIR               NCT67xx hwmon directory (default: hwmon_resolve())
+ *   Example: examples/nct-agent.conf.example
+ *
+ * USAGE:
+ *   nct-agent [--config FILE] [--collector HOST[:PORT]] [--node NAME] [--once]
+ *     --once    Print the batch the current ring would produce as JSON
+ *               lines (the collector's output format) and exit
+ *   nct-agent --serve [--listen ADDR:PORT] [--profile FILE] [--out FILE]
+ *     --listen  IPv4 listen address (default 0.0.0.0:9799)
+ *     --profile Signed profile pushed to nodes (from --sign)
+ *     --out     Append JSON lines here (default stdout)
+ *   nct-agent --sign PLAN --key PRIVATE.pem [--generation N] [-o OUT]
+ *     Sign a compiled plan (nct-profile --compile) for distribution;
+ *     generation defaults to the current Unix time, so a later signing
+ *     always supersedes an earlier one. OUT defaults to PLAN.signed
+ *   nct-agent --alarm-event
+ *     nct-alarm --exec hook: send the transition in NCT_ALARM,
+ *     NCT_ALARM_STATE, NCT_ALARM_LABEL and NCT_ALARM_VALUE to the running
+ *     agent (socket NCT_FLEET_EVENT_PATH, $NCT_AGENT_SOCKET overrides)
+ *   Keys: openssl genpkey -algorithm ed25519 -out fleet-key.pem
+ *         openssl pkey -in fleet-key.pem -pubout -out nct-agent.pub
+ *
+ * EXIT STATUS:
+ *   0  clean shutdown (SIGINT/SIGTERM), profile signed, --once printed,
+ *      --alarm-event sent (or no agent running to send it to)
+ *   1  --once: no ring or no closed bucket yet
+ *   2  usage error, bad config, key/plan/listen failure, --alarm-event
+ *      outside an nct-alarm hook
+ *
+ * SAFETY / CAVEATS:
+ *   - Telemetry travels unencrypted; run it on the management network or
+ *     through a tunnel. Profiles are authenticated by their signature
+ *     regardless of transport, so a hostile network can delay a rollout
+ *     but never inject or roll back a profile
+ *   - Applying a profile needs write access to hwmon and to the plan path,
+ *     so the agent runs as root (nct-agent.service); --serve needs neither
+ *   - The collector interprets rollup records against the channel table of
+ *     the node's latest HELLO
+ *   - Alarm events are forwarded, not detected: they need nct-alarm running
+ *     with `--exec '/usr/lib/eirikr/nct-agent --alarm-event'` (the shipped
+ *     nct-alarm.service does), and a transition while the agent is down is
+ *     only in nct-alarm's journal
+ */
+
+#define _GNU_SOURCE
+#include "nct-fleet.h"
+#include "nct-hwmon.h"
+#include "nct-plan.h"
+#include "nct-ring.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <limits.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#define DEFAULT_CONFIG   "/usr/local/etc/nct-agent.conf"
+#define DEFAULT_LISTEN   "0.0.0.0:" NCT_FLEET_PORT
+#define GENERATION_PATH  "/var/lib/eirikr/nct-agent.generation"
+#define QUEUE_MAX        256          /* 4+ hours of 1m batches */
+#define BACKOFF_MAX_S    60
+#define CONNECT_WAIT_MS  5000
+#define SEND_TIMEOUT_S   10
+#define MAX_CLIENTS      1024
+#define TICK_NS          1000000000ll
+
+static volatile sig_atomic_t stop_requested;
+
+static void on_signal(int sig) {
+	(void)sig;
+	stop_requested = 1;
+}
+
+static int64_t clock_ns(clockid_t clock) {
+	struct timespec ts;
+	clock_gettime(clock, &ts);
+	return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* ============================================================================
+ * Frames and receive buffers (both sides)
+ * ============================================================================ */
+
+/*
+ * send_frame() - Frame header plus up to two payload parts in one writev(2)
+ * WHY blocking: sockets carry SO_SNDTIMEO, so a stuck peer costs at most
+ *     SEND_TIMEOUT_S and then the connection is dropped
+ * RETURNS: 0, or -1 (errno set)
+ */
+static int send_frame(int fd, uint16_t type, const void *a, size_t alen, const void *b, size_t blen) {
+	struct nct_fleet_frame f = {.magic = NCT_FLEET_MAGIC, .type = type, .length = (uint32_t)(alen + blen)};
+	struct iovec iov[3] = {{&f, sizeof(f)}, {(void *)a, alen}, {(void *)b, blen}};
+	struct msghdr msg = {.msg_iov = iov, .msg_iovlen = 3};
+	size_t left = sizeof(f) + alen + blen;
+
+	while (left > 0) {
+		ssize_t n = sendmsg(fd, &msg, MSG_NOSIGNAL);
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return -1;
+		}
+		left -= (size_t)n;
+		while (n > 0 && msg.msg_iovlen > 0) {
+			size_t take = (size_t)n < msg.msg_iov->iov_len ? (size_t)n : msg.msg_iov->iov_len;
+			msg.msg_iov->iov_base = (char *)msg.msg_iov->iov_base + take;
+			msg.msg_iov->iov_len -= take;
+			n -= (ssize_t)take;
+			if (msg.msg_iov->iov_len == 0) {
+				msg.msg_iov++;
+				msg.msg_iovlen--;
+			}
+		}
+	}
+	return 0;
+}
+
+struct rxbuf {
+	uint8_t *data;
+	size_t len, cap;
+};
+
+/*
+ * rx_pull() - Read what is available towards the current frame
+ * HOW:  Reads at most up to the end of the current frame, so a complete
+ *       frame is always data[0 .. len) and nothing of the next one
+ * RETURNS: 1 = frame complete, 0 = need more, -1 = peer closed, error or
+ *          malformed header (errno EPROTO)
+ */
+static int rx_pull(int fd, struct rxbuf *b) {
+	for (;;) {
+		size_t need = sizeof(struct nct_fleet_frame);
+		if (b->len >= need) {
+			const struct nct_fleet_frame *f = (const struct nct_fleet_frame *)b->data;
+			if (!nct_fleet_frame_ok(f)) {
+				errno = EPROTO;
+				return -1;
+			}
+			need += f->length;
+			if (b->len == need) {
+				return 1;
+			}
+		}
+		if (need > b->cap) {
+			uint8_t *p = realloc(b->data, need);
+			if (!p) {
+				return -1;
+			}
+			b->data = p;
+			b->cap = need;
+		}
+		ssize_t n = recv(fd, b->data + b->len, need - b->len, MSG_DONTWAIT);
+		if (n == 0) {
+			errno = ECONNRESET;
+			return -1;
+		}
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+		}
+		b->len += (size_t)n;
+	}
+}
+
+static void socket_tune(int fd) {
+	int one = 1, idle = 60, intvl = 20, cnt = 3;
+	struct timeval tv = {.tv_sec = SEND_TIMEOUT_S};
+	setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+	/* a silently vanished peer (power loss, partition) is noticed in ~2 min */
+	setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &one, sizeof(one));
+	setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, &idle, sizeof(idle));
+	setsockopt(fd, IPPROTO_TCP, TCP_KEEPINTVL, &intvl, sizeof(intvl));
+	setsockopt(fd, IPPROTO_TCP, TCP_KEEPCNT, &cnt, sizeof(cnt));
+}
+
+/* ============================================================================
+ * JSON output (collector and --once)
+ * ============================================================================ */
+
+static void json_str(FILE *out, const char *s) {
+	if (!s || !*s) {
+		fputs("null", out);
+		return;
+	}
+	fputc('"', out);
+	for (; *s; ++s) {
+		if (*s == '"' || *s == '\\') {
+			fprintf(out, "\\%c", *s);
+		} else if ((unsigned char)*s < 0x20) {
+			fprintf(out, "\\u%04x", (unsigned char)*s);
+		} else {
+			fputc(*s, out);
+		}
+	}
+	fputc('"', out);
+}
+
+static void json_time(FILE *out, int64_t t_ns) {
+	fprintf(out, "%lld.%03lld", (long long)(t_ns / 1000000000), (long long)(t_ns % 1000000000 / 1000000));
+}
+
+/*
+ * print_records() - One JSON line per record of an inflated batch
+ * IN:  ch[0..nch) the node's HELLO channel table
+ * HOW:  Values stay in sysfs units (millidegrees, RPM, millivolts, duty);
+ *       channels without a valid sample in the bucket are omitted
+ * RETURNS: records printed, or -1 if the batch is malformed
+ */
+static int print_records(FILE *out, const char *node, const struct nct_fleet_channel *ch, uint32_t nch,
+			 const void *raw, size_t len) {
+	static const char *const kind_name[] = {"temp", "fan", "in", "pwm", "pwm_enable"};
+	const struct nct_fleet_rec *r;
+	size_t off = 0;
+	int n = 0;
+
+	while ((r = nct_fleet_next_rec(raw, len, &off)) != NULL) {
+		if (r->type == NCT_FLEET_REC_ROLLUP) {
+			const struct nct_fleet_rollup *ru = (const struct nct_fleet_rollup *)r;
+			if (r->size < sizeof(*ru) || r->size < nct_fleet_rollup_size(ru->nchannels)) {
+				return -1;
+			}
+			fputs("{\"node\":", out);
+			json_str(out, node);
+			fputs(",\"t\":", out);
+			json_time(out, ru->t_start_ns);
+			if (ru->period_s % 3600 == 0) {
+				fprintf(out, ",\"window\":\"%uh\"", ru->period_s / 3600);
+			} else if (ru->period_s % 60 == 0) {
+				fprintf(out, ",\"window\":\"%um\"", ru->period_s / 60);
+			} else {
+				fprintf(out, ",\"window\":\"%us\"", ru->period_s);
+			}
+			fprintf(out, ",\"samples\":%u,\"channels\":[", ru->nsamples);
+			bool first = true;
+			for (uint32_t i = 0; i < ru->nchannels; ++i) {
+				const struct nct_fleet_agg *a = &ru->agg[i];
+				if (a->min == NCT_FLEET_INVALID) {
+					continue;
+				}
+				fputs(first ? "{\"name\":" : ",{\"name\":", out);
+				json_str(out, i < nch ? ch[i].name : NULL);
+				fputs(",\"label\":", out);
+				json_str(out, i < nch ? ch[i].label : NULL);
+				fprintf(out, ",\"kind\":\"%s\",\"min\":%d,\"max\":%d,\"mean\":%d,\"last\":%d}",
+					i < nch && ch[i].kind < 5 ? kind_name[ch[i].kind] : "unknown",
+					a->min, a->max, a->mean, a->last);
+				first = false;
+			}
+			fputs("]}\n", out);
+			n++;
+		} else if (r->type == NCT_FLEET_REC_EVENT) {
+			const struct nct_fleet_event *ev = (const struct nct_fleet_event *)r;
+			if (r->size < sizeof(*ev)) {
+				return -1;
+			}
+			char text[NCT_FLEET_TEXT_MAX];
+			snprintf(text, sizeof(text), "%s", ev->text);
+			fputs("{\"node\":", out);
+			json_str(out, node);
+			fputs(",\"t\":", out);
+			json_time(out, ev->t_ns);
+			fputs(",\"event\":", out);
+			json_str(out, ev->kind < NCT_FLEET_EV_KIND_COUNT ? nct_fleet_event_name[ev->kind] : "unknown");
+			fprintf(out, ",\"value\":%lld,\"channel\":", (long long)ev->value);
+			json_str(out, ev->channel >= 0 && (uint32_t)ev->channel < nch ? ch[ev->channel].name : NULL);
+			fputs(",\"text\":", out);
+			json_str(out, text);
+			fputs("}\n", out);
+			n++;
+		}
+	}
+	return off == len ? n : -1;
+}
+
+/* ============================================================================
+ * Agent
+ * ============================================================================ */
+
+struct agent_config {
+	char collector[256];
+	char node[NCT_FLEET_NODE_MAX];
+	char key[256];
+	char ring[256];
+	char plan[256];
+	char hwmon[HWMON_PATH_MAX];
+	bool rollup_level[NCT_RING_ROLLUP_LEVELS];
+	int batch_s;
+};
+
+struct queued {
+	uint64_t seq;
+	size_t len;
+	uint8_t *payload;               /* struct nct_fleet_batch + deflate stream */
+};
+
+struct agent {
+	struct agent_config cfg;
+	EVP_PKEY *key;
+	uint64_t generation;            /* last profile applied */
+
+	const struct nct_ring_header *ring;
+	size_t ring_size;
+	ino_t ring_ino;
+	bool sampler_up;
+	uint64_t last_start[NCT_RING_ROLLUP_LEVELS];   /* newest bucket shipped, ring clock */
+
+	uint64_t buf[NCT_FLEET_RAW_MAX / 8];   /* open batch, raw records */
+	size_t raw_len;
+	uint32_t nrecords;
+	int64_t batch_start_ns;
+	uint64_t next_seq;
+	uint64_t dropped;               /* batches lost since the last event */
+
+	struct queued queue[QUEUE_MAX];
+	int nqueued;
+
+	int event_fd;                   /* local event socket, -1 if unavailable */
+
+	int fd;
+	uint64_t sent_seq;              /* newest batch written on this connection */
+	int backoff_s;
+	int64_t next_connect_ns;
+	struct rxbuf rx;
+};
+
+/*
+ * parse_rollups() - "1s,1m,1h" into rollup_level[] flags
+ * RETURNS: 0, or -1 on an unknown window
+ */
+static int parse_rollups(bool *level, const char *list) {
+	char buf[64];
+	snprintf(buf, sizeof(buf), "%s", list);
+	memset(level, 0, NCT_RING_ROLLUP_LEVELS * sizeof(*level));
+	for (char *save, *tok = strtok_r(buf, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+		uint32_t l = 0;
+		while (l < NCT_RING_ROLLUP_LEVELS && strcmp(tok, nct_ring_rollup_spec[l].name) != 0) {
+			l++;
+		}
+		if (l == NCT_RING_ROLLUP_LEVELS) {
+			return -1;
+		}
+		level[l] = true;
+	}
+	return 0;
+}
+
+static void copy_str(char *dst, size_t len, const char *src) {
+	size_t n = strnlen(src, len - 1);
+	memcpy(dst, src, n);
+	dst[n] = '\0';
+}
+
+/*
+ * load_config() - Read "key value" lines into cfg
+ * RETURNS: 0, or -1 after printing the offending line
+ */
+static int load_config(const char *path, struct agent_config *cfg) {
+	FILE *in = fopen(path, "r");
+	if (!in) {
+		fprintf(stderr, "[ERROR] Cannot open %s: %s\n", path, strerror(errno));
+		return -1;
+	}
+	char line[512];
+	int lineno = 0, rc = 0;
+	while (rc == 0 && fgets(line, sizeof(line), in)) {
+		char key[32], value[300];
+		lineno++;
+		char *hash = strchr(line, '#');
+		if (hash) {
+			*hash = '\0';
+		}
+		int n = sscanf(line, "%31s %299s", key, value);
+		if (n <= 0) {
+			continue;
+		}
+		if (n != 2) {
+			rc = -1;
+		} else if (strcmp(key, "collector") == 0) {
+			copy_str(cfg->collector, sizeof(cfg->collector), value);
+		} else if (strcmp(key, "node") == 0) {
+			copy_str(cfg->node, sizeof(cfg->node), value);
+		} else if (strcmp(key, "key") == 0) {
+			copy_str(cfg->key, sizeof(cfg->key), value);
+		} else if (strcmp(key, "ring") == 0) {
+			copy_str(cfg->ring, sizeof(cfg->ring), value);
+		} else if (strcmp(key, "plan") == 0) {
+			copy_str(cfg->plan, sizeof(cfg->plan), value);
+		} else if (strcmp(key, "hwmon") == 0) {
+			copy_str(cfg->hwmon, sizeof(cfg->hwmon), value);
+		} else if (strcmp(key, "rollups") == 0) {
+			rc = parse_rollups(cfg->rollup_level, value);
+		} else if (strcmp(key, "batch") == 0) {
+			cfg->batch_s = atoi(value);
+			rc = cfg->batch_s >= 5 && cfg->batch_s <= 3600 ? 0 : -1;
+		} else {
+			rc = -1;
+		}
+	}
+	fclose(in);
+	if (rc < 0) {
+		fprintf(stderr, "[ERROR] %s:%d: expected collector|node|key|rollups|batch|ring|plan|hwmon VALUE\n", path, lineno);
+	}
+	return rc;
+}
+
+static uint64_t generation_load(void) {
+	unsigned long long g = 0;
+	FILE *in = fopen(GENERATION_PATH, "r");
+	if (in) {
+		if (fscanf(in, "%llu", &g) != 1) {
+			g = 0;
+		}
+		fclose(in);
+	}
+	return g;
+}
+
+/*
+ * write_atomic() - Replace PATH with data via PATH.tmp + fsync + rename
+ * WHY: A crash mid-write must leave either the old file or the new one;
+ *      max-fans-restore.service applies whatever sits at the plan path
+ * RETURNS: 0, or -1 (errno set)
+ */
+static int write_atomic(const char *path, const void *data, size_t len) {
+	char tmp[PATH_MAX];
+	snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+
+	char dir[PATH_MAX];
+	snprintf(dir, sizeof(dir), "%s", path);
+	char *slash = strrchr(dir, '/');
+	if (slash && slash != dir) {
+		*slash = '\0';
+		if (mkdir(dir, 0755) < 0 && errno != EEXIST) {
+			return -1;
+		}
+	}
+
+	int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		return -1;
+	}
+	if (write(fd, data, len) != (ssize_t)len || fsync(fd) < 0) {
+		int saved = errno ? errno : EIO;
+		close(fd);
+		unlink(tmp);
+		errno = saved;
+		return -1;
+	}
+	close(fd);
+	if (rename(tmp, path) < 0) {
+		int saved = errno;
+		unlink(tmp);
+		errno = saved;
+		return -1;
+	}
+	return 0;
+}
+
+static void generation_store(uint64_t g) {
+	char text[32];
+	int n = snprintf(text, sizeof(text), "%llu\n", (unsigned long long)g);
+	if (write_atomic(GENERATION_PATH, text, (size_t)n) < 0) {
+		fprintf(stderr, "[WARN] Cannot record profile generation in %s: %s\n", GENERATION_PATH, strerror(errno));
+	}
+}
+
+static void seal_batch(struct agent *a);
+
+/*
+ * add_record() - Append one record to the open batch
+ * HOW:  Seals the batch first if the record would overflow it
+ */
+static void add_record(struct agent *a, const void *rec, size_t size) {
+	if (a->raw_len + size > sizeof(a->buf)) {
+		seal_batch(a);
+	}
+	if (a->raw_len == 0) {
+		a->batch_start_ns = clock_ns(CLOCK_MONOTONIC);
+	}
+	memcpy((char *)a->buf + a->raw_len, rec, size);
+	a->raw_len += size;
+	a->nrecords++;
+}
+
+static void add_event(struct agent *a, enum nct_fleet_event_kind kind, int64_t value, const char *fmt, ...) {
+	struct nct_fleet_event ev = {
+		.rec = {.type = NCT_FLEET_REC_EVENT, .size = sizeof(ev)},
+		.t_ns = clock_ns(CLOCK_REALTIME),
+		.value = value,
+		.kind = (uint16_t)kind,
+		.channel = -1,
+	};
+	va_list ap;
+	va_start(ap, fmt);
+	vsnprintf(ev.text, sizeof(ev.text), fmt, ap);
+	va_end(ap);
+	add_record(a, &ev, sizeof(ev));
+}
+
+/*
+ * seal_batch() - Deflate the open batch into a queued BATCH payload
+ * HOW:  compress2() at the default level: rollup records are mostly
+ *       repeated small integers and shrink ~4x; the queue keeps the
+ *       compressed form, so an outage costs a quarter of the memory too
+ */
+static void seal_batch(struct agent *a) {
+	if (a->raw_len == 0) {
+		return;
+	}
+	uLongf zlen = compressBound((uLong)a->raw_len);
+	uint8_t *p = malloc(sizeof(struct nct_fleet_batch) + zlen);
+	if (!p || compress2(p + sizeof(struct nct_fleet_batch), &zlen, (const Bytef *)a->buf, (uLong)a->raw_len,
+			    Z_DEFAULT_COMPRESSION) != Z_OK) {
+		fprintf(stderr, "[WARN] Cannot compress batch of %u records; dropped\n", a->nrecords);
+		free(p);
+		a->raw_len = 0;
+		a->nrecords = 0;
+		return;
+	}
+	struct nct_fleet_batch hdr = {.seq = a->next_seq++, .raw_bytes = (uint32_t)a->raw_len, .nrecords = a->nrecords};
+	memcpy(p, &hdr, sizeof(hdr));
+	a->raw_len = 0;
+	a->nrecords = 0;
+
+	if (a->nqueued == QUEUE_MAX) {
+		free(a->queue[0].payload);
+		memmove(&a->queue[0], &a->queue[1], (QUEUE_MAX - 1) * sizeof(a->queue[0]));
+		a->nqueued--;
+		if (a->dropped++ == 0) {
+			fprintf(stderr, "[WARN] Batch queue full (%d); dropping the oldest until the collector is back\n",
+				QUEUE_MAX);
+		}
+	}
+	a->queue[a->nqueued++] = (struct queued){.seq = hdr.seq, .len = sizeof(hdr) + zlen, .payload = p};
+	/* reported once the collector can hear it, not once per lost batch */
+	if (a->dropped > 0 && a->fd >= 0) {
+		add_event(a, NCT_FLEET_EV_BATCHES_DROPPED, (int64_t)a->dropped, "queue full while disconnected");
+		a->dropped = 0;
+	}
+}
+
+/*
+ * ring_refresh() - Attach, re-attach after a sampler restart, track up/down
+ * RETURNS: true if the channel table may have changed (new mapping)
+ */
+static bool ring_refresh(struct agent *a) {
+	bool changed = false;
+	struct stat st;
+	if (stat(a->cfg.ring, &st) < 0) {
+		if (a->ring) {
+			nct_ring_detach(a->ring, a->ring_size);
+			a->ring = NULL;
+		}
+	} else if (!a->ring || st.st_ino != a->ring_ino) {
+		size_t size;
+		const struct nct_ring_header *ring = nct_ring_attach(a->cfg.ring, &size);
+		if (ring) {
+			if (a->ring) {
+				nct_ring_detach(a->ring, a->ring_size);
+			}
+			a->ring = ring;
+			a->ring_size = size;
+			a->ring_ino = st.st_ino;
+			changed = true;
+		}
+	}
+
+	bool up = a->ring && atomic_load_explicit(&a->ring->writer_pid, memory_order_acquire) != 0;
+	if (up != a->sampler_up) {
+		a->sampler_up = up;
+		if (up) {
+			add_event(a, NCT_FLEET_EV_SAMPLER_UP, a->ring->nchannels, "%u channels at %u Hz",
+				  a->ring->nchannels, a->ring->rate_hz);
+		} else {
+			add_event(a, NCT_FLEET_EV_SAMPLER_DOWN, 0, "%s", a->ring ? "writer exited" : "ring missing");
+		}
+	}
+	return changed;
+}
+
+/*
+ * harvest() - Copy every bucket closed since the last call into the batch
+ * HOW:  A bucket is identified by its start on CLOCK_MONOTONIC, which
+ *       (unlike bucket.number) survives a sampler restart, so
+ *       last_start[] alone says what was shipped. The newest closed bucket
+ *       bounds how far back to look; on the first pass only that one is
+ *       taken, not the ring's whole history
+ * RETURNS: records added
+ */
+static int harvest(struct agent *a) {
+	static struct nct_ring_rollup_bucket bucket;
+	static uint64_t rec_buf[(sizeof(struct nct_fleet_rollup) +
+				 NCT_FLEET_CHANNELS * sizeof(struct nct_fleet_agg)) / 8];
+	struct nct_fleet_rollup *ru = (struct nct_fleet_rollup *)rec_buf;
+	const struct nct_ring_rollups *r = a->ring ? nct_ring_rollups(a->ring, a->ring_size) : NULL;
+	int added = 0;
+
+	if (!r) {
+		return 0;
+	}
+	int64_t offset = clock_ns(CLOCK_REALTIME) - clock_ns(CLOCK_MONOTONIC);
+	uint32_t nch = a->ring->nchannels;
+
+	for (uint32_t l = 0; l < r->nlevels; ++l) {
+		const struct nct_ring_rollup_level *lv = &r->level[l];
+		if (!a->cfg.rollup_level[l] || nct_ring_read_rollup(a->ring, r, l, 1, &bucket) < 0 ||
+		    bucket.t_start_ns <= a->last_start[l]) {
+			continue;
+		}
+		uint64_t behind = a->last_start[l] ? (bucket.t_start_ns - a->last_start[l]) / lv->period_ns : 1;
+		uint32_t oldest = behind < lv->nbuckets - 1 ? (uint32_t)behind : lv->nbuckets - 1;
+
+		for (uint32_t age = oldest; age >= 1; --age) {
+			if (nct_ring_read_rollup(a->ring, r, l, age, &bucket) < 0 || bucket.t_start_ns <= a->last_start[l]) {
+				continue;
+			}
+			a->last_start[l] = bucket.t_start_ns;
+			*ru = (struct nct_fleet_rollup){
+				.rec = {.type = NCT_FLEET_REC_ROLLUP, .size = (uint16_t)nct_fleet_rollup_size(nch)},
+				.t_start_ns = (int64_t)bucket.t_start_ns + offset,
+				.period_s = (uint32_t)(lv->period_ns / 1000000000ull),
+				.nsamples = bucket.nsamples,
+				.nchannels = nch,
+			};
+			for (uint32_t i = 0; i < nch; ++i) {
+				const struct nct_ring_agg *g = &bucket.agg[i];
+				ru->agg[i] = g->count == 0
+					? (struct nct_fleet_agg){NCT_FLEET_INVALID, NCT_FLEET_INVALID, NCT_FLEET_INVALID, NCT_FLEET_INVALID}
+					: (struct nct_fleet_agg){g->min, g->max, (int32_t)(g->sum / g->count), g->last};
+			}
+			add_record(a, ru, ru->rec.size);
+			added++;
+		}
+	}
+	return added;
+}
+
+static const char *event_path(void) {
+	const char *p = getenv("NCT_AGENT_SOCKET");
+	return p && p[0] ? p : NCT_FLEET_EVENT_PATH;
+}
+
+static int event_addr(const char *path, struct sockaddr_un *addr) {
+	memset(addr, 0, sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(addr->sun_path)) {
+		errno = ENAMETOOLONG;
+		return -1;
+	}
+	memcpy(addr->sun_path, path, strlen(path) + 1);
+	return 0;
+}
+
+/*
+ * event_open() - Bind the local event socket (nct-fleet.h LOCAL EVENTS)
+ * WHY 0600: the agent runs as root, so only root (nct-alarm) can send;
+ *     a user cannot inject alarms into the fleet's record
+ * RETURNS: non-blocking socket, or -1 (errno set)
+ */
+static int event_open(const char *path) {
+	struct sockaddr_un addr;
+	if (event_addr(path, &addr) < 0) {
+		return -1;
+	}
+	unlink(path);
+
+	int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd < 0 || bind(fd, (const struct sockaddr *)&addr, sizeof(addr)) < 0 || chmod(path, 0600) < 0) {
+		int saved = errno;
+		if (fd >= 0) {
+			close(fd);
+		}
+		errno = saved;
+		return -1;
+	}
+	return fd;
+}
+
+/*
+ * ring_channel() - Ring (and HELLO) index of the channel an event names
+ * HOW:  text starts with "temp1"; the ring calls it "temp1_input"
+ * RETURNS: index, or -1 if the ring has no such channel
+ */
+static int ring_channel(const struct agent *a, const char *text) {
+	size_t len = strcspn(text, " ");
+	for (uint32_t i = 0; a->ring && len > 0 && i < a->ring->nchannels; ++i) {
+		const char *name = a->ring->channels[i].name;
+		if (strncmp(name, text, len) == 0 && (name[len] == '_' || name[len] == '\0')) {
+			return (int)i;
+		}
+	}
+	return -1;
+}
+
+/*
+ * event_drain() - Move every pending local event into the open batch
+ * HOW:  Only whole alarm records are taken; the agent, not the sender,
+ *       fills the record header and the channel index
+ */
+static void event_drain(struct agent *a) {
+	struct nct_fleet_event ev;
+	ssize_t n;
+	while ((n = recv(a->event_fd, &ev, sizeof(ev), MSG_DONTWAIT | MSG_TRUNC)) >= 0) {
+		if (n != (ssize_t)sizeof(ev) || (ev.kind != NCT_FLEET_EV_ALARM_RAISED && ev.kind != NCT_FLEET_EV_ALARM_CLEARED)) {
+			fprintf(stderr, "[WARN] Ignoring malformed local event (%zd bytes)\n", n);
+			continue;
+		}
+		ev.rec = (struct nct_fleet_rec){.type = NCT_FLEET_REC_EVENT, .size = sizeof(ev)};
+		ev.text[sizeof(ev.text) - 1] = '\0';
+		ev.channel = (int16_t)ring_channel(a, ev.text);
+		ev.reserved = 0;
+		add_record(a, &ev, sizeof(ev));
+	}
+}
+
+/*
+ * alarm_event() - --alarm-event: hand one nct-alarm transition to the agent
+ * WHY exit 0 without an agent: the hook runs on every node, the agent only
+ *     where a collector is configured
+ * RETURNS: exit status
+ */
+static int alarm_event(void) {
+	const char *name = getenv("NCT_ALARM"), *state = getenv("NCT_ALARM_STATE");
+	const char *label = getenv("NCT_ALARM_LABEL"), *value = getenv("NCT_ALARM_VALUE");
+	if (!name || !*name || !state || (strcmp(state, "raised") != 0 && strcmp(state, "cleared") != 0)) {
+		fprintf(stderr, "[ERROR] --alarm-event is an nct-alarm --exec hook (NCT_ALARM, NCT_ALARM_STATE unset)\n");
+		return 2;
+	}
+
+	struct nct_fleet_event ev = {
+		.rec = {.type = NCT_FLEET_REC_EVENT, .size = sizeof(ev)},
+		.t_ns = clock_ns(CLOCK_REALTIME),
+		.value = value && *value ? strtoll(value, NULL, 10) : 0,
+		.kind = strcmp(state, "raised") == 0 ? NCT_FLEET_EV_ALARM_RAISED : NCT_FLEET_EV_ALARM_CLEARED,
+		.channel = -1,
+	};
+	if (label && *label) {
+		snprintf(ev.text, sizeof(ev.text), "%s (%s)", name, label);
+	} else {
+		snprintf(ev.text, sizeof(ev.text), "%s", name);
+	}
+
+	const char *path = event_path();
+	struct sockaddr_un addr;
+	int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	if (fd < 0 || event_addr(path, &addr) < 0) {
+		fprintf(stderr, "[ERROR] Cannot reach nct-agent at %s: %s\n", path, strerror(errno));
+		if (fd >= 0) {
+			close(fd);
+		}
+		return 2;
+	}
+	int rc = 0;
+	if (sendto(fd, &ev, sizeof(ev), 0, (const struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		if (errno == ENOENT || errno == ECONNREFUSED) {
+			fprintf(stderr, "[INFO] No nct-agent listening on %s; alarm not forwarded\n", path);
+		} else {
+			fprintf(stderr, "[ERROR] Cannot send to nct-agent at %s: %s\n", path, strerror(errno));
+			rc = 2;
+		}
+	}
+	close(fd);
+	return rc;
+}
+
+static void hello_fill(const struct agent *a, struct nct_fleet_hello *h) {
+	memset(h, 0, sizeof(*h));
+	h->version = NCT_FLEET_VERSION;
+	h->generation = a->generation;
+	snprintf(h->node, sizeof(h->node), "%s", a->cfg.node);
+	if (a->ring) {
+		h->nchannels = a->ring->nchannels;
+		h->rate_hz = a->ring->rate_hz;
+		for (uint32_t i = 0; i < h->nchannels; ++i) {
+			const struct nct_ring_channel *c = &a->ring->channels[i];
+			memcpy(h->channels[i].name, c->name, sizeof(h->channels[i].name));
+			memcpy(h->channels[i].label, c->label, sizeof(h->channels[i].label));
+			h->channels[i].kind = c->kind;
+			h->channels[i].index = c->index;
+		}
+	}
+}
+
+static int send_hello(struct agent *a) {
+	static struct nct_fleet_hello h;
+	hello_fill(a, &h);
+	return send_frame(a->fd, NCT_FLEET_HELLO, &h, sizeof(h), NULL, 0);
+}
+
+/*
+ * retry_later() - Schedule the next connect: backoff plus up to 1 s jitter
+ */
+static void retry_later(struct agent *a, const char *why) {
+	fprintf(stderr, "[WARN] Collector %s: %s; retrying in %d s\n", a->cfg.collector, why, a->backoff_s);
+	a->next_connect_ns = clock_ns(CLOCK_MONOTONIC) + (int64_t)a->backoff_s * 1000000000 +
+			     (int64_t)(rand() % 1000) * 1000000;
+	a->backoff_s = a->backoff_s * 2 > BACKOFF_MAX_S ? BACKOFF_MAX_S : a->backoff_s * 2;
+}
+
+static void conn_drop(struct agent *a, const char *why) {
+	close(a->fd);
+	a->fd = -1;
+	a->rx.len = 0;
+	retry_later(a, why);
+}
+
+/*
+ * conn_open() - Resolve the collector and connect, bounded by CONNECT_WAIT_MS
+ * RETURNS: connected socket (blocking, tuned), or -1 with *why set
+ */
+static int conn_open(const char *spec, const char **why) {
+	char host[256];
+	const char *port = NCT_FLEET_PORT;
+	snprintf(host, sizeof(host), "%s", spec);
+	char *colon = strrchr(host, ':');
+	if (host[0] == '[') {                   /* [v6addr]:port */
+		char *close_br = strchr(host, ']');
+		if (close_br) {
+			*close_br = '\0';
+			memmove(host, host + 1, strlen(host));
+			colon = close_br[1] == ':' ? close_br : NULL;
+			if (colon) {
+				port = spec + (colon - host) + 2;
+			}
+		}
+	} else if (colon && !strchr(colon + 1, ':')) {
+		*colon = '\0';
+		port = colon + 1;
+	}
+
+	struct addrinfo hints = {.ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM}, *res;
+	if (getaddrinfo(host, port, &hints, &res) != 0) {
+		*why = "cannot resolve";
+		return -1;
+	}
+	int fd = -1;
+	*why = "connection failed";
+	for (struct addrinfo *ai = res; ai && fd < 0; ai = ai->ai_next) {
+		fd = socket(ai->ai_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+		if (fd < 0) {
+			continue;
+		}
+		int err = 0;
+		socklen_t elen = sizeof(err);
+		if (connect(fd, ai->ai_addr, ai->ai_addrlen) < 0) {
+			struct pollfd pfd = {.fd = fd, .events = POLLOUT};
+			if (errno != EINPROGRESS || poll(&pfd, 1, CONNECT_WAIT_MS) != 1 ||
+			    getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &elen) < 0 || err != 0) {
+				*why = err ? strerror(err) : "connect timed out";
+				close(fd);
+				fd = -1;
+			}
+		}
+	}
+	freeaddrinfo(res);
+	if (fd >= 0) {
+		fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+		socket_tune(fd);
+	}
+	return fd;
+}
+
+/*
+ * pump_queue() - Send every queued batch not yet written on this connection
+ * RETURNS: 0, or -1 if the connection failed (dropped)
+ */
+static int pump_queue(struct agent *a) {
+	for (int i = 0; i < a->nqueued && a->fd >= 0; ++i) {
+		struct queued *q = &a->queue[i];
+		if (q->seq <= a->sent_seq) {
+			continue;
+		}
+		if (send_frame(a->fd, NCT_FLEET_BATCH, q->payload, q->len, NULL, 0) < 0) {
+			conn_drop(a, strerror(errno));
+			return -1;
+		}
+		a->sent_seq = q->seq;
+	}
+	return 0;
+}
+
+static void queue_ack(struct agent *a, uint64_t seq) {
+	int n = 0;
+	while (n < a->nqueued && a->queue[n].seq <= seq) {
+		free(a->queue[n++].payload);
+	}
+	memmove(&a->queue[0], &a->queue[n], (size_t)(a->nqueued - n) * sizeof(a->queue[0]));
+	a->nqueued -= n;
+}
+
+/*
+ * nct_fan_path() - nct-fan installed next to this binary (/usr/lib/eirikr)
+ */
+static void nct_fan_path(char *out, size_t len) {
+	char self[PATH_MAX - 16];
+	ssize_t n = readlink("/proc/self/exe", self, sizeof(self) - 1);
+	if (n > 0) {
+		self[n] = '\0';
+		char *slash = strrchr(self, '/');
+		if (slash) {
+			*slash = '\0';
+			snprintf(out, len, "%s/nct-fan", self);
+			return;
+		}
+	}
+	snprintf(out, len, "/usr/lib/eirikr/nct-fan");
+}
+
+/*
+ * run_reconcile() - fork + exec `nct-fan --reconcile PLAN HWMON`
+ * WHY exec, not a library call: nct-fan is the one applier every path
+ *     uses (max-fans-advanced.sh, the sleep hook, the restore service);
+ *     its output goes to the agent's journal like theirs
+ * RETURNS: nct-fan's exit status (0 = every write succeeded), or 127
+ */
+static int run_reconcile(const char *plan, const char *hwmon) {
+	char fan[PATH_MAX];
+	nct_fan_path(fan, sizeof(fan));
+	pid_t pid = fork();
+	if (pid < 0) {
+		return 127;
+	}
+	if (pid == 0) {
+		execl(fan, "nct-fan", "--reconcile", plan, hwmon, (char *)NULL);
+		fprintf(stderr, "[ERROR] Cannot run %s: %s\n", fan, strerror(errno));
+		_exit(127);
+	}
+	int status;
+	while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+	}
+	return WIFEXITED(status) ? WEXITSTATUS(status) : 127;
+}
+
+static int verify_signature(EVP_PKEY *key, const struct nct_fleet_profile *p, const uint8_t *plan) {
+	size_t hlen = nct_fleet_signed_header();
+	uint8_t *msg = malloc(hlen + p->plan_bytes);
+	EVP_MD_CTX *ctx = EVP_MD_CTX_new();
+	int ok = 0;
+	if (msg && ctx) {
+		memcpy(msg, p, hlen);
+		memcpy(msg + hlen, plan, p->plan_bytes);
+		ok = EVP_DigestVerifyInit(ctx, NULL, NULL, NULL, key) == 1 &&
+		     EVP_DigestVerify(ctx, p->signature, sizeof(p->signature), msg, hlen + p->plan_bytes) == 1;
+	}
+	EVP_MD_CTX_free(ctx);
+	free(msg);
+	return ok;
+}
+
+/*
+ * plan_valid() - The bytes are exactly one undamaged compiled plan
+ */
+static bool plan_valid(const uint8_t *plan, size_t len) {
+	static struct nct_plan_entry entries[NCT_PLAN_MAX];
+	struct nct_plan_header hdr;
+	FILE *in = fmemopen((void *)plan, len, "r");
+	if (!in) {
+		return false;
+	}
+	int n = nct_plan_read(in, &hdr, entries, NCT_PLAN_MAX);
+	bool ok = n > 0 && ftell(in) == (long)len;
+	fclose(in);
+	return ok;
+}
+
+/*
+ * handle_profile() - Verify, install and apply one PROFILE frame
+ * OUT: res filled for the RESULT frame; status 1 = refused (no key, bad
+ *      signature, stale generation, damaged plan), 2 = not installed, or
+ *      installed (generation recorded) but nct-fan failed
+ */
+static void handle_profile(struct agent *a, const uint8_t *payload, size_t len, struct nct_fleet_result *res) {
+	const struct nct_fleet_profile *p = (const struct nct_fleet_profile *)payload;
+	const uint8_t *plan = payload + sizeof(*p);
+	memset(res, 0, sizeof(*res));
+	res->status = 1;
+
+	if (len < sizeof(*p) || memcmp(p->magic, NCT_FLEET_PROFILE_MAGIC, sizeof(p->magic)) != 0 ||
+	    p->plan_bytes != len - sizeof(*p)) {
+		snprintf(res->message, sizeof(res->message), "malformed profile frame");
+		return;
+	}
+	res->generation = p->generation;
+	if (!a->key) {
+		snprintf(res->message, sizeof(res->message), "no verification key configured");
+	} else if (p->generation <= a->generation) {
+		snprintf(res->message, sizeof(res->message), "generation %llu not newer than applied %llu",
+			 (unsigned long long)p->generation, (unsigned long long)a->generation);
+	} else if (!verify_signature(a->key, p, plan)) {
+		snprintf(res->message, sizeof(res->message), "bad signature");
+	} else if (!plan_valid(plan, p->plan_bytes)) {
+		snprintf(res->message, sizeof(res->message), "damaged or incompatible plan");
+	} else if (write_atomic(a->cfg.plan, plan, p->plan_bytes) < 0) {
+		snprintf(res->message, sizeof(res->message), "cannot install %.48s: %s", a->cfg.plan, strerror(errno));
+		res->status = 2;
+	} else {
+		/*
+		 * Installed is adopted: max-fans-restore.service now enforces
+		 * this plan, so HELLO must report its generation whatever the
+		 * reconcile below does, or the collector would push it forever
+		 */
+		a->generation = p->generation;
+		generation_store(a->generation);
+
+		char hwmon[HWMON_PATH_MAX];
+		struct hwmon_resolution hr;
+		snprintf(hwmon, sizeof(hwmon), "%s", a->cfg.hwmon);
+		if (!hwmon[0] && hwmon_resolve(&hr, 0) == 0) {
+			snprintf(hwmon, sizeof(hwmon), "%s", hr.hwmon);
+		}
+		int rc = hwmon[0] ? run_reconcile(a->cfg.plan, hwmon) : 127;
+		if (rc == 0) {
+			res->status = 0;
+			snprintf(res->message, sizeof(res->message), "applied through %.72s", hwmon);
+		} else {
+			res->status = 2;
+			snprintf(res->message, sizeof(res->message), hwmon[0] ? "installed; nct-fan --reconcile exited %d"
+				 : "installed; no NCT67xx hwmon device", rc);
+		}
+	}
+
+	if (res->status == 0) {
+		fprintf(stderr, "[INFO] Profile generation %llu %s\n", (unsigned long long)res->generation, res->message);
+		add_event(a, NCT_FLEET_EV_PROFILE_APPLIED, (int64_t)res->generation, "%s", res->message);
+	} else {
+		fprintf(stderr, "[WARN] Profile generation %llu refused: %s\n", (unsigned long long)res->generation,
+			res->message);
+		add_event(a, NCT_FLEET_EV_PROFILE_FAILED, (int64_t)res->generation, "%s", res->message);
+	}
+}
+
+/*
+ * conn_read() - Handle every complete frame the collector has sent
+ */
+static void conn_read(struct agent *a) {
+	int rc;
+	while ((rc = rx_pull(a->fd, &a->rx)) == 1) {
+		const struct nct_fleet_frame *f = (const struct nct_fleet_frame *)a->rx.data;
+		const uint8_t *payload = a->rx.data + sizeof(*f);
+		if (f->type == NCT_FLEET_ACK && f->length == sizeof(struct nct_fleet_ack)) {
+			struct nct_fleet_ack ack;
+			memcpy(&ack, payload, sizeof(ack));
+			queue_ack(a, ack.seq);
+			a->backoff_s = 1;                 /* the collector is really taking data */
+		} else if (f->type == NCT_FLEET_PROFILE) {
+			struct nct_fleet_result res;
+			handle_profile(a, payload, f->length, &res);
+			if (send_frame(a->fd, NCT_FLEET_RESULT, &res, sizeof(res), NULL, 0) < 0) {
+				conn_drop(a, strerror(errno));
+				return;
+			}
+		} else {
+			conn_drop(a, "unexpected frame");
+			return;
+		}
+		a->rx.len = 0;
+	}
+	if (rc < 0) {
+		conn_drop(a, errno == EPROTO ? "protocol error" : errno == ECONNRESET ? "closed" : strerror(errno));
+	}
+}
+
+static int agent_once(struct agent *a) {
+	ring_refresh(a);
+	a->raw_len = 0;                         /* --once shows rollups, not attach events */
+	a->nrecords = 0;
+	if (!a->ring || harvest(a) == 0) {
+		fprintf(stderr, "[ERROR] No closed rollup bucket in %s yet\n", a->cfg.ring);
+		return 1;
+	}
+	static struct nct_fleet_hello h;
+	hello_fill(a, &h);
+	print_records(stdout, h.node, h.channels, h.nchannels, a->buf, a->raw_len);
+	return 0;
+}
+
+static int agent_run(struct agent *a) {
+	fprintf(stderr, "[INFO] Agent %s -> %s, %ds batches, profile generation %llu%s\n", a->cfg.node,
+		a->cfg.collector, a->cfg.batch_s, (unsigned long long)a->generation,
+		a->key ? "" : " (no key: profiles refused)");
+
+	a->event_fd = event_open(event_path());
+	if (a->event_fd < 0) {
+		fprintf(stderr, "[WARN] Cannot bind %s: %s; alarm events will not be forwarded\n", event_path(),
+			strerror(errno));
+	}
+
+	int64_t next_tick = clock_ns(CLOCK_MONOTONIC);
+	while (!stop_requested) {
+		int64_t now = clock_ns(CLOCK_MONOTONIC);
+		if (now >= next_tick) {
+			next_tick = now + TICK_NS;
+			bool changed = ring_refresh(a);
+			harvest(a);
+			if (a->raw_len > 0 && now - a->batch_start_ns >= (int64_t)a->cfg.batch_s * 1000000000) {
+				seal_batch(a);
+			}
+			if (a->fd < 0 && now >= a->next_connect_ns) {
+				const char *why;
+				a->fd = conn_open(a->cfg.collector, &why);
+				if (a->fd < 0) {
+					retry_later(a, why);
+				} else {
+					fprintf(stderr, "[INFO] Connected to %s (%d batches queued)\n", a->cfg.collector,
+						a->nqueued);
+					a->sent_seq = 0;
+					if (send_hello(a) < 0) {
+						conn_drop(a, strerror(errno));
+					}
+				}
+			} else if (a->fd >= 0 && changed && send_hello(a) < 0) {
+				conn_drop(a, strerror(errno));
+			}
+			if (a->fd >= 0) {
+				pump_queue(a);
+			}
+		}
+
+		/* a negative fd is ignored by poll(2), so either may be absent */
+		struct pollfd pfd[2] = {{.fd = a->fd, .events = POLLIN}, {.fd = a->event_fd, .events = POLLIN}};
+		int wait_ms = (int)((next_tick - clock_ns(CLOCK_MONOTONIC)) / 1000000);
+		if (poll(pfd, 2, wait_ms > 0 ? wait_ms : 0) > 0) {
+			if (pfd[1].revents & POLLIN) {
+				event_drain(a);
+			}
+			if (pfd[0].revents) {
+				conn_read(a);
+			}
+		}
+	}
+	if (a->event_fd >= 0) {
+		close(a->event_fd);
+		unlink(event_path());
+	}
+
+	seal_batch(a);
+	if (a->fd >= 0) {
+		pump_queue(a);
+	}
+	fprintf(stderr, "[INFO] Agent stopped (%d batches unacknowledged)\n", a->nqueued);
+	return 0;
+}
+
+/* ============================================================================
+ * Signing (--sign)
+ * ============================================================================ */
+
+static int sign_plan(const char *plan_path, const char *key_path, uint64_t generation, const char *out_path) {
+	static uint8_t plan[sizeof(struct nct_plan_header) + NCT_PLAN_MAX * sizeof(struct nct_plan_entry) + 1];
+	FILE *in = fopen(plan_path, "rb");
+	if (!in) {
+		fprintf(stderr, "[ERROR] Cannot open %s: %s\n", plan_path, strerror(errno));
+		return 2;
+	}
+	size_t len = fread(plan, 1, sizeof(plan), in);
+	fclose(in);
+	if (!plan_valid(plan, len)) {
+		fprintf(stderr, "[ERROR] %s is not a compiled plan (build it with nct-profile --compile)\n", plan_path);
+		return 2;
+	}
+
+	FILE *kf = fopen(key_path, "r");
+	EVP_PKEY *key = kf ? PEM_read_PrivateKey(kf, NULL, NULL, NULL) : NULL;
+	if (kf) {
+		fclose(kf);
+	}
+	if (!key || EVP_PKEY_id(key) != EVP_PKEY_ED25519) {
+		fprintf(stderr, "[ERROR] %s is not an Ed25519 private key (openssl genpkey -algorithm ed25519)\n", key_path);
+		EVP_PKEY_free(key);
+		return 2;
+	}
+
+	static uint8_t msg[sizeof(struct nct_fleet_profile) + sizeof(plan)];
+	struct nct_fleet_profile p = {.generation = generation, .plan_bytes = (uint32_t)len};
+	memcpy(p.magic, NCT_FLEET_PROFILE_MAGIC, sizeof(p.magic));
+	size_t hlen = nct_fleet_signed_header(), siglen = sizeof(p.signature);
+	memcpy(msg, &p, hlen);
+	memcpy(msg + hlen, plan, len);
+
+	EVP_MD_CTX *ctx = EVP_MD_CTX_new();
+	bool ok = ctx && EVP_DigestSignInit(ctx, NULL, NULL, NULL, key) == 1 &&
+		  EVP_DigestSign(ctx, p.signature, &siglen, msg, hlen + len) == 1;
+	EVP_MD_CTX_free(ctx);
+	EVP_PKEY_free(key);
+	if (!ok) {
+		fprintf(stderr, "[ERROR] Signing failed\n");
+		return 2;
+	}
+
+	memcpy(msg, &p, sizeof(p));
+	memcpy(msg + sizeof(p), plan, len);
+	if (write_atomic(out_path, msg, sizeof(p) + len) < 0) {
+		fprintf(stderr, "[ERROR] Cannot write %s: %s\n", out_path, strerror(errno));
+		return 2;
+	}
+	fprintf(stderr, "[INFO] Signed %s as generation %llu -> %s\n", plan_path, (unsigned long long)generation,
+		out_path);
+	return 0;
+}
+
+/* ============================================================================
+ * Collector (--serve)
+ * ============================================================================ */
+
+struct client {
+	int fd;
+	bool hello;
+	uint64_t generation;            /* as reported, or as last applied */
+	uint64_t pushed;                /* generation sent on this connection */
+	struct rxbuf rx;
+	struct nct_fleet_hello info;
+};
+
+struct collector {
+	const char *profile_path;
+	uint8_t *profile;               /* whole signed file, NULL = none */
+	size_t profile_len;
+	uint64_t profile_gen;
+	ino_t profile_ino;
+	int64_t profile_mtime_ns;
+	FILE *out;
+	struct client *client[MAX_CLIENTS];
+	int nclients;
+	uint8_t raw[NCT_FLEET_RAW_MAX];
+};
+
+/*
+ * profile_reload() - Re-read --profile when its inode or mtime changed
+ * HOW:  Only framing is checked here; the nodes verify the signature
+ */
+static void profile_reload(struct collector *c) {
+	struct stat st;
+	if (!c->profile_path || stat(c->profile_path, &st) < 0) {
+		return;
+	}
+	int64_t mtime = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+	if (c->profile && st.st_ino == c->profile_ino && mtime == c->profile_mtime_ns) {
+		return;
+	}
+	c->profile_ino = st.st_ino;
+	c->profile_mtime_ns = mtime;
+
+	uint8_t *buf = st.st_size > 0 && (size_t)st.st_size <= NCT_FLEET_FRAME_MAX ? malloc((size_t)st.st_size) : NULL;
+	FILE *in = buf ? fopen(c->profile_path, "rb") : NULL;
+	size_t len = in ? fread(buf, 1, (size_t)st.st_size, in) : 0;
+	if (in) {
+		fclose(in);
+	}
+	const struct nct_fleet_profile *p = (const struct nct_fleet_profile *)buf;
+	if (!buf || len != (size_t)st.st_size || len < sizeof(*p) ||
+	    memcmp(p->magic, NCT_FLEET_PROFILE_MAGIC, sizeof(p->magic)) != 0 || p->plan_bytes != len - sizeof(*p)) {
+		fprintf(stderr, "[WARN] %s is not a signed profile (nct-agent --sign); keeping the previous one\n",
+			c->profile_path);
+		free(buf);
+		return;
+	}
+	free(c->profile);
+	c->profile = buf;
+	c->profile_len = len;
+	c->profile_gen = p->generation;
+	fprintf(stderr, "[INFO] Serving profile generation %llu (%zu bytes)\n", (unsigned long long)c->profile_gen, len);
+}
+
+static int client_drop(struct collector *c, int i, const char *why) {
+	struct client *cl = c->client[i];
+	fprintf(stderr, "[INFO] Node %s disconnected: %s\n", cl->hello ? cl->info.node : "(no hello)", why);
+	close(cl->fd);
+	free(cl->rx.data);
+	free(cl);
+	c->client[i] = c->client[--c->nclients];
+	return -1;
+}
+
+static int client_push(struct collector *c, struct client *cl) {
+	if (!cl->hello || !c->profile || cl->generation >= c->profile_gen || cl->pushed == c->profile_gen) {
+		return 0;
+	}
+	cl->pushed = c->profile_gen;
+	fprintf(stderr, "[INFO] Pushing profile generation %llu to %s (has %llu)\n", (unsigned long long)c->profile_gen,
+		cl->info.node, (unsigned long long)cl->generation);
+	return send_frame(cl->fd, NCT_FLEET_PROFILE, c->profile, c->profile_len, NULL, 0);
+}
+
+/*
+ * client_frame() - Handle one complete frame from node i
+ * RETURNS: 0, or -1 after dropping the node
+ */
+static int client_frame(struct collector *c, int i) {
+	struct client *cl = c->client[i];
+	const struct nct_fleet_frame *f = (const struct nct_fleet_frame *)cl->rx.data;
+	const uint8_t *payload = cl->rx.data + sizeof(*f);
+
+	switch (f->type) {
+	case NCT_FLEET_HELLO:
+		if (f->length != sizeof(cl->info)) {
+			return client_drop(c, i, "bad hello");
+		}
+		memcpy(&cl->info, payload, sizeof(cl->info));
+		cl->info.node[sizeof(cl->info.node) - 1] = '\0';
+		if (cl->info.version != NCT_FLEET_VERSION || cl->info.nchannels > NCT_FLEET_CHANNELS) {
+			return client_drop(c, i, "unsupported version");
+		}
+		for (uint32_t k = 0; k < cl->info.nchannels; ++k) {
+			cl->info.channels[k].name[NCT_FLEET_NAME_MAX - 1] = '\0';
+			cl->info.channels[k].label[NCT_FLEET_NAME_MAX - 1] = '\0';
+		}
+		if (!cl->hello) {
+			fprintf(stderr, "[INFO] Node %s connected: %u channels, profile generation %llu\n", cl->info.node,
+				cl->info.nchannels, (unsigned long long)cl->info.generation);
+		}
+		cl->hello = true;
+		cl->generation = cl->info.generation;
+		break;
+	case NCT_FLEET_BATCH: {
+		struct nct_fleet_batch b;
+		uLongf rlen = sizeof(c->raw);
+		if (!cl->hello || f->length < sizeof(b)) {
+			return client_drop(c, i, "batch before hello");
+		}
+		memcpy(&b, payload, sizeof(b));
+		if (b.raw_bytes > sizeof(c->raw) ||
+		    uncompress(c->raw, &rlen, payload + sizeof(b), f->length - sizeof(b)) != Z_OK || rlen != b.raw_bytes ||
+		    print_records(c->out, cl->info.node, cl->info.channels, cl->info.nchannels, c->raw, rlen) < 0) {
+			return client_drop(c, i, "corrupt batch");
+		}
+		/* ACK only what is on its way to storage */
+		fflush(c->out);
+		struct nct_fleet_ack ack = {.seq = b.seq};
+		if (send_frame(cl->fd, NCT_FLEET_ACK, &ack, sizeof(ack), NULL, 0) < 0) {
+			return client_drop(c, i, strerror(errno));
+		}
+		break;
+	}
+	case NCT_FLEET_RESULT: {
+		struct nct_fleet_result r;
+		if (f->length != sizeof(r)) {
+			return client_drop(c, i, "bad result");
+		}
+		memcpy(&r, payload, sizeof(r));
+		r.message[sizeof(r.message) - 1] = '\0';
+		fprintf(stderr, r.status == 0 ? "[INFO] Node %s: generation %llu %s\n"
+			: "[WARN] Node %s: generation %llu refused: %s\n",
+			cl->info.node, (unsigned long long)r.generation, r.message);
+		if (r.status == 0) {
+			cl->generation = r.generation;
+		}
+		break;
+	}
+	default:
+		return client_drop(c, i, "unexpected frame");
+	}
+	cl->rx.len = 0;
+	return 0;
+}
+
+static int listen_open(const char *spec) {
+	char host[64];
+	const char *colon = strrchr(spec, ':');
+	if (!colon || (size_t)(colon - spec) >= sizeof(host)) {
+		errno = EINVAL;
+		return -1;
+	}
+	memcpy(host, spec, (size_t)(colon - spec));
+	host[colon - spec] = '\0';
+
+	struct sockaddr_in sa = {.sin_family = AF_INET, .sin_port = htons((uint16_t)atoi(colon + 1))};
+	if (inet_pton(AF_INET, host, &sa.sin_addr) != 1) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		return -1;
+	}
+	int one = 1;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	if (bind(fd, (struct sockaddr *)&sa, sizeof(sa)) < 0 || listen(fd, 256) < 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+static int serve(const char *listen_spec, const char *profile_path, const char *out_path) {
+	static struct collector c;
+	static struct pollfd pfd[MAX_CLIENTS + 1];
+	c.profile_path = profile_path;
+	c.out = stdout;
+	if (out_path && !(c.out = fopen(out_path, "a"))) {
+		fprintf(stderr, "[ERROR] Cannot open %s: %s\n", out_path, strerror(errno));
+		return 2;
+	}
+	profile_reload(&c);
+	if (profile_path && !c.profile) {
+		fprintf(stderr, "[ERROR] No usable signed profile at %s\n", profile_path);
+		return 2;
+	}
+
+	int lfd = listen_open(listen_spec);
+	if (lfd < 0) {
+		fprintf(stderr, "[ERROR] Cannot listen on %s: %s\n", listen_spec, strerror(errno));
+		return 2;
+	}
+	fprintf(stderr, "[INFO] Collector listening on %s\n", listen_spec);
+
+	while (!stop_requested) {
+		pfd[0] = (struct pollfd){.fd = lfd, .events = POLLIN};
+		for (int i = 0; i < c.nclients; ++i) {
+			pfd[i + 1] = (struct pollfd){.fd = c.client[i]->fd, .events = POLLIN};
+		}
+		int n = poll(pfd, (nfds_t)c.nclients + 1, 1000);
+		if (n < 0 && errno != EINTR) {
+			fprintf(stderr, "[ERROR] poll: %s\n", strerror(errno));
+			break;
+		}
+
+		/* Walk backwards: client_drop() moves the last client into slot i */
+		for (int i = c.nclients - 1; n > 0 && i >= 0; --i) {
+			if (!(pfd[i + 1].revents & (POLLIN | POLLHUP | POLLERR))) {
+				continue;
+			}
+			int rc;
+			while ((rc = rx_pull(c.client[i]->fd, &c.client[i]->rx)) == 1 && client_frame(&c, i) == 0) {
+			}
+			if (rc < 0) {
+				client_drop(&c, i, errno == EPROTO ? "protocol error" : errno == ECONNRESET ? "closed"
+					    : strerror(errno));
+			}
+		}
+
+		if (n > 0 && (pfd[0].revents & POLLIN)) {
+			int cfd = accept4(lfd, NULL, NULL, SOCK_CLOEXEC);
+			if (cfd >= 0 && c.nclients == MAX_CLIENTS) {
+				fprintf(stderr, "[WARN] %d nodes connected; refusing another\n", MAX_CLIENTS);
+				close(cfd);
+			} else if (cfd >= 0) {
+				struct client *cl = calloc(1, sizeof(*cl));
+				if (!cl) {
+					close(cfd);
+				} else {
+					socket_tune(cfd);
+					cl->fd = cfd;
+					c.client[c.nclients++] = cl;
+				}
+			}
+		}
+
+		profile_reload(&c);
+		for (int i = c.nclients - 1; i >= 0; --i) {
+			if (client_push(&c, c.client[i]) < 0) {
+				client_drop(&c, i, strerror(errno));
+			}
+		}
+	}
+
+	close(lfd);
+	for (int i = c.nclients - 1; i >= 0; --i) {
+		client_drop(&c, i, "collector stopping");
+	}
+	if (c.out != stdout) {
+		fclose(c.out);
+	}
+	return 0;
+}
+
+static void usage(const char *prog) {
+	fprintf(stderr,
+		"Usage: %s [--config FILE] [--collector HOST[:PORT]] [--node NAME] [--once]\n"
+		"       %s --serve [--listen ADDR:PORT] [--profile FILE] [--out FILE]\n"
+		"       %s --sign PLAN --key PRIVATE.pem [--generation N] [-o OUT]\n"
+		"       %s --alarm-event\n"
+		"  --config FILE       Agent config (default %s)\n"
+		"  --collector ADDR    Override the config's collector\n"
+		"  --node NAME         Override the reported node name\n"
+		"  --once              Print the current rollups as collector JSON and exit\n"
+		"  --serve             Run the fleet collector\n"
+		"  --listen ADDR:PORT  Collector listen address (default %s)\n"
+		"  --profile FILE      Signed profile to push to nodes\n"
+		"  --out FILE          Append collected JSON lines (default stdout)\n"
+		"  --sign PLAN         Sign a compiled plan for distribution\n"
+		"  --key FILE          Ed25519 private key (PEM) for --sign\n"
+		"  --generation N      Profile generation (default: current Unix time)\n"
+		"  --alarm-event       nct-alarm --exec hook: forward NCT_ALARM* to the agent\n",
+		prog, prog, prog, prog, DEFAULT_CONFIG, DEFAULT_LISTEN);
+}
+
+int main(int argc, char *argv[]) {
+	static const struct option longopts[] = {
+		{"config", required_argument, NULL, 'c'},
+		{"collector", required_argument, NULL, 'C'},
+		{"node", required_argument, NULL, 'n'},
+		{"once", no_argument, NULL, '1'},
+		{"serve", no_argument, NULL, 's'},
+		{"listen", required_argument, NULL, 'l'},
+		{"profile", required_argument, NULL, 'p'},
+		{"out", required_argument, NULL, 'O'},
+		{"sign", required_argument, NULL, 'S'},
+		{"key", required_argument, NULL, 'k'},
+		{"generation", required_argument, NULL, 'g'},
+		{"alarm-event", no_argument, NULL, 'A'},
+		{"help", no_argument, NULL, 'h'},
+		{NULL, 0, NULL, 0},
+	};
+
+	static struct agent a = {.fd = -1, .event_fd = -1, .backoff_s = 1};
+	const char *config = DEFAULT_CONFIG, *collector = NULL, *node = NULL;
+	const char *listen_spec = DEFAULT_LISTEN, *profile = NULL, *out = NULL;
+	const char *sign = NULL, *key = NULL;
+	uint64_t generation = (uint64_t)time(NULL);
+	bool once = false, serve_mode = false, alarm = false;
+
+	int opt;
+	while ((opt = getopt_long(argc, argv, "c:C:n:1sl:p:O:o:S:k:g:Ah", longopts, NULL)) != -1) {
+		switch (opt) {
+		case 'c':
+			config = optarg;
+			break;
+		case 'C':
+			collector = optarg;
+			break;
+		case 'n':
+			node = optarg;
+			break;
+		case '1':
+			once = true;
+			break;
+		case 's':
+			serve_mode = true;
+			break;
+		case 'l':
+			listen_spec = optarg;
+			break;
+		case 'p':
+			profile = optarg;
+			break;
+		case 'O':
+		case 'o':
+			out = optarg;
+			break;
+		case 'S':
+			sign = optarg;
+			break;
+		case 'k':
+			key = optarg;
+			break;
+		case 'g':
+			generation = strtoull(optarg, NULL, 10);
+			if (generation == 0) {
+				fprintf(stderr, "[ERROR] --generation must be a positive integer\n");
+				return 2;
+			}
+			break;
+		case 'A':
+			alarm = true;
+			break;
+		case 'h':
+			usage(argv[0]);
+			return 0;
+		default:
+			usage(argv[0]);
+			return 2;
+		}
+	}
+
+	struct sigaction sa = {.sa_handler = on_signal};
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+
+	if (alarm) {
+		return alarm_event();
+	}
+	if (sign) {
+		if (!key) {
+			fprintf(stderr, "[ERROR] --sign needs --key PRIVATE.pem\n");
+			return 2;
+		}
+		char def[PATH_MAX];
+		snprintf(def, sizeof(def), "%s.signed", sign);
+		return sign_plan(sign, key, generation, out ? out : def);
+	}
+	if (serve_mode) {
+		return serve(listen_spec, profile, out);
+	}
+
+	struct agent_config *cfg = &a.cfg;
+	snprintf(cfg->ring, sizeof(cfg->ring), "%s", NCT_RING_PATH);
+	snprintf(cfg->plan, sizeof(cfg->plan), "%s", NCT_PLAN_PATH);
+	cfg->batch_s = 60;
+	parse_rollups(cfg->rollup_level, "1m");
+	if (gethostname(cfg->node, sizeof(cfg->node) - 1) < 0) {
+		snprintf(cfg->node, sizeof(cfg->node), "unknown");
+	}
+	if ((access(config, R_OK) == 0 || !once) && load_config(config, cfg) < 0) {
+		return 2;
+	}
+	if (collector) {
+		snprintf(cfg->collector, sizeof(cfg->collector), "%s", collector);
+	}
+	if (node) {
+		snprintf(cfg->node, sizeof(cfg->node), "%s", node);
+	}
+	if (once) {
+		return agent_once(&a);
+	}
+	if (!cfg->collector[0]) {
+		fprintf(stderr, "[ERROR] No collector configured (collector HOST[:PORT] in %s)\n", config);
+		return 2;
+	}
+
+	if (cfg->key[0]) {
+		FILE *kf = fopen(cfg->key, "r");
+		a.key = kf ? PEM_read_PUBKEY(kf, NULL, NULL, NULL) : NULL;
+		if (kf) {
+			fclose(kf);
+		}
+		if (!a.key || EVP_PKEY_id(a.key) != EVP_PKEY_ED25519) {
+			fprintf(stderr, "[ERROR] %s is not an Ed25519 public key (PEM)\n", cfg->key);
+			return 2;
+		}
+	}
+	a.generation = generation_load();
+	/* batch numbers stay increasing across agent restarts */
+	a.next_seq = (uint64_t)clock_ns(CLOCK_REALTIME) / 1000;
+	srand((unsigned)(getpid() ^ time(NULL)));
+
+	int rc = agent_run(&a);
+	EVP_PKEY_free(a.key);
+	return rc;
+}
+
+/*
+ * BUILD & DEPLOYMENT NOTES:
+ *
+ * Compilation:
+ *   gcc -std=c23 -O2 -Wall -Wextra -Werror -o nct-agent nct-agent.c \
+ *       nct-hwmon.c nct-stats.c -lz -lcrypto
+ *
+ * Installation (in PKGBUILD):
+ *   install -Dm755 nct-agent "$pkgdir/usr/lib/eirikr/nct-agent"
+ *   nct-agent.service runs it once /usr/local/etc/nct-agent.conf exists
+ *
+ * Rolling out a profile:
+ *   nct-profile --compile fleet.conf -o fleet.plan
+ *   nct-agent --sign fleet.plan --key fleet-key.pem -o /srv/nct/fleet.signed
+ *   (the collector started with --profile /srv/nct/fleet.signed picks it
+ *   up within a second and pushes it to every older node)
+ */
@@ -0,0 +1,592 @@
+/*
+ * nct-alarm.c - On-chip limit programming and alarm watching for NCT67xx
+ *
+ * PURPOSE:
+ *   Program the chip's own min/max limits (tempN_max, tempN_max_hyst,
+ *   tempN_crit, inN_min, inN_max, fanN_min) from the compiled profile,
+ *   then block until the chip latches an alarm instead of re-reading and
+ *   comparing every value in a loop.
+ *
+ * WHY THIS EXISTS:
+ *   Over-temperature and undervoltage detection used to poll values and
+ *   compare them in userspace on every node. The NCT6798D already
+ *   compares every conversion against its limit registers and latches the
+ *   result in its alarm registers; nct6775 exposes them as *_alarm.
+ *   Waiting on those costs nothing while the box is healthy.
+ *
+ * HOW:
+ *   1. --plan PLAN: the plan's limit writes (nct-profile [tempN] / [inN]
+ *      sections, fanN min =) are read back and only differing ones are
+ *      rewritten, like nct-fan --reconcile
+ *   2. Every tempN_alarm / inN_alarm / fanN_alarm is opened once and read
+ *      once (a read arms sysfs_notify() for the next change)
+ *   3. poll() waits for POLLPRI/POLLERR on all of them at once: a driver
+ *      that calls sysfs_notify() on an alarm wakes it immediately. nct6775
+ *      has no interrupt line and never notifies, so poll()'s timeout is
+ *      the chip update cycle (--interval, default 1500 ms, the driver's
+ *      HZ + HZ/2 register cache lifetime): one pread() per alarm per
+ *      cycle, no value reads, no comparisons, no wakeups in between
+ *   4. A 0 -> 1 transition is reported as [WARN] with the value and the
+ *      limit it crossed, 1 -> 0 as [INFO]; --exec runs a command for both
+ *
+ * USAGE:
+ *   nct-alarm [--plan PLAN] [--hwmon DIR] [--interval MS] [--exec CMD]
+ *             [--once] [--verbose] [--stats]
+ *     --plan PLAN    program the plan's limit writes first (nct-profile
+ *                    --compile; other writes in the plan are ignored)
+ *     --hwmon DIR    NCT67xx hwmon directory (default: hwmon_resolve())
+ *     --interval MS  update-cycle re-read, 100-60000; 0 = sysfs_notify()
+ *                    only (drivers that notify; nct6775 does not)
+ *     --exec CMD     run `sh -c CMD` on every transition with NCT_ALARM
+ *                    (temp1), NCT_ALARM_STATE (raised|cleared),
+ *                    NCT_ALARM_LABEL and NCT_ALARM_VALUE (sysfs units)
+ *     --once         program limits, print active alarms and exit
+ *     --stats        print nct-stats.h latency histograms on exit
+ *
+ * EXIT STATUS:
+ *   0  stopped by SIGINT/SIGTERM; --once: no alarm active
+ *   1  --once: at least one alarm active
+ *   2  usage error, no device, no alarm attributes, unreadable plan, or a
+ *      failed limit write
+ *
+ * SAFETY / CAVEATS:
+ *   - Writes nothing but the plan's limit attributes; fan control is left
+ *     to nct-fan and nct-fanctl
+ *   - fanN_min reads back as the RPM of the chip's count register, which
+ *     may differ from the profile's value by a few RPM; such a limit is
+ *     rewritten on every start (harmless, same register value)
+ *   - Alarms already active at start are reported once as raised
+ */
+
+#define _GNU_SOURCE
+#include "nct-hwmon.h"
+#include "nct-plan.h"
+#include "nct-stats.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_ALARMS        64
+#define INTERVAL_DEFAULT  1500    /* nct6775 update cycle: HZ + HZ / 2 */
+#define INTERVAL_MIN      100
+#define INTERVAL_MAX      60000
+
+/*
+ * struct alarm - One latched alarm bit and what it guards
+ * state: last value read, -1 before the first read
+ */
+struct alarm {
+	char name[HWMON_ATTR_MAX];      /* channel, e.g. "temp1" */
+	char label[HWMON_ATTR_MAX];     /* tempN_label, "" if none */
+	enum hwmon_kind kind;           /* HWMON_TEMP, HWMON_FAN or HWMON_IN */
+	int index;
+	int fd;                         /* *_alarm, O_RDONLY */
+	int input_fd;                   /* *_input, -1 if absent */
+	int state;
+};
+
+static struct alarm alarms[MAX_ALARMS];
+static int nalarms;
+static int hwmon_fd = -1;
+static const char *exec_cmd;
+static bool verbose;
+static volatile sig_atomic_t stop_requested;
+
+static void on_signal(int sig) {
+	(void)sig;
+	stop_requested = 1;
+}
+
+static int64_t monotonic_ms(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/*
+ * limit_attr() - Is this plan write one of the chip's alarm limits?
+ * WHY: pwmN_max etc. end in _max too but are curve parameters, so the
+ *      channel prefix is checked as well
+ */
+static bool limit_attr(const char *name) {
+	static const char *const suffixes[] = {"_min", "_max", "_max_hyst", "_crit"};
+	unsigned idx;
+	int end = 0;
+	if (sscanf(name, "temp%u%n", &idx, &end) != 1 && sscanf(name, "in%u%n", &idx, &end) != 1 &&
+	    sscanf(name, "fan%u%n", &idx, &end) != 1) {
+		return false;
+	}
+	for (size_t i = 0; i < sizeof(suffixes) / sizeof(suffixes[0]); ++i) {
+		if (strcmp(name + end, suffixes[i]) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+ * program_limits() - Re-assert the plan's limit writes
+ * HOW:  Read each limit back through the hwmon dirfd and write it only if
+ *       it differs; the chip keeps limits across warm reboots but firmware
+ *       may reset them on S3 resume
+ * RETURNS: number of failed writes, or -1 if the plan is unreadable
+ */
+static int program_limits(const char *path) {
+	static struct nct_plan_entry entries[NCT_PLAN_MAX];
+	struct nct_plan_header hdr;
+
+	FILE *in = fopen(path, "re");
+	if (!in) {
+		fprintf(stderr, "[ERROR] Cannot open plan %s: %s\n", path, strerror(errno));
+		return -1;
+	}
+	int n = nct_plan_read(in, &hdr, entries, NCT_PLAN_MAX);
+	fclose(in);
+	if (n < 0) {
+		fprintf(stderr, "[ERROR] %s: damaged or incompatible plan (recompile with nct-profile --compile)\n", path);
+		return -1;
+	}
+
+	int checked = 0, written = 0, failures = 0;
+	for (int i = 0; i < n; ++i) {
+		const struct nct_plan_entry *e = &entries[i];
+		if (!limit_attr(e->name)) {
+			continue;
+		}
+		checked++;
+		int fd = openat(hwmon_fd, e->name, O_RDWR | O_CLOEXEC);
+		int32_t have;
+		if (fd >= 0 && hwmon_read_int(fd, &have) == 0 && have == strtol(e->value, NULL, 10)) {
+			close(fd);
+			continue;
+		}
+		char buf[NCT_PLAN_VALUE_MAX + 1];
+		int len = snprintf(buf, sizeof(buf), "%s\n", e->value);
+		uint64_t t = nct_stats_begin();
+		bool ok = fd >= 0 && pwrite(fd, buf, (size_t)len, 0) == len;
+		nct_stats_end(NCT_OP_SYSFS_WRITE, t);
+		if (ok) {
+			written++;
+			if (verbose) {
+				fprintf(stderr, "[INFO]   %s = %s\n", e->name, e->value);
+			}
+		} else {
+			fprintf(stderr, "[ERROR] Failed to set %s=%s (%s)\n", e->name, e->value, strerror(errno));
+			failures++;
+		}
+		if (fd >= 0) {
+			close(fd);
+		}
+	}
+	fprintf(stderr, "[INFO] Limits: %d in %s, %d written, %d failures\n", checked, path, written, failures);
+	return failures;
+}
+
+static int alarm_cmp(const void *a, const void *b) {
+	const struct alarm *x = a, *y = b;
+	if (x->kind != y->kind) {
+		return (int)x->kind - (int)y->kind;
+	}
+	return x->index - y->index;
+}
+
+/*
+ * open_alarms() - Find and open every tempN/inN/fanN_alarm
+ * HOW:  One readdir pass over the hwmon dirfd; sorted like
+ *       hwmon_scan_channels() so reports come out in a stable order
+ * RETURNS: number of alarms, or -1 (errno set) if the directory is unlistable
+ */
+static int open_alarms(void) {
+	static const struct {
+		const char *fmt;
+		enum hwmon_kind kind;
+	} kinds[] = {
+		{"temp%u_alarm%n", HWMON_TEMP},
+		{"fan%u_alarm%n", HWMON_FAN},
+		{"in%u_alarm%n", HWMON_IN},
+	};
+
+	int dup_fd = dup(hwmon_fd);
+	DIR *dir = dup_fd >= 0 ? fdopendir(dup_fd) : NULL;
+	if (!dir) {
+		if (dup_fd >= 0) {
+			close(dup_fd);
+		}
+		return -1;
+	}
+	struct dirent *de;
+	while (nalarms < MAX_ALARMS && (de = readdir(dir)) != NULL) {
+		for (size_t k = 0; k < sizeof(kinds) / sizeof(kinds[0]); ++k) {
+			unsigned idx;
+			int end = 0;
+			if (sscanf(de->d_name, kinds[k].fmt, &idx, &end) != 1 || end == 0 || de->d_name[end]) {
+				continue;
+			}
+			int fd = openat(hwmon_fd, de->d_name, O_RDONLY | O_CLOEXEC);
+			if (fd < 0) {
+				break;
+			}
+			struct alarm *a = &alarms[nalarms++];
+			memset(a, 0, sizeof(*a));
+			a->kind = kinds[k].kind;
+			a->index = (int)idx;
+			a->fd = fd;
+			a->state = -1;
+			snprintf(a->name, sizeof(a->name), "%.*s", (int)(strchr(de->d_name, '_') - de->d_name),
+				 de->d_name);
+
+			char attr[HWMON_ATTR_MAX + 8];
+			snprintf(attr, sizeof(attr), "%s_input", a->name);
+			a->input_fd = openat(hwmon_fd, attr, O_RDONLY | O_CLOEXEC);
+			snprintf(attr, sizeof(attr), "%s_label", a->name);
+			int lfd = openat(hwmon_fd, attr, O_RDONLY | O_CLOEXEC);
+			if (lfd >= 0) {
+				ssize_t n = pread(lfd, a->label, sizeof(a->label) - 1, 0);
+				a->label[n > 0 ? n : 0] = '\0';
+				a->label[strcspn(a->label, "\n")] = '\0';
+				close(lfd);
+			}
+			break;
+		}
+	}
+	closedir(dir);
+	qsort(alarms, (size_t)nalarms, sizeof(alarms[0]), alarm_cmp);
+	return nalarms;
+}
+
+/* RETURNS: the limit attribute's value, or INT32_MIN if absent */
+static int32_t read_limit(const struct alarm *a, const char *suffix) {
+	char attr[HWMON_ATTR_MAX + 16];
+	snprintf(attr, sizeof(attr), "%s%s", a->name, suffix);
+	int fd = openat(hwmon_fd, attr, O_RDONLY | O_CLOEXEC);
+	int32_t v = INT32_MIN;
+	if (fd >= 0) {
+		if (hwmon_read_int(fd, &v) < 0) {
+			v = INT32_MIN;
+		}
+		close(fd);
+	}
+	return v;
+}
+
+/*
+ * describe() - "92.0 C, max 85.0 C" / "1612 mV, limits 800-1500 mV" / "0 RPM, min 300 RPM"
+ * WHY: Limits are read only here, on a transition; the steady state never
+ *      touches them
+ */
+static void describe(const struct alarm *a, int32_t value, bool have, char *out, size_t len) {
+	int n = 0;
+	switch (a->kind) {
+	case HWMON_TEMP: {
+		int32_t max = read_limit(a, "_max");
+		int32_t crit = read_limit(a, "_crit");
+		n = have ? snprintf(out, len, "%.1f C", value / 1000.0) : snprintf(out, len, "? C");
+		if (max != INT32_MIN) {
+			n += snprintf(out + n, len - (size_t)n, ", max %.1f C", max / 1000.0);
+		}
+		if (crit != INT32_MIN) {
+			snprintf(out + n, len - (size_t)n, ", crit %.1f C", crit / 1000.0);
+		}
+		break;
+	}
+	case HWMON_IN: {
+		int32_t lo = read_limit(a, "_min");
+		int32_t hi = read_limit(a, "_max");
+		n = have ? snprintf(out, len, "%d mV", value) : snprintf(out, len, "? mV");
+		if (lo != INT32_MIN && hi != INT32_MIN) {
+			snprintf(out + n, len - (size_t)n, ", limits %d-%d mV", lo, hi);
+		}
+		break;
+	}
+	default: {
+		int32_t min = read_limit(a, "_min");
+		n = have ? snprintf(out, len, "%d RPM", value) : snprintf(out, len, "? RPM");
+		if (min != INT32_MIN) {
+			snprintf(out + n, len - (size_t)n, ", min %d RPM", min);
+		}
+		break;
+	}
+	}
+}
+
+/*
+ * run_hook() - --exec: start `sh -c CMD` for one transition, never waited for
+ * WHY: A slow pager or webhook must not delay the next alarm; SIGCHLD is
+ *      SA_NOCLDWAIT, so finished hooks never linger as zombies
+ */
+static void run_hook(const struct alarm *a, int32_t value, bool have) {
+	pid_t pid = fork();
+	if (pid != 0) {
+		if (pid < 0) {
+			fprintf(stderr, "[WARN] --exec: fork: %s\n", strerror(errno));
+		}
+		return;
+	}
+	char buf[24];
+	snprintf(buf, sizeof(buf), "%d", value);
+	setenv("NCT_ALARM", a->name, 1);
+	setenv("NCT_ALARM_STATE", a->state ? "raised" : "cleared", 1);
+	setenv("NCT_ALARM_LABEL", a->label, 1);
+	setenv("NCT_ALARM_VALUE", have ? buf : "", 1);
+	execl("/bin/sh", "sh", "-c", exec_cmd, (char *)NULL);
+	_exit(127);
+}
+
+/*
+ * check_alarm() - Re-read one alarm bit; report and hook a transition
+ * HOW:  The pread() at offset 0 also re-arms sysfs_notify() for this fd
+ * RETURNS: current state (0/1), or -1 if unreadable
+ */
+static int check_alarm(struct alarm *a) {
+	int32_t v;
+	if (hwmon_read_int(a->fd, &v) < 0) {
+		return -1;
+	}
+	int state = v != 0;
+	if (state == a->state || (a->state == -1 && !state)) {
+		a->state = state;
+		return state;
+	}
+	a->state = state;
+
+	int32_t value = 0;
+	bool have = a->input_fd >= 0 && hwmon_read_int(a->input_fd, &value) == 0;
+	char what[96];
+	describe(a, value, have, what, sizeof(what));
+	if (state) {
+		fprintf(stderr, "[WARN] Alarm raised: %s%s%s%s %s\n", a->name, a->label[0] ? " (" : "", a->label,
+			a->label[0] ? ")" : "", what);
+	} else {
+		fprintf(stderr, "[INFO] Alarm cleared: %s%s%s%s %s\n", a->name, a->label[0] ? " (" : "", a->label,
+			a->label[0] ? ")" : "", what);
+	}
+	if (exec_cmd) {
+		run_hook(a, value, have);
+	}
+	return state;
+}
+
+static void usage(FILE *out, const char *prog) {
+	fprintf(out,
+		"Usage: %s [--plan PLAN] [--hwmon DIR] [--interval MS] [--exec CMD] [--once] [--verbose] [--stats]\n"
+		"  --plan PLAN    program the plan's limit writes first (e.g. %s)\n"
+		"  --hwmon DIR    NCT67xx hwmon directory (default: resolve)\n"
+		"  --interval MS  re-read every alarm each update cycle (default %d; 0 = notify only)\n"
+		"  --exec CMD     run `sh -c CMD` on every raised/cleared transition\n"
+		"  --once         print active alarms and exit (1 if any)\n"
+		"  --verbose      log every limit write and wakeup\n"
+		"  --stats        print per-operation latency histograms on exit\n",
+		prog, NCT_PLAN_PATH, INTERVAL_DEFAULT);
+}
+
+/*
+ * main() - Entry point
+ * STRATEGY:
+ *   1. Resolve the device, program limits from --plan
+ *   2. Open every alarm and take its initial state (reporting active ones)
+ *   3. poll() until signalled: notified fds are re-read at once, all of
+ *      them once per --interval on an absolute CLOCK_MONOTONIC deadline
+ */
+int main(int argc, char **argv) {
+	static const struct option longopts[] = {
+		{"plan", required_argument, NULL, 'p'},
+		{"hwmon", required_argument, NULL, 'H'},
+		{"interval", required_argument, NULL, 'i'},
+		{"exec", required_argument, NULL, 'e'},
+		{"once", no_argument, NULL, '1'},
+		{"verbose", no_argument, NULL, 'v'},
+		{"stats", no_argument, NULL, 's'},
+		{"help", no_argument, NULL, 'h'},
+		{NULL, 0, NULL, 0},
+	};
+
+	const char *plan = NULL;
+	char hwmon[HWMON_PATH_MAX] = "";
+	long interval_ms = INTERVAL_DEFAULT;
+	bool once = false, show_stats = false;
+
+	int opt;
+	while ((opt = getopt_long(argc, argv, "p:H:i:e:1vsh", longopts, NULL)) != -1) {
+		switch (opt) {
+		case 'p':
+			plan = optarg;
+			break;
+		case 'H':
+			snprintf(hwmon, sizeof(hwmon), "%s", optarg);
+			break;
+		case 'i': {
+			char *end;
+			interval_ms = strtol(optarg, &end, 10);
+			if (*end || (interval_ms != 0 && (interval_ms < INTERVAL_MIN || interval_ms > INTERVAL_MAX))) {
+				fprintf(stderr, "[ERROR] --interval must be 0 or %d-%d ms\n", INTERVAL_MIN, INTERVAL_MAX);
+				return 2;
+			}
+			break;
+		}
+		case 'e':
+			exec_cmd = optarg;
+			break;
+		case '1':
+			once = true;
+			break;
+		case 'v':
+			verbose = true;
+			break;
+		case 's':
+			show_stats = true;
+			break;
+		case 'h':
+			usage(stdout, argv[0]);
+			return 0;
+		default:
+			usage(stderr, argv[0]);
+			return 2;
+		}
+	}
+	if (optind < argc) {
+		usage(stderr, argv[0]);
+		return 2;
+	}
+
+	if (!hwmon[0]) {
+		struct hwmon_resolution res;
+		if (hwmon_resolve(&res, 0) < 0) {
+			fprintf(stderr, "[ERROR] No %s* hwmon device under %s (is nct6775 loaded?)\n", HWMON_NAME_PREFIX,
+				HWMON_CLASS_PATH);
+			return 2;
+		}
+		snprintf(hwmon, sizeof(hwmon), "%s", res.hwmon);
+	}
+	hwmon_fd = open(hwmon, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (hwmon_fd < 0) {
+		fprintf(stderr, "[ERROR] Cannot open hwmon directory %s: %s\n", hwmon, strerror(errno));
+		return 2;
+	}
+
+	int rc = 0;
+	if (plan && program_limits(plan) != 0) {
+		rc = 2;
+	}
+	if (open_alarms() <= 0) {
+		fprintf(stderr, "[ERROR] No *_alarm attributes in %s\n", hwmon);
+		close(hwmon_fd);
+		return 2;
+	}
+
+	struct sigaction sa = {.sa_handler = on_signal};
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	struct sigaction chld = {.sa_handler = SIG_DFL, .sa_flags = SA_NOCLDWAIT};
+	sigemptyset(&chld.sa_mask);
+	sigaction(SIGCHLD, &chld, NULL);
+
+	int active = 0;
+	for (int i = 0; i < nalarms; ++i) {
+		active += check_alarm(&alarms[i]) == 1;
+	}
+	if (once) {
+		fprintf(stderr, "[INFO] %d alarm(s) on %s, %d active\n", nalarms, hwmon, active);
+		close(hwmon_fd);
+		if (show_stats) {
+			nct_stats_print(stderr, &nct_stats);
+		}
+		return rc ? rc : (active ? 1 : 0);
+	}
+
+	struct pollfd pfd[MAX_ALARMS];
+	for (int i = 0; i < nalarms; ++i) {
+		pfd[i] = (struct pollfd){.fd = alarms[i].fd, .events = POLLPRI};
+	}
+	if (interval_ms) {
+		fprintf(stderr, "[INFO] Watching %d alarm(s) on %s (%d active), re-read every %ld ms\n", nalarms, hwmon,
+			active, interval_ms);
+	} else {
+		fprintf(stderr, "[INFO] Watching %d alarm(s) on %s (%d active), sysfs_notify only\n", nalarms, hwmon,
+			active);
+	}
+
+	uint64_t notified = 0, cycles = 0;
+	int64_t deadline = monotonic_ms() + interval_ms;
+	while (!stop_requested) {
+		int timeout = -1;
+		if (interval_ms) {
+			int64_t left = deadline - monotonic_ms();
+			timeout = left > 0 ? (int)left : 0;
+		}
+		int n = poll(pfd, (nfds_t)nalarms, timeout);
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			fprintf(stderr, "[ERROR] poll: %s\n", strerror(errno));
+			rc = 2;
+			break;
+		}
+		for (int i = 0; n > 0 && i < nalarms; ++i) {
+			if (pfd[i].revents & (POLLPRI | POLLERR)) {
+				notified++;
+				if (verbose) {
+					fprintf(stderr, "[INFO] %s_alarm notified\n", alarms[i].name);
+				}
+				check_alarm(&alarms[i]);
+			}
+		}
+		if (interval_ms && monotonic_ms() >= deadline) {
+			for (int i = 0; i < nalarms; ++i) {
+				check_alarm(&alarms[i]);
+			}
+			cycles++;
+			deadline += interval_ms;
+			int64_t now = monotonic_ms();
+			if (deadline <= now) {
+				deadline = now + interval_ms;   /* suspended or stalled: no catch-up burst */
+			}
+		}
+	}
+
+	for (int i = 0; i < nalarms; ++i) {
+		close(alarms[i].fd);
+		if (alarms[i].input_fd >= 0) {
+			close(alarms[i].input_fd);
+		}
+	}
+	close(hwmon_fd);
+	fprintf(stderr, "[INFO] cycles=%llu notified=%llu\n", (unsigned long long)cycles,
+		(unsigned long long)notified);
+	if (show_stats) {
+		nct_stats_print(stderr, &nct_stats);
+	}
+	return rc;
+}
+
+/*
+ * BUILD & DEPLOYMENT NOTES:
+ *
+ * Compilation:
+ *   gcc -std=c23 -O2 -Wall -Wextra -Werror -o nct-alarm \
+ *       nct-alarm.c nct-hwmon.c nct-stats.c
+ *
+ * Installation (in PKGBUILD):
+ *   install -Dm755 nct-alarm "$pkgdir/usr/lib/eirikr/nct-alarm"
+ *   nct-alarm.service runs it with --plan /var/cache/eirikr/nct-fan.plan
+ *
+ * Cost model:
+ *   Healthy box: one poll() wakeup and ~30 alarm preads per update cycle,
+ *   no value reads; the driver refreshes its register cache at most once
+ *   per cycle either way, and with nct-sampler running those reads are
+ *   served from that cache. A value-polling loop comparing temperatures,
+ *   voltages and RPMs in userspace reads 3-4x as many attributes, needs
+ *   its own copy of the limits and still misses excursions between its
+ *   reads that the chip's per-conversion comparison latches.
+ */
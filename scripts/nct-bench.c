@@ -0,0 +1,697 @@
+/*
+ * nct-bench.c - Microbenchmarks for every NCT6798D access path
+ *
+ * PURPOSE:
+ *   Measure what each way of reaching the chip costs on this machine,
+ *   kernel and BIOS, and print it as one JSON document so runs can be
+ *   archived and compared across a fleet (kernel upgrades, BIOS updates,
+ *   nct6775 driving the chip through ISA ports vs the ASUS WMI methods).
+ *
+ * BENCHMARKS (result "name"):
+ *   sysfs_read.<kind>          one pread(2) + parse of one hwmon attribute;
+ *                              kind = temp, fan, in, pwm, pwm_enable
+ *   sysfs_write.pwm_auto_point one pwrite(2) of a curve point's current
+ *                              value back to it (--write only)
+ *   sysfs_write.pwm            the same for pwmN duty, manual-mode (1)
+ *                              headers only (--write only)
+ *   sio_read_cr                one sio_read() of CR 0x20/0x21, alternating
+ *                              so every read pays the index write
+ *   hwm_dump                   one pass over all HWM_BANKS banks with
+ *                              hwm_read_bank(), i.e. `nct-id --dump`
+ *   wmi_rhwm                   one ASUS RHWM firmware call
+ *   wmi_bank                   one 256-register bank via wmi_hwm_read_many()
+ *   script.<name>.<mode>       one end-to-end run of a read-only script mode
+ *                              (fork + bash + everything it execs)
+ *
+ *   Every result carries ops, failures, p50/p99/mean/min/max in ns and
+ *   ops_per_sec. A path that cannot run here stays in the output with
+ *   "skipped": "<reason>", so two documents always have the same keys.
+ *
+ * OUTPUT (stdout or -o FILE):
+ *   {"bench": "nct-bench", "schema": 1, "kernel": ..., "bios_version": ...,
+ *    "hwmon": ..., "hwm_ports_owner": "nct6775" | null, ...,
+ *    "results": [{"name": "sysfs_read.temp", "ops": 1000, "p50_ns": ...}, ...]}
+ *   hwm_ports_owner says which access path the kernel driver is using: a
+ *   claimed base+5/base+6 region means ISA, null with a live hwmon device
+ *   means the driver went through ASUS WMI. Either way the driver owns the
+ *   ports, and sio_read_cr / hwm_dump report "skipped": "HWM ports owned
+ *   by <owner>" unless --force.
+ *
+ * USAGE:
+ *   nct-bench [--iterations N] [--hwmon DIR] [--write] [--scripts DIR]
+ *             [--script-runs N] [--force] [-o FILE]
+ *     --iterations N   Ops per fast benchmark (default 1000); hwm_dump runs
+ *                      N/20 passes, WMI benchmarks are capped (see below)
+ *     --hwmon DIR      hwmon directory (default: hwmon_resolve())
+ *     --write          Enable the sysfs_write.* identity writes
+ *     --scripts DIR    Where max-fans-*.sh live (default: next to this binary)
+ *     --script-runs N  Runs per script benchmark (default 5)
+ *     --force          Run sio_read_cr and hwm_dump while nct6775 is bound
+ *                      (races its bank selects, as nct-id --dump --force)
+ *
+ * SAFETY / CAVEATS:
+ *   - Read-only unless --write, and --write only rewrites values that are
+ *     already programmed
+ *   - sio_read_cr and hwm_dump need root and unreserved ports; hwm_dump
+ *     holds HWM_LOCK_PATH and restores the bank exactly like nct-id --dump
+ *   - While nct6775 is bound (ISA or ASUS WMI) neither runs, and the SIO
+ *     probe is skipped too: the driver's bank selects are not locked
+ *     against ours, the same rule as isa_open() and nct-id --dump
+ *   - WMI calls cost ~0.1-1 ms each: wmi_rhwm is capped at 200 calls and
+ *     wmi_bank at 5 banks per run
+ *   - max-fans.sh has no read-only mode (it writes PWM 255), so it is
+ *     reported as skipped instead of being run
+ */
+
+#define _GNU_SOURCE
+#include "nct-hwmon.h"
+#include "nct-isa.h"
+#include "nct-sio.h"
+#include "nct-wmi.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/utsname.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_CHANNELS     128
+#define WMI_MAX_CALLS    200
+#define WMI_MAX_BANKS    5
+#define DEFAULT_ITER     1000
+#define DEFAULT_SCRIPTS  5
+#define DMI_PATH         "/sys/class/dmi/id"
+
+static uint64_t *samples;
+static bool first_result = true;
+
+static uint64_t clock_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * json_str() - Print a JSON string literal, or null for NULL / ""
+ */
+static void json_str(FILE *out, const char *s) {
+	if (!s || !*s) {
+		fputs("null", out);
+		return;
+	}
+	fputc('"', out);
+	for (; *s; ++s) {
+		if (*s == '"' || *s == '\\') {
+			fprintf(out, "\\%c", *s);
+		} else if ((unsigned char)*s < 0x20) {
+			fprintf(out, "\\u%04x", (unsigned char)*s);
+		} else {
+			fputc(*s, out);
+		}
+	}
+	fputc('"', out);
+}
+
+static void read_text(const char *path, char *buf, size_t len) {
+	buf[0] = '\0';
+	FILE *f = fopen(path, "re");
+	if (!f) {
+		return;
+	}
+	if (fgets(buf, (int)len, f)) {
+		buf[strcspn(buf, "\n")] = '\0';
+	}
+	fclose(f);
+}
+
+static int u64_cmp(const void *a, const void *b) {
+	uint64_t x = *(const uint64_t *)a;
+	uint64_t y = *(const uint64_t *)b;
+	return (x > y) - (x < y);
+}
+
+/*
+ * percentile() - Nearest-rank percentile of a sorted sample
+ */
+static uint64_t percentile(const uint64_t *v, size_t n, unsigned p) {
+	size_t rank = (n * p + 99) / 100;
+	return v[rank ? rank - 1 : 0];
+}
+
+static void result_begin(FILE *out, const char *name) {
+	fputs(first_result ? "\n    {\"name\": " : ",\n    {\"name\": ", out);
+	first_result = false;
+	json_str(out, name);
+}
+
+/*
+ * emit_result() - Sort n samples and print one result object
+ */
+static void emit_result(FILE *out, const char *name, uint64_t *ns, size_t n, size_t failures) {
+	if (n == 0) {
+		result_begin(out, name);
+		fprintf(out, ", \"skipped\": \"every operation failed\", \"failures\": %zu}", failures);
+		return;
+	}
+
+	qsort(ns, n, sizeof(ns[0]), u64_cmp);
+	uint64_t sum = 0;
+	for (size_t i = 0; i < n; ++i) {
+		sum += ns[i];
+	}
+	double mean = (double)sum / (double)n;
+
+	result_begin(out, name);
+	fprintf(out, ", \"ops\": %zu, \"failures\": %zu, \"p50_ns\": %" PRIu64 ", \"p99_ns\": %" PRIu64
+		", \"mean_ns\": %.0f, \"min_ns\": %" PRIu64 ", \"max_ns\": %" PRIu64 ", \"ops_per_sec\": %.1f}",
+		n, failures, percentile(ns, n, 50), percentile(ns, n, 99), mean, ns[0], ns[n - 1],
+		mean > 0 ? 1e9 / mean : 0.0);
+}
+
+static void emit_skip(FILE *out, const char *name, const char *reason) {
+	result_begin(out, name);
+	fputs(", \"skipped\": ", out);
+	json_str(out, reason);
+	fputc('}', out);
+}
+
+/*
+ * bench_sysfs_read() - One result per channel kind, cycling over its channels
+ */
+static void bench_sysfs_read(FILE *out, const struct hwmon_channel *ch, int nch, int iterations) {
+	for (int kind = 0; kind < HWMON_KIND_COUNT; ++kind) {
+		char name[48];
+		snprintf(name, sizeof(name), "sysfs_read.%s", hwmon_kind_name((enum hwmon_kind)kind));
+
+		int list[MAX_CHANNELS];
+		int cnt = 0;
+		for (int i = 0; i < nch; ++i) {
+			if ((int)ch[i].kind == kind) {
+				list[cnt++] = i;
+			}
+		}
+		if (cnt == 0) {
+			emit_skip(out, name, nch ? "no attributes of this kind" : "no nct67xx hwmon device");
+			continue;
+		}
+
+		size_t n = 0, failures = 0;
+		for (int i = 0; i < iterations; ++i) {
+			int32_t v;
+			uint64_t t0 = clock_ns();
+			int rc = hwmon_read_int(ch[list[i % cnt]].fd, &v);
+			uint64_t t1 = clock_ns();
+			if (rc < 0) {
+				failures++;
+			} else {
+				samples[n++] = t1 - t0;
+			}
+		}
+		emit_result(out, name, samples, n, failures);
+	}
+}
+
+/*
+ * open_identity() - Open an attribute read-write and capture its value
+ * RETURNS: fd, or -1 if it is missing, unreadable or not writable
+ */
+static int open_identity(int dirfd, const char *attr, char *value, size_t len) {
+	int fd = openat(dirfd, attr, O_RDWR | O_CLOEXEC);
+	if (fd < 0) {
+		return -1;
+	}
+	ssize_t n = pread(fd, value, len - 1, 0);
+	if (n <= 0) {
+		close(fd);
+		return -1;
+	}
+	value[n] = '\0';
+	return fd;
+}
+
+/*
+ * bench_sysfs_write() - Identity writes: every value written is the one
+ *                       the attribute held when the benchmark started
+ * HOW: Headers are found through their pwmN_enable channel, which every
+ *      controllable header has
+ */
+static void bench_sysfs_write(FILE *out, int dirfd, const struct hwmon_channel *ch, int nch,
+			      int iterations, bool enabled) {
+	static const char *const names[] = {"sysfs_write.pwm_auto_point", "sysfs_write.pwm"};
+	if (!enabled || dirfd < 0) {
+		for (size_t c = 0; c < 2; ++c) {
+			emit_skip(out, names[c], dirfd < 0 ? "no nct67xx hwmon device"
+							   : "pass --write (rewrites current values)");
+		}
+		return;
+	}
+
+	for (int c = 0; c < 2; ++c) {
+		int fds[MAX_CHANNELS];
+		char values[MAX_CHANNELS][24];
+		int cnt = 0;
+		for (int i = 0; i < nch && cnt < MAX_CHANNELS; ++i) {
+			if (ch[i].kind != HWMON_PWM_ENABLE) {
+				continue;
+			}
+			char attr[HWMON_ATTR_MAX + 24];
+			char mode[24];
+			if (c == 0) {
+				snprintf(attr, sizeof(attr), "pwm%d_auto_point1_temp", ch[i].index);
+			} else {
+				snprintf(attr, sizeof(attr), "pwm%d_enable", ch[i].index);
+				int efd = openat(dirfd, attr, O_RDONLY | O_CLOEXEC);
+				ssize_t m = efd >= 0 ? pread(efd, mode, sizeof(mode) - 1, 0) : -1;
+				if (efd >= 0) {
+					close(efd);
+				}
+				if (m <= 0 || mode[0] != '1' || (mode[1] != '\n' && mode[1] != '\0')) {
+					continue;
+				}
+				snprintf(attr, sizeof(attr), "pwm%d", ch[i].index);
+			}
+			int fd = open_identity(dirfd, attr, values[cnt], sizeof(values[cnt]));
+			if (fd >= 0) {
+				fds[cnt++] = fd;
+			}
+		}
+		if (cnt == 0) {
+			emit_skip(out, names[c], c == 0 ? "no writable pwmN_auto_point1_temp"
+							: "no header in manual mode (pwmN_enable=1)");
+			continue;
+		}
+
+		size_t n = 0, failures = 0;
+		for (int i = 0; i < iterations; ++i) {
+			int k = i % cnt;
+			size_t len = strlen(values[k]);
+			uint64_t t0 = clock_ns();
+			ssize_t w = pwrite(fds[k], values[k], len, 0);
+			uint64_t t1 = clock_ns();
+			if (w != (ssize_t)len) {
+				failures++;
+			} else {
+				samples[n++] = t1 - t0;
+			}
+		}
+		for (int k = 0; k < cnt; ++k) {
+			close(fds[k]);
+		}
+		emit_result(out, names[c], samples, n, failures);
+	}
+}
+
+/*
+ * bench_isa() - sio_read_cr and hwm_dump through the shadowed port layer
+ * IN:  owned  "HWM ports owned by <owner>" when the driver holds the
+ *             ports and --force was not given, else NULL
+ */
+static void bench_isa(FILE *out, const char *owned, bool probed, uint16_t port, uint16_t base,
+		      int iterations) {
+	const char *why = "ioperm denied or no Super I/O (not root, or ACPI-reserved ports)";
+	if (owned) {
+		emit_skip(out, "sio_read_cr", owned);
+		emit_skip(out, "hwm_dump", owned);
+		return;
+	}
+	if (!probed) {
+		emit_skip(out, "sio_read_cr", why);
+		emit_skip(out, "hwm_dump", why);
+		return;
+	}
+
+	struct sio_ctx sio;
+	if (sio_open(&sio, port)) {
+		emit_skip(out, "sio_read_cr", why);
+	} else {
+		size_t n = 0;
+		for (int i = 0; i < iterations; ++i) {
+			uint8_t reg = (i & 1) ? SIO_REG_DEVID_LO : SIO_REG_DEVID_HI;
+			uint64_t t0 = clock_ns();
+			(void)sio_read(&sio, reg);
+			samples[n++] = clock_ns() - t0;
+		}
+		sio_close(&sio);
+		emit_result(out, "sio_read_cr", samples, n, 0);
+	}
+
+	int lock_fd = open(HWM_LOCK_PATH, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+	if (lock_fd < 0 || flock(lock_fd, LOCK_EX) < 0) {
+		emit_skip(out, "hwm_dump", "cannot take " HWM_LOCK_PATH);
+		if (lock_fd >= 0) {
+			close(lock_fd);
+		}
+		return;
+	}
+	struct hwm_ctx hwm;
+	if (hwm_open(&hwm, base)) {
+		emit_skip(out, "hwm_dump", why);
+	} else {
+		static uint8_t regs[HWM_BANKS][HWM_BANK_SIZE];
+		int runs = iterations / 20 > 0 ? iterations / 20 : 1;
+		size_t n = 0;
+		for (int r = 0; r < runs; ++r) {
+			uint64_t t0 = clock_ns();
+			for (int bank = 0; bank < HWM_BANKS; ++bank) {
+				hwm_read_bank(&hwm, (uint8_t)bank, regs[bank]);
+			}
+			samples[n++] = clock_ns() - t0;
+		}
+		hwm_close(&hwm);
+		emit_result(out, "hwm_dump", samples, n, 0);
+	}
+	flock(lock_fd, LOCK_UN);
+	close(lock_fd);
+}
+
+/*
+ * bench_wmi() - wmi_rhwm (single call) and wmi_bank (256 calls)
+ */
+static void bench_wmi(FILE *out, int iterations) {
+	struct wmi_ctx wmi;
+	char err[256];
+	if (wmi_open(&wmi, err, sizeof(err)) < 0) {
+		emit_skip(out, "wmi_rhwm", err);
+		emit_skip(out, "wmi_bank", err);
+		return;
+	}
+
+	int calls = iterations < WMI_MAX_CALLS ? iterations : WMI_MAX_CALLS;
+	size_t n = 0, failures = 0;
+	for (int i = 0; i < calls; ++i) {
+		uint8_t v;
+		uint64_t t0 = clock_ns();
+		int rc = wmi_hwm_read(&wmi, HWM_REG(4, 0x90 + (i & 7)), &v);
+		uint64_t t1 = clock_ns();
+		if (rc < 0) {
+			failures++;
+		} else {
+			samples[n++] = t1 - t0;
+		}
+	}
+	emit_result(out, "wmi_rhwm", samples, n, failures);
+
+	uint16_t list[HWM_BANK_SIZE];
+	uint8_t regs[HWM_BANK_SIZE];
+	for (int index = 0; index < HWM_BANK_SIZE; ++index) {
+		list[index] = HWM_REG(4, index);
+	}
+	n = failures = 0;
+	for (int b = 0; b < WMI_MAX_BANKS; ++b) {
+		uint64_t t0 = clock_ns();
+		int rc = wmi_hwm_read_many(&wmi, list, HWM_BANK_SIZE, regs);
+		uint64_t t1 = clock_ns();
+		if (rc < 0) {
+			failures++;
+		} else {
+			samples[n++] = t1 - t0;
+		}
+	}
+	emit_result(out, "wmi_bank", samples, n, failures);
+	wmi_close(&wmi);
+}
+
+/*
+ * run_script() - fork + exec `bash SCRIPT ARG`, output discarded
+ * RETURNS: wait status, or -1 if fork failed
+ */
+static int run_script(const char *path, const char *arg) {
+	pid_t pid = fork();
+	if (pid < 0) {
+		return -1;
+	}
+	if (pid == 0) {
+		int null = open("/dev/null", O_RDWR);
+		if (null >= 0) {
+			dup2(null, STDIN_FILENO);
+			dup2(null, STDOUT_FILENO);
+			dup2(null, STDERR_FILENO);
+		}
+		execl("/bin/bash", "bash", path, arg, (char *)NULL);
+		_exit(127);
+	}
+	int status;
+	while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+	}
+	return status;
+}
+
+static void bench_scripts(FILE *out, const char *dir, int runs) {
+	static const struct {
+		const char *script;
+		const char *arg;
+	} modes[] = {
+		{"max-fans-enhanced", "--verify"},
+		{"max-fans-advanced", "--verify"},
+	};
+
+	for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); ++m) {
+		char name[64];
+		char path[PATH_MAX];
+		snprintf(name, sizeof(name), "script.%s.%s", modes[m].script, modes[m].arg + 2);
+		snprintf(path, sizeof(path), "%s/%s.sh", dir, modes[m].script);
+		if (access(path, R_OK) < 0) {
+			emit_skip(out, name, "script not found (use --scripts DIR)");
+			continue;
+		}
+
+		size_t n = 0, failures = 0;
+		for (int r = 0; r < runs; ++r) {
+			uint64_t t0 = clock_ns();
+			int status = run_script(path, modes[m].arg);
+			samples[n++] = clock_ns() - t0;
+			if (status < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+				failures++;
+			}
+		}
+		emit_result(out, name, samples, n, failures);
+	}
+	emit_skip(out, "script.max-fans.apply", "no read-only mode (writes PWM 255 to every header)");
+}
+
+/*
+ * platform_base() - HWM base from the platform device name (nct6775.656)
+ * WHY: Lets hwm_ports_owner be reported without ioperm() access
+ */
+static uint16_t platform_base(const char *platform) {
+	const char *dot = strrchr(platform, '.');
+	if (!dot || !strstr(platform, HWMON_PLATFORM_PREFIX)) {
+		return 0;
+	}
+	return (uint16_t)strtoul(dot + 1, NULL, 10);
+}
+
+static void usage(FILE *out, const char *prog) {
+	fprintf(out,
+		"Usage: %s [--iterations N] [--hwmon DIR] [--write] [--scripts DIR] [--script-runs N] [--force] [-o FILE]\n"
+		"  --iterations N   ops per benchmark (default %d)\n"
+		"  --hwmon DIR      hwmon directory (default: resolve nct67xx)\n"
+		"  --write          include sysfs identity-write benchmarks\n"
+		"  --scripts DIR    directory holding max-fans-*.sh (default: next to this binary)\n"
+		"  --script-runs N  runs per script benchmark (default %d)\n"
+		"  --force          run sio_read_cr/hwm_dump while nct6775 is bound\n"
+		"  -o FILE          write JSON to FILE instead of stdout\n",
+		prog, DEFAULT_ITER, DEFAULT_SCRIPTS);
+}
+
+/*
+ * main() - Entry point
+ * STRATEGY:
+ *   1. Collect the context (kernel, DMI, hwmon device, port owner, and the
+ *      SIO probe unless nct6775 is bound)
+ *   2. Run sysfs, ISA, WMI and script benchmarks in that order, each
+ *      emitting its result (or its skip reason) as soon as it finishes
+ */
+int main(int argc, char **argv) {
+	int iterations = DEFAULT_ITER;
+	int script_runs = DEFAULT_SCRIPTS;
+	bool do_write = false;
+	bool force = false;
+	char hwmon[HWMON_PATH_MAX] = "";
+	char scripts[PATH_MAX] = "";
+	const char *output = NULL;
+
+	static const struct option opts[] = {
+		{"iterations", required_argument, NULL, 'n'},
+		{"hwmon", required_argument, NULL, 'H'},
+		{"write", no_argument, NULL, 'w'},
+		{"scripts", required_argument, NULL, 's'},
+		{"script-runs", required_argument, NULL, 'r'},
+		{"force", no_argument, NULL, 'F'},
+		{"help", no_argument, NULL, 'h'},
+		{NULL, 0, NULL, 0},
+	};
+	int c;
+	while ((c = getopt_long(argc, argv, "o:h", opts, NULL)) != -1) {
+		switch (c) {
+		case 'n':
+			iterations = atoi(optarg);
+			break;
+		case 'H':
+			snprintf(hwmon, sizeof(hwmon), "%s", optarg);
+			break;
+		case 'w':
+			do_write = true;
+			break;
+		case 's':
+			snprintf(scripts, sizeof(scripts), "%s", optarg);
+			break;
+		case 'r':
+			script_runs = atoi(optarg);
+			break;
+		case 'F':
+			force = true;
+			break;
+		case 'o':
+			output = optarg;
+			break;
+		case 'h':
+			usage(stdout, argv[0]);
+			return 0;
+		default:
+			usage(stderr, argv[0]);
+			return 2;
+		}
+	}
+	if (iterations < 1 || iterations > 1000000 || script_runs < 1 || script_runs > 1000) {
+		fprintf(stderr, "[ERROR] --iterations must be 1-1000000, --script-runs 1-1000\n");
+		return 2;
+	}
+	if (!scripts[0]) {
+		char exe[PATH_MAX];
+		ssize_t n = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+		exe[n > 0 ? n : 0] = '\0';
+		char *slash = strrchr(exe, '/');
+		if (slash) {
+			*slash = '\0';
+		}
+		snprintf(scripts, sizeof(scripts), "%s", n > 0 ? exe : ".");
+	}
+
+	samples = calloc((size_t)(iterations > script_runs ? iterations : script_runs), sizeof(samples[0]));
+	if (!samples) {
+		fprintf(stderr, "[ERROR] Out of memory\n");
+		return 2;
+	}
+
+	FILE *out = output ? fopen(output, "we") : stdout;
+	if (!out) {
+		fprintf(stderr, "[ERROR] Cannot open %s: %s\n", output, strerror(errno));
+		return 2;
+	}
+
+	struct hwmon_resolution res = {0};
+	if (!hwmon[0] && hwmon_resolve(&res, 0) == 0) {
+		snprintf(hwmon, sizeof(hwmon), "%s", res.hwmon);
+	} else if (hwmon[0]) {
+		char path[HWMON_PATH_MAX + 8];
+		snprintf(path, sizeof(path), "%s/name", hwmon);
+		read_text(path, res.name, sizeof(res.name));
+	}
+	static struct hwmon_channel channels[MAX_CHANNELS];
+	int nch = 0;
+	int dirfd = hwmon[0] ? open(hwmon, O_RDONLY | O_DIRECTORY | O_CLOEXEC) : -1;
+	if (dirfd >= 0) {
+		nch = hwmon_scan_channels(dirfd, channels, MAX_CHANNELS);
+		nch = nch < 0 ? 0 : nch;
+	}
+
+	/* Before sio_probe(): the probe itself drives 0x2E/0x4E */
+	char driver[32] = "";
+	bool bound = isa_driver_bound(driver, sizeof(driver)) == 1;
+	uint16_t port = 0, devid = 0, base = 0;
+	bool probed = (!bound || force) && sio_probe(&port, &devid, &base) == 0;
+	if (!probed) {
+		base = platform_base(res.platform);
+	}
+	char owner[96] = "";
+	if (base && isa_region_owner(base + HWM_INDEX_OFFSET, base + HWM_DATA_OFFSET, owner, sizeof(owner)) <= 0) {
+		owner[0] = '\0';
+	}
+	char owned[160] = "";
+	if (!force && (owner[0] || bound)) {
+		snprintf(owned, sizeof(owned), "HWM ports owned by %s", owner[0] ? owner : driver);
+	} else if (bound) {
+		fprintf(stderr, "[WARN] %s is bound; --force: sio_read_cr/hwm_dump race its bank selects\n", driver);
+	}
+
+	struct utsname uts;
+	uname(&uts);
+	char bios_vendor[64], bios_version[64], bios_date[32], board_vendor[64], board_name[64];
+	read_text(DMI_PATH "/bios_vendor", bios_vendor, sizeof(bios_vendor));
+	read_text(DMI_PATH "/bios_version", bios_version, sizeof(bios_version));
+	read_text(DMI_PATH "/bios_date", bios_date, sizeof(bios_date));
+	read_text(DMI_PATH "/board_vendor", board_vendor, sizeof(board_vendor));
+	read_text(DMI_PATH "/board_name", board_name, sizeof(board_name));
+	char hex[3][8];
+	snprintf(hex[0], sizeof(hex[0]), probed ? "0x%X" : "", port);
+	snprintf(hex[1], sizeof(hex[1]), probed ? "0x%04X" : "", devid);
+	const struct nct_chip *chip = probed ? nct_chip_identify(devid) : NULL;
+	snprintf(hex[2], sizeof(hex[2]), base ? "0x%X" : "", base);
+	time_t now = time(NULL);
+	char stamp[32];
+	strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%S%z", localtime(&now));
+
+	fputs("{\n  \"bench\": \"nct-bench\",\n  \"schema\": 1,\n  \"time\": ", out);
+	json_str(out, stamp);
+	static const char *const keys[] = {
+		"kernel", "machine", "bios_vendor", "bios_version", "bios_date", "board_vendor",
+		"board_name", "hwmon", "hwmon_name", "platform", "sio_port", "chip", "devid",
+		"hwm_base", "hwm_ports_owner",
+	};
+	const char *vals[] = {
+		uts.release, uts.machine, bios_vendor, bios_version, bios_date, board_vendor,
+		board_name, hwmon, res.name, res.platform, hex[0], chip ? chip->name : "", hex[1],
+		hex[2], owner,
+	};
+	for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); ++i) {
+		fprintf(out, ",\n  \"%s\": ", keys[i]);
+		json_str(out, vals[i]);
+	}
+	fprintf(out, ",\n  \"iterations\": %d,\n  \"results\": [", iterations);
+
+	bench_sysfs_read(out, channels, nch, iterations);
+	bench_sysfs_write(out, dirfd, channels, nch, iterations, do_write);
+	bench_isa(out, owned[0] ? owned : NULL, probed, port, base, iterations);
+	bench_wmi(out, iterations);
+	bench_scripts(out, scripts, script_runs);
+	fputs("\n  ]\n}\n", out);
+
+	hwmon_close_channels(channels, nch);
+	if (dirfd >= 0) {
+		close(dirfd);
+	}
+	free(samples);
+	if (out != stdout && fclose(out) != 0) {
+		fprintf(stderr, "[ERROR] Cannot write %s: %s\n", output, strerror(errno));
+		return 1;
+	}
+	return 0;
+}
+
+/*
+ * BUILD & DEPLOYMENT NOTES:
+ *
+ * Compilation:
+ *   gcc -std=c23 -O2 -Wall -Wextra -o nct-bench \
+ *       nct-bench.c nct-hwmon.c nct-isa.c nct-sio.c nct-wmi.c nct-stats.c
+ *
+ * Running:
+ *   make bench                          # from a checkout, JSON on stdout
+ *   make bench BENCH_OUT=bench.json BENCH_ARGS="--write --iterations 5000"
+ *   sudo /usr/lib/eirikr/nct-bench -o /var/tmp/nct-bench.json
+ *   Root adds sio_read_cr, hwm_dump (nct6775 unloaded, or --force) and the
+ *   WMI results; unprivileged runs still cover sysfs and the scripts' cost.
+ *
+ * Comparing runs:
+ *   jq -r '.results[] | [.name, .p50_ns, .p99_ns] | @tsv' a.json b.json
+ */
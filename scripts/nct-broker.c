@@ -0,0 +1,791 @@
+/*
+ * nct-broker.c - Single owner of the NCT67xx hwmon attributes
+ *
+ * PURPOSE:
+ *   Serialize every read and write of the chip's fan-control attributes
+ *   across tools: clients (nct-fan, nct-fanctl, and through nct-fan every
+ *   max-fans*.sh run and max-fans-restore.service) send batched requests
+ *   over a Unix socket (nct-broker.h) and this process alone touches
+ *   sysfs.
+ *
+ * WHY THIS EXISTS:
+ *   max-fans.service, max-fans-restore.service, an admin running
+ *   max-fans-enhanced.sh and nct-fanctl could all write pwmN /
+ *   pwmN_enable at the same moment. set_smartfan_7pt() gates each header
+ *   with pwmN_enable=0 while it reprograms the curve; a duty or enable
+ *   write from another tool landing inside that window left the header
+ *   in the wrong mode, seen as a fan dropout. With one owner a gate
+ *   sequence is one request and nothing can land inside it.
+ *
+ * HOW:
+ *   1. Open the hwmon directory once; attributes are opened on first use
+ *      (O_RDWR, O_RDONLY for read-only ones) and kept open, like nct-fan
+ *   2. poll() on the listening socket and every client; a request is
+ *      executed completely before the next one is read, in arrival order
+ *   3. Reads of ring channels (tempN_input, fanN_input, inN_input, pwmN,
+ *      pwmN_enable) are served from nct-sampler's shared-memory ring when
+ *      the newest sample is fresh (two sample periods) and newer than the
+ *      broker's own last write to that attribute; nothing else is cached
+ *   4. Coalescing requests (a controller's duty writes) are held for
+ *      --window ms; then each attribute gets one write with the newest
+ *      value and every held client is answered with its result. Any other
+ *      request flushes held writes first
+ *
+ * USAGE:
+ *   nct-broker [--socket PATH] [--hwmon DIR] [--ring PATH] [--window MS]
+ *              [--verbose] [--stats]
+ *     --socket PATH  listening socket (default $NCT_BROKER_SOCKET or
+ *                    /run/nct-broker.sock), mode 0666; only uid 0 may write
+ *     --hwmon DIR    NCT67xx hwmon directory (default: hwmon_resolve())
+ *     --ring PATH    sampler ring (default /dev/shm/nct-telemetry); absent
+ *                    ring = every read goes to sysfs
+ *     --window MS    coalescing window, 0-1000 (default 25; 0 = merge only
+ *                    requests that arrive in the same poll() wakeup)
+ *     --verbose      log every request
+ *     --stats        print nct-stats.h latency histograms on exit
+ *
+ *   On exit a one-line summary goes to stderr:
+ *   [INFO] requests=N refused=N reads=N cached=N writes=N merged=N
+ *
+ * EXIT STATUS:
+ *   0  stopped by SIGINT/SIGTERM
+ *   2  usage error, no device, or the socket cannot be created (another
+ *      broker already listening on it)
+ *
+ * SAFETY / CAVEATS:
+ *   - Tools that do not know the broker (echo > pwmN by hand, lm_sensors'
+ *     pwmconfig) still write sysfs directly; the broker cannot stop them
+ *   - Clients fall back to direct sysfs writes when the broker is not
+ *     running, so fans stay controllable if it is stopped or crashes
+ *   - Attribute names are validated like nct-fan's: no '/', no leading
+ *     '.', so a request can never leave the hwmon directory
+ */
+
+#define _GNU_SOURCE
+#include "nct-broker.h"
+#include "nct-hwmon.h"
+#include "nct-ring.h"
+#include "nct-stats.h"
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#define MAX_ATTRS       512
+#define MAX_CLIENTS     64
+#define MAX_PENDING     64
+#define WINDOW_DEFAULT  25
+#define WINDOW_MAX      1000
+#define RING_CHECK_NS   1000000000ull   /* re-stat the ring at most once a second */
+
+/*
+ * struct attr - An attribute opened once for the broker's lifetime
+ * written_ns: last successful write; ring samples older than this are stale
+ */
+struct attr {
+	char name[NCT_BROKER_NAME_MAX];
+	int fd;                         /* >= 0 open, -errno if the open failed */
+	uint64_t written_ns;
+};
+
+/* One attribute with a held (coalesced) write */
+struct pending {
+	int attr;
+	char value[NCT_BROKER_VALUE_MAX];
+	int rc;
+};
+
+/*
+ * struct client - One connection
+ * held: a coalescing request is waiting for the flush; held_ops[] keeps
+ *       what it asked for so the reply can say whether it was superseded
+ */
+struct client {
+	int fd;
+	pid_t pid;
+	bool may_write;
+	bool held;
+	uint32_t tag;
+	uint32_t nops;
+	struct {
+		int pending;
+		char value[NCT_BROKER_VALUE_MAX];
+	} held_ops[NCT_BROKER_COALESCE_MAX];
+};
+
+struct counters {
+	uint64_t requests, refused, reads, cached, writes, merged;
+};
+
+static struct attr attrs[MAX_ATTRS];
+static int nattrs;
+static struct pending pending[MAX_PENDING];
+static int npending;
+static uint64_t flush_deadline_ns;
+static struct client clients[MAX_CLIENTS];
+static int nclients;
+static struct counters count;
+
+static int hwmon_fd = -1;
+static char hwmon_path[HWMON_PATH_MAX];
+static char hwmon_real[PATH_MAX];
+static const char *ring_path = NCT_RING_PATH;
+static const struct nct_ring_header *ring;
+static size_t ring_size;
+static ino_t ring_ino;
+static uint64_t ring_checked_ns;
+static bool verbose;
+static volatile sig_atomic_t stop_requested;
+
+/* Request/reply buffers: one request is handled at a time */
+static union {
+	struct nct_broker_req req;
+	char raw[NCT_BROKER_REQ_MAX];
+} rx;
+static struct nct_broker_result results[NCT_BROKER_OPS_MAX];
+
+static void on_signal(int sig) {
+	(void)sig;
+	stop_requested = 1;
+}
+
+static uint64_t monotonic_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static bool attr_name_valid(const char *name) {
+	return name[0] != '\0' && name[0] != '.' && strchr(name, '/') == NULL;
+}
+
+/*
+ * attr_get() - Cached attribute, opened on first use
+ * HOW:  O_RDWR first; read-only attributes (tempN_input, 0444) fall back
+ *       to O_RDONLY so reads of them still work
+ * RETURNS: index into attrs[], or -ENOSPC when the table is full
+ */
+static int attr_get(const char *name) {
+	for (int i = 0; i < nattrs; ++i) {
+		if (strcmp(attrs[i].name, name) == 0) {
+			return i;
+		}
+	}
+	if (nattrs == MAX_ATTRS) {
+		return -ENOSPC;
+	}
+
+	struct attr *a = &attrs[nattrs];
+	snprintf(a->name, sizeof(a->name), "%s", name);
+	a->fd = openat(hwmon_fd, name, O_RDWR | O_CLOEXEC);
+	if (a->fd < 0 && errno == EACCES) {
+		a->fd = openat(hwmon_fd, name, O_RDONLY | O_CLOEXEC);
+	}
+	if (a->fd < 0) {
+		a->fd = -errno;
+	}
+	a->written_ns = 0;
+	return nattrs++;
+}
+
+static int attr_write(int idx, const char *value) {
+	struct attr *a = &attrs[idx];
+	if (a->fd < 0) {
+		return a->fd;
+	}
+	char buf[NCT_BROKER_VALUE_MAX + 1];
+	int len = snprintf(buf, sizeof(buf), "%s\n", value);
+	uint64_t t = nct_stats_begin();
+	ssize_t n = pwrite(a->fd, buf, (size_t)len, 0);
+	nct_stats_end(NCT_OP_SYSFS_WRITE, t);
+	count.writes++;
+	if (n < 0) {
+		return -errno;
+	}
+	a->written_ns = monotonic_ns();
+	return n == len ? 0 : -EIO;
+}
+
+static int attr_read(int idx, char *buf, size_t len) {
+	struct attr *a = &attrs[idx];
+	if (a->fd < 0) {
+		return a->fd;
+	}
+	uint64_t t = nct_stats_begin();
+	ssize_t n = pread(a->fd, buf, len - 1, 0);
+	nct_stats_end(NCT_OP_SYSFS_READ, t);
+	if (n < 0) {
+		return -errno;
+	}
+	buf[n] = '\0';
+	buf[strcspn(buf, "\n")] = '\0';
+	return 0;
+}
+
+/*
+ * ring_refresh() - Attach, or re-attach after a sampler restart
+ * WHY: A restarted sampler replaces the file (rename(2)); the old mapping
+ *      stays valid but is never written again
+ */
+static void ring_refresh(uint64_t now) {
+	if (ring && now - ring_checked_ns < RING_CHECK_NS) {
+		return;
+	}
+	ring_checked_ns = now;
+
+	struct stat st;
+	if (stat(ring_path, &st) < 0) {
+		if (ring) {
+			nct_ring_detach(ring, ring_size);
+			ring = NULL;
+		}
+	} else if (!ring || st.st_ino != ring_ino) {
+		size_t size;
+		const struct nct_ring_header *r = nct_ring_attach(ring_path, &size);
+		if (r) {
+			if (ring) {
+				nct_ring_detach(ring, ring_size);
+			}
+			ring = r;
+			ring_size = size;
+			ring_ino = st.st_ino;
+			if (verbose) {
+				fprintf(stderr, "[INFO] Attached %s: %u channels at %u Hz\n", ring_path, r->nchannels,
+					r->rate_hz);
+			}
+		}
+	}
+}
+
+/*
+ * cache_read() - Serve a read from the sampler ring if it is current
+ * IN:  snap, one copy of the newest sample per request (taken lazily)
+ * RETURNS: true with the value in buf; false to read sysfs instead
+ */
+static bool cache_read(const struct attr *a, struct nct_ring_sample *snap, int *snap_state, char *buf,
+		       size_t len) {
+	if (*snap_state == 0) {
+		uint64_t now = monotonic_ns();
+		ring_refresh(now);
+		*snap_state = -1;
+		if (ring && ring->rate_hz > 0 &&
+		    atomic_load_explicit(&ring->writer_pid, memory_order_acquire) != 0 &&
+		    nct_ring_latest(ring, snap) == 0 && now - snap->t_ns <= 2000000000ull / ring->rate_hz) {
+			*snap_state = 1;
+		}
+	}
+	if (*snap_state < 0 || snap->t_ns <= a->written_ns) {
+		return false;
+	}
+
+	for (uint32_t i = 0; i < ring->nchannels && i < snap->nvalues; ++i) {
+		if (strcmp(ring->channels[i].name, a->name) == 0) {
+			if (snap->values[i] == NCT_RING_INVALID) {
+				return false;
+			}
+			snprintf(buf, len, "%d", snap->values[i]);
+			return true;
+		}
+	}
+	return false;
+}
+
+/* "pwm3_auto_point1_temp" -> "pwm3", as nct-fan's attr_channel() */
+static void op_channel(const char *name, char *out, size_t len) {
+	size_t n = strcspn(name, "_");
+	if (n >= len) {
+		n = len - 1;
+	}
+	memcpy(out, name, n);
+	out[n] = '\0';
+}
+
+static int send_reply(struct client *c, uint32_t tag, int32_t status, uint32_t nops) {
+	struct nct_broker_reply reply = {
+		.magic = NCT_BROKER_MAGIC,
+		.version = NCT_BROKER_VERSION,
+		.status = status,
+		.tag = tag,
+	};
+	struct iovec iov[2] = {
+		{.iov_base = &reply, .iov_len = sizeof(reply)},
+		{.iov_base = results, .iov_len = status == 0 ? nops * sizeof(results[0]) : 0},
+	};
+	struct msghdr msg = {.msg_iov = iov, .msg_iovlen = 2};
+	/* A client that stopped reading is dropped rather than stalling everyone */
+	return sendmsg(c->fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT) < 0 ? -errno : 0;
+}
+
+static void client_close(struct client *c) {
+	close(c->fd);
+	c->fd = -1;
+	c->held = false;
+}
+
+/*
+ * flush() - Write every held attribute once and answer the held clients
+ * ORDER: attributes in the order they were first held
+ */
+static void flush(void) {
+	if (npending == 0) {
+		return;
+	}
+	for (int i = 0; i < npending; ++i) {
+		struct pending *p = &pending[i];
+		p->rc = p->attr < 0 ? p->attr : attr_write(p->attr, p->value);
+		if (p->rc < 0 && p->attr >= 0) {
+			fprintf(stderr, "[WARN] Cannot set %s=%s (%s)\n", attrs[p->attr].name, p->value, strerror(-p->rc));
+		}
+	}
+
+	for (int i = 0; i < nclients; ++i) {
+		struct client *c = &clients[i];
+		if (c->fd < 0 || !c->held) {
+			continue;
+		}
+		for (uint32_t k = 0; k < c->nops; ++k) {
+			const struct pending *p = &pending[c->held_ops[k].pending];
+			results[k] = (struct nct_broker_result){
+				.rc = p->rc,
+				.source = strcmp(c->held_ops[k].value, p->value) != 0 ? NCT_BROKER_SRC_MERGED
+										       : NCT_BROKER_SRC_SYSFS,
+			};
+		}
+		c->held = false;
+		if (send_reply(c, c->tag, 0, c->nops) < 0) {
+			client_close(c);
+		}
+	}
+	npending = 0;
+}
+
+/*
+ * hold() - Queue a coalescing request's writes for the next flush
+ * WHY: A controller rewriting pwmN every tick and a second one nudging
+ *      it in between cost one sysfs write per window, not one per request
+ */
+static void hold(struct client *c, const struct nct_broker_req *req, const struct nct_broker_op *ops,
+		 uint64_t now, uint32_t window_ms) {
+	if (npending + (int)req->nops > MAX_PENDING) {
+		flush();
+	}
+	if (npending == 0) {
+		flush_deadline_ns = now + (uint64_t)window_ms * 1000000;
+	}
+
+	for (uint32_t k = 0; k < req->nops; ++k) {
+		int idx = attr_get(ops[k].name);
+		int p = 0;
+		while (p < npending && (idx < 0 || pending[p].attr != idx)) {
+			p++;
+		}
+		if (p == npending) {
+			pending[npending++].attr = idx;
+		} else {
+			count.merged++;     /* the older value never reaches the chip */
+		}
+		snprintf(pending[p].value, sizeof(pending[p].value), "%s", ops[k].value);
+		c->held_ops[k].pending = p;
+		snprintf(c->held_ops[k].value, sizeof(c->held_ops[k].value), "%s", ops[k].value);
+	}
+	c->held = true;
+	c->tag = req->tag;
+	c->nops = req->nops;
+}
+
+/*
+ * execute() - Run one request's ops in order, as a unit
+ * STRATEGY: the nct-fan run_profile() rules: '?' failures are reported
+ *           only, a failed '!' skips the rest of its channel until an op
+ *           of another channel appears
+ */
+static void execute(const struct nct_broker_op *ops, uint32_t nops, uint16_t flags) {
+	struct nct_ring_sample snap;
+	int snap_state = flags & NCT_BROKER_F_UNCACHED ? -1 : 0;
+	char skip_channel[NCT_BROKER_NAME_MAX] = "";
+
+	for (uint32_t k = 0; k < nops; ++k) {
+		const struct nct_broker_op *op = &ops[k];
+		struct nct_broker_result *r = &results[k];
+		memset(r, 0, sizeof(*r));
+
+		char channel[NCT_BROKER_NAME_MAX];
+		op_channel(op->name, channel, sizeof(channel));
+		if (skip_channel[0] != '\0' && strcmp(channel, skip_channel) == 0) {
+			r->rc = -ECANCELED;
+			continue;
+		}
+		skip_channel[0] = '\0';
+
+		int idx = attr_name_valid(op->name) ? attr_get(op->name) : -EINVAL;
+		if (idx < 0) {
+			r->rc = idx;
+		} else if (op->op == NCT_BROKER_READ) {
+			count.reads++;
+			if (cache_read(&attrs[idx], &snap, &snap_state, r->value, sizeof(r->value))) {
+				r->source = NCT_BROKER_SRC_CACHE;
+				count.cached++;
+			} else {
+				r->rc = attr_read(idx, r->value, sizeof(r->value));
+			}
+		} else {
+			r->rc = attr_write(idx, op->value);
+		}
+		if (r->rc < 0 && op->op == NCT_BROKER_WRITE && op->flag == '!') {
+			snprintf(skip_channel, sizeof(skip_channel), "%s", channel);
+		}
+	}
+}
+
+static bool hwmon_matches(const char *dir) {
+	if (dir[0] == '\0' || strcmp(dir, hwmon_path) == 0 || strcmp(dir, hwmon_real) == 0) {
+		return true;
+	}
+	char real[PATH_MAX];
+	return realpath(dir, real) && strcmp(real, hwmon_real) == 0;
+}
+
+/*
+ * handle() - Validate and dispatch one received message
+ * RETURNS: status sent to the client (0 = executed or held)
+ */
+static int handle(struct client *c, size_t len, bool truncated, uint32_t window_ms) {
+	struct nct_broker_req *req = &rx.req;
+	struct nct_broker_op *ops = (struct nct_broker_op *)(rx.raw + sizeof(*req));
+	uint32_t tag = len >= sizeof(*req) ? req->tag : 0;
+	int status = 0;
+
+	count.requests++;
+	if (truncated) {
+		status = E2BIG;
+	} else if (len < sizeof(*req) || req->magic != NCT_BROKER_MAGIC || req->version != NCT_BROKER_VERSION ||
+		   req->nops == 0 || req->nops > NCT_BROKER_OPS_MAX || len != sizeof(*req) + req->nops * sizeof(*ops)) {
+		status = EPROTO;
+	} else {
+		req->hwmon[sizeof(req->hwmon) - 1] = '\0';
+		if (!hwmon_matches(req->hwmon)) {
+			status = EXDEV;
+		}
+	}
+
+	bool coalesce = status == 0 && (req->flags & NCT_BROKER_F_COALESCE) && req->nops <= NCT_BROKER_COALESCE_MAX;
+	uint32_t nwrites = 0;
+	for (uint32_t k = 0; status == 0 && k < req->nops; ++k) {
+		ops[k].name[sizeof(ops[k].name) - 1] = '\0';
+		ops[k].value[sizeof(ops[k].value) - 1] = '\0';
+		if (ops[k].op == NCT_BROKER_WRITE) {
+			nwrites++;
+			coalesce = coalesce && ops[k].flag == ' ' && attr_name_valid(ops[k].name);
+		} else if (ops[k].op == NCT_BROKER_READ) {
+			coalesce = false;
+		} else {
+			status = EPROTO;
+		}
+	}
+	if (status == 0 && nwrites > 0 && !c->may_write) {
+		status = EPERM;
+	}
+
+	if (status != 0) {
+		count.refused++;
+		fprintf(stderr, "[WARN] Refused request from pid %d: %s\n", (int)c->pid, strerror(status));
+		return send_reply(c, tag, status, 0) < 0 ? -1 : status;
+	}
+	if (verbose) {
+		fprintf(stderr, "[INFO] pid %d: %u ops, %u writes%s\n", (int)c->pid, req->nops, nwrites,
+			coalesce ? " (coalesced)" : "");
+	}
+
+	uint64_t now = monotonic_ns();
+	if (coalesce) {
+		hold(c, req, ops, now, window_ms);
+		return 0;
+	}
+	flush();
+	execute(ops, req->nops, req->flags);
+	return send_reply(c, tag, 0, req->nops) < 0 ? -1 : 0;
+}
+
+static void client_accept(int listen_fd) {
+	int fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+	if (fd < 0) {
+		return;
+	}
+	struct ucred cred;
+	socklen_t len = sizeof(cred);
+	if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) < 0) {
+		close(fd);
+		return;
+	}
+
+	int slot = 0;
+	while (slot < nclients && clients[slot].fd >= 0) {
+		slot++;
+	}
+	if (slot == MAX_CLIENTS) {
+		fprintf(stderr, "[WARN] More than %d clients; refusing pid %d\n", MAX_CLIENTS, (int)cred.pid);
+		close(fd);
+		return;
+	}
+	clients[slot] = (struct client){.fd = fd, .pid = cred.pid, .may_write = cred.uid == NCT_BROKER_WRITER_UID};
+	if (slot == nclients) {
+		nclients++;
+	}
+}
+
+static void client_recv(struct client *c, uint32_t window_ms) {
+	ssize_t n = recv(c->fd, rx.raw, sizeof(rx.raw), MSG_TRUNC | MSG_DONTWAIT);
+	if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+		return;
+	}
+	if (n <= 0) {
+		client_close(c);   /* a held request's writes still happen at the flush */
+		return;
+	}
+	if (c->held) {
+		/* One outstanding request per client; nct_broker_call() never pipelines */
+		count.refused++;
+		client_close(c);
+		return;
+	}
+	if (handle(c, (size_t)n, (size_t)n > sizeof(rx.raw), window_ms) < 0) {
+		client_close(c);
+	}
+}
+
+/*
+ * listen_socket() - Create the listening socket, replacing a stale one
+ * WHY: A crashed broker leaves its socket file behind; a live one still
+ *      accepts, and must not be replaced
+ */
+static int listen_socket(const char *path) {
+	int probe = nct_broker_connect(path);
+	if (probe >= 0) {
+		close(probe);
+		fprintf(stderr, "[ERROR] A broker is already listening on %s\n", path);
+		return -1;
+	}
+
+	struct sockaddr_un addr = {.sun_family = AF_UNIX};
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		fprintf(stderr, "[ERROR] Socket path too long: %s\n", path);
+		return -1;
+	}
+	memcpy(addr.sun_path, path, strlen(path) + 1);
+	unlink(path);
+
+	int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+	if (fd < 0 || bind(fd, (const struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+	    chmod(path, 0666) < 0 || listen(fd, 16) < 0) {
+		fprintf(stderr, "[ERROR] Cannot listen on %s: %s\n", path, strerror(errno));
+		if (fd >= 0) {
+			close(fd);
+		}
+		return -1;
+	}
+	return fd;
+}
+
+static void usage(FILE *out, const char *prog) {
+	fprintf(out,
+		"Usage: %s [--socket PATH] [--hwmon DIR] [--ring PATH] [--window MS] [--verbose] [--stats]\n"
+		"  --socket PATH  listening socket (default %s)\n"
+		"  --hwmon DIR    NCT67xx hwmon directory (default: resolve)\n"
+		"  --ring PATH    sampler ring for cached reads (default %s)\n"
+		"  --window MS    coalescing window, 0-%d (default %d)\n"
+		"  --verbose      log every request\n"
+		"  --stats        print per-operation latency histograms on exit\n",
+		prog, nct_broker_path(), NCT_RING_PATH, WINDOW_MAX, WINDOW_DEFAULT);
+}
+
+/*
+ * main() - Entry point
+ * STRATEGY:
+ *   1. Resolve and open the hwmon directory, create the socket
+ *   2. poll() loop: accept, read and execute requests; the timeout is the
+ *      flush deadline while writes are held, infinite otherwise
+ *   3. On SIGINT/SIGTERM flush held writes, remove the socket, summarize
+ */
+int main(int argc, char **argv) {
+	static const struct option longopts[] = {
+		{"socket", required_argument, NULL, 'S'},
+		{"hwmon", required_argument, NULL, 'H'},
+		{"ring", required_argument, NULL, 'r'},
+		{"window", required_argument, NULL, 'w'},
+		{"verbose", no_argument, NULL, 'v'},
+		{"stats", no_argument, NULL, 's'},
+		{"help", no_argument, NULL, 'h'},
+		{NULL, 0, NULL, 0},
+	};
+
+	const char *socket_path = nct_broker_path();
+	long window_ms = WINDOW_DEFAULT;
+	bool show_stats = false;
+
+	int opt;
+	while ((opt = getopt_long(argc, argv, "S:H:r:w:vsh", longopts, NULL)) != -1) {
+		switch (opt) {
+		case 'S':
+			socket_path = optarg;
+			break;
+		case 'H':
+			snprintf(hwmon_path, sizeof(hwmon_path), "%s", optarg);
+			break;
+		case 'r':
+			ring_path = optarg;
+			break;
+		case 'w': {
+			char *end;
+			window_ms = strtol(optarg, &end, 10);
+			if (*end || window_ms < 0 || window_ms > WINDOW_MAX) {
+				fprintf(stderr, "[ERROR] --window must be 0-%d ms\n", WINDOW_MAX);
+				return 2;
+			}
+			break;
+		}
+		case 'v':
+			verbose = true;
+			break;
+		case 's':
+			show_stats = true;
+			break;
+		case 'h':
+			usage(stdout, argv[0]);
+			return 0;
+		default:
+			usage(stderr, argv[0]);
+			return 2;
+		}
+	}
+
+	if (!hwmon_path[0]) {
+		struct hwmon_resolution res;
+		if (hwmon_resolve(&res, 0) < 0) {
+			fprintf(stderr, "[ERROR] No %s* hwmon device under %s (is nct6775 loaded?)\n", HWMON_NAME_PREFIX,
+				HWMON_CLASS_PATH);
+			return 2;
+		}
+		snprintf(hwmon_path, sizeof(hwmon_path), "%s", res.hwmon);
+	}
+	hwmon_fd = open(hwmon_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (hwmon_fd < 0 || !realpath(hwmon_path, hwmon_real)) {
+		fprintf(stderr, "[ERROR] Cannot open hwmon directory %s: %s\n", hwmon_path, strerror(errno));
+		return 2;
+	}
+
+	int listen_fd = listen_socket(socket_path);
+	if (listen_fd < 0) {
+		close(hwmon_fd);
+		return 2;
+	}
+
+	struct sigaction sa = {.sa_handler = on_signal};
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+
+	ring_refresh(monotonic_ns());
+	fprintf(stderr, "[INFO] Brokering %s on %s (window %ld ms, ring %s)\n", hwmon_path, socket_path, window_ms,
+		ring ? "attached" : "absent");
+
+	static struct pollfd pfd[MAX_CLIENTS + 1];
+	static int pfd_client[MAX_CLIENTS + 1];
+	while (!stop_requested) {
+		int n = 0;
+		pfd[n++] = (struct pollfd){.fd = listen_fd, .events = POLLIN};
+		for (int i = 0; i < nclients; ++i) {
+			if (clients[i].fd >= 0) {
+				pfd_client[n] = i;
+				pfd[n++] = (struct pollfd){.fd = clients[i].fd, .events = POLLIN};
+			}
+		}
+
+		int timeout = -1;
+		if (npending > 0) {
+			uint64_t now = monotonic_ns();
+			timeout = now >= flush_deadline_ns ? 0 : (int)((flush_deadline_ns - now + 999999) / 1000000);
+		}
+		int ready = poll(pfd, (nfds_t)n, timeout);
+		if (ready < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			fprintf(stderr, "[ERROR] poll: %s\n", strerror(errno));
+			break;
+		}
+
+		for (int i = 1; i < n; ++i) {
+			if (pfd[i].revents) {
+				client_recv(&clients[pfd_client[i]], (uint32_t)window_ms);
+			}
+		}
+		if (pfd[0].revents & POLLIN) {
+			client_accept(listen_fd);
+		}
+		if (npending > 0 && monotonic_ns() >= flush_deadline_ns) {
+			flush();
+		}
+	}
+
+	flush();
+	for (int i = 0; i < nclients; ++i) {
+		if (clients[i].fd >= 0) {
+			close(clients[i].fd);
+		}
+	}
+	close(listen_fd);
+	unlink(socket_path);
+	for (int i = 0; i < nattrs; ++i) {
+		if (attrs[i].fd >= 0) {
+			close(attrs[i].fd);
+		}
+	}
+	close(hwmon_fd);
+	if (ring) {
+		nct_ring_detach(ring, ring_size);
+	}
+
+	fprintf(stderr, "[INFO] requests=%llu refused=%llu reads=%llu cached=%llu writes=%llu merged=%llu\n",
+		(unsigned long long)count.requests, (unsigned long long)count.refused,
+		(unsigned long long)count.reads, (unsigned long long)count.cached,
+		(unsigned long long)count.writes, (unsigned long long)count.merged);
+	if (show_stats) {
+		nct_stats_print(stderr, &nct_stats);
+	}
+	return 0;
+}
+
+/*
+ * BUILD & DEPLOYMENT NOTES:
+ *
+ * Compilation:
+ *   gcc -std=c23 -O2 -Wall -Wextra -Werror -o nct-broker \
+ *       nct-broker.c nct-hwmon.c nct-stats.c
+ *
+ * Installation (in PKGBUILD):
+ *   install -Dm755 nct-broker "$pkgdir/usr/lib/eirikr/nct-broker"
+ *   install -Dm644 nct-broker.h "$pkgdir/usr/include/eirikr/nct-broker.h"
+ *   nct-broker.service starts it before max-fans.service,
+ *   max-fans-restore.service and nct-fanctl.service
+ *
+ * Clients:
+ *   nct-fan --apply / --reconcile send the whole profile as one request
+ *   (reconcile: one read request, then one write request); nct-fanctl
+ *   sends its duty writes with NCT_BROKER_F_COALESCE and its mode
+ *   changes as ordinary requests. Both write sysfs directly when the
+ *   socket is missing, the broker owns another device (EXDEV), or
+ *   --direct is given.
+ *
+ * Cost model:
+ *   One request is one sendmsg()/recvmsg() pair on each side. A reconcile
+ *   run reads ~130 attributes; the ring channels among them (pwmN,
+ *   pwmN_enable) cost no sysfs read while nct-sampler runs. Two
+ *   controllers writing one duty every tick issue one sysfs write per
+ *   window between them.
+ */
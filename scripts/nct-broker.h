@@ -0,0 +1,226 @@
+/*
+ * nct-broker.h - Request/reply protocol of the nct-broker hwmon owner
+ *
+ * PURPOSE:
+ *   Message layouts and a small blocking client shared by `nct-broker`
+ *   (the one process that writes the chip) and its clients: nct-fan (and
+ *   through it max-fans*.sh, max-fans-restore.service, the sleep hook and
+ *   nct-agent) and nct-fanctl.
+ *
+ * WHY A BROKER:
+ *   Every tool used to open pwmN / pwmN_enable itself. A restore run
+ *   gating a header (pwmN_enable=0 ... pwmN_enable=5) while nct-fanctl
+ *   wrote a duty, or an admin ran max-fans-enhanced.sh, interleaved their
+ *   writes and showed up as fan dropouts. The broker executes each request
+ *   as a unit, so a gate sequence can no longer be split by another tool.
+ *
+ * TRANSPORT:
+ *   AF_UNIX SOCK_SEQPACKET at NCT_BROKER_PATH ($NCT_BROKER_SOCKET
+ *   overrides it): one request per message, one reply per request, in
+ *   order. Message boundaries are the framing; there is no length prefix.
+ *
+ *   client -> broker  struct nct_broker_req, then nops struct nct_broker_op
+ *   broker -> client  struct nct_broker_reply, then nops struct
+ *                     nct_broker_result (none if status != 0)
+ *
+ * REQUEST SEMANTICS:
+ *   - Ops run in order and no other client's op runs in between
+ *   - WRITE flags are the nct-fan PROFILE FORMAT flags: ' ' required,
+ *     '?' optional, '!' gate; after a failed gate the remaining ops of the
+ *     same channel (pwmN / fanN) are skipped with -ECANCELED
+ *   - READ is answered from the nct-sampler ring (nct-ring.h) when the
+ *     attribute is a ring channel, the newest sample is at most two sample
+ *     periods old and was taken after the broker's last write to it;
+ *     otherwise from sysfs. NCT_BROKER_F_UNCACHED forces sysfs
+ *   - NCT_BROKER_F_COALESCE (plain writes only, at most
+ *     NCT_BROKER_COALESCE_MAX ops): the client asserts only the newest
+ *     value matters (a controller's duty). Such writes are held for the
+ *     broker's window; each attribute is then written once with the newest
+ *     value, and every held request is answered with that write's result
+ *     (source NCT_BROKER_SRC_MERGED if its value was superseded). Any
+ *     other request first flushes the held writes, so ordering between
+ *     coalesced and sequenced requests is preserved
+ *   - hwmon names the directory the client resolved; a broker that owns
+ *     a different device answers EXDEV and the client writes directly
+ *   - Only uid 0 (NCT_BROKER_WRITER_UID) may write (SO_PEERCRED); other
+ *     clients get EPERM
+ *
+ * BYTE ORDER:
+ *   Native; both ends are on the same host.
+ */
+
+#ifndef NCT_BROKER_H
+#define NCT_BROKER_H
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define NCT_BROKER_PATH          "/run/nct-broker.sock"
+#define NCT_BROKER_MAGIC         0x4B52424Eu          /* "NBRK" */
+#define NCT_BROKER_VERSION       1
+#define NCT_BROKER_OPS_MAX       1024                 /* == NCT_PLAN_MAX */
+#define NCT_BROKER_COALESCE_MAX  16
+#define NCT_BROKER_NAME_MAX      64                   /* == NCT_PLAN_NAME_MAX */
+#define NCT_BROKER_VALUE_MAX     33                   /* == NCT_PLAN_VALUE_MAX */
+#define NCT_BROKER_HWMON_MAX     256                  /* == HWMON_PATH_MAX */
+#define NCT_BROKER_TIMEOUT_MS    5000                 /* client receive timeout */
+
+/* The uid allowed to write; tests/emu builds the broker with its own */
+#ifndef NCT_BROKER_WRITER_UID
+#define NCT_BROKER_WRITER_UID    0
+#endif
+
+enum nct_broker_op_type {
+	NCT_BROKER_READ = 1,
+	NCT_BROKER_WRITE,
+};
+
+enum nct_broker_flag {
+	NCT_BROKER_F_COALESCE = 1 << 0,
+	NCT_BROKER_F_UNCACHED = 1 << 1,
+};
+
+enum nct_broker_source {
+	NCT_BROKER_SRC_SYSFS = 0,       /* read or written through sysfs */
+	NCT_BROKER_SRC_CACHE,           /* read from the sampler ring */
+	NCT_BROKER_SRC_MERGED,          /* write superseded by a newer value */
+};
+
+struct nct_broker_req {
+	uint32_t magic;                 /* NCT_BROKER_MAGIC */
+	uint16_t version;               /* NCT_BROKER_VERSION */
+	uint16_t flags;                 /* enum nct_broker_flag */
+	uint32_t nops;                  /* <= NCT_BROKER_OPS_MAX */
+	uint32_t tag;                   /* echoed in the reply */
+	char hwmon[NCT_BROKER_HWMON_MAX]; /* client's device, "" = whatever the broker owns */
+};
+
+struct nct_broker_op {
+	uint8_t op;                     /* enum nct_broker_op_type */
+	char flag;                      /* WRITE: ' ', '?' or '!' */
+	char name[NCT_BROKER_NAME_MAX]; /* plain attribute name, no '/' */
+	char value[NCT_BROKER_VALUE_MAX]; /* WRITE: decimal value */
+	char reserved[29];
+};
+
+struct nct_broker_reply {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t reserved;
+	int32_t status;                 /* 0, or errno for the whole request */
+	uint32_t tag;
+};
+
+struct nct_broker_result {
+	int32_t rc;                     /* 0 or -errno; -ECANCELED = skipped */
+	uint8_t source;                 /* enum nct_broker_source */
+	char value[NCT_BROKER_VALUE_MAX]; /* READ: trimmed text */
+	char reserved[10];
+};
+
+_Static_assert(sizeof(struct nct_broker_op) == 128, "ops are fixed 128-byte records");
+_Static_assert(sizeof(struct nct_broker_result) == 48, "results are fixed 48-byte records");
+
+/* Largest request: fits the default AF_UNIX send buffer (net.core.wmem_default) */
+#define NCT_BROKER_REQ_MAX (sizeof(struct nct_broker_req) + NCT_BROKER_OPS_MAX * sizeof(struct nct_broker_op))
+
+static inline const char *nct_broker_path(void) {
+	const char *p = getenv("NCT_BROKER_SOCKET");
+	return p && p[0] ? p : NCT_BROKER_PATH;
+}
+
+/*
+ * nct_broker_connect() - Connect to a running broker
+ * RETURNS: socket fd, or -errno; -ENOENT / -ECONNREFUSED mean no broker
+ *          is running and the caller should write sysfs directly
+ */
+static inline int nct_broker_connect(const char *path) {
+	struct sockaddr_un addr = {.sun_family = AF_UNIX};
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		return -ENAMETOOLONG;
+	}
+	memcpy(addr.sun_path, path, strlen(path) + 1);
+
+	int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		return -errno;
+	}
+	struct timeval tv = {.tv_sec = NCT_BROKER_TIMEOUT_MS / 1000, .tv_usec = NCT_BROKER_TIMEOUT_MS % 1000 * 1000};
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	if (connect(fd, (const struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		int err = errno;
+		close(fd);
+		return -err;
+	}
+	return fd;
+}
+
+/*
+ * nct_broker_call() - Send one request and wait for its reply
+ * IN:  hwmon as resolved by the caller (may be NULL); ops[nops]
+ * OUT: res[nops], valid only when 0 is returned
+ * RETURNS: 0, -errno on a transport failure, or -status the broker
+ *          refused the whole request with (-EPERM, -EXDEV, -E2BIG)
+ */
+static inline int nct_broker_call(int fd, const char *hwmon, uint16_t flags, const struct nct_broker_op *ops,
+				  uint32_t nops, struct nct_broker_result *res) {
+	static uint32_t next_tag;
+	if (nops == 0 || nops > NCT_BROKER_OPS_MAX) {
+		return -E2BIG;
+	}
+
+	struct nct_broker_req req = {
+		.magic = NCT_BROKER_MAGIC,
+		.version = NCT_BROKER_VERSION,
+		.flags = flags,
+		.nops = nops,
+		.tag = ++next_tag,
+	};
+	snprintf(req.hwmon, sizeof(req.hwmon), "%s", hwmon ? hwmon : "");
+
+	struct iovec out[2] = {
+		{.iov_base = &req, .iov_len = sizeof(req)},
+		{.iov_base = (void *)ops, .iov_len = nops * sizeof(*ops)},
+	};
+	struct msghdr msg = {.msg_iov = out, .msg_iovlen = 2};
+	if (sendmsg(fd, &msg, MSG_NOSIGNAL) < 0) {
+		return -errno;
+	}
+
+	struct nct_broker_reply reply;
+	struct iovec in[2] = {
+		{.iov_base = &reply, .iov_len = sizeof(reply)},
+		{.iov_base = res, .iov_len = nops * sizeof(*res)},
+	};
+	msg = (struct msghdr){.msg_iov = in, .msg_iovlen = 2};
+	ssize_t n = recvmsg(fd, &msg, 0);
+	if (n < 0) {
+		return errno == EAGAIN ? -ETIMEDOUT : -errno;
+	}
+	if ((size_t)n < sizeof(reply) || reply.magic != NCT_BROKER_MAGIC || reply.tag != req.tag) {
+		return -EPROTO;
+	}
+	if (reply.status != 0) {
+		return -reply.status;
+	}
+	return (size_t)n == sizeof(reply) + nops * sizeof(*res) ? 0 : -EPROTO;
+}
+
+/* Fill one op; values longer than the field are the caller's bug and are cut */
+static inline void nct_broker_op_set(struct nct_broker_op *op, uint8_t type, char flag, const char *name,
+				     const char *value) {
+	memset(op, 0, sizeof(*op));
+	op->op = type;
+	op->flag = flag;
+	snprintf(op->name, sizeof(op->name), "%s", name);
+	snprintf(op->value, sizeof(op->value), "%s", value ? value : "");
+}
+
+#endif /* NCT_BROKER_H */
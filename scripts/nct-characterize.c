@@ -0,0 +1,784 @@
+/*
+ * nct-characterize.c - Parallel fan characterization sweep for NCT6798D headers
+ *
+ * PURPOSE:
+ *   Measure every fan header's response in one run: settled RPM per duty
+ *   step, the stall duty (lowest duty that keeps a spinning fan turning),
+ *   the start duty (lowest duty that starts a stopped fan) and whether the
+ *   reported RPM suggests a wrong fanN_pulses setting. The result is a
+ *   model file nct-profile reads (start = auto, floor = auto, pulses = auto).
+ *
+ * WHY THIS EXISTS:
+ *   pwmN_start / pwmN_floor for set_thermal_cruise() and fanN_pulses for
+ *   set_tachometry() are chosen by guesswork, because measuring them by
+ *   hand takes a fixed duty, a wait, an RPM reading, per step, per header:
+ *   hours per chassis type. Here all headers run at once and the whole
+ *   sweep takes a few minutes.
+ *
+ * HOW:
+ *   1. Save each header's pwmN_enable/pwmN, switch it to manual (1)
+ *   2. Run two passes over the duty steps per header: descending (finds
+ *      the stall duty) and ascending (finds the start duty)
+ *   3. Hold each step for --hold MS; the fan's RPM is sampled every 250 ms
+ *      during the second half of the hold and the median is the settled
+ *      value (marked unsettled when the window spreads more than 5 %)
+ *   4. Restore every header, analyse, write the model atomically
+ *
+ * STAGGERED SCHEDULE (why parallel headers do not skew each other):
+ *   Fans share the chassis airflow: a neighbour ramping up pushes air
+ *   through a slow fan and raises its RPM, a neighbour stopping lowers
+ *   the pressure it works against. Two measures keep that coupling out of
+ *   the readings:
+ *   - Header k's step boundaries are offset by k * hold / nheaders, so at
+ *     most one header changes duty at a time and no change lands in
+ *     another header's settle window at the same instant
+ *   - Even headers run descending-then-ascending, odd headers
+ *     ascending-then-descending, so at every point of the sweep half the
+ *     fans are fast and half slow and the total airflow stays roughly
+ *     constant instead of every fan ramping down together
+ *
+ * MODEL FORMAT (default /var/lib/eirikr/nct-fan.model, nct-profile syntax):
+ *   [pwmN]
+ *   fan = N                   tachometer measured (fanN_input)
+ *   connected = yes|no        no: nothing turned at full duty
+ *   responds = yes|no         no: RPM did not follow duty (3-pin fan on a
+ *                             header in PWM mode, or another header's fan)
+ *   stall_duty = D            lowest duty that kept it turning (descending)
+ *   start_duty = D            lowest duty that started it from rest
+ *   max_rpm = R
+ *   pulses = P                fanN_pulses during the sweep (0 = unknown)
+ *   pulses_suggested = P      PPR that makes max_rpm match --rated; without
+ *                             --rated always = pulses (nct-profile's
+ *                             pulses = auto must not act on a guess)
+ *   ppr_check = ok|suspect    suspect: pulses_suggested != pulses, or (no
+ *                             --rated) max_rpm outside 300-3600 RPM; the
+ *                             comment names the PPR that would fit
+ *   rpm_down = D:R, ...       settled RPM per step, descending pass
+ *   rpm_up = D:R, ...         ascending pass
+ *
+ * USAGE:
+ *   sudo nct-characterize [--hwmon DIR] [--headers LIST] [--hold MS]
+ *                         [--steps D,D,...] [--rated N:RPM]... [--max-temp C]
+ *                         [-o MODEL]
+ *     --headers LIST  e.g. 1-6 or 1,2,5 (default: every pwmN with a fanN_input)
+ *     --hold MS       time per duty step, 1000-60000 (default 5000)
+ *     --steps LIST    duty steps, any order (default 255 down to 0, finer
+ *                     below 64 where fans stall)
+ *     --rated N:RPM   fanN's rated maximum RPM (datasheet); makes the PPR
+ *                     check exact instead of a plausibility range
+ *     --max-temp C    abort and restore if any chip temperature exceeds C
+ *                     (default 85)
+ *   Then: nct-profile --compile PROFILE with `model = MODEL` and
+ *   start/floor/pulses = auto (see nct-profile.c)
+ *
+ * SAFETY / CAVEATS:
+ *   - Fans run down to duty 0 for one hold each; run it with the machine
+ *     idle. Any chip temperature above --max-temp aborts the sweep
+ *   - SIGINT/SIGTERM restore every header's saved mode and duty
+ *   - pwmN is assumed to drive fanN (true on the ASUS B550 boards); a
+ *     header whose fan does not follow its duty is reported responds = no
+ *   - Stop nct-fanctl first; it would fight the sweep for manual headers
+ */
+
+#define _GNU_SOURCE
+#include "nct-hwmon.h"
+#include "nct-rt.h"
+#include "nct-stats.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_MODEL    "/var/lib/eirikr/nct-fan.model"
+#define MAX_HEADERS      7
+#define MAX_STEPS        32
+#define MAX_TEMPS        16
+#define MAX_CHANNELS     128
+#define TEMP_OPEN_MC     127000  /* open thermistor input: reads +127 C, not a hot chip */
+#define HOLD_MIN         1000
+#define HOLD_MAX         60000
+#define HOLD_DEFAULT     5000
+#define POLL_MS          250
+#define MAX_WINDOW       ((HOLD_MAX / 2) / POLL_MS + 1)
+#define RPM_STOPPED      50      /* below this a fan counts as stopped */
+#define SETTLE_PCT       5       /* settle window spread tolerance */
+#define RESPOND_PCT      80      /* slowest spinning step below this % of max: responds */
+#define RPM_PLAUSIBLE_MIN 300    /* PPR heuristic without --rated */
+#define RPM_PLAUSIBLE_MAX 3600
+#define MAX_TEMP_DEFAULT 85
+
+static const int default_steps[] = {255, 224, 192, 160, 128, 112, 96, 80, 64, 56, 48, 40, 32, 24, 16, 8, 0};
+static const int valid_pulses[] = {1, 2, 3, 4, 5, 8};
+
+struct step_result {
+	int duty;
+	int rpm;
+	bool settled;
+	bool measured;
+};
+
+/*
+ * struct chan - One header under test: pwmN, its fanN tach, sweep state
+ * res[0] is the descending pass, res[1] the ascending one, in visit order
+ */
+struct chan {
+	int index;
+	int pwm_fd, enable_fd, fan_fd;
+	char saved_enable[16], saved_pwm[16];
+	bool took_over;
+	int pulses;
+	int rated;
+	bool descending_first;
+	uint64_t phase_ns;
+	long step;                          /* global step number, -1 = not started */
+	int32_t win[MAX_WINDOW];
+	int nwin;
+	struct step_result res[2][MAX_STEPS];
+};
+
+struct model {
+	bool connected, responds, ppr_suspect;
+	int stall, start, max_rpm, suggested;
+	int hint;                   /* no --rated: PPR bringing max_rpm in range, 0 = none */
+	const char *ppr_basis;
+};
+
+static struct chan chans[MAX_HEADERS];
+static int nchans;
+static int steps[MAX_STEPS];
+static int nsteps;
+static int hold_ms = HOLD_DEFAULT;
+static volatile sig_atomic_t stop_requested;
+
+static void on_signal(int sig) {
+	(void)sig;
+	stop_requested = 1;
+}
+
+static int fd_read_text(int fd, char *buf, size_t len) {
+	ssize_t n = pread(fd, buf, len - 1, 0);
+	if (n <= 0) {
+		return -1;
+	}
+	buf[n] = '\0';
+	buf[strcspn(buf, "\n")] = '\0';
+	return 0;
+}
+
+static int fd_write_int(int fd, int value) {
+	char buf[16];
+	int len = snprintf(buf, sizeof(buf), "%d\n", value);
+	uint64_t t = nct_stats_begin();
+	ssize_t n = pwrite(fd, buf, (size_t)len, 0);
+	nct_stats_end(NCT_OP_SYSFS_WRITE, t);
+	return n == len ? 0 : -1;
+}
+
+/*
+ * parse_list() - "1-6", "1,2,5" or "255,128,0" into out[]
+ * RETURNS: number of values, or -1 (malformed, out of [min, max], too many)
+ */
+static int parse_list(const char *arg, int min, int max, int *out, int cap) {
+	int n = 0;
+	const char *p = arg;
+	while (*p) {
+		char *end;
+		long a = strtol(p, &end, 10);
+		long b = a;
+		if (end == p) {
+			return -1;
+		}
+		if (*end == '-') {
+			p = end + 1;
+			b = strtol(p, &end, 10);
+			if (end == p) {
+				return -1;
+			}
+		}
+		if (a < min || b > max || b < a) {
+			return -1;
+		}
+		for (long v = a; v <= b; ++v) {
+			if (n == cap) {
+				return -1;
+			}
+			out[n++] = (int)v;
+		}
+		if (*end == ',') {
+			end++;
+		} else if (*end) {
+			return -1;
+		}
+		p = end;
+	}
+	return n;
+}
+
+static int cmp_desc(const void *a, const void *b) {
+	return *(const int *)b - *(const int *)a;
+}
+
+static int cmp_int(const void *a, const void *b) {
+	return *(const int *)a - *(const int *)b;
+}
+
+/*
+ * chan_open() - Open pwmN/pwmN_enable/fanN_input, save, take manual control
+ */
+static int chan_open(int dirfd, struct chan *c) {
+	char attr[HWMON_ATTR_MAX];
+
+	snprintf(attr, sizeof(attr), "pwm%d", c->index);
+	c->pwm_fd = openat(dirfd, attr, O_RDWR | O_CLOEXEC);
+	snprintf(attr, sizeof(attr), "pwm%d_enable", c->index);
+	c->enable_fd = openat(dirfd, attr, O_RDWR | O_CLOEXEC);
+	snprintf(attr, sizeof(attr), "fan%d_input", c->index);
+	c->fan_fd = openat(dirfd, attr, O_RDONLY | O_CLOEXEC);
+	if (c->pwm_fd < 0 || c->enable_fd < 0 || c->fan_fd < 0 ||
+	    fd_read_text(c->enable_fd, c->saved_enable, sizeof(c->saved_enable)) < 0 ||
+	    fd_read_text(c->pwm_fd, c->saved_pwm, sizeof(c->saved_pwm)) < 0) {
+		fprintf(stderr, "[ERROR] Cannot open pwm%d/pwm%d_enable/fan%d_input: %s\n", c->index, c->index, c->index,
+			strerror(errno));
+		return -1;
+	}
+
+	snprintf(attr, sizeof(attr), "fan%d_pulses", c->index);
+	int pfd = openat(dirfd, attr, O_RDONLY | O_CLOEXEC);
+	char buf[16];
+	if (pfd >= 0 && fd_read_text(pfd, buf, sizeof(buf)) == 0) {
+		c->pulses = atoi(buf);
+	}
+	if (pfd >= 0) {
+		close(pfd);
+	}
+
+	if (fd_write_int(c->enable_fd, 1) < 0) {
+		fprintf(stderr, "[ERROR] Cannot switch pwm%d to manual mode: %s\n", c->index, strerror(errno));
+		return -1;
+	}
+	c->took_over = true;
+	return 0;
+}
+
+/*
+ * chan_restore() - Duty first, then mode (same order as nct-fanctl)
+ */
+static void chan_restore(struct chan *c) {
+	if (c->took_over) {
+		if (strcmp(c->saved_enable, "1") == 0) {
+			fd_write_int(c->pwm_fd, atoi(c->saved_pwm));
+		}
+		if (fd_write_int(c->enable_fd, atoi(c->saved_enable)) < 0) {
+			fprintf(stderr, "[WARN] Cannot restore pwm%d_enable=%s: %s\n", c->index, c->saved_enable, strerror(errno));
+		}
+	}
+	int *fds[] = {&c->pwm_fd, &c->enable_fd, &c->fan_fd};
+	for (size_t i = 0; i < sizeof(fds) / sizeof(fds[0]); ++i) {
+		if (*fds[i] >= 0) {
+			close(*fds[i]);
+			*fds[i] = -1;
+		}
+	}
+}
+
+/* Global step number -> (pass, position in that pass, duty) */
+static int step_duty(const struct chan *c, long step, int *dir, int *pos) {
+	int pass = (int)(step / nsteps);
+	*pos = (int)(step % nsteps);
+	*dir = c->descending_first ? pass : 1 - pass;   /* 0 = descending */
+	return *dir == 0 ? steps[*pos] : steps[nsteps - 1 - *pos];
+}
+
+/*
+ * chan_finish_step() - Median of the settle window into the step's result
+ */
+static void chan_finish_step(struct chan *c) {
+	int dir, pos;
+	int duty = step_duty(c, c->step, &dir, &pos);
+	struct step_result *r = &c->res[dir][pos];
+
+	r->duty = duty;
+	r->measured = c->nwin > 0;
+	if (c->nwin > 0) {
+		qsort(c->win, (size_t)c->nwin, sizeof(c->win[0]), cmp_int);
+		r->rpm = c->win[c->nwin / 2];
+		int32_t spread = c->win[c->nwin - 1] - c->win[0];
+		r->settled = spread * 100 <= r->rpm * SETTLE_PCT || c->win[c->nwin - 1] < RPM_STOPPED;
+	}
+	c->nwin = 0;
+}
+
+/*
+ * chan_tick() - Advance the header's schedule, sample in the settle window
+ * RETURNS: true once both passes are done
+ */
+static bool chan_tick(struct chan *c, uint64_t elapsed_ns) {
+	uint64_t hold_ns = (uint64_t)hold_ms * 1000000;
+	long total = 2L * nsteps;
+
+	if (elapsed_ns < c->phase_ns) {
+		return false;
+	}
+	long step = (long)((elapsed_ns - c->phase_ns) / hold_ns);
+	if (step != c->step) {
+		if (c->step >= 0) {
+			chan_finish_step(c);
+		}
+		c->step = step;
+		if (step >= total) {
+			return true;
+		}
+		int dir, pos;
+		int duty = step_duty(c, step, &dir, &pos);
+		if (fd_write_int(c->pwm_fd, duty) < 0) {
+			fprintf(stderr, "[WARN] pwm%d: cannot write duty %d: %s\n", c->index, duty, strerror(errno));
+		}
+	}
+	if (step >= total) {
+		return true;
+	}
+
+	uint64_t in_step = (elapsed_ns - c->phase_ns) % hold_ns;
+	int32_t rpm;
+	if (in_step >= hold_ns / 2 && c->nwin < MAX_WINDOW && hwmon_read_int(c->fan_fd, &rpm) == 0) {
+		c->win[c->nwin++] = rpm;
+	}
+	return false;
+}
+
+static int snap_pulses(double want) {
+	int best = valid_pulses[0];
+	for (size_t i = 1; i < sizeof(valid_pulses) / sizeof(valid_pulses[0]); ++i) {
+		double d = want - valid_pulses[i];
+		double b = want - best;
+		if (d * d < b * b) {
+			best = valid_pulses[i];
+		}
+	}
+	return best;
+}
+
+/*
+ * analyse() - Stall/start duty, response and PPR plausibility for a header
+ * STALL: walk the descending pass in visit order; the last duty that still
+ *        turned before the first stopped step (0 if it never stopped)
+ * START: first duty of the ascending pass that turned after a stopped
+ *        step (0 if the fan never stopped)
+ * PPR:   the chip converts pulses to RPM with fanN_pulses; a fan with q
+ *        pulses per revolution read with p reports RPM * q / p. With
+ *        --rated the fix is p * max_rpm / rated; without it, max_rpm is
+ *        only checked against a plausible PC-fan range and the nearest
+ *        valid p that fits becomes a hint, never pulses_suggested: AIO
+ *        pumps and server fans legitimately exceed 3600 RPM
+ */
+static void analyse(const struct chan *c, struct model *m) {
+	memset(m, 0, sizeof(*m));
+	int min_spin = INT32_MAX;
+	for (int d = 0; d < 2; ++d) {
+		for (int i = 0; i < nsteps; ++i) {
+			const struct step_result *r = &c->res[d][i];
+			if (r->measured && r->rpm > m->max_rpm) {
+				m->max_rpm = r->rpm;
+			}
+			if (r->measured && r->rpm >= RPM_STOPPED && r->rpm < min_spin) {
+				min_spin = r->rpm;
+			}
+		}
+	}
+	m->connected = m->max_rpm >= RPM_STOPPED;
+	m->suggested = c->pulses;
+	m->ppr_basis = "none";
+	if (!m->connected) {
+		return;
+	}
+	m->responds = (int64_t)min_spin * 100 < (int64_t)m->max_rpm * RESPOND_PCT;
+
+	m->stall = 0;
+	for (int i = 0; i < nsteps; ++i) {
+		const struct step_result *r = &c->res[0][i];
+		if (!r->measured) {
+			continue;
+		}
+		if (r->rpm < RPM_STOPPED) {
+			break;
+		}
+		m->stall = r->duty;
+	}
+	bool stopped = false;
+	m->start = 0;
+	for (int i = 0; i < nsteps; ++i) {
+		const struct step_result *r = &c->res[1][i];
+		if (!r->measured) {
+			continue;
+		}
+		if (r->rpm < RPM_STOPPED) {
+			stopped = true;
+		} else if (stopped) {
+			m->start = r->duty;
+			break;
+		}
+	}
+
+	if (c->pulses <= 0) {
+		return;
+	}
+	if (c->rated > 0) {
+		m->ppr_basis = "rated";
+		m->suggested = snap_pulses((double)c->pulses * m->max_rpm / c->rated);
+	} else {
+		m->ppr_basis = "plausible-range";
+		if (m->max_rpm < RPM_PLAUSIBLE_MIN || m->max_rpm > RPM_PLAUSIBLE_MAX) {
+			m->ppr_suspect = true;
+			for (size_t i = 0; i < sizeof(valid_pulses) / sizeof(valid_pulses[0]); ++i) {
+				int q = valid_pulses[i];
+				long corrected = (long)m->max_rpm * c->pulses / q;
+				if (corrected >= RPM_PLAUSIBLE_MIN && corrected <= RPM_PLAUSIBLE_MAX &&
+				    (m->hint == 0 || abs(q - c->pulses) < abs(m->hint - c->pulses))) {
+					m->hint = q;
+				}
+			}
+		}
+	}
+	m->ppr_suspect = m->ppr_suspect || m->suggested != c->pulses;
+}
+
+static void write_pass(FILE *out, const char *key, const struct step_result *res) {
+	fprintf(out, "%s =", key);
+	bool first = true;
+	for (int i = 0; i < nsteps; ++i) {
+		if (res[i].measured) {
+			fprintf(out, "%s %d:%d%s", first ? "" : ",", res[i].duty, res[i].rpm, res[i].settled ? "" : "~");
+			first = false;
+		}
+	}
+	fputc('\n', out);
+}
+
+/*
+ * write_model() - MODEL.tmp, fsync, rename (a failed run keeps the old model)
+ */
+static int write_model(const char *path, const char *hwmon, const struct model *models) {
+	char dir[PATH_MAX];
+	snprintf(dir, sizeof(dir), "%s", path);
+	char *slash = strrchr(dir, '/');
+	if (slash && slash != dir) {
+		*slash = '\0';
+		if (mkdir(dir, 0755) < 0 && errno != EEXIST) {
+			fprintf(stderr, "[ERROR] Cannot create %s: %s\n", dir, strerror(errno));
+			return -1;
+		}
+	}
+
+	char tmp[PATH_MAX];
+	snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+	FILE *out = fopen(tmp, "we");
+	if (!out) {
+		fprintf(stderr, "[ERROR] Cannot create %s: %s\n", tmp, strerror(errno));
+		return -1;
+	}
+
+	time_t now = time(NULL);
+	char stamp[32];
+	strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%S%z", localtime(&now));
+	fprintf(out, "# nct-characterize model, %s, %s, hold %d ms\n", stamp, hwmon, hold_ms);
+	fprintf(out, "# rpm_down/rpm_up: settled RPM per duty step; '~' = did not settle within %d%%\n", SETTLE_PCT);
+	for (int i = 0; i < nchans; ++i) {
+		const struct chan *c = &chans[i];
+		const struct model *m = &models[i];
+		fprintf(out, "\n[pwm%d]\nfan = %d\nconnected = %s\n", c->index, c->index, m->connected ? "yes" : "no");
+		if (m->connected) {
+			fprintf(out, "responds = %s\nstall_duty = %d\nstart_duty = %d\nmax_rpm = %d\n"
+				"pulses = %d\npulses_suggested = %d\nppr_check = %s\t# %s",
+				m->responds ? "yes" : "no", m->stall, m->start, m->max_rpm, c->pulses, m->suggested,
+				m->ppr_suspect ? "suspect" : "ok", m->ppr_basis);
+			if (m->hint) {
+				fprintf(out, "; pulses %d would read %ld RPM, confirm with --rated", m->hint,
+					(long)m->max_rpm * c->pulses / m->hint);
+			}
+			fputc('\n', out);
+		}
+		write_pass(out, "rpm_down", c->res[0]);
+		write_pass(out, "rpm_up", c->res[1]);
+	}
+
+	bool ok = fflush(out) == 0 && fsync(fileno(out)) == 0;
+	ok = fclose(out) == 0 && ok;
+	if (!ok || rename(tmp, path) < 0) {
+		fprintf(stderr, "[ERROR] Cannot write %s: %s\n", path, strerror(errno));
+		unlink(tmp);
+		return -1;
+	}
+	return 0;
+}
+
+static void usage(FILE *out, const char *prog) {
+	fprintf(out,
+		"Usage: %s [--hwmon DIR] [--headers LIST] [--hold MS] [--steps LIST] [--rated N:RPM]...\n"
+		"          [--max-temp C] [-o MODEL]\n"
+		"  --hwmon DIR     NCT67xx hwmon directory (default: resolve)\n"
+		"  --headers LIST  headers to sweep, e.g. 1-6 or 1,3 (default: all with fanN_input)\n"
+		"  --hold MS       time per duty step, %d-%d (default %d)\n"
+		"  --steps LIST    duty steps 0-255 (default 255..0, %d steps)\n"
+		"  --rated N:RPM   fanN rated max RPM, for an exact PPR check\n"
+		"  --max-temp C    abort if a chip temperature exceeds C (default %d)\n"
+		"  -o MODEL        model file (default %s)\n",
+		prog, HOLD_MIN, HOLD_MAX, HOLD_DEFAULT, (int)(sizeof(default_steps) / sizeof(default_steps[0])),
+		MAX_TEMP_DEFAULT, DEFAULT_MODEL);
+}
+
+/*
+ * main() - Entry point
+ * STRATEGY:
+ *   1. Parse options, resolve hwmon, pick headers (pwmN with fanN_input)
+ *   2. Take over every header; on failure restore those taken, exit 2
+ *   3. 250 ms timerfd loop: temperature guard, then every header's
+ *      staggered schedule, until all passes are done
+ *   4. Restore, analyse, print a summary, write the model
+ */
+int main(int argc, char **argv) {
+	static const struct option longopts[] = {
+		{"hwmon", required_argument, NULL, 'H'},
+		{"headers", required_argument, NULL, 'n'},
+		{"hold", required_argument, NULL, 'd'},
+		{"steps", required_argument, NULL, 'S'},
+		{"rated", required_argument, NULL, 'r'},
+		{"max-temp", required_argument, NULL, 't'},
+		{"output", required_argument, NULL, 'o'},
+		{"help", no_argument, NULL, 'h'},
+		{NULL, 0, NULL, 0},
+	};
+
+	char hwmon[HWMON_PATH_MAX] = "";
+	const char *model_path = DEFAULT_MODEL;
+	int want[MAX_HEADERS];
+	int nwant = 0;
+	int rated[MAX_HEADERS + 1] = {0};
+	int max_temp = MAX_TEMP_DEFAULT;
+
+	nsteps = (int)(sizeof(default_steps) / sizeof(default_steps[0]));
+	memcpy(steps, default_steps, sizeof(default_steps));
+
+	int opt;
+	while ((opt = getopt_long(argc, argv, "H:n:d:S:r:t:o:h", longopts, NULL)) != -1) {
+		switch (opt) {
+		case 'H':
+			snprintf(hwmon, sizeof(hwmon), "%s", optarg);
+			break;
+		case 'n':
+			nwant = parse_list(optarg, 1, MAX_HEADERS, want, MAX_HEADERS);
+			if (nwant <= 0) {
+				fprintf(stderr, "[ERROR] --headers: expected e.g. 1-6 or 1,2,5 (1-%d)\n", MAX_HEADERS);
+				return 2;
+			}
+			break;
+		case 'd':
+			hold_ms = atoi(optarg);
+			if (hold_ms < HOLD_MIN || hold_ms > HOLD_MAX) {
+				fprintf(stderr, "[ERROR] --hold must be %d-%d ms\n", HOLD_MIN, HOLD_MAX);
+				return 2;
+			}
+			break;
+		case 'S':
+			nsteps = parse_list(optarg, 0, 255, steps, MAX_STEPS);
+			if (nsteps < 2) {
+				fprintf(stderr, "[ERROR] --steps: 2-%d duties 0-255\n", MAX_STEPS);
+				return 2;
+			}
+			qsort(steps, (size_t)nsteps, sizeof(steps[0]), cmp_desc);
+			break;
+		case 'r': {
+			int n, rpm;
+			if (sscanf(optarg, "%d:%d", &n, &rpm) != 2 || n < 1 || n > MAX_HEADERS || rpm <= 0) {
+				fprintf(stderr, "[ERROR] --rated: expected FAN:RPM, e.g. 1:1500\n");
+				return 2;
+			}
+			rated[n] = rpm;
+			break;
+		}
+		case 't':
+			max_temp = atoi(optarg);
+			if (max_temp < 30 || max_temp > 110) {
+				fprintf(stderr, "[ERROR] --max-temp must be 30-110 C\n");
+				return 2;
+			}
+			break;
+		case 'o':
+			model_path = optarg;
+			break;
+		case 'h':
+			usage(stdout, argv[0]);
+			return 0;
+		default:
+			usage(stderr, argv[0]);
+			return 2;
+		}
+	}
+
+	if (!hwmon[0]) {
+		struct hwmon_resolution res;
+		if (hwmon_resolve(&res, 0) < 0) {
+			fprintf(stderr, "[ERROR] No %s* hwmon device under %s (is nct6775 loaded?)\n", HWMON_NAME_PREFIX, HWMON_CLASS_PATH);
+			return 2;
+		}
+		snprintf(hwmon, sizeof(hwmon), "%s", res.hwmon);
+	}
+	int dirfd = open(hwmon, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dirfd < 0) {
+		fprintf(stderr, "[ERROR] Cannot open hwmon directory %s: %s\n", hwmon, strerror(errno));
+		return 2;
+	}
+
+	/* Temperature guard: every tempN_input the chip exposes */
+	static struct hwmon_channel all[MAX_CHANNELS];
+	int nall = hwmon_scan_channels(dirfd, all, MAX_CHANNELS);
+	int temps[MAX_TEMPS];
+	int ntemps = 0;
+	for (int i = 0; i < nall; ++i) {
+		if (all[i].kind == HWMON_TEMP && ntemps < MAX_TEMPS) {
+			temps[ntemps++] = i;
+		}
+	}
+
+	if (nwant == 0) {
+		for (int n = 1; n <= MAX_HEADERS; ++n) {
+			char a[HWMON_ATTR_MAX], b[HWMON_ATTR_MAX];
+			snprintf(a, sizeof(a), "pwm%d", n);
+			snprintf(b, sizeof(b), "fan%d_input", n);
+			if (faccessat(dirfd, a, F_OK, 0) == 0 && faccessat(dirfd, b, F_OK, 0) == 0) {
+				want[nwant++] = n;
+			}
+		}
+	}
+	if (nwant == 0) {
+		fprintf(stderr, "[ERROR] No pwmN with a fanN_input under %s\n", hwmon);
+		close(dirfd);
+		return 2;
+	}
+
+	struct sigaction sa = {.sa_handler = on_signal};
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+
+	int rc = 0;
+	uint64_t hold_ns = (uint64_t)hold_ms * 1000000;
+	for (nchans = 0; nchans < nwant; ++nchans) {
+		struct chan *c = &chans[nchans];
+		memset(c, 0, sizeof(*c));
+		c->index = want[nchans];
+		c->pwm_fd = c->enable_fd = c->fan_fd = -1;
+		c->step = -1;
+		c->rated = rated[c->index];
+		c->descending_first = nchans % 2 == 0;
+		c->phase_ns = hold_ns * (uint64_t)nchans / (uint64_t)nwant;
+		if (chan_open(dirfd, c) < 0) {
+			chan_restore(c);
+			rc = 2;
+			break;
+		}
+	}
+	close(dirfd);
+
+	struct nct_rt_timer timer = {.fd = -1};
+	if (rc == 0 && nct_rt_timer_open(&timer, (uint64_t)POLL_MS * 1000000) < 0) {
+		fprintf(stderr, "[ERROR] timerfd: %s\n", strerror(errno));
+		rc = 2;
+	}
+
+	if (rc == 0) {
+		uint64_t total_ms = (uint64_t)hold_ms * (uint64_t)(2 * nsteps) + (uint64_t)hold_ms;
+		fprintf(stderr, "[INFO] Sweeping %d header(s) on %s: %d steps x 2 passes, %d ms hold, ~%llu s\n",
+			nchans, hwmon, nsteps, hold_ms, (unsigned long long)(total_ms / 1000));
+	}
+	uint64_t t0 = nct_stats_begin();
+	while (rc == 0 && !stop_requested) {
+		uint64_t expirations;
+		if (nct_rt_timer_wait(&timer, &expirations) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			fprintf(stderr, "[ERROR] timerfd read: %s\n", strerror(errno));
+			rc = 2;
+			break;
+		}
+
+		for (int i = 0; i < ntemps && rc == 0; ++i) {
+			const struct hwmon_channel *tc = &all[temps[i]];
+			int32_t t;
+			if (hwmon_read_int(tc->fd, &t) == 0 && t > max_temp * 1000 && t < TEMP_OPEN_MC) {
+				fprintf(stderr, "[ERROR] %s reads %d.%03d C (> %d C); aborting sweep\n", tc->name, t / 1000,
+					t % 1000, max_temp);
+				rc = 1;
+			}
+		}
+
+		bool done = true;
+		uint64_t elapsed = nct_stats_begin() - t0;
+		for (int i = 0; i < nchans && rc == 0; ++i) {
+			done = chan_tick(&chans[i], elapsed) && done;
+		}
+		if (done) {
+			break;
+		}
+	}
+	nct_rt_timer_close(&timer);
+	for (int i = 0; i < nchans; ++i) {
+		chan_restore(&chans[i]);
+	}
+	hwmon_close_channels(all, nall);
+	if (rc != 0 || stop_requested) {
+		fprintf(stderr, "[INFO] Headers restored; no model written\n");
+		return rc ? rc : 1;
+	}
+
+	static struct model models[MAX_HEADERS];
+	for (int i = 0; i < nchans; ++i) {
+		const struct chan *c = &chans[i];
+		struct model *m = &models[i];
+		analyse(c, m);
+		if (!m->connected) {
+			printf("pwm%d/fan%d: no fan (0 RPM at full duty)\n", c->index, c->index);
+			continue;
+		}
+		char why[96] = "";
+		if (m->ppr_suspect && m->suggested != c->pulses) {
+			snprintf(why, sizeof(why), " (suspect, try pulses_suggested = %d)", m->suggested);
+		} else if (m->ppr_suspect) {
+			snprintf(why, sizeof(why), " (outside %d-%d RPM: check with --rated %d:RPM)", RPM_PLAUSIBLE_MIN,
+				 RPM_PLAUSIBLE_MAX, c->index);
+		}
+		printf("pwm%d/fan%d: max %d RPM, stalls below %d, starts at %d%s, pulses %d%s\n", c->index, c->index,
+		       m->max_rpm, m->stall, m->start, m->responds ? "" : " (does NOT follow duty)", c->pulses, why);
+	}
+	if (write_model(model_path, hwmon, models) < 0) {
+		return 2;
+	}
+	fprintf(stderr, "[INFO] Model written to %s\n", model_path);
+	return 0;
+}
+
+/*
+ * BUILD & DEPLOYMENT NOTES:
+ *
+ * Compilation:
+ *   gcc -std=c23 -O2 -Wall -Wextra -Werror -o nct-characterize \
+ *       nct-characterize.c nct-hwmon.c nct-stats.c nct-rt.c
+ *
+ * Installation (in PKGBUILD):
+ *   install -Dm755 nct-characterize "$pkgdir/usr/lib/eirikr/nct-characterize"
+ *
+ * Cost model:
+ *   Default sweep: 17 steps x 2 passes x 5 s + one hold of stagger, about
+ *   3 minutes for all headers together, instead of the same per header
+ *   when measured by hand. Per 250 ms tick: one pread() per fan and
+ *   temperature, one pwrite() per header only at its step boundaries.
+ */
@@ -0,0 +1,171 @@
+/*
+ * nct-chip.h - Compile-time descriptors for the supported NCT67xx chips
+ *
+ * PURPOSE:
+ *   One read-only descriptor per supported Nuvoton Super I/O (NCT6796D,
+ *   NCT6798D, NCT6799D): name, channel counts, HWM bank layout, SmartFan
+ *   register offsets and the plausible HWM base range. Every native tool
+ *   that identifies the chip (nct-id, the nct-isa backend, nct-bench) looks
+ *   the DEVID up here instead of hardcoding 0xD428.
+ *
+ * WHY A SWITCH, NOT A TABLE WALK:
+ *   nct_chip_identify() is a switch on the masked DEVID; the compiler turns
+ *   it into a few compares returning a pointer to a static const
+ *   descriptor. Callers identify once at startup and keep the pointer, so
+ *   hot paths (per-sample reads) only dereference constant fields.
+ *   nct_chip_by_driver() (kernel-driver fast path) compares three strings,
+ *   also once per process.
+ *
+ * DEVID MATCHING (kernel nct6775 SIO_ID_MASK):
+ *   CR 0x20/0x21 carries the chip ID in the upper 13 bits and the silicon
+ *   revision in the low 3 bits: 0xD42B (the force_id= variant some ASUS
+ *   boards report) is an NCT6798D, revision 3. Masking with 0xFFF0, as
+ *   earlier code did, also matched NCT6796D (0xD420) as an NCT6798D.
+ *
+ * REGISTER LAYOUT (shared NCT6779-family map, kernel nct6775 tables):
+ *   Readings      bank 4: voltages 0x80-0x8E, temperatures 0x90-0x96,
+ *                 fans 0xC0-0xCB + 0xCE (see nct-isa.c)
+ *   SmartFan IV   one bank per header, pwm1-7 = banks 1, 2, 3, 8, 9, A, B;
+ *                 offsets within the bank are struct nct_smartfan_regs
+ *   Duty readback pwm_read[]: the current output duty, whatever mode drives
+ *                 it (kernel REG_PWM_READ). The SmartFan `pwm` field is the
+ *                 output-value register written in manual mode; on pwm1-5
+ *                 the two differ (0x001-0x015 vs 0x109-0x909)
+ *   All three chips share this map today; map selects reading routines in
+ *   nct-isa.c so a chip with a different layout needs a new map, not a
+ *   new code path in every tool.
+ *
+ * SAFETY:
+ *   Descriptors only describe registers; writing SmartFan registers behind
+ *   the kernel driver's back is never done by these tools (see nct-isa.h).
+ */
+
+#ifndef NCT_CHIP_H
+#define NCT_CHIP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define NCT_CHIP_ID_MASK   0xFFF8   /* low 3 bits: silicon revision */
+#define NCT_CHIP_PWM_MAX   7
+
+/* Reading register maps implemented by nct-isa.c */
+enum nct_chip_map {
+	NCT_MAP_6779,           /* NCT6779-family bank 4 readings */
+};
+
+/*
+ * struct nct_smartfan_regs - SmartFan register offsets within a header's bank
+ * curve points: auto_temp + i / auto_pwm + i, i < curve_points
+ */
+struct nct_smartfan_regs {
+	uint8_t temp_sel;       /* temperature source (pwmN_temp_sel) */
+	uint8_t target;         /* Thermal Cruise target */
+	uint8_t mode;           /* enable mode / tolerance */
+	uint8_t step_down_time;
+	uint8_t step_up_time;
+	uint8_t stop_output;    /* pwmN_floor */
+	uint8_t start_output;   /* pwmN_start */
+	uint8_t stop_time;
+	uint8_t pwm;            /* duty output */
+	uint8_t auto_temp;      /* first curve temperature */
+	uint8_t auto_pwm;       /* first curve duty */
+};
+
+struct nct_chip {
+	const char *name;
+	const char *driver;             /* nct6775 hwmon name, e.g. "nct6798" */
+	uint16_t id;                    /* DEVID & NCT_CHIP_ID_MASK */
+	uint8_t npwm;
+	uint8_t nfan;
+	uint8_t ntemp;                  /* temperature reading registers */
+	uint8_t nin;                    /* voltage inputs */
+	uint8_t curve_points;           /* SmartFan IV points per header */
+	uint8_t nbanks;                 /* HWM banks 0..nbanks-1 */
+	uint8_t reading_bank;           /* bank holding the sensor readings */
+	enum nct_chip_map map;
+	uint8_t pwm_bank[NCT_CHIP_PWM_MAX];
+	uint16_t pwm_read[NCT_CHIP_PWM_MAX];    /* current duty, HWM_REG() form */
+	struct nct_smartfan_regs smartfan;
+	uint16_t base_min;              /* plausible LDN 0x0B base (CR 0x60/61) */
+	uint16_t base_max;
+};
+
+/* Identical on all three chips; the descriptors differ in name and ID */
+#define NCT_SMARTFAN_6779 { \
+	.temp_sel = 0x00, .target = 0x01, .mode = 0x02, .step_down_time = 0x03, \
+	.step_up_time = 0x04, .stop_output = 0x05, .start_output = 0x06, \
+	.stop_time = 0x07, .pwm = 0x09, .auto_temp = 0x21, .auto_pwm = 0x27, \
+}
+
+#define NCT_CHIP_6779_FAMILY \
+	.npwm = 7, .nfan = 7, .ntemp = 7, .nin = 15, .curve_points = 7, \
+	.nbanks = 16, .reading_bank = 4, .map = NCT_MAP_6779, \
+	.pwm_bank = {0x1, 0x2, 0x3, 0x8, 0x9, 0xA, 0xB}, \
+	.pwm_read = {0x001, 0x003, 0x011, 0x013, 0x015, 0xA09, 0xB09}, \
+	.smartfan = NCT_SMARTFAN_6779, \
+	.base_min = 0x0100, .base_max = 0x0FF8
+
+static const struct nct_chip nct6796d = {.name = "NCT6796D", .driver = "nct6796", .id = 0xD420, NCT_CHIP_6779_FAMILY};
+static const struct nct_chip nct6798d = {.name = "NCT6798D", .driver = "nct6798", .id = 0xD428, NCT_CHIP_6779_FAMILY};
+static const struct nct_chip nct6799d = {.name = "NCT6799D", .driver = "nct6799", .id = 0xD800, NCT_CHIP_6779_FAMILY};
+
+/*
+ * nct_chip_identify() - Descriptor for a raw CR 0x20/0x21 DEVID
+ * RETURNS: descriptor, or NULL for a chip without one
+ */
+static inline const struct nct_chip *nct_chip_identify(uint16_t devid) {
+	switch (devid & NCT_CHIP_ID_MASK) {
+	case 0xD420:
+		return &nct6796d;
+	case 0xD428:
+		return &nct6798d;
+	case 0xD800:
+		return &nct6799d;
+	default:
+		return NULL;
+	}
+}
+
+/*
+ * nct_chip_by_driver() - Descriptor for the name the kernel driver gave hwmonN
+ * WHY: With nct6775 bound, hwmonN/name identifies the chip without
+ *      touching the Super I/O ports (the driver does not export DEVID)
+ * RETURNS: descriptor, or NULL for a chip without one
+ */
+static inline const struct nct_chip *nct_chip_by_driver(const char *name) {
+	static const struct nct_chip *const chips[] = {&nct6796d, &nct6798d, &nct6799d};
+	for (size_t i = 0; i < sizeof(chips) / sizeof(chips[0]); ++i) {
+		if (strcmp(name, chips[i]->driver) == 0) {
+			return chips[i];
+		}
+	}
+	return NULL;
+}
+
+static inline unsigned nct_chip_revision(uint16_t devid) {
+	return devid & (uint16_t)~NCT_CHIP_ID_MASK;
+}
+
+/*
+ * nct_chip_base_ok() - Whether CR 0x60/61 can be this chip's HWM window
+ * WHY: A disabled or misread LDN returns 0x0000/0xFFFF or legacy-device
+ *      ports; driving base+5/base+6 there would poke an unrelated device.
+ *      The kernel also ignores the low 3 bits, so the range check does too
+ */
+static inline int nct_chip_base_ok(const struct nct_chip *chip, uint16_t base) {
+	uint16_t aligned = base & (uint16_t)~7u;
+	return aligned >= chip->base_min && aligned <= chip->base_max;
+}
+
+/*
+ * nct_chip_pwm_reg() - HWM register of a SmartFan field for header n (1-based)
+ * IN:  offset = one of chip->smartfan's fields
+ * RETURNS: (bank << 8) | index, the nct-sio.h HWM_REG() convention
+ */
+static inline uint16_t nct_chip_pwm_reg(const struct nct_chip *chip, int n, uint8_t offset) {
+	return (uint16_t)((chip->pwm_bank[n - 1] << 8) | offset);
+}
+
+#endif /* NCT_CHIP_H */
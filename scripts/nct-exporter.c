@@ -0,0 +1,720 @@
+/*
+ * nct-exporter.c - OpenMetrics exporter fed from the nct-sampler ring
+ *
+ * PURPOSE:
+ *   Serve NCT6798D temperatures, fan speeds, voltages, PWM duty and PWM
+ *   mode as OpenMetrics / Prometheus text without touching sysfs.
+ *
+ * WHY THIS EXISTS:
+ *   node_exporter's hwmon collector walks the whole /sys/class/hwmon tree
+ *   on every scrape, so scrape cost grows with the scrape count. Here the
+ *   hardware is read exactly once per sample by nct-sampler; the exporter
+ *   maps the shared ring read-only (nct-ring.h) and renders the newest
+ *   sample into a pre-sized static buffer.
+ *
+ * HOW:
+ *   1. Attach to the ring once (re-attach if the sampler is restarted)
+ *   2. On a scrape, re-render only if the ring head moved since the last
+ *      render or the cached body is a sampler period old; otherwise resend
+ *      the cached response verbatim. The age re-render is what lets a hung
+ *      or SIGKILLed sampler (head and writer_pid frozen) show up as down
+ *   3. The HTTP header is written into reserved space directly in front of
+ *      the body, so each response is one send(2) from one buffer
+ *   Nothing is allocated after startup; scrape latency is independent of
+ *   how many scrapers poll and of how many hwmon devices exist.
+ *
+ * METRICS:
+ *   nct_temperature_celsius{sensor="temp1",label="SYSTIN"}
+ *   nct_fan_speed_rpm{fan="fan1",label="..."}
+ *   nct_voltage_volts{sensor="in0",label="..."}
+ *   nct_pwm_duty{pwm="pwm1"}                       0-255
+ *   nct_pwm_mode{pwm="pwm1",mode="SmartFan-IV"}    raw pwmN_enable value
+ *   nct_temperature_celsius{chip="k10temp",sensor="temp1",label="Tctl"}
+ *       channels of other hwmon devices (nct-sampler --device) carry the
+ *       ring name's device prefix as chip; the nct67xx chip has none
+ *   nct_sampler_up                                 1 while the newest sample is
+ *                                                  at most two sampler periods
+ *                                                  old and writer_pid is set
+ *   nct_sample_age_seconds                         age of the rendered sample
+ *   nct_sampler_op_latency_seconds{op="sysfs_read"}  histogram of the
+ *       sampler's own operations (nct-stats.h classes, log2 buckets),
+ *       from the ring's stats block; absent for rings without one.
+ *       op="wakeup" is the sampler's timer jitter (nct-rt.h)
+ *   nct_sampler_deadline_misses_total              sampler ticks lost
+ *   nct_temperature_{min,max,mean}_celsius{sensor=,label=,window="1m"}
+ *   nct_fan_speed_{min,max,mean}_rpm, nct_voltage_{min,max,mean}_volts,
+ *   nct_pwm_duty_{min,max,mean}
+ *       the sampler's precomputed rollups (nct-ring.h) over the newest
+ *       complete bucket of each --rollups window; a window appears once
+ *       its first bucket has closed
+ *   Channels whose last read failed are omitted, not reported as 0.
+ *
+ * USAGE:
+ *   nct-exporter [--ring PATH] [--listen ADDR:PORT] [--rollups LIST] [--once]
+ *     --ring PATH         Ring published by nct-sampler (default /dev/shm/nct-telemetry)
+ *     --listen ADDR:PORT  IPv4 listen address (default 127.0.0.1:9798)
+ *     --rollups LIST      Windows to export: comma-separated 1s,1m,1h, or
+ *                         none (default 1m,1h)
+ *     --once              Render one exposition to stdout and exit
+ *
+ * SAFETY / CAVEATS:
+ *   - Read-only: never writes to the ring or to sysfs; runs unprivileged
+ *   - Serves GET /metrics (and GET /) only; one request per connection
+ *   - Binds to loopback by default; expose it deliberately
+ */
+
+#define _GNU_SOURCE
+#include "nct-ring.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <getopt.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * Buffer sizing
+ * WHY 256 KiB: a full 96-channel exposition is ~12 KiB, plus ~25 KiB per
+ *             exported rollup window; the body is never allowed to outgrow
+ *             BODY_MAX (render truncates at a line)
+ */
+#define HDR_RESERVE     256
+#define BODY_MAX        (256 * 1024)
+#define REQUEST_MAX     2048
+#define REQUEST_WAIT_MS 1000
+#define REATTACH_NS     1000000000ull
+
+#define DEFAULT_LISTEN  "127.0.0.1:9798"
+#define DEFAULT_ROLLUPS "1m,1h"
+
+static volatile sig_atomic_t stop_requested;
+
+static void on_signal(int sig) {
+	(void)sig;
+	stop_requested = 1;
+}
+
+/*
+ * struct exporter - Ring attachment plus the cached response
+ * response: [HDR_RESERVE bytes for the HTTP header][body]
+ */
+struct exporter {
+	const char *ring_path;
+	const struct nct_ring_header *ring;
+	size_t ring_size;
+	ino_t ring_ino;
+	uint64_t rendered_head;     /* ring head the cached body reflects */
+	uint32_t rendered_pid;
+	uint64_t rendered_ns;       /* when the cached body was rendered */
+	uint64_t last_check_ns;
+	bool rollup_level[NCT_RING_ROLLUP_LEVELS];  /* windows selected by --rollups */
+	size_t body_len;
+	char response[HDR_RESERVE + BODY_MAX];
+};
+
+static uint64_t clock_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* One sampler period; REATTACH_NS for a ring that does not say */
+static uint64_t ring_period_ns(const struct nct_ring_header *ring) {
+	return ring && ring->rate_hz > 0 ? 1000000000ull / ring->rate_hz : REATTACH_NS;
+}
+
+/*
+ * pwm_mode_name() - pwmN_enable value to the names verify_and_report() prints
+ */
+static const char *pwm_mode_name(int32_t mode) {
+	switch (mode) {
+	case 0: return "disabled";
+	case 1: return "manual";
+	case 2: return "thermal-cruise";
+	case 3: return "speed-cruise";
+	case 5: return "SmartFan-IV";
+	default: return "unknown";
+	}
+}
+
+/*
+ * struct out - Bounded append cursor over the body buffer
+ * WHY: snprintf into a fixed buffer never allocates; overflow latches
+ *      `full` and later appends become no-ops
+ */
+struct out {
+	char *buf;
+	size_t len;
+	size_t cap;
+	bool full;
+};
+
+static void out_printf(struct out *o, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+static void out_printf(struct out *o, const char *fmt, ...) {
+	if (o->full) {
+		return;
+	}
+	va_list ap;
+	va_start(ap, fmt);
+	int n = vsnprintf(o->buf + o->len, o->cap - o->len, fmt, ap);
+	va_end(ap);
+	if (n < 0 || (size_t)n >= o->cap - o->len) {
+		o->full = true;
+		return;
+	}
+	o->len += (size_t)n;
+}
+
+/* Escape a label value per OpenMetrics (backslash, quote, newline) */
+static void out_label(struct out *o, const char *s) {
+	char esc[2 * NCT_RING_NAME_MAX + 1];
+	size_t j = 0;
+	for (size_t i = 0; s[i] && i < NCT_RING_NAME_MAX; ++i) {
+		if (s[i] == '\\' || s[i] == '"') {
+			esc[j++] = '\\';
+			esc[j++] = s[i];
+		} else if (s[i] == '\n') {
+			esc[j++] = '\\';
+			esc[j++] = 'n';
+		} else {
+			esc[j++] = s[i];
+		}
+	}
+	esc[j] = '\0';
+	out_printf(o, "%s", esc);
+}
+
+/* Fixed-point milli-units (millidegrees, millivolts) as decimal */
+static void out_milli(struct out *o, int32_t v) {
+	int64_t a = v < 0 ? -(int64_t)v : v;
+	out_printf(o, "%s%lld.%03lld", v < 0 ? "-" : "", (long long)(a / 1000), (long long)(a % 1000));
+}
+
+/*
+ * Metric families, indexed by enum nct_ring_kind
+ * key: label key naming the channel; milli: value is in thousandths
+ * rollup/suffix: rollup family names are rollup + "_min" + suffix etc.;
+ *                NULL = the kind is not aggregated (modes have no mean)
+ */
+static const struct {
+	const char *metric;
+	const char *unit;
+	const char *help;
+	const char *key;
+	bool milli;
+	const char *rollup;
+	const char *suffix;
+} families[] = {
+	[NCT_RING_TEMP] = {"nct_temperature_celsius", "celsius", "Temperature input (tempN_input)", "sensor", true,
+			   "nct_temperature", "_celsius"},
+	[NCT_RING_FAN] = {"nct_fan_speed_rpm", NULL, "Fan tachometer reading (fanN_input)", "fan", false,
+			  "nct_fan_speed", "_rpm"},
+	[NCT_RING_IN] = {"nct_voltage_volts", "volts", "Voltage input (inN_input)", "sensor", true,
+			 "nct_voltage", "_volts"},
+	[NCT_RING_PWM] = {"nct_pwm_duty", NULL, "PWM duty cycle, 0-255 (pwmN)", "pwm", false, "nct_pwm_duty", ""},
+	[NCT_RING_PWM_ENABLE] = {"nct_pwm_mode", NULL, "PWM control mode (pwmN_enable)", "pwm", false, NULL, NULL},
+};
+
+#define NFAMILIES (sizeof(families) / sizeof(families[0]))
+
+static const char *channel_prefix(const struct nct_ring_channel *ch) {
+	return ch->kind == NCT_RING_TEMP ? "temp" : ch->kind == NCT_RING_FAN ? "fan" : ch->kind == NCT_RING_IN ? "in" : "pwm";
+}
+
+/* {chip="...",key="tempN",label="..." -- the caller closes the brace */
+static void out_channel(struct out *o, const struct nct_ring_channel *ch) {
+	const char *slash = memchr(ch->name, '/', sizeof(ch->name));
+	out_printf(o, "{");
+	if (slash) {
+		char chip[NCT_RING_NAME_MAX];
+		memcpy(chip, ch->name, (size_t)(slash - ch->name));
+		chip[slash - ch->name] = '\0';
+		out_printf(o, "chip=\"");
+		out_label(o, chip);
+		out_printf(o, "\",");
+	}
+	out_printf(o, "%s=\"%s%u\"", families[ch->kind].key, channel_prefix(ch), ch->index);
+	if (ch->label[0]) {
+		out_printf(o, ",label=\"");
+		out_label(o, ch->label);
+		out_printf(o, "\"");
+	}
+}
+
+/*
+ * render_stats() - Sampler latency histograms as one OpenMetrics histogram
+ * HOW:  Cumulative log2 buckets up to the highest non-empty one, then
+ *       +Inf; classes the sampler never used are omitted. op="wakeup" is
+ *       the timer jitter, followed by the deadline miss counter
+ */
+static void render_stats(struct out *o, const struct nct_stats *st) {
+	static const char metric[] = "nct_sampler_op_latency_seconds";
+	bool header = false;
+
+	for (int op = 0; op < NCT_OP_COUNT; ++op) {
+		const struct nct_hist *h = &st->op[op];
+		if (h->count == 0) {
+			continue;
+		}
+		if (!header) {
+			out_printf(o, "# TYPE %s histogram\n# UNIT %s seconds\n", metric, metric);
+			out_printf(o, "# HELP %s Latency of nct-sampler operations (log2 buckets)\n", metric);
+			header = true;
+		}
+
+		const char *name = nct_op_name((enum nct_op)op);
+		unsigned last = 0;
+		for (unsigned b = 0; b + 1 < NCT_STATS_BUCKETS; ++b) {
+			if (h->bucket[b]) {
+				last = b;
+			}
+		}
+		uint64_t cumulative = 0;
+		for (unsigned b = 0; b <= last; ++b) {
+			cumulative += h->bucket[b];
+			out_printf(o, "%s_bucket{op=\"%s\",le=\"%.9g\"} %llu\n", metric, name,
+				   (double)nct_bucket_limit_ns(b) / 1e9, (unsigned long long)cumulative);
+		}
+		out_printf(o, "%s_bucket{op=\"%s\",le=\"+Inf\"} %llu\n", metric, name, (unsigned long long)h->count);
+		out_printf(o, "%s_count{op=\"%s\"} %llu\n", metric, name, (unsigned long long)h->count);
+		out_printf(o, "%s_sum{op=\"%s\"} %.9f\n", metric, name, (double)h->sum_ns / 1e9);
+	}
+
+	/* Wakeup jitter's companion: ticks lost outright (nct-rt.h) */
+	if (st->op[NCT_OP_WAKEUP].count) {
+		out_printf(o, "# TYPE nct_sampler_deadline_misses counter\n"
+			   "# HELP nct_sampler_deadline_misses Sampler ticks lost to late wakeups\n"
+			   "nct_sampler_deadline_misses_total %llu\n",
+			   (unsigned long long)st->deadline_misses);
+	}
+}
+
+/*
+ * render_rollups() - The newest complete bucket of each selected window
+ * HOW:  Copy one bucket per window first (seqlock, nct_ring_read_rollup()),
+ *       then emit family by family so every family's samples stay
+ *       contiguous as OpenMetrics requires; channels without a valid
+ *       sample in the bucket are omitted
+ */
+static void render_rollups(struct out *o, const struct exporter *ex) {
+	static const char *const stat_name[] = {"min", "max", "mean"};
+	static struct nct_ring_rollup_bucket bucket[NCT_RING_ROLLUP_LEVELS];
+	bool have[NCT_RING_ROLLUP_LEVELS] = {false};
+
+	const struct nct_ring_rollups *r = nct_ring_rollups(ex->ring, ex->ring_size);
+	if (!r) {
+		return;
+	}
+	for (uint32_t l = 0; l < r->nlevels; ++l) {
+		have[l] = ex->rollup_level[l] && nct_ring_read_rollup(ex->ring, r, l, 1, &bucket[l]) == 0;
+	}
+
+	for (size_t st = 0; st < sizeof(stat_name) / sizeof(stat_name[0]); ++st) {
+		for (size_t kind = 0; kind < NFAMILIES; ++kind) {
+			if (!families[kind].rollup) {
+				continue;
+			}
+			bool header = false;
+			for (uint32_t l = 0; l < r->nlevels; ++l) {
+				for (uint32_t i = 0; have[l] && i < ex->ring->nchannels; ++i) {
+					const struct nct_ring_channel *ch = &ex->ring->channels[i];
+					const struct nct_ring_agg *a = &bucket[l].agg[i];
+					if (ch->kind != kind || a->count == 0) {
+						continue;
+					}
+					if (!header) {
+						header = true;
+						out_printf(o, "# TYPE %s_%s%s gauge\n", families[kind].rollup, stat_name[st],
+							   families[kind].suffix);
+						if (families[kind].unit) {
+							out_printf(o, "# UNIT %s_%s%s %s\n", families[kind].rollup, stat_name[st],
+								   families[kind].suffix, families[kind].unit);
+						}
+						out_printf(o, "# HELP %s_%s%s %s, %s over the rollup window\n", families[kind].rollup,
+							   stat_name[st], families[kind].suffix, families[kind].help, stat_name[st]);
+					}
+					out_printf(o, "%s_%s%s", families[kind].rollup, stat_name[st], families[kind].suffix);
+					out_channel(o, ch);
+					out_printf(o, ",window=\"%s\"} ", nct_ring_rollup_spec[l].name);
+					if (st == 2) {
+						double mean = (double)a->sum / (double)a->count;
+						out_printf(o, "%.3f\n", families[kind].milli ? mean / 1000.0 : mean);
+					} else if (families[kind].milli) {
+						out_milli(o, st == 0 ? a->min : a->max);
+						out_printf(o, "\n");
+					} else {
+						out_printf(o, "%d\n", st == 0 ? a->min : a->max);
+					}
+				}
+			}
+		}
+	}
+}
+
+/*
+ * parse_rollups() - --rollups LIST into ex->rollup_level[]
+ * RETURNS: 0, or -1 on an unknown window name
+ */
+static int parse_rollups(struct exporter *ex, const char *list) {
+	char buf[64];
+	snprintf(buf, sizeof(buf), "%s", list);
+	memset(ex->rollup_level, 0, sizeof(ex->rollup_level));
+	if (strcmp(buf, "none") == 0) {
+		return 0;
+	}
+	for (char *save, *tok = strtok_r(buf, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+		int l = 0;
+		while (l < NCT_RING_ROLLUP_LEVELS && strcmp(tok, nct_ring_rollup_spec[l].name) != 0) {
+			l++;
+		}
+		if (l == NCT_RING_ROLLUP_LEVELS) {
+			return -1;
+		}
+		ex->rollup_level[l] = true;
+	}
+	return 0;
+}
+
+/*
+ * render() - Render the newest ring sample into the body buffer
+ * ORDER: family by family, so each metric family's metadata is emitted
+ *        once, immediately before its samples; the ring is grouped by
+ *        kind per device, not across --device devices
+ */
+static void render(struct exporter *ex) {
+	struct out o = {.buf = ex->response + HDR_RESERVE, .cap = BODY_MAX};
+	static struct nct_ring_sample s;
+	bool have = ex->ring && nct_ring_latest(ex->ring, &s) == 0;
+	uint32_t pid = ex->ring ? atomic_load_explicit(&ex->ring->writer_pid, memory_order_acquire) : 0;
+
+	uint32_t n = have ? (s.nvalues < ex->ring->nchannels ? s.nvalues : ex->ring->nchannels) : 0;
+	for (size_t kind = 0; kind < NFAMILIES; ++kind) {
+		bool header = false;
+		for (uint32_t i = 0; i < n; ++i) {
+			const struct nct_ring_channel *ch = &ex->ring->channels[i];
+			if (ch->kind != kind || s.values[i] == NCT_RING_INVALID) {
+				continue;
+			}
+			if (!header) {
+				header = true;
+				out_printf(&o, "# TYPE %s gauge\n", families[ch->kind].metric);
+				if (families[ch->kind].unit) {
+					out_printf(&o, "# UNIT %s %s\n", families[ch->kind].metric, families[ch->kind].unit);
+				}
+				out_printf(&o, "# HELP %s %s\n", families[ch->kind].metric, families[ch->kind].help);
+			}
+
+			out_printf(&o, "%s", families[ch->kind].metric);
+			out_channel(&o, ch);
+			if (ch->kind == NCT_RING_PWM_ENABLE) {
+				out_printf(&o, ",mode=\"%s\"", pwm_mode_name(s.values[i]));
+			}
+			out_printf(&o, "} ");
+			if (families[ch->kind].milli) {
+				out_milli(&o, s.values[i]);
+			} else {
+				out_printf(&o, "%d", s.values[i]);
+			}
+			out_printf(&o, "\n");
+		}
+	}
+
+	/* Freshness, as nct-broker and nct-fanctl judge a ring sample: a killed
+	 * or hung sampler never clears writer_pid */
+	uint64_t now = clock_ns();
+	uint64_t age = have ? now - s.t_ns : 0;
+	bool up = have && pid != 0 && age <= 2 * ring_period_ns(ex->ring);
+	out_printf(&o, "# TYPE nct_sampler_up gauge\n# HELP nct_sampler_up 1 while nct-sampler is publishing\n");
+	out_printf(&o, "nct_sampler_up %d\n", up);
+	if (have) {
+		out_printf(&o, "# TYPE nct_sample_age_seconds gauge\n# UNIT nct_sample_age_seconds seconds\n");
+		out_printf(&o, "# HELP nct_sample_age_seconds Age of the sample at render time\n");
+		out_printf(&o, "nct_sample_age_seconds %llu.%06llu\n",
+			(unsigned long long)(age / 1000000000ull), (unsigned long long)(age % 1000000000ull / 1000));
+
+		static struct nct_stats st;
+		if (nct_ring_read_stats(ex->ring, ex->ring_size, &st) == 0) {
+			render_stats(&o, &st);
+		}
+		render_rollups(&o, ex);
+	}
+
+	if (o.full) {
+		/* Keep the exposition well-formed: cut back to the last full line */
+		while (o.len > 0 && o.buf[o.len - 1] != '\n') {
+			o.len--;
+		}
+		o.full = false;
+		if (o.cap - o.len < sizeof("# EOF\n")) {
+			o.len = o.cap - sizeof("# EOF\n");
+			while (o.len > 0 && o.buf[o.len - 1] != '\n') {
+				o.len--;
+			}
+		}
+	}
+	out_printf(&o, "# EOF\n");
+
+	ex->body_len = o.len;
+	ex->rendered_head = ex->ring ? nct_ring_head(ex->ring) : 0;
+	ex->rendered_pid = pid;
+	ex->rendered_ns = now;
+}
+
+/*
+ * ring_refresh() - Attach, or re-attach after the sampler was restarted
+ * WHEN: Only when the head has not moved for REATTACH_NS (a stalled or
+ *       replaced ring); a live ring costs no syscalls here
+ */
+static void ring_refresh(struct exporter *ex) {
+	uint64_t now = clock_ns();
+
+	if (ex->ring) {
+		uint64_t head = nct_ring_head(ex->ring);
+		uint32_t pid = atomic_load_explicit(&ex->ring->writer_pid, memory_order_acquire);
+		if ((head != ex->rendered_head && pid != 0) || now - ex->last_check_ns < REATTACH_NS) {
+			return;
+		}
+	} else if (now - ex->last_check_ns < REATTACH_NS && ex->last_check_ns != 0) {
+		return;
+	}
+	ex->last_check_ns = now;
+
+	struct stat st;
+	if (stat(ex->ring_path, &st) < 0) {
+		return;
+	}
+	if (ex->ring && st.st_ino == ex->ring_ino) {
+		return;
+	}
+
+	size_t size;
+	const struct nct_ring_header *ring = nct_ring_attach(ex->ring_path, &size);
+	if (!ring) {
+		return;
+	}
+	if (ex->ring) {
+		nct_ring_detach(ex->ring, ex->ring_size);
+	}
+	ex->ring = ring;
+	ex->ring_size = size;
+	ex->ring_ino = st.st_ino;
+	ex->rendered_head = UINT64_MAX;   /* force a render */
+}
+
+/*
+ * exporter_response() - Bring the cached response up to date
+ * RETURNS: pointer to the full HTTP response (header + body), length in *len
+ */
+static const char *exporter_response(struct exporter *ex, size_t *len) {
+	ring_refresh(ex);
+
+	uint64_t head = ex->ring ? nct_ring_head(ex->ring) : 0;
+	uint32_t pid = ex->ring ? atomic_load_explicit(&ex->ring->writer_pid, memory_order_acquire) : 0;
+	if (head != ex->rendered_head || pid != ex->rendered_pid || ex->body_len == 0 ||
+	    clock_ns() - ex->rendered_ns >= ring_period_ns(ex->ring)) {
+		render(ex);
+	}
+
+	char hdr[HDR_RESERVE];
+	int hlen = snprintf(hdr, sizeof(hdr),
+		"HTTP/1.1 200 OK\r\n"
+		"Content-Type: application/openmetrics-text; version=1.0.0; charset=utf-8\r\n"
+		"Content-Length: %zu\r\n"
+		"Connection: close\r\n\r\n",
+		ex->body_len);
+	char *start = ex->response + HDR_RESERVE - hlen;
+	memcpy(start, hdr, (size_t)hlen);
+	*len = (size_t)hlen + ex->body_len;
+	return start;
+}
+
+static int listen_open(const char *spec) {
+	char host[64];
+	const char *colon = strrchr(spec, ':');
+	if (!colon || (size_t)(colon - spec) >= sizeof(host)) {
+		errno = EINVAL;
+		return -1;
+	}
+	memcpy(host, spec, (size_t)(colon - spec));
+	host[colon - spec] = '\0';
+
+	struct sockaddr_in sa = {.sin_family = AF_INET, .sin_port = htons((uint16_t)atoi(colon + 1))};
+	if (inet_pton(AF_INET, host, &sa.sin_addr) != 1) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		return -1;
+	}
+	int one = 1;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	if (bind(fd, (struct sockaddr *)&sa, sizeof(sa)) < 0 || listen(fd, 64) < 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+/*
+ * serve_one() - Read one request, answer it, close
+ * WHY bounded wait: a scraper that connects and never sends must not stall
+ *     the others for longer than REQUEST_WAIT_MS
+ */
+static void serve_one(struct exporter *ex, int cfd) {
+	static const char not_found[] =
+		"HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+	char req[REQUEST_MAX];
+
+	struct pollfd pfd = {.fd = cfd, .events = POLLIN};
+	if (poll(&pfd, 1, REQUEST_WAIT_MS) <= 0) {
+		return;
+	}
+	ssize_t n = recv(cfd, req, sizeof(req) - 1, 0);
+	if (n <= 0) {
+		return;
+	}
+	req[n] = '\0';
+
+	if (strncmp(req, "GET /metrics ", 13) != 0 && strncmp(req, "GET / ", 6) != 0) {
+		send(cfd, not_found, sizeof(not_found) - 1, MSG_NOSIGNAL);
+		return;
+	}
+
+	size_t len;
+	const char *resp = exporter_response(ex, &len);
+	while (len > 0) {
+		ssize_t w = send(cfd, resp, len, MSG_NOSIGNAL);
+		if (w < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return;
+		}
+		resp += w;
+		len -= (size_t)w;
+	}
+}
+
+static void usage(const char *prog) {
+	fprintf(stderr,
+		"Usage: %s [--ring PATH] [--listen ADDR:PORT] [--rollups LIST] [--once]\n"
+		"  --ring PATH         Sampler ring (default %s)\n"
+		"  --listen ADDR:PORT  Listen address (default %s)\n"
+		"  --rollups LIST      Rollup windows 1s,1m,1h or none (default %s)\n"
+		"  --once              Print one exposition to stdout and exit\n",
+		prog, NCT_RING_PATH, DEFAULT_LISTEN, DEFAULT_ROLLUPS);
+}
+
+int main(int argc, char *argv[]) {
+	static const struct option longopts[] = {
+		{"ring", required_argument, NULL, 'r'},
+		{"listen", required_argument, NULL, 'l'},
+		{"rollups", required_argument, NULL, 'R'},
+		{"once", no_argument, NULL, '1'},
+		{"help", no_argument, NULL, 'h'},
+		{NULL, 0, NULL, 0},
+	};
+
+	static struct exporter ex = {.ring_path = NCT_RING_PATH};
+	const char *listen_spec = DEFAULT_LISTEN;
+	bool once = false;
+	parse_rollups(&ex, DEFAULT_ROLLUPS);
+
+	int opt;
+	while ((opt = getopt_long(argc, argv, "r:l:R:1h", longopts, NULL)) != -1) {
+		switch (opt) {
+		case 'r':
+			ex.ring_path = optarg;
+			break;
+		case 'l':
+			listen_spec = optarg;
+			break;
+		case 'R':
+			if (parse_rollups(&ex, optarg) < 0) {
+				fprintf(stderr, "[ERROR] --rollups takes 1s, 1m, 1h (comma-separated) or none\n");
+				return 2;
+			}
+			break;
+		case '1':
+			once = true;
+			break;
+		case 'h':
+			usage(argv[0]);
+			return 0;
+		default:
+			usage(argv[0]);
+			return 2;
+		}
+	}
+
+	if (once) {
+		size_t len;
+		exporter_response(&ex, &len);
+		fwrite(ex.response + HDR_RESERVE, 1, ex.body_len, stdout);
+		return ex.ring ? 0 : 1;
+	}
+
+	int lfd = listen_open(listen_spec);
+	if (lfd < 0) {
+		fprintf(stderr, "[ERROR] Cannot listen on %s: %s\n", listen_spec, strerror(errno));
+		return 2;
+	}
+
+	struct sigaction sa = {.sa_handler = on_signal};
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+
+	fprintf(stderr, "[INFO] Serving %s on http://%s/metrics\n", ex.ring_path, listen_spec);
+	ring_refresh(&ex);
+	if (!ex.ring) {
+		fprintf(stderr, "[WARN] Ring %s not available yet; reporting nct_sampler_up 0\n", ex.ring_path);
+	}
+
+	while (!stop_requested) {
+		int cfd = accept4(lfd, NULL, NULL, SOCK_CLOEXEC);
+		if (cfd < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			fprintf(stderr, "[ERROR] accept: %s\n", strerror(errno));
+			break;
+		}
+		serve_one(&ex, cfd);
+		close(cfd);
+	}
+
+	close(lfd);
+	if (ex.ring) {
+		nct_ring_detach(ex.ring, ex.ring_size);
+	}
+	return 0;
+}
+
+/*
+ * BUILD & DEPLOYMENT NOTES:
+ *
+ * Compilation:
+ *   gcc -std=c23 -O2 -Wall -Wextra -Werror -o nct-exporter nct-exporter.c
+ *
+ * Installation (in PKGBUILD):
+ *   install -Dm755 nct-exporter "$pkgdir/usr/lib/eirikr/nct-exporter"
+ *   nct-exporter.service runs it after nct-sampler.service
+ *
+ * Prometheus scrape config:
+ *   - job_name: nct
+ *     static_configs: [{targets: ['127.0.0.1:9798']}]
+ */
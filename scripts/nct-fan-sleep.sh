@@ -0,0 +1,113 @@
+#!/bin/bash
+
+################################################################################
+# nct-fan-sleep.sh - systemd-sleep hook: snapshot fan control before sleep,
+#                    restore it in one pass on wake
+#
+# LOCATION: /usr/lib/systemd/system-sleep/nct-fan-sleep.sh
+#   systemd-sleep runs every executable there with:
+#     $1 = pre | post
+#     $2 = suspend | hibernate | hybrid-sleep | suspend-then-hibernate
+#
+# WHY:
+#   Firmware may reprogram the NCT6798D fan controller during S3/S4 resume
+#   (pwmN_enable back to a BIOS mode, curve points reset). The old timer
+#   only re-ran max-fans-restore.service at boot and every 30 minutes, so a
+#   lost curve stayed lost for up to half an hour, and the re-run replayed
+#   every shell profile.
+#
+# HOW:
+#   pre:  nct-fan --snapshot writes the programmed state (every pwmN*
+#         attribute plus fanN_pulses/target/tolerance) to $SNAPSHOT as a
+#         nct-fan profile
+#   post: nct-fan --reconcile reads the chip once and writes back only what
+#         the firmware changed; an intact chip gets no writes at all.
+#         Without a snapshot (e.g. first sleep after install, or the
+#         snapshot failed) max-fans-restore.service is started instead
+#
+# CAVEATS:
+#   - The snapshot lives in /run (tmpfs): it never survives a reboot, which
+#     is correct because boot goes through max-fans-restore.service
+#   - Runs as root from systemd-suspend.service; output goes to the journal
+#     (journalctl -u systemd-suspend.service)
+################################################################################
+
+set -u
+
+readonly SNAPSHOT="/run/nct-fan-resume.profile"
+readonly NCT_FAN="${NCT_FAN:-/usr/lib/eirikr/nct-fan}"
+
+log_info() {
+	echo "[INFO] $*"
+}
+
+log_warn() {
+	echo "[WARN] $*"
+}
+
+log_error() {
+	echo "[ERROR] $*" >&2
+}
+
+snapshot() {
+	# WHAT: Save the programmed fan-control state before sleep
+	# HOW: Write to a temp file and rename, so a failed snapshot never
+	#      replaces a good one with a partial profile
+	# RETURNS: nct-fan exit status (0 = captured)
+
+	local hwmon="$1"
+	if ! "$NCT_FAN" --snapshot "$hwmon" >"$SNAPSHOT.tmp"; then
+		rm -f "$SNAPSHOT.tmp"
+		log_warn "Fan control snapshot of $hwmon failed; resume will use max-fans-restore.service"
+		return 1
+	fi
+	mv -f "$SNAPSHOT.tmp" "$SNAPSHOT"
+	log_info "Fan control snapshot: $(grep -cv '^#' "$SNAPSHOT") attributes from $hwmon"
+}
+
+restore() {
+	# WHAT: Write back whatever the firmware changed while asleep
+	# WHY: One nct-fan process, one read pass, drifted writes only; takes
+	#      milliseconds instead of re-running the shell profiles
+	# RETURNS: nct-fan exit status, or systemctl's for the fallback
+
+	local hwmon="$1"
+	if [ ! -s "$SNAPSHOT" ]; then
+		log_warn "No fan control snapshot; starting max-fans-restore.service"
+		systemctl --no-block restart max-fans-restore.service
+		return
+	fi
+
+	local start=$EPOCHREALTIME rc=0
+	"$NCT_FAN" --reconcile "$SNAPSHOT" "$hwmon" || rc=$?
+	local elapsed_us=$(( ${EPOCHREALTIME/./} - ${start/./} ))
+	log_info "Fan control restored from snapshot in $((elapsed_us / 1000)).$(printf '%03d' $((elapsed_us % 1000)))ms"
+	return $rc
+}
+
+main() {
+	local phase="${1:-}"
+
+	if [ ! -x "$NCT_FAN" ]; then
+		log_error "nct-fan not found at $NCT_FAN"
+		return 1
+	fi
+
+	local hwmon
+	hwmon=$("$NCT_FAN" --resolve) || return 1
+
+	case "$phase" in
+		pre)
+			snapshot "$hwmon"
+			;;
+		post)
+			restore "$hwmon"
+			;;
+		*)
+			log_error "Usage: $0 pre|post [suspend|hibernate|hybrid-sleep|suspend-then-hibernate]"
+			return 1
+			;;
+	esac
+}
+
+main "$@"
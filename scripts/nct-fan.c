@@ -0,0 +1,1219 @@
+/*
+ * nct-fan.c - Native NCT6798D hwmon Profile Applier
+ *
+ * PURPOSE:
+ *   Apply a whole fan-control profile (SmartFan IV points, timing, Thermal
+ *   Cruise targets, weighting, electrical mode, tachometry) to the nct6775
+ *   hwmon sysfs interface from a single process.
+ *
+ * WHY THIS EXISTS:
+ *   max-fans-advanced.sh used to fork `echo | sudo tee` for every attribute:
+ *   6 headers x (14 points + 3 timings + 2 enables) = 100+ process spawns per
+ *   profile install, which took seconds on every boot and every
+ *   max-fans-restore.timer tick. This tool opens the hwmon directory once,
+ *   opens each attribute once with openat(2) relative to that dirfd, and
+ *   writes every value with pwrite(2). The shell functions are now thin
+ *   wrappers that emit a profile and hand it to this binary.
+ *
+ * PROFILE FORMAT (one write per line, applied in order):
+ *   [FLAG]ATTRIBUTE VALUE
+ *
+ *   FLAG   Meaning                                  On write failure
+ *   (none) Required write                           [ERROR], counted as failure
+ *   ?      Optional write (timing, floor, start)    [WARN] only
+ *   !      Gate write (e.g. pwmN_enable=0 before    [WARN] only; remaining lines
+ *          reprogramming a header)                  for the same channel (pwmN /
+ *                                                   fanN) skipped, as the sudo tee
+ *                                                   path skipped the header
+ *
+ *   Blank lines and lines starting with '#' are ignored.
+ *   ATTRIBUTE must be a plain file name inside the hwmon directory
+ *   (no '/', no leading '.'), so a profile can never escape the device.
+ *
+ *   PROFILE may also be a compiled plan (nct-plan.h, written by
+ *   `nct-profile --compile`): the same lines as fixed records, validated
+ *   at compile time. It is recognised by its first byte and loaded without
+ *   any parsing; --apply and --reconcile treat both forms identically.
+ *
+ * EXAMPLE PROFILE:
+ *   !pwm1_enable 0
+ *   pwm1_auto_point1_temp 40000
+ *   pwm1_auto_point1_pwm 64
+ *   ?pwm1_step_up_time 800
+ *   pwm1_enable 5
+ *
+ * RECONCILE MODE (--reconcile):
+ *   Periodic enforcement (max-fans-restore.service) used to re-run the full
+ *   profile, and every run briefly dropped each header to pwmN_enable=0.
+ *   --reconcile reads every attribute the profile names once, before any
+ *   write, and then writes only what drifted:
+ *     - the last write of an attribute is its desired value; transitional
+ *       writes (gate enable=0 ... enable=5) are never compared
+ *     - a header whose curve or timing drifted gets its gate, the drifted
+ *       attributes, and its final enable write, in profile order
+ *     - a header whose curve is intact gets no gate; a drifted enable alone
+ *       is rewritten directly
+ *   A profile that already matches the chip costs one pread(2) per
+ *   attribute and no writes.
+ *
+ * BROKER (nct-broker.h):
+ *   When nct-broker.service is running, --apply sends every write as one
+ *   request and the broker executes it with the same flag rules, so no
+ *   other tool's pwmN / pwmN_enable write can land between a gate and its
+ *   re-enable. --reconcile sends its reads as one request (ring channels
+ *   are answered from nct-sampler's cache) and its writes as a second.
+ *   Without a broker, or when it owns another device, writes go to sysfs
+ *   directly as before; --direct skips the broker.
+ *
+ * USAGE:
+ *   nct-fan --apply PROFILE HWMON_DIR [--verbose] [--direct]
+ *   nct-fan --reconcile PROFILE HWMON_DIR [--verbose] [--direct]
+ *     PROFILE   Path to profile file, or '-' for stdin
+ *     HWMON_DIR e.g. /sys/class/hwmon/hwmon4
+ *   nct-fan --snapshot HWMON_DIR [--verbose]
+ *     Print the programmed fan-control state (pwmN*, fanN_pulses/target/
+ *     tolerance) as a profile: per header a gate, every value as an
+ *     optional write, then the enable value. The systemd-sleep hook saves
+ *     it before suspend and feeds it to --reconcile on resume
+ *   nct-fan --verify [HWMON_DIR] [--json]
+ *     Report chip name, temperatures (label, value), every header's duty,
+ *     mode (pwmN_enable decoded: disabled, manual, thermal-cruise,
+ *     speed-cruise, SmartFan-IV), electrical mode and temp source, and
+ *     every tach's RPM and pulses per revolution, from one process.
+ *     HWMON_DIR defaults to the --resolve device. --json prints one
+ *     object with a versioned schema (see verify()) for inventory tooling
+ *   nct-fan --resolve [--refresh] [--verbose]
+ *     Print the NCT67xx hwmon directory (hwmon_resolve() in nct-hwmon.c).
+ *     Served from /run/nct-hwmon.cache while it still matches the device;
+ *     --refresh rescans /sys/class/hwmon and rewrites the cache (run by
+ *     udev/60-nct-hwmon-cache.rules on every hwmon add/remove)
+ *   --stats (any mode)
+ *     On exit, print sysfs read/write and whole-apply latency histograms
+ *     (nct-stats.h) to stderr
+ *
+ * EXIT STATUS:
+ *   0  every required write succeeded (a skipped gated header is a [WARN])
+ *   1  one or more required writes failed (each reported on its own line)
+ *   2  usage error or the profile/hwmon directory could not be opened
+ *   --resolve: 0 device found, 1 no NCT67xx hwmon device
+ *   --snapshot: 0 state captured, 1 nothing readable, 2 directory unusable
+ *   --verify: 0 reported, 1 no device or no channels, 2 directory unusable
+ *
+ * SAFETY / CAVEATS:
+ *   - Uses only the kernel sysfs interface; driver locking and ACPI/WMI
+ *     arbitration are preserved exactly as with the shell scripts
+ *   - An attribute that appears several times is opened once and rewritten
+ *     (e.g. pwmN_enable 0 ... pwmN_enable 5)
+ *   - --reconcile compares against the driver's read-back; an attribute the
+ *     driver quantises reads back different and is rewritten on every run.
+ *     nct-profile and max-fans-advanced.sh --timing therefore only accept
+ *     values on the driver's grid (step times: multiples of 100 ms)
+ */
+
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "nct-broker.h"
+#include "nct-hwmon.h"
+#include "nct-plan.h"
+#include "nct-stats.h"
+
+/*
+ * Limits sized for the NCT6798D attribute set
+ * WHY: ~300 writable attributes exist per chip; 512 leaves headroom
+ */
+#define MAX_ATTRS     512
+#define MAX_ATTR_NAME 64
+#define MAX_VALUE     32
+#define MAX_LINES     1024    /* 7-point curves on 6 headers: ~130 lines */
+
+/*
+ * struct attr_fd - An attribute opened once for the lifetime of a profile
+ * WHAT: Maps an attribute name to its open file descriptor
+ * WHY:  Repeated writes (enable 0 ... enable 5) must not reopen the file
+ */
+struct attr_fd {
+	char name[MAX_ATTR_NAME];
+	int fd;     /* >= 0 open, -errno if the open failed */
+};
+
+/*
+ * struct profile_line - One parsed "[FLAG]ATTRIBUTE VALUE" line
+ * write: false when --reconcile found the chip already matches
+ */
+struct profile_line {
+	char flag;                  /* ' ', '?' or '!' */
+	char name[MAX_ATTR_NAME];
+	char value[MAX_VALUE + 1];
+	int lineno;
+	bool write;
+};
+
+_Static_assert(NCT_PLAN_NAME_MAX == MAX_ATTR_NAME && NCT_PLAN_VALUE_MAX == MAX_VALUE + 1 &&
+	       NCT_PLAN_MAX == MAX_LINES, "plan records map 1:1 onto profile lines");
+_Static_assert(NCT_BROKER_NAME_MAX == MAX_ATTR_NAME && NCT_BROKER_VALUE_MAX == MAX_VALUE + 1 &&
+	       NCT_BROKER_OPS_MAX == MAX_LINES, "a whole profile fits one broker request");
+
+static struct attr_fd attr_cache[MAX_ATTRS];
+static int attr_count;
+static struct profile_line lines[MAX_LINES];
+static int open_flags = O_WRONLY;   /* O_RDWR under --reconcile, O_RDONLY under --snapshot/--verify */
+static bool verbose;
+static bool show_stats;
+static int broker_fd = -1;          /* nct-broker connection, -1 = write sysfs directly */
+static const char *broker_hwmon;
+static struct nct_broker_result broker_read[MAX_LINES];  /* --reconcile reads, per line */
+static bool broker_have_reads;
+
+/*
+ * Logging helpers: same "[LEVEL] message" format as the shell scripts
+ * WHY: journal output from systemd units stays uniform across tools
+ */
+#define log_info(...)  do { printf("[INFO] " __VA_ARGS__); putchar('\n'); } while (0)
+#define log_warn(...)  do { printf("[WARN] " __VA_ARGS__); putchar('\n'); } while (0)
+#define log_error(...) do { fprintf(stderr, "[ERROR] " __VA_ARGS__); fputc('\n', stderr); } while (0)
+
+/*
+ * attr_name_valid() - Reject names that could leave the hwmon directory
+ * WHEN: For every profile line, before openat()
+ * WHY:  Profiles may come from config files; never follow '/' or '..'
+ */
+static bool attr_name_valid(const char *name) {
+	if (name[0] == '\0' || name[0] == '.') {
+		return false;
+	}
+	return strchr(name, '/') == NULL;
+}
+
+/*
+ * attr_open() - Return the cached fd for an attribute, opening it on first use
+ * HOW:  Linear scan of the cache (profiles are ~100 lines), then openat()
+ *       relative to the hwmon dirfd with O_WRONLY (O_RDWR to reconcile)
+ * RETURNS: fd >= 0, or -errno (the failure is cached so it is reported once
+ *          per write attempt without retrying the open)
+ */
+static int attr_open(int dirfd, const char *name) {
+	for (int i = 0; i < attr_count; ++i) {
+		if (strcmp(attr_cache[i].name, name) == 0) {
+			return attr_cache[i].fd;
+		}
+	}
+
+	int fd = openat(dirfd, name, open_flags | O_CLOEXEC);
+	if (fd < 0) {
+		fd = -errno;
+	}
+
+	if (attr_count < MAX_ATTRS) {
+		snprintf(attr_cache[attr_count].name, MAX_ATTR_NAME, "%s", name);
+		attr_cache[attr_count].fd = fd;
+		attr_count++;
+	}
+	return fd;
+}
+
+/*
+ * attr_write() - Write one value to an attribute
+ * HOW:  pwrite() at offset 0 with a trailing newline (identical bytes to
+ *       `echo VALUE | tee`); sysfs parses each write independently
+ * RETURNS: 0 on success, -errno on failure
+ */
+static int attr_write(int dirfd, const char *name, const char *value) {
+	int fd = attr_open(dirfd, name);
+	if (fd < 0) {
+		return fd;
+	}
+
+	char buf[MAX_VALUE + 2];
+	int len = snprintf(buf, sizeof(buf), "%s\n", value);
+	uint64_t t = nct_stats_begin();
+	ssize_t n = pwrite(fd, buf, (size_t)len, 0);
+	nct_stats_end(NCT_OP_SYSFS_WRITE, t);
+	if (n < 0) {
+		return -errno;
+	}
+	return n == len ? 0 : -EIO;
+}
+
+/*
+ * attr_channel() - Extract the channel prefix of an attribute
+ * WHAT: "pwm3_auto_point1_temp" -> "pwm3"; "fan2_pulses" -> "fan2"
+ * WHY:  A failed gate write skips the rest of that channel's lines
+ */
+static void attr_channel(const char *name, char *out, size_t len) {
+	size_t n = strcspn(name, "_");
+	if (n >= len) {
+		n = len - 1;
+	}
+	memcpy(out, name, n);
+	out[n] = '\0';
+}
+
+/*
+ * load_profile() - Parse a whole profile stream into lines[]
+ * WHY:  --reconcile must know every attribute before it reads or writes
+ *       anything; --apply writes the same lines in the same order
+ * RETURNS: number of lines, or -1 on a parse error or overflow
+ */
+static int load_profile(FILE *in) {
+	char line[256];
+	int lineno = 0;
+	int n = 0;
+
+	while (fgets(line, sizeof(line), in)) {
+		lineno++;
+
+		char *p = line + strspn(line, " \t");
+		if (*p == '#' || *p == '\n' || *p == '\0') {
+			continue;
+		}
+		if (n == MAX_LINES) {
+			log_error("Profile line %d: more than %d writes", lineno, MAX_LINES);
+			return -1;
+		}
+
+		struct profile_line *l = &lines[n];
+		l->flag = ' ';
+		if (*p == '?' || *p == '!') {
+			l->flag = *p++;
+		}
+		if (sscanf(p, "%63s %32s", l->name, l->value) != 2 || !attr_name_valid(l->name)) {
+			log_error("Profile line %d: expected '[?|!]ATTRIBUTE VALUE'", lineno);
+			return -1;
+		}
+		l->lineno = lineno;
+		l->write = true;
+		n++;
+	}
+	return n;
+}
+
+/*
+ * load_plan() - Load a compiled plan (nct-plan.h) into lines[]
+ * WHY:  Everything load_profile() checks was checked by the compiler; this
+ *       only verifies the image (magic, geometry, checksum) and copies
+ * RETURNS: number of lines, or -1 on a damaged plan
+ */
+static int load_plan(FILE *in) {
+	static struct nct_plan_entry entries[NCT_PLAN_MAX];
+	struct nct_plan_header hdr;
+
+	int n = nct_plan_read(in, &hdr, entries, NCT_PLAN_MAX);
+	if (n < 0) {
+		log_error("Damaged or incompatible plan (recompile with nct-profile --compile)");
+		return -1;
+	}
+
+	struct stat st;
+	if (hdr.source[0] && stat(hdr.source, &st) == 0 &&
+	    ((int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec != hdr.source_mtime_ns ||
+	     (int64_t)st.st_size != hdr.source_size)) {
+		log_warn("Plan is older than %s; applying it anyway (recompile with nct-profile --compile)",
+			 hdr.source);
+	}
+
+	for (int i = 0; i < n; ++i) {
+		lines[i].flag = entries[i].flag;
+		memcpy(lines[i].name, entries[i].name, sizeof(lines[i].name));
+		memcpy(lines[i].value, entries[i].value, sizeof(lines[i].value));
+		lines[i].lineno = i + 1;
+		lines[i].write = true;
+	}
+	return n;
+}
+
+/*
+ * broker_open() - Connect to nct-broker if it is running
+ * WHY: Silent when there is no broker: direct sysfs writes are the normal
+ *      mode on machines that do not run nct-broker.service
+ */
+static void broker_open(const char *hwmon) {
+	int fd = nct_broker_connect(nct_broker_path());
+	if (fd < 0) {
+		if (verbose) {
+			log_info("nct-fan: no broker at %s (%s); writing sysfs directly", nct_broker_path(),
+				 strerror(-fd));
+		}
+		return;
+	}
+	broker_fd = fd;
+	broker_hwmon = hwmon;
+}
+
+/*
+ * broker_submit() - Send ops[nops] as one request
+ * RETURNS: 0 with res[] filled; -1 after dropping the connection, so the
+ *          caller (and every later call) uses sysfs directly
+ */
+static int broker_submit(const struct nct_broker_op *ops, int nops, struct nct_broker_result *res) {
+	int rc = nct_broker_call(broker_fd, broker_hwmon, 0, ops, (uint32_t)nops, res);
+	if (rc == 0) {
+		return 0;
+	}
+	if (rc == -EXDEV || rc == -EPERM) {
+		if (verbose) {
+			log_info("nct-fan: broker refused the request (%s); writing sysfs directly", strerror(-rc));
+		}
+	} else {
+		log_warn("nct-broker unavailable (%s); writing sysfs directly", strerror(-rc));
+	}
+	close(broker_fd);
+	broker_fd = -1;
+	return -1;
+}
+
+/*
+ * broker_prefetch() - --reconcile: read every wanted line in one request
+ * IN:  want[i] marks the lines reconcile_plan() will compare
+ * OUT: broker_read[i] for those lines; broker_have_reads on success
+ */
+static void broker_prefetch(const struct profile_line *pl, int n, const bool *want) {
+	static struct nct_broker_op ops[MAX_LINES];
+	static struct nct_broker_result res[MAX_LINES];
+	int nops = 0;
+
+	for (int i = 0; i < n; ++i) {
+		if (want[i]) {
+			nct_broker_op_set(&ops[nops++], NCT_BROKER_READ, ' ', pl[i].name, NULL);
+		}
+	}
+	if (nops == 0 || broker_submit(ops, nops, res) < 0) {
+		return;
+	}
+	for (int i = 0, k = 0; i < n; ++i) {
+		if (want[i]) {
+			broker_read[i] = res[k++];
+		}
+	}
+	broker_have_reads = true;
+}
+
+/*
+ * attr_read() - Read an attribute's current value through its cached fd
+ * RETURNS: 0 with the trimmed text in buf, -errno on failure
+ */
+static int attr_read(int dirfd, const char *name, char *buf, size_t len) {
+	int fd = attr_open(dirfd, name);
+	if (fd < 0) {
+		return fd;
+	}
+	uint64_t t = nct_stats_begin();
+	ssize_t n = pread(fd, buf, len - 1, 0);
+	nct_stats_end(NCT_OP_SYSFS_READ, t);
+	if (n < 0) {
+		return -errno;
+	}
+	buf[n] = '\0';
+	buf[strcspn(buf, "\n")] = '\0';
+	return 0;
+}
+
+/*
+ * value_equal() - Compare a profile value with the text read back
+ * WHY: "0800" and "800" are the same setting; non-numeric values (none in
+ *      nct6775 today) fall back to an exact string match
+ */
+static bool value_equal(const char *want, const char *have) {
+	char *end_w, *end_h;
+	long w = strtol(want, &end_w, 10);
+	long h = strtol(have, &end_h, 10);
+	if (end_w != want && *end_w == '\0' && end_h != have && *end_h == '\0') {
+		return w == h;
+	}
+	return strcmp(want, have) == 0;
+}
+
+/*
+ * reconcile_plan() - Clear write on every line the chip already satisfies
+ * STRATEGY:
+ *   1. Read every distinct attribute once, before any write
+ *   2. Only the last write of an attribute is its desired value; earlier
+ *      writes (the enable 0 of a gate ... enable 5 pair) are transitional
+ *   3. A channel (pwmN / fanN) is "dirty" when any attribute other than a
+ *      gate attribute drifted; only dirty channels get their gate write and
+ *      the final gate-attribute write that re-enables the header
+ *   4. Clean channels only rewrite a drifted gate attribute (e.g. firmware
+ *      dropped pwm1_enable to 1 but the curve is intact): no enable=0 blip
+ *   An unreadable required attribute counts as drifted, so the write is
+ *   attempted and reported exactly as --apply would report it; an
+ *   unreadable optional ('?') one (not implemented on this chip) is left
+ *   alone, otherwise it would re-gate its header on every run
+ * RETURNS: number of drifted attributes
+ */
+static int reconcile_plan(int dirfd, struct profile_line *pl, int n, int *checked) {
+	static bool drifted[MAX_LINES];     /* per line: attribute's final value differs */
+	static bool last[MAX_LINES];        /* line is the attribute's last write */
+	static bool gate_attr[MAX_LINES];   /* attribute is written by some '!' line */
+	int drift_count = 0;
+
+	*checked = 0;
+	for (int i = 0; i < n; ++i) {
+		last[i] = true;
+		gate_attr[i] = false;
+		for (int j = 0; j < n; ++j) {
+			if (strcmp(pl[i].name, pl[j].name) != 0) {
+				continue;
+			}
+			if (j > i) {
+				last[i] = false;
+			}
+			if (pl[j].flag == '!') {
+				gate_attr[i] = true;
+			}
+		}
+	}
+
+	if (broker_fd >= 0) {
+		static bool compare[MAX_LINES];
+		for (int i = 0; i < n; ++i) {
+			compare[i] = last[i] && pl[i].flag != '!';
+		}
+		broker_prefetch(pl, n, compare);
+	}
+
+	for (int i = 0; i < n; ++i) {
+		drifted[i] = false;
+		if (!last[i] || pl[i].flag == '!') {
+			continue;
+		}
+		char have[MAX_VALUE + 1];
+		(*checked)++;
+		int rc;
+		if (broker_have_reads) {
+			rc = broker_read[i].rc;
+			snprintf(have, sizeof(have), "%s", broker_read[i].value);
+		} else {
+			rc = attr_read(dirfd, pl[i].name, have, sizeof(have));
+		}
+		if (rc < 0 && pl[i].flag == '?') {
+			if (verbose) {
+				log_info("  skip: %s (%s)", pl[i].name, strerror(-rc));
+			}
+			continue;
+		}
+		if (rc < 0 || !value_equal(pl[i].value, have)) {
+			drifted[i] = true;
+			drift_count++;
+			if (verbose) {
+				log_info("  drift: %s", pl[i].name);
+			}
+		}
+	}
+
+	for (int i = 0; i < n; ++i) {
+		char channel[MAX_ATTR_NAME];
+		attr_channel(pl[i].name, channel, sizeof(channel));
+
+		bool dirty = false;
+		for (int j = 0; j < n && !dirty; ++j) {
+			char other[MAX_ATTR_NAME];
+			attr_channel(pl[j].name, other, sizeof(other));
+			dirty = drifted[j] && !gate_attr[j] && strcmp(channel, other) == 0;
+		}
+
+		if (pl[i].flag == '!') {
+			pl[i].write = dirty;
+		} else if (!last[i]) {
+			pl[i].write = false;
+		} else if (gate_attr[i]) {
+			pl[i].write = dirty || drifted[i];
+		} else {
+			pl[i].write = drifted[i];
+		}
+	}
+	return drift_count;
+}
+
+/*
+ * run_profile() - Write every line still marked for writing
+ * STRATEGY:
+ *   1. Through the broker: all writes as one request; the broker applies
+ *      the gate skips and answers -ECANCELED for skipped lines
+ *   2. Directly: honour gate skips per channel here
+ *   3. Report each failure immediately, in profile order
+ * RETURNS: number of failed required writes (a failed gate only warns and
+ *          skips its header); *writes gets the number of successful writes
+ */
+static int run_profile(int dirfd, const struct profile_line *pl, int n, int *writes) {
+	static struct nct_broker_op ops[MAX_LINES];
+	static struct nct_broker_result res[MAX_LINES];
+	char skip_channel[MAX_ATTR_NAME] = "";
+	int failures = 0;
+
+	int nops = 0;
+	for (int i = 0; broker_fd >= 0 && i < n; ++i) {
+		if (pl[i].write) {
+			nct_broker_op_set(&ops[nops++], NCT_BROKER_WRITE, pl[i].flag, pl[i].name, pl[i].value);
+		}
+	}
+	bool brokered = nops > 0 && broker_submit(ops, nops, res) == 0;
+
+	*writes = 0;
+	for (int i = 0, k = 0; i < n; ++i) {
+		const struct profile_line *l = &pl[i];
+		if (!l->write) {
+			continue;
+		}
+
+		char channel[MAX_ATTR_NAME];
+		attr_channel(l->name, channel, sizeof(channel));
+		int rc;
+		if (brokered) {
+			rc = res[k++].rc;
+			if (rc == -ECANCELED) {
+				continue;
+			}
+		} else {
+			if (skip_channel[0] != '\0' && strcmp(channel, skip_channel) == 0) {
+				continue;
+			}
+			skip_channel[0] = '\0';
+			rc = attr_write(dirfd, l->name, l->value);
+		}
+		if (rc == 0) {
+			(*writes)++;
+			if (verbose) {
+				log_info("  %s = %s", l->name, l->value);
+			}
+			continue;
+		}
+
+		switch (l->flag) {
+		case '?':
+			log_warn("Cannot set %s=%s (%s)", l->name, l->value, strerror(-rc));
+			break;
+		case '!':
+			log_warn("Cannot set %s=%s (%s); skipping %s", l->name, l->value,
+				 strerror(-rc), channel);
+			snprintf(skip_channel, sizeof(skip_channel), "%s", channel);
+			break;
+		default:
+			log_error("Failed to set %s=%s (%s)", l->name, l->value, strerror(-rc));
+			failures++;
+			break;
+		}
+	}
+	return failures;
+}
+
+/*
+ * apply_profile() - Parse a profile stream and apply (or reconcile) it
+ * RETURNS: number of counted failures, or -1 on parse error
+ */
+static int apply_profile(FILE *in, int dirfd, bool reconcile) {
+	int c = getc(in);
+	if (c != EOF) {
+		ungetc(c, in);
+	}
+	int n = c == NCT_PLAN_MAGIC[0] ? load_plan(in) : load_profile(in);
+	if (n < 0) {
+		return -1;
+	}
+
+	uint64_t t = nct_stats_begin();
+	int checked = 0;
+	int drifted = reconcile ? reconcile_plan(dirfd, lines, n, &checked) : 0;
+
+	int writes;
+	int failures = run_profile(dirfd, lines, n, &writes);
+	nct_stats_end(NCT_OP_APPLY, t);
+
+	if (reconcile) {
+		log_info("nct-fan: reconcile checked %d attributes, %d drifted, %d writes, %d failures%s",
+			 checked, drifted, writes, failures, broker_fd >= 0 ? " (via nct-broker)" : "");
+	} else if (verbose) {
+		log_info("nct-fan: %d writes, %d attributes opened, %d failures%s",
+			 writes, attr_count, failures, broker_fd >= 0 ? " (via nct-broker)" : "");
+	}
+	return failures;
+}
+
+/*
+ * snapshot_wanted() - Is this attribute part of the programmed fan control?
+ * WHAT: Every pwmN / pwmN_* attribute (duty, enable, mode, curve points,
+ *       timing, temp source, weighting, cruise targets) plus fanN_pulses,
+ *       fanN_target and fanN_tolerance
+ * WHY:  Alarm limits, beep masks and intrusion flags are writable too but
+ *       are not fan control; clearing intrusion0_alarm on resume would be
+ *       a side effect nobody asked for
+ */
+static bool snapshot_wanted(int dirfd, const char *name) {
+	static const char *const fan_suffixes[] = {"_pulses", "_target", "_tolerance"};
+
+	bool wanted = strncmp(name, "pwm", 3) == 0 && name[3] >= '1' && name[3] <= '9';
+	if (!wanted && strncmp(name, "fan", 3) == 0 && strchr(name, '_')) {
+		for (size_t i = 0; i < sizeof(fan_suffixes) / sizeof(fan_suffixes[0]); ++i) {
+			wanted |= strcmp(strchr(name, '_'), fan_suffixes[i]) == 0;
+		}
+	}
+
+	struct stat st;
+	return wanted && strlen(name) < MAX_ATTR_NAME && fstatat(dirfd, name, &st, 0) == 0 &&
+	       S_ISREG(st.st_mode) && (st.st_mode & S_IWUSR);
+}
+
+static int name_cmp(const void *a, const void *b) {
+	return strcmp(a, b);
+}
+
+/*
+ * snapshot() - --snapshot: print the current fan-control state as a profile
+ * WHEN: systemd-sleep "pre" hook (scripts/nct-fan-sleep.sh), so "post" can
+ *       restore it with one `nct-fan --reconcile` pass
+ * HOW:  Writable attributes sorted by name (groups pwmN, pwmN_* together),
+ *       each read once; per channel the output is gate, values, enable,
+ *       and the manual duty last (the driver only honours pwmN in mode 1)
+ * RETURNS: 0, 1 if nothing was captured
+ */
+static int snapshot(int dirfd, const char *hwmon) {
+	static char names[MAX_ATTRS][MAX_ATTR_NAME];
+	int n = 0;
+
+	int dup_fd = dup(dirfd);
+	DIR *dir = dup_fd >= 0 ? fdopendir(dup_fd) : NULL;
+	if (!dir) {
+		log_error("Cannot list %s: %s", hwmon, strerror(errno));
+		if (dup_fd >= 0) {
+			close(dup_fd);
+		}
+		return 1;
+	}
+	struct dirent *de;
+	while (n < MAX_ATTRS && (de = readdir(dir)) != NULL) {
+		if (snapshot_wanted(dirfd, de->d_name)) {
+			memcpy(names[n++], de->d_name, strlen(de->d_name) + 1);
+		}
+	}
+	closedir(dir);
+	qsort(names, (size_t)n, sizeof(names[0]), name_cmp);
+
+	time_t now = time(NULL);
+	char stamp[32];
+	strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%S%z", localtime(&now));
+	printf("# nct-fan snapshot of %s at %s\n", hwmon, stamp);
+
+	int captured = 0;
+	for (int i = 0; i < n;) {
+		char channel[MAX_ATTR_NAME];
+		attr_channel(names[i], channel, sizeof(channel));
+		int j = i;
+		int enable = -1;
+		int duty = -1;
+		for (; j < n; ++j) {
+			char other[MAX_ATTR_NAME];
+			attr_channel(names[j], other, sizeof(other));
+			if (strcmp(channel, other) != 0) {
+				break;
+			}
+			const char *suffix = names[j] + strlen(channel);
+			if (strcmp(suffix, "_enable") == 0) {
+				enable = j;
+			} else if (*suffix == '\0') {
+				duty = j;
+			}
+		}
+
+		char enable_val[MAX_VALUE + 1] = "";
+		if (enable >= 0 && attr_read(dirfd, names[enable], enable_val, sizeof(enable_val)) == 0) {
+			printf("!%s 0\n", names[enable]);
+		} else {
+			enable = -1;
+		}
+		for (int k = i; k < j; ++k) {
+			char value[MAX_VALUE + 1];
+			if (k == enable || k == duty) {
+				continue;
+			}
+			if (attr_read(dirfd, names[k], value, sizeof(value)) < 0 || !value[0]) {
+				if (verbose) {
+					fprintf(stderr, "[WARN] Cannot read %s; not captured\n", names[k]);
+				}
+				continue;
+			}
+			printf("?%s %s\n", names[k], value);
+			captured++;
+		}
+		if (enable >= 0) {
+			printf("%s %s\n", names[enable], enable_val);
+			captured++;
+		}
+		char value[MAX_VALUE + 1];
+		if (duty >= 0 && (enable < 0 || strcmp(enable_val, "1") == 0) &&
+		    attr_read(dirfd, names[duty], value, sizeof(value)) == 0) {
+			printf("?%s %s\n", names[duty], value);
+			captured++;
+		}
+		i = j;
+	}
+
+	if (verbose) {
+		fprintf(stderr, "[INFO] nct-fan: snapshot captured %d attributes\n", captured);
+	}
+	return captured > 0 ? 0 : 1;
+}
+
+/*
+ * Channel indices --verify reports, one bit per index (tempN, pwmN, fanN)
+ * WHY: nct6775 numbers at most 10 temps, 7 headers and 7 tachs
+ */
+#define VERIFY_INDEX_MAX 31
+
+struct verify_set {
+	uint32_t temp, pwm, fan;
+};
+
+/*
+ * verify_scan() - Collect the channel indices present in the hwmon directory
+ * HOW:  One readdir pass; tempN_input, pwmN and fanN_input define a channel,
+ *       every other attribute of it is read by name afterwards
+ * RETURNS: 0, or -1 (errno set) if the directory cannot be listed
+ */
+static int verify_scan(int dirfd, struct verify_set *set) {
+	int dup_fd = dup(dirfd);
+	DIR *dir = dup_fd >= 0 ? fdopendir(dup_fd) : NULL;
+	if (!dir) {
+		int saved = errno;
+		if (dup_fd >= 0) {
+			close(dup_fd);
+		}
+		errno = saved;
+		return -1;
+	}
+
+	memset(set, 0, sizeof(*set));
+	struct dirent *de;
+	while ((de = readdir(dir)) != NULL) {
+		unsigned idx;
+		int end = 0;
+		if (sscanf(de->d_name, "temp%u_input%n", &idx, &end) == 1 && de->d_name[end] == '\0' && end) {
+			set->temp |= idx <= VERIFY_INDEX_MAX ? 1u << idx : 0;
+		} else if (sscanf(de->d_name, "pwm%u%n", &idx, &end) == 1 && de->d_name[end] == '\0') {
+			set->pwm |= idx <= VERIFY_INDEX_MAX ? 1u << idx : 0;
+		} else if (sscanf(de->d_name, "fan%u_input%n", &idx, &end) == 1 && de->d_name[end] == '\0' && end) {
+			set->fan |= idx <= VERIFY_INDEX_MAX ? 1u << idx : 0;
+		}
+	}
+	closedir(dir);
+	return 0;
+}
+
+/*
+ * verify_long() - Read a numeric attribute
+ * RETURNS: true with the value in *out, false if absent or not a number
+ */
+static bool verify_long(int dirfd, const char *fmt, unsigned idx, long *out) {
+	char name[MAX_ATTR_NAME], buf[MAX_VALUE + 1], *end;
+	snprintf(name, sizeof(name), fmt, idx);
+	if (attr_read(dirfd, name, buf, sizeof(buf)) < 0) {
+		return false;
+	}
+	*out = strtol(buf, &end, 10);
+	return end != buf;
+}
+
+/*
+ * pwm_mode_name() - pwmN_enable value to the names the shell report used
+ * WHY: Same strings as nct-exporter's nct_pwm_mode label, so dashboards
+ *      and inventory joins agree
+ */
+static const char *pwm_mode_name(long mode) {
+	switch (mode) {
+	case 0: return "disabled";
+	case 1: return "manual";
+	case 2: return "thermal-cruise";
+	case 3: return "speed-cruise";
+	case 5: return "SmartFan-IV";
+	default: return "unknown";
+	}
+}
+
+static void json_str(const char *s) {
+	if (!s || !*s) {
+		fputs("null", stdout);
+		return;
+	}
+	putchar('"');
+	for (; *s; ++s) {
+		if (*s == '"' || *s == '\\') {
+			printf("\\%c", *s);
+		} else if ((unsigned char)*s < 0x20) {
+			printf("\\u%04x", (unsigned char)*s);
+		} else {
+			putchar(*s);
+		}
+	}
+	putchar('"');
+}
+
+static void json_long(const char *key, bool ok, long v) {
+	if (ok) {
+		printf(",\"%s\":%ld", key, v);
+	} else {
+		printf(",\"%s\":null", key);
+	}
+}
+
+/*
+ * verify() - --verify: report chip, temperatures, headers and tachs
+ * WHEN: max-fans-advanced.sh --verify, max-fans-enhanced.sh --verify, and
+ *       fleet health checks that want the state without a shell per value
+ * HOW:  verify_scan() once, then every value through the cached dirfd
+ *       reads; nothing is written (open_flags is O_RDONLY)
+ * OUT:  Text: the sections verify_and_report() printed. JSON (one line):
+ *         {"schema":1,"hwmon":PATH,"name":NAME,
+ *          "temps":[{"index":N,"label":S|null,"input":MILLIDEG|null}],
+ *          "pwm":[{"index":N,"duty":0-255|null,"enable":N|null,
+ *                  "mode":S|null,"electrical":"DC"|"PWM"|null,
+ *                  "temp_sel":N|null}],
+ *          "fans":[{"index":N,"input":RPM|null,"pulses":N|null}]}
+ *       Keys are only ever added; "schema" is bumped if one changes meaning
+ * RETURNS: 0, 1 if the device exposes no channel at all, 2 if unlistable
+ */
+static int verify(int dirfd, const char *hwmon, bool json) {
+	struct verify_set set;
+	if (verify_scan(dirfd, &set) < 0) {
+		log_error("Cannot list %s: %s", hwmon, strerror(errno));
+		return 2;
+	}
+
+	char chip[MAX_VALUE + 1] = "";
+	attr_read(dirfd, "name", chip, sizeof(chip));
+
+	if (json) {
+		fputs("{\"schema\":1,\"hwmon\":", stdout);
+		json_str(hwmon);
+		fputs(",\"name\":", stdout);
+		json_str(chip);
+		fputs(",\"temps\":[", stdout);
+	} else {
+		log_info("Found %s at %s", chip[0] ? chip : "unknown", hwmon);
+		log_info("%s", "");
+		log_info("Temperature Sensors:");
+	}
+
+	bool first = true;
+	for (unsigned i = 1; i <= VERIFY_INDEX_MAX; ++i) {
+		if (!(set.temp & 1u << i)) {
+			continue;
+		}
+		char name[MAX_ATTR_NAME], label[MAX_VALUE + 1] = "";
+		snprintf(name, sizeof(name), "temp%u_label", i);
+		attr_read(dirfd, name, label, sizeof(label));
+		long input;
+		bool have = verify_long(dirfd, "temp%u_input", i, &input);
+		if (json) {
+			printf("%s{\"index\":%u,\"label\":", first ? "" : ",", i);
+			json_str(label);
+			json_long("input", have, input);
+			putchar('}');
+		} else if (have) {
+			log_info("  temp%u: %s %.1f°C (raw: %ld)", i, label[0] ? label : "-", input / 1000.0, input);
+		} else {
+			log_info("  temp%u: %s (unreadable)", i, label[0] ? label : "-");
+		}
+		first = false;
+	}
+	if (!json && first) {
+		log_info("  (none found)");
+	}
+
+	if (json) {
+		fputs("],\"pwm\":[", stdout);
+	} else {
+		log_info("%s", "");
+		log_info("SmartFan IV State (current):");
+	}
+	first = true;
+	for (unsigned i = 1; i <= VERIFY_INDEX_MAX; ++i) {
+		if (!(set.pwm & 1u << i)) {
+			continue;
+		}
+		long duty, enable, mode, sel;
+		bool have_duty = verify_long(dirfd, "pwm%u", i, &duty);
+		bool have_enable = verify_long(dirfd, "pwm%u_enable", i, &enable);
+		bool have_mode = verify_long(dirfd, "pwm%u_mode", i, &mode);
+		bool have_sel = verify_long(dirfd, "pwm%u_temp_sel", i, &sel);
+		if (json) {
+			printf("%s{\"index\":%u", first ? "" : ",", i);
+			json_long("duty", have_duty, duty);
+			json_long("enable", have_enable, enable);
+			fputs(",\"mode\":", stdout);
+			json_str(have_enable ? pwm_mode_name(enable) : NULL);
+			fputs(",\"electrical\":", stdout);
+			json_str(have_mode ? (mode ? "PWM" : "DC") : NULL);
+			json_long("temp_sel", have_sel, sel);
+			putchar('}');
+		} else {
+			char duty_txt[24] = "?", mode_txt[32] = "mode=?";
+			if (have_duty) {
+				snprintf(duty_txt, sizeof(duty_txt), "%ld", duty);
+			}
+			if (have_enable && strcmp(pwm_mode_name(enable), "unknown") == 0) {
+				snprintf(mode_txt, sizeof(mode_txt), "mode=%ld, unknown(%ld)", enable, enable);
+			} else if (have_enable) {
+				snprintf(mode_txt, sizeof(mode_txt), "mode=%ld, %s", enable, pwm_mode_name(enable));
+			}
+			log_info("  pwm%u: %s/255 (%s)", i, duty_txt, mode_txt);
+		}
+		first = false;
+	}
+
+	if (!json) {
+		log_info("%s", "");
+		log_info("Electrical Modes (DC=0, PWM=1):");
+		for (unsigned i = 1; i <= VERIFY_INDEX_MAX; ++i) {
+			long mode;
+			if (set.pwm & 1u << i && verify_long(dirfd, "pwm%u_mode", i, &mode)) {
+				log_info("  pwm%u_mode: %ld (%s)", i, mode, mode ? "PWM" : "DC");
+			}
+		}
+		log_info("%s", "");
+		log_info("Tachometry (RPM, pulses per rev):");
+	} else {
+		fputs("],\"fans\":[", stdout);
+	}
+	first = true;
+	for (unsigned i = 1; i <= VERIFY_INDEX_MAX; ++i) {
+		if (!(set.fan & 1u << i)) {
+			continue;
+		}
+		long rpm, pulses;
+		bool have_rpm = verify_long(dirfd, "fan%u_input", i, &rpm);
+		bool have_pulses = verify_long(dirfd, "fan%u_pulses", i, &pulses);
+		if (json) {
+			printf("%s{\"index\":%u", first ? "" : ",", i);
+			json_long("input", have_rpm, rpm);
+			json_long("pulses", have_pulses, pulses);
+			putchar('}');
+		} else {
+			char rpm_txt[24] = "?", ppr_txt[24] = "?";
+			if (have_rpm) {
+				snprintf(rpm_txt, sizeof(rpm_txt), "%ld", rpm);
+			}
+			if (have_pulses) {
+				snprintf(ppr_txt, sizeof(ppr_txt), "%ld", pulses);
+			}
+			log_info("  fan%u: %s RPM (pulses=%s)", i, rpm_txt, ppr_txt);
+		}
+		first = false;
+	}
+	if (json) {
+		fputs("]}\n", stdout);
+	}
+
+	return set.temp | set.pwm | set.fan ? 0 : 1;
+}
+
+static void usage(FILE *out) {
+	fprintf(out,
+		"Usage: nct-fan --apply PROFILE HWMON_DIR [--verbose] [--stats] [--direct]\n"
+		"       nct-fan --reconcile PROFILE HWMON_DIR [--verbose] [--stats] [--direct]\n"
+		"       nct-fan --snapshot HWMON_DIR [--verbose] [--stats]\n"
+		"       nct-fan --verify [HWMON_DIR] [--json] [--stats]\n"
+		"       nct-fan --resolve [--refresh] [--verbose]\n"
+		"  PROFILE    profile file ('-' = stdin), lines of '[?|!]ATTRIBUTE VALUE',\n"
+		"             or a plan compiled by nct-profile --compile\n"
+		"  HWMON_DIR  hwmon device directory, e.g. /sys/class/hwmon/hwmon4\n"
+		"  --reconcile  read current values first; write only drifted attributes\n"
+		"  --direct   write sysfs even when nct-broker is running\n"
+		"  --snapshot   print the current fan-control state as a profile\n"
+		"  --verify   report temps, headers and tachs (default: resolved device)\n"
+		"  --json     --verify as one JSON object (schema 1)\n"
+		"  --resolve  print the NCT67xx hwmon directory (cached in %s)\n"
+		"  --refresh  rescan /sys/class/hwmon and rewrite the cache\n"
+		"  --stats    print per-operation latency histograms to stderr on exit\n",
+		HWMON_CACHE_PATH);
+}
+
+/*
+ * resolve() - --resolve: print the hwmon directory for the shell scripts
+ * WHY: stdout carries only the path so callers can use $(nct-fan --resolve);
+ *      --verbose details go to stderr
+ */
+static int resolve(unsigned flags) {
+	struct hwmon_resolution res;
+	if (hwmon_resolve(&res, flags) < 0) {
+		log_error("No %s* hwmon device under %s (is nct6775 loaded?)",
+			  HWMON_NAME_PREFIX, HWMON_CLASS_PATH);
+		return 1;
+	}
+	if (verbose) {
+		fprintf(stderr, "[INFO] %s at %s (%s, %s)\n", res.name, res.hwmon, res.platform,
+			res.cached ? "cached" : "rescanned");
+	}
+	printf("%s\n", res.hwmon);
+	return 0;
+}
+
+/*
+ * main() - Entry point
+ * STRATEGY:
+ *   1. Open the hwmon directory once (O_DIRECTORY) as the dirfd for openat()
+ *   2. Load the profile and apply (or reconcile) it through apply_profile()
+ *   3. Exit 0/1/2 per the EXIT STATUS contract above
+ */
+int main(int argc, char **argv) {
+	const char *profile = NULL;
+	const char *hwmon = NULL;
+	bool do_resolve = false;
+	bool reconcile = false;
+	const char *snapshot_dir = NULL;
+	bool do_verify = false;
+	const char *verify_dir = NULL;
+	bool json = false;
+	bool direct = false;
+	unsigned resolve_flags = 0;
+
+	for (int i = 1; i < argc; ++i) {
+		if ((strcmp(argv[i], "--apply") == 0 || strcmp(argv[i], "--reconcile") == 0) && i + 2 < argc) {
+			reconcile = strcmp(argv[i], "--reconcile") == 0;
+			profile = argv[++i];
+			hwmon = argv[++i];
+		} else if (strcmp(argv[i], "--snapshot") == 0 && i + 1 < argc) {
+			snapshot_dir = argv[++i];
+		} else if (strcmp(argv[i], "--verify") == 0) {
+			do_verify = true;
+			if (i + 1 < argc && argv[i + 1][0] != '-') {
+				verify_dir = argv[++i];
+			}
+		} else if (strcmp(argv[i], "--json") == 0) {
+			json = true;
+		} else if (strcmp(argv[i], "--direct") == 0) {
+			direct = true;
+		} else if (strcmp(argv[i], "--resolve") == 0) {
+			do_resolve = true;
+		} else if (strcmp(argv[i], "--refresh") == 0) {
+			resolve_flags |= HWMON_RESOLVE_REFRESH;
+		} else if (strcmp(argv[i], "--verbose") == 0 || strcmp(argv[i], "-v") == 0) {
+			verbose = true;
+		} else if (strcmp(argv[i], "--stats") == 0) {
+			show_stats = true;
+		} else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+			usage(stdout);
+			return 0;
+		} else {
+			usage(stderr);
+			return 2;
+		}
+	}
+
+	if (do_resolve && !profile) {
+		return resolve(resolve_flags);
+	}
+	if (do_verify && !profile && !snapshot_dir) {
+		struct hwmon_resolution res;
+		if (!verify_dir) {
+			if (hwmon_resolve(&res, resolve_flags) < 0) {
+				log_error("No %s* hwmon device under %s (is nct6775 loaded?)",
+					  HWMON_NAME_PREFIX, HWMON_CLASS_PATH);
+				return 1;
+			}
+			verify_dir = res.hwmon;
+		}
+		int dirfd = open(verify_dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if (dirfd < 0) {
+			log_error("Cannot open hwmon directory %s: %s", verify_dir, strerror(errno));
+			return 2;
+		}
+		open_flags = O_RDONLY;
+		int rc = verify(dirfd, verify_dir, json);
+		close(dirfd);
+		if (show_stats) {
+			nct_stats_print(stderr, &nct_stats);
+		}
+		return rc;
+	}
+	if (snapshot_dir && !profile) {
+		int dirfd = open(snapshot_dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if (dirfd < 0) {
+			log_error("Cannot open hwmon directory %s: %s", snapshot_dir, strerror(errno));
+			return 2;
+		}
+		open_flags = O_RDONLY;
+		int rc = snapshot(dirfd, snapshot_dir);
+		close(dirfd);
+		if (show_stats) {
+			nct_stats_print(stderr, &nct_stats);
+		}
+		return rc;
+	}
+	if (!profile || !hwmon) {
+		usage(stderr);
+		return 2;
+	}
+
+	if (reconcile) {
+		open_flags = O_RDWR;
+	}
+	int dirfd = open(hwmon, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dirfd < 0) {
+		log_error("Cannot open hwmon directory %s: %s", hwmon, strerror(errno));
+		return 2;
+	}
+
+	FILE *in = strcmp(profile, "-") == 0 ? stdin : fopen(profile, "r");
+	if (!in) {
+		log_error("Cannot open profile %s: %s", profile, strerror(errno));
+		close(dirfd);
+		return 2;
+	}
+	if (!direct) {
+		broker_open(hwmon);
+	}
+
+	int failures = apply_profile(in, dirfd, reconcile);
+
+	if (in != stdin) {
+		fclose(in);
+	}
+	for (int i = 0; i < attr_count; ++i) {
+		if (attr_cache[i].fd >= 0) {
+			close(attr_cache[i].fd);
+		}
+	}
+	if (broker_fd >= 0) {
+		close(broker_fd);
+	}
+	close(dirfd);
+
+	if (show_stats) {
+		nct_stats_print(stderr, &nct_stats);
+	}
+	if (failures < 0) {
+		return 2;
+	}
+	return failures == 0 ? 0 : 1;
+}
+
+/*
+ * BUILD & DEPLOYMENT NOTES:
+ *
+ * Compilation:
+ *   gcc -std=c23 -O2 -Wall -Wextra -Werror -o nct-fan nct-fan.c nct-hwmon.c nct-stats.c
+ *
+ * Installation (in PKGBUILD):
+ *   install -Dm755 nct-fan "$pkgdir/usr/lib/eirikr/nct-fan"
+ *
+ * Callers:
+ *   max-fans-advanced.sh builds a profile per subcommand and pipes it to
+ *   `nct-fan --apply - "$hwmon"`; one process replaces every `sudo tee`.
+ *   With MAX_FANS_MODE=reconcile (max-fans-restore.service) the same
+ *   profiles go through `nct-fan --reconcile - "$hwmon"` instead.
+ *   max-fans*.sh read /run/nct-hwmon.cache and fall back to
+ *   `nct-fan --resolve` when it is missing or stale.
+ *   max-fans-advanced.sh --verify and max-fans-enhanced.sh --verify run
+ *   `nct-fan --verify "$hwmon"` and keep their shell loops only as the
+ *   fallback when nct-fan is not built.
+ *   max-fans.sh and max-fans-enhanced.sh --manual / --smartfan pipe their
+ *   writes to `nct-fan --apply -` too, so with nct-broker.service running
+ *   every shell path is serialized by the broker.
+ */
@@ -0,0 +1,1234 @@
+/*
+ * nct-fanctl.c - Closed-loop userspace fan controller for NCT6798D headers
+ *
+ * PURPOSE:
+ *   Drive chosen fan headers (pwmN in manual mode) from temperatures the
+ *   chip cannot see: GPU (amdgpu/nouveau), NVMe, k10temp, or any other
+ *   hwmon input, with a curve or a PID loop per header at a fixed cadence.
+ *
+ * WHY THIS EXISTS:
+ *   SmartFan IV and Thermal Cruise (set_smartfan_7pt(), set_thermal_cruise()
+ *   in max-fans-advanced.sh) run on the chip and can only follow the chip's
+ *   own temperature sources (pwmN_temp_sel). The hottest parts of the box
+ *   report through other drivers, so a header that should follow the GPU
+ *   has to be closed in userspace.
+ *
+ * HOW:
+ *   1. Parse the config; resolve every source once ("amdgpu/temp1_input"
+ *      -> /sys/class/hwmon/hwmonN/temp1_input) and keep an fd open per
+ *      source. While nct-sampler publishes its ring (--ring) and is
+ *      current, sources are read from its newest sample by channel name
+ *      ("temp1_input" for the nct67xx chip, "amdgpu/temp1_input" for a
+ *      --device); otherwise, or for a channel the ring does not carry,
+ *      the fd is re-read with pread(2) like nct-sampler
+ *   2. Save each controlled header's pwmN_enable/pwmN, switch it to manual
+ *      (pwmN_enable=1)
+ *   3. Every tick of a CLOCK_MONOTONIC timerfd: read sources (hottest wins),
+ *      run the header's curve or PID, clamp to [min, max]
+ *   4. Optional feed-forward: package power and CPU utilization rise
+ *      seconds before any temperature does. Their lead over a slow average
+ *      (time constant tau) raises a header's duty floor or shifts its
+ *      curve input up, and decays to nothing once the load is steady
+ *   5. Write pwmN only when the duty moved by at least `deadband`; every
+ *      other tick costs reads only. A steady box writes nothing at all
+ *   6. On SIGINT/SIGTERM restore every header's saved mode and duty, so
+ *      the chip's own curve takes over again
+ *
+ * CONFIG (default /usr/local/etc/nct-fanctl.conf; '#' comments):
+ *   interval MS                       tick period, 100-10000 (default 1000)
+ *   pwmN key=value ...                one line per controlled header
+ *     source=SRC[,SRC...]             hwmon_name/attribute or absolute path;
+ *                                     the hottest source drives the header
+ *     curve=T:D[,T:D...]              up to 8 points, T in C, D duty 0-255;
+ *                                     linear between points, flat outside
+ *     pid=TARGET:KP:KI:KD             hold TARGET C; gains in duty per C,
+ *                                     duty per C*s, duty*s per C
+ *     hyst=C                          curve only: falling temperatures are
+ *                                     followed only once they drop C below
+ *                                     the last peak (default 2)
+ *     deadband=D                      write only when |new - written| >= D
+ *                                     (default 1: any change)
+ *     min=D max=D                     duty clamp (default 0, 255)
+ *     ff_floor=D                      feed-forward: duty floor at full lead
+ *     ff_shift=C                      feed-forward, curve only: curve input
+ *                                     raised C at full lead
+ *   feedforward key=value ...         early heat signals (optional)
+ *     power=SRC                       cumulative energy counter in uJ:
+ *                                     "rapl" (powercap package-0, AMD and
+ *                                     Intel), hwmon_name/energyN_input or
+ *                                     an absolute path
+ *     load=PATH                       /proc/stat (aggregate utilization)
+ *     power_range=W0:W1               W0 = no signal, W1 = full (20:120)
+ *     load_range=P0:P1                percent, likewise (10:90)
+ *     tau=S                           how long a load step keeps the lead
+ *                                     (1-600 s, default 30: the cooler's
+ *                                     time constant)
+ *   Example: examples/nct-fanctl.conf.example
+ *
+ * USAGE:
+ *   nct-fanctl [--config FILE] [--hwmon DIR] [--dry-run] [--count N]
+ *              [--verbose] [--stats] [--rt[=PRIO]] [--cpu N] [--direct]
+ *              [--ring PATH]
+ *     --hwmon DIR  NCT67xx hwmon directory (default: hwmon_resolve())
+ *     --ring PATH  sampler ring (default /dev/shm/nct-telemetry); absent or
+ *                  stale ring = every source read goes to sysfs
+ *     --dry-run    compute and print duties, never touch pwmN/pwmN_enable
+ *     --direct     write sysfs even when nct-broker is running
+ *     --count N    stop after N ticks (default: until SIGINT/SIGTERM)
+ *     --verbose    print every tick, not only ticks that wrote
+ *     --stats      print nct-stats.h latency histograms on exit
+ *     --rt[=PRIO]  real-time mode (nct-rt.h): SCHED_FIFO at PRIO (default
+ *                  40), memory locked and pre-faulted, so ticks stay on
+ *                  time while every other core is saturated
+ *     --cpu N      pin to CPU N (a housekeeping core)
+ *
+ *   On exit a one-line summary goes to stderr:
+ *   [INFO] ticks=N overruns=N writes=N suppressed=N failsafe=N boosted=N cached=N wakeup_ns max=N
+ *   (boosted: header ticks the feed-forward lead was active; cached:
+ *   source reads served from the sampler ring)
+ *
+ * SAFETY / CAVEATS:
+ *   - Fail-safe: a header whose source cannot be read runs at its max
+ *   - Feed-forward only ever adds duty, and an unreadable power or load
+ *     signal only removes its lead: temperatures stay in charge
+ *   - RAPL energy_uj is root-only on current kernels
+ *   - Every resync interval (~30 s) pwmN_enable is re-read; if firmware or
+ *     another tool took the header out of manual mode it is re-asserted
+ *   - Only headers named in the config are touched; the rest keep whatever
+ *     max-fans-advanced.sh programmed
+ *   - A SIGKILLed controller leaves its headers at the last duty written;
+ *     nct-fanctl.service restarts it (Restart=on-failure)
+ *   - With nct-broker.service running every write goes through it: duty
+ *     writes as coalescing requests (held up to the broker's --window,
+ *     25 ms), mode changes as ordinary ones, so a restore run gating a
+ *     header is never split by a controller write. Reads stay direct
+ *   - A ring sample older than two sampler periods, or from a sampler that
+ *     has exited, is not used; feed-forward signals (energy_uj, /proc/stat)
+ *     are not in the ring and are always read directly
+ */
+
+#define _GNU_SOURCE
+#include "nct-broker.h"
+#include "nct-hwmon.h"
+#include "nct-ring.h"
+#include "nct-rt.h"
+#include "nct-stats.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_CONFIG   "/usr/local/etc/nct-fanctl.conf"
+#define MAX_HEADERS      8
+#define MAX_SOURCES      4
+#define MAX_POINTS       8
+#define INTERVAL_MIN     100
+#define INTERVAL_MAX     10000
+#define INTERVAL_DEFAULT 1000
+#define RESYNC_MS        30000
+#define FF_RAPL_PATH     "/sys/class/powercap/intel-rapl:0/energy_uj"
+#define FF_TAU_DEFAULT   30.0
+#define FF_LEVEL_MIN     0.01               /* lead below this counts as none */
+#define RING_CHECK_NS    1000000000ull      /* re-stat the ring at most once a second */
+
+enum ctl_mode {
+	CTL_NONE,
+	CTL_CURVE,
+	CTL_PID,
+};
+
+struct source {
+	char path[HWMON_PATH_MAX + HWMON_ATTR_MAX];
+	char chan[NCT_RING_NAME_MAX];       /* ring channel name, "" = sysfs only */
+	int slot;                           /* index in ring->channels, -1 = absent */
+	int fd;
+};
+
+/*
+ * struct header - One controlled pwmN: configuration, then loop state
+ */
+struct header {
+	int index;
+	enum ctl_mode mode;
+	struct source src[MAX_SOURCES];
+	int nsrc;
+	int32_t pt_temp[MAX_POINTS];        /* millidegrees C, ascending */
+	int pt_duty[MAX_POINTS];
+	int npts;
+	int32_t hyst;                       /* millidegrees C */
+	double target, kp, ki, kd;          /* PID, degrees C */
+	int min, max, deadband;
+	int ff_floor;                       /* duty at full feed-forward lead */
+	int32_t ff_shift;                   /* millidegrees C at full lead */
+
+	int pwm_fd, enable_fd;
+	char saved_enable[16], saved_pwm[16];
+	int32_t t_eff;                      /* curve input after hysteresis */
+	bool have_t;
+	double integral, prev_err;
+	int written;                        /* last duty written, -1 = none */
+	bool failsafe;
+	uint64_t writes, suppressed, failsafe_ticks, boosted;
+};
+
+/*
+ * struct feedforward - Early heat signals, sampled once per tick
+ * HOW: s = max(power, load), each mapped linearly from its range onto
+ *      0-1; slow follows s with time constant tau; the lead s - slow
+ *      (never below 0, released at most at the same rate) is what the
+ *      headers see. A step in load yields a
+ *      lead that decays like the heat reaching the sensor; steady load,
+ *      high or low, yields none
+ */
+struct feedforward {
+	bool enabled;
+	struct source power, load;          /* fd -1 = not configured */
+	double power_lo, power_hi;          /* W */
+	double load_lo, load_hi;            /* fraction of all CPUs */
+	double tau;                         /* s */
+
+	uint64_t energy_prev;               /* uJ */
+	uint64_t busy_prev, total_prev;     /* USER_HZ ticks */
+	bool have_energy, have_load, warned;
+	double power_w, util;
+	double slow, level;
+};
+
+static struct header headers[MAX_HEADERS];
+static int nheaders;
+static struct feedforward ff = {
+	.power = {.fd = -1},
+	.load = {.fd = -1},
+	.power_lo = 20.0,
+	.power_hi = 120.0,
+	.load_lo = 0.10,
+	.load_hi = 0.90,
+	.tau = FF_TAU_DEFAULT,
+};
+static int interval_ms = INTERVAL_DEFAULT;
+static bool verbose;
+static bool dry_run;
+static int broker_fd = -1;          /* nct-broker connection, -1 = write sysfs directly */
+static const char *hwmon_dir;
+static volatile sig_atomic_t stop_requested;
+
+static const char *ring_path = NCT_RING_PATH;
+static const struct nct_ring_header *ring;
+static size_t ring_size;
+static ino_t ring_ino;
+static uint64_t ring_checked_ns;
+static struct nct_ring_sample ring_snap;
+static bool ring_current;               /* ring_snap is usable this tick */
+static uint64_t ring_reads;
+
+static void on_signal(int sig) {
+	(void)sig;
+	stop_requested = 1;
+}
+
+/*
+ * parse_temp() - "45" or "45.5" (degrees C) to millidegrees
+ */
+static int parse_temp(const char *s, int32_t *out) {
+	char *end;
+	double v = strtod(s, &end);
+	if (end == s || v < -50.0 || v > 150.0) {
+		return -1;
+	}
+	*out = (int32_t)(v * 1000.0 + (v < 0 ? -0.5 : 0.5));
+	return 0;
+}
+
+static int parse_duty(const char *s, int *out) {
+	char *end;
+	long v = strtol(s, &end, 10);
+	if (end == s || *end || v < 0 || v > 255) {
+		return -1;
+	}
+	*out = (int)v;
+	return 0;
+}
+
+/*
+ * parse_curve() - "40:60,60:140,80:255" into ascending points
+ */
+static int parse_curve(struct header *h, char *spec) {
+	for (char *save, *tok = strtok_r(spec, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+		char *colon = strchr(tok, ':');
+		if (!colon || h->npts >= MAX_POINTS) {
+			return -1;
+		}
+		*colon = '\0';
+		if (parse_temp(tok, &h->pt_temp[h->npts]) < 0 || parse_duty(colon + 1, &h->pt_duty[h->npts]) < 0) {
+			return -1;
+		}
+		if (h->npts > 0 && h->pt_temp[h->npts] <= h->pt_temp[h->npts - 1]) {
+			return -1;
+		}
+		h->npts++;
+	}
+	h->mode = CTL_CURVE;
+	return h->npts > 0 ? 0 : -1;
+}
+
+static int parse_pid(struct header *h, const char *spec) {
+	if (sscanf(spec, "%lf:%lf:%lf:%lf", &h->target, &h->kp, &h->ki, &h->kd) != 4 ||
+	    h->target < 0 || h->target > 120) {
+		return -1;
+	}
+	h->mode = CTL_PID;
+	return 0;
+}
+
+/*
+ * source_resolve() - "amdgpu/temp1_input" or "/abs/path" to a readable path
+ * OUT: chan, the name nct-sampler gives the channel in its ring: bare for
+ *      the nct67xx chip, "name/attr" for a --device; "" for absolute paths
+ */
+static int source_resolve(const char *spec, char *out, size_t len, char *chan, size_t chanlen) {
+	chan[0] = '\0';
+	if (spec[0] == '/') {
+		snprintf(out, len, "%s", spec);
+		return 0;
+	}
+	const char *slash = strchr(spec, '/');
+	if (!slash || slash == spec || strchr(slash + 1, '/') || (size_t)(slash - spec) >= HWMON_ATTR_MAX) {
+		return -1;
+	}
+	char name[HWMON_ATTR_MAX];
+	char dir[HWMON_PATH_MAX];
+	memcpy(name, spec, (size_t)(slash - spec));
+	name[slash - spec] = '\0';
+	if (hwmon_find_by_name(name, dir, sizeof(dir)) < 0) {
+		return -1;
+	}
+	int n = snprintf(out, len, "%s%s", dir, slash);
+	if (n <= 0 || (size_t)n >= len) {
+		return -1;
+	}
+	bool chip = strncmp(name, HWMON_NAME_PREFIX, strlen(HWMON_NAME_PREFIX)) == 0;
+	n = snprintf(chan, chanlen, "%s", chip ? slash + 1 : spec);
+	if (n <= 0 || (size_t)n >= chanlen) {
+		chan[0] = '\0';
+	}
+	return 0;
+}
+
+/*
+ * parse_header() - One "pwmN key=value ..." line
+ * RETURNS: 0, or -1 after logging what is wrong with the line
+ */
+static int parse_header(char *line, int lineno) {
+	char *save;
+	char *tok = strtok_r(line, " \t", &save);
+	struct header *h = &headers[nheaders];
+	memset(h, 0, sizeof(*h));
+	h->hyst = 2000;
+	h->max = 255;
+	h->deadband = 1;
+	h->written = -1;
+	h->pwm_fd = h->enable_fd = -1;
+
+	char *end;
+	h->index = (int)strtol(tok + 3, &end, 10);
+	if (*end || h->index < 1 || h->index > 7) {
+		fprintf(stderr, "[ERROR] line %d: %s is not a pwm1-pwm7 header\n", lineno, tok);
+		return -1;
+	}
+	for (int i = 0; i < nheaders; ++i) {
+		if (headers[i].index == h->index) {
+			fprintf(stderr, "[ERROR] line %d: pwm%d configured twice\n", lineno, h->index);
+			return -1;
+		}
+	}
+
+	while ((tok = strtok_r(NULL, " \t", &save)) != NULL) {
+		char *val = strchr(tok, '=');
+		if (!val) {
+			fprintf(stderr, "[ERROR] line %d: expected key=value, got '%s'\n", lineno, tok);
+			return -1;
+		}
+		*val++ = '\0';
+
+		int rc = 0;
+		if (strcmp(tok, "source") == 0) {
+			for (char *s2, *src = strtok_r(val, ",", &s2); src && rc == 0; src = strtok_r(NULL, ",", &s2)) {
+				struct source *sp = &h->src[h->nsrc];
+				if (h->nsrc >= MAX_SOURCES ||
+				    source_resolve(src, sp->path, sizeof(sp->path), sp->chan, sizeof(sp->chan)) < 0) {
+					fprintf(stderr, "[ERROR] line %d: cannot resolve source '%s'\n", lineno, src);
+					return -1;
+				}
+				h->nsrc++;
+			}
+		} else if (strcmp(tok, "curve") == 0) {
+			rc = parse_curve(h, val);
+		} else if (strcmp(tok, "pid") == 0) {
+			rc = parse_pid(h, val);
+		} else if (strcmp(tok, "hyst") == 0) {
+			rc = parse_temp(val, &h->hyst);
+			rc = rc < 0 || h->hyst < 0 ? -1 : 0;
+		} else if (strcmp(tok, "deadband") == 0) {
+			rc = parse_duty(val, &h->deadband);
+		} else if (strcmp(tok, "min") == 0) {
+			rc = parse_duty(val, &h->min);
+		} else if (strcmp(tok, "max") == 0) {
+			rc = parse_duty(val, &h->max);
+		} else if (strcmp(tok, "ff_floor") == 0) {
+			rc = parse_duty(val, &h->ff_floor);
+		} else if (strcmp(tok, "ff_shift") == 0) {
+			rc = parse_temp(val, &h->ff_shift);
+			rc = rc < 0 || h->ff_shift < 0 ? -1 : 0;
+		} else {
+			fprintf(stderr, "[ERROR] line %d: unknown key '%s'\n", lineno, tok);
+			return -1;
+		}
+		if (rc < 0) {
+			fprintf(stderr, "[ERROR] line %d: bad value for %s\n", lineno, tok);
+			return -1;
+		}
+	}
+
+	if (h->nsrc == 0 || h->mode == CTL_NONE || h->min > h->max) {
+		fprintf(stderr, "[ERROR] line %d: pwm%d needs source= and curve= or pid= (and min <= max)\n", lineno, h->index);
+		return -1;
+	}
+	if (h->ff_shift && h->mode != CTL_CURVE) {
+		fprintf(stderr, "[ERROR] line %d: pwm%d: ff_shift= shifts a curve; use ff_floor= with pid=\n", lineno, h->index);
+		return -1;
+	}
+	nheaders++;
+	return 0;
+}
+
+/*
+ * parse_range() - "LO:HI" with min <= LO < HI <= max
+ */
+static int parse_range(const char *spec, double min, double max, double *lo, double *hi) {
+	char tail;
+	if (sscanf(spec, "%lf:%lf%c", lo, hi, &tail) != 2 || *lo < min || *hi > max || *lo >= *hi) {
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * parse_feedforward() - The "feedforward key=value ..." line
+ * RETURNS: 0, or -1 after logging what is wrong with the line
+ */
+static int parse_feedforward(char *line, int lineno) {
+	char *save;
+	strtok_r(line, " \t", &save);
+	for (char *tok; (tok = strtok_r(NULL, " \t", &save)) != NULL;) {
+		char *val = strchr(tok, '=');
+		if (!val) {
+			fprintf(stderr, "[ERROR] line %d: expected key=value, got '%s'\n", lineno, tok);
+			return -1;
+		}
+		*val++ = '\0';
+
+		int rc = 0;
+		if (strcmp(tok, "power") == 0) {
+			if (strcmp(val, "rapl") == 0) {
+				snprintf(ff.power.path, sizeof(ff.power.path), "%s", FF_RAPL_PATH);
+			} else if (source_resolve(val, ff.power.path, sizeof(ff.power.path), ff.power.chan,
+						  sizeof(ff.power.chan)) < 0) {
+				fprintf(stderr, "[ERROR] line %d: cannot resolve power source '%s'\n", lineno, val);
+				return -1;
+			}
+		} else if (strcmp(tok, "load") == 0) {
+			rc = val[0] == '/' ? 0 : -1;
+			snprintf(ff.load.path, sizeof(ff.load.path), "%s", val);
+		} else if (strcmp(tok, "power_range") == 0) {
+			rc = parse_range(val, 0.0, 1000.0, &ff.power_lo, &ff.power_hi);
+		} else if (strcmp(tok, "load_range") == 0) {
+			rc = parse_range(val, 0.0, 100.0, &ff.load_lo, &ff.load_hi);
+			ff.load_lo /= 100.0;
+			ff.load_hi /= 100.0;
+		} else if (strcmp(tok, "tau") == 0) {
+			char *end;
+			ff.tau = strtod(val, &end);
+			rc = end == val || *end || ff.tau < 1.0 || ff.tau > 600.0 ? -1 : 0;
+		} else {
+			fprintf(stderr, "[ERROR] line %d: unknown feedforward key '%s'\n", lineno, tok);
+			return -1;
+		}
+		if (rc < 0) {
+			fprintf(stderr, "[ERROR] line %d: bad value for %s\n", lineno, tok);
+			return -1;
+		}
+	}
+	if (!ff.power.path[0] && !ff.load.path[0]) {
+		fprintf(stderr, "[ERROR] line %d: feedforward needs power= and/or load=\n", lineno);
+		return -1;
+	}
+	ff.enabled = true;
+	return 0;
+}
+
+static int load_config(const char *path) {
+	FILE *f = fopen(path, "re");
+	if (!f) {
+		fprintf(stderr, "[ERROR] Cannot open config %s: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	char line[1024];
+	int lineno = 0;
+	int rc = 0;
+	while (rc == 0 && fgets(line, sizeof(line), f)) {
+		lineno++;
+		line[strcspn(line, "#\n")] = '\0';
+		char *p = line + strspn(line, " \t");
+		if (!*p) {
+			continue;
+		}
+		if (strncmp(p, "interval", 8) == 0 && (p[8] == ' ' || p[8] == '\t')) {
+			interval_ms = atoi(p + 9);
+			if (interval_ms < INTERVAL_MIN || interval_ms > INTERVAL_MAX) {
+				fprintf(stderr, "[ERROR] line %d: interval must be %d-%d ms\n", lineno, INTERVAL_MIN, INTERVAL_MAX);
+				rc = -1;
+			}
+		} else if (strncmp(p, "feedforward", 11) == 0 && (p[11] == ' ' || p[11] == '\t')) {
+			rc = parse_feedforward(p, lineno);
+		} else if (strncmp(p, "pwm", 3) == 0) {
+			if (nheaders >= MAX_HEADERS) {
+				fprintf(stderr, "[ERROR] line %d: more than %d headers\n", lineno, MAX_HEADERS);
+				rc = -1;
+			} else {
+				rc = parse_header(p, lineno);
+			}
+		} else {
+			fprintf(stderr, "[ERROR] line %d: unknown directive\n", lineno);
+			rc = -1;
+		}
+	}
+	fclose(f);
+	if (rc == 0 && nheaders == 0) {
+		fprintf(stderr, "[ERROR] %s configures no headers\n", path);
+		rc = -1;
+	}
+	for (int i = 0; rc == 0 && i < nheaders; ++i) {
+		if ((headers[i].ff_floor || headers[i].ff_shift) && !ff.enabled) {
+			fprintf(stderr, "[ERROR] pwm%d uses ff_floor=/ff_shift= but %s has no feedforward line\n",
+				headers[i].index, path);
+			rc = -1;
+		}
+	}
+	return rc;
+}
+
+static int fd_read_text(int fd, char *buf, size_t len) {
+	ssize_t n = pread(fd, buf, len - 1, 0);
+	if (n <= 0) {
+		return -1;
+	}
+	buf[n] = '\0';
+	buf[strcspn(buf, "\n")] = '\0';
+	return 0;
+}
+
+static uint64_t monotonic_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * ring_refresh() - Attach, or re-attach after a sampler restart, as
+ *                  nct-broker does; then bind every source to its channel
+ * WHY: A restarted sampler replaces the file (rename(2)) and may carry a
+ *      different channel table (--device), so slots are looked up again
+ */
+static void ring_refresh(uint64_t now) {
+	/* Throttled with or without a ring: no sampler must not cost a stat() per tick */
+	if (ring_checked_ns && now - ring_checked_ns < RING_CHECK_NS) {
+		return;
+	}
+	ring_checked_ns = now;
+
+	struct stat st;
+	if (stat(ring_path, &st) < 0) {
+		if (ring) {
+			nct_ring_detach(ring, ring_size);
+			ring = NULL;
+		}
+		return;
+	}
+	if (ring && st.st_ino == ring_ino) {
+		return;
+	}
+	size_t size;
+	const struct nct_ring_header *r = nct_ring_attach(ring_path, &size);
+	if (!r) {
+		return;
+	}
+	if (ring) {
+		nct_ring_detach(ring, ring_size);
+	}
+	ring = r;
+	ring_size = size;
+	ring_ino = st.st_ino;
+
+	int bound = 0, total = 0;
+	for (int i = 0; i < nheaders; ++i) {
+		for (int k = 0; k < headers[i].nsrc; ++k) {
+			struct source *src = &headers[i].src[k];
+			src->slot = -1;
+			for (uint32_t c = 0; src->chan[0] && c < r->nchannels; ++c) {
+				if (strncmp(r->channels[c].name, src->chan, NCT_RING_NAME_MAX) == 0) {
+					src->slot = (int)c;
+					bound++;
+					break;
+				}
+			}
+			total++;
+		}
+	}
+	fprintf(stderr, "[INFO] Attached %s: %d of %d source(s) read from the ring at %u Hz\n", ring_path, bound,
+		total, r->rate_hz);
+}
+
+/*
+ * ring_tick() - Take this tick's copy of the newest ring sample
+ * HOW: Usable only while the sampler runs and the sample is at most two
+ *      sampler periods old (the same test as nct-broker's cache_read());
+ *      otherwise every source falls back to pread() this tick
+ */
+static void ring_tick(void) {
+	uint64_t now = monotonic_ns();
+	ring_refresh(now);
+	ring_current = ring && ring->rate_hz > 0 &&
+		       atomic_load_explicit(&ring->writer_pid, memory_order_acquire) != 0 &&
+		       nct_ring_latest(ring, &ring_snap) == 0 && now - ring_snap.t_ns <= 2000000000ull / ring->rate_hz;
+}
+
+/*
+ * source_read() - One source value: the ring sample if it has it, else pread()
+ * RETURNS: 0 with *out in the attribute's units, -1 on read failure
+ */
+static int source_read(const struct source *src, int32_t *out) {
+	if (ring_current && src->slot >= 0 && (uint32_t)src->slot < ring_snap.nvalues &&
+	    ring_snap.values[src->slot] != NCT_RING_INVALID) {
+		*out = ring_snap.values[src->slot];
+		ring_reads++;
+		return 0;
+	}
+	return hwmon_read_int(src->fd, out);
+}
+
+static int fd_write_int(int fd, int value) {
+	char buf[16];
+	int len = snprintf(buf, sizeof(buf), "%d\n", value);
+	uint64_t t = nct_stats_begin();
+	ssize_t n = pwrite(fd, buf, (size_t)len, 0);
+	nct_stats_end(NCT_OP_SYSFS_WRITE, t);
+	return n == len ? 0 : -1;
+}
+
+/*
+ * header_write() - Write pwmN (enable false) or pwmN_enable
+ * WHY: Through nct-broker a duty is a coalescing request (only the newest
+ *      duty matters); a mode change is ordered against every other tool's
+ *      requests. A broker that goes away is dropped for the rest of the run
+ * RETURNS: 0, or -1 with errno set
+ */
+static int header_write(struct header *h, bool enable, int value) {
+	if (broker_fd >= 0) {
+		char attr[HWMON_ATTR_MAX], val[16];
+		snprintf(attr, sizeof(attr), enable ? "pwm%d_enable" : "pwm%d", h->index);
+		snprintf(val, sizeof(val), "%d", value);
+
+		struct nct_broker_op op;
+		struct nct_broker_result res;
+		nct_broker_op_set(&op, NCT_BROKER_WRITE, ' ', attr, val);
+		int rc = nct_broker_call(broker_fd, hwmon_dir, enable ? 0 : NCT_BROKER_F_COALESCE, &op, 1, &res);
+		if (rc == 0) {
+			errno = -res.rc;
+			return res.rc < 0 ? -1 : 0;
+		}
+		fprintf(stderr, "[WARN] nct-broker unavailable (%s); writing sysfs directly\n", strerror(-rc));
+		close(broker_fd);
+		broker_fd = -1;
+	}
+	return fd_write_int(enable ? h->enable_fd : h->pwm_fd, value);
+}
+
+/*
+ * header_open() - Open pwmN/pwmN_enable, save them, take manual control
+ */
+static int header_open(int dirfd, struct header *h) {
+	char attr[HWMON_ATTR_MAX];
+	int flags = (dry_run ? O_RDONLY : O_RDWR) | O_CLOEXEC;
+
+	snprintf(attr, sizeof(attr), "pwm%d", h->index);
+	h->pwm_fd = openat(dirfd, attr, flags);
+	snprintf(attr, sizeof(attr), "pwm%d_enable", h->index);
+	h->enable_fd = openat(dirfd, attr, flags);
+	if (h->pwm_fd < 0 || h->enable_fd < 0 ||
+	    fd_read_text(h->enable_fd, h->saved_enable, sizeof(h->saved_enable)) < 0 ||
+	    fd_read_text(h->pwm_fd, h->saved_pwm, sizeof(h->saved_pwm)) < 0) {
+		fprintf(stderr, "[ERROR] Cannot open pwm%d/pwm%d_enable: %s\n", h->index, h->index, strerror(errno));
+		return -1;
+	}
+
+	for (int i = 0; i < h->nsrc; ++i) {
+		h->src[i].fd = open(h->src[i].path, O_RDONLY | O_CLOEXEC);
+		if (h->src[i].fd < 0) {
+			fprintf(stderr, "[ERROR] Cannot open source %s: %s\n", h->src[i].path, strerror(errno));
+			return -1;
+		}
+	}
+
+	if (!dry_run && header_write(h, true, 1) < 0) {
+		fprintf(stderr, "[ERROR] Cannot switch pwm%d to manual mode: %s\n", h->index, strerror(errno));
+		return -1;
+	}
+	fprintf(stderr, "[INFO] pwm%d: %s control from %d source(s), was pwm%d_enable=%s\n",
+		 h->index, h->mode == CTL_PID ? "PID" : "curve", h->nsrc, h->index, h->saved_enable);
+	return 0;
+}
+
+/*
+ * header_restore() - Hand the header back to the mode it was in
+ * ORDER: duty first, then enable, so a manual-mode header never shows a
+ *        stale controller duty under its original mode
+ */
+static void header_restore(struct header *h) {
+	if (!dry_run && h->pwm_fd >= 0 && h->enable_fd >= 0) {
+		if (strcmp(h->saved_enable, "1") == 0) {
+			header_write(h, false, atoi(h->saved_pwm));
+		}
+		if (header_write(h, true, atoi(h->saved_enable)) < 0) {
+			fprintf(stderr, "[WARN] Cannot restore pwm%d_enable=%s: %s\n", h->index, h->saved_enable, strerror(errno));
+		}
+	}
+	for (int i = 0; i < h->nsrc; ++i) {
+		if (h->src[i].fd >= 0) {
+			close(h->src[i].fd);
+		}
+	}
+	if (h->pwm_fd >= 0) {
+		close(h->pwm_fd);
+	}
+	if (h->enable_fd >= 0) {
+		close(h->enable_fd);
+	}
+}
+
+/*
+ * ff_open() - Open the configured feed-forward signals
+ * RETURNS: 0, or -1 after logging (a configured signal must be readable
+ *          at start; later read failures only drop its lead)
+ */
+static int ff_open(void) {
+	struct source *sig[] = {&ff.power, &ff.load};
+	for (size_t i = 0; i < sizeof(sig) / sizeof(sig[0]); ++i) {
+		if (!sig[i]->path[0]) {
+			continue;
+		}
+		sig[i]->fd = open(sig[i]->path, O_RDONLY | O_CLOEXEC);
+		if (sig[i]->fd < 0) {
+			fprintf(stderr, "[ERROR] Cannot open feed-forward signal %s: %s\n", sig[i]->path, strerror(errno));
+			return -1;
+		}
+	}
+	fprintf(stderr, "[INFO] Feed-forward: power %s (%.0f-%.0f W), load %s (%.0f-%.0f%%), tau %.0f s\n",
+		ff.power.path[0] ? ff.power.path : "off", ff.power_lo, ff.power_hi,
+		ff.load.path[0] ? ff.load.path : "off", ff.load_lo * 100.0, ff.load_hi * 100.0, ff.tau);
+	return 0;
+}
+
+static void ff_close(void) {
+	if (ff.power.fd >= 0) {
+		close(ff.power.fd);
+	}
+	if (ff.load.fd >= 0) {
+		close(ff.load.fd);
+	}
+}
+
+/*
+ * ff_read_power() - Package power since the previous tick
+ * WHY: energy_uj / energyN_input are cumulative microjoules; one delta per
+ *      tick is the average power over exactly the interval the fans are
+ *      reacting to. A counter that went backwards wrapped
+ *      (max_energy_range_uj): that tick has no reading
+ * RETURNS: 1 with *watts set, 0 if there is no interval yet, -1 on error
+ */
+static int ff_read_power(double dt, double *watts) {
+	char buf[32];
+	char *end;
+	if (fd_read_text(ff.power.fd, buf, sizeof(buf)) < 0) {
+		return -1;
+	}
+	uint64_t e = strtoull(buf, &end, 10);
+	if (end == buf) {
+		return -1;
+	}
+	bool have = ff.have_energy && e >= ff.energy_prev;
+	uint64_t delta = e - ff.energy_prev;
+	ff.energy_prev = e;
+	ff.have_energy = true;
+	if (!have) {
+		return 0;
+	}
+	*watts = (double)delta / 1e6 / dt;
+	return 1;
+}
+
+/*
+ * ff_read_load() - Busy fraction of all CPUs since the previous tick
+ * HOW: The aggregate "cpu" line of /proc/stat: user nice system idle
+ *      iowait irq softirq steal (guest is already counted in user);
+ *      idle + iowait is idle time, the rest busy
+ * RETURNS: 1 with *util set, 0 if there is no interval yet, -1 on error
+ */
+static int ff_read_load(double *util) {
+	char buf[256];
+	unsigned long long v[8] = {0};
+	if (fd_read_text(ff.load.fd, buf, sizeof(buf)) < 0 ||
+	    sscanf(buf, "cpu %llu %llu %llu %llu %llu %llu %llu %llu", &v[0], &v[1], &v[2], &v[3], &v[4], &v[5],
+		   &v[6], &v[7]) < 4) {
+		return -1;
+	}
+	uint64_t total = 0;
+	for (int i = 0; i < 8; ++i) {
+		total += v[i];
+	}
+	uint64_t busy = total - v[3] - v[4];
+	bool have = ff.have_load && total > ff.total_prev && busy >= ff.busy_prev;
+	uint64_t dbusy = busy - ff.busy_prev, dtotal = total - ff.total_prev;
+	ff.busy_prev = busy;
+	ff.total_prev = total;
+	ff.have_load = true;
+	if (!have) {
+		return 0;
+	}
+	*util = (double)dbusy / (double)dtotal;
+	return 1;
+}
+
+static double ff_scale(double v, double lo, double hi) {
+	double x = (v - lo) / (hi - lo);
+	return x < 0.0 ? 0.0 : x > 1.0 ? 1.0 : x;
+}
+
+/*
+ * ff_tick() - Sample the signals and update the lead, once per tick
+ * WHY: slow starts at 0 (no history reads as idle), so a controller
+ *      started under load ramps early once, like a load step would
+ */
+static void ff_tick(double dt) {
+	double s = 0.0;
+	bool failed = false;
+	int rc;
+	if (ff.power.fd >= 0) {
+		rc = ff_read_power(dt, &ff.power_w);
+		failed |= rc < 0;
+		if (rc > 0) {
+			s = ff_scale(ff.power_w, ff.power_lo, ff.power_hi);
+		}
+	}
+	if (ff.load.fd >= 0) {
+		rc = ff_read_load(&ff.util);
+		failed |= rc < 0;
+		if (rc > 0) {
+			double l = ff_scale(ff.util, ff.load_lo, ff.load_hi);
+			s = l > s ? l : s;
+		}
+	}
+	if (failed != ff.warned) {
+		fprintf(stderr, failed ? "[WARN] Feed-forward signal unreadable; its lead is dropped\n"
+				       : "[INFO] Feed-forward signals readable again\n");
+		ff.warned = failed;
+	}
+
+	/* A lead releases no faster than it would decay at steady load, so a
+	 * one-tick dip in a bursty load does not drop the floor and re-raise it */
+	double decay = ff.tau / (ff.tau + dt);
+	ff.slow += (s - ff.slow) * (1.0 - decay);
+	ff.level = s - ff.slow > ff.level * decay ? s - ff.slow : ff.level * decay;
+	if (ff.level < FF_LEVEL_MIN) {
+		ff.level = 0.0;
+	}
+}
+
+/*
+ * curve_duty() - Linear interpolation over the header's points
+ */
+static int curve_duty(const struct header *h, int32_t t) {
+	if (t <= h->pt_temp[0]) {
+		return h->pt_duty[0];
+	}
+	for (int i = 1; i < h->npts; ++i) {
+		if (t <= h->pt_temp[i]) {
+			int32_t span = h->pt_temp[i] - h->pt_temp[i - 1];
+			int64_t rise = (int64_t)(h->pt_duty[i] - h->pt_duty[i - 1]) * (t - h->pt_temp[i - 1]);
+			return h->pt_duty[i - 1] + (int)((rise + span / 2) / span);
+		}
+	}
+	return h->pt_duty[h->npts - 1];
+}
+
+/*
+ * header_duty() - One control step
+ * CURVE: t_eff follows rises immediately and falls only once t is more
+ *        than hyst below it, so a temperature hovering at a curve point
+ *        does not toggle the duty
+ * PID:   conditional integration (anti-windup): the integral only grows
+ *        while the output is not pinned at min/max in the same direction
+ */
+static int header_duty(struct header *h, int32_t t, double dt) {
+	int duty;
+	if (h->mode == CTL_CURVE) {
+		if (!h->have_t || t >= h->t_eff) {
+			h->t_eff = t;
+		} else if (h->t_eff - t > h->hyst) {
+			h->t_eff = t + h->hyst;
+		}
+		h->have_t = true;
+		duty = curve_duty(h, h->t_eff);
+	} else {
+		double err = t / 1000.0 - h->target;
+		double deriv = h->have_t ? (err - h->prev_err) / dt : 0.0;
+		double integral = h->integral + err * dt;
+		double u = h->kp * err + h->ki * integral + h->kd * deriv;
+		if ((u < h->max || err < 0) && (u > h->min || err > 0)) {
+			h->integral = integral;
+		} else {
+			u = h->kp * err + h->ki * h->integral + h->kd * deriv;
+		}
+		h->prev_err = err;
+		h->have_t = true;
+		u = u < h->min ? h->min : u > h->max ? h->max : u;
+		duty = (int)(u + 0.5);
+	}
+	return duty < h->min ? h->min : duty > h->max ? h->max : duty;
+}
+
+/*
+ * header_tick() - Read sources, compute, write only if the duty moved
+ */
+static void header_tick(struct header *h, double dt, bool resync) {
+	int32_t hottest = INT32_MIN;
+	bool ok = true;
+	for (int i = 0; i < h->nsrc; ++i) {
+		int32_t v;
+		if (source_read(&h->src[i], &v) < 0) {
+			ok = false;
+			break;
+		}
+		if (v > hottest) {
+			hottest = v;
+		}
+	}
+
+	int duty;
+	double lead = h->ff_floor || h->ff_shift ? ff.level : 0.0;
+	if (!ok) {
+		if (!h->failsafe) {
+			fprintf(stderr, "[WARN] pwm%d: source unreadable; fail-safe duty %d\n", h->index, h->max);
+		}
+		h->failsafe = true;
+		h->failsafe_ticks++;
+		duty = h->max;
+	} else {
+		if (h->failsafe) {
+			fprintf(stderr, "[INFO] pwm%d: sources readable again; resuming control\n", h->index);
+		}
+		h->failsafe = false;
+		/* Feed-forward: the curve sees the heat that is on its way */
+		duty = header_duty(h, hottest + (int32_t)(lead * h->ff_shift), dt);
+		int floor = (int)(lead * h->ff_floor + 0.5);
+		if (floor > duty) {
+			duty = floor < h->max ? floor : h->max;
+		}
+		if (lead > 0.0) {
+			h->boosted++;
+		}
+	}
+
+	if (resync && !dry_run) {
+		char mode[16];
+		if (fd_read_text(h->enable_fd, mode, sizeof(mode)) == 0 && strcmp(mode, "1") != 0) {
+			fprintf(stderr, "[WARN] pwm%d: pwm%d_enable changed to %s; re-asserting manual mode\n", h->index, h->index, mode);
+			header_write(h, true, 1);
+			h->written = -1;
+		}
+	}
+
+	bool write = h->written < 0 || abs(duty - h->written) >= h->deadband ||
+		     (duty != h->written && (duty == h->min || duty == h->max));
+	if (!write) {
+		h->suppressed++;
+	} else if (!dry_run && header_write(h, false, duty) < 0) {
+		fprintf(stderr, "[WARN] pwm%d: cannot write duty %d: %s\n", h->index, duty, strerror(errno));
+		write = false;
+	} else {
+		h->written = duty;
+		h->writes++;
+	}
+
+	if (verbose || (write && !dry_run)) {
+		if (ok) {
+			char ffs[16] = "";
+			if (lead > 0.0) {
+				snprintf(ffs, sizeof(ffs), " ff=%.2f", lead);
+			}
+			fprintf(stderr, "[INFO] pwm%d: %d.%03dC duty=%d%s%s\n", h->index, hottest / 1000, abs(hottest % 1000), duty,
+				 ffs, write ? (dry_run ? " (dry-run)" : " (written)") : "");
+		} else {
+			fprintf(stderr, "[INFO] pwm%d: fail-safe duty=%d%s\n", h->index, duty, write ? " (written)" : "");
+		}
+	}
+}
+
+static void usage(FILE *out, const char *prog) {
+	fprintf(out,
+		"Usage: %s [--config FILE] [--hwmon DIR] [--dry-run] [--count N] [--verbose] [--stats] [--rt[=PRIO]] [--cpu N]\n"
+		"       [--direct] [--ring PATH]\n"
+		"  --config FILE  controller config (default %s)\n"
+		"  --hwmon DIR    NCT67xx hwmon directory (default: resolve)\n"
+		"  --dry-run      compute duties, never write pwmN/pwmN_enable\n"
+		"  --count N      stop after N ticks\n"
+		"  --verbose      log every tick\n"
+		"  --stats        print per-operation latency histograms on exit\n"
+		"  --rt[=PRIO]    SCHED_FIFO (default priority %d), locked memory\n"
+		"  --cpu N        pin to CPU N\n"
+		"  --direct       write sysfs even when nct-broker is running\n"
+		"  --ring PATH    sampler ring for source reads (default %s)\n",
+		prog, DEFAULT_CONFIG, NCT_RT_PRIORITY_DEFAULT, NCT_RING_PATH);
+}
+
+/*
+ * main() - Entry point
+ * STRATEGY:
+ *   1. Load the config (sources resolved here, once; ring channels are
+ *      bound on the first tick and again after a sampler restart)
+ *   2. Open and take over each header; on any failure restore what was
+ *      taken and exit 2
+ *   3. timerfd loop until signalled or --count ticks
+ *   4. Restore every header, print the summary
+ */
+int main(int argc, char **argv) {
+	static const struct option longopts[] = {
+		{"config", required_argument, NULL, 'c'},
+		{"hwmon", required_argument, NULL, 'H'},
+		{"dry-run", no_argument, NULL, 'n'},
+		{"count", required_argument, NULL, 'N'},
+		{"verbose", no_argument, NULL, 'v'},
+		{"stats", no_argument, NULL, 's'},
+		{"rt", optional_argument, NULL, 'T'},
+		{"cpu", required_argument, NULL, 'C'},
+		{"direct", no_argument, NULL, 'D'},
+		{"ring", required_argument, NULL, 'R'},
+		{"help", no_argument, NULL, 'h'},
+		{NULL, 0, NULL, 0},
+	};
+
+	const char *config = DEFAULT_CONFIG;
+	char hwmon[HWMON_PATH_MAX] = "";
+	uint64_t count = 0;
+	bool show_stats = false;
+	bool direct = false;
+	struct nct_rt_config rt = {.priority = 0, .cpu = -1};
+
+	int opt;
+	while ((opt = getopt_long(argc, argv, "c:H:nN:vsT::C:DR:h", longopts, NULL)) != -1) {
+		switch (opt) {
+		case 'c':
+			config = optarg;
+			break;
+		case 'H':
+			snprintf(hwmon, sizeof(hwmon), "%s", optarg);
+			break;
+		case 'n':
+			dry_run = true;
+			break;
+		case 'N':
+			count = strtoull(optarg, NULL, 10);
+			break;
+		case 'v':
+			verbose = true;
+			break;
+		case 's':
+			show_stats = true;
+			break;
+		case 'T':
+			if (nct_rt_parse_priority(optarg, &rt.priority) < 0) {
+				fprintf(stderr, "[ERROR] --rt priority must be 1-99\n");
+				return 2;
+			}
+			break;
+		case 'C':
+			rt.cpu = atoi(optarg);
+			if (rt.cpu < 0) {
+				fprintf(stderr, "[ERROR] --cpu must be a CPU number\n");
+				return 2;
+			}
+			break;
+		case 'D':
+			direct = true;
+			break;
+		case 'R':
+			ring_path = optarg;
+			break;
+		case 'h':
+			usage(stdout, argv[0]);
+			return 0;
+		default:
+			usage(stderr, argv[0]);
+			return 2;
+		}
+	}
+
+	if (load_config(config) < 0) {
+		return 2;
+	}
+	if (!hwmon[0]) {
+		struct hwmon_resolution res;
+		if (hwmon_resolve(&res, 0) < 0) {
+			fprintf(stderr, "[ERROR] No %s* hwmon device under %s (is nct6775 loaded?)\n", HWMON_NAME_PREFIX, HWMON_CLASS_PATH);
+			return 2;
+		}
+		snprintf(hwmon, sizeof(hwmon), "%s", res.hwmon);
+	}
+	int dirfd = open(hwmon, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dirfd < 0) {
+		fprintf(stderr, "[ERROR] Cannot open hwmon directory %s: %s\n", hwmon, strerror(errno));
+		return 2;
+	}
+
+	hwmon_dir = hwmon;
+	if (!dry_run && !direct) {
+		broker_fd = nct_broker_connect(nct_broker_path());
+		if (broker_fd >= 0) {
+			fprintf(stderr, "[INFO] Writing through nct-broker at %s\n", nct_broker_path());
+		}
+	}
+
+	/* Signals first: a SIGTERM during takeover must still restore */
+	struct sigaction sa = {.sa_handler = on_signal};
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+
+	int opened = 0;
+	int rc = 0;
+	for (; opened < nheaders; ++opened) {
+		if (header_open(dirfd, &headers[opened]) < 0) {
+			header_restore(&headers[opened]);
+			rc = 2;
+			break;
+		}
+	}
+	close(dirfd);
+	if (rc == 0 && ff.enabled && ff_open() < 0) {
+		rc = 2;
+	}
+
+	struct nct_rt_timer timer = {.fd = -1};
+	if (rc == 0 && nct_rt_timer_open(&timer, (uint64_t)interval_ms * 1000000) < 0) {
+		fprintf(stderr, "[ERROR] timerfd: %s\n", strerror(errno));
+		rc = 2;
+	}
+	if (rc == 0 && (rt.priority || rt.cpu >= 0)) {
+		char err[160];
+		if (nct_rt_enter(&rt, err, sizeof(err)) < 0) {
+			fprintf(stderr, "[ERROR] Real-time mode: %s\n", err);
+			rc = 2;
+		} else {
+			fprintf(stderr, "[INFO] Real-time mode: SCHED_FIFO priority %d, CPU %d (0 / -1 = unchanged)\n",
+				rt.priority, rt.cpu);
+		}
+	}
+
+	uint64_t ticks = 0, overruns = 0;
+	int resync_every = RESYNC_MS / interval_ms;
+	double dt = interval_ms / 1000.0;
+	if (rc == 0) {
+		fprintf(stderr, "[INFO] Controlling %d header(s) on %s every %d ms%s\n", nheaders, hwmon, interval_ms,
+			 dry_run ? " (dry run)" : "");
+	}
+	while (rc == 0 && !stop_requested && (count == 0 || ticks < count)) {
+		uint64_t expirations;
+		if (nct_rt_timer_wait(&timer, &expirations) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			fprintf(stderr, "[ERROR] timerfd read: %s\n", strerror(errno));
+			break;
+		}
+		if (expirations > 1) {
+			overruns += expirations - 1;
+		}
+		bool resync = ticks > 0 && ticks % (uint64_t)resync_every == 0;
+		ring_tick();
+		if (ff.enabled) {
+			ff_tick(dt * (double)expirations);
+		}
+		for (int i = 0; i < nheaders; ++i) {
+			header_tick(&headers[i], dt * (double)expirations, resync);
+		}
+		ticks++;
+	}
+
+	uint64_t writes = 0, suppressed = 0, failsafe = 0, boosted = 0;
+	for (int i = 0; i < opened; ++i) {
+		writes += headers[i].writes;
+		suppressed += headers[i].suppressed;
+		failsafe += headers[i].failsafe_ticks;
+		boosted += headers[i].boosted;
+		header_restore(&headers[i]);
+	}
+	ff_close();
+	if (ring) {
+		nct_ring_detach(ring, ring_size);
+	}
+	nct_rt_timer_close(&timer);
+	if (broker_fd >= 0) {
+		close(broker_fd);
+	}
+	fprintf(stderr, "[INFO] ticks=%llu overruns=%llu writes=%llu suppressed=%llu failsafe=%llu boosted=%llu cached=%llu wakeup_ns max=%llu\n",
+		 (unsigned long long)ticks, (unsigned long long)overruns, (unsigned long long)writes,
+		 (unsigned long long)suppressed, (unsigned long long)failsafe, (unsigned long long)boosted,
+		 (unsigned long long)ring_reads,
+		 (unsigned long long)nct_stats.op[NCT_OP_WAKEUP].max_ns);
+	if (show_stats) {
+		nct_stats_print(stderr, &nct_stats);
+	}
+	return rc;
+}
+
+/*
+ * BUILD & DEPLOYMENT NOTES:
+ *
+ * Compilation:
+ *   gcc -std=c23 -O2 -Wall -Wextra -Werror -o nct-fanctl \
+ *       nct-fanctl.c nct-hwmon.c nct-stats.c nct-rt.c
+ *
+ * Installation (in PKGBUILD):
+ *   install -Dm755 nct-fanctl "$pkgdir/usr/lib/eirikr/nct-fanctl"
+ *   nct-fanctl.service runs it when /usr/local/etc/nct-fanctl.conf exists
+ *
+ * Cost model:
+ *   Per tick: one pread() per source, or none while the sampler ring is
+ *   current (one seqlock copy serves every source, and the ring is
+ *   re-stat()ed at most once a second), plus, only when the duty moved,
+ *   one pwrite() per header. A naive loop writing every header every tick at
+ *   1 Hz issues 86400 writes per header per day, each taking the nct6775
+ *   update lock and an ISA or WMI round trip; with the deadband a steady
+ *   machine writes a few times per load change.
+ *   Feed-forward adds two pread()s per tick (energy_uj, /proc/stat), not
+ *   per header, and writes only when the lead moves a duty by deadband.
+ */
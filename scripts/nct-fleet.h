@@ -0,0 +1,232 @@
+/*
+ * nct-fleet.h - Wire protocol between nct-agent and a fleet collector
+ *
+ * PURPOSE:
+ *   Frame, record and signed-profile layouts shared by `nct-agent` (one
+ *   per node) and `nct-agent --serve` (one per fleet), so hundreds of
+ *   nodes push rollups and events to one place and pull compiled profiles
+ *   (nct-plan.h) from it without per-host SSH fan-out.
+ *
+ * CONNECTION (one long-lived TCP stream per node, agent connects):
+ *   agent -> collector   HELLO    node name, channel table, applied profile
+ *                                 generation; once per connection
+ *   agent -> collector   BATCH    zlib-compressed records, numbered
+ *   collector -> agent   ACK      every batch up to seq is stored
+ *   collector -> agent   PROFILE  signed plan, when the agent's generation
+ *                                 is older than the collector's
+ *   agent -> collector   RESULT   outcome of applying a PROFILE
+ *
+ *   Every frame is struct nct_fleet_frame followed by length payload
+ *   bytes. Unacknowledged batches stay queued on the agent and are resent
+ *   after a reconnect, so delivery is at-least-once: a collector may see a
+ *   seq twice and should keep the first.
+ *
+ * BATCH PAYLOAD (after struct nct_fleet_batch, inflated to raw_bytes):
+ *   records back to back, each starting with struct nct_fleet_rec and
+ *   8-byte aligned: NCT_FLEET_REC_ROLLUP (one closed nct-ring.h bucket,
+ *   every channel) or NCT_FLEET_REC_EVENT. Readers skip record types they
+ *   do not know by rec.size.
+ *
+ * SIGNED PROFILE (PROFILE payload and the file `nct-agent --sign` writes):
+ *   struct nct_fleet_profile, then plan_bytes of a compiled plan. The
+ *   Ed25519 signature covers the header up to signature[] followed by the
+ *   plan, so neither the plan nor its generation can be altered or
+ *   replayed under a newer number. Agents apply only generations above
+ *   the one they last applied.
+ *
+ * LOCAL EVENTS (same host, not on the wire to the collector):
+ *   The agent binds an AF_UNIX SOCK_DGRAM socket at NCT_FLEET_EVENT_PATH
+ *   (mode 0600, so root only). Each datagram is one struct nct_fleet_event
+ *   that joins the open batch; `nct-agent --alarm-event` sends one from
+ *   the environment nct-alarm --exec provides. The sender leaves channel
+ *   at -1 and starts text with the channel ("temp1"); the agent resolves
+ *   it against the ring's channel table.
+ *
+ * BYTE ORDER:
+ *   Little-endian native layout; every node and collector this package
+ *   targets is x86-64, and the static assert below keeps it honest.
+ */
+
+#ifndef NCT_FLEET_H
+#define NCT_FLEET_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define NCT_FLEET_MAGIC         0x544C464Eu          /* "NFLT" */
+#define NCT_FLEET_VERSION       1
+#define NCT_FLEET_PORT          "9799"
+#define NCT_FLEET_CHANNELS      96                   /* == NCT_RING_CHANNELS */
+#define NCT_FLEET_NAME_MAX      32
+#define NCT_FLEET_NODE_MAX      64
+#define NCT_FLEET_TEXT_MAX      96
+#define NCT_FLEET_INVALID       INT32_MIN            /* no valid sample in the bucket */
+#define NCT_FLEET_FRAME_MAX     (1u << 20)           /* payload cap, both directions */
+#define NCT_FLEET_RAW_MAX       (256u << 10)         /* inflated batch cap */
+#define NCT_FLEET_PROFILE_MAGIC "\x7fNCTSPLN"
+#define NCT_FLEET_SIG_BYTES     64                   /* Ed25519 */
+#define NCT_FLEET_EVENT_PATH    "/run/nct-agent.sock"
+
+_Static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "wire layout is little-endian native");
+
+enum nct_fleet_frame_type {
+	NCT_FLEET_HELLO = 1,
+	NCT_FLEET_BATCH,
+	NCT_FLEET_ACK,
+	NCT_FLEET_PROFILE,
+	NCT_FLEET_RESULT,
+};
+
+struct nct_fleet_frame {
+	uint32_t magic;                 /* NCT_FLEET_MAGIC */
+	uint16_t type;                  /* enum nct_fleet_frame_type */
+	uint16_t reserved;
+	uint32_t length;                /* payload bytes, <= NCT_FLEET_FRAME_MAX */
+	uint32_t reserved2;
+};
+
+struct nct_fleet_channel {
+	char name[NCT_FLEET_NAME_MAX];  /* sysfs attribute, e.g. "temp1_input" */
+	char label[NCT_FLEET_NAME_MAX]; /* "CPUTIN", "" if none */
+	uint8_t kind;                   /* enum nct_ring_kind */
+	uint8_t index;
+	uint8_t reserved[6];
+};
+
+struct nct_fleet_hello {
+	uint32_t version;               /* NCT_FLEET_VERSION */
+	uint32_t nchannels;             /* 0 while the node's sampler is down */
+	uint32_t rate_hz;
+	uint32_t reserved;
+	uint64_t generation;            /* last profile applied, 0 = none */
+	char node[NCT_FLEET_NODE_MAX];
+	struct nct_fleet_channel channels[NCT_FLEET_CHANNELS];
+};
+
+struct nct_fleet_batch {
+	uint64_t seq;                   /* strictly increasing per node, see nct-agent.c */
+	uint32_t raw_bytes;             /* inflated size of the records */
+	uint32_t nrecords;
+};
+
+struct nct_fleet_ack {
+	uint64_t seq;                   /* every batch <= seq is stored */
+};
+
+enum nct_fleet_rec_type {
+	NCT_FLEET_REC_ROLLUP = 1,
+	NCT_FLEET_REC_EVENT,
+};
+
+struct nct_fleet_rec {
+	uint16_t type;                  /* enum nct_fleet_rec_type */
+	uint16_t size;                  /* whole record, multiple of 8 */
+	uint32_t reserved;
+};
+
+/* One channel of a closed bucket; all NCT_FLEET_INVALID if count was 0 */
+struct nct_fleet_agg {
+	int32_t min;
+	int32_t max;
+	int32_t mean;
+	int32_t last;
+};
+
+struct nct_fleet_rollup {
+	struct nct_fleet_rec rec;
+	int64_t t_start_ns;             /* CLOCK_REALTIME at bucket start */
+	uint32_t period_s;              /* 1, 60 or 3600 */
+	uint32_t nsamples;
+	uint32_t nchannels;             /* == HELLO nchannels */
+	uint32_t reserved;
+	struct nct_fleet_agg agg[];     /* nchannels */
+};
+
+enum nct_fleet_event_kind {
+	NCT_FLEET_EV_SAMPLER_UP = 1,    /* ring attached or writer came back */
+	NCT_FLEET_EV_SAMPLER_DOWN,      /* ring gone or writer exited */
+	NCT_FLEET_EV_PROFILE_APPLIED,   /* value = generation */
+	NCT_FLEET_EV_PROFILE_FAILED,    /* value = generation, text = reason */
+	NCT_FLEET_EV_BATCHES_DROPPED,   /* value = batches lost to a full queue */
+	NCT_FLEET_EV_ALARM_RAISED,      /* value = reading (sysfs units), text = "temp1 (CPUTIN)" */
+	NCT_FLEET_EV_ALARM_CLEARED,     /* as ALARM_RAISED */
+	NCT_FLEET_EV_KIND_COUNT,
+};
+
+struct nct_fleet_event {
+	struct nct_fleet_rec rec;
+	int64_t t_ns;                   /* CLOCK_REALTIME */
+	int64_t value;
+	uint16_t kind;                  /* enum nct_fleet_event_kind */
+	int16_t channel;                /* index into the HELLO table, -1 = none */
+	uint32_t reserved;
+	char text[NCT_FLEET_TEXT_MAX];
+};
+
+struct nct_fleet_profile {
+	char magic[8];                  /* NCT_FLEET_PROFILE_MAGIC, no NUL */
+	uint64_t generation;            /* strictly increasing per fleet */
+	uint32_t plan_bytes;            /* compiled plan that follows */
+	uint32_t reserved;
+	uint8_t signature[NCT_FLEET_SIG_BYTES];
+};
+
+struct nct_fleet_result {
+	uint64_t generation;
+	int32_t status;                 /* 0 applied, > 0 failed, see message */
+	uint32_t reserved;
+	char message[NCT_FLEET_TEXT_MAX];
+};
+
+_Static_assert(sizeof(struct nct_fleet_frame) == 16, "frame header is 16 bytes");
+_Static_assert(sizeof(struct nct_fleet_rollup) % 8 == 0 && sizeof(struct nct_fleet_event) % 8 == 0,
+	       "records stay 8-byte aligned");
+_Static_assert(sizeof(struct nct_fleet_rollup) + NCT_FLEET_CHANNELS * sizeof(struct nct_fleet_agg) <= UINT16_MAX,
+	       "rec.size holds a full rollup record");
+
+static const char *const nct_fleet_event_name[NCT_FLEET_EV_KIND_COUNT] = {
+	[NCT_FLEET_EV_SAMPLER_UP] = "sampler_up",
+	[NCT_FLEET_EV_SAMPLER_DOWN] = "sampler_down",
+	[NCT_FLEET_EV_PROFILE_APPLIED] = "profile_applied",
+	[NCT_FLEET_EV_PROFILE_FAILED] = "profile_failed",
+	[NCT_FLEET_EV_BATCHES_DROPPED] = "batches_dropped",
+	[NCT_FLEET_EV_ALARM_RAISED] = "alarm_raised",
+	[NCT_FLEET_EV_ALARM_CLEARED] = "alarm_cleared",
+};
+
+static inline size_t nct_fleet_rollup_size(uint32_t nchannels) {
+	return sizeof(struct nct_fleet_rollup) + (size_t)nchannels * sizeof(struct nct_fleet_agg);
+}
+
+/* Bytes covered by the signature before the plan: magic .. reserved */
+static inline size_t nct_fleet_signed_header(void) {
+	return offsetof(struct nct_fleet_profile, signature);
+}
+
+/*
+ * nct_fleet_frame_ok() - Validate a received frame header
+ * RETURNS: 1 if length payload bytes may follow, 0 to drop the connection
+ */
+static inline int nct_fleet_frame_ok(const struct nct_fleet_frame *f) {
+	return f->magic == NCT_FLEET_MAGIC && f->type >= NCT_FLEET_HELLO && f->type <= NCT_FLEET_RESULT &&
+	       f->length <= NCT_FLEET_FRAME_MAX;
+}
+
+/*
+ * nct_fleet_next_rec() - Record at *off of an inflated batch, then advance
+ * RETURNS: record, or NULL at the end or on a malformed size
+ */
+static inline const struct nct_fleet_rec *nct_fleet_next_rec(const void *raw, size_t len, size_t *off) {
+	if (*off + sizeof(struct nct_fleet_rec) > len) {
+		return NULL;
+	}
+	const struct nct_fleet_rec *r = (const struct nct_fleet_rec *)((const char *)raw + *off);
+	if (r->size < sizeof(*r) || r->size % 8 != 0 || *off + r->size > len) {
+		return NULL;
+	}
+	*off += r->size;
+	return r;
+}
+
+#endif /* NCT_FLEET_H */
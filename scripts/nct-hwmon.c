@@ -0,0 +1,452 @@
+/*
+ * nct-hwmon.c - hwmon sysfs discovery and channel access (see nct-hwmon.h)
+ */
+
+#define _GNU_SOURCE
+#include "nct-hwmon.h"
+#include "nct-stats.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * read_text() - Read a one-line attribute or cache file, newline stripped
+ * RETURNS: 0 on success, -1 if missing or empty
+ */
+static int read_text(const char *path, char *buf, size_t len) {
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return -1;
+	}
+	ssize_t n = read(fd, buf, len - 1);
+	close(fd);
+	if (n <= 0) {
+		return -1;
+	}
+	buf[n] = '\0';
+	buf[strcspn(buf, "\n")] = '\0';
+	return 0;
+}
+
+/*
+ * device_of() - Resolve hwmonN/device to its /sys/devices path
+ * WHY: hwmonN numbering follows probe order (GPUs, NVMe, k10temp all
+ *      register hwmon devices); the platform device path does not change
+ */
+static int device_of(const char *hwmon, char *out, size_t len) {
+	char link[HWMON_PATH_MAX + sizeof("/device")];
+	char real[PATH_MAX];
+	snprintf(link, sizeof(link), "%s/device", hwmon);
+	if (!realpath(link, real) || strlen(real) >= len) {
+		return -1;
+	}
+	memcpy(out, real, strlen(real) + 1);
+	return 0;
+}
+
+/*
+ * cache_load() - Accept the cached resolution only if it still describes
+ *                the same chip at the same platform device
+ * HOW:  Parse key=value lines, then re-read hwmon/name and re-resolve
+ *       hwmon/device; any mismatch is a miss
+ */
+static int cache_load(struct hwmon_resolution *res) {
+	FILE *f = fopen(HWMON_CACHE_PATH, "re");
+	if (!f) {
+		return -1;
+	}
+	memset(res, 0, sizeof(*res));
+	static const struct {
+		const char *key;
+		size_t offset;
+		size_t size;
+	} fields[] = {
+		{"name=", offsetof(struct hwmon_resolution, name), HWMON_ATTR_MAX},
+		{"hwmon=", offsetof(struct hwmon_resolution, hwmon), HWMON_PATH_MAX},
+		{"platform=", offsetof(struct hwmon_resolution, platform), HWMON_PATH_MAX},
+	};
+	char line[HWMON_PATH_MAX + 16];
+	while (fgets(line, sizeof(line), f)) {
+		line[strcspn(line, "\n")] = '\0';
+		for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); ++i) {
+			size_t klen = strlen(fields[i].key);
+			if (strncmp(line, fields[i].key, klen) != 0) {
+				continue;
+			}
+			size_t vlen = strlen(line + klen);
+			if (vlen < fields[i].size) {
+				memcpy((char *)res + fields[i].offset, line + klen, vlen + 1);
+			}
+		}
+	}
+	fclose(f);
+	if (!res->name[0] || !res->hwmon[0] || !res->platform[0]) {
+		return -1;
+	}
+
+	char name_path[HWMON_PATH_MAX + sizeof("/name")];
+	char name[HWMON_ATTR_MAX];
+	char platform[HWMON_PATH_MAX];
+	snprintf(name_path, sizeof(name_path), "%s/name", res->hwmon);
+	if (read_text(name_path, name, sizeof(name)) < 0 || strcmp(name, res->name) != 0 ||
+	    device_of(res->hwmon, platform, sizeof(platform)) < 0 || strcmp(platform, res->platform) != 0) {
+		return -1;
+	}
+	res->cached = 1;
+	return 0;
+}
+
+/*
+ * cache_store() - Atomically replace HWMON_CACHE_PATH (tmp file + rename)
+ * NOTE: Failure (e.g. not root, /run read-only) is not an error; the next
+ *       caller simply rescans
+ */
+static void cache_store(const struct hwmon_resolution *res) {
+	char tmp[sizeof(HWMON_CACHE_PATH) + 16];
+	snprintf(tmp, sizeof(tmp), "%s.%d", HWMON_CACHE_PATH, (int)getpid());
+	FILE *f = fopen(tmp, "we");
+	if (!f) {
+		return;
+	}
+	fprintf(f, "# nct-hwmon resolver cache (rewritten on hwmon add/remove)\n"
+		   "name=%s\nhwmon=%s\nplatform=%s\n", res->name, res->hwmon, res->platform);
+	if (fclose(f) != 0 || rename(tmp, HWMON_CACHE_PATH) < 0) {
+		unlink(tmp);
+	}
+}
+
+/*
+ * scan() - Full /sys/class/hwmon walk for an NCT67xx device
+ * HOW:  Read each hwmonN/name once and match the "nct67" prefix used by
+ *       every nct6775-driven chip; a device on the nct6775.<base> ISA
+ *       platform device wins over any other match (e.g. an I2C-attached
+ *       nct67xx on a BMC board)
+ */
+static int scan(struct hwmon_resolution *res) {
+	DIR *dir = opendir(HWMON_CLASS_PATH);
+	if (!dir) {
+		return -1;
+	}
+
+	int rc = -1;
+	struct dirent *de;
+	while ((de = readdir(dir)) != NULL) {
+		if (strncmp(de->d_name, "hwmon", 5) != 0) {
+			continue;
+		}
+
+		struct hwmon_resolution cand = {0};
+		char name_path[sizeof(HWMON_CLASS_PATH) + sizeof(de->d_name) + sizeof("/name")];
+		snprintf(name_path, sizeof(name_path), "%s/%s/name", HWMON_CLASS_PATH, de->d_name);
+		if (read_text(name_path, cand.name, sizeof(cand.name)) < 0 ||
+		    strncmp(cand.name, HWMON_NAME_PREFIX, strlen(HWMON_NAME_PREFIX)) != 0) {
+			continue;
+		}
+		int n = snprintf(cand.hwmon, sizeof(cand.hwmon), "%s/%s", HWMON_CLASS_PATH, de->d_name);
+		if (n < 0 || (size_t)n >= sizeof(cand.hwmon) ||
+		    device_of(cand.hwmon, cand.platform, sizeof(cand.platform)) < 0) {
+			continue;
+		}
+
+		const char *base = strrchr(cand.platform, '/');
+		int isa = strncmp(base ? base + 1 : cand.platform, HWMON_PLATFORM_PREFIX,
+				  strlen(HWMON_PLATFORM_PREFIX)) == 0;
+		if (rc < 0 || isa) {
+			*res = cand;
+			rc = 0;
+		}
+		if (isa) {
+			break;
+		}
+	}
+	closedir(dir);
+	return rc;
+}
+
+/*
+ * hwmon_resolve() - Locate the NCT67xx hwmon directory via the /run cache
+ * WHEN: Startup of every tool and script; udev calls it with
+ *       HWMON_RESOLVE_REFRESH on every hwmon add/remove
+ * RETURNS: 0 with res filled (res->cached says whether the scan was
+ *          skipped), or -1 if no device matched (a stale cache is removed)
+ */
+int hwmon_resolve(struct hwmon_resolution *res, unsigned flags) {
+	if (!(flags & HWMON_RESOLVE_REFRESH) && cache_load(res) == 0) {
+		return 0;
+	}
+
+	memset(res, 0, sizeof(*res));
+	if (scan(res) < 0) {
+		unlink(HWMON_CACHE_PATH);
+		return -1;
+	}
+	cache_store(res);
+	return 0;
+}
+
+/*
+ * hwmon_find_by_name() - Locate another driver's hwmon device by its name
+ * WHEN: nct-fanctl sources such as "amdgpu/temp1_input" or "nvme/temp1_input"
+ * HOW:  Lowest-numbered hwmonN whose name matches exactly, so a box with
+ *       two NVMe drives always picks the same one (use a full path for the
+ *       other)
+ * RETURNS: 0 with the hwmon directory in out, -1 if nothing matched
+ */
+int hwmon_find_by_name(const char *name, char *out, size_t len) {
+	DIR *dir = opendir(HWMON_CLASS_PATH);
+	if (!dir) {
+		return -1;
+	}
+
+	long best = -1;
+	struct dirent *de;
+	while ((de = readdir(dir)) != NULL) {
+		if (strncmp(de->d_name, "hwmon", 5) != 0) {
+			continue;
+		}
+		char path[sizeof(HWMON_CLASS_PATH) + sizeof(de->d_name) + sizeof("/name")];
+		char found[HWMON_ATTR_MAX];
+		snprintf(path, sizeof(path), "%s/%s/name", HWMON_CLASS_PATH, de->d_name);
+		if (read_text(path, found, sizeof(found)) < 0 || strcmp(found, name) != 0) {
+			continue;
+		}
+		long index = strtol(de->d_name + 5, NULL, 10);
+		if (best >= 0 && index >= best) {
+			continue;
+		}
+		int n = snprintf(out, len, "%s/%s", HWMON_CLASS_PATH, de->d_name);
+		if (n > 0 && (size_t)n < len) {
+			best = index;
+		}
+	}
+	closedir(dir);
+	return best >= 0 ? 0 : -1;
+}
+
+static int device_cmp(const void *a, const void *b) {
+	const struct hwmon_device *x = a;
+	const struct hwmon_device *y = b;
+	return x->index - y->index;
+}
+
+/*
+ * hwmon_list_devices() - Every registered hwmon device, by name
+ * WHEN: nct-sampler --device all / --device NAME
+ * HOW:  One pass over HWMON_CLASS_PATH; devices without a readable name
+ *       are skipped. Sorted by N in hwmonN, so the first entry of a given
+ *       name is the one hwmon_find_by_name() picks
+ * RETURNS: number of devices (<= max), or -1 if the class is missing
+ */
+int hwmon_list_devices(struct hwmon_device *out, int max) {
+	DIR *dir = opendir(HWMON_CLASS_PATH);
+	if (!dir) {
+		return -1;
+	}
+
+	int n = 0;
+	struct dirent *de;
+	while (n < max && (de = readdir(dir)) != NULL) {
+		if (strncmp(de->d_name, "hwmon", 5) != 0) {
+			continue;
+		}
+		char path[sizeof(HWMON_CLASS_PATH) + sizeof(de->d_name) + sizeof("/name")];
+		snprintf(path, sizeof(path), "%s/%s/name", HWMON_CLASS_PATH, de->d_name);
+		if (read_text(path, out[n].name, sizeof(out[n].name)) < 0) {
+			continue;
+		}
+		int len = snprintf(out[n].hwmon, sizeof(out[n].hwmon), "%s/%s", HWMON_CLASS_PATH, de->d_name);
+		if (len <= 0 || (size_t)len >= sizeof(out[n].hwmon)) {
+			continue;
+		}
+		out[n].index = (int)strtol(de->d_name + 5, NULL, 10);
+		n++;
+	}
+	closedir(dir);
+
+	qsort(out, (size_t)n, sizeof(out[0]), device_cmp);
+	return n;
+}
+
+/*
+ * classify() - Map an attribute name to a sampled channel kind
+ * ACCEPTS: tempN_input, fanN_input, inN_input, pwmN, pwmN_enable
+ * RETURNS: kind, or -1 for attributes the sampler does not read
+ */
+static int classify(const char *name, int *index) {
+	static const struct {
+		const char *prefix;
+		const char *suffix;
+		enum hwmon_kind kind;
+	} patterns[] = {
+		{"temp", "_input", HWMON_TEMP},
+		{"fan", "_input", HWMON_FAN},
+		{"in", "_input", HWMON_IN},
+		{"pwm", "_enable", HWMON_PWM_ENABLE},
+		{"pwm", "", HWMON_PWM},
+	};
+
+	for (size_t i = 0; i < sizeof(patterns) / sizeof(patterns[0]); ++i) {
+		size_t plen = strlen(patterns[i].prefix);
+		if (strncmp(name, patterns[i].prefix, plen) != 0) {
+			continue;
+		}
+		char *end;
+		long n = strtol(name + plen, &end, 10);
+		if (end == name + plen || strcmp(end, patterns[i].suffix) != 0) {
+			continue;
+		}
+		*index = (int)n;
+		return patterns[i].kind;
+	}
+	return -1;
+}
+
+/*
+ * read_label() - Read the companion <kind>N_label attribute, if any
+ * WHY: temp sources are only meaningful by label (SYSTIN, CPUTIN, AUXTIN0,
+ *      PECI Agent 0, ...); tempN numbering differs between boards
+ */
+static void read_label(int dirfd, const char *prefix, int index, char *label, size_t len) {
+	char attr[HWMON_ATTR_MAX + 8];
+	snprintf(attr, sizeof(attr), "%s%d_label", prefix, index);
+	label[0] = '\0';
+
+	int fd = openat(dirfd, attr, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return;
+	}
+	ssize_t n = read(fd, label, len - 1);
+	close(fd);
+	if (n <= 0) {
+		label[0] = '\0';
+		return;
+	}
+	label[n] = '\0';
+	label[strcspn(label, "\n")] = '\0';
+}
+
+static int channel_cmp(const void *a, const void *b) {
+	const struct hwmon_channel *x = a;
+	const struct hwmon_channel *y = b;
+	if (x->kind != y->kind) {
+		return (int)x->kind - (int)y->kind;
+	}
+	return x->index - y->index;
+}
+
+/*
+ * hwmon_scan_channels() - Enumerate and open every sampled attribute
+ * WHEN: Once at startup; the fds stay open for the life of the process
+ * RETURNS: number of channels opened (<= max), or -1 on readdir failure
+ */
+int hwmon_scan_channels(int dirfd, struct hwmon_channel *out, int max) {
+	int dup_fd = dup(dirfd);
+	if (dup_fd < 0) {
+		return -1;
+	}
+	DIR *dir = fdopendir(dup_fd);
+	if (!dir) {
+		close(dup_fd);
+		return -1;
+	}
+
+	int n = 0;
+	struct dirent *de;
+	while (n < max && (de = readdir(dir)) != NULL) {
+		int index;
+		int kind = classify(de->d_name, &index);
+		if (kind < 0 || strlen(de->d_name) >= HWMON_ATTR_MAX) {
+			continue;
+		}
+
+		int fd = openat(dirfd, de->d_name, O_RDONLY | O_CLOEXEC);
+		if (fd < 0) {
+			continue;
+		}
+		snprintf(out[n].name, sizeof(out[n].name), "%s", de->d_name);
+		out[n].kind = (enum hwmon_kind)kind;
+		out[n].index = index;
+		out[n].fd = fd;
+		if (kind == HWMON_TEMP || kind == HWMON_FAN || kind == HWMON_IN) {
+			static const char *const prefixes[] = {"temp", "fan", "in"};
+			read_label(dirfd, prefixes[kind], index, out[n].label, sizeof(out[n].label));
+		} else {
+			out[n].label[0] = '\0';
+		}
+		n++;
+	}
+	closedir(dir);
+
+	qsort(out, (size_t)n, sizeof(out[0]), channel_cmp);
+	return n;
+}
+
+void hwmon_close_channels(struct hwmon_channel *ch, int n) {
+	for (int i = 0; i < n; ++i) {
+		if (ch[i].fd >= 0) {
+			close(ch[i].fd);
+			ch[i].fd = -1;
+		}
+	}
+}
+
+/*
+ * hwmon_read_int() - Re-read an integer attribute through its open fd
+ * HOW:  One pread() at offset 0 into a stack buffer, hand-rolled decimal
+ *       parse (sysfs values are plain [-]digits + newline)
+ * RETURNS: 0 on success, -errno on read failure, -EINVAL on bad text
+ */
+int hwmon_read_int(int fd, int32_t *value) {
+	char buf[24];
+	uint64_t t = nct_stats_begin();
+	ssize_t n = pread(fd, buf, sizeof(buf) - 1, 0);
+	nct_stats_end(NCT_OP_SYSFS_READ, t);
+	if (n < 0) {
+		return -errno;
+	}
+	return hwmon_parse_int(buf, (size_t)n, value);
+}
+
+/*
+ * hwmon_parse_int() - Decode the text of one integer attribute
+ * WHEN: hwmon_read_int(), and callers that read attributes some other way
+ *       (nct-sampler's io_uring batch)
+ * RETURNS: 0, or -EINVAL if buf[0..n) does not start with [-]digits
+ */
+int hwmon_parse_int(const char *buf, size_t n, int32_t *value) {
+	const char *p = buf;
+	const char *end = buf + n;
+	int neg = 0;
+	if (p < end && *p == '-') {
+		neg = 1;
+		p++;
+	}
+	if (p == end || *p < '0' || *p > '9') {
+		return -EINVAL;
+	}
+
+	int64_t v = 0;
+	while (p < end && *p >= '0' && *p <= '9') {
+		v = v * 10 + (*p++ - '0');
+	}
+	*value = (int32_t)(neg ? -v : v);
+	return 0;
+}
+
+const char *hwmon_kind_name(enum hwmon_kind kind) {
+	static const char *const names[HWMON_KIND_COUNT] = {
+		[HWMON_TEMP] = "temp",
+		[HWMON_FAN] = "fan",
+		[HWMON_IN] = "in",
+		[HWMON_PWM] = "pwm",
+		[HWMON_PWM_ENABLE] = "pwm_enable",
+	};
+	return kind < HWMON_KIND_COUNT ? names[kind] : "unknown";
+}
@@ -0,0 +1,97 @@
+/*
+ * nct-hwmon.h - hwmon sysfs discovery and channel access for native tools
+ *
+ * PURPOSE:
+ *   Shared by the native tools that read the nct6775 hwmon interface
+ *   (nct-sampler, nct-fanctl, ...). Discovery runs once; afterwards every channel is
+ *   an open file descriptor re-read with pread(2) at offset 0.
+ *
+ * WHY pread AT OFFSET 0:
+ *   sysfs regenerates an attribute's text whenever it is read from offset 0,
+ *   so an fd can stay open for the life of the process. This replaces the
+ *   open/read/close (or `cat` fork) per value in the shell scripts.
+ *
+ * CHANNEL ORDER:
+ *   hwmon_scan_channels() returns channels sorted by kind (temp, fan, in,
+ *   pwm, pwm_enable) and then by index, so a given chip always yields the
+ *   same layout regardless of readdir() order.
+ *
+ * RESOLUTION CACHE:
+ *   hwmon_resolve() maps the chip to its stable platform device (e.g.
+ *   /sys/devices/platform/nct6775.656, 656 = HWM base 0x290) and to the
+ *   hwmonN directory the kernel gave it this boot, and records both in
+ *   HWMON_CACHE_PATH. A cache hit costs one realpath() and one name read;
+ *   the full /sys/class/hwmon scan only happens on a miss or when udev
+ *   reports a hwmon add/remove (udev/60-nct-hwmon-cache.rules runs
+ *   `nct-fan --resolve --refresh`). Shell scripts read the same file:
+ *     # nct-hwmon resolver cache
+ *     name=nct6798
+ *     hwmon=/sys/class/hwmon/hwmon4
+ *     platform=/sys/devices/platform/nct6775.656
+ */
+
+#ifndef NCT_HWMON_H
+#define NCT_HWMON_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef HWMON_CLASS_PATH
+#define HWMON_CLASS_PATH  "/sys/class/hwmon"
+#endif
+#define HWMON_NAME_PREFIX "nct67"    /* nct6796, nct6798, nct6799, ... */
+#define HWMON_PATH_MAX    256
+#define HWMON_ATTR_MAX    32
+#ifndef HWMON_CACHE_PATH
+#define HWMON_CACHE_PATH  "/run/nct-hwmon.cache"   /* tmpfs: cleared every boot */
+#endif
+#define HWMON_PLATFORM_PREFIX "nct6775."            /* ISA platform device name */
+
+#define HWMON_RESOLVE_REFRESH 0x1    /* ignore the cache, rescan and rewrite it */
+
+enum hwmon_kind {
+	HWMON_TEMP,         /* tempN_input, millidegrees C */
+	HWMON_FAN,          /* fanN_input, RPM */
+	HWMON_IN,           /* inN_input, millivolts */
+	HWMON_PWM,          /* pwmN, duty 0-255 */
+	HWMON_PWM_ENABLE,   /* pwmN_enable, mode 0/1/2/3/5 */
+	HWMON_KIND_COUNT,
+};
+
+struct hwmon_channel {
+	char name[HWMON_ATTR_MAX];   /* attribute file name, e.g. "temp1_input" */
+	char label[HWMON_ATTR_MAX];  /* tempN_label etc. e.g. "CPUTIN", "" if none */
+	enum hwmon_kind kind;
+	int index;                   /* N in tempN_input / pwmN */
+	int fd;                      /* O_RDONLY, kept open */
+};
+
+/*
+ * struct hwmon_resolution - Where the chip lives, as recorded in the cache
+ */
+struct hwmon_resolution {
+	char name[HWMON_ATTR_MAX];          /* hwmonN/name, e.g. "nct6798" */
+	char hwmon[HWMON_PATH_MAX];         /* /sys/class/hwmon/hwmonN */
+	char platform[HWMON_PATH_MAX];      /* realpath of hwmonN/device */
+	int cached;                         /* 1 if served from HWMON_CACHE_PATH */
+};
+
+/*
+ * struct hwmon_device - Any driver's hwmon device (k10temp, amdgpu, nvme, ...)
+ */
+struct hwmon_device {
+	char name[HWMON_ATTR_MAX];          /* hwmonN/name */
+	char hwmon[HWMON_PATH_MAX];         /* /sys/class/hwmon/hwmonN */
+	int index;                          /* N */
+};
+
+int hwmon_resolve(struct hwmon_resolution *res, unsigned flags);
+int hwmon_find_by_name(const char *name, char *out, size_t len);
+int hwmon_list_devices(struct hwmon_device *out, int max);
+int hwmon_scan_channels(int dirfd, struct hwmon_channel *out, int max);
+void hwmon_close_channels(struct hwmon_channel *ch, int n);
+int hwmon_read_int(int fd, int32_t *value);
+int hwmon_parse_int(const char *buf, size_t n, int32_t *value);
+const char *hwmon_kind_name(enum hwmon_kind kind);
+
+#endif /* NCT_HWMON_H */
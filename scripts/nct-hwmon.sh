@@ -0,0 +1,79 @@
+#!/bin/bash
+################################################################################
+# nct-hwmon.sh - NCT67xx hwmon resolution shared by the max-fans*.sh scripts
+#
+# PURPOSE:
+#   One copy of "where is nct-fan" and "which hwmonN is the Super I/O" for
+#   max-fans.sh, max-fans-enhanced.sh and max-fans-advanced.sh, which
+#   source it from their own directory (/usr/lib/eirikr, or scripts/ in a
+#   source checkout). Not executable on its own.
+#
+# PROVIDES:
+#   HWMON_PATH, HWMON_CACHE   sysfs class directory, resolver cache
+#   find_nct_fan              path of the nct-fan binary
+#   resolve_nct_hwmon         the NCT67xx hwmon directory
+#
+# WHY:
+#   GPUs, NVMe drives and k10temp also register hwmon devices; only the
+#   nct6775 platform device may be touched. The cache format and the
+#   fallback order are hwmon_resolve()'s (nct-hwmon.c), so they live in
+#   one place on the shell side too.
+################################################################################
+
+readonly HWMON_PATH="/sys/class/hwmon"
+readonly HWMON_CACHE="/run/nct-hwmon.cache"
+
+find_nct_fan() {
+	# PURPOSE: Locate the nct-fan native tool
+	# WHY: Installed next to the scripts (/usr/lib/eirikr), or at the repo
+	#      root after `make build` when run from a source checkout
+	# RETURNS: 0 and the path on stdout ($NCT_FAN overrides the search)
+
+	local lib_dir candidate
+	lib_dir="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+	for candidate in "${NCT_FAN:-}" "$lib_dir/nct-fan" "$lib_dir/../nct-fan"; do
+		if [[ -n "$candidate" && -x "$candidate" ]]; then
+			echo "$candidate"
+			return 0
+		fi
+	done
+	return 1
+}
+
+resolve_nct_hwmon() {
+	# PURPOSE: Return the NCT67xx hwmon directory without scanning every hwmon
+	# HOW: 1. $HWMON_CACHE, accepted while hwmon/name still matches
+	#         (udev/60-nct-hwmon-cache.rules refreshes it on hwmon add/remove)
+	#      2. `nct-fan --resolve`: full rescan, rewrites the cache
+	#      3. Direct nct67* name match when nct-fan is not built
+	# RETURNS: 0 and the directory on stdout, 1 if no device
+
+	local key value name="" hwmon="" current=""
+	if [[ -r "$HWMON_CACHE" ]]; then
+		while IFS='=' read -r key value; do
+			case "$key" in
+			name) name="$value" ;;
+			hwmon) hwmon="$value" ;;
+			esac
+		done <"$HWMON_CACHE"
+		if [[ -n "$hwmon" && -r "$hwmon/name" ]] && read -r current <"$hwmon/name" &&
+			[[ -n "$name" && "$current" == "$name" ]]; then
+			echo "$hwmon"
+			return 0
+		fi
+	fi
+
+	local nct_fan
+	if nct_fan=$(find_nct_fan); then
+		"$nct_fan" --resolve 2>/dev/null
+		return
+	fi
+
+	for hwmon in "$HWMON_PATH"/hwmon*; do
+		if [[ -r "$hwmon/name" ]] && read -r current <"$hwmon/name" && [[ "$current" == nct67* ]]; then
+			echo "$hwmon"
+			return 0
+		fi
+	done
+	return 1
+}
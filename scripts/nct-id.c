@@ -14,9 +14,10 @@
  *   3. Read configuration registers (CR): write reg# to index, read from data+1
  *   4. Exit: write 0xAA to index port
  *
- *   For NCT6798D specifically:
- *   - Chip ID (CR 0x20/0x21): expect 0xD428 (verified against Linux driver tables)
- *   - HWM base (CR 0x60/0x61 in device 0x0B): typically 0x0290, selectable 0x290-0x29F
+ *   Chip identity comes from the descriptor tables in nct-chip.h:
+ *   - Chip ID (CR 0x20/0x21, low 3 bits = revision): 0xD420 NCT6796D,
+ *     0xD428 NCT6798D (0xD42B = revision 3), 0xD800 NCT6799D
+ *   - HWM base (CR 0x60/0x61 in device 0x0B): typically 0x0290 on ASUS
  *   - PWM/Fan registers: indexed via base+5 (index), base+6 (data)
  *
  * WHY THIS MATTERS:
@@ -28,13 +29,43 @@
  *   protocol, informing kernel driver strategy.
  *
  * USAGE:
- *   Compile: gcc -std=c23 -O2 -Wall -Wextra -o nct-id nct-id.c
- *   Run:     sudo ./nct-id
+ *   Compile: gcc -std=c23 -O2 -Wall -Wextra -o nct-id nct-id.c nct-hwmon.c nct-isa.c nct-sio.c nct-wmi.c nct-stats.c
+ *   Run:     ./nct-id
+ *            Fast path: when the nct6775 driver is bound, report the chip,
+ *            HWM base and access method (ISA or ASUS WMI) from sysfs,
+ *            /proc/ioports and the kernel log. No port is touched, so it
+ *            cannot race the driver. Exits 1 if no driver is bound.
+ *
+ *   Probe:   sudo ./nct-id --probe
+ *            Raw Super I/O probe (0x87/0x87 enter sequence on 0x2E and
+ *            0x4E, requires root for ioperm(2)); prints the identified chip
+ *            and its channel counts, an unsupported chip with its raw DEVID.
+ *            --backend isa|wmi and --dump also imply the raw path.
  *            (requires root for ioperm(2) access to 0x2E/0x4E ISA ports)
  *
+ *   Locked:  sudo ./nct-id --backend wmi
+ *            Read the same registers through the ASUS WMI RSIO/RHWM methods
+ *            (nct-wmi.h, needs acpi_call). The default --backend auto falls
+ *            back to WMI when ioperm() is denied on both SIO ports, instead
+ *            of printing nothing.
+ *
+ *   Snapshot: sudo ./nct-id --dump [--format bin|hex|json] [-o FILE]
+ *            After locating the HWM base, read every HWM bank through the
+ *            base+5/base+6 index/data pair in one tight pass and emit a
+ *            point-in-time register image (see HWM SNAPSHOT FORMAT below).
+ *            Default format is the compact binary image on stdout.
+ *            Refused (exit 2) while nct6775 is bound, whether it uses ISA
+ *            or ASUS WMI: both drive base+5/base+6. Use --backend wmi, or
+ *            --force to dump through the ports anyway.
+ *
+ *   Stats:   sudo ./nct-id --dump -o /dev/null --stats
+ *            Port operations issued/saved, WMI call counts, and log2
+ *            latency histograms per operation class (nct-stats.h) on stderr.
+ *
  * EXPECTED OUTPUT (ASUS B550 + NCT6798D):
- *   SIO at 0x2E: DEVID=0xD428  HWM base=0x0290 (index/data @ base+5/base+6)
- *     DEVID: Matches Linux driver's NCT6798D identification
+ *   Kernel nct6775 (platform nct6775.656): NCT6798D (7 pwm, 7 fan, 7 temp, 15 in)  HWM base=0x0290 via ASUS WMI
+ *   SIO at 0x2E (--probe): NCT6798D rev 0 (7 pwm, 7 fan, 7 temp, 15 in)  HWM base=0x0290 (index/data @ base+5/base+6)
+ *     Chip:  DEVID 0xD428 matched in nct-chip.h (Linux driver SIO_ID_MASK)
  *     Base:  Firmware sets HWM to 0x0290 (configurable, but 0x0290 is standard)
  *     Index/Data: At offsets +5 and +6 from base (hardcoded per Nuvoton design)
  *
@@ -44,6 +75,14 @@
  *   - This is informational; actual fan control should use kernel nct6775 driver
  *   - On systems with WMI, the kernel driver avoids these ports altogether
  *
+ * HWM SNAPSHOT FORMAT (--dump --format bin):
+ *   struct hwm_image_header (32 bytes, little-endian, see below), followed by
+ *   nbanks x 256 register bytes; register (bank B, index R) lives at
+ *   offset 32 + B*256 + R. One image covers all sensors, the SmartFan IV
+ *   block (0x80-0xCF) and the weighting registers (0x75-0x79) in every bank.
+ *   --format hex prints a 16-column hexdump per bank; --format json prints
+ *   one object with the header fields and a hex string per bank.
+ *
  * REFERENCES (for decision justification):
  *   - Linux kernel nct6775 driver: drivers/hwmon/nct6775.c (chip ID tables)
  *   - Nuvoton NCT6796D datasheet (public): register layout, SIO protocol
@@ -54,85 +93,347 @@
 #define _GNU_SOURCE
 #include <errno.h>
 #include <inttypes.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <sys/io.h>
+#include <string.h>
+#include <sys/klog.h>
+#include <time.h>
 #include <unistd.h>
 
+#include "nct-chip.h"
+#include "nct-hwmon.h"
+#include "nct-isa.h"
+#include "nct-sio.h"
+#include "nct-stats.h"
+#include "nct-wmi.h"
+
+/*
+ * struct hwm_image_header - Header of a binary HWM snapshot
+ * WHY fixed layout: Images are archived and diffed across incidents and
+ *     kernels, so the format must not depend on compiler padding
+ */
+struct hwm_image_header {
+	char magic[8];          /* "NCTHWM\0" + format version byte (1) */
+	uint16_t devid;         /* CR 0x20/0x21 */
+	uint16_t base;          /* CR 0x60/0x61 */
+	uint16_t sio_port;      /* 0x2E or 0x4E; 0 = read through ASUS WMI */
+	uint8_t nbanks;         /* banks that follow the header */
+	uint8_t orig_bank;      /* bank-select value restored after the pass */
+	uint64_t realtime_ns;   /* CLOCK_REALTIME at start of pass */
+	uint32_t pass_ns;       /* duration of the read pass (consistency window) */
+	uint32_t reserved;
+};
+
+_Static_assert(sizeof(struct hwm_image_header) == 32, "HWM image header must be 32 bytes");
+
+enum backend {
+	BACKEND_AUTO,           /* ISA, then WMI if no SIO port is accessible */
+	BACKEND_ISA,
+	BACKEND_WMI,
+};
+
 /*
- * HELPER MACROS: Hide inb()/outb() C99 register semantics
- * WHY: Makes register operations explicit and readable
+ * struct kernel_id - What the bound nct6775 driver already knows
+ * access: "ISA" (driver holds base+5/base+6 in /proc/ioports), "ASUS WMI"
+ *         (bound, no region, or the kernel log says so), or "unknown"
  */
-static inline void outb_u8(unsigned short port, unsigned char val) {
-	outb(val, port);
+struct kernel_id {
+	struct hwmon_resolution res;
+	const struct nct_chip *chip;
+	uint16_t base;
+	uint16_t sio_port;      /* from the kernel log; 0 = not logged */
+	char driver[32];
+	const char *access;
+};
+
+enum dump_format {
+	DUMP_NONE,
+	DUMP_BIN,
+	DUMP_HEX,
+	DUMP_JSON,
+};
+
+static uint64_t clock_ns(clockid_t clk) {
+	struct timespec ts;
+	clock_gettime(clk, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
 }
 
-static inline unsigned char inb_u8(unsigned short port) {
-	return inb(port);
+/*
+ * klog_scan() - Pick the driver's probe messages out of the kernel log
+ * WHAT: "nct6775: Found NCT6798D or compatible chip at 0x2e:0x290" (SIO
+ *       port and base) and "nct6775: Using Asus WMI to access 0xc1 chip."
+ * WHY:  The only place the access method is recorded when /proc/ioports
+ *       is not readable with addresses (non-root)
+ * RETURNS: 1 if a probe message was found, 0 if not (log rotated or
+ *          dmesg_restrict denies SYSLOG_ACTION_READ_ALL)
+ */
+static int klog_scan(struct kernel_id *k, bool *wmi) {
+	int size = klogctl(10, NULL, 0);   /* SYSLOG_ACTION_SIZE_BUFFER */
+	if (size <= 0) {
+		return 0;
+	}
+	char *buf = malloc((size_t)size + 1);
+	if (!buf) {
+		return 0;
+	}
+	int n = klogctl(3, buf, size);     /* SYSLOG_ACTION_READ_ALL */
+	int found = 0;
+	buf[n > 0 ? n : 0] = '\0';
+	for (char *line = strtok(buf, "\n"); line; line = strtok(NULL, "\n")) {
+		const char *msg = strstr(line, "nct6775: ");
+		if (!msg) {
+			continue;
+		}
+		msg += strlen("nct6775: ");
+		const char *at = strstr(msg, " compatible chip at ");
+		unsigned port, base;
+		if (strncmp(msg, "Found ", 6) == 0 && at &&
+		    sscanf(at, " compatible chip at %x:%x", &port, &base) == 2) {
+			k->sio_port = (uint16_t)port;
+			found = 1;
+		} else if (strncmp(msg, "Using Asus WMI", 14) == 0) {
+			*wmi = true;
+			found = 1;
+		}
+	}
+	free(buf);
+	return found;
 }
 
 /*
- * sio_enter() - Enter Extended Function Mode
- * WHEN: At start of chip interrogation
- * HOW:  Write magic bytes 0x87, 0x87 to index port (0x2E or 0x4E)
- * WHY:  Nuvoton Super I/O protocol requirement; unlocks CR access
- * WHO:  Called by main() for each candidate SIO index port
+ * kernel_identify() - Identify the chip through the bound nct6775 driver
+ * WHEN: Default mode; the raw Super I/O probe only runs on request
+ * HOW:  1. hwmon_resolve(): cached hwmonN + platform device nct6775.<base>
+ *       2. hwmonN/name -> descriptor (nct_chip_by_driver)
+ *       3. platform/driver symlink -> bound driver
+ *       4. /proc/ioports: the driver claims base+5/base+6 only when it
+ *          drives the ports itself (ISA); bound without a claim = WMI
+ *       5. kernel log (only if ioports was not conclusive, e.g. non-root
+ *          sees zeroed addresses): WMI message, and the SIO port
+ * WHY:  ioperm() plus the 0x87/0x87 enter sequence on two ports is the
+ *       slow part of nct-id and races the driver's own SIO accesses
+ * RETURNS: 0 when a driver is bound, -1 otherwise
  */
-static int sio_enter(unsigned short idx) {
-	/*
-	 * Request I/O permission for index and data ports.
-	 * WHY two ports: idx is index, idx+1 is data (read/write alternation)
-	 * SAFETY: ioperm() checks ACPI ASL declarations; may fail if firmware owns these
-	 */
-	if (ioperm(idx, 1, 1) || ioperm(idx + 1, 1, 1)) {
-		return -1;  /* ACPI resource conflict or permission denied */
+static int kernel_identify(struct kernel_id *k) {
+	memset(k, 0, sizeof(*k));
+	k->access = "unknown";
+	if (hwmon_resolve(&k->res, 0) < 0) {
+		return -1;
+	}
+
+	const char *dev = strrchr(k->res.platform, '/');
+	dev = dev ? dev + 1 : k->res.platform;
+	if (strncmp(dev, HWMON_PLATFORM_PREFIX, strlen(HWMON_PLATFORM_PREFIX)) == 0) {
+		k->base = (uint16_t)strtoul(dev + strlen(HWMON_PLATFORM_PREFIX), NULL, 10);
+	}
+	k->chip = nct_chip_by_driver(k->res.name);
+
+	char link[HWMON_PATH_MAX + sizeof("/driver")];
+	char real[PATH_MAX];
+	snprintf(link, sizeof(link), "%s/driver", k->res.platform);
+	if (!realpath(link, real)) {
+		return -1;
 	}
+	const char *drv = strrchr(real, '/');
+	snprintf(k->driver, sizeof(k->driver), "%.31s", drv ? drv + 1 : real);
 
-	/* Magic sequence: write 0x87 twice to enter extended function mode */
-	outb_u8(idx, 0x87);
-	outb_u8(idx, 0x87);
+	char owner[96];
+	int claimed = k->base && geteuid() == 0 ?
+		isa_region_owner(k->base + HWM_INDEX_OFFSET, k->base + HWM_DATA_OFFSET, owner, sizeof(owner)) : -1;
+	if (claimed > 0 && strcmp(owner, k->driver) == 0) {
+		k->access = "ISA";
+	} else if (claimed == 0) {
+		k->access = "ASUS WMI";
+	} else {
+		/* Reading the whole log costs ~0.5 ms; only when ioports cannot say */
+		bool wmi = false;
+		if (klog_scan(k, &wmi)) {
+			k->access = wmi ? "ASUS WMI" : "ISA";
+		}
+	}
 	return 0;
 }
 
 /*
- * sio_exit() - Exit Extended Function Mode
- * WHEN: At end of chip interrogation
- * HOW:  Write 0xAA to index port
- * WHY:  Nuvoton protocol; releases lock, restores normal I/O behavior
- * WHO:  Called by main() after reading all registers
+ * hwm_snapshot() - Read every HWM bank in one pass
+ * WHEN: --dump, after the SIO probe reported a plausible base address
+ * HOW:  hwm_open() saves the current bank, hwm_read_bank() reads banks
+ *       0..HWM_BANKS-1 (one bank select each, index writes only), then
+ *       hwm_close() restores the saved bank
+ * WHY restore: The kernel nct6775 driver caches its last selected bank and
+ *       skips the 0x4E write when it believes the bank is unchanged; leaving
+ *       a different bank selected would corrupt its next read
+ * RETURNS: 0 on success, -1 if the HWM ports are not accessible
  */
-static void sio_exit(unsigned short idx) {
-	outb_u8(idx, 0xAA);
-	/* Note: ioperm() release not explicitly done here; process exit cleans up */
+static int hwm_snapshot(unsigned short base, struct hwm_image_header *hdr,
+			unsigned char regs[HWM_BANKS][HWM_BANK_SIZE], struct port_stats *stats) {
+	struct hwm_ctx hwm;
+
+	hdr->realtime_ns = clock_ns(CLOCK_REALTIME);
+	uint64_t start = clock_ns(CLOCK_MONOTONIC);
+
+	if (hwm_open(&hwm, base)) {
+		return -1;
+	}
+	hdr->orig_bank = hwm.orig_bank;
+	for (int bank = 0; bank < HWM_BANKS; ++bank) {
+		hwm_read_bank(&hwm, (uint8_t)bank, regs[bank]);
+	}
+	hwm_close(&hwm);
+
+	hdr->pass_ns = (uint32_t)(clock_ns(CLOCK_MONOTONIC) - start);
+	hdr->nbanks = HWM_BANKS;
+	port_stats_add(stats, &hwm.stats);
+	return 0;
 }
 
 /*
- * sio_write_cr() - Write a Configuration Register (CR)
- * WHEN: Setting logical device or other config (not used for HWM control)
- * HOW:  Write register number to index, value to data port
- * WHY:  Standard Super I/O protocol for non-indexed register access
- * WHO:  Called to select logical device 0x0B (HWM)
+ * wmi_snapshot() - Read every HWM bank through ASUS WMI RHWM
+ * WHEN: --dump on ACPI-locked boards (ioperm denied)
+ * HOW:  One wmi_hwm_read_many() per bank over a single acpi_call session;
+ *       RHWM takes the bank as an argument, so no bank-select calls and
+ *       nothing to restore (orig_bank is reported as 0)
+ * RETURNS: 0 on success, -1 if any firmware call failed
  */
-static void sio_write_cr(unsigned short idx, unsigned char reg, unsigned char val) {
-	outb_u8(idx, reg);       /* Index port: register selector */
-	outb_u8(idx + 1, val);   /* Data port: value to write */
+static int wmi_snapshot(struct wmi_ctx *wmi, struct hwm_image_header *hdr,
+			unsigned char regs[HWM_BANKS][HWM_BANK_SIZE]) {
+	uint16_t list[HWM_BANK_SIZE];
+	int rc = 0;
+
+	hdr->realtime_ns = clock_ns(CLOCK_REALTIME);
+	uint64_t start = clock_ns(CLOCK_MONOTONIC);
+	for (int bank = 0; bank < HWM_BANKS; ++bank) {
+		for (int index = 0; index < HWM_BANK_SIZE; ++index) {
+			list[index] = HWM_REG(bank, index);
+		}
+		if (wmi_hwm_read_many(wmi, list, HWM_BANK_SIZE, regs[bank]) < 0) {
+			rc = -1;
+		}
+	}
+	hdr->pass_ns = (uint32_t)(clock_ns(CLOCK_MONOTONIC) - start);
+	hdr->nbanks = HWM_BANKS;
+	return rc;
 }
 
 /*
- * sio_read_cr() - Read a Configuration Register (CR)
- * WHEN: Chip identification and HWM base discovery
- * HOW:  Write register number to index, read from data port
- * WHY:  Standard Super I/O protocol for CR access
- * WHO:  Called to read chip ID (CR 0x20/0x21) and HWM base (CR 0x60/0x61)
+ * stats_print() - Report port operations issued and avoided (--stats)
+ * WHY: ISA port I/O costs ~1us per access; "saved" is the latency the
+ *      shadowed access layer removed from this run
  */
-static unsigned char sio_read_cr(unsigned short idx, unsigned char reg) {
-	outb_u8(idx, reg);
-	return inb_u8(idx + 1);
+static void stats_print(FILE *out, const struct port_stats *st) {
+	fprintf(out, "port-io: outb=%" PRIu64 " inb=%" PRIu64 " saved=%" PRIu64
+		" (index=%" PRIu64 " ldn=%" PRIu64 " bank=%" PRIu64 ")\n",
+		st->outb, st->inb, port_stats_saved(st),
+		st->index_saved, st->ldn_saved, st->bank_saved);
+}
+
+/*
+ * dump_write() - Emit a snapshot in the requested format
+ * WHO: main() after a successful hwm_snapshot()
+ */
+static int dump_write(FILE *out, enum dump_format fmt, const struct hwm_image_header *hdr,
+		      unsigned char regs[HWM_BANKS][HWM_BANK_SIZE]) {
+	const struct nct_chip *chip = nct_chip_identify(hdr->devid);
+
+	switch (fmt) {
+	case DUMP_BIN:
+		if (fwrite(hdr, sizeof(*hdr), 1, out) != 1 ||
+		    fwrite(regs, HWM_BANK_SIZE, hdr->nbanks, out) != hdr->nbanks) {
+			return -1;
+		}
+		break;
+	case DUMP_HEX:
+		fprintf(out, "# SIO 0x%X %s DEVID=0x%04X base=0x%04X pass=%" PRIu32 "ns\n",
+			hdr->sio_port, chip ? chip->name : "unknown", hdr->devid, hdr->base, hdr->pass_ns);
+		for (int bank = 0; bank < hdr->nbanks; ++bank) {
+			for (int reg = 0; reg < HWM_BANK_SIZE; ++reg) {
+				if (reg % 16 == 0) {
+					fprintf(out, "%X%02X:", bank, reg);
+				}
+				fprintf(out, " %02X", regs[bank][reg]);
+				if (reg % 16 == 15) {
+					fputc('\n', out);
+				}
+			}
+		}
+		break;
+	case DUMP_JSON:
+		fprintf(out, "{\"sio_port\":\"0x%X\",\"chip\":\"%s\",\"devid\":\"0x%04X\",\"base\":\"0x%04X\","
+			"\"realtime_ns\":%" PRIu64 ",\"pass_ns\":%" PRIu32 ",\"banks\":[",
+			hdr->sio_port, chip ? chip->name : "unknown", hdr->devid, hdr->base, hdr->realtime_ns,
+			hdr->pass_ns);
+		for (int bank = 0; bank < hdr->nbanks; ++bank) {
+			fprintf(out, "%s\"", bank ? "," : "");
+			for (int reg = 0; reg < HWM_BANK_SIZE; ++reg) {
+				fprintf(out, "%02x", regs[bank][reg]);
+			}
+			fputc('"', out);
+		}
+		fputs("]}\n", out);
+		break;
+	case DUMP_NONE:
+		break;
+	}
+	return fflush(out) == 0 ? 0 : -1;
+}
+
+/*
+ * chip_describe() - "NCT6798D rev 0 (7 pwm, 7 fan, 7 temp, 15 in)"
+ * WHY: A raw DEVID needs the driver's ID table to interpret; the
+ *      descriptor lookup happens once here, not for every reader
+ */
+static void chip_describe(char *buf, size_t len, uint16_t devid) {
+	const struct nct_chip *chip = nct_chip_identify(devid);
+	if (!chip) {
+		snprintf(buf, len, "unsupported chip DEVID=0x%04X", devid);
+		return;
+	}
+	snprintf(buf, len, "%s rev %u (%u pwm, %u fan, %u temp, %u in)", chip->name, nct_chip_revision(devid),
+		 chip->npwm, chip->nfan, chip->ntemp, chip->nin);
+}
+
+/*
+ * base_check() - Warn about a base no supported chip would use
+ * WHY: --dump drives base+5/base+6; an implausible base means a disabled
+ *      or misread LDN and the ports belong to something else
+ */
+static bool base_check(uint16_t devid, uint16_t base) {
+	const struct nct_chip *chip = nct_chip_identify(devid);
+	if (chip && !nct_chip_base_ok(chip, base)) {
+		fprintf(stderr, "[WARN] %s HWM base 0x%04X outside 0x%04X-0x%04X; not touching it\n",
+			chip->name, base, chip->base_min, chip->base_max);
+		return false;
+	}
+	return true;
+}
+
+static void wmi_stats_print(FILE *out, const struct wmi_stats *st) {
+	fprintf(out, "wmi: calls=%" PRIu64 " errors=%" PRIu64 " avg_call_ns=%" PRIu64 "\n",
+		st->calls, st->errors, st->calls ? st->call_ns / st->calls : 0);
+}
+
+static void usage(FILE *out) {
+	fprintf(out,
+		"Usage: nct-id [--probe] [--backend auto|isa|wmi] [--dump [--format bin|hex|json] [-o FILE] [--force]]\n"
+		"              [--stats]\n"
+		"  (no args)  Identify the chip through the bound nct6775 driver (no port access)\n"
+		"  --probe    Raw Super I/O probe: chip ID and HWM base for each SIO port\n"
+		"  --backend  isa (ioperm), wmi (ASUS RSIO/RHWM via acpi_call), or\n"
+		"             auto: isa, then wmi when no SIO port is accessible\n"
+		"  --dump     Snapshot every HWM bank (default: binary image on stdout)\n"		"  --force    Dump through the ports even while nct6775 is bound\n"
+		"  --stats    Print port operations issued and saved, and per-operation\n"
+		"             latency histograms (ioperm, port I/O, WMI calls) (stderr)\n");
 }
 
 /*
  * main() - Entry point
  * STRATEGY:
+ *   0. Unless raw access was requested (--probe, --backend, --dump),
+ *      report what the bound kernel driver knows and stop
  *   1. Iterate over two possible SIO index ports (0x2E, 0x4E)
  *   2. For each port, attempt to enter extended function mode
  *   3. Read chip ID from CR 0x20 (high byte) + CR 0x21 (low byte)
@@ -142,8 +443,117 @@ static unsigned char sio_read_cr(unsigned short idx, unsigned char reg) {
  *
  * DECISION: Check both ports because some boards populate only one
  * DECISION: Continue on ACPI conflicts rather than fail (informative)
+ * DECISION: --dump snapshots the first chip with a plausible HWM base and
+ *           keeps the one-line report on stderr so stdout stays a clean image
  */
-int main(void) {
+int main(int argc, char **argv) {
+	enum dump_format fmt = DUMP_NONE;
+	const char *out_path = NULL;
+	bool show_stats = false;
+	bool force = false;
+	enum backend backend = BACKEND_AUTO;
+	bool raw = false;
+	struct port_stats stats = {0};
+
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--dump") == 0) {
+			if (fmt == DUMP_NONE) {
+				fmt = DUMP_BIN;
+			}
+		} else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+			const char *f = argv[++i];
+			fmt = strcmp(f, "hex") == 0  ? DUMP_HEX :
+			      strcmp(f, "json") == 0 ? DUMP_JSON :
+			      strcmp(f, "bin") == 0  ? DUMP_BIN : DUMP_NONE;
+			if (fmt == DUMP_NONE) {
+				usage(stderr);
+				return 2;
+			}
+		} else if (strcmp(argv[i], "--probe") == 0) {
+			raw = true;
+		} else if (strcmp(argv[i], "--backend") == 0 && i + 1 < argc) {
+			const char *b = argv[++i];
+			raw = true;
+			if (strcmp(b, "auto") == 0) {
+				backend = BACKEND_AUTO;
+			} else if (strcmp(b, "isa") == 0) {
+				backend = BACKEND_ISA;
+			} else if (strcmp(b, "wmi") == 0) {
+				backend = BACKEND_WMI;
+			} else {
+				usage(stderr);
+				return 2;
+			}
+		} else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+			out_path = argv[++i];
+		} else if (strcmp(argv[i], "--stats") == 0) {
+			show_stats = true;
+		} else if (strcmp(argv[i], "--force") == 0) {
+			force = true;
+		} else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+			usage(stdout);
+			return 0;
+		} else {
+			usage(stderr);
+			return 2;
+		}
+	}
+
+	/*
+	 * Kernel fast path
+	 * WHY: With nct6775 bound, sysfs already names the chip and its base;
+	 *      probing ports the driver is actively driving gains nothing
+	 */
+	uint64_t t = nct_stats_begin();
+	struct kernel_id kid;
+	bool bound = kernel_identify(&kid) == 0;
+	if (!raw && fmt == DUMP_NONE) {
+		if (!bound) {
+			fprintf(stderr, "No NCT67xx bound to a kernel driver; run nct-id --probe (root) "
+				"for the raw Super I/O probe\n");
+			return 1;
+		}
+		const char *dev = strrchr(kid.res.platform, '/');
+		char desc[96];
+		if (kid.chip) {
+			snprintf(desc, sizeof(desc), "%s (%u pwm, %u fan, %u temp, %u in)", kid.chip->name,
+				 kid.chip->npwm, kid.chip->nfan, kid.chip->ntemp, kid.chip->nin);
+		} else {
+			snprintf(desc, sizeof(desc), "unsupported chip \"%s\"", kid.res.name);
+		}
+		printf("Kernel %s (platform %s): %s  HWM base=0x%04X via %s", kid.driver, dev ? dev + 1 : kid.res.platform,
+		       desc, kid.base, kid.access);
+		if (kid.sio_port) {
+			printf("  SIO 0x%X", kid.sio_port);
+		}
+		printf("\n");
+		if (show_stats) {
+			fprintf(stderr, "kernel path: %" PRIu64 "ns, hwmon cache %s, no port access\n",
+				nct_stats_begin() - t, kid.res.cached ? "hit" : "miss");
+		}
+		return 0;
+	}
+	/*
+	 * WHY: The bound driver selects banks on base+5/+6 itself, directly
+	 *      (ISA) or through the RSIO/RHWM AML (ASUS WMI) that drives the
+	 *      same ports; a port snapshot in between reads, and its bank
+	 *      restore leaves, the wrong bank. WMI calls serialize with it
+	 */
+	if (bound && fmt != DUMP_NONE && backend != BACKEND_WMI) {
+		if (!force) {
+			fprintf(stderr, "[ERROR] %s is bound (via %s) and drives HWM ports 0x%X-0x%X; a port "
+				"snapshot races its bank selects. Use --backend wmi, unload the driver, "
+				"or --force\n",
+				kid.driver, kid.access, kid.base + HWM_INDEX_OFFSET, kid.base + HWM_DATA_OFFSET);
+			return 2;
+		}
+		fprintf(stderr, "[WARN] --force: dumping through the ports while %s is bound\n", kid.driver);
+	}
+
+	FILE *report = fmt == DUMP_NONE ? stdout : stderr;
+	bool dumped = false;
+	bool any_port = false;
+
 	/*
 	 * Candidate SIO index ports per Nuvoton/ASUS convention
 	 * Port 0x2E: Primary Super I/O (standard)
@@ -151,27 +561,29 @@ int main(void) {
 	 */
 	unsigned short idx_ports[2] = {0x2E, 0x4E};
 
-	for (int p = 0; p < 2; ++p) {
+	for (int p = 0; p < 2 && backend != BACKEND_WMI; ++p) {
 		unsigned short IDX = idx_ports[p];
+		struct sio_ctx sio;
 
 		/*
 		 * Attempt extended function mode entry
-		 * WHY: If sio_enter() fails (ioperm returns -1), ACPI has locked ports
+		 * WHY: If sio_open() fails (ioperm returns -1), ACPI has locked ports
 		 * ACTION: Skip this port, try next; don't abort
 		 */
-		if (sio_enter(IDX)) {
+		if (sio_open(&sio, IDX)) {
 			/* ioperm() failed; likely ACPI resource conflict */
 			continue;
 		}
+		any_port = true;
 
 		/*
 		 * Read Chip ID (two bytes)
 		 * WHAT: CR 0x20 = high byte, CR 0x21 = low byte
-		 * FOR WHAT: Identify chip type (0xD428 = NCT6798D)
+		 * FOR WHAT: Identify chip type via nct_chip_identify()
 		 * WHY: Confirms this is the expected chip before accessing HWM
 		 */
-		unsigned char id_hi = sio_read_cr(IDX, 0x20);
-		unsigned char id_lo = sio_read_cr(IDX, 0x21);
+		unsigned char id_hi = sio_read(&sio, SIO_REG_DEVID_HI);
+		unsigned char id_lo = sio_read(&sio, SIO_REG_DEVID_LO);
 		unsigned int devid = ((unsigned)id_hi << 8) | id_lo;
 
 		/*
@@ -181,7 +593,7 @@ int main(void) {
 		 * WHY: Super I/O logical devices share index/data ports;
 		 *      must select target device before reading its base address
 		 */
-		sio_write_cr(IDX, 0x07, 0x0B);
+		sio_select_ldn(&sio, SIO_LDN_HWM);
 
 		/*
 		 * Read HWM Base Address (two bytes)
@@ -190,24 +602,158 @@ int main(void) {
 		 * TYPICAL VALUE: 0x0290 on ASUS boards (selectable 0x290-0x29F)
 		 * USAGE: Actual fan control uses base+5 (index), base+6 (data)
 		 */
-		unsigned char ba_hi = sio_read_cr(IDX, 0x60);
-		unsigned char ba_lo = sio_read_cr(IDX, 0x61);
+		unsigned char ba_hi = sio_read(&sio, SIO_REG_BASE_HI);
+		unsigned char ba_lo = sio_read(&sio, SIO_REG_BASE_LO);
 		unsigned short base = (ba_hi << 8) | ba_lo;
 
 		/*
 		 * Report findings
 		 * INTERPRETATION:
-		 *   DEVID 0xD428 = NCT6798D (matches Linux driver table)
+		 *   chip name/revision from the nct-chip.h descriptor
 		 *   base 0x0290 = standard ASUS factory configuration
 		 *   index/data at base+5/base+6 = Nuvoton standard (hardcoded)
 		 */
-		printf("SIO at 0x%X: DEVID=0x%04X  HWM base=0x%04X "
-		       "(index/data @ base+5/base+6)\n",
-		       IDX, devid, base);
+		char desc[96];
+		chip_describe(desc, sizeof(desc), (uint16_t)devid);
+		fprintf(report, "SIO at 0x%X: %s  HWM base=0x%04X "
+			"(index/data @ base+5/base+6)\n",
+			IDX, desc, base);
+
+		sio_close(&sio);
+		port_stats_add(&stats, &sio.stats);
 
-		sio_exit(IDX);
+		/*
+		 * Optional full-bank snapshot
+		 * WHY after sio_close(): HWM ports are independent of the SIO
+		 *     configuration mode; leave extended function mode first
+		 * SKIP: base 0x0000/0xFFFF means the logical device is disabled
+		 */
+		if (fmt == DUMP_NONE || dumped || base == 0 || base == 0xFFFF || !base_check((uint16_t)devid, base)) {
+			continue;
+		}
+
+		static unsigned char regs[HWM_BANKS][HWM_BANK_SIZE];
+		struct hwm_image_header hdr = {
+			.magic = {'N', 'C', 'T', 'H', 'W', 'M', '\0', 1},
+			.devid = (uint16_t)devid,
+			.base = base,
+			.sio_port = IDX,
+		};
+		if (hwm_snapshot(base, &hdr, regs, &stats)) {
+			fprintf(stderr, "HWM ports 0x%X-0x%X not accessible: %s\n",
+				base + HWM_INDEX_OFFSET, base + HWM_DATA_OFFSET, strerror(errno));
+			continue;
+		}
+
+		FILE *out = out_path ? fopen(out_path, "wb") : stdout;
+		if (!out || dump_write(out, fmt, &hdr, regs)) {
+			fprintf(stderr, "Cannot write snapshot: %s\n", strerror(errno));
+			return 1;
+		}
+		if (out != stdout) {
+			fclose(out);
+		}
+		dumped = true;
+	}
+
+	/*
+	 * ASUS WMI path
+	 * WHEN: --backend wmi, or auto and ioperm() was denied on every port
+	 * WHY: On ACPI-locked boards this is the only userspace route to the
+	 *      chip; previously nct-id exited silently with no output
+	 */
+	struct wmi_stats wstats = {0};
+	bool used_wmi = false;
+	if (backend == BACKEND_WMI || (backend == BACKEND_AUTO && !any_port)) {
+		struct wmi_ctx wmi;
+		char err[256];
+		uint8_t id_hi, id_lo, ba_hi, ba_lo;
+
+		if (wmi_open(&wmi, err, sizeof(err)) < 0) {
+			fprintf(stderr, "%sASUS WMI unavailable: %s\n",
+				backend == BACKEND_AUTO ? "No Super I/O port accessible via ioperm() "
+				"(ACPI-reserved or not root) and " : "", err);
+			return 1;
+		}
+		used_wmi = true;
+
+		/*
+		 * RSIO/WSIO take the SIO index port, like the ISA loop above:
+		 * the first port whose DEVID names a known chip is the one, and
+		 * LDN 0x0B is selected (WSIO CR 0x07) before its base is read
+		 */
+		unsigned int devid = 0xFFFF;
+		int rc = 0;
+		for (int p = 0; p < 2 && rc == 0; ++p) {
+			rc = wmi_sio_read(&wmi, (uint8_t)idx_ports[p], SIO_REG_DEVID_HI, &id_hi);
+			if (rc == 0) {
+				rc = wmi_sio_read(&wmi, (uint8_t)idx_ports[p], SIO_REG_DEVID_LO, &id_lo);
+			}
+			if (rc == 0 && nct_chip_identify((uint16_t)((id_hi << 8) | id_lo))) {
+				devid = ((unsigned)id_hi << 8) | id_lo;
+				rc = wmi_sio_select(&wmi, (uint8_t)idx_ports[p], SIO_LDN_HWM);
+				if (rc == 0) {
+					rc = wmi_sio_read(&wmi, (uint8_t)idx_ports[p], SIO_REG_BASE_HI, &ba_hi);
+				}
+				if (rc == 0) {
+					rc = wmi_sio_read(&wmi, (uint8_t)idx_ports[p], SIO_REG_BASE_LO, &ba_lo);
+				}
+				break;
+			}
+		}
+		if (rc < 0) {
+			fprintf(stderr, "ASUS WMI RSIO/WSIO call failed: %s\n", strerror(-rc));
+			wmi_close(&wmi);
+			return 1;
+		}
+		if (devid == 0xFFFF) {
+			fprintf(stderr, "ASUS WMI RSIO found no Nuvoton Super I/O behind 0x%X or 0x%X\n",
+				idx_ports[0], idx_ports[1]);
+			wmi_close(&wmi);
+			return 1;
+		}
+		unsigned short base = (unsigned short)((ba_hi << 8) | ba_lo);
+		char desc[96];
+		chip_describe(desc, sizeof(desc), (uint16_t)devid);
+		fprintf(report, "SIO via ASUS WMI: %s  HWM base=0x%04X (RSIO/RHWM)\n", desc, base);
+
+		if (fmt != DUMP_NONE && !dumped) {
+			static unsigned char regs[HWM_BANKS][HWM_BANK_SIZE];
+			struct hwm_image_header hdr = {
+				.magic = {'N', 'C', 'T', 'H', 'W', 'M', '\0', 1},
+				.devid = (uint16_t)devid,
+				.base = base,
+				.sio_port = 0,
+			};
+			if (wmi_snapshot(&wmi, &hdr, regs)) {
+				fprintf(stderr, "[WARN] Some RHWM calls failed; those registers read as 0xFF\n");
+			}
+			FILE *out = out_path ? fopen(out_path, "wb") : stdout;
+			if (!out || dump_write(out, fmt, &hdr, regs)) {
+				fprintf(stderr, "Cannot write snapshot: %s\n", strerror(errno));
+				wmi_close(&wmi);
+				return 1;
+			}
+			if (out != stdout) {
+				fclose(out);
+			}
+			dumped = true;
+		}
+		wstats = wmi.stats;
+		wmi_close(&wmi);
 	}
 
+	if (show_stats) {
+		stats_print(stderr, &stats);
+		if (used_wmi) {
+			wmi_stats_print(stderr, &wstats);
+		}
+		nct_stats_print(stderr, &nct_stats);
+	}
+	if (fmt != DUMP_NONE && !dumped) {
+		fprintf(stderr, "No accessible NCT HWM found; nothing dumped\n");
+		return 1;
+	}
 	return 0;
 }
 
@@ -215,7 +761,7 @@ int main(void) {
  * BUILD & DEPLOYMENT NOTES:
  *
  * Compilation:
- *   gcc -std=c23 -O2 -Wall -Wextra -o nct-id nct-id.c
+ *   gcc -std=c23 -O2 -Wall -Wextra -o nct-id nct-id.c nct-hwmon.c nct-isa.c nct-sio.c nct-wmi.c nct-stats.c
  *
  * Flags:
  *   -std=c23: Modern C with inline semantics
@@ -226,10 +772,13 @@ int main(void) {
  *   install -Dm755 nct-id "$pkgdir/usr/lib/eirikr/nct-id"
  *
  * Usage (in systemd unit or manual verification):
- *   sudo /usr/lib/eirikr/nct-id
+ *   /usr/lib/eirikr/nct-id                 (driver bound: sysfs only)
+ *   sudo /usr/lib/eirikr/nct-id --probe    (raw Super I/O probe)
  *
  * Expected behavior on ASUS B550:
- *   - Output: SIO at 0x2E: DEVID=0xD428  HWM base=0x0290 ...
+ *   - Output: Kernel nct6775 (platform nct6775.656): NCT6798D (...)  HWM base=0x0290 via ...
+ *   - --probe: SIO at 0x2E: NCT6798D rev 0 (...)  HWM base=0x0290 ...
  *   - Confirms kernel nct6775 driver will find and control this chip
- *   - If ACPI locks ports, kernel driver automatically falls back to WMI
+ *   - If ACPI locks ports, kernel driver automatically falls back to WMI,
+ *     and so does nct-id (SIO via ASUS WMI: ...) when acpi_call is loaded
  */
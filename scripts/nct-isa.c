@@ -0,0 +1,308 @@
+/*
+ * nct-isa.c - Direct ISA HWM read backend (see nct-isa.h)
+ *
+ * REGISTER MAP NCT_MAP_6779 (NCT6796D/NCT6798D/NCT6799D, kernel nct6775
+ * NCT6779-family tables; the chip descriptor is in nct-chip.h):
+ *   Temperatures  bank 4, 0x90-0x96  signed 8-bit degrees C (source readings)
+ *   Voltages      bank 4, 0x80-0x8E  8-bit, LSB per scale_in[] below
+ *   Fans          bank 4, 0xC0-0xCB + 0xCE  16-bit big-endian RPM
+ *   PWM duty      0x001, 0x003, 0x011, 0x013, 0x015, 0xA09, 0xB09 (kernel
+ *                 REG_PWM_READ): 8-bit current output duty, whatever mode
+ *                 drives it. Not the 0x109-0x909 output-value registers,
+ *                 which hold the manual-mode setting; pwm1-5 read from bank
+ *                 0, so a sample costs three bank switches, not seven
+ */
+
+#define _GNU_SOURCE
+#include "nct-isa.h"
+#include "nct-stats.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+static const struct isa_sensor map6779_sensors[] = {
+	{"SYSTIN", HWMON_TEMP, 1, 0x490, 1, 0},
+	{"CPUTIN", HWMON_TEMP, 2, 0x491, 1, 0},
+	{"AUXTIN0", HWMON_TEMP, 3, 0x492, 1, 0},
+	{"AUXTIN1", HWMON_TEMP, 4, 0x493, 1, 0},
+	{"AUXTIN2", HWMON_TEMP, 5, 0x494, 1, 0},
+	{"AUXTIN3", HWMON_TEMP, 6, 0x495, 1, 0},
+	{"AUXTIN4", HWMON_TEMP, 7, 0x496, 1, 0},
+
+	{"SYSFANIN", HWMON_FAN, 1, 0x4C0, 2, 0},
+	{"CPUFANIN", HWMON_FAN, 2, 0x4C2, 2, 0},
+	{"AUXFANIN0", HWMON_FAN, 3, 0x4C4, 2, 0},
+	{"AUXFANIN1", HWMON_FAN, 4, 0x4C6, 2, 0},
+	{"AUXFANIN2", HWMON_FAN, 5, 0x4C8, 2, 0},
+	{"AUXFANIN3", HWMON_FAN, 6, 0x4CA, 2, 0},
+	{"AUXFANIN4", HWMON_FAN, 7, 0x4CE, 2, 0},
+
+	{"CPUVCORE", HWMON_IN, 0, 0x480, 1, 800},
+	{"VIN1", HWMON_IN, 1, 0x481, 1, 800},
+	{"AVSB", HWMON_IN, 2, 0x482, 1, 1600},
+	{"3VCC", HWMON_IN, 3, 0x483, 1, 1600},
+	{"VIN0", HWMON_IN, 4, 0x484, 1, 800},
+	{"VIN8", HWMON_IN, 5, 0x485, 1, 800},
+	{"VIN4", HWMON_IN, 6, 0x486, 1, 800},
+	{"3VSB", HWMON_IN, 7, 0x487, 1, 1600},
+	{"VBAT", HWMON_IN, 8, 0x488, 1, 1600},
+	{"VTT", HWMON_IN, 9, 0x489, 1, 800},
+	{"VIN5", HWMON_IN, 10, 0x48A, 1, 800},
+	{"VIN6", HWMON_IN, 11, 0x48B, 1, 800},
+	{"VIN2", HWMON_IN, 12, 0x48C, 1, 800},
+	{"VIN3", HWMON_IN, 13, 0x48D, 1, 800},
+	{"VIN7", HWMON_IN, 14, 0x48E, 1, 800},
+
+	/* chip->pwm_read[n - 1]; labels follow the fan inputs */
+	{"SYSFANOUT", HWMON_PWM, 1, 0x001, 1, 0},
+	{"CPUFANOUT", HWMON_PWM, 2, 0x003, 1, 0},
+	{"AUXFANOUT0", HWMON_PWM, 3, 0x011, 1, 0},
+	{"AUXFANOUT1", HWMON_PWM, 4, 0x013, 1, 0},
+	{"AUXFANOUT2", HWMON_PWM, 5, 0x015, 1, 0},
+	{"AUXFANOUT3", HWMON_PWM, 6, 0xA09, 1, 0},
+	{"AUXFANOUT4", HWMON_PWM, 7, 0xB09, 1, 0},
+};
+
+/* Reading routines per enum nct_chip_map, indexed by chip->map */
+static const struct {
+	const struct isa_sensor *sensors;
+	int nsensors;
+} isa_maps[] = {
+	[NCT_MAP_6779] = {map6779_sensors, (int)(sizeof(map6779_sensors) / sizeof(map6779_sensors[0]))},
+};
+
+/* A map covers its family's largest member; skip channels this chip lacks */
+static bool isa_chip_has(const struct nct_chip *chip, const struct isa_sensor *s) {
+	switch (s->kind) {
+	case HWMON_TEMP:
+		return s->index <= chip->ntemp;
+	case HWMON_FAN:
+		return s->index <= chip->nfan;
+	case HWMON_IN:
+		return s->index < chip->nin;
+	case HWMON_PWM:
+		return s->index <= chip->npwm;
+	default:
+		return false;
+	}
+}
+
+/*
+ * isa_region_owner() - Report who has claimed any port in [first, last]
+ * HOW:  Scan /proc/ioports; PnP motherboard reservations ("pnp 00:0x")
+ *       and PCI host bridge windows ("PCI Bus 0000:00", which span all of
+ *       0x0000-0x0CF7) describe the board, not a driver, and are ignored
+ * RETURNS: 1 and the owner name if claimed, 0 if free, -1 if unreadable
+ */
+int isa_region_owner(uint16_t first, uint16_t last, char *owner, size_t len) {
+	FILE *f = fopen("/proc/ioports", "re");
+	if (!f) {
+		return -1;
+	}
+
+	int rc = 0;
+	char line[160];
+	while (fgets(line, sizeof(line), f)) {
+		unsigned start, end;
+		char name[96];
+		if (sscanf(line, " %x-%x : %95[^\n]", &start, &end, name) != 3) {
+			continue;
+		}
+		if (start > last || end < first || strncmp(name, "pnp ", 4) == 0 || strncmp(name, "PCI Bus", 7) == 0) {
+			continue;
+		}
+		snprintf(owner, len, "%s", name);
+		rc = 1;
+		break;
+	}
+	fclose(f);
+	return rc;
+}
+
+/*
+ * isa_driver_bound() - Is a kernel driver bound to the NCT67xx platform device?
+ * HOW:  hwmon_resolve() (cached) for the nct6775.<base> platform device,
+ *       then its driver symlink; the same facts nct-id's kernel path uses
+ * WHY:  /proc/ioports alone misses the ASUS WMI binding, which claims no
+ *       region yet drives the SIO and HWM ports from its AML methods
+ * RETURNS: 1 with the driver name (e.g. "nct6775") in driver, 0 if none
+ */
+int isa_driver_bound(char *driver, size_t len) {
+	struct hwmon_resolution res;
+	if (hwmon_resolve(&res, 0) < 0) {
+		return 0;
+	}
+	char link[HWMON_PATH_MAX + sizeof("/driver")];
+	char real[PATH_MAX];
+	snprintf(link, sizeof(link), "%s/driver", res.platform);
+	if (!realpath(link, real)) {
+		return 0;
+	}
+	const char *drv = strrchr(real, '/');
+	snprintf(driver, len, "%s", drv ? drv + 1 : real);
+	return 1;
+}
+
+/*
+ * isa_open() - Refuse a bound driver or claimed region, probe, take access
+ * IN:  flags ISA_OPEN_FORCE: proceed while nct6775 is bound (the driver's
+ *      name is left in b->shared_with for the caller to warn about)
+ * RETURNS: 0 on success; -1 with a one-line reason in err
+ */
+int isa_open(struct isa_backend *b, unsigned flags, char *err, size_t errlen) {
+	memset(b, 0, sizeof(*b));
+	b->lock_fd = -1;
+
+	/* Before sio_probe(): the probe itself drives 0x2E/0x4E */
+	char driver[sizeof(b->shared_with)];
+	if (isa_driver_bound(driver, sizeof(driver))) {
+		if (!(flags & ISA_OPEN_FORCE)) {
+			snprintf(err, errlen, "%s is bound and drives the SIO/HWM ports (ISA or ASUS WMI); "
+				 "unload it, or --force to race its bank selects", driver);
+			return -1;
+		}
+		snprintf(b->shared_with, sizeof(b->shared_with), "%s", driver);
+	}
+
+	uint16_t base;
+	if (sio_probe(&b->sio_port, &b->devid, &base)) {
+		snprintf(err, errlen, "no Super I/O HWM found (ioperm denied or ACPI-reserved ports)");
+		return -1;
+	}
+	b->chip = nct_chip_identify(b->devid);
+	if (!b->chip) {
+		snprintf(err, errlen, "DEVID 0x%04X is not a supported NCT67xx; no ISA register map", b->devid);
+		return -1;
+	}
+	if (!nct_chip_base_ok(b->chip, base)) {
+		snprintf(err, errlen, "%s reports implausible HWM base 0x%04X", b->chip->name, base);
+		return -1;
+	}
+
+	char owner[96];
+	int claimed = isa_region_owner(base + HWM_INDEX_OFFSET, base + HWM_DATA_OFFSET, owner, sizeof(owner));
+	if (claimed > 0 && b->shared_with[0] && strcmp(owner, b->shared_with) == 0) {
+		claimed = 0;    /* the forced driver's own claim */
+	}
+	if (claimed != 0) {
+		if (claimed > 0) {
+			snprintf(err, errlen, "HWM ports 0x%X-0x%X claimed by \"%s\"; refusing to share them",
+				 base + HWM_INDEX_OFFSET, base + HWM_DATA_OFFSET, owner);
+		} else {
+			snprintf(err, errlen, "cannot read /proc/ioports: %s", strerror(errno));
+		}
+		return -1;
+	}
+
+	b->lock_fd = open(HWM_LOCK_PATH, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+	if (b->lock_fd < 0) {
+		snprintf(err, errlen, "cannot open %s: %s", HWM_LOCK_PATH, strerror(errno));
+		return -1;
+	}
+	if (flock(b->lock_fd, LOCK_EX) < 0 || hwm_open(&b->hwm, base)) {
+		snprintf(err, errlen, "cannot access HWM at 0x%X: %s", base, strerror(errno));
+		close(b->lock_fd);
+		b->lock_fd = -1;
+		return -1;
+	}
+	hwm_close(&b->hwm);
+	flock(b->lock_fd, LOCK_UN);
+
+	/*
+	 * Select the chip's reading map once; isa_sample() then walks the
+	 * precomputed register list and never consults the descriptor
+	 */
+	const struct isa_sensor *map = isa_maps[b->chip->map].sensors;
+	for (int i = 0; i < isa_maps[b->chip->map].nsensors && b->nsensors < ISA_MAX_SENSORS; ++i) {
+		if (isa_chip_has(b->chip, &map[i])) {
+			b->sensor_buf[b->nsensors++] = map[i];
+		}
+	}
+	b->sensors = b->sensor_buf;
+	for (int i = 0; i < b->nsensors; ++i) {
+		for (int w = 0; w < b->sensors[i].width && b->nregs < ISA_MAX_REGS; ++w) {
+			b->regs[b->nregs++] = (uint16_t)(b->sensors[i].reg + w);
+		}
+	}
+	return 0;
+}
+
+void isa_close(struct isa_backend *b) {
+	if (b->lock_fd >= 0) {
+		close(b->lock_fd);
+		b->lock_fd = -1;
+	}
+}
+
+/*
+ * isa_channels() - Describe the backend's channels in hwmon terms
+ * WHY: nct-sampler and the ring carry one channel table regardless of
+ *      backend; fd is -1 because nothing is read through sysfs
+ */
+int isa_channels(const struct isa_backend *b, struct hwmon_channel *out, int max) {
+	static const char *const suffix[HWMON_KIND_COUNT] = {
+		[HWMON_TEMP] = "temp", [HWMON_FAN] = "fan", [HWMON_IN] = "in", [HWMON_PWM] = "pwm",
+	};
+	int n = 0;
+	for (int i = 0; i < b->nsensors && n < max; ++i, ++n) {
+		const struct isa_sensor *s = &b->sensors[i];
+		/* pwmN has no _input suffix in sysfs either */
+		snprintf(out[n].name, sizeof(out[n].name), "%s%d%s", suffix[s->kind], s->index,
+			 s->kind == HWMON_PWM ? "" : "_input");
+		snprintf(out[n].label, sizeof(out[n].label), "%s", s->label);
+		out[n].kind = s->kind;
+		out[n].index = s->index;
+		out[n].fd = -1;
+	}
+	return n;
+}
+
+/*
+ * isa_sample() - Read every sensor in one locked access window
+ * HOW:  flock -> hwm_resync (learn current bank) -> hwm_read_many (each
+ *       bank selected once: bank 4, then the PWM banks) -> hwm_close
+ *       (restore bank) -> unlock
+ * OUT:  values[i] for sensors[i], in sysfs units
+ * RETURNS: 0, or -errno if the lock could not be taken
+ */
+int isa_sample(struct isa_backend *b, int32_t *values) {
+	uint64_t t = nct_stats_begin();
+	if (flock(b->lock_fd, LOCK_EX) < 0) {
+		return -errno;
+	}
+	nct_stats_end(NCT_OP_LOCK_WAIT, t);
+	hwm_resync(&b->hwm);
+	hwm_read_many(&b->hwm, b->regs, (size_t)b->nregs, b->raw);
+	hwm_close(&b->hwm);
+	flock(b->lock_fd, LOCK_UN);
+
+	int r = 0;
+	for (int i = 0; i < b->nsensors; ++i) {
+		const struct isa_sensor *s = &b->sensors[i];
+		switch (s->kind) {
+		case HWMON_TEMP:
+			values[i] = (int8_t)b->raw[r] * 1000;
+			break;
+		case HWMON_FAN:
+			values[i] = (b->raw[r] << 8) | b->raw[r + 1];
+			break;
+		case HWMON_IN:
+			values[i] = (b->raw[r] * s->scale + 50) / 100;
+			break;
+		case HWMON_PWM:
+			values[i] = b->raw[r];
+			break;
+		default:
+			values[i] = INT32_MIN;
+			break;
+		}
+		r += s->width;
+	}
+	return 0;
+}
@@ -0,0 +1,92 @@
+/*
+ * nct-isa.h - Direct ISA HWM read backend (temperature, fan, voltage, duty)
+ *
+ * PURPOSE:
+ *   Read NCT6798D sensor registers straight through the HWM index/data
+ *   pair at base+5/base+6, as an alternative to the nct6775 sysfs files.
+ *   Used by nct-sampler --backend isa (controller fast path, latency
+ *   benchmarking).
+ *
+ * WHY:
+ *   Every sysfs read is served from the driver's cache, refreshed at most
+ *   once per update_interval (~1 s). That hides real sensor dynamics from
+ *   a closed-loop controller. A direct read costs ~2 port operations per
+ *   register (~2-3 us) and always returns the chip's current value.
+ *
+ * LOCKING (who may drive base+5/base+6):
+ *   1. Kernel driver: isa_open() refuses while the nct6775 platform
+ *      driver is bound (isa_driver_bound()), whatever its access path:
+ *      bound through ASUS WMI it leaves the region unclaimed, but its
+ *      RSIO/RHWM AML still drives 0x2E/0x4E and base+5/+6. It also
+ *      refuses when /proc/ioports shows the HWM index/data ports claimed
+ *      by any driver (e.g. "0295-0296 : nct6775"). The driver's
+ *      update_lock is not reachable from userspace, so the ports are only
+ *      shared on explicit request (ISA_OPEN_FORCE, the tools' --force);
+ *      otherwise unload nct6775 first.
+ *   2. Other userspace tools: every access window holds an exclusive
+ *      flock(2) on HWM_LOCK_PATH, and re-learns the selected bank on entry
+ *      (hwm_resync) and restores it on exit (hwm_close).
+ *
+ * UNITS:
+ *   Values are converted to sysfs units (millidegrees C, RPM, millivolts)
+ *   so ISA and sysfs samples are interchangeable downstream.
+ *
+ * CAVEATS:
+ *   - Requires root (ioperm(2)); x86 only
+ *   - The driver and region checks run once at isa_open(); a driver
+ *     loaded later is not detected until the backend is reopened
+ *   - Channel numbering follows the register map below, not the driver's
+ *     temp source assignment; labels (SYSTIN, CPUTIN, ...) are authoritative
+ */
+
+#ifndef NCT_ISA_H
+#define NCT_ISA_H
+
+#include "nct-chip.h"
+#include "nct-hwmon.h"
+#include "nct-sio.h"
+
+#ifndef HWM_LOCK_PATH
+#define HWM_LOCK_PATH "/run/lock/nct-hwm.lock"
+#endif
+#define ISA_MAX_REGS  64
+#define ISA_OPEN_FORCE 0x1      /* share the ports with a bound nct6775 (races its bank selects) */
+#define ISA_MAX_SENSORS 40      /* map6779: 7 temp + 7 fan + 15 in + 7 pwm */
+
+/*
+ * struct isa_sensor - One sensor reading in the HWM register space
+ * reg:   16-bit (bank << 8 | index) register; word sensors read reg, reg+1
+ * scale: voltage LSB in units of 10 uV (kernel nct6775 scale_in); 0 otherwise
+ */
+struct isa_sensor {
+	const char *label;
+	enum hwmon_kind kind;
+	int index;
+	uint16_t reg;
+	uint8_t width;      /* 1 = byte, 2 = big-endian word */
+	uint16_t scale;
+};
+
+struct isa_backend {
+	struct hwm_ctx hwm;
+	uint16_t sio_port;
+	uint16_t devid;
+	const struct nct_chip *chip;    /* picked once by isa_open() */
+	int lock_fd;
+	char shared_with[32];           /* bound driver accepted by ISA_OPEN_FORCE, "" = none */
+	const struct isa_sensor *sensors;
+	int nsensors;
+	struct isa_sensor sensor_buf[ISA_MAX_SENSORS];  /* the chip's subset of its map */
+	uint16_t regs[ISA_MAX_REGS];    /* every register to read per sample */
+	uint8_t raw[ISA_MAX_REGS];
+	int nregs;
+};
+
+int isa_driver_bound(char *driver, size_t len);
+int isa_open(struct isa_backend *b, unsigned flags, char *err, size_t errlen);
+void isa_close(struct isa_backend *b);
+int isa_channels(const struct isa_backend *b, struct hwmon_channel *out, int max);
+int isa_sample(struct isa_backend *b, int32_t *values);
+int isa_region_owner(uint16_t first, uint16_t last, char *owner, size_t len);
+
+#endif /* NCT_ISA_H */
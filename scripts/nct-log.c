@@ -0,0 +1,248 @@
+/*
+ * nct-log.c - Telemetry log writer for nct-sampler --log (see nct-log.h)
+ */
+
+#define _GNU_SOURCE
+#include "nct-log.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+static int64_t realtime_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int is_log_name(const struct dirent *d) {
+	size_t len = strlen(d->d_name);
+	return strncmp(d->d_name, "nct-", 4) == 0 && len > 8 && strcmp(d->d_name + len - 4, ".log") == 0;
+}
+
+/*
+ * prune() - Delete the oldest log files beyond w->keep
+ * WHY: Names sort by creation time, so alphasort order is age order and
+ *      the file just created is always the last one kept
+ */
+static void prune(const struct nct_log_writer *w) {
+	struct dirent **names;
+	int n = scandir(w->dir, &names, is_log_name, alphasort);
+	if (n < 0) {
+		return;
+	}
+	for (int i = 0; i < n; ++i) {
+		if (i < n - w->keep) {
+			char path[sizeof(w->dir) + 300];
+			snprintf(path, sizeof(path), "%s/%s", w->dir, names[i]->d_name);
+			if (unlink(path) == 0) {
+				fprintf(stderr, "[INFO] Telemetry log: removed %s (--log-keep %d)\n", path, w->keep);
+			}
+		}
+		free(names[i]);
+	}
+	free(names);
+}
+
+/*
+ * start_file() - Create the next nct-YYYYmmddTHHMMSSZ.log and write its header
+ * HOW:  Names must sort in creation order (prune() relies on it), so a
+ *       name's second is never earlier than the previous file's + 1, and
+ *       O_EXCL bumps it past a file left by a restart within the same
+ *       second instead of appending to (or truncating) that file
+ * RETURNS: 0, or -1 (errno set)
+ */
+static int start_file(struct nct_log_writer *w) {
+	w->hdr.created_ns = realtime_ns();
+	time_t sec = (time_t)(w->hdr.created_ns / 1000000000);
+	if (sec <= w->name_sec) {
+		sec = w->name_sec + 1;
+	}
+
+	int fd = -1;
+	for (int attempt = 0; attempt < 60 && fd < 0; ++attempt, ++sec) {
+		struct tm tm;
+		char stamp[32], path[sizeof(w->dir) + 48];
+		gmtime_r(&sec, &tm);
+		strftime(stamp, sizeof(stamp), "%Y%m%dT%H%M%SZ", &tm);
+		snprintf(path, sizeof(path), "%s/nct-%s.log", w->dir, stamp);
+		fd = open(path, O_WRONLY | O_CREAT | O_EXCL | O_APPEND | O_CLOEXEC, 0644);
+		if (fd < 0 && errno != EEXIST) {
+			return -1;
+		}
+	}
+	if (fd < 0) {
+		return -1;
+	}
+
+	if (write(fd, &w->hdr, sizeof(w->hdr)) != (ssize_t)sizeof(w->hdr)) {
+		int saved = errno ? errno : EIO;
+		close(fd);
+		errno = saved;
+		return -1;
+	}
+	w->fd = fd;
+	w->name_sec = sec - 1;
+	w->file_bytes = sizeof(w->hdr);
+	prune(w);
+	return 0;
+}
+
+/*
+ * nct_log_open() - Create DIR (one level) and the first log file
+ * IN:  ch[0..n) channel table, copied into every file's header
+ *      max_bytes rotation size, keep number of files kept in DIR
+ * RETURNS: 0, or -1 (errno set)
+ */
+int nct_log_open(struct nct_log_writer *w, const char *dir, const struct nct_log_channel *ch, uint32_t n,
+		 uint32_t rate_hz, const char *source, uint64_t max_bytes, int keep) {
+	memset(w, 0, sizeof(*w));
+	w->fd = -1;
+	if (n == 0 || n > NCT_LOG_CHANNELS || rate_hz == 0 || strlen(dir) >= sizeof(w->dir)) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (mkdir(dir, 0755) < 0 && errno != EEXIST) {
+		return -1;
+	}
+	snprintf(w->dir, sizeof(w->dir), "%s", dir);
+	w->max_bytes = max_bytes;
+	w->keep = keep;
+	w->nchannels = n;
+	w->period_us = 1000000 / rate_hz;
+
+	memcpy(w->hdr.magic, NCT_LOG_MAGIC, sizeof(w->hdr.magic));
+	w->hdr.version = NCT_LOG_VERSION;
+	w->hdr.header_size = sizeof(w->hdr);
+	w->hdr.nchannels = n;
+	w->hdr.rate_hz = rate_hz;
+	memcpy(w->hdr.source, source, strnlen(source, sizeof(w->hdr.source) - 1));
+	memcpy(w->hdr.channels, ch, n * sizeof(ch[0]));
+
+	w->blk = (struct nct_log_block *)w->buf;
+	w->min = (int32_t *)(w->blk + 1);
+	w->max = w->min + n;
+	w->payload = (uint8_t *)(w->max + n);
+	return start_file(w);
+}
+
+/*
+ * flush_block() - Seal the block in buf and append it with one write(2)
+ * WHEN: The payload reached NCT_LOG_BLOCK_BYTES or spans NCT_LOG_BLOCK_NS,
+ *       and on close
+ * HOW:  Rotate first if the block would push the file past max_bytes;
+ *       fdatasync after every block, so a crash loses only the block
+ *       being built (~once a minute, cheap next to the sampling itself)
+ * RETURNS: 0, or -1 (errno set; the file is truncated back to its last
+ *          complete block, so readers still see a clean file)
+ */
+static int flush_block(struct nct_log_writer *w) {
+	if (w->blk->nsamples == 0) {
+		return 0;
+	}
+	size_t summary = 2 * (size_t)w->nchannels * sizeof(int32_t);
+	size_t size = nct_log_block_size(w->blk, w->nchannels);
+	memset(w->payload + w->blk->payload_bytes, 0, nct_log_pad8(w->blk->payload_bytes) - w->blk->payload_bytes);
+	for (uint32_t i = 0; i < w->nchannels; ++i) {
+		if (w->min[i] == INT32_MAX) {           /* no valid sample in the block */
+			w->min[i] = w->max[i] = NCT_LOG_INVALID;
+		}
+	}
+	w->blk->magic = NCT_LOG_BLOCK_MAGIC;
+	w->blk->checksum = nct_log_checksum(w->min, summary + w->blk->payload_bytes);
+
+	if (w->file_bytes > sizeof(w->hdr) && w->file_bytes + size > w->max_bytes) {
+		fdatasync(w->fd);
+		close(w->fd);
+		w->fd = -1;
+		if (start_file(w) < 0) {
+			return -1;
+		}
+	}
+
+	ssize_t done = write(w->fd, w->buf, size);
+	if (done != (ssize_t)size) {
+		int saved = done < 0 ? errno : ENOSPC;
+		/* best effort: if this fails too, readers stop at the torn block */
+		(void)!ftruncate(w->fd, (off_t)w->file_bytes);
+		errno = saved;
+		return -1;
+	}
+	fdatasync(w->fd);
+	w->file_bytes += size;
+	w->bytes += size;
+	w->blocks++;
+	w->blk->nsamples = 0;
+	w->blk->payload_bytes = 0;
+	return 0;
+}
+
+/*
+ * nct_log_append() - Encode one sample into the current block
+ * IN:  t_ns CLOCK_REALTIME of the sample; values[nchannels],
+ *      NCT_LOG_INVALID where the read failed
+ * HOW:  prev_t_ns tracks the time the reader will reconstruct, not the
+ *       caller's, so rounding to microseconds never accumulates
+ * RETURNS: 0, or -1 if a flush failed (errno set)
+ */
+int nct_log_append(struct nct_log_writer *w, int64_t t_ns, const int32_t *values) {
+	struct nct_log_block *b = w->blk;
+	uint8_t *p = w->payload + b->payload_bytes;
+
+	if (b->nsamples == 0) {
+		b->t_first_ns = t_ns;
+		w->prev_t_ns = t_ns;
+		memset(w->prev, 0, sizeof(w->prev));
+		for (uint32_t i = 0; i < w->nchannels; ++i) {
+			w->min[i] = INT32_MAX;
+			w->max[i] = INT32_MIN;
+		}
+		p += nct_log_put_varint(p, 0);
+	} else {
+		int64_t dt_us = (t_ns - w->prev_t_ns) / 1000;
+		p += nct_log_put_varint(p, nct_log_zigzag(dt_us - w->period_us));
+		w->prev_t_ns += dt_us * 1000;
+	}
+
+	for (uint32_t i = 0; i < w->nchannels; ++i) {
+		int32_t v = values[i];
+		p += nct_log_put_varint(p, nct_log_zigzag((int64_t)v - w->prev[i]));
+		w->prev[i] = v;
+		if (v != NCT_LOG_INVALID) {
+			if (v < w->min[i]) {
+				w->min[i] = v;
+			}
+			if (v > w->max[i]) {
+				w->max[i] = v;
+			}
+		}
+	}
+
+	b->payload_bytes = (uint32_t)(p - w->payload);
+	b->t_last_ns = w->prev_t_ns;
+	b->nsamples++;
+	if (b->payload_bytes >= NCT_LOG_BLOCK_BYTES || (uint64_t)(b->t_last_ns - b->t_first_ns) >= NCT_LOG_BLOCK_NS) {
+		return flush_block(w);
+	}
+	return 0;
+}
+
+/*
+ * nct_log_close() - Flush the partial block and close the file
+ * RETURNS: 0, or -1 if the final flush failed (errno set)
+ */
+int nct_log_close(struct nct_log_writer *w) {
+	if (w->fd < 0) {
+		return 0;
+	}
+	int rc = flush_block(w);
+	close(w->fd);
+	w->fd = -1;
+	return rc;
+}
@@ -0,0 +1,273 @@
+/*
+ * nct-log.h - Append-only, block-structured telemetry log (nct-sampler --log)
+ *
+ * PURPOSE:
+ *   On-disk layout, encoder constants and header-only reader API of the
+ *   compact history files nct-sampler writes with --log DIR and nct-query
+ *   reads. Weeks of per-node samples in tens of MB per day instead of
+ *   journal text, queryable over a time range without decoding it all.
+ *
+ * LAYOUT (native endianness, every block 8-byte aligned):
+ *   struct nct_log_file             magic, geometry, channel table
+ *   block, block, ...               appended, never rewritten
+ *
+ *   block = struct nct_log_block    time range, sample count, checksum
+ *           int32_t min[nchannels]  per-channel summary of the block
+ *           int32_t max[nchannels]  (NCT_LOG_INVALID samples excluded)
+ *           payload                 payload_bytes, padded to 8
+ *
+ * ENCODING (each block decodes on its own):
+ *   Per sample: varint(zigzag(dt_us - period_us)), then per channel
+ *   varint(zigzag(value - previous value)). The first sample's dt is 0
+ *   and its "previous values" are 0. A steady tick costs one byte and an
+ *   unchanged channel one byte; a sample of ~40 mostly idle channels
+ *   takes ~45 bytes instead of ~300 as text.
+ *
+ * TIME INDEX:
+ *   t_first_ns / t_last_ns (CLOCK_REALTIME, so history spans reboots) in
+ *   every block header: a reader walks headers by size and decodes only
+ *   blocks overlapping its range; min/max of a fully covered block come
+ *   from its summary without decoding at all. File names
+ *   (nct-YYYYmmddTHHMMSSZ.log, UTC) sort by creation time, so a directory
+ *   listing is already in time order.
+ *
+ * DURABILITY:
+ *   A block is written with one write(2) when its payload reaches
+ *   NCT_LOG_BLOCK_BYTES or spans NCT_LOG_BLOCK_NS, so at most a minute of
+ *   samples is lost on a crash. A torn last block fails its checksum and
+ *   readers stop there; the file stays readable. Files rotate at
+ *   --log-size and the oldest beyond --log-keep are deleted.
+ */
+
+#ifndef NCT_LOG_H
+#define NCT_LOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define NCT_LOG_MAGIC         "\x7fNCTTLOG"
+#define NCT_LOG_VERSION       1
+#define NCT_LOG_BLOCK_MAGIC   0x4B4C4254u            /* "TBLK" */
+#define NCT_LOG_CHANNELS      96                     /* == NCT_RING_CHANNELS */
+#define NCT_LOG_NAME_MAX      32
+#define NCT_LOG_INVALID       INT32_MIN              /* channel read failed */
+#define NCT_LOG_BLOCK_BYTES   16384                  /* payload flush threshold */
+#define NCT_LOG_BLOCK_NS      (60ull * 1000000000ull) /* ... or one minute */
+#define NCT_LOG_SAMPLE_MAX    (10 + 10 * NCT_LOG_CHANNELS)  /* worst-case encoded sample */
+#define NCT_LOG_DIR           "/var/lib/eirikr/telemetry"
+#define NCT_LOG_FILE_BYTES    (64ull << 20)          /* default --log-size */
+#define NCT_LOG_KEEP          32                     /* default --log-keep */
+
+struct nct_log_channel {
+	char name[NCT_LOG_NAME_MAX];    /* sysfs attribute, e.g. "temp1_input" */
+	char label[NCT_LOG_NAME_MAX];   /* tempN_label etc., "" if none */
+	uint8_t kind;                   /* enum hwmon_kind */
+	uint8_t index;
+	uint8_t reserved[6];
+};
+
+struct nct_log_file {
+	char magic[8];                  /* NCT_LOG_MAGIC, no NUL */
+	uint32_t version;
+	uint32_t header_size;           /* offset of the first block */
+	uint32_t nchannels;
+	uint32_t rate_hz;               /* period_us = 1000000 / rate_hz */
+	int64_t created_ns;             /* CLOCK_REALTIME */
+	char source[64];                /* hwmon directory or ISA description */
+	struct nct_log_channel channels[NCT_LOG_CHANNELS];  /* first nchannels valid */
+};
+
+struct nct_log_block {
+	uint32_t magic;                 /* NCT_LOG_BLOCK_MAGIC */
+	uint32_t payload_bytes;
+	uint32_t nsamples;
+	uint32_t checksum;              /* nct_log_checksum() of summary + payload */
+	int64_t t_first_ns;             /* CLOCK_REALTIME of the first sample */
+	int64_t t_last_ns;
+};
+
+_Static_assert(sizeof(struct nct_log_file) % 8 == 0, "blocks start 8-byte aligned");
+_Static_assert(sizeof(struct nct_log_block) == 32, "block header is 32 bytes");
+
+static inline size_t nct_log_pad8(size_t n) {
+	return (n + 7) & ~(size_t)7;
+}
+
+/* Whole block: header + min[] + max[] + padded payload */
+static inline size_t nct_log_block_size(const struct nct_log_block *b, uint32_t nchannels) {
+	return sizeof(*b) + 2 * (size_t)nchannels * sizeof(int32_t) + nct_log_pad8(b->payload_bytes);
+}
+
+static inline const int32_t *nct_log_block_min(const struct nct_log_block *b) {
+	return (const int32_t *)(b + 1);
+}
+
+static inline const int32_t *nct_log_block_max(const struct nct_log_block *b, uint32_t nchannels) {
+	return nct_log_block_min(b) + nchannels;
+}
+
+static inline const uint8_t *nct_log_block_payload(const struct nct_log_block *b, uint32_t nchannels) {
+	return (const uint8_t *)(nct_log_block_max(b, nchannels) + nchannels);
+}
+
+/* FNV-1a, as nct-plan.h: catches torn and corrupted blocks */
+static inline uint32_t nct_log_checksum(const void *data, size_t len) {
+	const unsigned char *p = data;
+	uint32_t h = 2166136261u;
+	for (size_t i = 0; i < len; ++i) {
+		h = (h ^ p[i]) * 16777619u;
+	}
+	return h;
+}
+
+static inline uint64_t nct_log_zigzag(int64_t v) {
+	return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static inline int64_t nct_log_unzigzag(uint64_t v) {
+	return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+/* RETURNS: bytes written to out (1-10) */
+static inline size_t nct_log_put_varint(uint8_t *out, uint64_t v) {
+	size_t n = 0;
+	while (v >= 0x80) {
+		out[n++] = (uint8_t)(v | 0x80);
+		v >>= 7;
+	}
+	out[n++] = (uint8_t)v;
+	return n;
+}
+
+/* RETURNS: 0, or -1 if the varint runs past end or over 10 bytes */
+static inline int nct_log_get_varint(const uint8_t **p, const uint8_t *end, uint64_t *out) {
+	uint64_t v = 0;
+	for (unsigned shift = 0; shift < 70 && *p < end; shift += 7) {
+		uint8_t byte = *(*p)++;
+		v |= (uint64_t)(byte & 0x7F) << shift;
+		if (!(byte & 0x80)) {
+			*out = v;
+			return 0;
+		}
+	}
+	return -1;
+}
+
+/*
+ * nct_log_file_ok() - Validate a mapped file's header
+ * RETURNS: 1 if blocks may be walked from header_size, 0 otherwise
+ */
+static inline int nct_log_file_ok(const void *map, size_t size) {
+	const struct nct_log_file *f = map;
+	return size >= sizeof(*f) && memcmp(f->magic, NCT_LOG_MAGIC, sizeof(f->magic)) == 0 &&
+	       f->version == NCT_LOG_VERSION && f->header_size == sizeof(*f) && f->nchannels > 0 &&
+	       f->nchannels <= NCT_LOG_CHANNELS && f->rate_hz > 0;
+}
+
+/*
+ * nct_log_next_block() - Block at offset *off of a mapped file, then advance
+ * HOW:  Header and size checks only; the checksum costs a pass over the
+ *       block, so it is verified by nct_log_block_verify() when decoding
+ * RETURNS: block, or NULL at the end of the valid prefix
+ */
+static inline const struct nct_log_block *nct_log_next_block(const void *map, size_t size, size_t *off) {
+	const struct nct_log_file *f = map;
+	if (*off + sizeof(struct nct_log_block) > size) {
+		return NULL;
+	}
+	const struct nct_log_block *b = (const struct nct_log_block *)((const char *)map + *off);
+	if (b->magic != NCT_LOG_BLOCK_MAGIC || b->nsamples == 0 || b->payload_bytes > size ||
+	    *off + nct_log_block_size(b, f->nchannels) > size) {
+		return NULL;
+	}
+	*off += nct_log_block_size(b, f->nchannels);
+	return b;
+}
+
+static inline int nct_log_block_verify(const struct nct_log_block *b, uint32_t nchannels) {
+	size_t len = 2 * (size_t)nchannels * sizeof(int32_t) + b->payload_bytes;
+	return nct_log_checksum(b + 1, len) == b->checksum;
+}
+
+/*
+ * struct nct_log_cursor - Sample-by-sample decoder over one block
+ * After each successful nct_log_cursor_next(): t_ns and values[] hold
+ * the sample
+ */
+struct nct_log_cursor {
+	const uint8_t *p, *end;
+	uint32_t left;
+	uint32_t nchannels;
+	int started;
+	int64_t period_us;
+	int64_t t_ns;
+	int32_t values[NCT_LOG_CHANNELS];
+};
+
+static inline void nct_log_cursor_init(struct nct_log_cursor *c, const struct nct_log_file *f,
+				       const struct nct_log_block *b) {
+	c->p = nct_log_block_payload(b, f->nchannels);
+	c->end = c->p + b->payload_bytes;
+	c->left = b->nsamples;
+	c->nchannels = f->nchannels;
+	c->period_us = 1000000 / f->rate_hz;
+	c->t_ns = b->t_first_ns;
+	c->started = 0;
+	memset(c->values, 0, sizeof(c->values));
+}
+
+/* RETURNS: 1 = sample decoded, 0 = end of block, -1 = corrupt payload */
+static inline int nct_log_cursor_next(struct nct_log_cursor *c) {
+	uint64_t v;
+	if (c->left == 0) {
+		return 0;
+	}
+	if (nct_log_get_varint(&c->p, c->end, &v) < 0) {
+		return -1;
+	}
+	/* the first sample sits at t_first_ns; later ones are relative to the period */
+	if (c->started) {
+		c->t_ns += (c->period_us + nct_log_unzigzag(v)) * 1000;
+	}
+	c->started = 1;
+	for (uint32_t i = 0; i < c->nchannels; ++i) {
+		if (nct_log_get_varint(&c->p, c->end, &v) < 0) {
+			return -1;
+		}
+		c->values[i] = (int32_t)((int64_t)c->values[i] + nct_log_unzigzag(v));
+	}
+	c->left--;
+	return 1;
+}
+
+/*
+ * struct nct_log_writer - nct-sampler's encoder state (nct-log.c)
+ * buf holds the block being built in its on-disk form (header, min[],
+ * max[], payload), so a flush is one write(2) of buf
+ */
+struct nct_log_writer {
+	char dir[192];
+	int fd;
+	uint64_t file_bytes, max_bytes;
+	int keep;
+	int64_t name_sec;               /* second in the current file's name */
+	uint32_t nchannels;
+	int64_t period_us;
+	int64_t prev_t_ns;              /* reconstructed time of the last sample */
+	int32_t prev[NCT_LOG_CHANNELS];
+	struct nct_log_block *blk;      /* all four point into buf */
+	int32_t *min, *max;
+	uint8_t *payload;
+	struct nct_log_file hdr;
+	uint64_t buf[(sizeof(struct nct_log_block) + 2 * NCT_LOG_CHANNELS * sizeof(int32_t) +
+		      NCT_LOG_BLOCK_BYTES + NCT_LOG_SAMPLE_MAX + 7) / 8];
+	uint64_t blocks, bytes;         /* written since open, for the exit summary */
+};
+
+int nct_log_open(struct nct_log_writer *w, const char *dir, const struct nct_log_channel *ch, uint32_t n,
+		 uint32_t rate_hz, const char *source, uint64_t max_bytes, int keep);
+int nct_log_append(struct nct_log_writer *w, int64_t t_ns, const int32_t *values);
+int nct_log_close(struct nct_log_writer *w);
+
+#endif /* NCT_LOG_H */
@@ -0,0 +1,103 @@
+/*
+ * nct-plan.h - Compiled fan-control write plan (binary profile image)
+ *
+ * PURPOSE:
+ *   On-disk layout of the ordered write plan that nct-profile compiles
+ *   from a declarative profile and nct-fan applies. A plan holds exactly
+ *   the lines of an nct-fan text profile ("[FLAG]ATTRIBUTE VALUE"), already
+ *   validated, expanded and in write order, as fixed-size records.
+ *
+ * WHY:
+ *   Boot-time application should do no parsing and no validation: the
+ *   compiler checked curve monotonicity, PPR values, ranges and required
+ *   keys once, when the profile was edited. nct-fan reads the header, the
+ *   records, verifies the checksum and starts writing.
+ *
+ * LAYOUT (native endianness; plans are built and applied on the same box):
+ *   struct nct_plan_header      magic, geometry, checksum, source identity
+ *   struct nct_plan_entry[n]    n = header.count, in write order
+ *
+ *   magic starts with 0x7F, a byte no text profile starts with, so
+ *   `nct-fan --apply FILE` tells a plan from a text profile by one getc().
+ *
+ * STALENESS:
+ *   The header records the source profile's path, size and mtime.
+ *   nct-fan compares them with one stat(2) and warns when the source was
+ *   edited after compilation; it still applies the plan it has, because a
+ *   profile that no longer compiles must not leave the fans unprogrammed.
+ *
+ * FLAGS (identical to the text profile, see nct-fan.c PROFILE FORMAT):
+ *   ' ' required write, '?' optional write, '!' gate write
+ */
+
+#ifndef NCT_PLAN_H
+#define NCT_PLAN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define NCT_PLAN_MAGIC     "\x7fNCTPLAN"
+#define NCT_PLAN_VERSION   1
+#define NCT_PLAN_NAME_MAX  64       /* == nct-fan MAX_ATTR_NAME */
+#define NCT_PLAN_VALUE_MAX 33       /* == nct-fan MAX_VALUE + 1 */
+#define NCT_PLAN_MAX       1024     /* == nct-fan MAX_LINES */
+#define NCT_PLAN_SOURCE_MAX 256
+#define NCT_PLAN_PATH      "/var/cache/eirikr/nct-fan.plan"
+
+struct nct_plan_header {
+	char magic[8];                      /* NCT_PLAN_MAGIC, no NUL */
+	uint32_t version;
+	uint32_t entry_size;                /* sizeof(struct nct_plan_entry) */
+	uint32_t count;
+	uint32_t checksum;                  /* nct_plan_checksum() of the entries */
+	int64_t source_mtime_ns;
+	int64_t source_size;
+	char source[NCT_PLAN_SOURCE_MAX];   /* absolute path of the profile */
+};
+
+struct nct_plan_entry {
+	char flag;                          /* ' ', '?' or '!' */
+	char name[NCT_PLAN_NAME_MAX];       /* NUL-terminated attribute name */
+	char value[NCT_PLAN_VALUE_MAX];     /* NUL-terminated decimal value */
+	char reserved[30];
+};
+
+_Static_assert(sizeof(struct nct_plan_entry) == 128, "plan entries are fixed 128-byte records");
+
+/* FNV-1a over the entry records: catches a truncated or corrupted cache */
+static inline uint32_t nct_plan_checksum(const struct nct_plan_entry *e, uint32_t count) {
+	const unsigned char *p = (const unsigned char *)e;
+	uint32_t h = 2166136261u;
+	for (size_t i = 0; i < (size_t)count * sizeof(*e); ++i) {
+		h = (h ^ p[i]) * 16777619u;
+	}
+	return h;
+}
+
+/*
+ * nct_plan_read() - Read a whole plan from a stream
+ * IN:  max = capacity of entries[]
+ * RETURNS: entry count, or -1 (bad magic/version/geometry, short read,
+ *          checksum mismatch, too many entries)
+ */
+static inline int nct_plan_read(FILE *in, struct nct_plan_header *hdr, struct nct_plan_entry *entries, int max) {
+	if (fread(hdr, sizeof(*hdr), 1, in) != 1 || memcmp(hdr->magic, NCT_PLAN_MAGIC, sizeof(hdr->magic)) != 0 ||
+	    hdr->version != NCT_PLAN_VERSION || hdr->entry_size != sizeof(struct nct_plan_entry) ||
+	    hdr->count > (uint32_t)max) {
+		return -1;
+	}
+	if (fread(entries, sizeof(*entries), hdr->count, in) != hdr->count ||
+	    nct_plan_checksum(entries, hdr->count) != hdr->checksum) {
+		return -1;
+	}
+	for (uint32_t i = 0; i < hdr->count; ++i) {
+		entries[i].name[NCT_PLAN_NAME_MAX - 1] = '\0';
+		entries[i].value[NCT_PLAN_VALUE_MAX - 1] = '\0';
+	}
+	hdr->source[NCT_PLAN_SOURCE_MAX - 1] = '\0';
+	return (int)hdr->count;
+}
+
+#endif /* NCT_PLAN_H */
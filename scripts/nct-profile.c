@@ -0,0 +1,1054 @@
+/*
+ * nct-profile.c - Declarative fan profile compiler for nct-fan
+ *
+ * PURPOSE:
+ *   Compile a declarative per-header profile (curves, cruise targets,
+ *   weighting, electrical mode, tachometry) into a validated, ordered
+ *   write plan (nct-plan.h) that nct-fan applies in one shot.
+ *
+ * WHY THIS EXISTS:
+ *   Profiles used to be bash lines in max-fans-restore.conf calling
+ *   max-fans-advanced.sh subcommands one at a time, with the curve
+ *   hardcoded in DEFAULT_TEMPS_7PT/DEFAULT_PWMS_7PT and validation (the
+ *   1/2/3/4/5/8 PPR check in set_tachometry()) repeated on every boot.
+ *   Here everything is checked once, when the profile is edited; boot
+ *   reads a fixed-record image and writes.
+ *
+ * PROFILE FORMAT (default /usr/local/etc/nct-fan-profile.conf):
+ *   [pwmN] or [pwmA-B]      header section; a range applies to each header,
+ *                           later sections override earlier ones per key
+ *   [fanN] or [fanA-B]      tachometer section
+ *   [tempN] / [inN]         on-chip alarm limits (see LIMITS); in0 is valid
+ *   key = value             '#' starts a comment
+ *   model = PATH            top level, before any section: nct-characterize
+ *                           model that the "auto" values below come from
+ *
+ *   pwm keys:
+ *     mode = smartfan | cruise | manual      omitted: mode left alone
+ *     curve = T:D, T:D, ...                  smartfan, 1-7 points, T in C
+ *                                            (0-127, strictly rising), duty
+ *                                            D 0-255 (never falling)
+ *     target = C, tolerance = C              cruise (both required)
+ *     start = D, floor = D                   cruise, optional; auto = the
+ *                                            model's start/stall duty + 8
+ *     duty = D                               manual (required)
+ *     step_up_time = MS, step_down_time = MS, stop_time = MS
+ *                                            100-25500, a multiple of 100:
+ *                                            nct6775 stores 100 ms units
+ *     electrical = pwm | dc
+ *     weight_sensor = N                      tempN as secondary source
+ *     weight_temp_step = C, weight_temp_step_base = C,
+ *     weight_duty_step = N, weight_temp_step_tol = C
+ *   fan keys:
+ *     pulses = 1 | 2 | 3 | 4 | 5 | 8 | auto   auto = model's pulses_suggested
+ *                                            (changes PPR only for a fan
+ *                                            characterized with --rated)
+ *     min = RPM                              fanN_min, 0 = no alarm
+ *   temp keys:
+ *     max = C, max_hyst = C, crit = C        tempN_max / _max_hyst / _crit
+ *   in keys:
+ *     min = MV, max = MV                     inN_min / inN_max, chip-pin mV
+ *   Example: examples/nct-fan-profile.conf.example
+ *
+ * MEASURED MODEL (model = PATH, written by nct-characterize):
+ *   start/floor = auto resolve to the measured duty plus AUTO_MARGIN, so a
+ *   fan that stalls below 40 gets a floor of 48 instead of a guess. A
+ *   header the model found without a fan gets no start/floor write. With a
+ *   model loaded, an explicit floor > 0 below the measured stall duty is an
+ *   error: the fan would stop at floor while the chip believes it turns.
+ *
+ * LIMITS:
+ *   The chip compares every conversion against these registers and latches
+ *   tempN_alarm / inN_alarm / fanN_alarm; nct-alarm waits on those instead
+ *   of polling values. max_hyst must not exceed max and min must not
+ *   exceed max. Voltages are at the chip pin (what inN_input reports), not
+ *   the rail after sensors.conf scaling.
+ *
+ * PLAN ORDER (per header, ascending; identical to max-fans-advanced.sh):
+ *   !pwmN_enable 0                 only when mode is set (the gate)
+ *   curve points / cruise targets, ?timing, weighting, pwmN_mode
+ *   pwmN_enable 5|2|1              only when mode is set
+ *   pwmN DUTY                      manual only (honoured in mode 1 only)
+ *   then fanN_pulses for every fan section
+ *   then limits: fanN_min, tempN_max/_max_hyst/_crit, inN_min/_max
+ *
+ * USAGE:
+ *   nct-profile --compile PROFILE [-o PLAN]   (default -o /var/cache/eirikr/nct-fan.plan)
+ *   nct-profile --check PROFILE               validate, write nothing
+ *   nct-profile --print PROFILE|PLAN          the plan as an nct-fan text profile
+ *   Apply: nct-fan --apply PLAN HWMON_DIR (or max-fans-advanced.sh --plan)
+ *
+ * EXIT STATUS:
+ *   0  valid (and written)
+ *   1  validation errors, each reported as [ERROR] FILE:LINE: ...
+ *   2  usage error or I/O failure
+ *
+ * SAFETY / CAVEATS:
+ *   - Never touches hardware; the plan goes through nct-fan's gate and
+ *     reconcile logic like any text profile
+ *   - Written atomically (PLAN.tmp + rename), so a failed compile keeps the
+ *     previous plan in place
+ */
+
+#define _GNU_SOURCE
+#include "nct-plan.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define MAX_PWM    7
+#define MAX_FAN    7
+#define MAX_POINTS 7    /* SmartFan IV: pwmN_auto_point1..7 */
+#define TEMP_MAX   127  /* auto point / target registers are 8-bit C */
+#define AUTO_MARGIN 8   /* duty added to a measured start/stall duty */
+#define MAX_TEMP   16   /* nct6775 names temp1-temp10 plus virtual temps */
+#define MAX_IN     15   /* in0-in15 */
+#define IN_MAX_MV  4080 /* 8-bit limit register x 16 mV, the coarsest scale */
+#define FAN_MIN_MAX 30000
+
+enum section {
+	SEC_PWM,
+	SEC_FAN,
+	SEC_TEMP,
+	SEC_IN,
+};
+
+enum pwm_mode {
+	MODE_KEEP,
+	MODE_SMARTFAN,
+	MODE_CRUISE,
+	MODE_MANUAL,
+};
+
+/* Optional numeric settings, in plan order after the curve/cruise block */
+enum pwm_key {
+	K_START, K_FLOOR, K_DUTY,
+	K_STEP_UP, K_STEP_DOWN, K_STOP,
+	K_WEIGHT_SEL, K_WEIGHT_STEP, K_WEIGHT_BASE, K_WEIGHT_DUTY, K_WEIGHT_TOL,
+	K_ELECTRICAL, K_TARGET, K_TOLERANCE,
+	K_COUNT,
+};
+
+struct pwm_spec {
+	enum pwm_mode mode;
+	int mode_line;
+	int npts;
+	int pt_temp[MAX_POINTS];
+	int pt_duty[MAX_POINTS];
+	int curve_line;
+	bool set[K_COUNT];
+	long val[K_COUNT];
+	int line[K_COUNT];
+};
+
+struct fan_spec {
+	int pulses;     /* 0 = not set */
+	bool min_set;
+	long min;       /* fanN_min, RPM */
+};
+
+enum limit_key {
+	L_MIN, L_MAX, L_HYST, L_CRIT,
+	L_COUNT,
+};
+
+/* Alarm limits of one [tempN] / [inN], in sysfs units */
+struct limit_spec {
+	bool set[L_COUNT];
+	long val[L_COUNT];
+	int line[L_COUNT];
+};
+
+/*
+ * struct limit_def - One key a [tempN] / [inN] section accepts
+ * attr: sysfs attribute, %d = channel index; order here is plan order
+ */
+struct limit_def {
+	const char *key;
+	enum limit_key k;
+	long min, max;
+	long scale;
+	const char *attr;
+};
+
+static const struct limit_def temp_limits[] = {
+	{"max", L_MAX, 0, TEMP_MAX, 1000, "temp%d_max"},
+	{"max_hyst", L_HYST, 0, TEMP_MAX, 1000, "temp%d_max_hyst"},
+	{"crit", L_CRIT, 0, TEMP_MAX, 1000, "temp%d_crit"},
+};
+
+static const struct limit_def in_limits[] = {
+	{"min", L_MIN, 0, IN_MAX_MV, 1, "in%d_min"},
+	{"max", L_MAX, 0, IN_MAX_MV, 1, "in%d_max"},
+};
+
+/* One [pwmN] section of an nct-characterize model */
+struct model_header {
+	bool present, connected;
+	int fan;
+	int stall_duty, start_duty;
+	int pulses_suggested;   /* 0 = not measured */
+};
+
+/*
+ * struct key_def - One "key = value" a pwm section accepts
+ * step:  the value must be a multiple of this (the driver's register unit)
+ * scale: multiply the value by this before writing (C -> millidegrees);
+ *        all four weight_temp_* attributes are millidegrees in sysfs, not
+ *        just _step_base
+ */
+struct key_def {
+	const char *key;
+	enum pwm_key k;
+	long min, max;
+	long step;
+	long scale;
+};
+
+static const struct key_def pwm_keys[] = {
+	{"start", K_START, 0, 255, 1, 1},
+	{"floor", K_FLOOR, 0, 255, 1, 1},
+	{"duty", K_DUTY, 0, 255, 1, 1},
+	{"step_up_time", K_STEP_UP, 100, 25500, 100, 1},
+	{"step_down_time", K_STEP_DOWN, 100, 25500, 100, 1},
+	{"stop_time", K_STOP, 100, 25500, 100, 1},
+	{"weight_sensor", K_WEIGHT_SEL, 1, 16, 1, 1},
+	{"weight_temp_step", K_WEIGHT_STEP, 0, 255, 1, 1000},
+	{"weight_temp_step_base", K_WEIGHT_BASE, 0, TEMP_MAX, 1, 1000},
+	{"weight_duty_step", K_WEIGHT_DUTY, 0, 255, 1, 1},
+	{"weight_temp_step_tol", K_WEIGHT_TOL, 0, 255, 1, 1000},
+	{"target", K_TARGET, 0, TEMP_MAX, 1, 1000},
+	{"tolerance", K_TOLERANCE, 0, TEMP_MAX, 1, 1000},
+};
+
+static struct pwm_spec pwms[MAX_PWM + 1];
+static struct fan_spec fans[MAX_FAN + 1];
+static struct limit_spec temps[MAX_TEMP + 1];
+static struct limit_spec ins[MAX_IN + 1];
+static struct model_header model[MAX_PWM + 1];
+static const char *model_path;   /* NULL: no model = line */
+static struct nct_plan_entry plan[NCT_PLAN_MAX];
+static int plan_len;
+static int errors;
+static const char *spec_path;
+static int section_line;   /* line of the current section header */
+
+#define spec_error(lineno, ...) do { \
+	fprintf(stderr, "[ERROR] %s:%d: ", spec_path, lineno); \
+	fprintf(stderr, __VA_ARGS__); \
+	fputc('\n', stderr); \
+	errors++; \
+} while (0)
+
+static char *trim(char *s) {
+	s += strspn(s, " \t");
+	char *end = s + strlen(s);
+	while (end > s && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\n' || end[-1] == '\r')) {
+		*--end = '\0';
+	}
+	return s;
+}
+
+static bool parse_long(const char *s, long min, long max, long *out) {
+	char *end;
+	errno = 0;
+	long v = strtol(s, &end, 10);
+	if (end == s || *end || errno || v < min || v > max) {
+		return false;
+	}
+	*out = v;
+	return true;
+}
+
+/*
+ * parse_section() - "[pwm2]" / "[pwm1-6]" / "[fan3]" / "[temp1]" / "[in0-7]"
+ * OUT: *sec, *lo, *hi
+ * RETURNS: 0, or -1 (reported)
+ */
+static int parse_section(char *s, int lineno, enum section *sec, int *lo, int *hi) {
+	static const struct {
+		const char *prefix;
+		enum section sec;
+		int first, last;
+	} kinds[] = {
+		{"pwm", SEC_PWM, 1, MAX_PWM},
+		{"fan", SEC_FAN, 1, MAX_FAN},
+		{"temp", SEC_TEMP, 1, MAX_TEMP},
+		{"in", SEC_IN, 0, MAX_IN},
+	};
+
+	size_t len = strlen(s);
+	if (len < 3 || s[len - 1] != ']') {
+		spec_error(lineno, "malformed section header");
+		return -1;
+	}
+	s[len - 1] = '\0';
+	s++;
+
+	size_t kind = 0;
+	while (kind < sizeof(kinds) / sizeof(kinds[0]) &&
+	       strncmp(s, kinds[kind].prefix, strlen(kinds[kind].prefix)) != 0) {
+		kind++;
+	}
+	if (kind == sizeof(kinds) / sizeof(kinds[0])) {
+		spec_error(lineno, "unknown section [%s] (expected [pwmN], [pwmA-B], [fanN], [tempN], [inN])", s);
+		return -1;
+	}
+	*sec = kinds[kind].sec;
+
+	char *end;
+	const char *digits = s + strlen(kinds[kind].prefix);
+	long a = strtol(digits, &end, 10);
+	long b = a;
+	if (*end == '-') {
+		b = strtol(end + 1, &end, 10);
+	}
+	if (end == digits || *end || a < kinds[kind].first || b < a || b > kinds[kind].last) {
+		spec_error(lineno, "[%s]: index must be %d-%d (range A-B with A <= B)", s, kinds[kind].first,
+			   kinds[kind].last);
+		return -1;
+	}
+	*lo = (int)a;
+	*hi = (int)b;
+	return 0;
+}
+
+/*
+ * parse_curve() - "40:64, 50:96, ..." with monotonicity checks
+ * WHY: SmartFan IV interpolates between consecutive points; a falling
+ *      temperature or duty makes the chip's curve engine misbehave instead
+ *      of failing, so it is rejected here
+ */
+static int parse_curve(struct pwm_spec *p, char *v, int lineno) {
+	int n = 0;
+	int temp[MAX_POINTS], duty[MAX_POINTS];
+
+	for (char *save, *tok = strtok_r(v, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+		tok = trim(tok);
+		char *colon = strchr(tok, ':');
+		long t, d;
+		if (n == MAX_POINTS) {
+			spec_error(lineno, "curve: more than %d points", MAX_POINTS);
+			return -1;
+		}
+		if (!colon) {
+			spec_error(lineno, "curve: point '%s' is not TEMP:DUTY", tok);
+			return -1;
+		}
+		*colon = '\0';
+		if (!parse_long(trim(tok), 0, TEMP_MAX, &t) || !parse_long(trim(colon + 1), 0, 255, &d)) {
+			spec_error(lineno, "curve: point %d needs TEMP 0-%d C and DUTY 0-255", n + 1, TEMP_MAX);
+			return -1;
+		}
+		if (n > 0 && t <= temp[n - 1]) {
+			spec_error(lineno, "curve: point %d temperature %ld C is not above point %d (%d C)",
+				   n + 1, t, n, temp[n - 1]);
+			return -1;
+		}
+		if (n > 0 && d < duty[n - 1]) {
+			spec_error(lineno, "curve: point %d duty %ld is below point %d (%d)", n + 1, d, n, duty[n - 1]);
+			return -1;
+		}
+		temp[n] = (int)t;
+		duty[n] = (int)d;
+		n++;
+	}
+	if (n == 0) {
+		spec_error(lineno, "curve: no points");
+		return -1;
+	}
+
+	p->npts = n;
+	memcpy(p->pt_temp, temp, sizeof(temp));
+	memcpy(p->pt_duty, duty, sizeof(duty));
+	p->curve_line = lineno;
+	return 0;
+}
+
+/*
+ * drop_inherited() - Forget other modes' keys set by an earlier section
+ * WHY: [pwm1-6] mode = smartfan, curve = ... followed by [pwm3] mode =
+ *      cruise must not leave pwm3 with a curve it can never use; keys from
+ *      the same section are kept, so mistakes there are still reported
+ */
+static void drop_inherited(struct pwm_spec *p) {
+	static const enum pwm_key cruise_keys[] = {K_TARGET, K_TOLERANCE, K_START, K_FLOOR};
+
+	if (p->mode != MODE_SMARTFAN && p->npts && p->curve_line < section_line) {
+		p->npts = 0;
+	}
+	for (size_t i = 0; i < sizeof(cruise_keys) / sizeof(cruise_keys[0]); ++i) {
+		enum pwm_key k = cruise_keys[i];
+		if (p->mode != MODE_CRUISE && p->set[k] && p->line[k] < section_line) {
+			p->set[k] = false;
+		}
+	}
+	if (p->mode != MODE_MANUAL && p->set[K_DUTY] && p->line[K_DUTY] < section_line) {
+		p->set[K_DUTY] = false;
+	}
+}
+
+static const struct model_key {
+	const char *key;
+	size_t offset;
+	long min, max;
+} model_keys[] = {
+	{"fan", offsetof(struct model_header, fan), 1, MAX_FAN},
+	{"stall_duty", offsetof(struct model_header, stall_duty), 0, 255},
+	{"start_duty", offsetof(struct model_header, start_duty), 0, 255},
+	{"pulses_suggested", offsetof(struct model_header, pulses_suggested), 0, 8},
+};
+
+/*
+ * load_model() - Read the [pwmN] sections of an nct-characterize model
+ * WHY: Only the keys "auto" needs are kept; the RPM tables are for people
+ * RETURNS: 0, or -1 (reported against the profile's model = line)
+ */
+static int load_model(const char *path, int lineno) {
+	FILE *in = fopen(path, "re");
+	if (!in) {
+		spec_error(lineno, "model: cannot open %s: %s", path, strerror(errno));
+		return -1;
+	}
+
+	char buf[512];
+	int mline = 0, cur = 0, bad = 0;
+	while (fgets(buf, sizeof(buf), in)) {
+		mline++;
+		buf[strcspn(buf, "#")] = '\0';
+		char *line = trim(buf);
+		char *eq = strchr(line, '=');
+		long v;
+		if (!*line) {
+			continue;
+		}
+		if (*line == '[') {
+			char *end;
+			cur = strncmp(line, "[pwm", 4) == 0 ? (int)strtol(line + 4, &end, 10) : 0;
+			if (cur < 1 || cur > MAX_PWM || strcmp(end, "]") != 0) {
+				bad = bad ? bad : mline;
+				cur = 0;
+				continue;
+			}
+			model[cur] = (struct model_header){.present = true, .fan = cur};
+			continue;
+		}
+		if (!cur || !eq) {
+			bad = bad ? bad : mline;
+			continue;
+		}
+		*eq = '\0';
+		char *key = trim(line);
+		char *value = trim(eq + 1);
+		struct model_header *m = &model[cur];
+		if (strcmp(key, "connected") == 0) {
+			m->connected = strcmp(value, "yes") == 0;
+			continue;
+		}
+		const struct model_key *mk = NULL;
+		for (size_t i = 0; i < sizeof(model_keys) / sizeof(model_keys[0]); ++i) {
+			if (strcmp(key, model_keys[i].key) == 0) {
+				mk = &model_keys[i];
+			}
+		}
+		if (!mk) {
+			continue;   /* rpm tables, max_rpm, ... */
+		}
+		if (!parse_long(value, mk->min, mk->max, &v)) {
+			bad = bad ? bad : mline;
+			continue;
+		}
+		*(int *)((char *)m + mk->offset) = (int)v;
+	}
+	fclose(in);
+	if (bad) {
+		spec_error(lineno, "model: %s:%d is not an nct-characterize model", path, bad);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * auto_duty() - start/floor = auto for header n
+ * RETURNS: duty, -1 (no fan: skip the write), or -2 (reported)
+ */
+static int auto_duty(int n, enum pwm_key k, int lineno) {
+	const struct model_header *m = &model[n];
+	if (!model_path) {
+		spec_error(lineno, "%s = auto needs a top-level model = PATH (nct-characterize)",
+			   k == K_START ? "start" : "floor");
+		return -2;
+	}
+	if (!m->present) {
+		spec_error(lineno, "pwm%d: not in model %s (re-run nct-characterize with this header)", n, model_path);
+		return -2;
+	}
+	if (!m->connected) {
+		return -1;
+	}
+	int duty = (k == K_START ? m->start_duty : m->stall_duty) + AUTO_MARGIN;
+	return duty > 255 ? 255 : duty;
+}
+
+/*
+ * set_pwm_key() - Apply one key to every header of the current section
+ */
+static void set_pwm_key(int lo, int hi, const char *key, char *value, int lineno) {
+	if (strcmp(key, "mode") == 0) {
+		enum pwm_mode m;
+		if (strcmp(value, "smartfan") == 0) {
+			m = MODE_SMARTFAN;
+		} else if (strcmp(value, "cruise") == 0) {
+			m = MODE_CRUISE;
+		} else if (strcmp(value, "manual") == 0) {
+			m = MODE_MANUAL;
+		} else {
+			spec_error(lineno, "mode must be smartfan, cruise or manual");
+			return;
+		}
+		for (int i = lo; i <= hi; ++i) {
+			pwms[i].mode = m;
+			pwms[i].mode_line = lineno;
+			drop_inherited(&pwms[i]);
+		}
+		return;
+	}
+	if (strcmp(key, "curve") == 0) {
+		struct pwm_spec tmp = {0};
+		if (parse_curve(&tmp, value, lineno) == 0) {
+			for (int i = lo; i <= hi; ++i) {
+				pwms[i].npts = tmp.npts;
+				memcpy(pwms[i].pt_temp, tmp.pt_temp, sizeof(tmp.pt_temp));
+				memcpy(pwms[i].pt_duty, tmp.pt_duty, sizeof(tmp.pt_duty));
+				pwms[i].curve_line = lineno;
+			}
+		}
+		return;
+	}
+
+	long v;
+	enum pwm_key k;
+	if ((strcmp(key, "start") == 0 || strcmp(key, "floor") == 0) && strcmp(value, "auto") == 0) {
+		k = key[0] == 's' ? K_START : K_FLOOR;
+		for (int i = lo; i <= hi; ++i) {
+			int duty = auto_duty(i, k, lineno);
+			if (duty == -2) {
+				return;
+			}
+			pwms[i].set[k] = duty >= 0;
+			pwms[i].val[k] = duty;
+			pwms[i].line[k] = lineno;
+		}
+		return;
+	}
+	if (strcmp(key, "electrical") == 0) {
+		if (strcmp(value, "dc") != 0 && strcmp(value, "pwm") != 0) {
+			spec_error(lineno, "electrical must be dc or pwm");
+			return;
+		}
+		k = K_ELECTRICAL;
+		v = strcmp(value, "pwm") == 0;
+	} else {
+		const struct key_def *def = NULL;
+		for (size_t i = 0; i < sizeof(pwm_keys) / sizeof(pwm_keys[0]); ++i) {
+			if (strcmp(key, pwm_keys[i].key) == 0) {
+				def = &pwm_keys[i];
+			}
+		}
+		if (!def) {
+			spec_error(lineno, "unknown pwm key '%s'", key);
+			return;
+		}
+		if (!parse_long(value, def->min, def->max, &v)) {
+			spec_error(lineno, "%s must be an integer %ld-%ld", key, def->min, def->max);
+			return;
+		}
+		/* Off-grid values read back rounded: --reconcile would regate every run */
+		if (v % def->step) {
+			spec_error(lineno, "%s must be a multiple of %ld (%ld-%ld)", key, def->step, def->min, def->max);
+			return;
+		}
+		k = def->k;
+		v *= def->scale;
+	}
+	for (int i = lo; i <= hi; ++i) {
+		pwms[i].set[k] = true;
+		pwms[i].val[k] = v;
+		pwms[i].line[k] = lineno;
+	}
+}
+
+/*
+ * model_pulses() - pulses = auto: pulses_suggested of the header measuring fanN
+ * RETURNS: PPR, or 0 (reported)
+ */
+static int model_pulses(int fan, int lineno) {
+	if (!model_path) {
+		spec_error(lineno, "pulses = auto needs a top-level model = PATH (nct-characterize)");
+		return 0;
+	}
+	for (int n = 1; n <= MAX_PWM; ++n) {
+		if (model[n].present && model[n].fan == fan && model[n].pulses_suggested) {
+			return model[n].pulses_suggested;
+		}
+	}
+	spec_error(lineno, "fan%d: model %s has no PPR check for it (no fan, or pulses unknown)", fan, model_path);
+	return 0;
+}
+
+/*
+ * set_fan_key() - pulses, validated exactly like set_tachometry()
+ */
+static void set_fan_key(int lo, int hi, const char *key, const char *value, int lineno) {
+	long v;
+	if (strcmp(key, "min") == 0) {
+		if (!parse_long(value, 0, FAN_MIN_MAX, &v)) {
+			spec_error(lineno, "min must be an RPM 0-%d", FAN_MIN_MAX);
+			return;
+		}
+		for (int i = lo; i <= hi; ++i) {
+			fans[i].min_set = true;
+			fans[i].min = v;
+		}
+		return;
+	}
+	if (strcmp(key, "pulses") != 0) {
+		spec_error(lineno, "unknown fan key '%s'", key);
+		return;
+	}
+	if (strcmp(value, "auto") == 0) {
+		for (int i = lo; i <= hi; ++i) {
+			fans[i].pulses = model_pulses(i, lineno);
+		}
+		return;
+	}
+	if (!parse_long(value, 1, 8, &v) || v == 6 || v == 7) {
+		spec_error(lineno, "pulses must be 1, 2, 3, 4, 5 or 8");
+		return;
+	}
+	for (int i = lo; i <= hi; ++i) {
+		fans[i].pulses = (int)v;
+	}
+}
+
+/*
+ * set_limit_key() - One key of a [tempN] / [inN] section
+ */
+static void set_limit_key(enum section sec, int lo, int hi, const char *key, const char *value, int lineno) {
+	const struct limit_def *defs = sec == SEC_TEMP ? temp_limits : in_limits;
+	size_t ndefs = sec == SEC_TEMP ? sizeof(temp_limits) / sizeof(temp_limits[0])
+				       : sizeof(in_limits) / sizeof(in_limits[0]);
+	struct limit_spec *specs = sec == SEC_TEMP ? temps : ins;
+
+	const struct limit_def *def = NULL;
+	for (size_t i = 0; i < ndefs; ++i) {
+		if (strcmp(key, defs[i].key) == 0) {
+			def = &defs[i];
+		}
+	}
+	long v;
+	if (!def) {
+		spec_error(lineno, "unknown %s key '%s'", sec == SEC_TEMP ? "temp" : "in", key);
+		return;
+	}
+	if (!parse_long(value, def->min, def->max, &v)) {
+		spec_error(lineno, "%s must be an integer %ld-%ld", key, def->min, def->max);
+		return;
+	}
+	for (int i = lo; i <= hi; ++i) {
+		specs[i].set[def->k] = true;
+		specs[i].val[def->k] = v * def->scale;
+		specs[i].line[def->k] = lineno;
+	}
+}
+
+/*
+ * load_spec() - Parse every line, reporting each error and carrying on
+ */
+static void load_spec(FILE *in) {
+	char buf[512];
+	int lineno = 0;
+	bool seen_section = false, have_section = false;
+	enum section sec = SEC_PWM;
+	int lo = 0, hi = 0;
+
+	while (fgets(buf, sizeof(buf), in)) {
+		lineno++;
+		buf[strcspn(buf, "#")] = '\0';
+		char *line = trim(buf);
+		if (!*line) {
+			continue;
+		}
+		if (*line == '[') {
+			seen_section = true;
+			section_line = lineno;
+			have_section = parse_section(line, lineno, &sec, &lo, &hi) == 0;
+			continue;
+		}
+		char *eq = strchr(line, '=');
+		if (!eq) {
+			spec_error(lineno, "expected 'key = value'");
+			continue;
+		}
+		*eq = '\0';
+		char *key = trim(line);
+		char *value = trim(eq + 1);
+		if (!seen_section && strcmp(key, "model") == 0) {
+			if (model_path) {
+				spec_error(lineno, "model given twice");
+			} else if (load_model(value, lineno) == 0) {
+				model_path = strdup(value);
+			}
+			continue;
+		}
+		if (!have_section) {
+			/* Keys under a rejected header were already accounted for */
+			if (!seen_section) {
+				spec_error(lineno, "'%s' outside a [pwmN] / [fanN] / [tempN] / [inN] section", key);
+			}
+			continue;
+		}
+		switch (sec) {
+		case SEC_PWM:
+			set_pwm_key(lo, hi, key, value, lineno);
+			break;
+		case SEC_FAN:
+			set_fan_key(lo, hi, key, value, lineno);
+			break;
+		default:
+			set_limit_key(sec, lo, hi, key, value, lineno);
+			break;
+		}
+	}
+}
+
+/*
+ * check_header() - Cross-key rules that need the whole section merged
+ */
+static void check_header(int n) {
+	struct pwm_spec *p = &pwms[n];
+	static const enum pwm_key cruise_only[] = {K_TARGET, K_TOLERANCE, K_START, K_FLOOR};
+
+	if (p->npts && p->mode != MODE_SMARTFAN) {
+		spec_error(p->curve_line, "pwm%d: curve needs mode = smartfan", n);
+	}
+	if (p->mode == MODE_SMARTFAN && !p->npts) {
+		spec_error(p->mode_line, "pwm%d: mode = smartfan needs a curve", n);
+	}
+	for (size_t i = 0; i < sizeof(cruise_only) / sizeof(cruise_only[0]); ++i) {
+		if (p->set[cruise_only[i]] && p->mode != MODE_CRUISE) {
+			spec_error(p->line[cruise_only[i]], "pwm%d: target/tolerance/start/floor need mode = cruise", n);
+			break;
+		}
+	}
+	if (p->mode == MODE_CRUISE && (!p->set[K_TARGET] || !p->set[K_TOLERANCE])) {
+		spec_error(p->mode_line, "pwm%d: mode = cruise needs target and tolerance", n);
+	}
+	if (p->set[K_DUTY] && p->mode != MODE_MANUAL) {
+		spec_error(p->line[K_DUTY], "pwm%d: duty needs mode = manual", n);
+	}
+	if (p->mode == MODE_MANUAL && !p->set[K_DUTY]) {
+		spec_error(p->mode_line, "pwm%d: mode = manual needs duty", n);
+	}
+	if (model_path && model[n].connected && p->set[K_FLOOR] && p->val[K_FLOOR] > 0 &&
+	    p->val[K_FLOOR] < model[n].stall_duty) {
+		spec_error(p->line[K_FLOOR], "pwm%d: floor %ld is below the measured stall duty %d (%s)", n,
+			   p->val[K_FLOOR], model[n].stall_duty, model_path);
+	}
+	for (enum pwm_key k = K_WEIGHT_STEP; k <= K_WEIGHT_TOL; ++k) {
+		if (p->set[k] && !p->set[K_WEIGHT_SEL]) {
+			spec_error(p->line[k], "pwm%d: weighting keys need weight_sensor", n);
+			break;
+		}
+	}
+}
+
+/*
+ * check_limits() - max_hyst <= max, min <= max, for one [tempN] / [inN]
+ */
+static void check_limits(const struct limit_spec *l, const char *prefix, int n) {
+	if (l->set[L_HYST] && l->set[L_MAX] && l->val[L_HYST] > l->val[L_MAX]) {
+		spec_error(l->line[L_HYST], "%s%d: max_hyst is above max (the alarm would never clear)", prefix, n);
+	}
+	if (l->set[L_MIN] && l->set[L_MAX] && l->val[L_MIN] > l->val[L_MAX]) {
+		spec_error(l->line[L_MIN], "%s%d: min is above max (the alarm would never clear)", prefix, n);
+	}
+}
+
+static void emit(char flag, const char *value, const char *fmt, int index, int sub) {
+	if (plan_len == NCT_PLAN_MAX) {
+		spec_error(0, "plan exceeds %d writes", NCT_PLAN_MAX);
+		return;
+	}
+	struct nct_plan_entry *e = &plan[plan_len++];
+	memset(e, 0, sizeof(*e));
+	e->flag = flag;
+	snprintf(e->name, sizeof(e->name), fmt, index, sub);
+	snprintf(e->value, sizeof(e->value), "%s", value);
+}
+
+static void emit_long(char flag, long v, const char *fmt, int index, int sub) {
+	char buf[24];
+	snprintf(buf, sizeof(buf), "%ld", v);
+	emit(flag, buf, fmt, index, sub);
+}
+
+static void emit_key(const struct pwm_spec *p, enum pwm_key k, char flag, const char *fmt, int n) {
+	if (p->set[k]) {
+		emit_long(flag, p->val[k], fmt, n, 0);
+	}
+}
+
+/*
+ * build_plan() - Expand every header into writes, in PLAN ORDER
+ */
+static void build_plan(void) {
+	static const int enable_value[] = {[MODE_SMARTFAN] = 5, [MODE_CRUISE] = 2, [MODE_MANUAL] = 1};
+
+	for (int n = 1; n <= MAX_PWM; ++n) {
+		const struct pwm_spec *p = &pwms[n];
+		if (p->mode != MODE_KEEP) {
+			emit('!', "0", "pwm%d_enable", n, 0);
+		}
+		for (int i = 0; i < p->npts; ++i) {
+			emit_long(' ', (long)p->pt_temp[i] * 1000, "pwm%d_auto_point%d_temp", n, i + 1);
+			emit_long(' ', p->pt_duty[i], "pwm%d_auto_point%d_pwm", n, i + 1);
+		}
+		emit_key(p, K_TARGET, ' ', "pwm%d_target_temp", n);
+		emit_key(p, K_TOLERANCE, ' ', "pwm%d_temp_tolerance", n);
+		emit_key(p, K_START, '?', "pwm%d_start", n);
+		emit_key(p, K_FLOOR, '?', "pwm%d_floor", n);
+		emit_key(p, K_STEP_UP, '?', "pwm%d_step_up_time", n);
+		emit_key(p, K_STEP_DOWN, '?', "pwm%d_step_down_time", n);
+		emit_key(p, K_STOP, '?', "pwm%d_stop_time", n);
+		emit_key(p, K_WEIGHT_SEL, ' ', "pwm%d_weight_temp_sel", n);
+		emit_key(p, K_WEIGHT_STEP, '?', "pwm%d_weight_temp_step", n);
+		emit_key(p, K_WEIGHT_BASE, '?', "pwm%d_weight_temp_step_base", n);
+		emit_key(p, K_WEIGHT_DUTY, '?', "pwm%d_weight_duty_step", n);
+		emit_key(p, K_WEIGHT_TOL, '?', "pwm%d_weight_temp_step_tol", n);
+		emit_key(p, K_ELECTRICAL, ' ', "pwm%d_mode", n);
+		if (p->mode != MODE_KEEP) {
+			emit_long(' ', enable_value[p->mode], "pwm%d_enable", n, 0);
+		}
+		emit_key(p, K_DUTY, ' ', "pwm%d", n);
+	}
+	for (int n = 1; n <= MAX_FAN; ++n) {
+		if (fans[n].pulses) {
+			emit_long(' ', fans[n].pulses, "fan%d_pulses", n, 0);
+		}
+	}
+	for (int n = 1; n <= MAX_FAN; ++n) {
+		if (fans[n].min_set) {
+			emit_long(' ', fans[n].min, "fan%d_min", n, 0);
+		}
+	}
+	for (int n = 1; n <= MAX_TEMP; ++n) {
+		for (size_t i = 0; i < sizeof(temp_limits) / sizeof(temp_limits[0]); ++i) {
+			if (temps[n].set[temp_limits[i].k]) {
+				emit_long(' ', temps[n].val[temp_limits[i].k], temp_limits[i].attr, n, 0);
+			}
+		}
+	}
+	for (int n = 0; n <= MAX_IN; ++n) {
+		for (size_t i = 0; i < sizeof(in_limits) / sizeof(in_limits[0]); ++i) {
+			if (ins[n].set[in_limits[i].k]) {
+				emit_long(' ', ins[n].val[in_limits[i].k], in_limits[i].attr, n, 0);
+			}
+		}
+	}
+}
+
+/*
+ * write_plan() - Write the plan atomically: PLAN.tmp, fsync, rename
+ */
+static int write_plan(const char *out, const struct stat *src, const char *src_abs) {
+	struct nct_plan_header hdr = {0};
+	memcpy(hdr.magic, NCT_PLAN_MAGIC, sizeof(hdr.magic));
+	hdr.version = NCT_PLAN_VERSION;
+	hdr.entry_size = sizeof(struct nct_plan_entry);
+	hdr.count = (uint32_t)plan_len;
+	hdr.checksum = nct_plan_checksum(plan, hdr.count);
+	hdr.source_mtime_ns = (int64_t)src->st_mtim.tv_sec * 1000000000 + src->st_mtim.tv_nsec;
+	hdr.source_size = (int64_t)src->st_size;
+	/* A source path too long to record only disables the staleness check */
+	size_t srclen = strlen(src_abs);
+	if (srclen < sizeof(hdr.source)) {
+		memcpy(hdr.source, src_abs, srclen + 1);
+	}
+
+	/* The cache directory is ours; create it (one level) on first compile */
+	char dir[PATH_MAX];
+	snprintf(dir, sizeof(dir), "%s", out);
+	char *slash = strrchr(dir, '/');
+	if (slash && slash != dir) {
+		*slash = '\0';
+		if (mkdir(dir, 0755) < 0 && errno != EEXIST) {
+			fprintf(stderr, "[ERROR] Cannot create %s: %s\n", dir, strerror(errno));
+			return -1;
+		}
+	}
+
+	char tmp[PATH_MAX];
+	snprintf(tmp, sizeof(tmp), "%s.tmp", out);
+	int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		fprintf(stderr, "[ERROR] Cannot create %s: %s\n", tmp, strerror(errno));
+		return -1;
+	}
+	size_t body = (size_t)plan_len * sizeof(plan[0]);
+	bool ok = write(fd, &hdr, sizeof(hdr)) == (ssize_t)sizeof(hdr) &&
+		  write(fd, plan, body) == (ssize_t)body && fsync(fd) == 0;
+	ok = close(fd) == 0 && ok;
+	if (!ok || rename(tmp, out) < 0) {
+		fprintf(stderr, "[ERROR] Cannot write %s: %s\n", out, strerror(errno));
+		unlink(tmp);
+		return -1;
+	}
+	return 0;
+}
+
+static void print_plan(const struct nct_plan_entry *e, int n) {
+	for (int i = 0; i < n; ++i) {
+		printf("%s%s %s\n", e[i].flag == ' ' ? "" : (e[i].flag == '?' ? "?" : "!"), e[i].name, e[i].value);
+	}
+}
+
+static void usage(FILE *out) {
+	fprintf(out,
+		"Usage: nct-profile --compile PROFILE [-o PLAN]\n"
+		"       nct-profile --check PROFILE\n"
+		"       nct-profile --print PROFILE|PLAN\n"
+		"  --compile  validate PROFILE and write its write plan (default %s)\n"
+		"  --check    validate only\n"
+		"  --print    print the plan as an nct-fan text profile\n",
+		NCT_PLAN_PATH);
+}
+
+/*
+ * main() - Entry point
+ * STRATEGY:
+ *   1. --print of an existing plan: read and print it
+ *   2. Otherwise parse the whole profile, run cross-key checks, report
+ *      every error (not just the first), build the plan
+ *   3. --compile writes it atomically; --print prints it
+ */
+int main(int argc, char **argv) {
+	enum { NONE, COMPILE, CHECK, PRINT } action = NONE;
+	const char *out = NCT_PLAN_PATH;
+
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--compile") == 0 && i + 1 < argc) {
+			action = COMPILE;
+			spec_path = argv[++i];
+		} else if (strcmp(argv[i], "--check") == 0 && i + 1 < argc) {
+			action = CHECK;
+			spec_path = argv[++i];
+		} else if (strcmp(argv[i], "--print") == 0 && i + 1 < argc) {
+			action = PRINT;
+			spec_path = argv[++i];
+		} else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+			out = argv[++i];
+		} else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+			usage(stdout);
+			return 0;
+		} else {
+			usage(stderr);
+			return 2;
+		}
+	}
+	if (action == NONE) {
+		usage(stderr);
+		return 2;
+	}
+
+	FILE *in = fopen(spec_path, "re");
+	struct stat st;
+	if (!in || fstat(fileno(in), &st) < 0) {
+		fprintf(stderr, "[ERROR] Cannot open %s: %s\n", spec_path, strerror(errno));
+		return 2;
+	}
+
+	int c = getc(in);
+	ungetc(c, in);
+	if (action == PRINT && c == NCT_PLAN_MAGIC[0]) {
+		struct nct_plan_header hdr;
+		int n = nct_plan_read(in, &hdr, plan, NCT_PLAN_MAX);
+		fclose(in);
+		if (n < 0) {
+			fprintf(stderr, "[ERROR] %s: damaged or incompatible plan\n", spec_path);
+			return 1;
+		}
+		printf("# nct-profile plan compiled from %s\n", hdr.source);
+		print_plan(plan, n);
+		return 0;
+	}
+
+	load_spec(in);
+	fclose(in);
+	for (int n = 1; n <= MAX_PWM; ++n) {
+		check_header(n);
+	}
+	for (int n = 1; n <= MAX_TEMP; ++n) {
+		check_limits(&temps[n], "temp", n);
+	}
+	for (int n = 0; n <= MAX_IN; ++n) {
+		check_limits(&ins[n], "in", n);
+	}
+	if (errors == 0) {
+		build_plan();
+	}
+	if (errors) {
+		fprintf(stderr, "[ERROR] %s: %d error(s); nothing written\n", spec_path, errors);
+		return 1;
+	}
+	if (plan_len == 0) {
+		fprintf(stderr, "[WARN] %s programs nothing\n", spec_path);
+	}
+
+	switch (action) {
+	case PRINT:
+		print_plan(plan, plan_len);
+		return 0;
+	case CHECK:
+		printf("[INFO] %s: valid, %d writes\n", spec_path, plan_len);
+		return 0;
+	default:
+		break;
+	}
+
+	char abs[PATH_MAX];
+	if (!realpath(spec_path, abs)) {
+		snprintf(abs, sizeof(abs), "%s", spec_path);
+	}
+	if (write_plan(out, &st, abs) < 0) {
+		return 2;
+	}
+	printf("[INFO] Compiled %s: %d writes -> %s\n", spec_path, plan_len, out);
+	return 0;
+}
+
+/*
+ * BUILD & DEPLOYMENT NOTES:
+ *
+ * Compilation:
+ *   gcc -std=c23 -O2 -Wall -Wextra -Werror -o nct-profile nct-profile.c
+ *
+ * Installation (in PKGBUILD):
+ *   install -Dm755 nct-profile "$pkgdir/usr/lib/eirikr/nct-profile"
+ *
+ * Callers:
+ *   The user compiles after editing /usr/local/etc/nct-fan-profile.conf
+ *   (and after re-running nct-characterize when it names a model);
+ *   max-fans-restore.service applies /var/cache/eirikr/nct-fan.plan with
+ *   `max-fans-advanced.sh --plan`, which hands it to nct-fan --reconcile.
+ *   nct-alarm.service re-asserts the plan's limit writes before it starts
+ *   waiting on the alarm attributes.
+ */
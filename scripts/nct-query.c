@@ -0,0 +1,666 @@
+/*
+ * nct-query.c - Time-range statistics over the nct-sampler telemetry log
+ *
+ * PURPOSE:
+ *   Answer "how hot did the CPU get overnight, and how often" from the
+ *   history nct-sampler --log keeps on disk: min, max, mean and exact
+ *   percentiles per channel over any time range, as a table or JSON.
+ *
+ * WHY THIS EXISTS:
+ *   The ring holds minutes; the journal holds text nobody wants to parse
+ *   for a week of 10 Hz samples. The log (nct-log.h) is compact and
+ *   indexed by time, so a query reads only the blocks it needs straight
+ *   from the page cache.
+ *
+ * HOW:
+ *   1. scandir() the log directory; files sort by creation time
+ *   2. mmap() each file read-only and walk its block headers: blocks
+ *      outside [--from, --to] are skipped without touching their payload
+ *   3. If only min/max are asked for, blocks lying wholly inside the range
+ *      are answered from their per-block summary without decoding
+ *   4. Other blocks are checksummed and decoded sample by sample; values
+ *      for percentiles are kept (4 bytes each) and sorted once at the end
+ *   Channels are matched by attribute name (or label) per file, so
+ *   history survives sampler restarts with a different channel table.
+ *
+ * USAGE:
+ *   nct-query [--dir DIR] [--from TIME] [--to TIME] [--channel NAME]...
+ *             [--stats LIST] [--json]
+ *     --dir DIR      Log directory (default /var/lib/eirikr/telemetry)
+ *     --from TIME    Start of the range (default -1h)
+ *     --to TIME      End of the range (default now)
+ *                    TIME: now, -30s / -15m / -6h / -7d (relative to now),
+ *                    @EPOCH seconds, or local "YYYY-mm-dd[ HH:MM[:SS]]"
+ *     --channel NAME Attribute (temp2_input) or label (CPUTIN); repeat
+ *                    for several (default: every channel)
+ *     --stats LIST   Comma-separated: count, min, max, mean, pN with N in
+ *                    0-100, e.g. p99.9 (default min,mean,max,p50,p95,p99)
+ *     --json         One JSON object on stdout instead of a table
+ *
+ *   Values are raw sysfs units (millidegrees, RPM, millivolts, duty 0-255).
+ *   A summary line goes to stderr:
+ *   [INFO] files=N blocks read=N decoded=N summarised=N samples=N
+ *
+ * EXIT CODES:
+ *   0  statistics printed
+ *   1  no samples in the range
+ *   2  usage error or the directory holds no readable log
+ *
+ * SAFETY / CAVEATS:
+ *   - Read-only; runs unprivileged where the log directory is readable
+ *   - Summaries are trusted without a checksum pass (that would mean
+ *     reading the block anyway); a block that fails its checksum when
+ *     decoded ends that file's walk with a warning
+ */
+
+#define _GNU_SOURCE
+#include "nct-log.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_QUERY_CHANNELS 256
+#define MAX_STATS          16
+#define STATS_DEFAULT      "min,mean,max,p50,p95,p99"
+
+enum stat_kind { STAT_COUNT, STAT_MIN, STAT_MAX, STAT_MEAN, STAT_PCT };
+
+struct stat_spec {
+	enum stat_kind kind;
+	double pct;             /* STAT_PCT: 0-100 */
+	char name[16];
+};
+
+/*
+ * struct accum - Running statistics of one channel across all files
+ * values[] is only filled when a percentile was asked for
+ */
+struct accum {
+	char name[NCT_LOG_NAME_MAX];
+	char label[NCT_LOG_NAME_MAX];
+	uint64_t count;
+	int64_t sum;
+	int32_t min, max;
+	int32_t *values;
+	size_t nvalues, cap;
+};
+
+struct query {
+	int64_t from_ns, to_ns;
+	struct stat_spec stats[MAX_STATS];
+	int nstats;
+	bool need_values;       /* a percentile was asked for */
+	bool summary_ok;        /* only min/max: fully covered blocks need no decoding */
+	bool all_channels;
+	struct accum acc[MAX_QUERY_CHANNELS];
+	int nacc;
+	uint64_t files, blocks, decoded, summarised, samples;
+	int64_t first_ns, last_ns;
+};
+
+static int64_t realtime_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/*
+ * parse_time() - Parse a --from / --to argument
+ * RETURNS: 0 with *out in CLOCK_REALTIME ns, or -1
+ */
+static int parse_time(const char *s, int64_t now, int64_t *out) {
+	char *end;
+	if (strcmp(s, "now") == 0) {
+		*out = now;
+		return 0;
+	}
+	if (s[0] == '-') {
+		double v = strtod(s + 1, &end);
+		static const struct {
+			char unit;
+			int64_t ns;
+		} units[] = {{'s', 1000000000}, {'m', 60000000000}, {'h', 3600000000000}, {'d', 86400000000000}};
+		for (size_t i = 0; end != s + 1 && v >= 0 && i < sizeof(units) / sizeof(units[0]); ++i) {
+			if (end[0] == units[i].unit && end[1] == '\0') {
+				*out = now - (int64_t)(v * (double)units[i].ns);
+				return 0;
+			}
+		}
+		return -1;
+	}
+	if (s[0] == '@') {
+		double v = strtod(s + 1, &end);
+		if (end == s + 1 || *end) {
+			return -1;
+		}
+		*out = (int64_t)(v * 1e9);
+		return 0;
+	}
+
+	static const char *const formats[] = {"%Y-%m-%d %H:%M:%S", "%Y-%m-%dT%H:%M:%S", "%Y-%m-%d %H:%M",
+					      "%Y-%m-%dT%H:%M", "%Y-%m-%d"};
+	for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); ++i) {
+		struct tm tm = {0};
+		end = strptime(s, formats[i], &tm);
+		if (end && *end == '\0') {
+			tm.tm_isdst = -1;
+			*out = (int64_t)mktime(&tm) * 1000000000;
+			return 0;
+		}
+	}
+	return -1;
+}
+
+/*
+ * parse_stats() - Parse --stats into q->stats
+ * RETURNS: 0, or -1 after printing the offending entry
+ */
+static int parse_stats(struct query *q, const char *list) {
+	char buf[256];
+	snprintf(buf, sizeof(buf), "%s", list);
+	q->nstats = 0;
+	q->need_values = false;
+	q->summary_ok = true;
+	for (char *save, *tok = strtok_r(buf, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+		if (q->nstats == MAX_STATS || strlen(tok) >= sizeof(q->stats[0].name)) {
+			fprintf(stderr, "[ERROR] --stats: too many entries or \"%s\" too long\n", tok);
+			return -1;
+		}
+		struct stat_spec *sp = &q->stats[q->nstats++];
+		snprintf(sp->name, sizeof(sp->name), "%s", tok);
+		if (strcmp(tok, "count") == 0) {
+			sp->kind = STAT_COUNT;
+		} else if (strcmp(tok, "min") == 0) {
+			sp->kind = STAT_MIN;
+		} else if (strcmp(tok, "max") == 0) {
+			sp->kind = STAT_MAX;
+		} else if (strcmp(tok, "mean") == 0) {
+			sp->kind = STAT_MEAN;
+		} else if (tok[0] == 'p') {
+			char *end;
+			sp->kind = STAT_PCT;
+			sp->pct = strtod(tok + 1, &end);
+			if (end == tok + 1 || *end || sp->pct < 0 || sp->pct > 100) {
+				fprintf(stderr, "[ERROR] --stats: \"%s\" is not pN with N in 0-100\n", tok);
+				return -1;
+			}
+			q->need_values = true;
+		} else {
+			fprintf(stderr, "[ERROR] --stats: unknown statistic \"%s\"\n", tok);
+			return -1;
+		}
+		if (sp->kind != STAT_MIN && sp->kind != STAT_MAX) {
+			q->summary_ok = false;
+		}
+	}
+	if (q->nstats == 0) {
+		fprintf(stderr, "[ERROR] --stats is empty\n");
+		return -1;
+	}
+	return 0;
+}
+
+static struct accum *accum_add(struct query *q, const char *name, const char *label) {
+	if (q->nacc == MAX_QUERY_CHANNELS) {
+		return NULL;
+	}
+	struct accum *a = &q->acc[q->nacc++];
+	memset(a, 0, sizeof(*a));
+	snprintf(a->name, sizeof(a->name), "%s", name);
+	snprintf(a->label, sizeof(a->label), "%s", label);
+	a->min = INT32_MAX;
+	a->max = INT32_MIN;
+	return a;
+}
+
+/*
+ * accum_for() - Accumulator for one channel of a file's table
+ * HOW:  Match by attribute name first, then by label (--channel CPUTIN);
+ *       without --channel every channel gets one, created on first sight
+ * RETURNS: accumulator, or NULL if the channel is not queried
+ */
+static struct accum *accum_for(struct query *q, const struct nct_log_channel *ch) {
+	char name[NCT_LOG_NAME_MAX], label[NCT_LOG_NAME_MAX];
+	memcpy(name, ch->name, sizeof(name));
+	memcpy(label, ch->label, sizeof(label));
+	name[sizeof(name) - 1] = label[sizeof(label) - 1] = '\0';
+
+	for (int i = 0; i < q->nacc; ++i) {
+		if (strcmp(q->acc[i].name, name) == 0) {
+			if (!q->acc[i].label[0]) {
+				snprintf(q->acc[i].label, sizeof(q->acc[i].label), "%s", label);
+			}
+			return &q->acc[i];
+		}
+	}
+	for (int i = 0; label[0] && i < q->nacc; ++i) {
+		if (strcmp(q->acc[i].name, label) == 0) {
+			/* --channel gave the label: report under the attribute name */
+			snprintf(q->acc[i].name, sizeof(q->acc[i].name), "%s", name);
+			snprintf(q->acc[i].label, sizeof(q->acc[i].label), "%s", label);
+			return &q->acc[i];
+		}
+	}
+	if (!q->all_channels) {
+		return NULL;
+	}
+	return accum_add(q, name, label);
+}
+
+static int accum_push(struct accum *a, int32_t v) {
+	if (a->nvalues == a->cap) {
+		size_t cap = a->cap ? a->cap * 2 : 4096;
+		int32_t *p = realloc(a->values, cap * sizeof(*p));
+		if (!p) {
+			return -1;
+		}
+		a->values = p;
+		a->cap = cap;
+	}
+	a->values[a->nvalues++] = v;
+	return 0;
+}
+
+static void accum_minmax(struct accum *a, int32_t lo, int32_t hi) {
+	if (lo < a->min) {
+		a->min = lo;
+	}
+	if (hi > a->max) {
+		a->max = hi;
+	}
+}
+
+/*
+ * decode_block() - Feed every in-range sample of one block to its channels
+ * IN:  map[] column -> accumulator (NULL = column not queried)
+ * RETURNS: 0, or -1 on a corrupt block or allocation failure
+ */
+static int decode_block(struct query *q, const struct nct_log_file *f, const struct nct_log_block *b,
+			struct accum *const *map) {
+	if (!nct_log_block_verify(b, f->nchannels)) {
+		return -1;
+	}
+	static struct nct_log_cursor c;
+	nct_log_cursor_init(&c, f, b);
+	int rc;
+	while ((rc = nct_log_cursor_next(&c)) > 0) {
+		if (c.t_ns < q->from_ns || c.t_ns > q->to_ns) {
+			continue;
+		}
+		q->samples++;
+		if (q->first_ns == 0 || c.t_ns < q->first_ns) {
+			q->first_ns = c.t_ns;
+		}
+		if (c.t_ns > q->last_ns) {
+			q->last_ns = c.t_ns;
+		}
+		for (uint32_t i = 0; i < f->nchannels; ++i) {
+			struct accum *a = map[i];
+			int32_t v = c.values[i];
+			if (!a || v == NCT_LOG_INVALID) {
+				continue;
+			}
+			a->count++;
+			a->sum += v;
+			accum_minmax(a, v, v);
+			if (q->need_values && accum_push(a, v) < 0) {
+				return -1;
+			}
+		}
+	}
+	q->decoded++;
+	return rc;
+}
+
+/*
+ * query_file() - Fold one mapped log file into the query
+ * RETURNS: 0, or -1 if the file is not a telemetry log
+ */
+static int query_file(struct query *q, const char *path, const void *map, size_t size) {
+	if (!nct_log_file_ok(map, size)) {
+		fprintf(stderr, "[WARN] %s: not a version %d telemetry log, skipped\n", path, NCT_LOG_VERSION);
+		return -1;
+	}
+	const struct nct_log_file *f = map;
+	struct accum *cols[NCT_LOG_CHANNELS];
+	bool any = false;
+	for (uint32_t i = 0; i < f->nchannels; ++i) {
+		cols[i] = accum_for(q, &f->channels[i]);
+		any |= cols[i] != NULL;
+	}
+	q->files++;
+	if (!any) {
+		return 0;
+	}
+
+	size_t off = f->header_size;
+	const struct nct_log_block *b;
+	while ((b = nct_log_next_block(map, size, &off))) {
+		q->blocks++;
+		if (b->t_last_ns < q->from_ns || b->t_first_ns > q->to_ns) {
+			continue;
+		}
+		if (q->summary_ok && b->t_first_ns >= q->from_ns && b->t_last_ns <= q->to_ns) {
+			const int32_t *lo = nct_log_block_min(b), *hi = nct_log_block_max(b, f->nchannels);
+			for (uint32_t i = 0; i < f->nchannels; ++i) {
+				if (cols[i] && lo[i] != NCT_LOG_INVALID) {
+					accum_minmax(cols[i], lo[i], hi[i]);
+				}
+			}
+			q->samples += b->nsamples;
+			if (q->first_ns == 0 || b->t_first_ns < q->first_ns) {
+				q->first_ns = b->t_first_ns;
+			}
+			if (b->t_last_ns > q->last_ns) {
+				q->last_ns = b->t_last_ns;
+			}
+			q->summarised++;
+			continue;
+		}
+		if (decode_block(q, f, b, cols) < 0) {
+			fprintf(stderr, "[WARN] %s: block at offset %zu is corrupt or out of memory; rest of file skipped\n",
+				path, off - nct_log_block_size(b, f->nchannels));
+			break;
+		}
+	}
+	return 0;
+}
+
+static bool is_log_name(const char *name) {
+	size_t len = strlen(name);
+	return strncmp(name, "nct-", 4) == 0 && len > 8 && strcmp(name + len - 4, ".log") == 0;
+}
+
+static int log_filter(const struct dirent *d) {
+	return is_log_name(d->d_name);
+}
+
+/*
+ * query_dir() - Run the query over every log file in dir, oldest first
+ * RETURNS: number of readable log files, or -1 if dir cannot be listed
+ */
+static int query_dir(struct query *q, const char *dir) {
+	struct dirent **names;
+	int n = scandir(dir, &names, log_filter, alphasort);
+	if (n < 0) {
+		fprintf(stderr, "[ERROR] Cannot list %s: %s\n", dir, strerror(errno));
+		return -1;
+	}
+	int readable = 0;
+	for (int i = 0; i < n; ++i) {
+		char path[4096];
+		snprintf(path, sizeof(path), "%s/%s", dir, names[i]->d_name);
+		free(names[i]);
+
+		int fd = open(path, O_RDONLY | O_CLOEXEC);
+		struct stat st;
+		if (fd < 0 || fstat(fd, &st) < 0) {
+			fprintf(stderr, "[WARN] %s: %s\n", path, strerror(errno));
+			if (fd >= 0) {
+				close(fd);
+			}
+			continue;
+		}
+		if (st.st_size == 0) {
+			close(fd);
+			continue;
+		}
+		void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+		close(fd);
+		if (map == MAP_FAILED) {
+			fprintf(stderr, "[WARN] %s: mmap: %s\n", path, strerror(errno));
+			continue;
+		}
+		if (query_file(q, path, map, (size_t)st.st_size) == 0) {
+			readable++;
+		}
+		munmap(map, (size_t)st.st_size);
+	}
+	free(names);
+	return readable;
+}
+
+static int cmp_i32(const void *a, const void *b) {
+	int32_t x = *(const int32_t *)a, y = *(const int32_t *)b;
+	return (x > y) - (x < y);
+}
+
+/* Nearest-rank percentile of the sorted values[] */
+static int32_t percentile(const struct accum *a, double pct) {
+	size_t rank = (size_t)(pct / 100.0 * (double)a->nvalues + 0.999999);
+	if (rank < 1) {
+		rank = 1;
+	}
+	if (rank > a->nvalues) {
+		rank = a->nvalues;
+	}
+	return a->values[rank - 1];
+}
+
+/*
+ * format_stat() - One statistic of one channel as text
+ * RETURNS: false if the statistic has no value (no valid samples)
+ */
+static bool format_stat(const struct query *q, const struct accum *a, const struct stat_spec *sp, char *buf, size_t len) {
+	bool have = q->summary_ok ? a->min <= a->max : a->count > 0;
+	switch (sp->kind) {
+	case STAT_COUNT:
+		snprintf(buf, len, "%llu", (unsigned long long)a->count);
+		return true;
+	case STAT_MIN:
+		snprintf(buf, len, "%d", a->min);
+		return have;
+	case STAT_MAX:
+		snprintf(buf, len, "%d", a->max);
+		return have;
+	case STAT_MEAN:
+		snprintf(buf, len, "%.1f", have ? (double)a->sum / (double)a->count : 0.0);
+		return have;
+	case STAT_PCT:
+		snprintf(buf, len, "%d", have ? percentile(a, sp->pct) : 0);
+		return have;
+	}
+	return false;
+}
+
+static void format_time(int64_t ns, char *buf, size_t len) {
+	time_t sec = (time_t)(ns / 1000000000);
+	struct tm tm;
+	localtime_r(&sec, &tm);
+	strftime(buf, len, "%Y-%m-%d %H:%M:%S", &tm);
+}
+
+static void json_str(FILE *out, const char *s) {
+	if (!s || !*s) {
+		fputs("null", out);
+		return;
+	}
+	fputc('"', out);
+	for (; *s; ++s) {
+		if (*s == '"' || *s == '\\') {
+			fprintf(out, "\\%c", *s);
+		} else if ((unsigned char)*s < 0x20) {
+			fprintf(out, "\\u%04x", (unsigned char)*s);
+		} else {
+			fputc(*s, out);
+		}
+	}
+	fputc('"', out);
+}
+
+static void print_table(const struct query *q) {
+	char from[32], to[32];
+	format_time(q->first_ns, from, sizeof(from));
+	format_time(q->last_ns, to, sizeof(to));
+	printf("# %s .. %s  %llu samples\n", from, to, (unsigned long long)q->samples);
+	printf("%-16s %-12s", "channel", "label");
+	for (int s = 0; s < q->nstats; ++s) {
+		printf(" %10s", q->stats[s].name);
+	}
+	putchar('\n');
+	for (int i = 0; i < q->nacc; ++i) {
+		const struct accum *a = &q->acc[i];
+		printf("%-16s %-12s", a->name, a->label[0] ? a->label : "-");
+		for (int s = 0; s < q->nstats; ++s) {
+			char buf[32];
+			printf(" %10s", format_stat(q, a, &q->stats[s], buf, sizeof(buf)) ? buf : "-");
+		}
+		putchar('\n');
+	}
+}
+
+static void print_json(const struct query *q) {
+	printf("{\"from_ns\":%lld,\"to_ns\":%lld,\"first_ns\":%lld,\"last_ns\":%lld,\"samples\":%llu,\"channels\":[",
+	       (long long)q->from_ns, (long long)q->to_ns, (long long)q->first_ns, (long long)q->last_ns,
+	       (unsigned long long)q->samples);
+	for (int i = 0; i < q->nacc; ++i) {
+		const struct accum *a = &q->acc[i];
+		printf("%s{\"name\":", i ? "," : "");
+		json_str(stdout, a->name);
+		fputs(",\"label\":", stdout);
+		json_str(stdout, a->label);
+		for (int s = 0; s < q->nstats; ++s) {
+			char buf[32];
+			printf(",\"%s\":%s", q->stats[s].name,
+			       format_stat(q, a, &q->stats[s], buf, sizeof(buf)) ? buf : "null");
+		}
+		putchar('}');
+	}
+	puts("]}");
+}
+
+static void usage(FILE *out, const char *prog) {
+	fprintf(out,
+		"Usage: %s [--dir DIR] [--from TIME] [--to TIME] [--channel NAME]... [--stats LIST] [--json]\n"
+		"  --dir DIR      Log directory (default %s)\n"
+		"  --from TIME    Range start (default -1h)\n"
+		"  --to TIME      Range end (default now)\n"
+		"                 TIME: now, -30s/-15m/-6h/-7d, @EPOCH, \"YYYY-mm-dd[ HH:MM[:SS]]\"\n"
+		"  --channel NAME Attribute or label; repeatable (default: all)\n"
+		"  --stats LIST   count,min,max,mean,pN (default %s)\n"
+		"  --json         JSON output\n",
+		prog, NCT_LOG_DIR, STATS_DEFAULT);
+}
+
+int main(int argc, char **argv) {
+	static const struct option longopts[] = {
+		{"dir", required_argument, NULL, 'd'},
+		{"from", required_argument, NULL, 'f'},
+		{"to", required_argument, NULL, 't'},
+		{"channel", required_argument, NULL, 'c'},
+		{"stats", required_argument, NULL, 's'},
+		{"json", no_argument, NULL, 'j'},
+		{"help", no_argument, NULL, 'h'},
+		{NULL, 0, NULL, 0},
+	};
+
+	static struct query q;
+	const char *dir = NCT_LOG_DIR, *from = "-1h", *to = "now", *stats = STATS_DEFAULT;
+	bool json = false;
+
+	int opt;
+	while ((opt = getopt_long(argc, argv, "d:f:t:c:s:jh", longopts, NULL)) != -1) {
+		switch (opt) {
+		case 'd':
+			dir = optarg;
+			break;
+		case 'f':
+			from = optarg;
+			break;
+		case 't':
+			to = optarg;
+			break;
+		case 'c':
+			if (strlen(optarg) >= NCT_LOG_NAME_MAX || !accum_add(&q, optarg, "")) {
+				fprintf(stderr, "[ERROR] --channel \"%s\": name too long or too many channels\n", optarg);
+				return 2;
+			}
+			break;
+		case 's':
+			stats = optarg;
+			break;
+		case 'j':
+			json = true;
+			break;
+		case 'h':
+			usage(stdout, argv[0]);
+			return 0;
+		default:
+			usage(stderr, argv[0]);
+			return 2;
+		}
+	}
+
+	int64_t now = realtime_ns();
+	if (parse_time(from, now, &q.from_ns) < 0 || parse_time(to, now, &q.to_ns) < 0) {
+		fprintf(stderr, "[ERROR] Cannot parse --from \"%s\" / --to \"%s\"\n", from, to);
+		return 2;
+	}
+	if (q.from_ns > q.to_ns) {
+		fprintf(stderr, "[ERROR] --from is after --to\n");
+		return 2;
+	}
+	if (parse_stats(&q, stats) < 0) {
+		return 2;
+	}
+	q.all_channels = q.nacc == 0;
+
+	int readable = query_dir(&q, dir);
+	if (readable < 0) {
+		return 2;
+	}
+	fprintf(stderr, "[INFO] files=%llu blocks read=%llu decoded=%llu summarised=%llu samples=%llu\n",
+		(unsigned long long)q.files, (unsigned long long)q.blocks, (unsigned long long)q.decoded,
+		(unsigned long long)q.summarised, (unsigned long long)q.samples);
+	if (readable == 0) {
+		fprintf(stderr, "[ERROR] No telemetry log in %s (run nct-sampler --log %s)\n", dir, dir);
+		return 2;
+	}
+	if (q.samples == 0) {
+		fprintf(stderr, "[INFO] No samples between --from and --to\n");
+		return 1;
+	}
+
+	for (int i = 0; i < q.nacc; ++i) {
+		if (q.acc[i].values) {
+			qsort(q.acc[i].values, q.acc[i].nvalues, sizeof(int32_t), cmp_i32);
+		}
+	}
+	if (json) {
+		print_json(&q);
+	} else {
+		print_table(&q);
+	}
+	for (int i = 0; i < q.nacc; ++i) {
+		free(q.acc[i].values);
+	}
+	return 0;
+}
+
+/*
+ * BUILD & DEPLOYMENT NOTES:
+ *
+ * Compilation (header-only reader, no other objects):
+ *   gcc -std=c23 -O2 -Wall -Wextra -Werror -o nct-query nct-query.c
+ *
+ * Installation (in PKGBUILD):
+ *   install -Dm755 nct-query "$pkgdir/usr/lib/eirikr/nct-query"
+ *
+ * Cost model:
+ *   Walking a file's block headers touches one page per ~16 KiB block
+ *   (~4000 page-cache hits for a full 64 MiB file, a few ms). Decoding
+ *   runs at a few hundred MB/s of payload, i.e. a day at 10 Hz (~40 MB)
+ *   in well under a second; min/max-only queries over whole blocks skip
+ *   decoding entirely. Percentiles keep 4 bytes per value and sample:
+ *   ~35 MB per channel-week at 10 Hz.
+ */
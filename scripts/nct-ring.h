@@ -0,0 +1,422 @@
+/*
+ * nct-ring.h - Shared-memory telemetry ring published by nct-sampler
+ *
+ * PURPOSE:
+ *   Fixed binary layout of the /dev/shm ring that nct-sampler writes and
+ *   every other telemetry consumer (metrics agent, dashboard, fan
+ *   controller) reads. This header is self-contained: include it, call
+ *   nct_ring_attach() once, then read samples with plain loads.
+ *
+ * WHY A RING:
+ *   Consumers must not each re-read sysfs. One sampler reads the hardware;
+ *   everybody else maps the result read-only. After attach, reading a
+ *   sample costs zero syscalls.
+ *
+ * LAYOUT (all little-endian, every struct cache-line aligned):
+ *   struct nct_ring_header    magic, geometry, channel table, head counter
+ *   struct nct_ring_slot[N]   N = header.nslots (power of two)
+ *   struct nct_ring_stats     at header.stats_offset (0 = absent): the
+ *                             sampler's own latency histograms (nct-stats.h)
+ *   struct nct_ring_rollups   at header.rollup_offset (0 = absent), then
+ *                             each level's buckets: per-channel min / max /
+ *                             sum / count / last over 1 s, 1 min and 1 h
+ *
+ *   Sample number s (0, 1, 2, ...) lives in slot s & (nslots - 1).
+ *   header.head is the number of samples published so far; the newest
+ *   sample is head - 1.
+ *
+ * CONCURRENCY (single writer, any number of readers, per-slot seqlock):
+ *   Writer:  slot.seq++ (odd) -> write seqno/t_ns/values -> slot.seq++
+ *            (even) -> head = seqno + 1
+ *   Reader:  s1 = seq (acquire); odd -> retry; copy; s2 = seq; s1 != s2
+ *            -> retry. A copied slot whose seqno differs from the one
+ *            requested was overwritten by a writer that lapped the reader.
+ *   The stats block uses the same seqlock, rewritten once per sample.
+ *   Each rollup bucket has its own seqlock and is updated in place by
+ *   every sample that falls into it; level.head counts buckets started,
+ *   so bucket b (0, 1, 2, ...) lives in slot b % nbuckets, the open one
+ *   is head - 1 and the newest complete one head - 2.
+ *   Readers give up after NCT_RING_SPIN_MAX retries with -EAGAIN: a
+ *   writer killed between its two seq increments leaves the slot odd
+ *   forever, and a reader must not spin on it at 100% CPU.
+ *   Readers never write to the mapping, so it is mapped PROT_READ.
+ *
+ * LIFETIME:
+ *   header.writer_pid is the sampler's pid while it runs and 0 after a
+ *   clean exit. A restarted sampler replaces the file (rename(2)), so a
+ *   reader seeing writer_pid == 0 or a stalled head should re-attach.
+ */
+
+#ifndef NCT_RING_H
+#define NCT_RING_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "nct-stats.h"
+
+#define NCT_RING_PATH         "/dev/shm/nct-telemetry"
+#define NCT_RING_MAGIC        0x474E495254434EULL   /* "NCTRING\0" */
+#define NCT_RING_VERSION      1
+#define NCT_RING_CACHELINE    64
+#define NCT_RING_CHANNELS     96
+#define NCT_RING_NAME_MAX     32
+#define NCT_RING_SLOTS        1024                  /* 20 s at 50 Hz */
+#define NCT_RING_INVALID      INT32_MIN             /* channel read failed */
+#define NCT_RING_ROLLUP_LEVELS 3                    /* 1 s, 1 min, 1 h */
+#define NCT_RING_SPIN_MAX     (1u << 20)            /* seqlock retries, ~ms; writer holds us */
+
+/* Channel kinds; numerically identical to enum hwmon_kind */
+enum nct_ring_kind {
+	NCT_RING_TEMP,          /* millidegrees C */
+	NCT_RING_FAN,           /* RPM */
+	NCT_RING_IN,            /* millivolts */
+	NCT_RING_PWM,           /* duty 0-255 */
+	NCT_RING_PWM_ENABLE,    /* mode 0/1/2/3/5 */
+};
+
+struct nct_ring_channel {
+	char name[NCT_RING_NAME_MAX];   /* sysfs attribute, e.g. "temp1_input";
+					   "k10temp/temp1_input" for nct-sampler --device */
+	char label[NCT_RING_NAME_MAX];  /* tempN_label etc., "" if the driver has none */
+	uint8_t kind;                   /* enum nct_ring_kind */
+	uint8_t index;                  /* N in tempN_input / pwmN */
+	uint8_t reserved[2];
+};
+
+struct nct_ring_header {
+	alignas(NCT_RING_CACHELINE) uint64_t magic;
+	uint32_t version;
+	uint32_t header_size;           /* sizeof(struct nct_ring_header) */
+	uint32_t slot_size;             /* sizeof(struct nct_ring_slot) */
+	uint32_t nslots;
+	uint32_t nchannels;             /* valid entries in channels[] */
+	uint32_t rate_hz;
+	_Atomic uint32_t writer_pid;    /* 0 once the writer has exited */
+	uint32_t stats_offset;          /* struct nct_ring_stats; 0 = none */
+	uint32_t rollup_offset;         /* struct nct_ring_rollups; 0 = none */
+
+	/* Own cache line: the only header field written per sample */
+	alignas(NCT_RING_CACHELINE) _Atomic uint64_t head;
+
+	alignas(NCT_RING_CACHELINE) struct nct_ring_channel channels[NCT_RING_CHANNELS];
+};
+
+struct nct_ring_slot {
+	alignas(NCT_RING_CACHELINE) _Atomic uint32_t seq;   /* odd while being written */
+	uint32_t nvalues;
+	uint64_t seqno;                 /* sample number stored in this slot */
+	uint64_t t_ns;                  /* CLOCK_MONOTONIC at sample start */
+	int32_t values[NCT_RING_CHANNELS];
+};
+
+/*
+ * struct nct_ring_stats - Sampler instrumentation, after the last slot
+ * WHY: A slow sampler loop can be diagnosed from outside (nct-exporter
+ *      renders it as histograms) without restarting it with --stats
+ */
+struct nct_ring_stats {
+	alignas(NCT_RING_CACHELINE) _Atomic uint32_t seq;   /* odd while being written */
+	uint32_t reserved;
+	struct nct_stats stats;
+};
+
+/*
+ * Rollups - Running aggregates per channel at fixed resolutions
+ * WHY: Dashboards and alerts want "max over the last minute", not 20 Hz
+ *      raw samples; the sampler folds each sample into the open bucket of
+ *      every level (O(1) per channel, fixed memory), so readers copy one
+ *      precomputed bucket instead of scanning the ring
+ * BUCKETS: Aligned to multiples of period_ns on the ring's clock
+ *      (CLOCK_MONOTONIC, like slot.t_ns); a bucket with no samples (the
+ *      sampler stalled) is simply never started, so check t_start_ns
+ */
+struct nct_ring_agg {
+	int32_t min;                    /* NCT_RING_INVALID if count == 0 */
+	int32_t max;
+	int32_t last;                   /* newest valid value */
+	uint32_t count;                 /* valid samples folded in */
+	int64_t sum;                    /* mean = sum / count */
+};
+
+struct nct_ring_rollup_bucket {
+	alignas(NCT_RING_CACHELINE) _Atomic uint32_t seq;   /* odd while being written */
+	uint32_t nsamples;              /* samples folded in, valid or not */
+	uint64_t number;                /* bucket number b within its level */
+	uint64_t t_start_ns;            /* bucket covers [t_start_ns, t_start_ns + period_ns) */
+	uint64_t t_last_ns;             /* newest sample folded in */
+	alignas(NCT_RING_CACHELINE) struct nct_ring_agg agg[NCT_RING_CHANNELS];
+};
+
+struct nct_ring_rollup_level {
+	uint64_t period_ns;
+	uint32_t nbuckets;              /* history depth, complete + open */
+	uint32_t buckets_offset;        /* from the ring header */
+	_Atomic uint64_t head;          /* buckets started so far */
+};
+
+struct nct_ring_rollups {
+	alignas(NCT_RING_CACHELINE) uint32_t nlevels;
+	uint32_t bucket_size;           /* sizeof(struct nct_ring_rollup_bucket) */
+	struct nct_ring_rollup_level level[NCT_RING_ROLLUP_LEVELS];
+};
+
+/* Resolution and history per level: 2 min of seconds, 2 h of minutes, 2 days of hours */
+static const struct {
+	uint64_t period_ns;
+	uint32_t nbuckets;
+	const char *name;
+} nct_ring_rollup_spec[NCT_RING_ROLLUP_LEVELS] = {
+	{1000000000ull, 120, "1s"},
+	{60000000000ull, 120, "1m"},
+	{3600000000000ull, 48, "1h"},
+};
+
+_Static_assert(sizeof(struct nct_ring_header) % NCT_RING_CACHELINE == 0, "header must fill whole cache lines");
+_Static_assert(sizeof(struct nct_ring_rollup_bucket) % NCT_RING_CACHELINE == 0, "bucket must fill whole cache lines");
+_Static_assert(sizeof(struct nct_ring_rollups) % NCT_RING_CACHELINE == 0, "rollups must fill whole cache lines");
+_Static_assert(sizeof(struct nct_ring_slot) % NCT_RING_CACHELINE == 0, "slot must fill whole cache lines");
+_Static_assert((NCT_RING_SLOTS & (NCT_RING_SLOTS - 1)) == 0, "slot count must be a power of two");
+
+static inline size_t nct_ring_size(uint32_t nslots) {
+	return sizeof(struct nct_ring_header) + (size_t)nslots * sizeof(struct nct_ring_slot);
+}
+
+/* Ring plus trailing stats block, as nct-sampler creates it */
+static inline size_t nct_ring_size_stats(uint32_t nslots) {
+	return nct_ring_size(nslots) + sizeof(struct nct_ring_stats);
+}
+
+/* Rollup block plus every level's buckets */
+static inline size_t nct_ring_rollups_size(void) {
+	size_t size = sizeof(struct nct_ring_rollups);
+	for (int l = 0; l < NCT_RING_ROLLUP_LEVELS; ++l) {
+		size += nct_ring_rollup_spec[l].nbuckets * sizeof(struct nct_ring_rollup_bucket);
+	}
+	return size;
+}
+
+/* Ring, stats block and rollups, as nct-sampler creates it */
+static inline size_t nct_ring_size_full(uint32_t nslots) {
+	return nct_ring_size_stats(nslots) + nct_ring_rollups_size();
+}
+
+static inline struct nct_ring_slot *nct_ring_slots(const struct nct_ring_header *hdr) {
+	return (struct nct_ring_slot *)((char *)hdr + sizeof(struct nct_ring_header));
+}
+
+/*
+ * struct nct_ring_sample - A reader's private copy of one slot
+ */
+struct nct_ring_sample {
+	uint64_t seqno;
+	uint64_t t_ns;
+	uint32_t nvalues;
+	int32_t values[NCT_RING_CHANNELS];
+};
+
+/*
+ * nct_ring_attach() - Map the ring read-only and validate its header
+ * RETURNS: mapped header, or NULL with errno set (EPROTO = bad magic,
+ *          version or geometry)
+ * NOTE: The only syscalls a consumer ever issues are here and in
+ *       nct_ring_detach()
+ */
+static inline const struct nct_ring_header *nct_ring_attach(const char *path, size_t *size) {
+	/* No O_CLOEXEC: it needs _POSIX_C_SOURCE and the fd is closed below */
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return NULL;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(struct nct_ring_header)) {
+		close(fd);
+		errno = EPROTO;
+		return NULL;
+	}
+
+	void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		return NULL;
+	}
+
+	const struct nct_ring_header *hdr = map;
+	if (hdr->magic != NCT_RING_MAGIC || hdr->version != NCT_RING_VERSION ||
+	    hdr->header_size != sizeof(struct nct_ring_header) ||
+	    hdr->slot_size != sizeof(struct nct_ring_slot) ||
+	    hdr->nslots == 0 || (hdr->nslots & (hdr->nslots - 1)) != 0 ||
+	    hdr->nchannels > NCT_RING_CHANNELS ||
+	    nct_ring_size(hdr->nslots) > (size_t)st.st_size) {
+		munmap(map, (size_t)st.st_size);
+		errno = EPROTO;
+		return NULL;
+	}
+
+	*size = (size_t)st.st_size;
+	return hdr;
+}
+
+static inline void nct_ring_detach(const struct nct_ring_header *hdr, size_t size) {
+	munmap((void *)hdr, size);
+}
+
+static inline uint64_t nct_ring_head(const struct nct_ring_header *hdr) {
+	return atomic_load_explicit(&hdr->head, memory_order_acquire);
+}
+
+/*
+ * nct_ring_read() - Copy sample `seqno` out of the ring
+ * RETURNS: 0 on success
+ *          -EAGAIN   sample not published yet, or the slot stayed
+ *                    mid-update for NCT_RING_SPIN_MAX retries (writer died)
+ *          -ESTALE   sample already overwritten (reader fell behind)
+ */
+static inline int nct_ring_read(const struct nct_ring_header *hdr, uint64_t seqno, struct nct_ring_sample *out) {
+	if (seqno >= nct_ring_head(hdr)) {
+		return -EAGAIN;
+	}
+
+	const struct nct_ring_slot *slot = &nct_ring_slots(hdr)[seqno & (hdr->nslots - 1)];
+	for (uint32_t spin = 0;; ++spin) {
+		if (spin == NCT_RING_SPIN_MAX) {
+			return -EAGAIN;
+		}
+		uint32_t s1 = atomic_load_explicit(&slot->seq, memory_order_acquire);
+		if (s1 & 1) {
+			continue;   /* writer mid-update; it finishes within microseconds */
+		}
+
+		out->seqno = slot->seqno;
+		out->t_ns = slot->t_ns;
+		out->nvalues = slot->nvalues < NCT_RING_CHANNELS ? slot->nvalues : NCT_RING_CHANNELS;
+		memcpy(out->values, slot->values, out->nvalues * sizeof(out->values[0]));
+
+		atomic_thread_fence(memory_order_acquire);
+		if (atomic_load_explicit(&slot->seq, memory_order_relaxed) == s1) {
+			break;
+		}
+	}
+	return out->seqno == seqno ? 0 : -ESTALE;
+}
+
+/*
+ * nct_ring_latest() - Copy the newest published sample
+ * RETURNS: 0 on success, -EAGAIN if nothing has been published yet or
+ *          the newest slot is stuck mid-update (see nct_ring_read())
+ */
+static inline int nct_ring_latest(const struct nct_ring_header *hdr, struct nct_ring_sample *out) {
+	for (;;) {
+		uint64_t head = nct_ring_head(hdr);
+		if (head == 0) {
+			return -EAGAIN;
+		}
+		/* -ESTALE only if the writer lapped us between the two loads */
+		int rc = nct_ring_read(hdr, head - 1, out);
+		if (rc != -ESTALE) {
+			return rc;
+		}
+	}
+}
+
+/*
+ * nct_ring_read_stats() - Copy the sampler's latency histograms
+ * IN:  size as returned by nct_ring_attach()
+ * RETURNS: 0 on success, -ENOENT if the ring carries no stats block,
+ *          -EAGAIN if the block stayed mid-update (writer died)
+ */
+static inline int nct_ring_read_stats(const struct nct_ring_header *hdr, size_t size, struct nct_stats *out) {
+	if (hdr->stats_offset == 0 || (size_t)hdr->stats_offset + sizeof(struct nct_ring_stats) > size ||
+	    hdr->stats_offset % NCT_RING_CACHELINE != 0) {
+		return -ENOENT;
+	}
+
+	const struct nct_ring_stats *rs = (const struct nct_ring_stats *)((const char *)hdr + hdr->stats_offset);
+	for (uint32_t spin = 0; spin < NCT_RING_SPIN_MAX; ++spin) {
+		uint32_t s1 = atomic_load_explicit(&rs->seq, memory_order_acquire);
+		if (s1 & 1) {
+			continue;
+		}
+		memcpy(out, &rs->stats, sizeof(*out));
+		atomic_thread_fence(memory_order_acquire);
+		if (atomic_load_explicit(&rs->seq, memory_order_relaxed) == s1) {
+			return 0;
+		}
+	}
+	return -EAGAIN;
+}
+
+/*
+ * nct_ring_rollups() - Locate and validate the rollup block
+ * IN:  size as returned by nct_ring_attach()
+ * RETURNS: the block, or NULL if the ring carries none
+ */
+static inline const struct nct_ring_rollups *nct_ring_rollups(const struct nct_ring_header *hdr, size_t size) {
+	if (hdr->rollup_offset == 0 || hdr->rollup_offset % NCT_RING_CACHELINE != 0 ||
+	    (size_t)hdr->rollup_offset + sizeof(struct nct_ring_rollups) > size) {
+		return NULL;
+	}
+	const struct nct_ring_rollups *r = (const struct nct_ring_rollups *)((const char *)hdr + hdr->rollup_offset);
+	if (r->nlevels == 0 || r->nlevels > NCT_RING_ROLLUP_LEVELS ||
+	    r->bucket_size != sizeof(struct nct_ring_rollup_bucket)) {
+		return NULL;
+	}
+	for (uint32_t l = 0; l < r->nlevels; ++l) {
+		const struct nct_ring_rollup_level *lv = &r->level[l];
+		if (lv->nbuckets < 2 || lv->period_ns == 0 || lv->buckets_offset % NCT_RING_CACHELINE != 0 ||
+		    (size_t)lv->buckets_offset + (size_t)lv->nbuckets * r->bucket_size > size) {
+			return NULL;
+		}
+	}
+	return r;
+}
+
+/*
+ * nct_ring_read_rollup() - Copy one bucket of one level
+ * IN:  age 0 = the open (still filling) bucket, 1 = the newest complete
+ *      one, up to nbuckets - 1
+ * RETURNS: 0 on success
+ *          -EAGAIN   no such bucket yet (sampler started recently), or
+ *                    it stayed mid-update (writer died)
+ *          -ESTALE   the bucket was recycled while being copied
+ */
+static inline int nct_ring_read_rollup(const struct nct_ring_header *hdr, const struct nct_ring_rollups *r,
+				       uint32_t level, uint32_t age, struct nct_ring_rollup_bucket *out) {
+	const struct nct_ring_rollup_level *lv = &r->level[level];
+	uint64_t head = atomic_load_explicit(&lv->head, memory_order_acquire);
+	if (age >= lv->nbuckets || head <= age) {
+		return -EAGAIN;
+	}
+	uint64_t number = head - 1 - age;
+	const struct nct_ring_rollup_bucket *b = (const struct nct_ring_rollup_bucket *)
+		((const char *)hdr + lv->buckets_offset + (number % lv->nbuckets) * sizeof(*b));
+	for (uint32_t spin = 0;; ++spin) {
+		if (spin == NCT_RING_SPIN_MAX) {
+			return -EAGAIN;
+		}
+		uint32_t s1 = atomic_load_explicit(&b->seq, memory_order_acquire);
+		if (s1 & 1) {
+			continue;
+		}
+		out->nsamples = b->nsamples;
+		out->number = b->number;
+		out->t_start_ns = b->t_start_ns;
+		out->t_last_ns = b->t_last_ns;
+		memcpy(out->agg, b->agg, hdr->nchannels * sizeof(out->agg[0]));
+		atomic_thread_fence(memory_order_acquire);
+		if (atomic_load_explicit(&b->seq, memory_order_relaxed) == s1) {
+			break;
+		}
+	}
+	return out->number == number ? 0 : -ESTALE;
+}
+
+#endif /* NCT_RING_H */
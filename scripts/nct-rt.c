@@ -0,0 +1,144 @@
+/*
+ * nct-rt.c - Periodic timer and real-time mode (see nct-rt.h)
+ */
+
+#define _GNU_SOURCE
+#include "nct-rt.h"
+#include "nct-stats.h"
+
+#include <errno.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+/*
+ * nct_rt_parse_priority() - Validate an --rt[=PRIO] argument
+ * IN:  arg may be NULL (no "=PRIO" given): default priority
+ * RETURNS: 0, or -1 if arg is not 1-99
+ */
+int nct_rt_parse_priority(const char *arg, int *priority) {
+	if (!arg) {
+		*priority = NCT_RT_PRIORITY_DEFAULT;
+		return 0;
+	}
+	char *end;
+	long v = strtol(arg, &end, 10);
+	if (end == arg || *end || v < 1 || v > 99) {
+		return -1;
+	}
+	*priority = (int)v;
+	return 0;
+}
+
+/*
+ * prefault_stack() - Touch NCT_RT_STACK bytes below the current frame
+ * WHY: mlockall(MCL_FUTURE) locks pages as they are faulted in; touching
+ *      them now moves those faults out of the control loop
+ */
+static __attribute__((noinline)) void prefault_stack(void) {
+	volatile unsigned char buf[NCT_RT_STACK];
+	for (size_t i = 0; i < sizeof(buf); i += 4096) {
+		buf[i] = 0;
+	}
+}
+
+/*
+ * nct_rt_enter() - Switch the calling process into real-time mode
+ * IN:    cfg->priority 0 = pin only (--cpu without --rt)
+ * ORDER: affinity and memory before the class change, so the setup work
+ *        itself never runs at RT priority
+ * RETURNS: 0, or -1 with a reason in err
+ */
+int nct_rt_enter(const struct nct_rt_config *cfg, char *err, size_t errlen) {
+	if (cfg->cpu >= CPU_SETSIZE) {
+		snprintf(err, errlen, "CPU %d out of range", cfg->cpu);
+		return -1;
+	}
+	if (cfg->cpu >= 0) {
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(cfg->cpu, &set);
+		if (sched_setaffinity(0, sizeof(set), &set) < 0) {
+			snprintf(err, errlen, "cannot pin to CPU %d: %s", cfg->cpu, strerror(errno));
+			return -1;
+		}
+	}
+
+	if (cfg->priority == 0) {
+		return 0;
+	}
+
+	if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0) {
+		snprintf(err, errlen, "mlockall: %s (raise RLIMIT_MEMLOCK / LimitMEMLOCK=)", strerror(errno));
+		return -1;
+	}
+	prefault_stack();
+
+	struct sched_param sp = {.sched_priority = cfg->priority};
+	if (sched_setscheduler(0, SCHED_FIFO | SCHED_RESET_ON_FORK, &sp) < 0) {
+		snprintf(err, errlen, "SCHED_FIFO priority %d: %s (needs CAP_SYS_NICE or RLIMIT_RTPRIO)",
+			 cfg->priority, strerror(errno));
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * nct_rt_timer_open() - Arm an absolute-deadline periodic timerfd
+ * HOW:  TFD_TIMER_ABSTIME with the first deadline "now": the first expiry
+ *       is immediate and every deadline is now + k * period, so wakeup
+ *       latency can be measured against a known deadline
+ * RETURNS: 0, or -1 with errno set
+ */
+int nct_rt_timer_open(struct nct_rt_timer *t, uint64_t period_ns) {
+	t->fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+	if (t->fd < 0) {
+		return -1;
+	}
+	t->period_ns = period_ns;
+	t->next_ns = nct_stats_begin();
+
+	struct itimerspec its = {
+		.it_interval = {.tv_sec = (time_t)(period_ns / 1000000000), .tv_nsec = (long)(period_ns % 1000000000)},
+		.it_value = {.tv_sec = (time_t)(t->next_ns / 1000000000), .tv_nsec = (long)(t->next_ns % 1000000000)},
+	};
+	if (timerfd_settime(t->fd, TFD_TIMER_ABSTIME, &its, NULL) < 0) {
+		int saved = errno;
+		close(t->fd);
+		t->fd = -1;
+		errno = saved;
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * nct_rt_timer_wait() - Block until the next tick, account its jitter
+ * OUT: *expirations >= 1; more than 1 means ticks were missed
+ * RETURNS: 0, or -1 with errno set (EINTR: a signal arrived first)
+ */
+int nct_rt_timer_wait(struct nct_rt_timer *t, uint64_t *expirations) {
+	uint64_t n;
+	if (read(t->fd, &n, sizeof(n)) != (ssize_t)sizeof(n)) {
+		return -1;
+	}
+	uint64_t now = nct_stats_begin();
+	uint64_t deadline = t->next_ns + (n - 1) * t->period_ns;
+
+	nct_stats_add(NCT_OP_WAKEUP, now > deadline ? now - deadline : 0);
+	nct_stats.deadline_misses += n - 1;
+	t->next_ns += n * t->period_ns;
+	*expirations = n;
+	return 0;
+}
+
+void nct_rt_timer_close(struct nct_rt_timer *t) {
+	if (t->fd >= 0) {
+		close(t->fd);
+		t->fd = -1;
+	}
+}
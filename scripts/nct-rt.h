@@ -0,0 +1,72 @@
+/*
+ * nct-rt.h - Periodic timer with wakeup-jitter accounting, opt-in real-time mode
+ *
+ * PURPOSE:
+ *   Shared tick source for the long-running loops (nct-sampler,
+ *   nct-fanctl): an absolute-deadline CLOCK_MONOTONIC timerfd that records
+ *   how late every wakeup was, plus an opt-in real-time mode (--rt) that
+ *   makes those wakeups hold up on a saturated machine.
+ *
+ * WHY:
+ *   Under full CPU load a SCHED_OTHER loop competes with every build job
+ *   for its time slice: a 100 ms fan tick can run tens of ms late, exactly
+ *   when the fans should react. SCHED_FIFO preempts all fair-class work,
+ *   mlockall() removes page-fault stalls on the hot path, and pinning to a
+ *   housekeeping core keeps the loop off the cores the load saturates.
+ *
+ * JITTER ACCOUNTING (always on, recorded into nct_stats):
+ *   NCT_OP_WAKEUP         now - the deadline of the expiry just consumed,
+ *                         i.e. how long after the timer fired the loop ran
+ *   nct_stats.deadline_misses
+ *                         expiries consumed after the next one was already
+ *                         due: the loop (or its wakeup) took a whole period
+ *   Both reach the sampler's ring stats block, so nct-exporter reports
+ *   them next to the sensor values.
+ *
+ * REAL-TIME MODE (nct_rt_enter(), call once after setup, before the loop):
+ *   1. Pin to cfg->cpu (sched_setaffinity), if >= 0
+ *   2. mlockall(MCL_CURRENT | MCL_FUTURE), then pre-fault NCT_RT_STACK
+ *      bytes of stack so the loop never takes a page fault
+ *   3. SCHED_FIFO at cfg->priority, with SCHED_RESET_ON_FORK so anything
+ *      the process spawns starts in the normal class
+ *   With cfg->priority == 0 (--cpu without --rt) only step 1 runs.
+ *
+ * CAVEATS:
+ *   - Needs CAP_SYS_NICE (or RLIMIT_RTPRIO) and RLIMIT_MEMLOCK (systemd:
+ *     root services have both); failures are reported, never ignored
+ *   - A SCHED_FIFO loop that never sleeps starves its core; both callers
+ *     block in the timerfd read every tick, and the kernel's RT throttling
+ *     (sched_rt_runtime_us) remains the backstop
+ */
+
+#ifndef NCT_RT_H
+#define NCT_RT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define NCT_RT_PRIORITY_DEFAULT 40          /* below threaded IRQ handlers (50) */
+#define NCT_RT_STACK            (64 * 1024) /* pre-faulted stack bytes */
+
+struct nct_rt_config {
+	int priority;   /* SCHED_FIFO priority 1-99; 0 = real-time mode off */
+	int cpu;        /* CPU to pin to; -1 = leave affinity alone */
+};
+
+/*
+ * struct nct_rt_timer - Absolute-deadline periodic timer
+ * next_ns: deadline of the next expiry not yet consumed
+ */
+struct nct_rt_timer {
+	int fd;
+	uint64_t period_ns;
+	uint64_t next_ns;
+};
+
+int nct_rt_parse_priority(const char *arg, int *priority);
+int nct_rt_enter(const struct nct_rt_config *cfg, char *err, size_t errlen);
+int nct_rt_timer_open(struct nct_rt_timer *t, uint64_t period_ns);
+int nct_rt_timer_wait(struct nct_rt_timer *t, uint64_t *expirations);
+void nct_rt_timer_close(struct nct_rt_timer *t);
+
+#endif /* NCT_RT_H */
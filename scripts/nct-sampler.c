@@ -0,0 +1,1062 @@
+/*
+ * nct-sampler.c - Persistent NCT6798D hwmon Telemetry Sampler
+ *
+ * PURPOSE:
+ *   Sample every temperature, fan, voltage and PWM channel of the nct6775
+ *   hwmon device, and optionally of other hwmon devices (k10temp, amdgpu,
+ *   nvme), at a fixed rate (1-50 Hz) from one long-running process.
+ *
+ * WHY THIS EXISTS:
+ *   Every script in scripts/ is one-shot, and verify_and_report() forks a
+ *   `cat` per attribute. At ~40 channels that is ~40 fork+exec+open per
+ *   sample; fine for a human, unusable for continuous telemetry. This
+ *   sampler discovers the hwmon device once, keeps one fd per channel open,
+ *   and re-reads each with a single pread(2) per tick: ~40 syscalls and no
+ *   allocation per sample.
+ *
+ * HOW:
+ *   1. hwmon_resolve() (or --hwmon DIR) locates the nct67xx device, from
+ *      the /run/nct-hwmon.cache entry when it is still valid
+ *   2. hwmon_scan_channels() opens temp*_input, fan*_input, in*_input,
+ *      pwmN and pwmN_enable once, in a stable sorted order
+ *   3. A CLOCK_MONOTONIC timerfd fires at the configured rate; each
+ *      expiry takes one sample: timestamp, then pread every channel
+ *   4. Missed expiries (the process was descheduled) are counted as
+ *      overruns; the sampler never tries to "catch up" with burst reads.
+ *      The timer (nct-rt.h) is absolute-deadline, so each wakeup's lateness
+ *      is recorded too; --rt adds SCHED_FIFO, mlockall and --cpu pinning
+ *   5. --backend isa swaps step 2-3's pread() for direct HWM register reads
+ *      (nct-isa.h): current chip values instead of the driver's cached
+ *      update_interval values, for the controller fast path and benchmarks
+ *   6. With --ring, every sample is also published into a /dev/shm ring
+ *      (layout and reader API in nct-ring.h) so other consumers never
+ *      touch sysfs themselves, and folded into the ring's 1 s / 1 min /
+ *      1 h rollups (per-channel min/max/mean/last, O(1) per sample)
+ *   7. With --log DIR, every sample is also appended to a compact on-disk
+ *      history (delta/varint blocks, nct-log.h) that nct-query reads
+ *   8. --device adds other drivers' hwmon devices after the primary chip;
+ *      their channels are named "k10temp/temp1_input" (the nct-fanctl
+ *      source syntax) in stdout, ring and log. --io uring reads all sysfs
+ *      channels of a tick with one io_uring batch (nct-uring.h) instead of
+ *      one pread() each, falling back to pread() where io_uring is
+ *      unavailable; every device's read time is tracked either way
+ *
+ * OUTPUT (stdout, one line per sample, tab separated):
+ *   # t_ns <channel> <channel> ...     header, once
+ *   <CLOCK_MONOTONIC ns> <v> <v> ...   raw sysfs units; '-' = read failed
+ *
+ * USAGE:
+ *   nct-sampler [--rate HZ] [--backend sysfs|isa [--force]] [--hwmon DIR]
+ *               [--device NAME|DIR|all]... [--io pread|uring] [--ring PATH]
+ *               [--log DIR [--log-size MB] [--log-keep N]]
+ *               [--count N] [--quiet] [--stats] [--rt[=PRIO]] [--cpu N]
+ *     --rate HZ    Sample rate, 1-50 (default 10)
+ *     --backend    sysfs (default): hwmon attributes via pread()
+ *                  isa: temp/fan/in registers via base+5/base+6 (root;
+ *                  refused while nct6775 is bound, over ISA or ASUS WMI,
+ *                  or a driver has claimed the HWM ports; --force shares
+ *                  the ports with a bound driver anyway, racing its bank
+ *                  selects); --device channels are still read through sysfs
+ *     --hwmon DIR  Skip discovery and sample DIR
+ *     --device X   Also sample hwmon device X: a name (lowest-numbered
+ *                  hwmonN of that name), a directory, or "all" (every
+ *                  device except nct67xx ones). Repeatable; a device that
+ *                  is missing is a warning, not an error
+ *     --io MODE    pread (default): one pread() per channel
+ *                  uring: one io_uring batch per tick; one tick per
+ *                  second is still read with pread() to time each device
+ *     --ring PATH  Publish samples to a shared-memory ring
+ *                  (nct-sampler.service uses /dev/shm/nct-telemetry)
+ *     --log DIR    Append samples to the telemetry log in DIR (created one
+ *                  level deep; e.g. /var/lib/eirikr/telemetry)
+ *     --log-size MB  Rotate log files at MB (default 64)
+ *     --log-keep N   Keep the newest N files, delete older ones (default 32)
+ *     --count N    Stop after N samples (default: run until SIGINT/SIGTERM)
+ *     --quiet      Do not print samples (summary only)
+ *     --stats      Also print the nct-stats.h latency histograms on exit
+ *                  (per-channel sysfs_read or port_io/lock_wait, sample,
+ *                  wakeup) and the deadline miss count
+ *     --rt[=PRIO]  Real-time mode: SCHED_FIFO at PRIO (default 40), memory
+ *                  locked and pre-faulted (root or CAP_SYS_NICE)
+ *     --cpu N      Pin to CPU N (a housekeeping core), with or without --rt
+ *
+ *   On exit a summary goes to stderr, then one line per device:
+ *   [INFO] samples=N overruns=N read_errors=N sample_ns avg=N max=N wakeup_ns max=N
+ *   [INFO] device KEY: channels=N read_ns avg=N p99<=N max=N per_channel=N
+ *   With --ring the same histograms are republished after every sample in
+ *   the ring's stats block (nct_ring_read_stats(), nct-exporter), and the
+ *   rollups are read with nct_ring_read_rollup()
+ *
+ * SAFETY / CAVEATS:
+ *   - Read-only; the sysfs backend uses only the kernel interface and runs
+ *     unprivileged (hwmon inputs are world-readable)
+ *   - The isa backend only reads sensor registers; the bank select it
+ *     touches is restored after every sample (see nct-isa.h LOCKING)
+ *   - Channels that appear after startup (module reload) are not picked up;
+ *     restart the sampler
+ *   - The ring and log carry the first NCT_RING_CHANNELS channels, primary
+ *     chip first; --device channels past that are sampled for stdout only
+ */
+
+#define _GNU_SOURCE
+#include "nct-hwmon.h"
+#include "nct-isa.h"
+#include "nct-log.h"
+#include "nct-ring.h"
+#include "nct-rt.h"
+#include "nct-stats.h"
+#include "nct-uring.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * Limits
+ * WHY 256: NCT6798D exposes ~40 sampled channels; with --device the
+ *          k10temp, amdgpu and NVMe devices of a GPU node add ~60 more.
+ *          The ring and log still carry the first NCT_RING_CHANNELS
+ * WHY PROBE: with --io uring every rate-th tick (once a second) is read
+ *          with pread() device by device instead, which is where the
+ *          per-device read latency comes from (a batch completes as one)
+ */
+#define MAX_CHANNELS 256
+#define MAX_DEVICES  16
+#define RATE_MIN     1
+#define RATE_MAX     50
+#define RATE_DEFAULT 10
+
+#define SAMPLE_INVALID NCT_RING_INVALID
+
+_Static_assert(MAX_CHANNELS >= NCT_RING_CHANNELS, "ring channels must fit the scan table");
+_Static_assert(MAX_CHANNELS <= NCT_URING_FILES_MAX, "every sysfs channel fits one io_uring batch");
+_Static_assert(NCT_RING_NAME_MAX == HWMON_ATTR_MAX, "ring names are copied verbatim from the scan table");
+_Static_assert((int)HWMON_PWM_ENABLE == (int)NCT_RING_PWM_ENABLE, "ring kinds mirror enum hwmon_kind");
+_Static_assert(NCT_LOG_CHANNELS == NCT_RING_CHANNELS, "ring and log carry the same channels");
+_Static_assert(NCT_LOG_NAME_MAX == HWMON_ATTR_MAX, "log names are copied verbatim from the scan table");
+_Static_assert(NCT_LOG_INVALID == SAMPLE_INVALID, "failed reads are logged as they are sampled");
+
+static volatile sig_atomic_t stop_requested;
+
+static void on_signal(int sig) {
+	(void)sig;
+	stop_requested = 1;
+}
+
+/*
+ * struct sampler_stats - Running counters reported at exit
+ * sample_ns: CLOCK_MONOTONIC time spent inside sample_once(), i.e. the
+ *            per-sample cost the sampler adds to the node
+ */
+struct sampler_stats {
+	uint64_t samples;
+	uint64_t overruns;
+	uint64_t read_errors;
+	uint64_t sample_ns_sum;
+	uint64_t sample_ns_max;
+};
+
+static uint64_t clock_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * struct sampler_device - One hwmon device whose channels are sampled
+ * key:  ring/stdout name prefix, "k10temp" -> "k10temp/temp1_input"
+ *       (the nct-fanctl source syntax); "" for the primary nct67xx
+ *       device, whose names stay bare. A second device of the same name
+ *       gets "nvme.1", ...
+ * read: time to read all of its channels in one tick
+ */
+struct sampler_device {
+	char name[HWMON_ATTR_MAX];
+	char key[HWMON_ATTR_MAX];
+	char dir[HWMON_PATH_MAX];
+	char real[HWMON_PATH_MAX];
+	int first;                  /* channels[first .. first + n) */
+	int n;
+	struct nct_hist read;
+};
+
+/*
+ * struct sampler_io - How the channels are read each tick
+ * isa:   the primary device's channels through HWM ports (NULL = sysfs)
+ * uring: channels [uring_first, n) as one io_uring batch (NULL = pread)
+ */
+struct sampler_io {
+	struct isa_backend *isa;
+	struct nct_uring *uring;
+	int uring_first;
+	int probe_every;
+	char (*buf)[NCT_URING_BUF];
+	int32_t *len;
+};
+
+/*
+ * uring_sample() - Read channels [uring_first, n) with one batch
+ * RETURNS: 0, or -errno if the batch could not be submitted (the caller
+ *          then reads this tick with pread())
+ */
+static int uring_sample(const struct sampler_io *io, int n, int32_t *values, struct sampler_stats *st) {
+	int rc = nct_uring_read(io->uring, io->len, NULL);
+	if (rc < 0) {
+		return rc;
+	}
+	for (int i = io->uring_first; i < n; ++i) {
+		int j = i - io->uring_first;
+		if (io->len[j] < 0 || hwmon_parse_int(io->buf[j], (size_t)io->len[j], &values[i]) < 0) {
+			values[i] = SAMPLE_INVALID;
+			st->read_errors++;
+		}
+	}
+	return 0;
+}
+
+/*
+ * sample_once() - Take one timestamped sample of every channel
+ * HOW:  Timestamp first, then the primary device through one locked ISA
+ *       access window when io->isa is set, then the sysfs channels: one
+ *       io_uring batch, or one pread() per open fd, timed per device
+ * OUT:  values[i] for ch[i], SAMPLE_INVALID where the read failed
+ * RETURNS: the sample timestamp (CLOCK_MONOTONIC ns)
+ */
+static uint64_t sample_once(const struct hwmon_channel *ch, int n, struct sampler_device *dev, int ndev,
+			    const struct sampler_io *io, int32_t *values, struct sampler_stats *st) {
+	uint64_t t = clock_ns();
+	int d = 0;
+
+	if (io->isa) {
+		if (isa_sample(io->isa, values) < 0) {
+			for (int i = 0; i < dev[0].n; ++i) {
+				values[i] = SAMPLE_INVALID;
+			}
+			st->read_errors += (uint64_t)dev[0].n;
+		}
+		nct_hist_add(&dev[0].read, clock_ns() - t);
+		d = 1;
+	}
+
+	bool batch = io->uring && st->samples % (uint64_t)io->probe_every != 0;
+	if (batch && uring_sample(io, n, values, st) < 0) {
+		batch = false;
+	}
+	for (; !batch && d < ndev; ++d) {
+		uint64_t t0 = clock_ns();
+		for (int i = dev[d].first; i < dev[d].first + dev[d].n; ++i) {
+			if (hwmon_read_int(ch[i].fd, &values[i]) < 0) {
+				values[i] = SAMPLE_INVALID;
+				st->read_errors++;
+			}
+		}
+		nct_hist_add(&dev[d].read, clock_ns() - t0);
+	}
+
+	uint64_t cost = clock_ns() - t;
+	nct_stats_add(NCT_OP_SAMPLE, cost);
+	st->samples++;
+	st->sample_ns_sum += cost;
+	if (cost > st->sample_ns_max) {
+		st->sample_ns_max = cost;
+	}
+	return t;
+}
+
+static void print_header(const struct hwmon_channel *ch, int n) {
+	fputs("# t_ns", stdout);
+	for (int i = 0; i < n; ++i) {
+		printf("\t%s", ch[i].name);
+	}
+	putchar('\n');
+	fflush(stdout);
+}
+
+static void print_sample(uint64_t t, const int32_t *values, int n) {
+	printf("%llu", (unsigned long long)t);
+	for (int i = 0; i < n; ++i) {
+		if (values[i] == SAMPLE_INVALID) {
+			fputs("\t-", stdout);
+		} else {
+			printf("\t%d", values[i]);
+		}
+	}
+	putchar('\n');
+	fflush(stdout);
+}
+
+/*
+ * ring_create() - Build a fresh ring file and atomically move it into place
+ * HOW:  Create PATH.tmp, size and map it, fill header + channel table, then
+ *       rename(2) over PATH so readers never map a half-initialised file
+ * RETURNS: writable mapping, or NULL on failure (errno set)
+ */
+static struct nct_ring_header *ring_create(const char *path, const struct hwmon_channel *ch, int n, int rate) {
+	char tmp[HWMON_PATH_MAX + 8];
+	snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+
+	int fd = open(tmp, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		return NULL;
+	}
+
+	size_t size = nct_ring_size_full(NCT_RING_SLOTS);
+	if (ftruncate(fd, (off_t)size) < 0) {
+		close(fd);
+		unlink(tmp);
+		return NULL;
+	}
+	void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		unlink(tmp);
+		return NULL;
+	}
+
+	struct nct_ring_header *hdr = map;   /* ftruncate zero-filled every slot */
+	hdr->magic = NCT_RING_MAGIC;
+	hdr->version = NCT_RING_VERSION;
+	hdr->header_size = sizeof(struct nct_ring_header);
+	hdr->slot_size = sizeof(struct nct_ring_slot);
+	hdr->nslots = NCT_RING_SLOTS;
+	hdr->nchannels = (uint32_t)n;
+	hdr->rate_hz = (uint32_t)rate;
+	hdr->stats_offset = (uint32_t)nct_ring_size(NCT_RING_SLOTS);
+	hdr->rollup_offset = (uint32_t)nct_ring_size_stats(NCT_RING_SLOTS);
+
+	struct nct_ring_rollups *r = (struct nct_ring_rollups *)((char *)hdr + hdr->rollup_offset);
+	size_t off = hdr->rollup_offset + sizeof(*r);
+	r->nlevels = NCT_RING_ROLLUP_LEVELS;
+	r->bucket_size = sizeof(struct nct_ring_rollup_bucket);
+	for (int l = 0; l < NCT_RING_ROLLUP_LEVELS; ++l) {
+		r->level[l].period_ns = nct_ring_rollup_spec[l].period_ns;
+		r->level[l].nbuckets = nct_ring_rollup_spec[l].nbuckets;
+		r->level[l].buckets_offset = (uint32_t)off;
+		off += nct_ring_rollup_spec[l].nbuckets * sizeof(struct nct_ring_rollup_bucket);
+	}
+	for (int i = 0; i < n; ++i) {
+		memcpy(hdr->channels[i].name, ch[i].name, sizeof(hdr->channels[i].name));
+		memcpy(hdr->channels[i].label, ch[i].label, sizeof(hdr->channels[i].label));
+		hdr->channels[i].kind = (uint8_t)ch[i].kind;
+		hdr->channels[i].index = (uint8_t)ch[i].index;
+	}
+	atomic_store_explicit(&hdr->writer_pid, (uint32_t)getpid(), memory_order_release);
+
+	if (rename(tmp, path) < 0) {
+		munmap(map, size);
+		unlink(tmp);
+		return NULL;
+	}
+	return hdr;
+}
+
+/*
+ * ring_publish() - Store one sample under the slot seqlock, then advance head
+ * COST: a few cache lines of stores (~3 for 40 channels), no syscalls
+ */
+static void ring_publish(struct nct_ring_header *hdr, uint64_t seqno, uint64_t t, const int32_t *values, int n) {
+	struct nct_ring_slot *slot = &nct_ring_slots(hdr)[seqno & (NCT_RING_SLOTS - 1)];
+	uint32_t seq = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+
+	atomic_store_explicit(&slot->seq, seq + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+
+	slot->seqno = seqno;
+	slot->t_ns = t;
+	slot->nvalues = (uint32_t)n;
+	memcpy(slot->values, values, (size_t)n * sizeof(values[0]));
+
+	atomic_store_explicit(&slot->seq, seq + 2, memory_order_release);
+	atomic_store_explicit(&hdr->head, seqno + 1, memory_order_release);
+}
+
+/*
+ * rollup_fold() - Fold one sample into the open bucket of every level
+ * HOW:  A sample past the open bucket's period starts the next bucket
+ *       (reset under its seqlock, then head advances); otherwise it only
+ *       updates the open one in place. The ring memory is the only state
+ * COST: per level one seqlock pair and ~24 bytes of stores per channel
+ */
+static void rollup_fold(struct nct_ring_header *hdr, uint64_t t, const int32_t *values, int n) {
+	struct nct_ring_rollups *r = (struct nct_ring_rollups *)((char *)hdr + hdr->rollup_offset);
+
+	for (uint32_t l = 0; l < r->nlevels; ++l) {
+		struct nct_ring_rollup_level *lv = &r->level[l];
+		struct nct_ring_rollup_bucket *buckets = (struct nct_ring_rollup_bucket *)((char *)hdr + lv->buckets_offset);
+		uint64_t head = atomic_load_explicit(&lv->head, memory_order_relaxed);
+		uint64_t start = t - t % lv->period_ns;
+		struct nct_ring_rollup_bucket *b = head ? &buckets[(head - 1) % lv->nbuckets] : NULL;
+		bool fresh = !b || b->t_start_ns != start;
+		if (fresh) {
+			b = &buckets[head % lv->nbuckets];
+		}
+
+		uint32_t seq = atomic_load_explicit(&b->seq, memory_order_relaxed);
+		atomic_store_explicit(&b->seq, seq + 1, memory_order_relaxed);
+		atomic_thread_fence(memory_order_release);
+
+		if (fresh) {
+			b->number = head;
+			b->t_start_ns = start;
+			b->nsamples = 0;
+			for (int i = 0; i < n; ++i) {
+				b->agg[i] = (struct nct_ring_agg){NCT_RING_INVALID, NCT_RING_INVALID, NCT_RING_INVALID, 0, 0};
+			}
+		}
+		for (int i = 0; i < n; ++i) {
+			struct nct_ring_agg *a = &b->agg[i];
+			int32_t v = values[i];
+			if (v == NCT_RING_INVALID) {
+				continue;
+			}
+			if (a->count == 0 || v < a->min) {
+				a->min = v;
+			}
+			if (a->count == 0 || v > a->max) {
+				a->max = v;
+			}
+			a->last = v;
+			a->sum += v;
+			a->count++;
+		}
+		b->nsamples++;
+		b->t_last_ns = t;
+
+		atomic_store_explicit(&b->seq, seq + 2, memory_order_release);
+		if (fresh) {
+			atomic_store_explicit(&lv->head, head + 1, memory_order_release);
+		}
+	}
+}
+
+/*
+ * ring_publish_stats() - Copy this process's nct_stats into the ring
+ * WHEN: After every sample, so readers see the histograms including the
+ *       sample that just landed; ~2 KiB of stores, no syscalls
+ */
+static void ring_publish_stats(struct nct_ring_header *hdr) {
+	struct nct_ring_stats *rs = (struct nct_ring_stats *)((char *)hdr + hdr->stats_offset);
+	uint32_t seq = atomic_load_explicit(&rs->seq, memory_order_relaxed);
+
+	atomic_store_explicit(&rs->seq, seq + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	memcpy(&rs->stats, &nct_stats, sizeof(rs->stats));
+	atomic_store_explicit(&rs->seq, seq + 2, memory_order_release);
+}
+
+static void ring_close(struct nct_ring_header *hdr) {
+	atomic_store_explicit(&hdr->writer_pid, 0, memory_order_release);
+	munmap(hdr, nct_ring_size_full(NCT_RING_SLOTS));
+}
+
+/*
+ * log_open() - Start the telemetry log with this run's channel table
+ * RETURNS: 0, or -1 after printing the reason
+ */
+static int log_open(struct nct_log_writer *w, const char *dir, const struct hwmon_channel *ch, int n, int rate,
+		    const char *source, uint64_t max_bytes, int keep) {
+	static struct nct_log_channel table[NCT_LOG_CHANNELS];
+	for (int i = 0; i < n; ++i) {
+		memcpy(table[i].name, ch[i].name, sizeof(table[i].name));
+		memcpy(table[i].label, ch[i].label, sizeof(table[i].label));
+		table[i].kind = (uint8_t)ch[i].kind;
+		table[i].index = (uint8_t)ch[i].index;
+	}
+	if (nct_log_open(w, dir, table, (uint32_t)n, (uint32_t)rate, source, max_bytes, keep) < 0) {
+		fprintf(stderr, "[ERROR] Cannot start telemetry log in %s: %s\n", dir, strerror(errno));
+		return -1;
+	}
+	fprintf(stderr, "[INFO] Telemetry log: %s (rotate at %llu MiB, keep %d files)\n", dir,
+		(unsigned long long)(max_bytes >> 20), keep);
+	return 0;
+}
+
+/*
+ * open_sysfs() - Discover (unless given) the hwmon directory and open channels
+ * RETURNS: channel count, or -1 after printing the reason
+ */
+static int open_sysfs(char *hwmon, size_t len, struct hwmon_channel *channels) {
+	if (!hwmon[0]) {
+		struct hwmon_resolution res;
+		if (hwmon_resolve(&res, 0) < 0) {
+			fprintf(stderr, "[ERROR] No %s* hwmon device under %s (is nct6775 loaded?)\n",
+				HWMON_NAME_PREFIX, HWMON_CLASS_PATH);
+			return -1;
+		}
+		snprintf(hwmon, len, "%s", res.hwmon);
+	}
+
+	int dirfd = open(hwmon, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dirfd < 0) {
+		fprintf(stderr, "[ERROR] Cannot open %s: %s\n", hwmon, strerror(errno));
+		return -1;
+	}
+	int nch = hwmon_scan_channels(dirfd, channels, MAX_CHANNELS);
+	close(dirfd);
+	if (nch <= 0) {
+		fprintf(stderr, "[ERROR] No sampleable channels in %s\n", hwmon);
+		return -1;
+	}
+	return nch;
+}
+
+/* hwmonN/name, newline stripped; "" if unreadable */
+static void read_name(const char *dir, char *out, size_t len) {
+	char path[HWMON_PATH_MAX + sizeof("/name")];
+	snprintf(path, sizeof(path), "%s/name", dir);
+	out[0] = '\0';
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return;
+	}
+	ssize_t n = read(fd, out, len - 1);
+	close(fd);
+	out[n > 0 ? n : 0] = '\0';
+	out[strcspn(out, "\n")] = '\0';
+}
+
+/*
+ * add_device() - Register one more hwmon device and open its channels
+ * HOW:  Skip a directory that is already sampled, pick the key (the
+ *       device name, ".N" for the N-th duplicate), hwmon_scan_channels()
+ *       into channels[*nch...], then prefix every name with "key/" so
+ *       ring, log and stdout names stay unique; channels whose prefixed
+ *       name does not fit HWMON_ATTR_MAX are dropped
+ * RETURNS: channels added (0 for a duplicate), or -1 after a warning
+ */
+static int add_device(struct sampler_device *dev, int *ndev, const char *dir, struct hwmon_channel *channels,
+		      int *nch) {
+	char real[PATH_MAX];
+	if (!realpath(dir, real)) {
+		fprintf(stderr, "[WARN] --device %s: %s\n", dir, strerror(errno));
+		return -1;
+	}
+	if (strlen(real) >= HWMON_PATH_MAX) {
+		fprintf(stderr, "[WARN] --device %s: path too long\n", dir);
+		return -1;
+	}
+	int dups = 0;
+	char name[HWMON_ATTR_MAX];
+	read_name(real, name, sizeof(name));
+	for (int i = 0; i < *ndev; ++i) {
+		if (strcmp(dev[i].real, real) == 0) {
+			return 0;
+		}
+		dups += strcmp(dev[i].name, name) == 0;
+	}
+	if (*ndev >= MAX_DEVICES || !name[0]) {
+		fprintf(stderr, "[WARN] --device %s: %s; skipped\n", dir,
+			name[0] ? "too many devices" : "no hwmon name attribute");
+		return -1;
+	}
+
+	char key[2 * HWMON_ATTR_MAX];
+	int klen = dups ? snprintf(key, sizeof(key), "%s.%d", name, dups) : snprintf(key, sizeof(key), "%s", name);
+	if (klen < 0 || klen >= HWMON_ATTR_MAX) {
+		fprintf(stderr, "[WARN] --device %s: name too long; skipped\n", dir);
+		return -1;
+	}
+
+	struct sampler_device *d = &dev[*ndev];
+	memset(d, 0, sizeof(*d));
+	memcpy(d->name, name, sizeof(d->name));
+	memcpy(d->key, key, (size_t)klen + 1);
+	snprintf(d->dir, sizeof(d->dir), "%s", dir);
+	memcpy(d->real, real, strlen(real) + 1);
+
+	int dirfd = open(real, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dirfd < 0) {
+		fprintf(stderr, "[WARN] --device %s: %s\n", dir, strerror(errno));
+		return -1;
+	}
+	struct hwmon_channel *out = channels + *nch;
+	int found = hwmon_scan_channels(dirfd, out, MAX_CHANNELS - *nch);
+	close(dirfd);
+
+	int n = 0;
+	for (int i = 0; i < found; ++i) {
+		char full[2 * HWMON_ATTR_MAX];
+		int len = snprintf(full, sizeof(full), "%s/%s", d->key, out[i].name);
+		if (len < 0 || len >= HWMON_ATTR_MAX) {
+			fprintf(stderr, "[WARN] %s: channel name too long for the ring; skipped\n", full);
+			close(out[i].fd);
+			continue;
+		}
+		out[n] = out[i];
+		memcpy(out[n].name, full, (size_t)len + 1);
+		n++;
+	}
+	if (n <= 0) {
+		fprintf(stderr, "[WARN] --device %s: no sampleable channels\n", dir);
+		return -1;
+	}
+	d->first = *nch;
+	d->n = n;
+	*nch += n;
+	(*ndev)++;
+	fprintf(stderr, "[INFO] Device %s: %d channels from %s\n", d->key, n, real);
+	return n;
+}
+
+/*
+ * add_devices() - Resolve one --device argument
+ * ACCEPTS: "all" (every hwmon device except nct67xx ones), a hwmon name
+ *          (lowest-numbered device of that name, as hwmon_find_by_name()
+ *          picks for nct-fanctl sources) or a directory
+ * WHY WARN, NOT FAIL: one unit file serves nodes with and without a GPU;
+ *          a missing device must not stop the primary chip's telemetry
+ */
+static void add_devices(const char *spec, struct sampler_device *dev, int *ndev, struct hwmon_channel *channels,
+			int *nch) {
+	if (strchr(spec, '/')) {
+		add_device(dev, ndev, spec, channels, nch);
+		return;
+	}
+
+	static struct hwmon_device list[MAX_CHANNELS];
+	int n = hwmon_list_devices(list, MAX_CHANNELS);
+	bool all = strcmp(spec, "all") == 0;
+	bool matched = false;
+	for (int i = 0; i < n; ++i) {
+		if (all ? strncmp(list[i].name, HWMON_NAME_PREFIX, strlen(HWMON_NAME_PREFIX)) == 0
+			: strcmp(list[i].name, spec) != 0) {
+			continue;
+		}
+		matched = true;
+		add_device(dev, ndev, list[i].hwmon, channels, nch);
+		if (!all) {
+			break;
+		}
+	}
+	if (!matched) {
+		fprintf(stderr, "[WARN] --device %s: no such hwmon device under %s\n", spec, HWMON_CLASS_PATH);
+	}
+}
+
+/*
+ * clip_devices() - Shrink the device table after channels were dropped
+ * WHY: the ring and log keep channels [0, nch); devices wholly past it
+ *      are forgotten, the one straddling it is shortened
+ */
+static void clip_devices(struct sampler_device *dev, int *ndev, int nch) {
+	int kept = 0;
+	for (int i = 0; i < *ndev; ++i) {
+		if (dev[i].first >= nch) {
+			continue;
+		}
+		if (dev[i].first + dev[i].n > nch) {
+			dev[i].n = nch - dev[i].first;
+		}
+		kept++;
+	}
+	*ndev = kept;
+}
+
+static void usage(const char *prog) {
+	fprintf(stderr,
+		"Usage: %s [--rate HZ] [--backend sysfs|isa [--force]] [--hwmon DIR] [--device NAME|DIR|all]... [--io pread|uring] [--ring PATH] [--log DIR [--log-size MB] [--log-keep N]] [--count N] [--quiet] [--stats] [--rt[=PRIO]] [--cpu N]\n"
+		"  --rate HZ    Sample rate %d-%d Hz (default %d)\n"
+		"  --backend    sysfs (default) or isa (direct HWM registers, root;\n"
+		"               refused while nct6775 is bound unless --force)\n"
+		"  --hwmon DIR  hwmon directory (default: discover nct67xx)\n"
+		"  --device X   Also sample hwmon device X (k10temp, amdgpu, nvme, a\n"
+		"               directory, or all); repeatable\n"
+		"  --io MODE    pread (default) or uring (one io_uring batch per tick)\n"
+		"  --ring PATH  Publish samples to a shared-memory ring (e.g. %s)\n"
+		"  --log DIR    Append samples to the telemetry log in DIR (e.g. %s)\n"
+		"  --log-size MB  Rotate log files at MB (default %llu)\n"
+		"  --log-keep N   Keep the newest N log files (default %d)\n"
+		"  --count N    Stop after N samples (default: until signalled)\n"
+		"  --quiet      Do not print samples\n"
+		"  --stats      Print per-operation latency histograms on exit\n"
+		"  --rt[=PRIO]  SCHED_FIFO (default priority %d), locked memory\n"
+		"  --cpu N      Pin to CPU N\n",
+		prog, RATE_MIN, RATE_MAX, RATE_DEFAULT, NCT_RING_PATH, NCT_LOG_DIR,
+		(unsigned long long)(NCT_LOG_FILE_BYTES >> 20), NCT_LOG_KEEP, NCT_RT_PRIORITY_DEFAULT);
+}
+
+int main(int argc, char *argv[]) {
+	static const struct option longopts[] = {
+		{"rate", required_argument, NULL, 'r'},
+		{"hwmon", required_argument, NULL, 'H'},
+		{"device", required_argument, NULL, 'd'},
+		{"io", required_argument, NULL, 'i'},
+		{"backend", required_argument, NULL, 'b'},
+		{"ring", required_argument, NULL, 'R'},
+		{"log", required_argument, NULL, 'L'},
+		{"log-size", required_argument, NULL, 'S'},
+		{"log-keep", required_argument, NULL, 'K'},
+		{"count", required_argument, NULL, 'c'},
+		{"quiet", no_argument, NULL, 'q'},
+		{"stats", no_argument, NULL, 's'},
+		{"rt", optional_argument, NULL, 'T'},
+		{"cpu", required_argument, NULL, 'C'},
+		{"force", no_argument, NULL, 'F'},
+		{"help", no_argument, NULL, 'h'},
+		{NULL, 0, NULL, 0},
+	};
+
+	int rate = RATE_DEFAULT;
+	uint64_t count = 0;
+	bool quiet = false;
+	bool show_stats = false;
+	char hwmon[HWMON_PATH_MAX] = "";
+	const char *ring_path = NULL;
+	const char *log_dir = NULL;
+	uint64_t log_bytes = NCT_LOG_FILE_BYTES;
+	int log_keep = NCT_LOG_KEEP;
+	bool use_isa = false;
+	bool force = false;
+	bool use_uring = false;
+	const char *device_spec[MAX_DEVICES];
+	int ndevice_spec = 0;
+	struct nct_rt_config rt = {.priority = 0, .cpu = -1};
+
+	int opt;
+	while ((opt = getopt_long(argc, argv, "r:H:d:i:b:R:L:S:K:c:qsT::C:Fh", longopts, NULL)) != -1) {
+		switch (opt) {
+		case 'r':
+			rate = atoi(optarg);
+			if (rate < RATE_MIN || rate > RATE_MAX) {
+				fprintf(stderr, "[ERROR] --rate must be %d-%d Hz\n", RATE_MIN, RATE_MAX);
+				return 2;
+			}
+			break;
+		case 'H':
+			snprintf(hwmon, sizeof(hwmon), "%s", optarg);
+			break;
+		case 'd':
+			if (ndevice_spec == MAX_DEVICES) {
+				fprintf(stderr, "[ERROR] At most %d --device options\n", MAX_DEVICES);
+				return 2;
+			}
+			device_spec[ndevice_spec++] = optarg;
+			break;
+		case 'i':
+			if (strcmp(optarg, "uring") == 0) {
+				use_uring = true;
+			} else if (strcmp(optarg, "pread") != 0) {
+				fprintf(stderr, "[ERROR] --io must be pread or uring\n");
+				return 2;
+			}
+			break;
+		case 'F':
+			force = true;
+			break;
+		case 'b':
+			if (strcmp(optarg, "isa") == 0) {
+				use_isa = true;
+			} else if (strcmp(optarg, "sysfs") != 0) {
+				fprintf(stderr, "[ERROR] --backend must be sysfs or isa\n");
+				return 2;
+			}
+			break;
+		case 'R':
+			if (strlen(optarg) >= HWMON_PATH_MAX) {
+				fprintf(stderr, "[ERROR] --ring path too long\n");
+				return 2;
+			}
+			ring_path = optarg;
+			break;
+		case 'L':
+			log_dir = optarg;
+			break;
+		case 'S': {
+			long mb = atol(optarg);
+			if (mb < 1 || mb > 4096) {
+				fprintf(stderr, "[ERROR] --log-size must be 1-4096 MB\n");
+				return 2;
+			}
+			log_bytes = (uint64_t)mb << 20;
+			break;
+		}
+		case 'K':
+			log_keep = atoi(optarg);
+			if (log_keep < 1) {
+				fprintf(stderr, "[ERROR] --log-keep must be at least 1\n");
+				return 2;
+			}
+			break;
+		case 'c':
+			count = strtoull(optarg, NULL, 10);
+			break;
+		case 'q':
+			quiet = true;
+			break;
+		case 's':
+			show_stats = true;
+			break;
+		case 'T':
+			if (nct_rt_parse_priority(optarg, &rt.priority) < 0) {
+				fprintf(stderr, "[ERROR] --rt priority must be 1-99\n");
+				return 2;
+			}
+			break;
+		case 'C':
+			rt.cpu = atoi(optarg);
+			if (rt.cpu < 0) {
+				fprintf(stderr, "[ERROR] --cpu must be a CPU number\n");
+				return 2;
+			}
+			break;
+		case 'h':
+			usage(argv[0]);
+			return 0;
+		default:
+			usage(argv[0]);
+			return 2;
+		}
+	}
+
+	static struct hwmon_channel channels[MAX_CHANNELS];
+	static struct isa_backend isa_storage;
+	static struct sampler_device dev[MAX_DEVICES];
+	struct sampler_io io = {.probe_every = rate};
+	int ndev = 1;
+	int nch;
+
+	if (use_isa) {
+		char err[160];
+		if (isa_open(&isa_storage, force ? ISA_OPEN_FORCE : 0, err, sizeof(err)) < 0) {
+			fprintf(stderr, "[ERROR] ISA backend: %s\n", err);
+			return 2;
+		}
+		if (isa_storage.shared_with[0]) {
+			fprintf(stderr, "[WARN] --force: sharing the HWM ports with bound %s; its bank selects "
+				"can interleave with ours\n", isa_storage.shared_with);
+		}
+		io.isa = &isa_storage;
+		nch = isa_channels(io.isa, channels, MAX_CHANNELS);
+		snprintf(hwmon, sizeof(hwmon), "ISA HWM 0x%X (%s rev %u)", io.isa->hwm.base, io.isa->chip->name,
+			 nct_chip_revision(io.isa->devid));
+	} else {
+		nch = open_sysfs(hwmon, sizeof(hwmon), channels);
+		if (nch < 0) {
+			return 2;
+		}
+		char real[PATH_MAX];
+		if (realpath(hwmon, real) && strlen(real) < sizeof(dev[0].real)) {
+			memcpy(dev[0].real, real, strlen(real) + 1);
+		}
+		read_name(hwmon, dev[0].name, sizeof(dev[0].name));
+	}
+	snprintf(dev[0].dir, sizeof(dev[0].dir), "%s", hwmon);
+	dev[0].n = nch;
+	for (int i = 0; i < ndevice_spec; ++i) {
+		add_devices(device_spec[i], dev, &ndev, channels, &nch);
+	}
+
+	if ((ring_path || log_dir) && nch > NCT_RING_CHANNELS) {
+		fprintf(stderr, "[WARN] %d channels found; ring and log carry the first %d\n", nch, NCT_RING_CHANNELS);
+		hwmon_close_channels(channels + NCT_RING_CHANNELS, nch - NCT_RING_CHANNELS);
+		nch = NCT_RING_CHANNELS;
+		clip_devices(dev, &ndev, nch);
+	}
+
+	/*
+	 * After the clip: the batch covers exactly the sysfs channels kept.
+	 * Failing to set up io_uring is not fatal; pread() reads the same fds
+	 */
+	static struct nct_uring uring_storage;
+	static char uring_buf[MAX_CHANNELS][NCT_URING_BUF];
+	static int32_t uring_len[MAX_CHANNELS];
+	io.uring_first = io.isa ? dev[0].n : 0;
+	if (use_uring && nch > io.uring_first) {
+		static int fds[MAX_CHANNELS];
+		for (int i = io.uring_first; i < nch; ++i) {
+			fds[i - io.uring_first] = channels[i].fd;
+		}
+		int rc = nct_uring_open(&uring_storage, fds, (unsigned)(nch - io.uring_first), uring_buf);
+		if (rc < 0) {
+			fprintf(stderr, "[WARN] io_uring unavailable (%s); reading with pread()\n", strerror(-rc));
+		} else {
+			io.uring = &uring_storage;
+			io.buf = uring_buf;
+			io.len = uring_len;
+			fprintf(stderr, "[INFO] Reading %d sysfs channels per tick as one io_uring batch\n",
+				nch - io.uring_first);
+		}
+	}
+
+	struct nct_ring_header *ring = NULL;
+	if (ring_path) {
+		ring = ring_create(ring_path, channels, nch, rate);
+		if (!ring) {
+			fprintf(stderr, "[ERROR] Cannot create ring %s: %s\n", ring_path, strerror(errno));
+			hwmon_close_channels(channels, nch);
+			return 2;
+		}
+	}
+
+	/*
+	 * The log is CLOCK_REALTIME so history spans reboots; converting with
+	 * one offset taken now keeps its timestamps monotonic across NTP
+	 * steps (they stay within a step of wall time for this run)
+	 */
+	static struct nct_log_writer log_storage;
+	struct nct_log_writer *log = NULL;
+	int64_t log_offset_ns = 0;
+	if (log_dir) {
+		if (log_open(&log_storage, log_dir, channels, nch, rate, hwmon, log_bytes, log_keep) < 0) {
+			hwmon_close_channels(channels, nch);
+			return 2;
+		}
+		log = &log_storage;
+		struct timespec real;
+		clock_gettime(CLOCK_REALTIME, &real);
+		log_offset_ns = (int64_t)real.tv_sec * 1000000000 + real.tv_nsec - (int64_t)clock_ns();
+	}
+
+	struct nct_rt_timer timer;
+	if (nct_rt_timer_open(&timer, UINT64_C(1000000000) / (uint64_t)rate) < 0) {
+		fprintf(stderr, "[ERROR] timerfd: %s\n", strerror(errno));
+		if (log) {
+			nct_log_close(log);
+		}
+		hwmon_close_channels(channels, nch);
+		return 2;
+	}
+
+	/* No SA_RESTART: a signal must interrupt the blocking timerfd read */
+	struct sigaction sa = {.sa_handler = on_signal};
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+
+	/* Last setup step: everything above ran in the normal class */
+	if (rt.priority || rt.cpu >= 0) {
+		char err[160];
+		if (nct_rt_enter(&rt, err, sizeof(err)) < 0) {
+			fprintf(stderr, "[ERROR] Real-time mode: %s\n", err);
+			nct_rt_timer_close(&timer);
+			if (log) {
+				nct_log_close(log);
+			}
+			hwmon_close_channels(channels, nch);
+			return 2;
+		}
+		fprintf(stderr, "[INFO] Real-time mode: SCHED_FIFO priority %d, CPU %d (0 / -1 = unchanged)\n",
+			rt.priority, rt.cpu);
+	}
+
+	fprintf(stderr, "[INFO] Sampling %d channels from %s%s at %d Hz\n", nch, hwmon,
+		ndev > 1 ? " and --device" : "", rate);
+	if (!quiet) {
+		print_header(channels, nch);
+	}
+
+	static int32_t values[MAX_CHANNELS];
+	struct sampler_stats st = {0};
+
+	while (!stop_requested && (count == 0 || st.samples < count)) {
+		uint64_t expirations;
+		if (nct_rt_timer_wait(&timer, &expirations) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			fprintf(stderr, "[ERROR] timerfd read: %s\n", strerror(errno));
+			break;
+		}
+		if (expirations > 1) {
+			st.overruns += expirations - 1;
+		}
+
+		uint64_t t = sample_once(channels, nch, dev, ndev, &io, values, &st);
+		if (ring) {
+			ring_publish_stats(ring);
+			ring_publish(ring, st.samples - 1, t, values, nch);
+			rollup_fold(ring, t, values, nch);
+		}
+		if (log && nct_log_append(log, (int64_t)t + log_offset_ns, values) < 0) {
+			/* keep sampling for the ring and stdout; the log resumes on restart */
+			fprintf(stderr, "[WARN] Telemetry log write failed (%s); logging stopped\n", strerror(errno));
+			nct_log_close(log);
+			log = NULL;
+		}
+		if (!quiet) {
+			print_sample(t, values, nch);
+		}
+	}
+
+	fprintf(stderr, "[INFO] samples=%llu overruns=%llu read_errors=%llu sample_ns avg=%llu max=%llu wakeup_ns max=%llu\n",
+		(unsigned long long)st.samples, (unsigned long long)st.overruns,
+		(unsigned long long)st.read_errors,
+		(unsigned long long)(st.samples ? st.sample_ns_sum / st.samples : 0),
+		(unsigned long long)st.sample_ns_max,
+		(unsigned long long)nct_stats.op[NCT_OP_WAKEUP].max_ns);
+	for (int d = 0; d < ndev; ++d) {
+		const struct nct_hist *h = &dev[d].read;
+		uint64_t avg = h->count ? h->sum_ns / h->count : 0;
+		fprintf(stderr, "[INFO] device %s: channels=%d read_ns avg=%llu p99<=%llu max=%llu per_channel=%llu\n",
+			d ? dev[d].key : dev[d].dir, dev[d].n, (unsigned long long)avg,
+			(unsigned long long)nct_hist_percentile(h, 99), (unsigned long long)h->max_ns,
+			(unsigned long long)(dev[d].n ? avg / (uint64_t)dev[d].n : 0));
+	}
+	if (show_stats) {
+		nct_stats_print(stderr, &nct_stats);
+	}
+	if (log) {
+		if (nct_log_close(log) < 0) {
+			fprintf(stderr, "[WARN] Telemetry log: final block lost: %s\n", strerror(errno));
+		}
+		fprintf(stderr, "[INFO] Telemetry log: %llu blocks, %llu bytes (%.1f bytes/sample)\n",
+			(unsigned long long)log->blocks, (unsigned long long)log->bytes,
+			st.samples ? (double)log->bytes / (double)st.samples : 0.0);
+	}
+
+	nct_rt_timer_close(&timer);
+	if (ring) {
+		ring_close(ring);
+	}
+	if (io.uring) {
+		nct_uring_close(io.uring);
+	}
+	hwmon_close_channels(channels, nch);
+	if (io.isa) {
+		isa_close(io.isa);
+	}
+	return 0;
+}
+
+/*
+ * BUILD & DEPLOYMENT NOTES:
+ *
+ * Compilation:
+ *   gcc -std=c23 -O2 -Wall -Wextra -Werror -o nct-sampler \
+ *       nct-sampler.c nct-hwmon.c nct-isa.c nct-sio.c nct-stats.c nct-rt.c nct-log.c \
+ *       nct-uring.c
+ *
+ * Installation (in PKGBUILD):
+ *   install -Dm755 nct-sampler "$pkgdir/usr/lib/eirikr/nct-sampler"
+ *   install -Dm644 nct-ring.h "$pkgdir/usr/include/eirikr/nct-ring.h"
+ *   install -Dm644 nct-stats.h "$pkgdir/usr/include/eirikr/nct-stats.h"
+ *   install -Dm644 nct-log.h "$pkgdir/usr/include/eirikr/nct-log.h"
+ *   nct-sampler.service runs it with --ring /dev/shm/nct-telemetry --quiet
+ *
+ * Cost model:
+ *   One pread() per channel per tick and nothing else: at 10 Hz with ~40
+ *   channels that is ~400 syscalls/s, each served from the nct6775 driver's
+ *   register cache (refreshed at most every ~1 s by the driver itself), so
+ *   sampling faster than the driver update interval only costs syscalls,
+ *   never extra ISA bus traffic. The isa backend instead issues ~80 port
+ *   operations per sample (~100 us) and sees every register change.
+ *   --log adds ~1 us of encoding per sample and one write(2) + fdatasync
+ *   per 16 KiB block (about once a minute at 10 Hz).
+ *   The ring's rollups add ~24 bytes of stores per channel and level per
+ *   sample (~3 KiB at 40 channels) and ~680 KiB of /dev/shm in total.
+ *   --io uring replaces the per-channel syscalls with one io_uring_enter()
+ *   per tick; each read still costs its driver's show() routine, so the
+ *   win scales with the syscall entry cost of the CPU and kernel
+ *   (mitigations). On an eIBRS test VM both modes measured ~1.5 us per
+ *   channel with 60 channels: compare the per_channel= exit lines of both
+ *   modes on the node before switching nct-sampler.service over.
+ */
@@ -0,0 +1,296 @@
+/*
+ * nct-sio.c - Shadowed Super I/O and HWM register access (see nct-sio.h)
+ *
+ * IMPLEMENTATION NOTES:
+ *   - All port I/O funnels through port_out()/port_in() so every access is
+ *     counted in struct port_stats and timed as NCT_OP_PORT_IO
+ *   - Index ports are only rewritten when the latched index differs
+ *   - CR 0x07 and HWM bank select are only rewritten when the target differs
+ *   - hwm_read_many() groups requests by bank so each bank is selected once,
+ *     starting with whichever bank is already selected
+ *   - -DNCT_PORT_SHIM routes the three port primitives to the emulator
+ *     (nct-sio.h); the default build is unchanged
+ */
+
+#define _GNU_SOURCE
+#include "nct-sio.h"
+#include "nct-stats.h"
+
+#include <string.h>
+
+#ifdef NCT_PORT_SHIM
+#define outb(val, port)          nct_shim_outb(val, port)
+#define inb(port)                nct_shim_inb(port)
+#define ioperm(from, num, on)    nct_shim_ioperm(from, num, on)
+#else
+#include <sys/io.h>
+#endif
+
+static inline void port_out(struct port_stats *st, uint16_t port, uint8_t val) {
+	uint64_t t = nct_stats_begin();
+	outb(val, port);
+	nct_stats_end(NCT_OP_PORT_IO, t);
+	st->outb++;
+}
+
+static inline uint8_t port_in(struct port_stats *st, uint16_t port) {
+	uint64_t t = nct_stats_begin();
+	uint8_t val = inb(port);
+	nct_stats_end(NCT_OP_PORT_IO, t);
+	st->inb++;
+	return val;
+}
+
+static int port_grant(uint16_t port, unsigned long num) {
+	uint64_t t = nct_stats_begin();
+	int rc = ioperm(port, num, 1);
+	nct_stats_end(NCT_OP_IOPERM, t);
+	return rc;
+}
+
+/*
+ * sio_open() - Gain port access and enter Extended Function Mode
+ * HOW:  ioperm() index+data, then write 0x87 twice to the index port
+ * RETURNS: 0 on success, -1 if ioperm() failed (ACPI conflict / not root)
+ */
+int sio_open(struct sio_ctx *ctx, uint16_t port) {
+	memset(ctx, 0, sizeof(*ctx));
+	ctx->port = port;
+	ctx->index = -1;
+	ctx->ldn = -1;
+
+	if (port_grant(port, 2)) {
+		return -1;
+	}
+
+	port_out(&ctx->stats, port, 0x87);
+	port_out(&ctx->stats, port, 0x87);
+	return 0;
+}
+
+/*
+ * sio_close() - Exit Extended Function Mode (write 0xAA to the index port)
+ * NOTE: The index latch is meaningless after exit, so shadow state is reset
+ */
+void sio_close(struct sio_ctx *ctx) {
+	port_out(&ctx->stats, ctx->port, 0xAA);
+	ctx->index = -1;
+	ctx->ldn = -1;
+}
+
+static void sio_set_index(struct sio_ctx *ctx, uint8_t reg) {
+	if (ctx->index == reg) {
+		ctx->stats.index_saved++;
+		return;
+	}
+	port_out(&ctx->stats, ctx->port, reg);
+	ctx->index = reg;
+}
+
+uint8_t sio_read(struct sio_ctx *ctx, uint8_t reg) {
+	sio_set_index(ctx, reg);
+	return port_in(&ctx->stats, ctx->port + 1);
+}
+
+void sio_write(struct sio_ctx *ctx, uint8_t reg, uint8_t val) {
+	sio_set_index(ctx, reg);
+	port_out(&ctx->stats, ctx->port + 1, val);
+	if (reg == SIO_REG_LDN) {
+		ctx->ldn = val;
+	}
+}
+
+/*
+ * sio_select_ldn() - Select a logical device unless it is already selected
+ * SAVES: index write + data write (2 port operations) per redundant select
+ */
+void sio_select_ldn(struct sio_ctx *ctx, uint8_t ldn) {
+	if (ctx->ldn == ldn) {
+		ctx->stats.ldn_saved += 2;
+		return;
+	}
+	sio_write(ctx, SIO_REG_LDN, ldn);
+}
+
+/*
+ * sio_probe() - Locate the first Super I/O chip with an enabled HWM device
+ * HOW:  Try 0x2E then 0x4E; read DEVID and the LDN 0x0B base (CR 0x60/61)
+ * RETURNS: 0 with port/devid/base filled, -1 if no port was accessible or
+ *          no chip reported a usable base (0x0000/0xFFFF = disabled)
+ */
+int sio_probe(uint16_t *port, uint16_t *devid, uint16_t *base) {
+	static const uint16_t ports[] = {0x2E, 0x4E};
+
+	for (size_t p = 0; p < sizeof(ports) / sizeof(ports[0]); ++p) {
+		struct sio_ctx sio;
+		if (sio_open(&sio, ports[p])) {
+			continue;
+		}
+		uint16_t id = (uint16_t)(sio_read(&sio, SIO_REG_DEVID_HI) << 8) | sio_read(&sio, SIO_REG_DEVID_LO);
+		sio_select_ldn(&sio, SIO_LDN_HWM);
+		uint16_t ba = (uint16_t)(sio_read(&sio, SIO_REG_BASE_HI) << 8) | sio_read(&sio, SIO_REG_BASE_LO);
+		sio_close(&sio);
+
+		if (id != 0xFFFF && ba != 0 && ba != 0xFFFF) {
+			*port = ports[p];
+			*devid = id;
+			*base = ba;
+			return 0;
+		}
+	}
+	return -1;
+}
+
+static void hwm_set_index(struct hwm_ctx *ctx, uint8_t index) {
+	if (ctx->index == index) {
+		ctx->stats.index_saved++;
+		return;
+	}
+	port_out(&ctx->stats, ctx->base + HWM_INDEX_OFFSET, index);
+	ctx->index = index;
+}
+
+/*
+ * hwm_set_bank() - Select a bank unless it is already selected
+ * NOTE: Register 0x4E is visible from every bank, so accesses to it never
+ *       need a bank switch
+ */
+static void hwm_set_bank(struct hwm_ctx *ctx, uint8_t bank) {
+	if (ctx->bank == bank) {
+		ctx->stats.bank_saved += 2;
+		return;
+	}
+	hwm_set_index(ctx, HWM_REG_BANK);
+	port_out(&ctx->stats, ctx->base + HWM_DATA_OFFSET, bank);
+	ctx->bank = bank;
+}
+
+/*
+ * hwm_open() - Gain access to base+5/base+6 and learn the current bank
+ * WHY read the bank: It seeds the shadow (so the first access in the
+ *     current bank costs nothing extra) and is restored by hwm_close()
+ * RETURNS: 0 on success, -1 if ioperm() failed
+ */
+int hwm_open(struct hwm_ctx *ctx, uint16_t base) {
+	memset(ctx, 0, sizeof(*ctx));
+	ctx->base = base;
+	ctx->index = -1;
+	ctx->bank = -1;
+
+	if (port_grant(base + HWM_INDEX_OFFSET, 2)) {
+		return -1;
+	}
+
+	hwm_resync(ctx);
+	return 0;
+}
+
+/*
+ * hwm_close() - Restore the bank that was selected at hwm_open()
+ * WHY: The kernel nct6775 driver skips its own 0x4E write when it believes
+ *      the bank is unchanged; leaving another bank selected breaks it
+ */
+void hwm_close(struct hwm_ctx *ctx) {
+	if (ctx->bank < 0) {
+		/* Shadow lost: force the write rather than trusting a stale value */
+		hwm_set_index(ctx, HWM_REG_BANK);
+		port_out(&ctx->stats, ctx->base + HWM_DATA_OFFSET, ctx->orig_bank);
+		ctx->bank = ctx->orig_bank;
+		return;
+	}
+	hwm_set_bank(ctx, ctx->orig_bank);
+}
+
+/*
+ * hwm_invalidate() - Forget latched index and bank
+ * WHEN: Another agent may have driven the ports since our last access
+ */
+void hwm_invalidate(struct hwm_ctx *ctx) {
+	ctx->index = -1;
+	ctx->bank = -1;
+}
+
+/*
+ * hwm_resync() - Re-learn the selected bank after another agent had the chip
+ * WHEN: hwm_open(), and at the start of every locked access window; the
+ *       bank read here becomes the bank hwm_close() restores
+ */
+void hwm_resync(struct hwm_ctx *ctx) {
+	hwm_invalidate(ctx);
+	ctx->orig_bank = hwm_read(ctx, HWM_REG_BANK);
+	ctx->bank = ctx->orig_bank;
+}
+
+uint8_t hwm_read(struct hwm_ctx *ctx, uint16_t reg) {
+	uint8_t index = reg & 0xFF;
+	if (index != HWM_REG_BANK) {
+		hwm_set_bank(ctx, reg >> 8);
+	}
+	hwm_set_index(ctx, index);
+	return port_in(&ctx->stats, ctx->base + HWM_DATA_OFFSET);
+}
+
+void hwm_write(struct hwm_ctx *ctx, uint16_t reg, uint8_t val) {
+	uint8_t index = reg & 0xFF;
+	if (index == HWM_REG_BANK) {
+		hwm_set_bank(ctx, val);
+		return;
+	}
+	hwm_set_bank(ctx, reg >> 8);
+	hwm_set_index(ctx, index);
+	port_out(&ctx->stats, ctx->base + HWM_DATA_OFFSET, val);
+}
+
+/*
+ * hwm_read_bank() - Read all 256 registers of one bank
+ * COST: at most 2 (bank) + 256 x 2 port operations
+ */
+void hwm_read_bank(struct hwm_ctx *ctx, uint8_t bank, uint8_t out[HWM_BANK_SIZE]) {
+	for (int index = 0; index < HWM_BANK_SIZE; ++index) {
+		out[index] = hwm_read(ctx, HWM_REG(bank, index));
+	}
+}
+
+/*
+ * hwm_read_many() - Read an arbitrary register list with minimal bank switches
+ * HOW:  Collect the distinct banks (current bank first, then order of first
+ *       appearance), then read each bank's registers in request order
+ * OUT:  out[i] receives the value of regs[i]
+ */
+void hwm_read_many(struct hwm_ctx *ctx, const uint16_t *regs, size_t n, uint8_t *out) {
+	uint8_t banks[256];
+	uint8_t seen[256 / 8] = {0};
+	int nbanks = 0;
+
+	if (ctx->bank >= 0) {
+		banks[nbanks++] = (uint8_t)ctx->bank;
+		seen[ctx->bank / 8] |= (uint8_t)(1u << (ctx->bank % 8));
+	}
+	for (size_t i = 0; i < n; ++i) {
+		uint8_t b = regs[i] >> 8;
+		if (!(seen[b / 8] & (1u << (b % 8)))) {
+			seen[b / 8] |= (uint8_t)(1u << (b % 8));
+			banks[nbanks++] = b;
+		}
+	}
+
+	for (int k = 0; k < nbanks; ++k) {
+		for (size_t i = 0; i < n; ++i) {
+			if ((regs[i] >> 8) == banks[k]) {
+				out[i] = hwm_read(ctx, regs[i]);
+			}
+		}
+	}
+}
+
+uint64_t port_stats_saved(const struct port_stats *st) {
+	return st->index_saved + st->ldn_saved + st->bank_saved;
+}
+
+void port_stats_add(struct port_stats *dst, const struct port_stats *src) {
+	dst->outb += src->outb;
+	dst->inb += src->inb;
+	dst->index_saved += src->index_saved;
+	dst->ldn_saved += src->ldn_saved;
+	dst->bank_saved += src->bank_saved;
+}
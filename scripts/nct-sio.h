@@ -0,0 +1,121 @@
+/*
+ * nct-sio.h - Shadowed Super I/O and HWM register access for Nuvoton NCT67xx
+ *
+ * PURPOSE:
+ *   One register-access layer for every native tool that talks to the chip
+ *   through ISA port I/O (nct-id, the nct-isa sampler backend).
+ *
+ * WHY SHADOWING:
+ *   ISA port I/O costs ~1us per access, so access count dominates full-bank
+ *   dumps and high-rate sampling. Both indexed interfaces latch state:
+ *   - SIO index port (0x2E/0x4E) keeps the last CR number written
+ *   - CR 0x07 keeps the selected logical device
+ *   - HWM index port (base+5) keeps the last HWM index written
+ *   - HWM register 0x4E keeps the selected bank
+ *   The contexts below remember what was last written and skip writes that
+ *   would not change anything. Every skipped port operation is counted.
+ *
+ * REGISTER ADDRESSING:
+ *   HWM registers use the kernel nct6775 16-bit convention:
+ *   (bank << 8) | index, e.g. 0x4C0 = bank 4, index 0xC0.
+ *
+ * SAFETY / CAVEATS:
+ *   - Shadow state is only valid while nobody else drives the same ports.
+ *     The kernel nct6775 driver also caches its bank; hwm_close() restores
+ *     the bank found at hwm_open(). Call hwm_invalidate() whenever another
+ *     agent may have touched the chip (e.g. after releasing a shared lock).
+ *   - Requires root (ioperm(2)); fails cleanly when ACPI reserves the ports.
+ */
+
+#ifndef NCT_SIO_H
+#define NCT_SIO_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define SIO_REG_LDN      0x07   /* Logical device select */
+#define SIO_REG_DEVID_HI 0x20
+#define SIO_REG_DEVID_LO 0x21
+#define SIO_REG_BASE_HI  0x60
+#define SIO_REG_BASE_LO  0x61
+#define SIO_LDN_HWM      0x0B   /* Hardware Monitor logical device */
+
+#define HWM_INDEX_OFFSET 5      /* base+5: HWM index port */
+#define HWM_DATA_OFFSET  6      /* base+6: HWM data port */
+#define HWM_REG_BANK     0x4E   /* bank select, visible in every bank */
+#define HWM_BANK_SIZE    256
+#define HWM_BANKS        16     /* banks 0x0-0xF: superset of the NCT6798D map */
+
+#define HWM_REG(bank, index) ((uint16_t)(((bank) << 8) | (index)))
+
+#ifdef NCT_PORT_SHIM
+/*
+ * Emulator builds (-DNCT_PORT_SHIM, tests/emu/nct-emu-port.c): nct-sio.c
+ * calls these instead of <sys/io.h>, whose outb()/inb() are inline
+ * instructions no LD_PRELOAD can reach. Same argument order as glibc
+ */
+void nct_shim_outb(uint8_t val, uint16_t port);
+uint8_t nct_shim_inb(uint16_t port);
+int nct_shim_ioperm(unsigned long from, unsigned long num, int turn_on);
+#endif
+
+/*
+ * struct port_stats - Port operations issued and avoided
+ * WHAT: outb/inb count what actually hit the bus; *_saved count writes the
+ *       shadow state made unnecessary (one bank switch saved = 2 writes)
+ */
+struct port_stats {
+	uint64_t outb;
+	uint64_t inb;
+	uint64_t index_saved;
+	uint64_t ldn_saved;
+	uint64_t bank_saved;
+};
+
+/*
+ * struct sio_ctx - Super I/O configuration port (0x2E or 0x4E)
+ * index/ldn are -1 when unknown (after open or hwm_invalidate-style reset)
+ */
+struct sio_ctx {
+	uint16_t port;
+	int16_t index;
+	int16_t ldn;
+	struct port_stats stats;
+};
+
+/*
+ * struct hwm_ctx - HWM index/data pair at base+5/base+6
+ * orig_bank: bank found at hwm_open(), restored by hwm_close()
+ */
+struct hwm_ctx {
+	uint16_t base;
+	int16_t index;
+	int16_t bank;
+	uint8_t orig_bank;
+	struct port_stats stats;
+};
+
+/* Super I/O configuration space */
+int sio_open(struct sio_ctx *ctx, uint16_t port);
+void sio_close(struct sio_ctx *ctx);
+uint8_t sio_read(struct sio_ctx *ctx, uint8_t reg);
+void sio_write(struct sio_ctx *ctx, uint8_t reg, uint8_t val);
+void sio_select_ldn(struct sio_ctx *ctx, uint8_t ldn);
+int sio_probe(uint16_t *port, uint16_t *devid, uint16_t *base);
+
+/* HWM register space */
+int hwm_open(struct hwm_ctx *ctx, uint16_t base);
+void hwm_close(struct hwm_ctx *ctx);
+void hwm_invalidate(struct hwm_ctx *ctx);
+void hwm_resync(struct hwm_ctx *ctx);
+uint8_t hwm_read(struct hwm_ctx *ctx, uint16_t reg);
+void hwm_write(struct hwm_ctx *ctx, uint16_t reg, uint8_t val);
+void hwm_read_bank(struct hwm_ctx *ctx, uint8_t bank, uint8_t out[HWM_BANK_SIZE]);
+void hwm_read_many(struct hwm_ctx *ctx, const uint16_t *regs, size_t n, uint8_t *out);
+
+/* Counters */
+uint64_t port_stats_saved(const struct port_stats *st);
+void port_stats_add(struct port_stats *dst, const struct port_stats *src);
+
+#endif /* NCT_SIO_H */
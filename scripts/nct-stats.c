@@ -0,0 +1,117 @@
+/*
+ * nct-stats.c - Per-operation counters and latency histograms (see nct-stats.h)
+ */
+
+#define _GNU_SOURCE
+#include "nct-stats.h"
+
+#include <inttypes.h>
+#include <time.h>
+
+struct nct_stats nct_stats;
+
+uint64_t nct_stats_begin(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+void nct_stats_add(enum nct_op op, uint64_t ns) {
+	nct_hist_add(&nct_stats.op[op], ns);
+}
+
+/* Record into a caller-owned histogram (nct-sampler's per-device read times) */
+void nct_hist_add(struct nct_hist *h, uint64_t ns) {
+	unsigned b = ns > 1 ? 63u - (unsigned)__builtin_clzll(ns) : 0;
+	if (b >= NCT_STATS_BUCKETS) {
+		b = NCT_STATS_BUCKETS - 1;
+	}
+	h->count++;
+	h->sum_ns += ns;
+	if (ns > h->max_ns) {
+		h->max_ns = ns;
+	}
+	h->bucket[b]++;
+}
+
+void nct_stats_end(enum nct_op op, uint64_t begin_ns) {
+	nct_stats_add(op, nct_stats_begin() - begin_ns);
+}
+
+/*
+ * nct_hist_percentile() - Upper bound of the bucket holding percentile pct
+ * WHY bound, not value: log2 buckets only know a latency to within 2x;
+ *      the bound is clamped to max_ns so a tight distribution is not
+ *      over-reported
+ * RETURNS: ns, 0 for an empty histogram
+ */
+uint64_t nct_hist_percentile(const struct nct_hist *h, unsigned pct) {
+	if (h->count == 0) {
+		return 0;
+	}
+	uint64_t rank = (h->count * pct + 99) / 100;
+	uint64_t seen = 0;
+	for (unsigned b = 0; b < NCT_STATS_BUCKETS; ++b) {
+		seen += h->bucket[b];
+		if (seen >= rank) {
+			uint64_t limit = nct_bucket_limit_ns(b);
+			return limit < h->max_ns ? limit : h->max_ns;
+		}
+	}
+	return h->max_ns;
+}
+
+static void print_ns(FILE *out, uint64_t ns) {
+	if (ns >= 10000000000ull) {
+		fprintf(out, "%" PRIu64 "s", ns / UINT64_C(1000000000));
+	} else if (ns >= 10000000) {
+		fprintf(out, "%" PRIu64 "ms", ns / 1000000);
+	} else if (ns >= 10000) {
+		fprintf(out, "%" PRIu64 "us", ns / 1000);
+	} else {
+		fprintf(out, "%" PRIu64 "ns", ns);
+	}
+}
+
+/*
+ * nct_stats_print() - One summary line plus one bucket line per used class
+ * FORMAT:
+ *   latency sysfs_read: count=40 mean=2310ns p50<=4096ns p99<=8192ns max=7203ns
+ *     buckets sysfs_read: <2048ns:3 <4096ns:30 <8192ns:7
+ *   deadline misses: 0                    (periodic loops only)
+ */
+void nct_stats_print(FILE *out, const struct nct_stats *st) {
+	for (int op = 0; op < NCT_OP_COUNT; ++op) {
+		const struct nct_hist *h = &st->op[op];
+		if (h->count == 0) {
+			continue;
+		}
+		const char *name = nct_op_name((enum nct_op)op);
+		fprintf(out, "latency %s: count=%" PRIu64 " mean=", name, h->count);
+		print_ns(out, h->sum_ns / h->count);
+		fputs(" p50<=", out);
+		print_ns(out, nct_hist_percentile(h, 50));
+		fputs(" p99<=", out);
+		print_ns(out, nct_hist_percentile(h, 99));
+		fputs(" max=", out);
+		print_ns(out, h->max_ns);
+		fprintf(out, "\n  buckets %s:", name);
+		for (unsigned b = 0; b < NCT_STATS_BUCKETS; ++b) {
+			if (h->bucket[b] == 0) {
+				continue;
+			}
+			if (b + 1 < NCT_STATS_BUCKETS) {
+				fputs(" <", out);
+				print_ns(out, nct_bucket_limit_ns(b));
+			} else {
+				fputs(" >=", out);
+				print_ns(out, 1ull << b);
+			}
+			fprintf(out, ":%" PRIu64, h->bucket[b]);
+		}
+		fputc('\n', out);
+	}
+	if (st->op[NCT_OP_WAKEUP].count) {
+		fprintf(out, "deadline misses: %" PRIu64 "\n", st->deadline_misses);
+	}
+}
@@ -0,0 +1,95 @@
+/*
+ * nct-stats.h - Per-operation counters and latency histograms
+ *
+ * PURPOSE:
+ *   Tell where the time of a slow profile apply or sampler loop goes:
+ *   ioperm(), port I/O, the HWM user lock, sysfs (including the nct6775
+ *   driver's update lock, which every pread() takes), or ASUS WMI method
+ *   calls, and how late periodic loops wake up. Every native tool
+ *   records into one process-wide struct nct_stats; nct-id, nct-fan,
+ *   nct-sampler and nct-fanctl print it with --stats and nct-sampler also
+ *   publishes it in its shared-memory ring (nct-ring.h).
+ *
+ * HISTOGRAMS:
+ *   Log2 buckets over nanoseconds: bucket b counts latencies in
+ *   [2^b, 2^(b+1)) ns (bucket 0 also holds 0), the last bucket is
+ *   open-ended (>= 2^31 ns, ~2.1 s). Recording one operation is two vDSO
+ *   clock reads, a count-leading-zeros and four increments (~40 ns), small
+ *   next to the ~1 us port access or multi-us sysfs read it measures, so
+ *   instrumentation is always compiled in and always on.
+ *
+ * LAYOUT:
+ *   Plain fixed-size integers, no pointers: the same struct is copied
+ *   verbatim into the ring, so this header stays self-contained for ring
+ *   readers. Readers that only use the types need not link nct-stats.c.
+ *
+ * CAVEATS:
+ *   - Single-threaded tools: the global is updated without atomics
+ */
+
+#ifndef NCT_STATS_H
+#define NCT_STATS_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define NCT_STATS_BUCKETS 32
+
+/*
+ * enum nct_op - Operation classes (append only: the order is part of the ring ABI)
+ */
+enum nct_op {
+	NCT_OP_IOPERM,          /* ioperm() grant in sio_open()/hwm_open() */
+	NCT_OP_PORT_IO,         /* one inb/outb on the SIO or HWM ports */
+	NCT_OP_LOCK_WAIT,       /* flock(HWM_LOCK_PATH) acquisition */
+	NCT_OP_SYSFS_READ,      /* one pread() of an hwmon attribute */
+	NCT_OP_SYSFS_WRITE,     /* one pwrite() of an hwmon attribute */
+	NCT_OP_WMI_CALL,        /* one ASUS WMI method call via acpi_call */
+	NCT_OP_SAMPLE,          /* one complete nct-sampler sample */
+	NCT_OP_APPLY,           /* one complete nct-fan apply / reconcile */
+	NCT_OP_WAKEUP,          /* timer deadline -> loop running (nct-rt.h) */
+	NCT_OP_COUNT,
+};
+
+struct nct_hist {
+	uint64_t count;
+	uint64_t sum_ns;
+	uint64_t max_ns;
+	uint64_t bucket[NCT_STATS_BUCKETS];
+};
+
+struct nct_stats {
+	struct nct_hist op[NCT_OP_COUNT];
+	uint64_t deadline_misses;   /* periodic ticks lost to late wakeups (nct-rt.h) */
+};
+
+static inline const char *nct_op_name(enum nct_op op) {
+	switch (op) {
+	case NCT_OP_IOPERM: return "ioperm";
+	case NCT_OP_PORT_IO: return "port_io";
+	case NCT_OP_LOCK_WAIT: return "lock_wait";
+	case NCT_OP_SYSFS_READ: return "sysfs_read";
+	case NCT_OP_SYSFS_WRITE: return "sysfs_write";
+	case NCT_OP_WMI_CALL: return "wmi_call";
+	case NCT_OP_SAMPLE: return "sample";
+	case NCT_OP_APPLY: return "apply";
+	case NCT_OP_WAKEUP: return "wakeup";
+	default: return "unknown";
+	}
+}
+
+/* Exclusive upper bound of bucket b in ns (UINT64_MAX for the last one) */
+static inline uint64_t nct_bucket_limit_ns(unsigned b) {
+	return b + 1 < NCT_STATS_BUCKETS ? 1ull << (b + 1) : UINT64_MAX;
+}
+
+extern struct nct_stats nct_stats;   /* this process's counters */
+
+uint64_t nct_stats_begin(void);
+void nct_stats_end(enum nct_op op, uint64_t begin_ns);
+void nct_stats_add(enum nct_op op, uint64_t ns);
+void nct_hist_add(struct nct_hist *h, uint64_t ns);
+uint64_t nct_hist_percentile(const struct nct_hist *h, unsigned pct);
+void nct_stats_print(FILE *out, const struct nct_stats *st);
+
+#endif /* NCT_STATS_H */
@@ -0,0 +1,981 @@
+/*
+ * nct-step.c - Step-response capture and analysis for fan ramp timing
+ *
+ * PURPOSE:
+ *   Record temperature, PWM duty and RPM at the backend's highest useful
+ *   rate around a load step (a synthetic all-core load, or a real one
+ *   being watched), then report rise time, overshoot and settling per
+ *   header and suggest pwmN_step_up_time / step_down_time / stop_time.
+ *
+ * WHY THIS EXISTS:
+ *   DEFAULT_STEP_UP_TIME=800, DEFAULT_STEP_DOWN_TIME=1200 and
+ *   DEFAULT_STOP_TIME=3000 in max-fans-advanced.sh are guesses. Too slow a
+ *   ramp lets the CPU heat up before the fans catch up; too fast a ramp
+ *   outruns the fan and the thermal mass and hunts. Both show up directly
+ *   in a step response, which nothing here could record: nct-sampler tops
+ *   out at 50 Hz as text and sysfs only changes once per update_interval.
+ *
+ * HOW:
+ *   --capture TRACE:
+ *     1. Open every temp/fan/pwm channel (sysfs, or --backend isa for
+ *        uncached registers at up to 1 kHz), record the headers' current
+ *        timing attributes
+ *     2. --pre S of baseline, then --load S of one busy process per CPU,
+ *        then recovery until --duration S; --watch records a real load
+ *        instead and marks no edges
+ *     3. One fixed-size record per timerfd tick (nct-trace.h); the load
+ *        edges are written into the header at the end
+ *   --analyse TRACE:
+ *     For each header with a responding duty, on the load-on edge and the
+ *     load-off edge: initial value (median of the 5 s before the edge),
+ *     final value (median of the last 20 % of the phase), delay (10 %),
+ *     rise time (10-90 %), overshoot past the final value and settling
+ *     time (last exit from a +/-5 % band), for the driving temperature,
+ *     the duty and the RPM
+ *
+ * SUGGESTIONS (printed as nct-profile lines, see nct-profile.c):
+ *   step_up_time    duty should cover its rise within half of the
+ *                   temperature's time constant (63 %), so the fans are
+ *                   ahead of the heat: tau / 2 / duty steps. Never faster
+ *                   than the fan follows (the RPM's 90 % point lagging the
+ *                   duty's, spread over the duty steps),
+ *                   and x1.5 of the current value if duty or RPM overshot
+ *                   by more than 10 % (hunting)
+ *   step_down_time  the same on the load-off edge, at least 1.5 x step_up:
+ *                   slow ramp-down is inaudible and damps oscillation
+ *   stop_time       at least the temperature's settling time after the
+ *                   load ends, so a fan is not stopped while the heatsink
+ *                   still sheds heat (1000-30000 ms)
+ *   Heuristics, not a controller design: re-run after changing them.
+ *
+ * USAGE:
+ *   sudo nct-step --capture TRACE [--load S | --watch] [--pre S] [--duration S]
+ *                 [--backend sysfs|isa [--force]] [--rate HZ] [--hwmon DIR] [--rt[=PRIO]] [--cpu N]
+ *   nct-step --analyse TRACE [--temp NAME]
+ *     --rate HZ     sysfs 1-50 (default 20), isa 1-1000 (default 200)
+ *     --load S      synthetic load length (default 60), after --pre (default 10)
+ *     --duration S  whole capture (default pre + load + 60; --watch 300)
+ *     --temp NAME   driving temperature, e.g. temp2_input (default: the
+ *                   channel that rose most across the edge)
+ *
+ * SAFETY / CAVEATS:
+ *   - Read-only on the chip; the load is ordinary busy processes, killed
+ *     on exit, on signal and (PR_SET_PDEATHSIG) if nct-step itself dies
+ *   - The sysfs backend only sees the driver's cache (~1 s steps); rise
+ *     times shorter than a few update intervals need --backend isa, which
+ *     is refused while nct6775 is bound, over ISA or ASUS WMI (see
+ *     nct-isa.h): unload it for the capture (SmartFan keeps running in
+ *     hardware), or --force to race its bank selects
+ *   - Headers in manual mode (pwmN_enable=1) do not respond to a step and
+ *     are reported as such
+ */
+
+#define _GNU_SOURCE
+#include "nct-hwmon.h"
+#include "nct-isa.h"
+#include "nct-rt.h"
+#include "nct-stats.h"
+#include "nct-trace.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/prctl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_CHANNELS      128
+#define MAX_LOAD_PROCS    256
+#define SYSFS_RATE_MAX    50
+#define SYSFS_RATE_DEFAULT 20
+#define ISA_RATE_MAX      1000
+#define ISA_RATE_DEFAULT  200
+#define PRE_DEFAULT       10
+#define LOAD_DEFAULT      60
+#define POST_DEFAULT      60
+#define WATCH_DEFAULT     300
+#define NS_PER_MS         1000000LL
+#define NS_PER_S          1000000000LL
+#define BASELINE_NS       (5 * NS_PER_S)  /* initial value: median of this window */
+#define FINAL_PCT         20              /* final value: median of the phase's last 20 % */
+#define SETTLE_PCT        5
+#define OVERSHOOT_PCT     10              /* above this, the ramp is hunting */
+#define STEP_DETECT_MC    2000            /* watch mode: load edge = baseline + 2 C */
+#define TEMP_OPEN_MC      127000          /* open thermistor input */
+#define STEP_MS_MIN       100
+#define STEP_MS_MAX       25500           /* nct6775 step times: 8-bit x 100 ms */
+#define STOP_MS_MIN       1000
+#define STOP_MS_MAX       30000
+
+_Static_assert(NCT_TRACE_NAME_MAX == HWMON_ATTR_MAX, "trace channel names are hwmon attribute names");
+
+static volatile sig_atomic_t stop_requested;
+
+static void on_signal(int sig) {
+	(void)sig;
+	stop_requested = 1;
+}
+
+/* ------------------------------------------------------------------------ */
+/* Capture                                                                  */
+/* ------------------------------------------------------------------------ */
+
+static pid_t load_pids[MAX_LOAD_PROCS];
+static int nload;
+
+/*
+ * load_start() - One busy process per online CPU
+ * WHY processes, not threads: no -pthread in every build line, and
+ *     PR_SET_PDEATHSIG guarantees the load dies with us
+ */
+static int load_start(void) {
+	long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+	pid_t parent = getpid();
+	if (ncpu < 1) {
+		ncpu = 1;
+	}
+	for (long i = 0; i < ncpu && nload < MAX_LOAD_PROCS; ++i) {
+		pid_t pid = fork();
+		if (pid < 0) {
+			return -1;
+		}
+		if (pid == 0) {
+			prctl(PR_SET_PDEATHSIG, SIGKILL);
+			if (getppid() != parent) {
+				_exit(0);
+			}
+			for (volatile uint64_t x = 0;; x++) {
+			}
+		}
+		load_pids[nload++] = pid;
+	}
+	return nload;
+}
+
+static void load_stop(void) {
+	for (int i = 0; i < nload; ++i) {
+		kill(load_pids[i], SIGKILL);
+	}
+	for (int i = 0; i < nload; ++i) {
+		waitpid(load_pids[i], NULL, 0);
+	}
+	nload = 0;
+}
+
+static void read_timing(const char *hwmon, struct nct_trace_header *h) {
+	static const char *const attr[NCT_TRACE_TIMING_COUNT] = {
+		[NCT_TRACE_STEP_UP] = "step_up_time", [NCT_TRACE_STEP_DOWN] = "step_down_time",
+		[NCT_TRACE_STOP] = "stop_time", [NCT_TRACE_ENABLE] = "enable",
+	};
+	int dirfd = hwmon[0] ? open(hwmon, O_RDONLY | O_DIRECTORY | O_CLOEXEC) : -1;
+
+	for (int n = 0; n < NCT_TRACE_PWM; ++n) {
+		for (int k = 0; k < NCT_TRACE_TIMING_COUNT; ++k) {
+			char name[HWMON_ATTR_MAX];
+			int32_t v = -1;
+			snprintf(name, sizeof(name), "pwm%d_%s", n + 1, attr[k]);
+			int fd = dirfd >= 0 ? openat(dirfd, name, O_RDONLY | O_CLOEXEC) : -1;
+			if (fd >= 0) {
+				if (hwmon_read_int(fd, &v) < 0) {
+					v = -1;
+				}
+				close(fd);
+			}
+			h->timing[n][k] = v;
+		}
+	}
+	if (dirfd >= 0) {
+		close(dirfd);
+	}
+}
+
+static bool traced_kind(enum hwmon_kind kind) {
+	return kind == HWMON_TEMP || kind == HWMON_FAN || kind == HWMON_PWM;
+}
+
+struct capture_opts {
+	const char *path;
+	char hwmon[HWMON_PATH_MAX];
+	bool use_isa, force, watch;
+	int rate, pre_s, load_s, duration_s;
+	struct nct_rt_config rt;
+};
+
+/*
+ * capture() - Record one trace
+ * RETURNS: 0, or 2 (setup or I/O failure)
+ */
+static int capture(struct capture_opts *o) {
+	static struct hwmon_channel all[MAX_CHANNELS];
+	static struct isa_backend isa_storage;
+	struct isa_backend *isa = NULL;
+	static struct nct_trace_header hdr;
+	int nall = 0;
+
+	if (!o->hwmon[0]) {
+		struct hwmon_resolution res;
+		if (hwmon_resolve(&res, 0) == 0) {
+			snprintf(o->hwmon, sizeof(o->hwmon), "%s", res.hwmon);
+		} else if (!o->use_isa) {
+			fprintf(stderr, "[ERROR] No %s* hwmon device under %s (is nct6775 loaded?)\n", HWMON_NAME_PREFIX,
+				HWMON_CLASS_PATH);
+			return 2;
+		}
+	}
+
+	memcpy(hdr.magic, NCT_TRACE_MAGIC, sizeof(hdr.magic));
+	hdr.version = NCT_TRACE_VERSION;
+	hdr.rate_hz = (uint32_t)o->rate;
+	hdr.load_on_ns = hdr.load_off_ns = -1;
+	read_timing(o->hwmon, &hdr);
+
+	if (o->use_isa) {
+		char err[160];
+		if (isa_open(&isa_storage, o->force ? ISA_OPEN_FORCE : 0, err, sizeof(err)) < 0) {
+			fprintf(stderr, "[ERROR] ISA backend: %s\n", err);
+			return 2;
+		}
+		if (isa_storage.shared_with[0]) {
+			fprintf(stderr, "[WARN] --force: sharing the HWM ports with bound %s; its bank selects "
+				"can interleave with ours\n", isa_storage.shared_with);
+		}
+		isa = &isa_storage;
+		nall = isa_channels(isa, all, MAX_CHANNELS);
+		hdr.backend = 1;
+		snprintf(hdr.source, sizeof(hdr.source), "ISA HWM 0x%X (%s)", isa->hwm.base, isa->chip->name);
+	} else {
+		int dirfd = open(o->hwmon, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if (dirfd < 0) {
+			fprintf(stderr, "[ERROR] Cannot open %s: %s\n", o->hwmon, strerror(errno));
+			return 2;
+		}
+		nall = hwmon_scan_channels(dirfd, all, MAX_CHANNELS);
+		close(dirfd);
+		snprintf(hdr.source, sizeof(hdr.source), "%.63s", o->hwmon);
+	}
+
+	/* sel[i]: index into all[] (and the ISA value vector) of trace channel i */
+	int sel[NCT_TRACE_CHANNELS];
+	for (int i = 0; i < nall && hdr.nchannels < NCT_TRACE_CHANNELS; ++i) {
+		if (traced_kind(all[i].kind)) {
+			struct nct_trace_channel *c = &hdr.channels[hdr.nchannels];
+			memcpy(c->name, all[i].name, sizeof(c->name));
+			memcpy(c->label, all[i].label, sizeof(c->label));
+			c->kind = (uint8_t)all[i].kind;
+			c->index = (uint8_t)all[i].index;
+			sel[hdr.nchannels++] = i;
+		}
+	}
+	int rc = 2;
+	FILE *out = NULL;
+	struct nct_rt_timer timer = {.fd = -1};
+	if (hdr.nchannels == 0) {
+		fprintf(stderr, "[ERROR] No temp/fan/pwm channels in %s\n", hdr.source);
+		goto out;
+	}
+
+	out = fopen(o->path, "we");
+	if (!out) {
+		fprintf(stderr, "[ERROR] Cannot create %s: %s\n", o->path, strerror(errno));
+		goto out;
+	}
+	setvbuf(out, NULL, _IOFBF, 1 << 20);
+	if (fwrite(&hdr, sizeof(hdr), 1, out) != 1) {
+		fprintf(stderr, "[ERROR] Cannot write %s: %s\n", o->path, strerror(errno));
+		goto out;
+	}
+
+	if (nct_rt_timer_open(&timer, (uint64_t)NS_PER_S / (uint64_t)o->rate) < 0) {
+		fprintf(stderr, "[ERROR] timerfd: %s\n", strerror(errno));
+		goto out;
+	}
+	struct sigaction sa = {.sa_handler = on_signal};
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	if (o->rt.priority || o->rt.cpu >= 0) {
+		char err[160];
+		if (nct_rt_enter(&o->rt, err, sizeof(err)) < 0) {
+			fprintf(stderr, "[ERROR] Real-time mode: %s\n", err);
+			goto out;
+		}
+	}
+
+	if (o->watch) {
+		fprintf(stderr, "[INFO] Watching %u channels of %s at %d Hz for %d s\n", hdr.nchannels, hdr.source,
+			o->rate, o->duration_s);
+	} else {
+		fprintf(stderr, "[INFO] Capturing %u channels of %s at %d Hz: %d s baseline, %d s load, %d s total\n",
+			hdr.nchannels, hdr.source, o->rate, o->pre_s, o->load_s, o->duration_s);
+	}
+
+	struct timespec wall;
+	clock_gettime(CLOCK_REALTIME, &wall);
+	hdr.start_realtime_ns = (int64_t)wall.tv_sec * NS_PER_S + wall.tv_nsec;
+	int64_t on_at = (int64_t)o->pre_s * NS_PER_S;
+	int64_t off_at = on_at + (int64_t)o->load_s * NS_PER_S;
+	int64_t end_at = (int64_t)o->duration_s * NS_PER_S;
+	uint64_t t0 = nct_stats_begin();
+	uint64_t samples = 0, overruns = 0;
+	static int32_t raw[MAX_CHANNELS];
+	static unsigned char rec[sizeof(uint64_t) + NCT_TRACE_CHANNELS * sizeof(int32_t)];
+	size_t recsize = nct_trace_record_size(&hdr);
+
+	rc = 0;
+	while (!stop_requested) {
+		uint64_t expirations;
+		if (nct_rt_timer_wait(&timer, &expirations) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			fprintf(stderr, "[ERROR] timerfd read: %s\n", strerror(errno));
+			rc = 2;
+			break;
+		}
+		overruns += expirations - 1;
+
+		uint64_t t = nct_stats_begin() - t0;
+		if ((int64_t)t >= end_at) {
+			break;
+		}
+		if (!o->watch && hdr.load_on_ns < 0 && (int64_t)t >= on_at) {
+			if (load_start() < 0) {
+				fprintf(stderr, "[ERROR] Cannot start load: %s\n", strerror(errno));
+				rc = 2;
+				break;
+			}
+			hdr.load_on_ns = (int64_t)(nct_stats_begin() - t0);
+			fprintf(stderr, "[INFO] Load on: %d busy processes\n", nload);
+		}
+		if (nload && (int64_t)t >= off_at) {
+			load_stop();
+			hdr.load_off_ns = (int64_t)(nct_stats_begin() - t0);
+			fprintf(stderr, "[INFO] Load off\n");
+		}
+
+		if (isa) {
+			if (isa_sample(isa, raw) < 0) {
+				for (int i = 0; i < nall; ++i) {
+					raw[i] = NCT_TRACE_INVALID;
+				}
+			}
+		} else {
+			for (uint32_t i = 0; i < hdr.nchannels; ++i) {
+				if (hwmon_read_int(all[sel[i]].fd, &raw[sel[i]]) < 0) {
+					raw[sel[i]] = NCT_TRACE_INVALID;
+				}
+			}
+		}
+		memcpy(rec, &t, sizeof(t));
+		for (uint32_t i = 0; i < hdr.nchannels; ++i) {
+			memcpy(rec + sizeof(t) + i * sizeof(int32_t), &raw[sel[i]], sizeof(int32_t));
+		}
+		if (fwrite(rec, recsize, 1, out) != 1) {
+			fprintf(stderr, "[ERROR] Cannot write %s: %s\n", o->path, strerror(errno));
+			rc = 2;
+			break;
+		}
+		samples++;
+	}
+	if (nload) {
+		load_stop();
+		hdr.load_off_ns = (int64_t)(nct_stats_begin() - t0);
+	}
+
+	/* Finalise the edges; a trace cut short above keeps them at -1 */
+	if (fseek(out, 0, SEEK_SET) < 0 || fwrite(&hdr, sizeof(hdr), 1, out) != 1 || fflush(out) != 0 ||
+	    fsync(fileno(out)) < 0) {
+		fprintf(stderr, "[ERROR] Cannot finalise %s: %s\n", o->path, strerror(errno));
+		rc = 2;
+	}
+	fprintf(stderr, "[INFO] %llu samples (%llu overruns) -> %s\n", (unsigned long long)samples,
+		(unsigned long long)overruns, o->path);
+
+out:
+	if (out && fclose(out) != 0 && rc == 0) {
+		rc = 2;
+	}
+	nct_rt_timer_close(&timer);
+	if (!isa) {
+		hwmon_close_channels(all, nall);
+	} else {
+		isa_close(isa);
+	}
+	return rc;
+}
+
+/* ------------------------------------------------------------------------ */
+/* Analysis                                                                 */
+/* ------------------------------------------------------------------------ */
+
+static struct nct_trace_header th;
+static unsigned char *trace;
+static size_t nrec, recsize;
+
+static int64_t rec_t(size_t r) {
+	uint64_t t;
+	memcpy(&t, trace + r * recsize, sizeof(t));
+	return (int64_t)t;
+}
+
+static int32_t rec_v(size_t r, int ch) {
+	int32_t v;
+	memcpy(&v, trace + r * recsize + sizeof(uint64_t) + (size_t)ch * sizeof(int32_t), sizeof(v));
+	return v;
+}
+
+/* First record at or after t */
+static size_t rec_at(int64_t t) {
+	size_t lo = 0, hi = nrec;
+	while (lo < hi) {
+		size_t mid = (lo + hi) / 2;
+		if (rec_t(mid) < t) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+static int cmp_i32(const void *a, const void *b) {
+	int32_t x = *(const int32_t *)a, y = *(const int32_t *)b;
+	return (x > y) - (x < y);
+}
+
+/*
+ * median() - Median of channel ch over records [from, to)
+ * RETURNS: 0, or -1 (no valid sample in the range)
+ */
+static int median(int ch, size_t from, size_t to, int32_t *out) {
+	static int32_t *buf;
+	static size_t cap;
+	size_t n = 0;
+
+	if (to - from > cap) {
+		cap = to - from;
+		free(buf);
+		buf = malloc(cap * sizeof(*buf));
+		if (!buf) {
+			cap = 0;
+			return -1;
+		}
+	}
+	for (size_t r = from; r < to; ++r) {
+		int32_t v = rec_v(r, ch);
+		if (v != NCT_TRACE_INVALID) {
+			buf[n++] = v;
+		}
+	}
+	if (n == 0) {
+		return -1;
+	}
+	qsort(buf, n, sizeof(*buf), cmp_i32);
+	*out = buf[n / 2];
+	return 0;
+}
+
+/*
+ * struct edge - Response of one channel to one load edge
+ * times in ms after the edge, -1 = never reached
+ */
+struct edge {
+	bool valid;
+	bool moving;            /* still changing at the end of the phase */
+	int32_t y0, yf, peak;
+	int64_t t10, t63, t90, settle;
+	int overshoot_pct;
+};
+
+static int32_t min_band(enum hwmon_kind kind) {
+	switch (kind) {
+	case HWMON_TEMP:
+		return 500;     /* 0.5 C */
+	case HWMON_FAN:
+		return 30;      /* RPM */
+	default:
+		return 2;       /* duty */
+	}
+}
+
+/*
+ * edge_analyse() - Initial/final value, 10/63/90 % times, overshoot, settling
+ * IN: the phase is [t_edge, t_end), the previous one [t_prev, t_edge);
+ *     the initial value is the final value of the previous phase (its last
+ *     FINAL_PCT, at most BASELINE_NS), so an unsettled previous phase does
+ *     not drag the baseline back
+ */
+static void edge_analyse(int ch, int64_t t_prev, int64_t t_edge, int64_t t_end, struct edge *e) {
+	memset(e, 0, sizeof(*e));
+	e->t10 = e->t63 = e->t90 = -1;
+
+	int64_t base_len = (t_edge - t_prev) * FINAL_PCT / 100;
+	base_len = base_len > BASELINE_NS ? BASELINE_NS : base_len;
+	size_t b0 = rec_at(t_edge - base_len), r0 = rec_at(t_edge), r1 = rec_at(t_end);
+	if (r0 >= r1) {
+		return;
+	}
+	size_t f0 = r1 - (r1 - r0) * FINAL_PCT / 100;
+	int32_t before_final;
+	if (median(ch, b0 < r0 ? b0 : r0, b0 < r0 ? r0 : r0 + 1, &e->y0) < 0 || median(ch, f0, r1, &e->yf) < 0 ||
+	    median(ch, f0 - (r1 - f0) < r0 ? r0 : f0 - (r1 - f0), f0 > r0 ? f0 : r0 + 1, &before_final) < 0) {
+		return;
+	}
+
+	int64_t delta = (int64_t)e->yf - e->y0;
+	int32_t band = min_band((enum hwmon_kind)th.channels[ch].kind);
+	int64_t pct_band = (delta < 0 ? -delta : delta) * SETTLE_PCT / 100;
+	if (pct_band > band) {
+		band = (int32_t)pct_band;
+	}
+	if ((delta < 0 ? -delta : delta) < 2 * (int64_t)min_band((enum hwmon_kind)th.channels[ch].kind)) {
+		return;   /* did not respond */
+	}
+	e->valid = true;
+	e->moving = before_final > e->yf + band || before_final < e->yf - band;
+	e->peak = e->yf;
+
+	int64_t last_out = -1;
+	for (size_t r = r0; r < r1; ++r) {
+		int32_t v = rec_v(r, ch);
+		if (v == NCT_TRACE_INVALID) {
+			continue;
+		}
+		int64_t dt = (rec_t(r) - t_edge) / NS_PER_MS;
+		int64_t num = ((int64_t)v - e->y0) * 1000 / delta;   /* progress, per mille */
+		if (e->t10 < 0 && num >= 100) {
+			e->t10 = dt;
+		}
+		if (e->t63 < 0 && num >= 632) {
+			e->t63 = dt;
+		}
+		if (e->t90 < 0 && num >= 900) {
+			e->t90 = dt;
+		}
+		if ((delta > 0 && v > e->peak) || (delta < 0 && v < e->peak)) {
+			e->peak = v;
+		}
+		if (v > e->yf + band || v < e->yf - band) {
+			last_out = dt;
+		}
+	}
+	e->settle = last_out < 0 ? 0 : last_out;
+	/* Past a final value that is still moving, "overshoot" is just the ramp continuing */
+	e->overshoot_pct = e->moving ? 0 : (int)(((int64_t)e->peak - e->yf) * 100 / delta);
+}
+
+static void print_ms(int64_t ms) {
+	if (ms < 0) {
+		printf("   -- ");
+	} else {
+		printf("%5.1fs", (double)ms / 1000.0);
+	}
+}
+
+static void print_edge(const char *what, const struct edge *e, double div, const char *unit) {
+	printf("    %-5s ", what);
+	if (!e->valid) {
+		printf("no response%s\n", e->yf != e->y0 ? " (moved against the temperature: lengthen the phase)" : "");
+		return;
+	}
+	printf("%7.1f -> %7.1f %-4s delay ", e->y0 / div, e->yf / div, unit);
+	print_ms(e->t10);
+	printf("  rise ");
+	print_ms(e->t10 >= 0 && e->t90 >= 0 ? e->t90 - e->t10 : -1);
+	printf("  overshoot %3d%%  settle ", e->overshoot_pct);
+	print_ms(e->settle);
+	printf("%s\n", e->moving ? "  (still moving at phase end)" : "");
+}
+
+static void against(struct edge *e, const struct edge *temp) {
+	if (e->valid && temp->valid && ((int64_t)e->yf - e->y0 > 0) != ((int64_t)temp->yf - temp->y0 > 0)) {
+		e->valid = false;
+	}
+}
+
+static int find_channel(enum hwmon_kind kind, int index) {
+	for (uint32_t i = 0; i < th.nchannels; ++i) {
+		if (th.channels[i].kind == kind && th.channels[i].index == index) {
+			return (int)i;
+		}
+	}
+	return -1;
+}
+
+static int64_t round100(int64_t ms, int64_t lo, int64_t hi) {
+	ms = (ms + 50) / 100 * 100;
+	return ms < lo ? lo : (ms > hi ? hi : ms);
+}
+
+/*
+ * suggest_step() - step_up/step_down for one edge (see SUGGESTIONS)
+ * IN: current = the trace's recorded value, -1 if unknown
+ */
+static int64_t suggest_step(const struct edge *temp, const struct edge *duty, const struct edge *rpm, int32_t current) {
+	int64_t steps = (int64_t)duty->yf - duty->y0;
+	steps = steps < 0 ? -steps : steps;
+	int64_t ms = temp->valid && temp->t63 > 0 ? temp->t63 / 2 / steps : STEP_MS_MIN;
+	/* A duty ramp shorter than the fan's own lag behind the duty buys nothing */
+	int64_t lag = rpm->valid && rpm->t90 >= 0 && duty->t90 >= 0 ? rpm->t90 - duty->t90 : 0;
+	if (lag / steps > ms) {
+		ms = lag / steps;
+	}
+	if ((duty->overshoot_pct > OVERSHOOT_PCT || (rpm->valid && rpm->overshoot_pct > OVERSHOOT_PCT)) && current > 0 &&
+	    current * 3 / 2 > ms) {
+		ms = (int64_t)current * 3 / 2;
+	}
+	return round100(ms, STEP_MS_MIN, STEP_MS_MAX);
+}
+
+/*
+ * pick_temp() - The temperature that rose most across the load-on edge
+ */
+static int pick_temp(int64_t t_on, int64_t t_end) {
+	int best = -1;
+	int64_t best_rise = 0;
+	for (uint32_t i = 0; i < th.nchannels; ++i) {
+		struct edge e;
+		if (th.channels[i].kind != HWMON_TEMP) {
+			continue;
+		}
+		edge_analyse((int)i, 0, t_on, t_end, &e);
+		if (e.valid && e.yf < TEMP_OPEN_MC && (int64_t)e.yf - e.y0 > best_rise) {
+			best_rise = (int64_t)e.yf - e.y0;
+			best = (int)i;
+		}
+	}
+	return best;
+}
+
+/*
+ * detect_edge() - Watch mode: first time temp ch exceeds its baseline + 2 C
+ * RETURNS: edge time in ns, or -1
+ */
+static int64_t detect_edge(int ch) {
+	int32_t base;
+	if (median(ch, 0, rec_at(BASELINE_NS), &base) < 0) {
+		return -1;
+	}
+	for (size_t r = rec_at(BASELINE_NS); r < nrec; ++r) {
+		int32_t v = rec_v(r, ch);
+		if (v != NCT_TRACE_INVALID && v < TEMP_OPEN_MC && v > base + STEP_DETECT_MC) {
+			return rec_t(r);
+		}
+	}
+	return -1;
+}
+
+/*
+ * analyse() - Report every header of a trace
+ * RETURNS: 0, 1 (no step found), 2 (unreadable trace)
+ */
+static int analyse(const char *path, const char *temp_name) {
+	FILE *in = fopen(path, "re");
+	struct stat st;
+	if (!in || fstat(fileno(in), &st) < 0) {
+		fprintf(stderr, "[ERROR] Cannot open %s: %s\n", path, strerror(errno));
+		return 2;
+	}
+	if (nct_trace_read_header(in, &th) < 0) {
+		fprintf(stderr, "[ERROR] %s: not an nct-step trace\n", path);
+		fclose(in);
+		return 2;
+	}
+	recsize = nct_trace_record_size(&th);
+	nrec = ((size_t)st.st_size - sizeof(th)) / recsize;
+	trace = malloc(nrec * recsize + 1);
+	if (!trace || fread(trace, recsize, nrec, in) != nrec || nrec < 2) {
+		fprintf(stderr, "[ERROR] %s: truncated trace\n", path);
+		fclose(in);
+		return 2;
+	}
+	fclose(in);
+
+	int64_t t_end = rec_t(nrec - 1) + 1;
+	int temp = -1;
+	if (temp_name) {
+		for (uint32_t i = 0; i < th.nchannels; ++i) {
+			if (strcmp(th.channels[i].name, temp_name) == 0 && th.channels[i].kind == HWMON_TEMP) {
+				temp = (int)i;
+			}
+		}
+		if (temp < 0) {
+			fprintf(stderr, "[ERROR] %s: no temperature channel %s\n", path, temp_name);
+			return 2;
+		}
+	}
+
+	int64_t on = th.load_on_ns, off = th.load_off_ns;
+	if (on < 0) {
+		/* Watch mode: edge from the chosen temperature, or the first that steps */
+		for (uint32_t i = 0; i < th.nchannels && on < 0; ++i) {
+			if (th.channels[i].kind == HWMON_TEMP && (temp < 0 || (int)i == temp)) {
+				on = detect_edge((int)i);
+			}
+		}
+		off = -1;
+	}
+	if (on < 0) {
+		fprintf(stderr, "[ERROR] %s: no load step (no temperature rose %d C above its first 5 s)\n", path,
+			STEP_DETECT_MC / 1000);
+		return 1;
+	}
+	int64_t rise_end = off > on ? off : t_end;
+	if (temp < 0) {
+		temp = pick_temp(on, rise_end);
+	}
+	if (temp < 0) {
+		fprintf(stderr, "[ERROR] %s: no temperature responded to the load step\n", path);
+		return 1;
+	}
+
+	struct edge temp_rise, temp_fall = {0};
+	edge_analyse(temp, 0, on, rise_end, &temp_rise);
+	if (off > on) {
+		edge_analyse(temp, on, off, t_end, &temp_fall);
+	}
+
+	printf("Trace %s: %zu samples at %u Hz from %s, %.1f s\n", path, nrec, th.rate_hz, th.source, (double)t_end / NS_PER_S);
+	printf("Load on at %.1f s", (double)on / NS_PER_S);
+	if (off > on) {
+		printf(", off at %.1f s", (double)off / NS_PER_S);
+	}
+	printf("%s; driving temperature %s%s%s%s\n", th.load_on_ns < 0 ? " (detected)" : "", th.channels[temp].name,
+	       th.channels[temp].label[0] ? " (" : "", th.channels[temp].label, th.channels[temp].label[0] ? ")" : "");
+	print_edge("rise", &temp_rise, 1000.0, "C");
+	if (off > on) {
+		print_edge("fall", &temp_fall, 1000.0, "C");
+	}
+
+	char snippet[NCT_TRACE_PWM][160];
+	int nsnip = 0;
+	for (int n = 1; n <= NCT_TRACE_PWM; ++n) {
+		int pwm = find_channel(HWMON_PWM, n);
+		int fan = find_channel(HWMON_FAN, n);
+		if (pwm < 0) {
+			continue;
+		}
+		const int32_t *cur = th.timing[n - 1];
+		struct edge d_rise, d_fall = {0}, r_rise = {0}, r_fall = {0};
+		edge_analyse(pwm, 0, on, rise_end, &d_rise);
+		if (fan >= 0) {
+			edge_analyse(fan, 0, on, rise_end, &r_rise);
+		}
+		if (off > on) {
+			edge_analyse(pwm, on, off, t_end, &d_fall);
+			if (fan >= 0) {
+				edge_analyse(fan, on, off, t_end, &r_fall);
+			}
+		}
+		/* A duty moving against its temperature is still catching up with the previous edge */
+		against(&d_rise, &temp_rise);
+		against(&r_rise, &temp_rise);
+		against(&d_fall, &temp_fall);
+		against(&r_fall, &temp_fall);
+
+		printf("\npwm%d", n);
+		if (cur[NCT_TRACE_ENABLE] >= 0) {
+			printf(" (pwm%d_enable=%d, step_up %d ms, step_down %d ms, stop %d ms)", n, cur[NCT_TRACE_ENABLE],
+			       cur[NCT_TRACE_STEP_UP], cur[NCT_TRACE_STEP_DOWN], cur[NCT_TRACE_STOP]);
+		}
+		putchar('\n');
+		print_edge("rise", &d_rise, 1.0, "duty");
+		if (fan >= 0) {
+			print_edge("", &r_rise, 1.0, "rpm");
+		}
+		if (off > on) {
+			print_edge("fall", &d_fall, 1.0, "duty");
+			if (fan >= 0) {
+				print_edge("", &r_fall, 1.0, "rpm");
+			}
+		}
+		if (!d_rise.valid) {
+			continue;
+		}
+
+		int64_t up = suggest_step(&temp_rise, &d_rise, &r_rise, cur[NCT_TRACE_STEP_UP]);
+		int64_t down = up * 3 / 2;
+		if (d_fall.valid) {
+			int64_t fall = suggest_step(&temp_fall, &d_fall, &r_fall, cur[NCT_TRACE_STEP_DOWN]);
+			down = fall > down ? fall : down;
+		}
+		down = round100(down, STEP_MS_MIN, STEP_MS_MAX);
+		int64_t stop = temp_fall.valid ? round100(temp_fall.settle, STOP_MS_MIN, STOP_MS_MAX)
+					   : (cur[NCT_TRACE_STOP] > 0 ? cur[NCT_TRACE_STOP] : 3000);
+		printf("    suggest step_up_time %lld ms, step_down_time %lld ms, stop_time %lld ms%s%s\n", (long long)up,
+		       (long long)down, (long long)stop, temp_fall.valid ? "" : " (no load-off edge: stop_time kept)",
+		       d_rise.moving || temp_rise.moving || d_fall.moving ? " (unsettled phase: lengthen --load/--duration)" : "");
+		snprintf(snippet[nsnip++], sizeof(snippet[0]),
+			 "[pwm%d]\nstep_up_time = %lld\nstep_down_time = %lld\nstop_time = %lld\n", n, (long long)up,
+			 (long long)down, (long long)stop);
+	}
+
+	if (nsnip) {
+		printf("\n# nct-profile snippet (paste into /usr/local/etc/nct-fan-profile.conf)\n");
+		for (int i = 0; i < nsnip; ++i) {
+			fputs(snippet[i], stdout);
+		}
+	} else {
+		printf("\nNo header's duty responded (manual mode, or a curve flat over this range)\n");
+	}
+	free(trace);
+	return 0;
+}
+
+static void usage(FILE *out, const char *prog) {
+	fprintf(out,
+		"Usage: %s --capture TRACE [--load S | --watch] [--pre S] [--duration S]\n"
+		"          [--backend sysfs|isa [--force]] [--rate HZ] [--hwmon DIR] [--rt[=PRIO]] [--cpu N]\n"
+		"       %s --analyse TRACE [--temp NAME]\n"
+		"  --rate HZ     sysfs 1-%d (default %d), isa 1-%d (default %d)\n"
+		"  --load S      synthetic load length (default %d), after --pre S (default %d)\n"
+		"  --watch       no synthetic load; record a real one\n"
+		"  --duration S  whole capture (default pre + load + %d; --watch %d)\n"
+		"  --temp NAME   driving temperature for --analyse (default: largest rise)\n"
+		"  --force       isa: share the ports with a bound nct6775 (races its bank selects)\n",
+		prog, prog, SYSFS_RATE_MAX, SYSFS_RATE_DEFAULT, ISA_RATE_MAX, ISA_RATE_DEFAULT, LOAD_DEFAULT, PRE_DEFAULT,
+		POST_DEFAULT, WATCH_DEFAULT);
+}
+
+/*
+ * main() - Entry point
+ * STRATEGY: parse, then exactly one of capture() / analyse()
+ */
+int main(int argc, char **argv) {
+	static const struct option longopts[] = {
+		{"capture", required_argument, NULL, 'c'},
+		{"analyse", required_argument, NULL, 'a'},
+		{"load", required_argument, NULL, 'l'},
+		{"watch", no_argument, NULL, 'w'},
+		{"pre", required_argument, NULL, 'p'},
+		{"duration", required_argument, NULL, 'd'},
+		{"backend", required_argument, NULL, 'b'},
+		{"rate", required_argument, NULL, 'r'},
+		{"hwmon", required_argument, NULL, 'H'},
+		{"temp", required_argument, NULL, 't'},
+		{"rt", optional_argument, NULL, 'T'},
+		{"cpu", required_argument, NULL, 'C'},
+		{"force", no_argument, NULL, 'F'},
+		{"help", no_argument, NULL, 'h'},
+		{NULL, 0, NULL, 0},
+	};
+
+	struct capture_opts o = {.pre_s = PRE_DEFAULT, .load_s = LOAD_DEFAULT, .rt = {.priority = 0, .cpu = -1}};
+	const char *analyse_path = NULL, *temp_name = NULL;
+
+	int opt;
+	while ((opt = getopt_long(argc, argv, "c:a:l:wp:d:b:r:H:t:T::C:Fh", longopts, NULL)) != -1) {
+		switch (opt) {
+		case 'c':
+			o.path = optarg;
+			break;
+		case 'a':
+			analyse_path = optarg;
+			break;
+		case 'l':
+			o.load_s = atoi(optarg);
+			break;
+		case 'w':
+			o.watch = true;
+			break;
+		case 'p':
+			o.pre_s = atoi(optarg);
+			break;
+		case 'd':
+			o.duration_s = atoi(optarg);
+			break;
+		case 'F':
+			o.force = true;
+			break;
+		case 'b':
+			if (strcmp(optarg, "isa") == 0) {
+				o.use_isa = true;
+			} else if (strcmp(optarg, "sysfs") != 0) {
+				fprintf(stderr, "[ERROR] --backend must be sysfs or isa\n");
+				return 2;
+			}
+			break;
+		case 'r':
+			o.rate = atoi(optarg);
+			break;
+		case 'H':
+			snprintf(o.hwmon, sizeof(o.hwmon), "%s", optarg);
+			break;
+		case 't':
+			temp_name = optarg;
+			break;
+		case 'T':
+			if (nct_rt_parse_priority(optarg, &o.rt.priority) < 0) {
+				fprintf(stderr, "[ERROR] --rt priority must be 1-99\n");
+				return 2;
+			}
+			break;
+		case 'C':
+			o.rt.cpu = atoi(optarg);
+			if (o.rt.cpu < 0) {
+				fprintf(stderr, "[ERROR] --cpu must be a CPU number\n");
+				return 2;
+			}
+			break;
+		case 'h':
+			usage(stdout, argv[0]);
+			return 0;
+		default:
+			usage(stderr, argv[0]);
+			return 2;
+		}
+	}
+
+	if (!o.path == !analyse_path) {
+		usage(stderr, argv[0]);
+		return 2;
+	}
+	if (analyse_path) {
+		return analyse(analyse_path, temp_name);
+	}
+
+	int rate_max = o.use_isa ? ISA_RATE_MAX : SYSFS_RATE_MAX;
+	if (o.rate == 0) {
+		o.rate = o.use_isa ? ISA_RATE_DEFAULT : SYSFS_RATE_DEFAULT;
+	}
+	if (o.rate < 1 || o.rate > rate_max) {
+		fprintf(stderr, "[ERROR] --rate must be 1-%d Hz for the %s backend\n", rate_max, o.use_isa ? "isa" : "sysfs");
+		return 2;
+	}
+	if (o.pre_s < 0 || o.load_s < 1) {
+		fprintf(stderr, "[ERROR] --pre must be >= 0 and --load >= 1 s\n");
+		return 2;
+	}
+	if (o.duration_s == 0) {
+		o.duration_s = o.watch ? WATCH_DEFAULT : o.pre_s + o.load_s + POST_DEFAULT;
+	}
+	if (o.duration_s < 1 || (!o.watch && o.duration_s <= o.pre_s + o.load_s)) {
+		fprintf(stderr, "[ERROR] --duration must exceed --pre + --load\n");
+		return 2;
+	}
+	return capture(&o);
+}
+
+/*
+ * BUILD & DEPLOYMENT NOTES:
+ *
+ * Compilation:
+ *   gcc -std=c23 -O2 -Wall -Wextra -Werror -o nct-step nct-step.c \
+ *       nct-hwmon.c nct-isa.c nct-sio.c nct-stats.c nct-rt.c
+ *
+ * Installation (in PKGBUILD):
+ *   install -Dm755 nct-step "$pkgdir/usr/lib/eirikr/nct-step"
+ *
+ * Cost model:
+ *   Record size 8 + 4 x channels bytes (~90 B for the NCT6798D's 21
+ *   temp/fan/pwm channels): the default 130 s capture is ~230 KB with
+ *   sysfs at 20 Hz and ~2.3 MB with isa at 200 Hz. Analysis loads the
+ *   whole trace and makes a few linear passes per channel.
+ */
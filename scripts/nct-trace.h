@@ -0,0 +1,98 @@
+/*
+ * nct-trace.h - Binary step-response trace written by nct-step --capture
+ *
+ * PURPOSE:
+ *   On-disk layout of a high-rate capture of temperature, PWM duty and RPM
+ *   around a load step: one header (channel table, load edges, the
+ *   header timing attributes in force) followed by fixed-size records.
+ *
+ * WHY BINARY:
+ *   At the ISA backend's rates (up to 1 kHz) a text line per sample costs
+ *   more than the sample itself; fixed records are written with one
+ *   fwrite() each and analysed without parsing.
+ *
+ * LAYOUT (native endianness; traces are analysed on the box or one like it):
+ *   struct nct_trace_header          magic, geometry, edges, channel table
+ *   record[n], nct_trace_record_size() bytes each:
+ *     uint64_t t_ns                  since capture start (CLOCK_MONOTONIC)
+ *     int32_t  value[nchannels]      sysfs units; NCT_TRACE_INVALID = failed
+ *   n follows from the file size; a capture cut short by a crash leaves a
+ *   readable prefix (its edges are still -1, see below).
+ *
+ *   magic starts with 0x7F like nct-plan.h, so no text file matches it.
+ *
+ * EDGES:
+ *   load_on_ns / load_off_ns are the synthetic load's start and end
+ *   relative to t_ns 0, or -1 (watch mode, or the capture was interrupted
+ *   before the header was finalised); the analyser then finds the step in
+ *   the temperature itself.
+ */
+
+#ifndef NCT_TRACE_H
+#define NCT_TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define NCT_TRACE_MAGIC     "\x7fNCTTRCE"
+#define NCT_TRACE_VERSION   1
+#define NCT_TRACE_CHANNELS  64
+#define NCT_TRACE_NAME_MAX  32
+#define NCT_TRACE_PWM       7
+#define NCT_TRACE_INVALID   INT32_MIN
+
+/* Header timing attributes recorded at capture, per pwmN; -1 = absent */
+enum nct_trace_timing {
+	NCT_TRACE_STEP_UP,      /* pwmN_step_up_time, ms */
+	NCT_TRACE_STEP_DOWN,    /* pwmN_step_down_time, ms */
+	NCT_TRACE_STOP,         /* pwmN_stop_time, ms */
+	NCT_TRACE_ENABLE,       /* pwmN_enable, mode 0/1/2/3/5 */
+	NCT_TRACE_TIMING_COUNT,
+};
+
+struct nct_trace_channel {
+	char name[NCT_TRACE_NAME_MAX];  /* sysfs attribute, e.g. "fan2_input" */
+	char label[NCT_TRACE_NAME_MAX]; /* "CPUTIN", "" if none */
+	uint8_t kind;                   /* enum hwmon_kind */
+	uint8_t index;
+	uint8_t reserved[6];
+};
+
+struct nct_trace_header {
+	char magic[8];                  /* NCT_TRACE_MAGIC, no NUL */
+	uint32_t version;
+	uint32_t nchannels;
+	uint32_t rate_hz;
+	uint32_t backend;               /* 0 = sysfs, 1 = isa */
+	int64_t load_on_ns;
+	int64_t load_off_ns;
+	int64_t start_realtime_ns;      /* wall clock at t_ns 0 */
+	int32_t timing[NCT_TRACE_PWM][NCT_TRACE_TIMING_COUNT];
+	char source[64];                /* hwmon directory or "ISA HWM 0x290 (...)" */
+	struct nct_trace_channel channels[NCT_TRACE_CHANNELS];
+};
+
+static inline size_t nct_trace_record_size(const struct nct_trace_header *h) {
+	return sizeof(uint64_t) + (size_t)h->nchannels * sizeof(int32_t);
+}
+
+/*
+ * nct_trace_read_header() - Read and validate the header of a trace
+ * RETURNS: 0, or -1 (bad magic/version/geometry, short read)
+ */
+static inline int nct_trace_read_header(FILE *in, struct nct_trace_header *h) {
+	if (fread(h, sizeof(*h), 1, in) != 1 || memcmp(h->magic, NCT_TRACE_MAGIC, sizeof(h->magic)) != 0 ||
+	    h->version != NCT_TRACE_VERSION || h->nchannels == 0 || h->nchannels > NCT_TRACE_CHANNELS) {
+		return -1;
+	}
+	h->source[sizeof(h->source) - 1] = '\0';
+	for (uint32_t i = 0; i < h->nchannels; ++i) {
+		h->channels[i].name[NCT_TRACE_NAME_MAX - 1] = '\0';
+		h->channels[i].label[NCT_TRACE_NAME_MAX - 1] = '\0';
+	}
+	return 0;
+}
+
+#endif /* NCT_TRACE_H */
@@ -0,0 +1,1201 @@
+/*
+ * nct-tune.c - Offline fan curve optimizer from telemetry and fan models
+ *
+ * PURPOSE:
+ *   Find, per chassis, the SmartFan IV 7-point curves and pwmN_weight_*
+ *   settings that keep chosen temperatures under a ceiling at the lowest
+ *   total fan duty, from what the machine actually did (the nct-sampler
+ *   telemetry log) and how its fans actually respond (the nct-characterize
+ *   model). The result is an nct-profile profile.
+ *
+ * WHY THIS EXISTS:
+ *   DEFAULT_TEMPS_7PT/DEFAULT_PWMS_7PT (max-fans-advanced.sh) and
+ *   SMARTFAN_TEMPS/SMARTFAN_PWMS (max-fans-enhanced.sh) are one curve for
+ *   every case, cooler and workload: too loud on a roomy case with a big
+ *   cooler, too late on a cramped one. The history of the box already
+ *   says how hot it runs at which fan speed; this turns it into a curve.
+ *
+ * THERMAL MODEL (quasi-steady, one chassis airflow):
+ *   A fan's airflow is its RPM relative to its own max_rpm, looked up in
+ *   the model's rpm_down table (0 below stall_duty); the chassis airflow a
+ *   is the sum over connected headers. Heat leaves through a conductance
+ *   G(a) = passive + a^0.8 (forced convection; passive is what the case
+ *   sheds with every fan stopped, relative to one fan at full speed). At
+ *   each logged sample the heat input is whatever held the recorded
+ *   temperature T at the recorded airflow, so under other fan speeds
+ *       T' = ambient + (T - ambient) * G(a_recorded) / G(a')
+ *   for every sensor. With the candidate curves a' depends on T' (the
+ *   curves read the temperatures they change); the fixed point is unique
+ *   because more airflow means cooler sensors means lower duties, and is
+ *   found by bisection on a'.
+ *
+ * SEARCH:
+ *   Each optimized header's curve is seven points spanning T0..T6 with
+ *   duties from d0 (at least the model's stall_duty + 8) rising to 255
+ *   with shape exponent gamma; a header given --weight also searches
+ *   weight_temp_step_base / _temp_step / _duty_step. Coordinate descent
+ *   minimizes (ceiling violation, then mean total duty) from the static
+ *   default curve; a final pass lowers individual points while the
+ *   ceiling holds. Samples are thinned to the hottest one per
+ *   --resolution, which keeps every peak the ceiling is checked against.
+ *
+ * USAGE:
+ *   nct-tune --model MODEL --target CHANNEL:C [--target ...]
+ *            [--header N[:CHANNEL]]... [--weight N:CHANNEL]...
+ *            [--dir DIR] [--from TIME] [--to TIME] [--resolution S]
+ *            [--ambient C] [--passive G] [--margin C] [-o PROFILE]
+ *     --model MODEL   nct-characterize model (default /var/lib/eirikr/nct-fan.model)
+ *     --target CH:C   keep CH (attribute or label, e.g. CPUTIN:75 or
+ *                     k10temp/temp1_input:85) at or below C
+ *     --header N:CH   optimize pwmN, whose pwmN_temp_sel is chip input CH
+ *                     (tempK_input or its label). Default: every connected
+ *                     header the model says responds, following the first
+ *                     --target (which must then be a chip input)
+ *     --weight N:CH   also search SmartFan IV weighting of pwmN by CH
+ *     --dir/--from/--to  telemetry range as nct-query (default the last 7 d)
+ *     --resolution S  one sample per S seconds, the hottest (default 60)
+ *     --ambient C     intake temperature (default: the coolest logged value)
+ *     --passive G     conductance with every fan stopped (default 0.15)
+ *     --margin C      keep predictions this far below each ceiling (default 2)
+ *     -o PROFILE      write the profile here (atomically) instead of stdout
+ *   Then: nct-profile --compile PROFILE (merge other sections as needed)
+ *
+ *   A report goes to stderr: recorded, static-default and optimized mean
+ *   duty, fan power (cube law) and the predicted maximum of every target.
+ *
+ * EXIT CODES:
+ *   0  profile written
+ *   1  no curve meets the ceilings (the report says by how much)
+ *   2  usage error, unreadable model or log, no samples in the range
+ *
+ * SAFETY / CAVEATS:
+ *   - Offline: reads the log and model, never touches hardware
+ *   - The model is only as good as the log: a range without the heaviest
+ *     workload cannot size the curve for it. Use a range that includes it
+ *   - One airflow for the whole case: a header's fan cools every sensor
+ *     equally. Headers the model marks responds = no keep their recorded
+ *     duty and are not optimized
+ *   - The profile's curves follow whatever pwmN_temp_sel is on the chip;
+ *     --header's CH must match it
+ */
+
+#define _GNU_SOURCE
+#include "nct-log.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_MODEL    "/var/lib/eirikr/nct-fan.model"
+#define MAX_PWM          7
+#define MAX_POINTS       7      /* SmartFan IV: pwmN_auto_point1..7 */
+#define MAX_SENSORS      16     /* targets, header inputs and weight inputs */
+#define MAX_RPM_STEPS    32
+#define TEMP_MAX         127    /* auto point registers are 8-bit C */
+#define AUTO_MARGIN      8      /* duty above a measured stall, as nct-profile */
+#define RESOLUTION_DEFAULT 60
+#define PASSIVE_DEFAULT  0.15
+#define MARGIN_DEFAULT   2.0
+#define AIRFLOW_EXP      0.8    /* forced convection: Nu ~ Re^0.8 */
+#define BISECT_STEPS     14
+#define POLISH_ROUNDS    8
+
+/* max-fans-advanced.sh DEFAULT_TEMPS_7PT / DEFAULT_PWMS_7PT: the starting point */
+static const int default_temps[MAX_POINTS] = {40, 50, 60, 65, 70, 75, 80};
+static const int default_pwms[MAX_POINTS] = {64, 96, 128, 160, 192, 224, 255};
+
+/* Candidate values per search coordinate */
+static const int t0_values[] = {20, 25, 30, 35, 40, 45, 50, 55, 60, 65, 70, 75, 80};
+static const int t6_values[] = {40, 45, 50, 55, 60, 65, 70, 75, 80, 85, 90, 95, 100};
+static const double gamma_values[] = {0.5, 0.75, 1.0, 1.5, 2.0, 3.0};
+static const int wbase_values[] = {30, 35, 40, 45, 50, 55, 60, 65, 70, 75, 80, 85, 90};
+static const int wstep_values[] = {1, 2, 3, 5};
+static const int wduty_values[] = {0, 4, 8, 12, 16, 24, 32};
+
+struct sensor {
+	char name[NCT_LOG_NAME_MAX];    /* as given: attribute or label */
+	char attr[NCT_LOG_NAME_MAX];    /* attribute, once seen in a log */
+	char label[NCT_LOG_NAME_MAX];
+	double ceiling;                 /* C; 0 = not a target */
+	double recorded_max;
+};
+
+/*
+ * struct header - One pwmN: its fan (model), its role, its candidate
+ */
+struct header {
+	bool connected, responds, optimize;
+	int stall_duty, max_rpm;
+	double air[256];                /* airflow per duty, 0-1 */
+	int in_sensor, w_sensor;        /* index into sensors[], -1 = none */
+
+	int t0, t6, d0, gamma_i;        /* parametric curve */
+	int w_base, w_step, w_duty;     /* weighting; w_duty 0 = off */
+	int pt_temp[MAX_POINTS], pt_duty[MAX_POINTS];
+};
+
+/*
+ * struct sample - One thinned telemetry sample
+ * afix: airflow of headers that are not optimized (recorded duty);
+ * glog: G(a) at the recorded airflow
+ */
+struct sample {
+	float t[MAX_SENSORS];           /* C */
+	uint8_t duty[MAX_PWM + 1];
+	float afix, glog;
+};
+
+/* Outcome of one evaluation, compared lexicographically */
+struct score {
+	double violation;               /* C above ceiling - margin, summed */
+	double duty;                    /* mean total duty of optimized headers */
+	double power;                   /* mean sum of airflow^3 (fan power) */
+	double tmax[MAX_SENSORS];
+};
+
+static struct header headers[MAX_PWM + 1];
+static struct sensor sensors[MAX_SENSORS];
+static int nsensors;
+static struct sample *samples;
+static size_t nsamples, sample_cap;
+static double ambient = NAN, passive = PASSIVE_DEFAULT, margin = MARGIN_DEFAULT;
+static double coolest = 1e9;
+static uint64_t evaluations;
+
+static int64_t realtime_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/*
+ * parse_time() - --from / --to, the nct-query syntax
+ * RETURNS: 0 with *out in CLOCK_REALTIME ns, or -1
+ */
+static int parse_time(const char *s, int64_t now, int64_t *out) {
+	char *end;
+	if (strcmp(s, "now") == 0) {
+		*out = now;
+		return 0;
+	}
+	if (s[0] == '-') {
+		double v = strtod(s + 1, &end);
+		static const struct {
+			char unit;
+			int64_t ns;
+		} units[] = {{'s', 1000000000}, {'m', 60000000000}, {'h', 3600000000000}, {'d', 86400000000000}};
+		for (size_t i = 0; end != s + 1 && v >= 0 && i < sizeof(units) / sizeof(units[0]); ++i) {
+			if (end[0] == units[i].unit && end[1] == '\0') {
+				*out = now - (int64_t)(v * (double)units[i].ns);
+				return 0;
+			}
+		}
+		return -1;
+	}
+	if (s[0] == '@') {
+		double v = strtod(s + 1, &end);
+		if (end == s + 1 || *end) {
+			return -1;
+		}
+		*out = (int64_t)(v * 1e9);
+		return 0;
+	}
+
+	static const char *const formats[] = {"%Y-%m-%d %H:%M:%S", "%Y-%m-%dT%H:%M:%S", "%Y-%m-%d %H:%M",
+					      "%Y-%m-%dT%H:%M", "%Y-%m-%d"};
+	for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); ++i) {
+		struct tm tm = {0};
+		end = strptime(s, formats[i], &tm);
+		if (end && *end == '\0') {
+			tm.tm_isdst = -1;
+			*out = (int64_t)mktime(&tm) * 1000000000;
+			return 0;
+		}
+	}
+	return -1;
+}
+
+static char *trim(char *s) {
+	s += strspn(s, " \t");
+	char *end = s + strlen(s);
+	while (end > s && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\n' || end[-1] == '\r')) {
+		*--end = '\0';
+	}
+	return s;
+}
+
+/*
+ * sensor_add() - Sensor by name, created on first use
+ * RETURNS: index, or -1 if the name is too long or the table is full
+ */
+static int sensor_add(const char *name) {
+	for (int i = 0; i < nsensors; ++i) {
+		if (strcmp(sensors[i].name, name) == 0) {
+			return i;
+		}
+	}
+	if (nsensors == MAX_SENSORS || strlen(name) >= NCT_LOG_NAME_MAX) {
+		return -1;
+	}
+	struct sensor *s = &sensors[nsensors];
+	snprintf(s->name, sizeof(s->name), "%s", name);
+	s->recorded_max = -1e9;
+	return nsensors++;
+}
+
+/*
+ * chip_temp_index() - K of a chip input "tempK_input", by attribute or label
+ * WHY: pwmN_temp_sel and pwmN_weight_temp_sel select chip inputs only
+ * RETURNS: K, or -1 (not a chip temperature, or not seen in the log)
+ */
+static int chip_temp_index(const struct sensor *s) {
+	const char *attr = s->attr[0] ? s->attr : s->name;
+	char *end;
+	if (strncmp(attr, "temp", 4) != 0) {
+		return -1;
+	}
+	long k = strtol(attr + 4, &end, 10);
+	return end != attr + 4 && strcmp(end, "_input") == 0 && k >= 1 && k <= 16 ? (int)k : -1;
+}
+
+/*
+ * parse_rpm_table() - "255:1320, 224:1200~, ..." into duty -> airflow
+ * HOW: Linear between measured steps, 0 below stall_duty, relative to
+ *      max_rpm; '~' (unsettled) steps are used as measured
+ */
+static int parse_rpm_table(struct header *h, char *v) {
+	int duty[MAX_RPM_STEPS], rpm[MAX_RPM_STEPS], n = 0;
+	for (char *save, *tok = strtok_r(v, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+		char *end;
+		long d = strtol(tok, &end, 10);
+		if (*end != ':' || d < 0 || d > 255 || n == MAX_RPM_STEPS) {
+			return -1;
+		}
+		long r = strtol(end + 1, &end, 10);
+		if (r < 0 || (*end && *end != '~')) {
+			return -1;
+		}
+		/* insertion sort by duty: the descending pass lists them high to low */
+		int i = n++;
+		for (; i > 0 && duty[i - 1] > d; --i) {
+			duty[i] = duty[i - 1];
+			rpm[i] = rpm[i - 1];
+		}
+		duty[i] = (int)d;
+		rpm[i] = (int)r;
+	}
+	if (n < 2 || h->max_rpm <= 0) {
+		return n == 0 ? 0 : -1;
+	}
+	for (int d = 0; d < 256; ++d) {
+		double r;
+		if (d <= duty[0]) {
+			r = rpm[0];
+		} else if (d >= duty[n - 1]) {
+			r = rpm[n - 1];
+		} else {
+			int i = 1;
+			while (duty[i] < d) {
+				i++;
+			}
+			r = rpm[i - 1] + (double)(rpm[i] - rpm[i - 1]) * (d - duty[i - 1]) / (duty[i] - duty[i - 1]);
+		}
+		h->air[d] = d < h->stall_duty ? 0.0 : r / h->max_rpm;
+	}
+	return 0;
+}
+
+/*
+ * load_model() - The [pwmN] sections of an nct-characterize model
+ * RETURNS: 0, or -1 after logging the first bad line
+ */
+static int load_model(const char *path) {
+	FILE *in = fopen(path, "re");
+	if (!in) {
+		fprintf(stderr, "[ERROR] Cannot open model %s: %s\n", path, strerror(errno));
+		return -1;
+	}
+	char buf[1024];
+	char table[MAX_PWM + 1][1024] = {{0}};
+	int line = 0, cur = 0, bad = 0;
+	while (fgets(buf, sizeof(buf), in)) {
+		line++;
+		buf[strcspn(buf, "#")] = '\0';
+		char *s = trim(buf);
+		char *eq = strchr(s, '=');
+		if (!*s) {
+			continue;
+		}
+		if (*s == '[') {
+			char *end;
+			cur = strncmp(s, "[pwm", 4) == 0 ? (int)strtol(s + 4, &end, 10) : 0;
+			if (cur < 1 || cur > MAX_PWM || strcmp(end, "]") != 0) {
+				bad = bad ? bad : line;
+				cur = 0;
+			}
+			continue;
+		}
+		if (!cur || !eq) {
+			bad = bad ? bad : line;
+			continue;
+		}
+		*eq = '\0';
+		char *key = trim(s), *value = trim(eq + 1);
+		struct header *h = &headers[cur];
+		if (strcmp(key, "connected") == 0) {
+			h->connected = strcmp(value, "yes") == 0;
+		} else if (strcmp(key, "responds") == 0) {
+			h->responds = strcmp(value, "yes") == 0;
+		} else if (strcmp(key, "stall_duty") == 0) {
+			h->stall_duty = atoi(value);
+		} else if (strcmp(key, "max_rpm") == 0) {
+			h->max_rpm = atoi(value);
+		} else if (strcmp(key, "rpm_down") == 0) {
+			snprintf(table[cur], sizeof(table[cur]), "%s", value);
+		}
+	}
+	fclose(in);
+	for (int n = 1; !bad && n <= MAX_PWM; ++n) {
+		struct header *h = &headers[n];
+		if (h->connected && (parse_rpm_table(h, table[n]) < 0 || h->max_rpm <= 0)) {
+			fprintf(stderr, "[ERROR] %s: [pwm%d] has no usable rpm_down/max_rpm\n", path, n);
+			return -1;
+		}
+	}
+	if (bad) {
+		fprintf(stderr, "[ERROR] %s:%d is not an nct-characterize model\n", path, bad);
+		return -1;
+	}
+	return 0;
+}
+
+static double conductance(double a) {
+	return passive + pow(a, AIRFLOW_EXP);
+}
+
+/*
+ * struct reader - Column map and thinning state while scanning the log
+ */
+struct reader {
+	int64_t from_ns, to_ns, bucket_ns;
+	int64_t bucket;                 /* current bucket number, -1 = none */
+	struct sample pending;
+	double pending_excess;
+	bool have_pending;
+	uint64_t files, decoded;
+};
+
+static int sample_push(const struct sample *s) {
+	if (nsamples == sample_cap) {
+		size_t cap = sample_cap ? sample_cap * 2 : 4096;
+		struct sample *p = realloc(samples, cap * sizeof(*p));
+		if (!p) {
+			return -1;
+		}
+		samples = p;
+		sample_cap = cap;
+	}
+	samples[nsamples++] = *s;
+	return 0;
+}
+
+/*
+ * thin() - Keep the hottest sample of every --resolution bucket
+ * WHY: The ceiling is checked against peaks; the duty objective only
+ *      needs the time spent hot, which one sample per minute preserves
+ */
+static int thin(struct reader *r, int64_t t_ns, const struct sample *s) {
+	double excess = -1e9;
+	for (int i = 0; i < nsensors; ++i) {
+		if (sensors[i].ceiling > 0 && s->t[i] - sensors[i].ceiling > excess) {
+			excess = s->t[i] - sensors[i].ceiling;
+		}
+	}
+	int64_t bucket = t_ns / r->bucket_ns;
+	if (r->have_pending && bucket != r->bucket) {
+		if (sample_push(&r->pending) < 0) {
+			return -1;
+		}
+		r->have_pending = false;
+	}
+	if (!r->have_pending || excess > r->pending_excess) {
+		r->pending = *s;
+		r->pending_excess = excess;
+		r->have_pending = true;
+		r->bucket = bucket;
+	}
+	return 0;
+}
+
+/*
+ * read_file() - Decode one mapped log file into thinned samples
+ * RETURNS: 0, 1 if the file lacks a needed channel (skipped), -1 on error
+ */
+static int read_file(struct reader *r, const char *path, const void *map, size_t size) {
+	if (!nct_log_file_ok(map, size)) {
+		fprintf(stderr, "[WARN] %s: not a version %d telemetry log, skipped\n", path, NCT_LOG_VERSION);
+		return 1;
+	}
+	const struct nct_log_file *f = map;
+	int scol[MAX_SENSORS], pcol[MAX_PWM + 1];
+	for (int i = 0; i < nsensors; ++i) {
+		scol[i] = -1;
+	}
+	for (int n = 0; n <= MAX_PWM; ++n) {
+		pcol[n] = -1;
+	}
+	for (uint32_t c = 0; c < f->nchannels; ++c) {
+		char name[NCT_LOG_NAME_MAX], label[NCT_LOG_NAME_MAX];
+		memcpy(name, f->channels[c].name, sizeof(name));
+		memcpy(label, f->channels[c].label, sizeof(label));
+		name[sizeof(name) - 1] = label[sizeof(label) - 1] = '\0';
+		for (int i = 0; i < nsensors; ++i) {
+			if (strcmp(sensors[i].name, name) == 0 || (label[0] && strcmp(sensors[i].name, label) == 0)) {
+				scol[i] = (int)c;
+				snprintf(sensors[i].attr, sizeof(sensors[i].attr), "%s", name);
+				snprintf(sensors[i].label, sizeof(sensors[i].label), "%s", label);
+			}
+		}
+		char *end;
+		long n = strncmp(name, "pwm", 3) == 0 ? strtol(name + 3, &end, 10) : 0;
+		if (n >= 1 && n <= MAX_PWM && *end == '\0') {
+			pcol[n] = (int)c;
+		}
+	}
+	for (int i = 0; i < nsensors; ++i) {
+		if (scol[i] < 0) {
+			fprintf(stderr, "[WARN] %s: no channel %s, skipped\n", path, sensors[i].name);
+			return 1;
+		}
+	}
+	for (int n = 1; n <= MAX_PWM; ++n) {
+		if (headers[n].connected && pcol[n] < 0) {
+			fprintf(stderr, "[WARN] %s: no channel pwm%d (fan in the model), skipped\n", path, n);
+			return 1;
+		}
+	}
+	r->files++;
+
+	size_t off = f->header_size;
+	const struct nct_log_block *b;
+	static struct nct_log_cursor c;
+	while ((b = nct_log_next_block(map, size, &off))) {
+		if (b->t_last_ns < r->from_ns || b->t_first_ns > r->to_ns) {
+			continue;
+		}
+		if (!nct_log_block_verify(b, f->nchannels)) {
+			fprintf(stderr, "[WARN] %s: corrupt block; rest of file skipped\n", path);
+			break;
+		}
+		r->decoded++;
+		nct_log_cursor_init(&c, f, b);
+		int rc;
+		while ((rc = nct_log_cursor_next(&c)) > 0) {
+			if (c.t_ns < r->from_ns || c.t_ns > r->to_ns) {
+				continue;
+			}
+			struct sample s = {0};
+			bool valid = true;
+			for (int i = 0; i < nsensors && valid; ++i) {
+				int32_t v = c.values[scol[i]];
+				valid = v != NCT_LOG_INVALID;
+				s.t[i] = (float)(v / 1000.0);
+			}
+			for (int n = 1; n <= MAX_PWM && valid; ++n) {
+				if (pcol[n] >= 0) {
+					int32_t v = c.values[pcol[n]];
+					valid = v != NCT_LOG_INVALID;
+					s.duty[n] = (uint8_t)(v < 0 ? 0 : v > 255 ? 255 : v);
+				}
+			}
+			if (!valid) {
+				continue;
+			}
+			for (int i = 0; i < nsensors; ++i) {
+				coolest = s.t[i] < coolest ? s.t[i] : coolest;
+				if (s.t[i] > sensors[i].recorded_max) {
+					sensors[i].recorded_max = s.t[i];
+				}
+			}
+			if (thin(r, c.t_ns, &s) < 0) {
+				return -1;
+			}
+		}
+		if (rc < 0) {
+			fprintf(stderr, "[WARN] %s: corrupt payload; rest of file skipped\n", path);
+			break;
+		}
+	}
+	return 0;
+}
+
+static int log_filter(const struct dirent *d) {
+	size_t len = strlen(d->d_name);
+	return strncmp(d->d_name, "nct-", 4) == 0 && len > 8 && strcmp(d->d_name + len - 4, ".log") == 0;
+}
+
+/*
+ * read_log() - Every log file in dir, oldest first, into samples[]
+ * RETURNS: 0, or -1 after logging
+ */
+static int read_log(struct reader *r, const char *dir) {
+	struct dirent **names;
+	int n = scandir(dir, &names, log_filter, alphasort);
+	if (n < 0) {
+		fprintf(stderr, "[ERROR] Cannot list %s: %s\n", dir, strerror(errno));
+		return -1;
+	}
+	int rc = 0;
+	for (int i = 0; i < n; ++i) {
+		char path[4096];
+		snprintf(path, sizeof(path), "%s/%s", dir, names[i]->d_name);
+		free(names[i]);
+		if (rc < 0) {
+			continue;
+		}
+		int fd = open(path, O_RDONLY | O_CLOEXEC);
+		struct stat st;
+		if (fd < 0 || fstat(fd, &st) < 0 || st.st_size == 0) {
+			if (fd >= 0) {
+				close(fd);
+			}
+			continue;
+		}
+		void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+		close(fd);
+		if (map == MAP_FAILED) {
+			fprintf(stderr, "[WARN] %s: mmap: %s\n", path, strerror(errno));
+			continue;
+		}
+		if (read_file(r, path, map, (size_t)st.st_size) < 0) {
+			fprintf(stderr, "[ERROR] Out of memory reading %s\n", path);
+			rc = -1;
+		}
+		munmap(map, (size_t)st.st_size);
+	}
+	free(names);
+	if (rc == 0 && r->have_pending && sample_push(&r->pending) < 0) {
+		rc = -1;
+	}
+	return rc;
+}
+
+/*
+ * build_curve() - Seven points from a header's T0/T6/d0/gamma
+ * RETURNS: 0, or -1 if the span is too narrow for 7 rising integer points
+ */
+static int build_curve(struct header *h) {
+	if (h->t6 - h->t0 < MAX_POINTS - 1 || h->t6 > TEMP_MAX || h->d0 > 255) {
+		return -1;
+	}
+	for (int i = 0; i < MAX_POINTS; ++i) {
+		double x = (double)i / (MAX_POINTS - 1);
+		h->pt_temp[i] = h->t0 + (int)lround((h->t6 - h->t0) * x);
+		h->pt_duty[i] = h->d0 + (int)lround((255 - h->d0) * pow(x, gamma_values[h->gamma_i]));
+	}
+	return 0;
+}
+
+/*
+ * header_duty() - SmartFan IV duty of a candidate at the given temperatures
+ * HOW: Flat below point 1 and above point 7, linear between; weighting
+ *      adds weight_duty_step per weight_temp_step above _step_base
+ */
+static int header_duty(const struct header *h, double t_in, double t_w) {
+	int duty;
+	if (t_in <= h->pt_temp[0]) {
+		duty = h->pt_duty[0];
+	} else if (t_in >= h->pt_temp[MAX_POINTS - 1]) {
+		duty = h->pt_duty[MAX_POINTS - 1];
+	} else {
+		int i = 1;
+		while (h->pt_temp[i] < t_in) {
+			i++;
+		}
+		duty = h->pt_duty[i - 1] + (int)lround((h->pt_duty[i] - h->pt_duty[i - 1]) * (t_in - h->pt_temp[i - 1]) /
+						      (h->pt_temp[i] - h->pt_temp[i - 1]));
+	}
+	if (h->w_duty && t_w > h->w_base) {
+		duty += h->w_duty * (int)((t_w - h->w_base) / h->w_step);
+	}
+	return duty < 255 ? duty : 255;
+}
+
+/*
+ * airflow_at() - Airflow the optimized headers produce if the chassis
+ *                airflow is a (and the sensors settle accordingly)
+ */
+static double airflow_at(const struct sample *s, double a, double *temps, int *duty) {
+	double r = s->glog / conductance(a);
+	for (int i = 0; i < nsensors; ++i) {
+		temps[i] = s->t[i] > ambient ? ambient + (s->t[i] - ambient) * r : s->t[i];
+	}
+	double total = s->afix;
+	for (int n = 1; n <= MAX_PWM; ++n) {
+		const struct header *h = &headers[n];
+		if (!h->optimize) {
+			continue;
+		}
+		duty[n] = header_duty(h, temps[h->in_sensor], h->w_sensor >= 0 ? temps[h->w_sensor] : 0.0);
+		total += h->air[duty[n]];
+	}
+	return total;
+}
+
+/*
+ * evaluate() - Replay the thinned log under the current candidates
+ */
+static void evaluate(struct score *sc) {
+	double temps[MAX_SENSORS];
+	int duty[MAX_PWM + 1];
+	double amax = 0.0;
+	for (int n = 1; n <= MAX_PWM; ++n) {
+		amax += headers[n].connected ? 1.0 : 0.0;
+	}
+
+	memset(sc, 0, sizeof(*sc));
+	for (int i = 0; i < nsensors; ++i) {
+		sc->tmax[i] = -1e9;
+	}
+	for (size_t k = 0; k < nsamples; ++k) {
+		const struct sample *s = &samples[k];
+		double lo = 0.0, hi = amax;
+		for (int it = 0; it < BISECT_STEPS; ++it) {
+			double mid = (lo + hi) / 2;
+			if (airflow_at(s, mid, temps, duty) > mid) {
+				lo = mid;
+			} else {
+				hi = mid;
+			}
+		}
+		/* settle on the cooler end of the bracket: never under-predict */
+		airflow_at(s, lo, temps, duty);
+		for (int i = 0; i < nsensors; ++i) {
+			sc->tmax[i] = temps[i] > sc->tmax[i] ? temps[i] : sc->tmax[i];
+		}
+		for (int n = 1; n <= MAX_PWM; ++n) {
+			if (headers[n].optimize) {
+				double air = headers[n].air[duty[n]];
+				sc->duty += duty[n];
+				sc->power += air * air * air;
+			}
+		}
+	}
+	if (nsamples) {
+		sc->duty /= (double)nsamples;
+		sc->power /= (double)nsamples;
+	}
+	for (int i = 0; i < nsensors; ++i) {
+		double over = sc->tmax[i] - (sensors[i].ceiling - margin);
+		if (sensors[i].ceiling > 0 && over > 0) {
+			sc->violation += over;
+		}
+	}
+	evaluations++;
+}
+
+static bool better(const struct score *a, const struct score *b) {
+	if (a->violation < b->violation - 1e-6) {
+		return true;
+	}
+	return a->violation <= b->violation + 1e-6 && a->duty < b->duty - 1e-6;
+}
+
+/*
+ * try_value() - Set one coordinate, keep it if the result is better
+ * RETURNS: true if *best improved
+ */
+static bool try_value(struct header *h, int *field, int value, struct score *best) {
+	struct header saved = *h;
+	*field = value;
+	if (build_curve(h) == 0) {
+		struct score sc;
+		evaluate(&sc);
+		if (better(&sc, best)) {
+			*best = sc;
+			return true;
+		}
+	}
+	*h = saved;
+	return false;
+}
+
+#define TRY_LIST(h, field, list, best, improved) \
+	for (size_t _i = 0; _i < sizeof(list) / sizeof((list)[0]); ++_i) { \
+		improved |= try_value(h, &(h)->field, (list)[_i], best); \
+	}
+
+/*
+ * search() - Coordinate descent over every optimized header's parameters
+ */
+static void search(struct score *best) {
+	for (int round = 0; round < 8; ++round) {
+		bool improved = false;
+		for (int n = 1; n <= MAX_PWM; ++n) {
+			struct header *h = &headers[n];
+			if (!h->optimize) {
+				continue;
+			}
+			int floor = h->stall_duty + AUTO_MARGIN;
+			int d0_values[9];
+			for (int k = 0; k < 9; ++k) {
+				d0_values[k] = floor + 16 * k < 255 ? floor + 16 * k : 255;
+			}
+			TRY_LIST(h, t0, t0_values, best, improved);
+			TRY_LIST(h, t6, t6_values, best, improved);
+			TRY_LIST(h, d0, d0_values, best, improved);
+			for (int g = 0; g < (int)(sizeof(gamma_values) / sizeof(gamma_values[0])); ++g) {
+				improved |= try_value(h, &h->gamma_i, g, best);
+			}
+			if (h->w_sensor >= 0) {
+				TRY_LIST(h, w_base, wbase_values, best, improved);
+				TRY_LIST(h, w_step, wstep_values, best, improved);
+				TRY_LIST(h, w_duty, wduty_values, best, improved);
+			}
+		}
+		if (!improved) {
+			break;
+		}
+	}
+}
+
+/*
+ * polish() - Lower single points of the parametric curves while it pays
+ * WHY: The parametric family is smooth; the best curve often has a knee
+ *      (quiet up to the load's usual temperature, steep after) that only
+ *      point-wise moves reach
+ */
+static void polish(struct score *best) {
+	static const int steps[] = {-8, -4, -2, -1};
+	for (int round = 0; round < POLISH_ROUNDS; ++round) {
+		bool improved = false;
+		for (int n = 1; n <= MAX_PWM; ++n) {
+			struct header *h = &headers[n];
+			int floor = h->stall_duty + AUTO_MARGIN;
+			for (int i = 0; h->optimize && i < MAX_POINTS - 1; ++i) {
+				for (size_t s = 0; s < sizeof(steps) / sizeof(steps[0]); ++s) {
+					int old = h->pt_duty[i];
+					int d = old + steps[s];
+					if (d < floor || (i > 0 && d < h->pt_duty[i - 1])) {
+						continue;
+					}
+					h->pt_duty[i] = d;
+					struct score sc;
+					evaluate(&sc);
+					if (better(&sc, best)) {
+						*best = sc;
+						improved = true;
+						break;
+					}
+					h->pt_duty[i] = old;
+				}
+				/* a later point is the other way to delay the ramp */
+				if (i > 0 && h->pt_temp[i] + 1 < h->pt_temp[i + 1]) {
+					h->pt_temp[i]++;
+					struct score sc;
+					evaluate(&sc);
+					if (better(&sc, best)) {
+						*best = sc;
+						improved = true;
+					} else {
+						h->pt_temp[i]--;
+					}
+				}
+			}
+		}
+		if (!improved) {
+			break;
+		}
+	}
+}
+
+/*
+ * write_profile() - The optimized headers as nct-profile sections
+ * RETURNS: 0, or -1 after logging (PROFILE.tmp + rename: a failed run
+ *          keeps the previous file)
+ */
+static int write_profile(const char *path, const char *model_path, const char *dir, const struct score *sc,
+			 const struct score *recorded) {
+	char tmp[4096];
+	FILE *out = stdout;
+	if (path) {
+		snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+		out = fopen(tmp, "we");
+		if (!out) {
+			fprintf(stderr, "[ERROR] Cannot create %s: %s\n", tmp, strerror(errno));
+			return -1;
+		}
+	}
+
+	time_t now = time(NULL);
+	char stamp[32];
+	strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%S%z", localtime(&now));
+	fprintf(out, "# nct-tune profile, %s\n", stamp);
+	fprintf(out, "# log %s (%zu samples), model %s\n", dir, nsamples, model_path);
+	fprintf(out, "# ambient %.1f C, passive %.2f, margin %.1f C\n", ambient, passive, margin);
+	for (int i = 0; i < nsensors; ++i) {
+		if (sensors[i].ceiling > 0) {
+			fprintf(out, "# ceiling %s %.0f C: recorded max %.1f C, predicted max %.1f C\n", sensors[i].name,
+				sensors[i].ceiling, sensors[i].recorded_max, sc->tmax[i]);
+		}
+	}
+	fprintf(out, "# mean total duty %.0f -> %.0f, fan power %.0f%% of recorded\n", recorded->duty, sc->duty,
+		recorded->power > 0 ? 100.0 * sc->power / recorded->power : 100.0);
+	fprintf(out, "# Each curve follows the chip's pwmN_temp_sel; it must be the input named below.\n");
+	fprintf(out, "model = %s\n", model_path);
+	for (int n = 1; n <= MAX_PWM; ++n) {
+		const struct header *h = &headers[n];
+		if (!h->optimize) {
+			continue;
+		}
+		const struct sensor *in = &sensors[h->in_sensor];
+		fprintf(out, "\n# pwm%d follows %s%s%s%s\n[pwm%d]\nmode = smartfan\ncurve =", n, in->attr,
+			in->label[0] ? " (" : "", in->label, in->label[0] ? ")" : "", n);
+		for (int i = 0; i < MAX_POINTS; ++i) {
+			fprintf(out, "%s %d:%d", i ? "," : "", h->pt_temp[i], h->pt_duty[i]);
+		}
+		fputc('\n', out);
+		if (h->w_sensor >= 0 && h->w_duty) {
+			fprintf(out, "weight_sensor = %d\nweight_temp_step = %d\nweight_temp_step_base = %d\n"
+				"weight_duty_step = %d\nweight_temp_step_tol = %d\n",
+				chip_temp_index(&sensors[h->w_sensor]), h->w_step, h->w_base, h->w_duty, h->w_step > 1 ? 1 : 0);
+		}
+	}
+
+	if (!path) {
+		return fflush(out) == 0 ? 0 : -1;
+	}
+	bool ok = fflush(out) == 0 && fsync(fileno(out)) == 0;
+	ok = fclose(out) == 0 && ok;
+	if (!ok || rename(tmp, path) < 0) {
+		fprintf(stderr, "[ERROR] Cannot write %s: %s\n", path, strerror(errno));
+		unlink(tmp);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * parse_n_channel() - "N:CHANNEL" for --header / --weight
+ * RETURNS: 0 with *n and *sensor, or -1
+ */
+static int parse_n_channel(const char *arg, int *n, int *sensor) {
+	char *end;
+	long v = strtol(arg, &end, 10);
+	if (end == arg || v < 1 || v > MAX_PWM || (*end && *end != ':')) {
+		return -1;
+	}
+	*n = (int)v;
+	*sensor = -1;
+	if (*end == ':' && (*sensor = sensor_add(end + 1)) < 0) {
+		return -1;
+	}
+	return 0;
+}
+
+static void usage(FILE *out, const char *prog) {
+	fprintf(out,
+		"Usage: %s --target CHANNEL:C [--target ...] [--model MODEL] [--header N[:CHANNEL]]...\n"
+		"       [--weight N:CHANNEL]... [--dir DIR] [--from TIME] [--to TIME] [--resolution S]\n"
+		"       [--ambient C] [--passive G] [--margin C] [-o PROFILE]\n"
+		"  --target CH:C    ceiling for CH (attribute or label), repeatable\n"
+		"  --model MODEL    nct-characterize model (default %s)\n"
+		"  --header N:CH    optimize pwmN, whose pwmN_temp_sel is chip input CH\n"
+		"                   (default: every responding header, first --target)\n"
+		"  --weight N:CH    also search pwmN weighting by chip input CH\n"
+		"  --dir DIR        telemetry log (default %s)\n"
+		"  --from/--to TIME range, as nct-query (default -7d .. now)\n"
+		"  --resolution S   keep the hottest sample per S seconds (default %d)\n"
+		"  --ambient C      intake temperature (default: coolest logged value)\n"
+		"  --passive G      conductance with all fans stopped (default %.2f)\n"
+		"  --margin C       predicted headroom below each ceiling (default %.0f)\n"
+		"  -o PROFILE       write the profile here instead of stdout\n",
+		prog, DEFAULT_MODEL, NCT_LOG_DIR, RESOLUTION_DEFAULT, PASSIVE_DEFAULT, MARGIN_DEFAULT);
+}
+
+/*
+ * main() - Entry point
+ * STRATEGY:
+ *   1. Parse targets/headers into the sensor table, load the model
+ *   2. Read and thin the log; fix ambient and the recorded airflow
+ *   3. Score the recorded run and the static default, then search
+ *   4. Report, and write the profile if every ceiling holds
+ */
+int main(int argc, char **argv) {
+	static const struct option longopts[] = {
+		{"model", required_argument, NULL, 'm'},
+		{"target", required_argument, NULL, 'T'},
+		{"header", required_argument, NULL, 'H'},
+		{"weight", required_argument, NULL, 'W'},
+		{"dir", required_argument, NULL, 'd'},
+		{"from", required_argument, NULL, 'f'},
+		{"to", required_argument, NULL, 't'},
+		{"resolution", required_argument, NULL, 'r'},
+		{"ambient", required_argument, NULL, 'a'},
+		{"passive", required_argument, NULL, 'p'},
+		{"margin", required_argument, NULL, 'M'},
+		{"output", required_argument, NULL, 'o'},
+		{"help", no_argument, NULL, 'h'},
+		{NULL, 0, NULL, 0},
+	};
+
+	const char *model_path = DEFAULT_MODEL, *dir = NCT_LOG_DIR, *from = "-7d", *to = "now", *output = NULL;
+	int resolution = RESOLUTION_DEFAULT;
+	int header_in[MAX_PWM + 1], header_w[MAX_PWM + 1];
+	bool header_given[MAX_PWM + 1] = {false};
+	int first_target = -1;
+	for (int n = 0; n <= MAX_PWM; ++n) {
+		header_in[n] = header_w[n] = -1;
+	}
+
+	int opt;
+	while ((opt = getopt_long(argc, argv, "m:T:H:W:d:f:t:r:a:p:M:o:h", longopts, NULL)) != -1) {
+		char *colon, *end;
+		int n, s;
+		switch (opt) {
+		case 'm':
+			model_path = optarg;
+			break;
+		case 'T':
+			colon = strrchr(optarg, ':');
+			if (!colon) {
+				fprintf(stderr, "[ERROR] --target needs CHANNEL:C, got \"%s\"\n", optarg);
+				return 2;
+			}
+			*colon = '\0';
+			s = sensor_add(optarg);
+			if (s < 0) {
+				fprintf(stderr, "[ERROR] --target %s: name too long or too many channels\n", optarg);
+				return 2;
+			}
+			sensors[s].ceiling = strtod(colon + 1, &end);
+			if (end == colon + 1 || *end || sensors[s].ceiling <= 0 || sensors[s].ceiling > TEMP_MAX) {
+				fprintf(stderr, "[ERROR] --target %s: ceiling must be 1-%d C\n", optarg, TEMP_MAX);
+				return 2;
+			}
+			first_target = first_target < 0 ? s : first_target;
+			break;
+		case 'H':
+		case 'W':
+			if (parse_n_channel(optarg, &n, &s) < 0 || (opt == 'W' && s < 0)) {
+				fprintf(stderr, "[ERROR] --%s \"%s\": expected N%s with N 1-%d\n", opt == 'H' ? "header" : "weight",
+					optarg, opt == 'H' ? "[:CHANNEL]" : ":CHANNEL", MAX_PWM);
+				return 2;
+			}
+			if (opt == 'H') {
+				header_given[n] = true;
+				header_in[n] = s;
+			} else {
+				header_w[n] = s;
+			}
+			break;
+		case 'd':
+			dir = optarg;
+			break;
+		case 'f':
+			from = optarg;
+			break;
+		case 't':
+			to = optarg;
+			break;
+		case 'r':
+			resolution = atoi(optarg);
+			if (resolution < 1 || resolution > 3600) {
+				fprintf(stderr, "[ERROR] --resolution must be 1-3600 s\n");
+				return 2;
+			}
+			break;
+		case 'a':
+			ambient = strtod(optarg, &end);
+			if (end == optarg || *end || ambient < -20 || ambient > 60) {
+				fprintf(stderr, "[ERROR] --ambient must be -20-60 C\n");
+				return 2;
+			}
+			break;
+		case 'p':
+			passive = strtod(optarg, &end);
+			if (end == optarg || *end || passive <= 0 || passive > 10) {
+				fprintf(stderr, "[ERROR] --passive must be above 0 and at most 10\n");
+				return 2;
+			}
+			break;
+		case 'M':
+			margin = strtod(optarg, &end);
+			if (end == optarg || *end || margin < 0 || margin > 30) {
+				fprintf(stderr, "[ERROR] --margin must be 0-30 C\n");
+				return 2;
+			}
+			break;
+		case 'o':
+			output = strcmp(optarg, "-") == 0 ? NULL : optarg;
+			break;
+		case 'h':
+			usage(stdout, argv[0]);
+			return 0;
+		default:
+			usage(stderr, argv[0]);
+			return 2;
+		}
+	}
+	if (first_target < 0 || optind != argc) {
+		usage(stderr, argv[0]);
+		return 2;
+	}
+	if (load_model(model_path) < 0) {
+		return 2;
+	}
+
+	bool any_given = false;
+	for (int n = 1; n <= MAX_PWM; ++n) {
+		any_given |= header_given[n];
+	}
+	int noptimize = 0;
+	for (int n = 1; n <= MAX_PWM; ++n) {
+		struct header *h = &headers[n];
+		h->optimize = any_given ? header_given[n] : h->connected && h->responds;
+		h->in_sensor = header_in[n] >= 0 ? header_in[n] : first_target;
+		h->w_sensor = header_w[n];
+		if (h->optimize && !(h->connected && h->responds)) {
+			fprintf(stderr, "[ERROR] pwm%d: the model has no responding fan on it\n", n);
+			return 2;
+		}
+		if (h->w_sensor >= 0 && !h->optimize) {
+			fprintf(stderr, "[ERROR] --weight %d: pwm%d is not optimized\n", n, n);
+			return 2;
+		}
+		noptimize += h->optimize;
+	}
+	if (noptimize == 0) {
+		fprintf(stderr, "[ERROR] No header to optimize (%s has no responding fan)\n", model_path);
+		return 2;
+	}
+
+	struct reader r = {.bucket_ns = (int64_t)resolution * 1000000000, .bucket = -1};
+	int64_t now = realtime_ns();
+	if (parse_time(from, now, &r.from_ns) < 0 || parse_time(to, now, &r.to_ns) < 0 || r.from_ns > r.to_ns) {
+		fprintf(stderr, "[ERROR] Cannot parse --from \"%s\" / --to \"%s\" (or from is after to)\n", from, to);
+		return 2;
+	}
+	if (read_log(&r, dir) < 0) {
+		return 2;
+	}
+	if (nsamples == 0) {
+		fprintf(stderr, "[ERROR] No usable samples in %s between --from and --to (files=%llu)\n", dir,
+			(unsigned long long)r.files);
+		return 2;
+	}
+
+	/* Chip-side checks need the attribute names the log resolved */
+	for (int n = 1; n <= MAX_PWM; ++n) {
+		const struct header *h = &headers[n];
+		if (h->optimize && chip_temp_index(&sensors[h->in_sensor]) < 0) {
+			fprintf(stderr, "[ERROR] pwm%d: %s is not a chip input; give --header %d:tempK_input\n", n,
+				sensors[h->in_sensor].name, n);
+			return 2;
+		}
+		if (h->w_sensor >= 0 && chip_temp_index(&sensors[h->w_sensor]) < 0) {
+			fprintf(stderr, "[ERROR] --weight %d: %s is not a chip input\n", n, sensors[h->w_sensor].name);
+			return 2;
+		}
+	}
+	if (isnan(ambient)) {
+		ambient = coolest;
+	}
+	for (size_t k = 0; k < nsamples; ++k) {
+		struct sample *s = &samples[k];
+		double a = 0.0, afix = 0.0;
+		for (int n = 1; n <= MAX_PWM; ++n) {
+			if (headers[n].connected) {
+				a += headers[n].air[s->duty[n]];
+				afix += headers[n].optimize ? 0.0 : headers[n].air[s->duty[n]];
+			}
+		}
+		s->glog = (float)conductance(a);
+		s->afix = (float)afix;
+	}
+	fprintf(stderr, "[INFO] %zu samples (one per %d s) from %llu file(s); %d header(s) to optimize, ambient %.1f C\n",
+		nsamples, resolution, (unsigned long long)r.files, noptimize, ambient);
+
+	/* The recorded run: what the log's own duties did (by construction T' = T) */
+	struct score recorded = {0};
+	for (size_t k = 0; k < nsamples; ++k) {
+		for (int n = 1; n <= MAX_PWM; ++n) {
+			if (headers[n].optimize) {
+				double air = headers[n].air[samples[k].duty[n]];
+				recorded.duty += samples[k].duty[n];
+				recorded.power += air * air * air;
+			}
+		}
+	}
+	recorded.duty /= (double)nsamples;
+	recorded.power /= (double)nsamples;
+
+	for (int n = 1; n <= MAX_PWM; ++n) {
+		struct header *h = &headers[n];
+		memcpy(h->pt_temp, default_temps, sizeof(h->pt_temp));
+		memcpy(h->pt_duty, default_pwms, sizeof(h->pt_duty));
+		h->t0 = default_temps[0];
+		h->t6 = default_temps[MAX_POINTS - 1];
+		h->d0 = default_pwms[0] > h->stall_duty + AUTO_MARGIN ? default_pwms[0] : h->stall_duty + AUTO_MARGIN;
+		h->gamma_i = 2;
+		h->w_base = 60;
+		h->w_step = 2;
+		h->w_duty = 0;
+	}
+	struct score best;
+	evaluate(&best);
+	struct score dflt = best;
+	search(&best);
+	polish(&best);
+
+	for (int i = 0; i < nsensors; ++i) {
+		if (sensors[i].ceiling > 0) {
+			fprintf(stderr, "[INFO] %s <= %.0f C: recorded max %.1f, default curve %.1f, optimized %.1f\n",
+				sensors[i].name, sensors[i].ceiling, sensors[i].recorded_max, dflt.tmax[i], best.tmax[i]);
+		}
+	}
+	fprintf(stderr, "[INFO] mean total duty: recorded %.0f, default curve %.0f, optimized %.0f "
+		"(fan power %.0f%% of recorded); %llu evaluations\n",
+		recorded.duty, dflt.duty, best.duty, recorded.power > 0 ? 100.0 * best.power / recorded.power : 100.0,
+		(unsigned long long)evaluations);
+
+	int rc = 0;
+	if (best.violation > 0) {
+		fprintf(stderr, "[ERROR] No curve keeps every target %.1f C below its ceiling (short by %.1f C);\n"
+			"        raise --target, lower --margin, or add cooling. No profile written\n", margin, best.violation);
+		rc = 1;
+	} else if (write_profile(output, model_path, dir, &best, &recorded) < 0) {
+		rc = 2;
+	} else if (output) {
+		fprintf(stderr, "[INFO] Profile written to %s (compile: nct-profile --compile %s)\n", output, output);
+	}
+	free(samples);
+	return rc;
+}
+
+/*
+ * BUILD & DEPLOYMENT NOTES:
+ *
+ * Compilation (header-only log reader, libm for pow()):
+ *   gcc -std=c23 -O2 -Wall -Wextra -Werror -o nct-tune nct-tune.c -lm
+ *
+ * Installation (in PKGBUILD):
+ *   install -Dm755 nct-tune "$pkgdir/usr/lib/eirikr/nct-tune"
+ *
+ * Cost model:
+ *   One evaluation replays every thinned sample with a 14-step bisection
+ *   over the airflow, each step one curve lookup per optimized header. A
+ *   week at --resolution 60 is ~10000 samples, ~1 ms per evaluation per
+ *   header; a full search is a few thousand evaluations, seconds for a
+ *   whole board. Reading the log is one decode pass (nct-query speed).
+ */
@@ -0,0 +1,212 @@
+/*
+ * nct-uring.c - Batched sysfs re-reads through io_uring (see nct-uring.h)
+ */
+
+#define _GNU_SOURCE
+#include "nct-uring.h"
+
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <stdbool.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+static uint64_t clock_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int uring_enter(int fd, unsigned submit, unsigned wait) {
+	long rc = syscall(__NR_io_uring_enter, fd, submit, wait, wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+	return rc < 0 ? -errno : (int)rc;
+}
+
+/*
+ * nct_uring_open() - Create a ring with fds[] registered as fixed files
+ * HOW:  io_uring_setup(), map the SQ/CQ rings (one mapping with
+ *       IORING_FEAT_SINGLE_MMAP) and the SQE array, register the files.
+ *       The SQEs are filled once here, SQE i reading fixed file i into
+ *       buf[i]: nothing in them changes between ticks, so a tick only
+ *       publishes their indices (the SQ array indirection)
+ * IN:  buf must stay valid, and is the only place reads land, until
+ *       nct_uring_close()
+ * RETURNS: 0, or -errno (u->fd stays -1; the caller falls back to pread)
+ */
+int nct_uring_open(struct nct_uring *u, const int *fds, unsigned nfiles, char (*buf)[NCT_URING_BUF]) {
+	memset(u, 0, sizeof(*u));
+	u->fd = -1;
+	if (nfiles == 0 || nfiles > NCT_URING_FILES_MAX) {
+		return -EINVAL;
+	}
+
+	/*
+	 * One thread submits and reaps, so completion work can wait for our
+	 * next io_uring_enter() (DEFER_TASKRUN) instead of interrupting the
+	 * sampler; kernels before 6.1 reject the flags and get a plain ring
+	 */
+	struct io_uring_params p;
+	memset(&p, 0, sizeof(p));
+	p.flags = IORING_SETUP_SUBMIT_ALL | IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+	long fd = syscall(__NR_io_uring_setup, nfiles, &p);
+	if (fd < 0 && errno == EINVAL) {
+		memset(&p, 0, sizeof(p));
+		fd = syscall(__NR_io_uring_setup, nfiles, &p);
+	}
+	if (fd < 0) {
+		return -errno;
+	}
+
+	u->sq_map_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	u->cq_map_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	u->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+	bool single = p.features & IORING_FEAT_SINGLE_MMAP;
+	if (single && u->cq_map_len > u->sq_map_len) {
+		u->sq_map_len = u->cq_map_len;
+	}
+
+	int err = 0;
+	u->sq_map = mmap(NULL, u->sq_map_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, (int)fd,
+			 IORING_OFF_SQ_RING);
+	if (u->sq_map == MAP_FAILED) {
+		err = -errno;
+		u->sq_map = NULL;
+		goto fail;
+	}
+	u->cq_map = single ? u->sq_map
+			   : mmap(NULL, u->cq_map_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, (int)fd,
+				  IORING_OFF_CQ_RING);
+	if (u->cq_map == MAP_FAILED) {
+		err = -errno;
+		u->cq_map = NULL;
+		goto fail;
+	}
+	u->sqes = mmap(NULL, u->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, (int)fd, IORING_OFF_SQES);
+	if (u->sqes == MAP_FAILED) {
+		err = -errno;
+		u->sqes = NULL;
+		goto fail;
+	}
+
+	char *sq = u->sq_map;
+	char *cq = u->cq_map;
+	u->sq_head = (unsigned *)(sq + p.sq_off.head);
+	u->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+	u->sq_mask = *(unsigned *)(sq + p.sq_off.ring_mask);
+	u->sq_array = (unsigned *)(sq + p.sq_off.array);
+	u->cq_head = (unsigned *)(cq + p.cq_off.head);
+	u->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+	u->cq_mask = *(unsigned *)(cq + p.cq_off.ring_mask);
+	u->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+
+	if (syscall(__NR_io_uring_register, (int)fd, IORING_REGISTER_FILES, fds, nfiles) < 0) {
+		err = -errno;
+		goto fail;
+	}
+
+	for (unsigned i = 0; i < nfiles; ++i) {
+		struct io_uring_sqe *sqe = &u->sqes[i];
+		memset(sqe, 0, sizeof(*sqe));
+		sqe->opcode = IORING_OP_READ;
+		sqe->flags = IOSQE_FIXED_FILE;
+		sqe->fd = (int)i;
+		sqe->addr = (uint64_t)(uintptr_t)buf[i];
+		sqe->len = NCT_URING_BUF - 1;
+		sqe->off = 0;
+		sqe->user_data = i;
+	}
+	u->fd = (int)fd;
+	u->nfiles = nfiles;
+	return 0;
+
+fail:
+	u->fd = (int)fd;
+	nct_uring_close(u);
+	return err;
+}
+
+/*
+ * nct_uring_read() - Re-read every registered file at offset 0, one batch
+ * HOW:  Publish SQE indices 0..nfiles-1 and submit them with one
+ *       io_uring_enter(). Reads that completed inline (sysfs attributes
+ *       normally do) are all reaped on return without another system
+ *       call; reads the kernel punted to its async workers are waited for
+ *       one io_uring_enter() at a time, so each gets its own timestamp
+ * OUT: len[i] bytes read into buf[i] (the buffer given to open), or
+ *      -errno; done_ns[i] (if non-NULL) when completion i was reaped
+ * RETURNS: number of reads submitted and reaped (normally nfiles; the
+ *          rest read -EAGAIN), or -errno if nothing could be submitted
+ */
+int nct_uring_read(struct nct_uring *u, int32_t *len, uint64_t *done_ns) {
+	unsigned tail = *u->sq_tail;
+	for (unsigned i = 0; i < u->nfiles; ++i) {
+		u->sq_array[(tail + i) & u->sq_mask] = i;
+	}
+	__atomic_store_n(u->sq_tail, tail + u->nfiles, __ATOMIC_RELEASE);
+
+	/* Inline completions are the common case: submit, wait for none */
+	int rc;
+	do {
+		rc = uring_enter(u->fd, u->nfiles, 0);
+	} while (rc == -EINTR);
+	if (rc < 0) {
+		/* nothing was consumed: take the SQEs back */
+		__atomic_store_n(u->sq_tail, tail, __ATOMIC_RELEASE);
+		return rc;
+	}
+	unsigned submitted = (unsigned)rc;
+	if (submitted < u->nfiles) {
+		/* the kernel stopped early; the unconsumed entries are dropped */
+		__atomic_store_n(u->sq_tail, tail + submitted, __ATOMIC_RELEASE);
+		for (unsigned i = submitted; i < u->nfiles; ++i) {
+			len[i] = -EAGAIN;
+		}
+	}
+
+	unsigned reaped = 0;
+	while (reaped < submitted) {
+		unsigned head = *u->cq_head;
+		unsigned ctail = __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE);
+		if (head == ctail) {
+			rc = uring_enter(u->fd, 0, 1);
+			if (rc < 0 && rc != -EINTR) {
+				return rc;
+			}
+			continue;
+		}
+		uint64_t now = done_ns ? clock_ns() : 0;
+		for (; head != ctail; ++head) {
+			const struct io_uring_cqe *cqe = &u->cqes[head & u->cq_mask];
+			unsigned i = (unsigned)cqe->user_data;
+			if (i < u->nfiles) {
+				len[i] = cqe->res;
+				if (done_ns) {
+					done_ns[i] = now;
+				}
+			}
+			reaped++;
+		}
+		__atomic_store_n(u->cq_head, head, __ATOMIC_RELEASE);
+	}
+	return (int)reaped;
+}
+
+void nct_uring_close(struct nct_uring *u) {
+	if (u->sqes) {
+		munmap(u->sqes, u->sqes_len);
+	}
+	if (u->cq_map && u->cq_map != u->sq_map) {
+		munmap(u->cq_map, u->cq_map_len);
+	}
+	if (u->sq_map) {
+		munmap(u->sq_map, u->sq_map_len);
+	}
+	if (u->fd >= 0) {
+		close(u->fd);
+	}
+	memset(u, 0, sizeof(*u));
+	u->fd = -1;
+}
@@ -0,0 +1,70 @@
+/*
+ * nct-uring.h - One-syscall batched re-reads of open sysfs attributes
+ *
+ * PURPOSE:
+ *   Let nct-sampler read every channel of every registered hwmon device
+ *   (nct67xx plus k10temp, amdgpu, nvme, ...) per tick with one
+ *   io_uring_enter(2) instead of one pread(2) per attribute.
+ *
+ * WHY:
+ *   A GPU node samples 100+ attributes per tick. Per-attribute syscall
+ *   entry/exit and fd lookup then dominate the sampler's cost, and grow
+ *   with every sensor added. With the attributes registered once as fixed
+ *   files, a tick is one SQE per attribute written into shared memory and
+ *   one system call for the whole batch.
+ *
+ * HOW:
+ *   nct_uring_open() sets up a ring through the raw system calls (no
+ *   liburing dependency; <linux/io_uring.h> only), maps SQ, CQ and SQE
+ *   array, registers the fds and prepares one IORING_OP_READ at offset 0
+ *   per file. nct_uring_read() submits all of them with one
+ *   io_uring_enter() and reaps the completions. Completions the
+ *   kernel could not finish inline (driver-side waits such as amdgpu's
+ *   SMU queries) are reaped as they arrive, each stamped with its
+ *   CLOCK_MONOTONIC completion time for per-device latency.
+ *
+ * FALLBACK:
+ *   nct_uring_open() fails with -ENOSYS, -EPERM (kernel.io_uring_disabled,
+ *   seccomp, containers) or -ENOMEM (RLIMIT_MEMLOCK on old kernels); the
+ *   caller then keeps reading with pread(2) as before.
+ *
+ * CAVEATS:
+ *   - One batch in flight at a time, single-threaded callers
+ *   - At most NCT_URING_FILES_MAX files per ring
+ */
+
+#ifndef NCT_URING_H
+#define NCT_URING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define NCT_URING_FILES_MAX 256
+#define NCT_URING_BUF       24      /* == hwmon_read_int()'s buffer */
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+/*
+ * struct nct_uring - Mapped ring plus the registered file set
+ * sq_* / cq_*: pointers into the kernel-shared rings (see io_uring(7))
+ */
+struct nct_uring {
+	int fd;
+	unsigned nfiles;
+	unsigned *sq_head, *sq_tail, *sq_array;
+	unsigned sq_mask;
+	unsigned *cq_head, *cq_tail;
+	unsigned cq_mask;
+	struct io_uring_sqe *sqes;
+	struct io_uring_cqe *cqes;
+	void *sq_map;
+	void *cq_map;
+	size_t sq_map_len, cq_map_len, sqes_len;
+};
+
+int nct_uring_open(struct nct_uring *u, const int *fds, unsigned nfiles, char (*buf)[NCT_URING_BUF]);
+int nct_uring_read(struct nct_uring *u, int32_t *len, uint64_t *done_ns);
+void nct_uring_close(struct nct_uring *u);
+
+#endif /* NCT_URING_H */
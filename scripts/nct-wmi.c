@@ -0,0 +1,242 @@
+/*
+ * nct-wmi.c - ASUS WMI (RSIO/RHWM) access backend (see nct-wmi.h)
+ *
+ * IMPLEMENTATION NOTES:
+ *   - -DNCT_PORT_SHIM routes the /proc/acpi/call session to the emulator
+ *     (nct-wmi.h); the default build is unchanged
+ */
+
+#define _GNU_SOURCE
+#include "nct-wmi.h"
+#include "nct-sio.h"
+#include "nct-stats.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef NCT_PORT_SHIM
+#define acpi_call_open()             nct_shim_acpi_open()
+#define pwrite(fd, buf, len, off)    nct_shim_acpi_pwrite(fd, buf, len, off)
+#define pread(fd, buf, len, off)     nct_shim_acpi_pread(fd, buf, len, off)
+#else
+#define acpi_call_open()             open(ACPI_CALL_PATH, O_RDWR | O_CLOEXEC)
+#endif
+
+static uint64_t clock_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int read_line(const char *path, char *buf, size_t len) {
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return -1;
+	}
+	ssize_t n = read(fd, buf, len - 1);
+	close(fd);
+	if (n <= 0) {
+		return -1;
+	}
+	buf[n] = '\0';
+	buf[strcspn(buf, "\n")] = '\0';
+	return 0;
+}
+
+/*
+ * resolve_method() - Find the ACPI path of the monitoring WMI method
+ * HOW:  /sys/bus/wmi/devices/<GUID>[-N]/object_id gives "xx"; walk up from
+ *       the device until a firmware_node/path names the PNP0C14 node, and
+ *       append ".WMxx"
+ * RETURNS: 0 with the path in out, -1 if the GUID is not exposed
+ */
+static int resolve_method(char *out, size_t len) {
+	const char *env = getenv("NCT_WMI_METHOD");
+	if (env && *env) {
+		snprintf(out, len, "%s", env);
+		return 0;
+	}
+
+	DIR *dir = opendir(WMI_BUS_PATH);
+	if (!dir) {
+		return -1;
+	}
+
+	int rc = -1;
+	struct dirent *de;
+	while (rc < 0 && (de = readdir(dir)) != NULL) {
+		if (strncasecmp(de->d_name, ASUSWMI_MONITORING_GUID, strlen(ASUSWMI_MONITORING_GUID)) != 0) {
+			continue;
+		}
+
+		char path[PATH_MAX];
+		char object_id[8];
+		snprintf(path, sizeof(path), "%s/%s/object_id", WMI_BUS_PATH, de->d_name);
+		if (read_line(path, object_id, sizeof(object_id)) < 0) {
+			continue;
+		}
+
+		char dev[PATH_MAX];
+		snprintf(path, sizeof(path), "%s/%s", WMI_BUS_PATH, de->d_name);
+		if (!realpath(path, dev)) {
+			continue;
+		}
+		for (int depth = 0; depth < 4 && rc < 0; ++depth) {
+			char *slash = strrchr(dev, '/');
+			if (!slash || slash == dev) {
+				break;
+			}
+			*slash = '\0';
+
+			char acpi_path[128];
+			snprintf(path, sizeof(path), "%.*s/firmware_node/path", PATH_MAX - 32, dev);
+			if (read_line(path, acpi_path, sizeof(acpi_path)) == 0) {
+				snprintf(out, len, "%s.WM%s", acpi_path, object_id);
+				rc = 0;
+			}
+		}
+	}
+	closedir(dir);
+	return rc;
+}
+
+/*
+ * wmi_call() - Invoke one firmware method and parse its Integer result
+ * HOW:  write "<method> 0x0 <id> b<bank><reg><val>00" to /proc/acpi/call,
+ *       pread the result ("0x2a" or "Error: ...") from offset 0
+ */
+static int wmi_call(struct wmi_ctx *ctx, uint32_t method_id, uint8_t bank, uint8_t reg, uint8_t val, uint32_t *ret) {
+	size_t room = sizeof(ctx->cmd) - ctx->prefix_len;
+	int n = snprintf(ctx->cmd + ctx->prefix_len, room, "0x%08X b%02X%02X%02X00\n", method_id, bank, reg, val);
+	if (n < 0 || (size_t)n >= room) {
+		return -EOVERFLOW;
+	}
+
+	uint64_t start = clock_ns();
+	ctx->stats.calls++;
+	ssize_t w = pwrite(ctx->fd, ctx->cmd, ctx->prefix_len + (size_t)n, 0);
+	char result[64];
+	ssize_t r = w < 0 ? -1 : pread(ctx->fd, result, sizeof(result) - 1, 0);
+	uint64_t cost = clock_ns() - start;
+	ctx->stats.call_ns += cost;
+	nct_stats_add(NCT_OP_WMI_CALL, cost);
+	if (w < 0 || r <= 0) {
+		int e = (w < 0 || r < 0) ? errno : EIO;
+		ctx->stats.errors++;
+		return -e;
+	}
+	result[r] = '\0';
+
+	char *end;
+	unsigned long v = strtoul(result, &end, 0);
+	if (end == result || strncmp(result, "Error", 5) == 0) {
+		ctx->stats.errors++;
+		return -EIO;
+	}
+	*ret = (uint32_t)v;
+	return 0;
+}
+
+/*
+ * wmi_open() - Resolve the method, open /proc/acpi/call, prove one call works
+ * RETURNS: 0 on success; -1 with a one-line reason in err
+ */
+int wmi_open(struct wmi_ctx *ctx, char *err, size_t errlen) {
+	memset(ctx, 0, sizeof(*ctx));
+	ctx->fd = -1;
+
+	char method[160];
+	if (resolve_method(method, sizeof(method)) < 0) {
+		snprintf(err, errlen, "ASUS monitoring WMI GUID %s not exposed under %s",
+			 ASUSWMI_MONITORING_GUID, WMI_BUS_PATH);
+		return -1;
+	}
+
+	ctx->fd = acpi_call_open();
+	if (ctx->fd < 0) {
+		snprintf(err, errlen, "cannot open %s (%s); load acpi_call", ACPI_CALL_PATH, strerror(errno));
+		return -1;
+	}
+
+	int n = snprintf(ctx->cmd, sizeof(ctx->cmd), "%s 0x0 ", method);
+	if (n < 0 || (size_t)n >= sizeof(ctx->cmd) - 32) {
+		snprintf(err, errlen, "WMI method path too long");
+		wmi_close(ctx);
+		return -1;
+	}
+	ctx->prefix_len = (size_t)n;
+
+	uint8_t probe;
+	if (wmi_sio_read(ctx, 0x2E, SIO_REG_DEVID_HI, &probe) < 0) {
+		snprintf(err, errlen, "%.*s(RSIO) failed", (int)ctx->prefix_len, ctx->cmd);
+		wmi_close(ctx);
+		return -1;
+	}
+	return 0;
+}
+
+void wmi_close(struct wmi_ctx *ctx) {
+	if (ctx->fd >= 0) {
+		close(ctx->fd);
+		ctx->fd = -1;
+	}
+}
+
+/*
+ * wmi_sio_read() - Read SIO configuration register `reg` behind index port `ioreg`
+ * HOW:  RSIO(ioreg, reg); the firmware enters and leaves extended function
+ *       mode around the access
+ * NOTE: Per-device CRs (0x30, 0x60/0x61, ...) belong to whichever logical
+ *       device CR 0x07 last selected; call wmi_sio_select() first
+ */
+int wmi_sio_read(struct wmi_ctx *ctx, uint8_t ioreg, uint8_t reg, uint8_t *val) {
+	uint32_t ret;
+	int rc = wmi_call(ctx, ASUSWMI_METHODID_RSIO, ioreg, reg, 0, &ret);
+	if (rc == 0) {
+		*val = (uint8_t)ret;
+	}
+	return rc;
+}
+
+/*
+ * wmi_sio_select() - Select logical device `ldn` behind index port `ioreg`
+ * HOW:  WSIO(ioreg, CR 0x07, ldn), as superio_wmi_select() in the driver
+ */
+int wmi_sio_select(struct wmi_ctx *ctx, uint8_t ioreg, uint8_t ldn) {
+	uint32_t ret;
+	return wmi_call(ctx, ASUSWMI_METHODID_WSIO, ioreg, SIO_REG_LDN, ldn, &ret);
+}
+
+int wmi_hwm_read(struct wmi_ctx *ctx, uint16_t reg, uint8_t *val) {
+	uint32_t ret;
+	int rc = wmi_call(ctx, ASUSWMI_METHODID_RHWM, (uint8_t)(reg >> 8), (uint8_t)reg, 0, &ret);
+	if (rc == 0) {
+		*val = (uint8_t)ret;
+	}
+	return rc;
+}
+
+/*
+ * wmi_hwm_read_many() - Read a register list in one WMI session
+ * OUT: out[i] receives regs[i]; 0xFF where a call failed
+ * RETURNS: 0 if every call succeeded, otherwise the last error
+ */
+int wmi_hwm_read_many(struct wmi_ctx *ctx, const uint16_t *regs, size_t n, uint8_t *out) {
+	int rc = 0;
+	for (size_t i = 0; i < n; ++i) {
+		int r = wmi_hwm_read(ctx, regs[i], &out[i]);
+		if (r < 0) {
+			out[i] = 0xFF;
+			rc = r;
+		}
+	}
+	return rc;
+}
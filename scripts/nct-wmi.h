@@ -0,0 +1,91 @@
+/*
+ * nct-wmi.h - ASUS WMI (RSIO/RHWM) access backend for ACPI-locked boards
+ *
+ * PURPOSE:
+ *   Read Super I/O configuration and HWM registers through the same ASUS
+ *   firmware methods the kernel nct6775 driver uses when ACPI reserves the
+ *   ISA ports (see docs/NCT6798D-PROGRAMMER-GUIDE.md section 2.2). Used by
+ *   nct-id when ioperm() is denied, including --dump.
+ *
+ * HOW:
+ *   The monitoring WMI block (GUID ASUSWMI_MONITORING_GUID) is implemented
+ *   by ACPI method WM<object_id> under its PNP0C14 device. The method path
+ *   is resolved once from /sys/bus/wmi/devices/<GUID>/object_id and the
+ *   parent's firmware_node/path, and invoked through the acpi_call module
+ *   (/proc/acpi/call), the kernel's userspace ACPI call interface:
+ *     WMxx(0, METHOD_ID, Buffer{bank, reg, val, 0})  -> Integer
+ *   This mirrors nct6775_asuswmi_evaluate_method() in the kernel driver.
+ *   For RSIO/WSIO the first byte is the SIO index port (0x2E/0x4E), not a
+ *   logical device: like superio_wmi_select(), a logical device is chosen
+ *   by a WSIO write of CR 0x07, and the selection persists in the chip.
+ *
+ * BATCHING:
+ *   The firmware methods read exactly one register per call; there is no
+ *   multi-register method to batch into. What wmi_hwm_read_many() saves is
+ *   everything around the call: one open fd for the whole session, a
+ *   pre-formatted command prefix, and no bank-select calls (the bank is an
+ *   argument of RHWM, so a full bank costs 256 calls, not 256 + 256).
+ *
+ * CAVEATS:
+ *   - Requires root and the acpi_call module (`modprobe acpi_call`)
+ *   - Firmware serialises calls with the kernel driver's own WMI use
+ *   - NCT_WMI_METHOD overrides the resolved method path (e.g. for boards
+ *     whose PNP0C14 node has no firmware_node link)
+ */
+
+#ifndef NCT_WMI_H
+#define NCT_WMI_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#define ASUSWMI_MONITORING_GUID "466747A0-70EC-11DE-8A39-0800200C9A66"
+#define ASUSWMI_METHODID_RSIO   0x5253494F   /* "RSIO": read SIO CR */
+#define ASUSWMI_METHODID_WSIO   0x5753494F   /* "WSIO": write SIO CR */
+#define ASUSWMI_METHODID_RHWM   0x5248574D   /* "RHWM": read HWM register */
+#define ASUSWMI_METHODID_WHWM   0x5748574D   /* "WHWM": write HWM register */
+
+#ifndef WMI_BUS_PATH
+#define WMI_BUS_PATH   "/sys/bus/wmi/devices"
+#endif
+#define ACPI_CALL_PATH "/proc/acpi/call"
+
+/*
+ * struct wmi_stats - Firmware calls issued (--stats)
+ * WHY: An AML method call costs tens to hundreds of microseconds, so call
+ *      count, not port count, is the cost of the WMI path
+ */
+struct wmi_stats {
+	uint64_t calls;
+	uint64_t errors;
+	uint64_t call_ns;
+};
+
+struct wmi_ctx {
+	int fd;                 /* /proc/acpi/call, open for the session */
+	char cmd[256];          /* "<method> 0x0 " prefix + per-call tail */
+	size_t prefix_len;
+	struct wmi_stats stats;
+};
+
+int wmi_open(struct wmi_ctx *ctx, char *err, size_t errlen);
+void wmi_close(struct wmi_ctx *ctx);
+int wmi_sio_read(struct wmi_ctx *ctx, uint8_t ioreg, uint8_t reg, uint8_t *val);
+int wmi_sio_select(struct wmi_ctx *ctx, uint8_t ioreg, uint8_t ldn);
+int wmi_hwm_read(struct wmi_ctx *ctx, uint16_t reg, uint8_t *val);
+int wmi_hwm_read_many(struct wmi_ctx *ctx, const uint16_t *regs, size_t n, uint8_t *out);
+
+#ifdef NCT_PORT_SHIM
+/*
+ * Emulator builds (-DNCT_PORT_SHIM, tests/emu/nct-emu-port.c): the
+ * /proc/acpi/call session goes to the emulator, which evaluates the same
+ * command strings against its register file. Same contract as open(2),
+ * pwrite(2) and pread(2) on the real file
+ */
+int nct_shim_acpi_open(void);
+ssize_t nct_shim_acpi_pwrite(int fd, const void *buf, size_t len, off_t off);
+ssize_t nct_shim_acpi_pread(int fd, void *buf, size_t len, off_t off);
+#endif
+
+#endif /* NCT_WMI_H */
@@ -0,0 +1,78 @@
+#!/bin/bash
+
+################################################################################
+# nct-emu-build.sh - Build the NCT6798D emulator and the tools wired to it
+#
+# USAGE: tests/emu/nct-emu-build.sh DIR
+#   Run from the repository root. DIR (created; tmpfs in CI) receives:
+#     DIR/root/             fake sysfs tree (nct-emu-tree.sh)
+#     DIR/nct-emu-sysfs.so  LD_PRELOAD shim with nct6775 attribute semantics
+#     DIR/nct-id, nct-fan, nct-sampler, nct-bench, nct-fanctl, nct-profile,
+#     DIR/nct-tune          built against the tree and the port emulator
+#     DIR/nct-broker        the same, writable by the building uid
+#     DIR/nct-emu-client    scripted broker client (nct-emu-client.c)
+#     DIR/nct-exporter,     read only the ring (and the local event
+#     DIR/nct-agent         socket), so built as shipped
+#     DIR/run               `DIR/run CMD...` runs CMD with the shim loaded
+#
+# HOW:
+#   The tools are the unmodified sources with build-time overrides only:
+#     -DHWMON_CLASS_PATH / -DHWMON_CACHE_PATH   resolve inside DIR/root
+#     -DHWM_LOCK_PATH                           no /run/lock needed
+#     -DWMI_BUS_PATH                            ASUS WMI GUID in DIR/root
+#     -DNCT_BROKER_WRITER_UID                   broker writes without root
+#     -DNCT_PORT_SHIM + nct-emu-port.c          SIO/HWM ports and the
+#                                               acpi_call WMI methods
+#                                               emulated, no root, no
+#                                               ioperm(2)
+#   Used by tests/run-tests.sh (Test Suite 11), make test-emu and
+#   make bench-emu.
+################################################################################
+
+set -euo pipefail
+
+readonly CFLAGS=(-std=c2x -O2 -Wall -Wextra -Werror)
+
+mkdir -p "${1:?usage: nct-emu-build.sh DIR}"
+DIR="$(cd "$1" && pwd)"
+readonly DIR
+
+readonly EMU_FLAGS=(
+	"-DHWMON_CLASS_PATH=\"${DIR}/root/class/hwmon\""
+	"-DHWMON_CACHE_PATH=\"${DIR}/nct-hwmon.cache\""
+	"-DHWM_LOCK_PATH=\"${DIR}/nct-hwm.lock\""
+	"-DWMI_BUS_PATH=\"${DIR}/root/bus/wmi/devices\""
+	-DNCT_PORT_SHIM -Iscripts
+)
+
+tests/emu/nct-emu-tree.sh "${DIR}/root" >/dev/null
+rm -f "${DIR}/nct-hwmon.cache"
+
+gcc "${CFLAGS[@]}" -shared -fPIC -o "${DIR}/nct-emu-sysfs.so" tests/emu/nct-emu-sysfs.c -ldl
+gcc "${CFLAGS[@]}" "${EMU_FLAGS[@]}" -o "${DIR}/nct-id" scripts/nct-id.c scripts/nct-hwmon.c scripts/nct-isa.c \
+	scripts/nct-sio.c scripts/nct-wmi.c scripts/nct-stats.c tests/emu/nct-emu-port.c
+gcc "${CFLAGS[@]}" "${EMU_FLAGS[@]}" -o "${DIR}/nct-fan" scripts/nct-fan.c scripts/nct-hwmon.c scripts/nct-stats.c
+gcc "${CFLAGS[@]}" "${EMU_FLAGS[@]}" -o "${DIR}/nct-sampler" scripts/nct-sampler.c scripts/nct-hwmon.c \
+	scripts/nct-isa.c scripts/nct-sio.c scripts/nct-stats.c scripts/nct-rt.c scripts/nct-log.c scripts/nct-uring.c \
+	tests/emu/nct-emu-port.c
+gcc "${CFLAGS[@]}" "${EMU_FLAGS[@]}" -o "${DIR}/nct-bench" scripts/nct-bench.c scripts/nct-hwmon.c scripts/nct-isa.c \
+	scripts/nct-sio.c scripts/nct-wmi.c scripts/nct-stats.c tests/emu/nct-emu-port.c
+gcc "${CFLAGS[@]}" "${EMU_FLAGS[@]}" -o "${DIR}/nct-fanctl" scripts/nct-fanctl.c scripts/nct-hwmon.c scripts/nct-stats.c \
+	scripts/nct-rt.c
+gcc "${CFLAGS[@]}" "${EMU_FLAGS[@]}" "-DNCT_BROKER_WRITER_UID=$(id -u)" -o "${DIR}/nct-broker" scripts/nct-broker.c \
+	scripts/nct-hwmon.c scripts/nct-stats.c
+gcc "${CFLAGS[@]}" -Iscripts -o "${DIR}/nct-emu-client" tests/emu/nct-emu-client.c
+gcc "${CFLAGS[@]}" -o "${DIR}/nct-profile" scripts/nct-profile.c
+gcc "${CFLAGS[@]}" -o "${DIR}/nct-tune" scripts/nct-tune.c -lm
+gcc "${CFLAGS[@]}" -o "${DIR}/nct-exporter" scripts/nct-exporter.c
+gcc "${CFLAGS[@]}" -o "${DIR}/nct-agent" scripts/nct-agent.c scripts/nct-hwmon.c scripts/nct-stats.c -lz -lcrypto
+
+cat >"${DIR}/run" <<-RUN
+	#!/bin/bash
+	export NCT_EMU_ROOT="${DIR}/root"
+	export LD_PRELOAD="${DIR}/nct-emu-sysfs.so\${LD_PRELOAD:+:\${LD_PRELOAD}}"
+	exec "\$@"
+RUN
+chmod +x "${DIR}/run"
+
+echo "[INFO] Emulator built in ${DIR} (hwmon ${DIR}/root/class/hwmon/hwmon3)"
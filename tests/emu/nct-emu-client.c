@@ -0,0 +1,224 @@
+/*
+ * nct-emu-client.c - Scripted nct-broker client for the emulator tests
+ *
+ * PURPOSE:
+ *   Send hand-written requests to nct-broker and print every result, so
+ *   tests/run-tests.sh can check the broker's answers op by op: merged
+ *   coalescing writes, -ECANCELED after a failed gate, EPERM for a client
+ *   that may not write.
+ *
+ * WHY:
+ *   nct-fan and nct-fanctl hide what the broker answered: a skipped line
+ *   is silently not written, a merged duty looks like any other success,
+ *   and one tool never has two coalescing requests in flight. This client
+ *   uses the same nct_broker_call() and prints the raw results.
+ *
+ * HOW:
+ *   OP is NAME (read) or [FLAG]NAME=VALUE (write; FLAG '?' or '!' as in
+ *   the nct-fan profile format).
+ *     default     all OPs as one request on one connection
+ *     --coalesce  one writer process per OP, each sending one
+ *                 NCT_BROKER_F_COALESCE write; the writers start
+ *                 --stagger ms apart (default 10) in argument order, so
+ *                 they reach the broker in that order inside its window
+ *   One line per result on stdout, in request order:
+ *     NAME[=VALUE] rc=0|ERRNAME source=sysfs|cache|merged [value=TEXT]
+ *   A refused request prints "status=ERRNAME" instead.
+ *
+ * USAGE:
+ *   nct-emu-client [--socket PATH] [--hwmon DIR] [--coalesce] [--stagger MS] OP...
+ *     --socket PATH  broker socket (default $NCT_BROKER_SOCKET or
+ *                    /run/nct-broker.sock)
+ *     --hwmon DIR    device named in the request (default "": any)
+ *
+ * EXIT STATUS:
+ *   0  every request was answered (op results may still be errors)
+ *   1  a request was refused, or the broker could not be reached
+ *   2  usage error
+ */
+
+#define _GNU_SOURCE
+#include "nct-broker.h"
+
+#include <getopt.h>
+#include <stdbool.h>
+#include <sys/wait.h>
+#include <time.h>
+
+#define MAX_OPS NCT_BROKER_COALESCE_MAX
+
+static const char *const source_names[] = {
+	[NCT_BROKER_SRC_SYSFS] = "sysfs",
+	[NCT_BROKER_SRC_CACHE] = "cache",
+	[NCT_BROKER_SRC_MERGED] = "merged",
+};
+
+static const char *err_name(int err) {
+	const char *name = strerrorname_np(err);
+	return name ? name : "EUNKNOWN";
+}
+
+/*
+ * parse_op() - "[FLAG]NAME=VALUE" is a write, "NAME" a read
+ * RETURNS: 0, or -1 for an empty name or a field that does not fit
+ */
+static int parse_op(const char *arg, struct nct_broker_op *op) {
+	char flag = arg[0] == '?' || arg[0] == '!' ? arg[0] : ' ';
+	const char *eq = strchr(arg, '=');
+	const char *start = eq && flag != ' ' ? arg + 1 : arg;
+	size_t len = eq ? (size_t)(eq - start) : strlen(start);
+	if (len == 0 || len >= NCT_BROKER_NAME_MAX || (eq && strlen(eq + 1) >= NCT_BROKER_VALUE_MAX)) {
+		return -1;
+	}
+
+	char name[NCT_BROKER_NAME_MAX];
+	memcpy(name, start, len);
+	name[len] = '\0';
+	if (!eq) {
+		nct_broker_op_set(op, NCT_BROKER_READ, ' ', name, NULL);
+	} else {
+		nct_broker_op_set(op, NCT_BROKER_WRITE, flag, name, eq + 1);
+	}
+	return 0;
+}
+
+static void print_result(const struct nct_broker_op *op, const struct nct_broker_result *r) {
+	printf("%s", op->name);
+	if (op->op == NCT_BROKER_WRITE) {
+		printf("=%s", op->value);
+	}
+	printf(" rc=%s source=%s", r->rc == 0 ? "0" : err_name(-r->rc),
+	       r->source <= NCT_BROKER_SRC_MERGED ? source_names[r->source] : "?");
+	if (op->op == NCT_BROKER_READ && r->rc == 0) {
+		printf(" value=%s", r->value);
+	}
+	putchar('\n');
+}
+
+/*
+ * submit() - Connect, send ops[nops] as one request, print the results
+ * RETURNS: 0 answered, 1 refused or unreachable
+ */
+static int submit(const char *path, const char *hwmon, uint16_t flags, const struct nct_broker_op *ops,
+		  uint32_t nops) {
+	struct nct_broker_result res[MAX_OPS];
+	int fd = nct_broker_connect(path);
+	if (fd < 0) {
+		fprintf(stderr, "[ERROR] Cannot connect to %s: %s\n", path, strerror(-fd));
+		return 1;
+	}
+	int rc = nct_broker_call(fd, hwmon, flags, ops, nops, res);
+	close(fd);
+	if (rc < 0) {
+		printf("status=%s\n", err_name(-rc));
+		return 1;
+	}
+	for (uint32_t k = 0; k < nops; ++k) {
+		print_result(&ops[k], &res[k]);
+	}
+	return 0;
+}
+
+/*
+ * coalesce() - One forked writer per op, started stagger_ms apart
+ * RETURNS: 0 every writer was answered, 1 otherwise
+ */
+static int coalesce(const char *path, const char *hwmon, const struct nct_broker_op *ops, int nops,
+		    long stagger_ms) {
+	const struct timespec gap = {.tv_sec = stagger_ms / 1000, .tv_nsec = stagger_ms % 1000 * 1000000};
+	fflush(stdout);
+	for (int i = 0; i < nops; ++i) {
+		if (i > 0) {
+			nanosleep(&gap, NULL);
+		}
+		pid_t pid = fork();
+		if (pid < 0) {
+			fprintf(stderr, "[ERROR] fork: %s\n", strerror(errno));
+			return 1;
+		}
+		if (pid == 0) {
+			int rc = submit(path, hwmon, NCT_BROKER_F_COALESCE, &ops[i], 1);
+			fflush(stdout);
+			_exit(rc);
+		}
+	}
+
+	int failed = 0, status;
+	while (wait(&status) > 0) {
+		failed |= !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+	}
+	return failed;
+}
+
+static void usage(FILE *out, const char *prog) {
+	fprintf(out,
+		"Usage: %s [--socket PATH] [--hwmon DIR] [--coalesce] [--stagger MS] OP...\n"
+		"  OP  NAME (read) or [?|!]NAME=VALUE (write), at most %d\n",
+		prog, MAX_OPS);
+}
+
+int main(int argc, char **argv) {
+	static const struct option longopts[] = {
+		{"socket", required_argument, NULL, 'S'},
+		{"hwmon", required_argument, NULL, 'H'},
+		{"coalesce", no_argument, NULL, 'c'},
+		{"stagger", required_argument, NULL, 't'},
+		{"help", no_argument, NULL, 'h'},
+		{NULL, 0, NULL, 0},
+	};
+
+	const char *path = nct_broker_path();
+	const char *hwmon = NULL;
+	bool coalescing = false;
+	long stagger_ms = 10;
+
+	int opt;
+	while ((opt = getopt_long(argc, argv, "S:H:ct:h", longopts, NULL)) != -1) {
+		switch (opt) {
+		case 'S':
+			path = optarg;
+			break;
+		case 'H':
+			hwmon = optarg;
+			break;
+		case 'c':
+			coalescing = true;
+			break;
+		case 't': {
+			char *end;
+			stagger_ms = strtol(optarg, &end, 10);
+			if (*end || stagger_ms < 0 || stagger_ms > 1000) {
+				fprintf(stderr, "[ERROR] --stagger must be 0-1000 ms\n");
+				return 2;
+			}
+			break;
+		}
+		case 'h':
+			usage(stdout, argv[0]);
+			return 0;
+		default:
+			usage(stderr, argv[0]);
+			return 2;
+		}
+	}
+
+	int nops = argc - optind;
+	if (nops == 0 || nops > MAX_OPS) {
+		usage(stderr, argv[0]);
+		return 2;
+	}
+	struct nct_broker_op ops[MAX_OPS];
+	for (int i = 0; i < nops; ++i) {
+		if (parse_op(argv[optind + i], &ops[i]) < 0) {
+			fprintf(stderr, "[ERROR] Bad op: %s\n", argv[optind + i]);
+			return 2;
+		}
+		if (coalescing && (ops[i].op != NCT_BROKER_WRITE || ops[i].flag != ' ')) {
+			fprintf(stderr, "[ERROR] --coalesce takes plain writes only: %s\n", argv[optind + i]);
+			return 2;
+		}
+	}
+
+	return coalescing ? coalesce(path, hwmon, ops, nops, stagger_ms)
+			  : submit(path, hwmon, 0, ops, (uint32_t)nops);
+}
@@ -0,0 +1,370 @@
+/*
+ * nct-emu-port.c - Emulated NCT6798D Super I/O and HWM port interface
+ *
+ * PURPOSE:
+ *   Stand in for the ISA bus when a tool is built with -DNCT_PORT_SHIM, so
+ *   nct-id --probe/--dump, nct-sampler --backend isa and nct-bench run the
+ *   real nct-sio.c protocol code without a board, root or ioperm(2). The
+ *   same chip answers the ASUS WMI methods nct-wmi.c sends to acpi_call.
+ *
+ * WHY:
+ *   outb()/inb() are inline instructions: nothing can interpose them at run
+ *   time, and CI runners have no Super I/O chip behind 0x2E anyway. With
+ *   the three primitives routed here (nct-sio.h), every shadowing and bank
+ *   ordering decision in nct-sio.c is exercised, and counted, exactly as on
+ *   hardware.
+ *
+ * WHAT IS MODELED:
+ *   SIO at NCT_EMU_SIO_PORT (default 0x2E), index/port+1 data:
+ *     - locked until 0x87 is written twice to the index port; 0xAA locks
+ *       again. A locked chip ignores index writes and reads back 0xFF
+ *     - CR 0x07 selects the logical device; CR 0x20/0x21 are the DEVID,
+ *       every other CR is per logical device. LDN 0x0B (HWM) is active
+ *       (CR 0x30 = 1) with its base in CR 0x60/0x61
+ *     - any other port (the second SIO candidate included) floats: 0xFF
+ *   HWM at base+5 (index) / base+6 (data):
+ *     - 16 banks x 256 registers; register 0x4E selects the bank and is
+ *       visible in every bank
+ *     - seeded with the bank 4 readings nct-isa.c maps (the same values
+ *       tests/emu/nct-emu-tree.sh writes to the fake sysfs tree) and one
+ *       duty per header, or with a `nct-id --dump` image
+ *     - duty readback (nct-chip.h pwm_read[]): 0x001-0x015 are read-only
+ *       mirrors of the pwm1-5 output registers (0x09 in banks 1, 2, 3, 8,
+ *       9); pwm6-7 read back through their own 0xA09/0xB09
+ *   ASUS WMI through /proc/acpi/call (nct-wmi.c, -DNCT_PORT_SHIM):
+ *     - "<method> 0x0 <id> b<a><b><c>00" is evaluated like the board's
+ *       WMBD AML: RSIO/WSIO(ioreg, CR, val) enter extended function mode
+ *       on ioreg, access the CR and leave again; RHWM/WHWM(bank, index,
+ *       val) select the bank and access the register. The firmware
+ *       drives the emulated ports directly, so ioperm() denial does not
+ *       apply and CR 0x07 stays selected between calls
+ *     - any other method path, or an unknown method ID, reads back
+ *       "Error: AE_NOT_FOUND" like acpi_call
+ *   Timing: every port access busy-waits NCT_EMU_PORT_NS (default 1000,
+ *   one LPC I/O cycle), so nct-bench and --stats report realistic costs.
+ *
+ * ENVIRONMENT:
+ *   NCT_EMU_DEVID=0xD428     CR 0x20/0x21 (0xD42B = NCT6798D rev 3)
+ *   NCT_EMU_BASE=0x0290      HWM base in LDN 0x0B CR 0x60/0x61
+ *   NCT_EMU_SIO_PORT=0x2E    0x4E moves the chip to the second port
+ *   NCT_EMU_PORT_NS=1000     cost of one port access; 0 = free
+ *   NCT_EMU_IOPERM=deny      ioperm() fails with EPERM (ACPI-reserved ports)
+ *   NCT_EMU_IMAGE=FILE       seed chip identity and every bank from a
+ *                            `nct-id --dump --format bin` image
+ *   NCT_EMU_WMI_METHOD=PATH  the one ACPI method that answers
+ *                            (default \_SB_.AMW0.WMBD, nct-emu-tree.sh)
+ *
+ * USAGE:
+ *   gcc -std=c2x -O2 -Wall -Wextra -Werror -DNCT_PORT_SHIM -Iscripts -o nct-id \
+ *       scripts/nct-id.c scripts/nct-hwmon.c scripts/nct-isa.c \
+ *       scripts/nct-sio.c scripts/nct-wmi.c scripts/nct-stats.c \
+ *       tests/emu/nct-emu-port.c
+ *   (make test-emu builds every tool this way)
+ */
+
+#define _GNU_SOURCE
+#include "nct-chip.h"
+#include "nct-sio.h"
+#include "nct-wmi.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SIO_LDNS        16
+#define SIO_CRS         256
+#define IMAGE_HEADER    32      /* struct hwm_image_header, nct-id.c */
+
+static struct {
+	int init;
+	uint16_t sio_port;
+	uint16_t base;
+	uint64_t port_ns;
+	int deny;
+
+	int unlock;             /* 0x87 writes seen in a row */
+	int entered;
+	uint8_t cr_index;
+	uint8_t ldn;
+	uint8_t global[0x30];   /* CR 0x00-0x2F: shared by every LDN */
+	uint8_t cr[SIO_LDNS][SIO_CRS];
+
+	uint8_t hwm_index;
+	uint8_t hwm[HWM_BANKS][HWM_BANK_SIZE];
+
+	const char *wmi_method;
+	char acpi_result[32];   /* what the next pread() of /proc/acpi/call returns */
+} emu;
+
+static uint64_t clock_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* Spin rather than sleep: one port access is far below timer slack */
+static void bus_cycle(void) {
+	if (!emu.port_ns) {
+		return;
+	}
+	uint64_t end = clock_ns() + emu.port_ns;
+	while (clock_ns() < end) {
+	}
+}
+
+static unsigned long env_num(const char *name, unsigned long dflt) {
+	const char *v = getenv(name);
+	if (!v || !*v) {
+		return dflt;
+	}
+	char *end;
+	unsigned long n = strtoul(v, &end, 0);
+	return *end ? dflt : n;
+}
+
+/*
+ * seed_readings() - Sensor and duty registers of an idle B550 board
+ * WHY: The values match tests/emu/nct-emu-tree.sh, so the isa and sysfs
+ *      backends report the same temperatures, fans and voltages
+ */
+static void seed_readings(void) {
+	static const int8_t temps[7] = {34, 41, 38, 30, 46, 28, 25};
+	static const uint16_t fans[7] = {812, 1216, 0, 645, 0, 0, 0};
+	/* mV * 100 / scale (800 or 1600), nct-isa.c map6779_sensors[] */
+	static const uint8_t volts[15] = {139, 126, 210, 210, 125, 125, 125, 210, 200, 131, 125, 125, 125, 125, 126};
+	static const uint8_t duty[7] = {128, 153, 0, 102, 0, 0, 0};
+
+	for (int i = 0; i < 7; ++i) {
+		emu.hwm[4][0x90 + i] = (uint8_t)temps[i];
+		/* AUXFANIN4 lives at 0x4CE; 0x4CC is unused on this map */
+		int r = i < 6 ? 0xC0 + 2 * i : 0xCE;
+		emu.hwm[4][r] = (uint8_t)(fans[i] >> 8);
+		emu.hwm[4][r + 1] = (uint8_t)fans[i];
+		emu.hwm[nct6798d.pwm_bank[i]][nct6798d.smartfan.pwm] = duty[i];
+	}
+	memcpy(&emu.hwm[4][0x80], volts, sizeof(volts));
+}
+
+/*
+ * seed_image() - Replace the register file with a `nct-id --dump` image
+ * RETURNS: 0, or -1 (with a warning) to keep the built-in seed
+ */
+static int seed_image(const char *path, uint16_t *devid) {
+	FILE *f = fopen(path, "rb");
+	if (!f) {
+		fprintf(stderr, "[WARN] nct-emu: cannot open %s: %s\n", path, strerror(errno));
+		return -1;
+	}
+	uint8_t hdr[IMAGE_HEADER];
+	int rc = -1;
+	if (fread(hdr, 1, sizeof(hdr), f) == sizeof(hdr) && memcmp(hdr, "NCTHWM", 6) == 0) {
+		unsigned nbanks = hdr[14] < HWM_BANKS ? hdr[14] : HWM_BANKS;
+		if (fread(emu.hwm, HWM_BANK_SIZE, nbanks, f) == nbanks) {
+			*devid = (uint16_t)(hdr[8] | hdr[9] << 8);
+			emu.base = (uint16_t)(hdr[10] | hdr[11] << 8);
+			rc = 0;
+		}
+	}
+	if (rc) {
+		fprintf(stderr, "[WARN] nct-emu: %s is not a complete HWM image; using built-in registers\n", path);
+		memset(emu.hwm, 0, sizeof(emu.hwm));
+	}
+	fclose(f);
+	return rc;
+}
+
+static void emu_init(void) {
+	if (emu.init) {
+		return;
+	}
+	emu.init = 1;
+	emu.sio_port = (uint16_t)env_num("NCT_EMU_SIO_PORT", 0x2E);
+	emu.base = (uint16_t)env_num("NCT_EMU_BASE", 0x0290);
+	emu.port_ns = env_num("NCT_EMU_PORT_NS", 1000);
+	const char *method = getenv("NCT_EMU_WMI_METHOD");
+	emu.wmi_method = method && *method ? method : "\\_SB_.AMW0.WMBD";
+	const char *deny = getenv("NCT_EMU_IOPERM");
+	emu.deny = deny && strcmp(deny, "deny") == 0;
+
+	uint16_t devid = (uint16_t)env_num("NCT_EMU_DEVID", 0xD428);
+	const char *image = getenv("NCT_EMU_IMAGE");
+	if (!image || !*image || seed_image(image, &devid)) {
+		seed_readings();
+	}
+	emu.global[0x20] = (uint8_t)(devid >> 8);
+	emu.global[0x21] = (uint8_t)devid;
+	emu.cr[SIO_LDN_HWM][0x30] = 0x01;
+	emu.cr[SIO_LDN_HWM][SIO_REG_BASE_HI] = (uint8_t)(emu.base >> 8);
+	emu.cr[SIO_LDN_HWM][SIO_REG_BASE_LO] = (uint8_t)emu.base;
+}
+
+static uint8_t *sio_cr(uint8_t index) {
+	return index < sizeof(emu.global) ? &emu.global[index] : &emu.cr[emu.ldn % SIO_LDNS][index];
+}
+
+static uint8_t *hwm_reg(void) {
+	if (emu.hwm_index == HWM_REG_BANK) {
+		return &emu.hwm[0][HWM_REG_BANK];
+	}
+	return &emu.hwm[emu.hwm[0][HWM_REG_BANK] % HWM_BANKS][emu.hwm_index];
+}
+
+/*
+ * pwm_readback() - Output register a duty readback address mirrors
+ * WHY: The chip, not the host, writes the readback: it shows the duty
+ *      being driven, which is the output register in every mode here
+ * RETURNS: the mirrored register, or NULL if the selected one is not a
+ *          mirror (0xA09/0xB09 are the output registers themselves)
+ */
+static uint8_t *pwm_readback(void) {
+	uint16_t reg = HWM_REG(emu.hwm[0][HWM_REG_BANK] % HWM_BANKS, emu.hwm_index);
+	for (int i = 0; i < nct6798d.npwm; ++i) {
+		uint16_t out = nct_chip_pwm_reg(&nct6798d, i + 1, nct6798d.smartfan.pwm);
+		if (reg == nct6798d.pwm_read[i] && reg != out) {
+			return &emu.hwm[out >> 8][out & 0xFF];
+		}
+	}
+	return NULL;
+}
+
+void nct_shim_outb(uint8_t val, uint16_t port) {
+	emu_init();
+	bus_cycle();
+
+	if (port == emu.sio_port) {
+		if (val == 0x87) {
+			emu.entered = ++emu.unlock >= 2;
+		} else if (emu.entered && val == 0xAA) {
+			emu.entered = 0;
+			emu.unlock = 0;
+		} else if (emu.entered) {
+			emu.cr_index = val;
+		} else {
+			emu.unlock = 0;
+		}
+	} else if (port == emu.sio_port + 1) {
+		if (!emu.entered) {
+			return;
+		}
+		if (emu.cr_index == SIO_REG_LDN) {
+			emu.ldn = val;
+		} else if (emu.cr_index != SIO_REG_DEVID_HI && emu.cr_index != SIO_REG_DEVID_LO) {
+			*sio_cr(emu.cr_index) = val;
+		}
+	} else if (port == emu.base + HWM_INDEX_OFFSET) {
+		emu.hwm_index = val;
+	} else if (port == emu.base + HWM_DATA_OFFSET && !pwm_readback()) {
+		*hwm_reg() = emu.hwm_index == HWM_REG_BANK ? (uint8_t)(val & 0x0F) : val;
+	}
+}
+
+uint8_t nct_shim_inb(uint16_t port) {
+	emu_init();
+	bus_cycle();
+
+	if (port == emu.sio_port) {
+		return emu.entered ? emu.cr_index : 0xFF;
+	}
+	if (port == emu.sio_port + 1) {
+		if (!emu.entered) {
+			return 0xFF;
+		}
+		return emu.cr_index == SIO_REG_LDN ? emu.ldn : *sio_cr(emu.cr_index);
+	}
+	if (port == emu.base + HWM_INDEX_OFFSET) {
+		return emu.hwm_index;
+	}
+	if (port == emu.base + HWM_DATA_OFFSET) {
+		uint8_t *mirror = pwm_readback();
+		return mirror ? *mirror : *hwm_reg();
+	}
+	return 0xFF;
+}
+
+int nct_shim_ioperm(unsigned long from, unsigned long num, int turn_on) {
+	(void)from;
+	(void)num;
+	(void)turn_on;
+	emu_init();
+	if (emu.deny) {
+		errno = EPERM;
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * wmi_evaluate() - One WMBD call, issued as the firmware's own port I/O
+ * RETURNS: the method's Integer result
+ */
+static uint32_t wmi_evaluate(uint32_t id, uint8_t a, uint8_t b, uint8_t c) {
+	uint8_t v = 0;
+
+	switch (id) {
+	case ASUSWMI_METHODID_RSIO:
+	case ASUSWMI_METHODID_WSIO:
+		nct_shim_outb(0x87, a);
+		nct_shim_outb(0x87, a);
+		nct_shim_outb(b, a);
+		if (id == ASUSWMI_METHODID_WSIO) {
+			nct_shim_outb(c, (uint16_t)(a + 1));
+		} else {
+			v = nct_shim_inb((uint16_t)(a + 1));
+		}
+		nct_shim_outb(0xAA, a);
+		break;
+	case ASUSWMI_METHODID_RHWM:
+	case ASUSWMI_METHODID_WHWM:
+		nct_shim_outb(HWM_REG_BANK, (uint16_t)(emu.base + HWM_INDEX_OFFSET));
+		nct_shim_outb(a, (uint16_t)(emu.base + HWM_DATA_OFFSET));
+		nct_shim_outb(b, (uint16_t)(emu.base + HWM_INDEX_OFFSET));
+		if (id == ASUSWMI_METHODID_WHWM) {
+			nct_shim_outb(c, (uint16_t)(emu.base + HWM_DATA_OFFSET));
+		} else {
+			v = nct_shim_inb((uint16_t)(emu.base + HWM_DATA_OFFSET));
+		}
+		break;
+	}
+	return v;
+}
+
+int nct_shim_acpi_open(void) {
+	emu_init();
+	return open("/dev/null", O_RDWR | O_CLOEXEC);
+}
+
+ssize_t nct_shim_acpi_pwrite(int fd, const void *buf, size_t len, off_t off) {
+	(void)fd;
+	(void)off;
+	emu_init();
+
+	char cmd[256];
+	char method[160];
+	unsigned id, a, b, c;
+	snprintf(cmd, sizeof(cmd), "%.*s", (int)len, (const char *)buf);
+	snprintf(emu.acpi_result, sizeof(emu.acpi_result), "Error: AE_NOT_FOUND");
+	if (sscanf(cmd, "%159s 0x0 %x b%2x%2x%2x", method, &id, &a, &b, &c) == 5 &&
+	    strcmp(method, emu.wmi_method) == 0 &&
+	    (id == ASUSWMI_METHODID_RSIO || id == ASUSWMI_METHODID_WSIO ||
+	     id == ASUSWMI_METHODID_RHWM || id == ASUSWMI_METHODID_WHWM)) {
+		uint32_t v = wmi_evaluate(id, (uint8_t)a, (uint8_t)b, (uint8_t)c);
+		snprintf(emu.acpi_result, sizeof(emu.acpi_result), "0x%x", v);
+	}
+	return (ssize_t)len;
+}
+
+ssize_t nct_shim_acpi_pread(int fd, void *buf, size_t len, off_t off) {
+	(void)fd;
+	(void)off;
+	size_t n = strlen(emu.acpi_result);
+	if (n > len) {
+		n = len;
+	}
+	memcpy(buf, emu.acpi_result, n);
+	return (ssize_t)n;
+}
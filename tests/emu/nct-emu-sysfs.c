@@ -0,0 +1,698 @@
+/*
+ * nct-emu-sysfs.c - LD_PRELOAD shim giving a fake hwmon tree nct6775 semantics
+ *
+ * PURPOSE:
+ *   Make the plain files tests/emu/nct-emu-tree.sh creates behave like the
+ *   nct6775 driver's attributes, so nct-fan, nct-sampler, nct-fanctl,
+ *   nct-bench and the max-fans scripts can be exercised in CI against the
+ *   same code paths they use on a B550 board.
+ *
+ * WHY:
+ *   A tmpfs file accepts anything: "300", "abc" and writes to temp1_input
+ *   all succeed, a short write leaves the tail of the previous value behind,
+ *   and a read costs ~200 ns instead of the driver's microseconds. Tests
+ *   against such a tree prove nothing about validation, reconcile drift or
+ *   sampler cost.
+ *
+ * WHAT IS MODELED (files under NCT_EMU_ROOT only; everything else passes
+ *   straight through):
+ *   - Read-only attributes (*_input, *_label, *_alarm, name) refuse an
+ *     open for writing with EACCES, as kernfs does without a store method
+ *   - A write is parsed like kstrtol(): one integer, optional newline, or
+ *     EINVAL. Values are then clamped or rejected per attribute like
+ *     nct6775's store functions (pwm 0-255 clamped, pwmN_enable 0/1/2/4/5,
+ *     pwmN_mode 0/1, fanN_pulses 0-4, temperatures rounded to 1 C,
+ *     step times to 100 ms) and stored as the driver would show them
+ *   - pwmN_enable=0 (full speed) sets pwmN to 255
+ *   - pwmN in SmartFan IV mode (enable 5) reads the duty its 7-point curve
+ *     gives for tempK_input, K = pwmN_temp_sel, and 255 at enable 0
+ *   - fanN_input follows the duty pwmN reads, between a per-fan floor and
+ *     maximum; a tach stored as 0 is a header with no fan and stays 0
+ *   - Latency: every read at offset 0 takes NCT_EMU_READ_NS (default 2000,
+ *     model work included),
+ *     every write NCT_EMU_WRITE_NS (default 5000, update_lock plus three
+ *     port writes), and the first read after 1.5 s (the driver's cache
+ *     lifetime) additionally NCT_EMU_UPDATE_US (default 700, a register
+ *     sweep over ISA; ~30000 models the ASUS WMI path)
+ *   State lives in the backing files (pwmN holds the last manual duty), so
+ *   it is shared by every process and a test can drive the model by
+ *   rewriting a tempN_input file itself.
+ *
+ * ENVIRONMENT:
+ *   NCT_EMU_ROOT=DIR      tree root (nct-emu-tree.sh's argument); unset = off
+ *   NCT_EMU_READ_NS, NCT_EMU_WRITE_NS, NCT_EMU_UPDATE_US   see above; 0 = free
+ *
+ * USAGE:
+ *   gcc -std=c2x -O2 -Wall -Wextra -Werror -shared -fPIC \
+ *       -o nct-emu-sysfs.so tests/emu/nct-emu-sysfs.c -ldl
+ *   NCT_EMU_ROOT=/tmp/emu LD_PRELOAD=$PWD/nct-emu-sysfs.so nct-fan --verify ...
+ *
+ * CAVEATS:
+ *   - Only the libc entry points are wrapped (open*, read, pread*, write,
+ *     pwrite*, dup*, close, and their _FORTIFY_SOURCE variants). stdio
+ *     (fopen of name/label files, tee, the shell's builtin echo) and
+ *     io_uring reads (nct-sampler --io uring) reach the backing file
+ *     directly: no validation, no model, no added latency
+ *   - The driver cache lifetime is tracked per process
+ */
+
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_FDS       1024
+#define CACHE_SLOTS   1024      /* > the ~330 attributes of one tree */
+#define ATTR_PATH_MAX 256
+#define CURVE_POINTS  7
+#define CACHE_NS     1500000000ull      /* nct6775: HZ + HZ / 2 */
+
+/* fanN_input = lo + (hi - lo) * duty / 255; matches the tree's seed duties */
+static const struct {
+	int lo, hi;
+} fan_model[] = {{300, 1320}, {400, 1760}, {350, 1500}, {245, 1245}, {300, 1500}, {300, 1500}, {300, 1500}};
+
+enum attr_kind { ATTR_NONE, ATTR_DIR, ATTR_FILE };
+
+struct attr_fd {
+	enum attr_kind kind;
+	char path[ATTR_PATH_MAX];       /* realpath of the attribute (or directory) */
+};
+
+struct backing {
+	char path[ATTR_PATH_MAX];
+	int fd;
+};
+
+static struct {
+	int init;
+	char root[PATH_MAX];    /* realpath of NCT_EMU_ROOT */
+	size_t root_len;
+	const char *given;      /* NCT_EMU_ROOT as set, for the prefix test */
+	uint64_t read_ns, write_ns, update_ns, last_update;
+
+	int (*open)(const char *, int, ...);
+	int (*openat)(int, const char *, int, ...);
+	ssize_t (*read)(int, void *, size_t);
+	ssize_t (*pread)(int, void *, size_t, off_t);
+	ssize_t (*write)(int, const void *, size_t);
+	ssize_t (*pwrite)(int, const void *, size_t, off_t);
+	int (*close)(int);
+} emu;
+
+static struct attr_fd fds[MAX_FDS];
+static struct backing backing[CACHE_SLOTS];
+
+static uint64_t clock_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void spin(uint64_t ns) {
+	if (!ns) {
+		return;
+	}
+	uint64_t end = clock_ns() + ns;
+	while (clock_ns() < end) {
+	}
+}
+
+static uint64_t env_num(const char *name, uint64_t dflt) {
+	const char *v = getenv(name);
+	if (!v || !*v) {
+		return dflt;
+	}
+	char *end;
+	unsigned long long n = strtoull(v, &end, 10);
+	return *end ? dflt : n;
+}
+
+static void emu_init(void) {
+	if (emu.init) {
+		return;
+	}
+	emu.open = (int (*)(const char *, int, ...))dlsym(RTLD_NEXT, "open");
+	emu.openat = (int (*)(int, const char *, int, ...))dlsym(RTLD_NEXT, "openat");
+	emu.read = (ssize_t (*)(int, void *, size_t))dlsym(RTLD_NEXT, "read");
+	emu.pread = (ssize_t (*)(int, void *, size_t, off_t))dlsym(RTLD_NEXT, "pread");
+	emu.write = (ssize_t (*)(int, const void *, size_t))dlsym(RTLD_NEXT, "write");
+	emu.pwrite = (ssize_t (*)(int, const void *, size_t, off_t))dlsym(RTLD_NEXT, "pwrite");
+	emu.close = (int (*)(int))dlsym(RTLD_NEXT, "close");
+
+	const char *root = getenv("NCT_EMU_ROOT");
+	if (root && *root && realpath(root, emu.root)) {
+		emu.root_len = strlen(emu.root);
+		emu.given = root;
+	}
+	emu.read_ns = env_num("NCT_EMU_READ_NS", 2000);
+	emu.write_ns = env_num("NCT_EMU_WRITE_NS", 5000);
+	emu.update_ns = env_num("NCT_EMU_UPDATE_US", 700) * 1000;
+	emu.init = 1;
+}
+
+/* ---- backing files (never re-enter the wrappers) ---- */
+
+/*
+ * backing_fd() - Cached O_RDWR fd of dir/name
+ * WHY: The model reads up to 16 sibling attributes per modeled read; an
+ *      open()/close() pair each would cost more than the driver latency
+ *      being emulated. Open-addressed by path hash, never evicted
+ * RETURNS: fd, or -1
+ */
+static int backing_fd(const char *dir, const char *name) {
+	char path[ATTR_PATH_MAX];
+	if (snprintf(path, sizeof(path), "%s/%s", dir, name) >= (int)sizeof(path)) {
+		return -1;
+	}
+	uint32_t h = 2166136261u;
+	for (const char *c = path; *c; ++c) {
+		h = (h ^ (uint8_t)*c) * 16777619u;
+	}
+	for (unsigned i = 0; i < CACHE_SLOTS; ++i) {
+		struct backing *b = &backing[(h + i) % CACHE_SLOTS];
+		if (!b->path[0]) {
+			int fd = emu.open(path, O_RDWR | O_CLOEXEC);
+			if (fd < 0) {
+				return -1;
+			}
+			snprintf(b->path, sizeof(b->path), "%s", path);
+			b->fd = fd;
+			return fd;
+		}
+		if (strcmp(b->path, path) == 0) {
+			return b->fd;
+		}
+	}
+	return -1;
+}
+
+static int file_read_int(const char *dir, const char *name, long *value) {
+	int fd = backing_fd(dir, name);
+	if (fd < 0) {
+		return -1;
+	}
+	char buf[32];
+	ssize_t n = emu.pread(fd, buf, sizeof(buf) - 1, 0);
+	if (n <= 0) {
+		return -1;
+	}
+	buf[n] = '\0';
+	char *end;
+	*value = strtol(buf, &end, 10);
+	return end == buf ? -1 : 0;
+}
+
+static void file_write_int(const char *dir, const char *name, long value) {
+	int fd = backing_fd(dir, name);
+	char buf[32];
+	int len = snprintf(buf, sizeof(buf), "%ld\n", value);
+	if (fd < 0 || ftruncate(fd, 0) < 0 || emu.pwrite(fd, buf, (size_t)len, 0) != len) {
+		fprintf(stderr, "[WARN] nct-emu: cannot store %s/%s\n", dir, name);
+	}
+}
+
+static void split(const char *path, char *dir, const char **attr) {
+	const char *slash = strrchr(path, '/');
+	size_t n = (size_t)(slash - path);
+	memcpy(dir, path, n);
+	dir[n] = '\0';
+	*attr = slash + 1;
+}
+
+/* ---- the model ---- */
+
+/*
+ * curve_duty() - SmartFan IV duty for header n at its source temperature
+ * HOW: Linear between the 7 points, flat outside them (the chip steps
+ *      between points; the interpolation is close enough for tests).
+ *      Points are read only up to the segment the temperature falls in
+ */
+static long curve_duty(const char *dir, int n, long held) {
+	char name[48];
+	long sel, temp;
+	snprintf(name, sizeof(name), "pwm%d_temp_sel", n);
+	if (file_read_int(dir, name, &sel)) {
+		return held;
+	}
+	snprintf(name, sizeof(name), "temp%ld_input", sel);
+	if (file_read_int(dir, name, &temp)) {
+		return held;
+	}
+
+	long t0 = 0, p0 = 0;
+	for (int i = 1; i <= CURVE_POINTS; ++i) {
+		long t, p;
+		snprintf(name, sizeof(name), "pwm%d_auto_point%d_temp", n, i);
+		if (file_read_int(dir, name, &t)) {
+			return held;
+		}
+		snprintf(name, sizeof(name), "pwm%d_auto_point%d_pwm", n, i);
+		if (file_read_int(dir, name, &p)) {
+			return held;
+		}
+		if (temp <= t) {
+			return i == 1 || t <= t0 ? p : p0 + (p - p0) * (temp - t0) / (t - t0);
+		}
+		t0 = t;
+		p0 = p;
+	}
+	return p0;
+}
+
+/* effective_duty() - What pwmN reads: the held value, or the curve's */
+static long effective_duty(const char *dir, int n) {
+	char name[32];
+	long duty = 0, enable = 1;
+	snprintf(name, sizeof(name), "pwm%d", n);
+	file_read_int(dir, name, &duty);
+	snprintf(name, sizeof(name), "pwm%d_enable", n);
+	file_read_int(dir, name, &enable);
+	if (enable == 0) {
+		return 255;
+	}
+	return enable == 5 ? curve_duty(dir, n, duty) : duty;
+}
+
+/* modeled() - pwmN and fanN_input are computed on read, not stored */
+static bool modeled(const char *attr, int *pwm, int *fan) {
+	int n, len = 0;
+	*pwm = *fan = 0;
+	if (sscanf(attr, "pwm%d%n", &n, &len) == 1 && attr[len] == '\0') {
+		*pwm = n;
+	} else if (sscanf(attr, "fan%d_input%n", &n, &len) == 1 && attr[len] == '\0' && n >= 1 &&
+		   n <= (int)(sizeof(fan_model) / sizeof(fan_model[0]))) {
+		*fan = n;
+	}
+	return *pwm || *fan;
+}
+
+/*
+ * show() - Format a modeled attribute the way the driver's show() would
+ * RETURNS: bytes placed in buf (truncated to len), or -1 if attr is stored
+ */
+static ssize_t show(const char *path, void *buf, size_t len) {
+	char dir[ATTR_PATH_MAX];
+	const char *attr;
+	int pwm, fan;
+	split(path, dir, &attr);
+	if (!modeled(attr, &pwm, &fan)) {
+		return -1;
+	}
+
+	long v;
+	if (pwm) {
+		v = effective_duty(dir, pwm);
+	} else if (file_read_int(dir, attr, &v) == 0 && v > 0) {
+		v = fan_model[fan - 1].lo + (fan_model[fan - 1].hi - fan_model[fan - 1].lo) * effective_duty(dir, fan) / 255;
+	} else {
+		v = 0;
+	}
+	char text[32];
+	size_t n = (size_t)snprintf(text, sizeof(text), "%ld\n", v);
+	n = n < len ? n : len;
+	memcpy(buf, text, n);
+	return (ssize_t)n;
+}
+
+/*
+ * charge() - Make a read that started at start cost what the driver's would
+ * HOW: Spin out the rest of NCT_EMU_READ_NS (model work counts towards
+ *      it), plus one register sweep when the driver's cache has expired
+ */
+static void charge(uint64_t start) {
+	uint64_t cost = emu.read_ns;
+	if (start - emu.last_update >= CACHE_NS) {
+		cost += emu.update_ns;
+		emu.last_update = start;
+	}
+	uint64_t now = clock_ns();
+	if (now - start < cost) {
+		spin(cost - (now - start));
+	}
+}
+
+static bool ends_with(const char *s, const char *suffix) {
+	size_t n = strlen(s), m = strlen(suffix);
+	return n >= m && strcmp(s + n - m, suffix) == 0;
+}
+
+static bool read_only(const char *attr) {
+	return strcmp(attr, "name") == 0 || ends_with(attr, "_input") || ends_with(attr, "_label") ||
+	       ends_with(attr, "_alarm");
+}
+
+static long clamp(long v, long lo, long hi) {
+	return v < lo ? lo : v > hi ? hi : v;
+}
+
+static long round_to(long v, long step) {
+	return (v + step / 2) / step * step;
+}
+
+/*
+ * store() - Validate one write the way nct6775's store functions do
+ * RETURNS: 0 after updating the backing file(s), or -EINVAL
+ */
+static int store(const char *path, const char *buf, size_t len) {
+	char text[32];
+	if (len == 0 || len >= sizeof(text)) {
+		return -EINVAL;
+	}
+	memcpy(text, buf, len);
+	text[len] = '\0';
+	if (text[len - 1] == '\n') {
+		text[len - 1] = '\0';
+	}
+	char *end;
+	errno = 0;
+	long v = strtol(text, &end, 10);
+	if (end == text || *end || errno || text[0] == ' ') {
+		return -EINVAL;
+	}
+
+	char dir[PATH_MAX];
+	const char *attr;
+	split(path, dir, &attr);
+	int n, len2 = 0;
+	if (sscanf(attr, "pwm%d%n", &n, &len2) == 1 && attr[len2] == '\0') {
+		v = clamp(v, 0, 255);
+	} else if (ends_with(attr, "_enable")) {
+		if (v < 0 || v > 5 || v == 3) {
+			return -EINVAL;
+		}
+		if (v == 0 && sscanf(attr, "pwm%d_enable", &n) == 1) {
+			char name[32];
+			snprintf(name, sizeof(name), "pwm%d", n);
+			file_write_int(dir, name, 255);
+		}
+	} else if (ends_with(attr, "_mode")) {
+		if (v != 0 && v != 1) {
+			return -EINVAL;
+		}
+	} else if (ends_with(attr, "_pulses")) {
+		if (v < 0 || v > 4) {
+			return -EINVAL;
+		}
+		v = v ? v : 4;
+	} else if (ends_with(attr, "_temp_sel")) {
+		if (v < 0 || v > 31) {
+			return -EINVAL;
+		}
+	} else if (ends_with(attr, "_time")) {
+		/* nct6775 step_time_to_reg(): 100 ms units, clamped to 1-255 */
+		v = round_to(clamp(v, 100, 25500), 100);
+	} else if (ends_with(attr, "_temp") || ends_with(attr, "_temp_step") || ends_with(attr, "_temp_step_base") ||
+		   ends_with(attr, "_temp_step_tol") || ends_with(attr, "_tolerance") || ends_with(attr, "_max") ||
+		   ends_with(attr, "_max_hyst") || ends_with(attr, "_crit")) {
+		if (strncmp(attr, "fan", 3) != 0 && strncmp(attr, "in", 2) != 0) {
+			v = round_to(clamp(v, 0, 255000), 1000);
+		}
+	} else if (ends_with(attr, "_pwm") || ends_with(attr, "_floor") || ends_with(attr, "_start") ||
+		   ends_with(attr, "_duty_step") || ends_with(attr, "_duty_base")) {
+		v = clamp(v, 0, 255);
+	} else if (v < 0) {
+		return -EINVAL;
+	}
+
+	spin(emu.write_ns);
+	file_write_int(dir, attr, v);
+	return 0;
+}
+
+/* ---- fd tracking ---- */
+
+static struct attr_fd *tracked(int fd) {
+	return emu.root_len && fd >= 0 && fd < MAX_FDS && fds[fd].kind != ATTR_NONE ? &fds[fd] : NULL;
+}
+
+/*
+ * resolve() - Is dirfd/path an existing file or directory under the tree?
+ * HOW: Resolve dirfd-relative and cwd-relative names first, so
+ *      openat(hwmon_dirfd, "pwm1") is recognised like an absolute path
+ * OUT: real = its realpath when true
+ */
+static bool resolve(int dirfd, const char *path, char real[PATH_MAX]) {
+	if (!emu.root_len) {
+		return false;
+	}
+	char full[PATH_MAX * 2];
+	if (path[0] == '/') {
+		/* cheap reject first: most opens are nowhere near the tree */
+		if (strncmp(path, emu.root, emu.root_len) != 0 && strncmp(path, emu.given, strlen(emu.given)) != 0) {
+			return false;
+		}
+		snprintf(full, sizeof(full), "%s", path);
+	} else if (dirfd != AT_FDCWD) {
+		struct attr_fd *d = tracked(dirfd);
+		if (!d || d->kind != ATTR_DIR) {
+			return false;
+		}
+		snprintf(full, sizeof(full), "%s/%s", d->path, path);
+	} else {
+		char cwd[PATH_MAX];
+		if (!getcwd(cwd, sizeof(cwd))) {
+			return false;
+		}
+		snprintf(full, sizeof(full), "%s/%s", cwd, path);
+	}
+	return realpath(full, real) && strncmp(real, emu.root, emu.root_len) == 0 && real[emu.root_len] == '/' &&
+	       strlen(real) < ATTR_PATH_MAX;
+}
+
+/*
+ * do_openat() - Open, and remember fds that name something in the tree
+ * WHY O_TRUNC is dropped there: sysfs ignores it, and `echo 300 > pwm1`
+ *     must not empty the backing file before store() has rejected the value
+ * RETURNS: fd, or -1 with errno; EACCES when a read-only attribute is
+ *          opened for writing (kernfs: no store method)
+ */
+static int do_openat(int dirfd, const char *path, int flags, mode_t mode) {
+	emu_init();
+	char real[PATH_MAX];
+	bool tree = resolve(dirfd, path, real);
+	int fd = emu.openat(dirfd, path, tree ? flags & ~O_TRUNC : flags, mode);
+	if (fd < 0 || fd >= MAX_FDS) {
+		return fd;
+	}
+	fds[fd].kind = ATTR_NONE;
+	if (!tree) {
+		return fd;
+	}
+
+	struct stat st;
+	bool dir = fstat(fd, &st) == 0 && S_ISDIR(st.st_mode);
+	if (!dir && (flags & O_ACCMODE) != O_RDONLY && read_only(strrchr(real, '/') + 1)) {
+		emu.close(fd);
+		errno = EACCES;
+		return -1;
+	}
+	fds[fd].kind = dir ? ATTR_DIR : ATTR_FILE;
+	snprintf(fds[fd].path, sizeof(fds[fd].path), "%s", real);
+	return fd;
+}
+
+static ssize_t do_pread(int fd, void *buf, size_t len, off_t off) {
+	emu_init();
+	struct attr_fd *a = tracked(fd);
+	if (!a || a->kind != ATTR_FILE || off != 0) {
+		return emu.pread(fd, buf, len, off);
+	}
+	uint64_t start = clock_ns();
+	ssize_t n = show(a->path, buf, len);
+	if (n < 0) {
+		n = emu.pread(fd, buf, len, off);
+	}
+	charge(start);
+	return n;
+}
+
+/*
+ * do_read() - read(2) on a tree file
+ * HOW: Like seq_file: the first read at offset 0 runs show(); a modeled
+ *      attribute then reads as EOF until the fd is rewound
+ */
+static ssize_t do_read(int fd, void *buf, size_t len) {
+	emu_init();
+	struct attr_fd *a = tracked(fd);
+	if (!a || a->kind != ATTR_FILE) {
+		return emu.read(fd, buf, len);
+	}
+	off_t pos = lseek(fd, 0, SEEK_CUR);
+	int pwm, fan;
+	if (pos != 0) {
+		return modeled(strrchr(a->path, '/') + 1, &pwm, &fan) ? 0 : emu.read(fd, buf, len);
+	}
+	uint64_t start = clock_ns();
+	ssize_t n = show(a->path, buf, len);
+	if (n < 0) {
+		n = emu.read(fd, buf, len);
+	} else {
+		lseek(fd, n, SEEK_SET);
+	}
+	charge(start);
+	return n;
+}
+
+static ssize_t do_write(int fd, const void *buf, size_t len, off_t off, bool positional) {
+	emu_init();
+	struct attr_fd *a = tracked(fd);
+	if (!a || a->kind != ATTR_FILE) {
+		return positional ? emu.pwrite(fd, buf, len, off) : emu.write(fd, buf, len);
+	}
+	int rc = store(a->path, buf, len);
+	if (rc < 0) {
+		errno = -rc;
+		return -1;
+	}
+	return (ssize_t)len;
+}
+
+/* ---- interposed libc entry points ---- */
+
+static mode_t open_mode(int flags, va_list ap) {
+	return flags & (O_CREAT | O_TMPFILE) ? va_arg(ap, mode_t) : 0;
+}
+
+int open(const char *path, int flags, ...) {
+	va_list ap;
+	va_start(ap, flags);
+	mode_t mode = open_mode(flags, ap);
+	va_end(ap);
+	return do_openat(AT_FDCWD, path, flags, mode);
+}
+
+int open64(const char *path, int flags, ...) {
+	va_list ap;
+	va_start(ap, flags);
+	mode_t mode = open_mode(flags, ap);
+	va_end(ap);
+	return do_openat(AT_FDCWD, path, flags, mode);
+}
+
+int openat(int dirfd, const char *path, int flags, ...) {
+	va_list ap;
+	va_start(ap, flags);
+	mode_t mode = open_mode(flags, ap);
+	va_end(ap);
+	return do_openat(dirfd, path, flags, mode);
+}
+
+int openat64(int dirfd, const char *path, int flags, ...) {
+	va_list ap;
+	va_start(ap, flags);
+	mode_t mode = open_mode(flags, ap);
+	va_end(ap);
+	return do_openat(dirfd, path, flags, mode);
+}
+
+int __open_2(const char *path, int flags);
+int __open64_2(const char *path, int flags);
+int __openat_2(int dirfd, const char *path, int flags);
+int __openat64_2(int dirfd, const char *path, int flags);
+ssize_t __read_chk(int fd, void *buf, size_t len, size_t buflen);
+ssize_t __pread_chk(int fd, void *buf, size_t len, off_t off, size_t buflen);
+ssize_t __pread64_chk(int fd, void *buf, size_t len, off_t off, size_t buflen);
+
+int __open_2(const char *path, int flags) {
+	return do_openat(AT_FDCWD, path, flags, 0);
+}
+
+int __open64_2(const char *path, int flags) {
+	return do_openat(AT_FDCWD, path, flags, 0);
+}
+
+int __openat_2(int dirfd, const char *path, int flags) {
+	return do_openat(dirfd, path, flags, 0);
+}
+
+int __openat64_2(int dirfd, const char *path, int flags) {
+	return do_openat(dirfd, path, flags, 0);
+}
+
+ssize_t read(int fd, void *buf, size_t len) {
+	return do_read(fd, buf, len);
+}
+
+ssize_t __read_chk(int fd, void *buf, size_t len, size_t buflen) {
+	(void)buflen;
+	return do_read(fd, buf, len);
+}
+
+ssize_t pread(int fd, void *buf, size_t len, off_t off) {
+	return do_pread(fd, buf, len, off);
+}
+
+ssize_t pread64(int fd, void *buf, size_t len, off_t off) {
+	return do_pread(fd, buf, len, off);
+}
+
+ssize_t __pread_chk(int fd, void *buf, size_t len, off_t off, size_t buflen) {
+	(void)buflen;
+	return do_pread(fd, buf, len, off);
+}
+
+ssize_t __pread64_chk(int fd, void *buf, size_t len, off_t off, size_t buflen) {
+	(void)buflen;
+	return do_pread(fd, buf, len, off);
+}
+
+ssize_t write(int fd, const void *buf, size_t len) {
+	return do_write(fd, buf, len, 0, false);
+}
+
+ssize_t pwrite(int fd, const void *buf, size_t len, off_t off) {
+	return do_write(fd, buf, len, off, true);
+}
+
+ssize_t pwrite64(int fd, const void *buf, size_t len, off_t off) {
+	return do_write(fd, buf, len, off, true);
+}
+
+/* dup2() keeps the attribute identity: dd and shell redirections use it */
+static int dup_track(int oldfd, int newfd) {
+	struct attr_fd *a = tracked(oldfd);
+	if (newfd >= 0 && newfd < MAX_FDS) {
+		fds[newfd].kind = ATTR_NONE;
+		if (a) {
+			fds[newfd] = *a;
+		}
+	}
+	return newfd;
+}
+
+int dup(int fd) {
+	emu_init();
+	int (*real)(int) = (int (*)(int))dlsym(RTLD_NEXT, "dup");
+	return dup_track(fd, real(fd));
+}
+
+int dup2(int oldfd, int newfd) {
+	emu_init();
+	int (*real)(int, int) = (int (*)(int, int))dlsym(RTLD_NEXT, "dup2");
+	return dup_track(oldfd, real(oldfd, newfd));
+}
+
+int dup3(int oldfd, int newfd, int flags) {
+	emu_init();
+	int (*real)(int, int, int) = (int (*)(int, int, int))dlsym(RTLD_NEXT, "dup3");
+	return dup_track(oldfd, real(oldfd, newfd, flags));
+}
+
+int close(int fd) {
+	emu_init();
+	if (fd >= 0 && fd < MAX_FDS) {
+		fds[fd].kind = ATTR_NONE;
+	}
+	return emu.close(fd);
+}
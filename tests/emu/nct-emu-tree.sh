@@ -0,0 +1,129 @@
+#!/bin/bash
+
+################################################################################
+# nct-emu-tree.sh - Build a fake sysfs hwmon tree for an ASUS B550 board
+#
+# USAGE: tests/emu/nct-emu-tree.sh ROOT
+#   ROOT is created (or a previous tree in it replaced; any other non-empty
+#   directory is refused) and receives:
+#     ROOT/class/hwmon/hwmon1 -> k10temp (PCI 0000:00:18.3)
+#     ROOT/class/hwmon/hwmon3 -> nct6798 (platform nct6775.656, HWM 0x290)
+#     ROOT/devices/platform/nct6775.656/driver -> bus/platform/drivers/nct6775
+#     ROOT/bus/wmi/devices/<ASUS monitoring GUID> -> WMI block BD under
+#                           PNP0C14:00 (\_SB_.AMW0), for nct-wmi.c
+#   Tools built with -DHWMON_CLASS_PATH='"ROOT/class/hwmon"' resolve hwmon3
+#   exactly as on the board; hwmon1 exercises the resolver's name filter
+#   and nct-sampler --device.
+#
+# WHY:
+#   The attribute set is the one nct6775 registers for an NCT6798D (7
+#   headers with the full SmartFan IV, Thermal Cruise and weighting block,
+#   7 tachs, 7 temps, 15 voltages), so nct-fan --snapshot/--verify,
+#   nct-profile plans and nct-sampler see a complete chip. The readings
+#   are the registers tests/emu/nct-emu-port.c is seeded with, so the isa
+#   and sysfs backends agree; every header starts in manual mode with the
+#   seed duty, which is what fanN_input was measured at.
+#
+# HOW:
+#   Plain files on any filesystem (tmpfs in CI). On their own they accept
+#   anything; run tools with LD_PRELOAD=nct-emu-sysfs.so NCT_EMU_ROOT=ROOT
+#   for driver semantics (validation, curve-driven duty, tach model,
+#   latency).
+################################################################################
+
+set -euo pipefail
+
+readonly ROOT="${1:?usage: nct-emu-tree.sh ROOT}"
+readonly PLATFORM="devices/platform/nct6775.656"
+readonly NCT="${PLATFORM}/hwmon/hwmon3"
+readonly K10="devices/pci0000:00/0000:00:18.3/hwmon/hwmon1"
+readonly WMI_GUID="466747A0-70EC-11DE-8A39-0800200C9A66"
+readonly WMI_DEV="devices/platform/PNP0C14:00"
+readonly WMI_BLOCK="${WMI_DEV}/wmi_bus/wmi_bus-PNP0C14:00/${WMI_GUID}"
+
+readonly -a TEMP_LABELS=(SYSTIN CPUTIN AUXTIN0 AUXTIN1 AUXTIN2 AUXTIN3 AUXTIN4)
+readonly -a TEMPS=(34000 41000 38000 30000 46000 28000 25000)
+readonly -a FANS=(812 1216 0 645 0 0 0)
+readonly -a DUTIES=(128 153 0 102 0 0 0)
+readonly -a VOLTS=(1112 1008 3360 3360 1000 1000 1000 3360 3200 1048 1000 1000 1000 1000 1008)
+readonly -a CURVE_TEMPS=(40000 50000 60000 65000 70000 75000 80000)
+readonly -a CURVE_PWMS=(64 96 128 160 192 224 255)
+
+# put FILE VALUE: one attribute, newline-terminated like sysfs
+put() {
+	printf '%s\n' "$2" >"${ROOT}/$1"
+}
+
+# Only ever delete what this script built: ROOT must never be a real /sys
+if [[ -e "${ROOT}/.nct-emu" ]]; then
+	rm -rf "${ROOT:?}/class" "${ROOT:?}/devices" "${ROOT:?}/bus"
+elif [[ -d "${ROOT}" && -n "$(ls -A "${ROOT}")" ]]; then
+	echo "[ERROR] ${ROOT} is not empty and not an emulator tree" >&2
+	exit 2
+fi
+mkdir -p "${ROOT}"
+touch "${ROOT}/.nct-emu"
+mkdir -p "${ROOT}/class/hwmon" "${ROOT}/bus/platform/drivers/nct6775" "${ROOT}/${NCT}" "${ROOT}/${K10}"
+
+ln -s ../../../bus/platform/drivers/nct6775 "${ROOT}/${PLATFORM}/driver"
+ln -s ../.. "${ROOT}/${NCT}/device"
+ln -s ../.. "${ROOT}/${K10}/device"
+ln -s "../../${NCT}" "${ROOT}/class/hwmon/hwmon3"
+ln -s "../../${K10}" "${ROOT}/class/hwmon/hwmon1"
+
+mkdir -p "${ROOT}/bus/wmi/devices" "${ROOT}/${WMI_BLOCK}" "${ROOT}/${WMI_DEV}/firmware_node"
+ln -s "../../../${WMI_BLOCK}" "${ROOT}/bus/wmi/devices/${WMI_GUID}"
+put "${WMI_BLOCK}/object_id" BD
+put "${WMI_DEV}/firmware_node/path" '\_SB_.AMW0'
+
+put "${K10}/name" k10temp
+put "${K10}/temp1_input" 45250
+put "${K10}/temp1_label" Tctl
+put "${K10}/temp3_input" 38125
+put "${K10}/temp3_label" Tccd1
+
+put "${NCT}/name" nct6798
+for i in {1..7}; do
+	put "${NCT}/temp${i}_input" "${TEMPS[i - 1]}"
+	put "${NCT}/temp${i}_label" "${TEMP_LABELS[i - 1]}"
+	put "${NCT}/temp${i}_max" 80000
+	put "${NCT}/temp${i}_max_hyst" 75000
+	put "${NCT}/temp${i}_alarm" 0
+
+	put "${NCT}/fan${i}_input" "${FANS[i - 1]}"
+	put "${NCT}/fan${i}_min" 0
+	put "${NCT}/fan${i}_pulses" 2
+	put "${NCT}/fan${i}_target" 0
+	put "${NCT}/fan${i}_tolerance" 0
+	put "${NCT}/fan${i}_alarm" 0
+
+	put "${NCT}/pwm${i}" "${DUTIES[i - 1]}"
+	put "${NCT}/pwm${i}_enable" 1
+	put "${NCT}/pwm${i}_mode" 1
+	put "${NCT}/pwm${i}_temp_sel" "$((i == 2 ? 2 : 1))"
+	for p in {1..7}; do
+		put "${NCT}/pwm${i}_auto_point${p}_temp" "${CURVE_TEMPS[p - 1]}"
+		put "${NCT}/pwm${i}_auto_point${p}_pwm" "${CURVE_PWMS[p - 1]}"
+	done
+	put "${NCT}/pwm${i}_floor" 0
+	put "${NCT}/pwm${i}_start" 1
+	put "${NCT}/pwm${i}_step_up_time" 1000
+	put "${NCT}/pwm${i}_step_down_time" 1000
+	put "${NCT}/pwm${i}_stop_time" 6000
+	put "${NCT}/pwm${i}_target_temp" 0
+	put "${NCT}/pwm${i}_temp_tolerance" 0
+	put "${NCT}/pwm${i}_weight_temp_sel" 0
+	put "${NCT}/pwm${i}_weight_temp_step" 0
+	put "${NCT}/pwm${i}_weight_temp_step_base" 0
+	put "${NCT}/pwm${i}_weight_temp_step_tol" 0
+	put "${NCT}/pwm${i}_weight_duty_step" 0
+	put "${NCT}/pwm${i}_weight_duty_base" 0
+done
+for i in {0..14}; do
+	put "${NCT}/in${i}_input" "${VOLTS[i]}"
+	put "${NCT}/in${i}_min" 0
+	put "${NCT}/in${i}_max" 0
+	put "${NCT}/in${i}_alarm" 0
+done
+
+echo "[INFO] Emulated NCT6798D at ${ROOT}/class/hwmon/hwmon3 (k10temp at hwmon1)"
@@ -66,6 +66,8 @@ log_info "Test Suite 1: Shell Script Syntax"
 run_test "max-fans.sh syntax" "bash -n scripts/max-fans.sh"
 run_test "max-fans-enhanced.sh syntax" "bash -n scripts/max-fans-enhanced.sh"
 run_test "max-fans-advanced.sh syntax" "bash -n scripts/max-fans-advanced.sh"
+run_test "nct-fan-sleep.sh syntax" "bash -n scripts/nct-fan-sleep.sh"
+run_test "nct-hwmon.sh syntax" "bash -n scripts/nct-hwmon.sh"
 run_test "PKGBUILD syntax" "bash -n PKGBUILD"
 run_test "Install script syntax" "bash -n eirikr-asus-b550-config.install"
 echo ""
@@ -76,6 +78,8 @@ if command -v shellcheck &>/dev/null; then
     run_test "ShellCheck max-fans.sh" "shellcheck -S warning scripts/max-fans.sh"
     run_test "ShellCheck max-fans-enhanced.sh" "shellcheck -S warning scripts/max-fans-enhanced.sh"
     run_test "ShellCheck max-fans-advanced.sh" "shellcheck -S warning scripts/max-fans-advanced.sh"
+    run_test "ShellCheck nct-fan-sleep.sh" "shellcheck -S warning scripts/nct-fan-sleep.sh"
+    run_test "ShellCheck nct-hwmon.sh" "shellcheck -S warning -s bash scripts/nct-hwmon.sh"
 else
     log_warning "ShellCheck not installed, skipping..."
 fi
@@ -83,11 +87,89 @@ echo ""
 
 # Test 3: C Code Compilation
 log_info "Test Suite 3: C Code Compilation"
-run_test "nct-id.c compiles" "gcc -std=c2x -O2 -Wall -Wextra -Werror -o /tmp/test-nct-id scripts/nct-id.c"
+run_test "nct-id.c compiles" "gcc -std=c2x -O2 -Wall -Wextra -Werror -o /tmp/test-nct-id scripts/nct-id.c scripts/nct-hwmon.c scripts/nct-isa.c scripts/nct-sio.c scripts/nct-wmi.c scripts/nct-stats.c"
 if [ -f /tmp/test-nct-id ]; then
     run_test "nct-id binary created" "test -x /tmp/test-nct-id"
     rm -f /tmp/test-nct-id
 fi
+run_test "nct-fan.c compiles" "gcc -std=c2x -O2 -Wall -Wextra -Werror -o /tmp/test-nct-fan scripts/nct-fan.c scripts/nct-hwmon.c scripts/nct-stats.c"
+if [ -f /tmp/test-nct-fan ]; then
+    run_test "nct-fan binary created" "test -x /tmp/test-nct-fan"
+    rm -f /tmp/test-nct-fan
+fi
+run_test "nct-sampler.c compiles" "gcc -std=c2x -O2 -Wall -Wextra -Werror -o /tmp/test-nct-sampler scripts/nct-sampler.c scripts/nct-hwmon.c scripts/nct-isa.c scripts/nct-sio.c scripts/nct-stats.c scripts/nct-rt.c scripts/nct-log.c scripts/nct-uring.c"
+if [ -f /tmp/test-nct-sampler ]; then
+    run_test "nct-sampler binary created" "test -x /tmp/test-nct-sampler"
+    rm -f /tmp/test-nct-sampler
+fi
+run_test "nct-exporter.c compiles" "gcc -std=c2x -O2 -Wall -Wextra -Werror -o /tmp/test-nct-exporter scripts/nct-exporter.c"
+if [ -f /tmp/test-nct-exporter ]; then
+    run_test "nct-exporter binary created" "test -x /tmp/test-nct-exporter"
+    rm -f /tmp/test-nct-exporter
+fi
+run_test "nct-bench.c compiles" "gcc -std=c2x -O2 -Wall -Wextra -Werror -o /tmp/test-nct-bench scripts/nct-bench.c scripts/nct-hwmon.c scripts/nct-isa.c scripts/nct-sio.c scripts/nct-wmi.c scripts/nct-stats.c"
+if [ -f /tmp/test-nct-bench ]; then
+    run_test "nct-bench binary created" "test -x /tmp/test-nct-bench"
+    rm -f /tmp/test-nct-bench
+fi
+run_test "nct-fanctl.c compiles" "gcc -std=c2x -O2 -Wall -Wextra -Werror -o /tmp/test-nct-fanctl scripts/nct-fanctl.c scripts/nct-hwmon.c scripts/nct-stats.c scripts/nct-rt.c"
+if [ -f /tmp/test-nct-fanctl ]; then
+    run_test "nct-fanctl binary created" "test -x /tmp/test-nct-fanctl"
+    rm -f /tmp/test-nct-fanctl
+fi
+
+run_test "nct-profile.c compiles" "gcc -std=c2x -O2 -Wall -Wextra -Werror -o /tmp/test-nct-profile scripts/nct-profile.c"
+if [ -f /tmp/test-nct-profile ]; then
+    run_test "nct-profile binary created" "test -x /tmp/test-nct-profile"
+    run_test "example profile compiles" "/tmp/test-nct-profile --check examples/nct-fan-profile.conf.example"
+    run_test "nct-profile writes weighting temperatures in millidegrees" "/tmp/test-nct-profile --print examples/nct-fan-profile.conf.example | grep -x '?pwm2_weight_temp_step 2000' && /tmp/test-nct-profile --print examples/nct-fan-profile.conf.example | grep -x '?pwm2_weight_temp_step_tol 2000'"
+    printf '[pwm1]\nmode = smartfan\ncurve = 40:64, 80:255\nstep_up_time = 250\n' >/tmp/test-nct-offgrid.conf
+    run_test "nct-profile rejects step times off the 100 ms grid" "{ /tmp/test-nct-profile --check /tmp/test-nct-offgrid.conf 2>&1 || true; } | grep '^\[ERROR\] /tmp/test-nct-offgrid.conf:4: step_up_time must be a multiple of 100'"
+    rm -f /tmp/test-nct-offgrid.conf
+    rm -f /tmp/test-nct-profile
+fi
+run_test "nct-characterize.c compiles" "gcc -std=c2x -O2 -Wall -Wextra -Werror -o /tmp/test-nct-characterize scripts/nct-characterize.c scripts/nct-hwmon.c scripts/nct-stats.c scripts/nct-rt.c"
+if [ -f /tmp/test-nct-characterize ]; then
+    run_test "nct-characterize binary created" "test -x /tmp/test-nct-characterize"
+    rm -f /tmp/test-nct-characterize
+fi
+run_test "nct-step.c compiles" "gcc -std=c2x -O2 -Wall -Wextra -Werror -o /tmp/test-nct-step scripts/nct-step.c scripts/nct-hwmon.c scripts/nct-isa.c scripts/nct-sio.c scripts/nct-stats.c scripts/nct-rt.c"
+if [ -f /tmp/test-nct-step ]; then
+    run_test "nct-step binary created" "test -x /tmp/test-nct-step"
+    rm -f /tmp/test-nct-step
+fi
+run_test "nct-query.c compiles" "gcc -std=c2x -O2 -Wall -Wextra -Werror -o /tmp/test-nct-query scripts/nct-query.c"
+if [ -f /tmp/test-nct-query ]; then
+    run_test "nct-query binary created" "test -x /tmp/test-nct-query"
+    rm -f /tmp/test-nct-query
+fi
+run_test "nct-agent.c compiles" "gcc -std=c2x -O2 -Wall -Wextra -Werror -o /tmp/test-nct-agent scripts/nct-agent.c scripts/nct-hwmon.c scripts/nct-stats.c -lz -lcrypto"
+if [ -f /tmp/test-nct-agent ]; then
+    run_test "nct-agent binary created" "test -x /tmp/test-nct-agent"
+    rm -f /tmp/test-nct-agent
+fi
+run_test "nct-alarm.c compiles" "gcc -std=c2x -O2 -Wall -Wextra -Werror -o /tmp/test-nct-alarm scripts/nct-alarm.c scripts/nct-hwmon.c scripts/nct-stats.c"
+if [ -f /tmp/test-nct-alarm ]; then
+    run_test "nct-alarm binary created" "test -x /tmp/test-nct-alarm"
+    rm -f /tmp/test-nct-alarm
+fi
+run_test "nct-broker.c compiles" "gcc -std=c2x -O2 -Wall -Wextra -Werror -o /tmp/test-nct-broker scripts/nct-broker.c scripts/nct-hwmon.c scripts/nct-stats.c"
+if [ -f /tmp/test-nct-broker ]; then
+    run_test "nct-broker binary created" "test -x /tmp/test-nct-broker"
+    rm -f /tmp/test-nct-broker
+fi
+run_test "nct-tune.c compiles" "gcc -std=c2x -O2 -Wall -Wextra -Werror -o /tmp/test-nct-tune scripts/nct-tune.c -lm"
+if [ -f /tmp/test-nct-tune ]; then
+    run_test "nct-tune binary created" "test -x /tmp/test-nct-tune"
+    rm -f /tmp/test-nct-tune
+fi
+run_test "nct-ring.h is self-contained" "echo '#include \"nct-ring.h\"' | gcc -std=c2x -Wall -Wextra -Werror -fsyntax-only -Iscripts -x c -"
+run_test "nct-trace.h is self-contained" "echo '#include \"nct-trace.h\"' | gcc -std=c2x -Wall -Wextra -Werror -fsyntax-only -Iscripts -x c -"
+run_test "nct-fleet.h is self-contained" "echo '#include \"nct-fleet.h\"' | gcc -std=c2x -Wall -Wextra -Werror -fsyntax-only -Iscripts -x c -"
+run_test "nct-log.h is self-contained" "echo '#include \"nct-log.h\"' | gcc -std=c2x -Wall -Wextra -Werror -fsyntax-only -Iscripts -x c -"
+run_test "nct-broker.h is self-contained" "echo '#include \"nct-broker.h\"' | gcc -std=c2x -Wall -Wextra -Werror -fsyntax-only -Iscripts -x c -"
+run_test "nct-uring.h is self-contained" "echo '#include \"nct-uring.h\"' | gcc -std=c2x -Wall -Wextra -Werror -fsyntax-only -Iscripts -x c -"
+run_test "nct-stats.h is self-contained" "echo '#include \"nct-stats.h\"' | gcc -std=c2x -Wall -Wextra -Werror -fsyntax-only -Iscripts -x c -"
 echo ""
 
 # Test 4: Documentation Files
@@ -124,11 +206,18 @@ log_info "Test Suite 7: Systemd Units"
 run_test "max-fans.service exists" "test -f systemd/max-fans.service"
 run_test "max-fans-restore.service exists" "test -f systemd/max-fans-restore.service"
 run_test "max-fans-restore.timer exists" "test -f systemd/max-fans-restore.timer"
+run_test "nct-sampler.service exists" "test -f systemd/nct-sampler.service"
+run_test "nct-exporter.service exists" "test -f systemd/nct-exporter.service"
+run_test "nct-fanctl.service exists" "test -f systemd/nct-fanctl.service"
+run_test "nct-agent.service exists" "test -f systemd/nct-agent.service"
+run_test "nct-alarm.service exists" "test -f systemd/nct-alarm.service"
+run_test "nct-broker.service exists" "test -f systemd/nct-broker.service"
 echo ""
 
 # Test 8: Udev Rules
 log_info "Test Suite 8: Udev Rules"
 run_test "hwmon permissions rule exists" "test -f udev/50-asus-hwmon-permissions.rules"
+run_test "hwmon resolver cache rule exists" "test -f udev/60-nct-hwmon-cache.rules"
 run_test "SATA rule exists" "test -f udev/90-asus-sata.rules"
 echo ""
 
@@ -150,6 +239,74 @@ else
 fi
 echo ""
 
+# Test 11: Emulated NCT6798D (tests/emu: fake sysfs tree + port emulator)
+log_info "Test Suite 11: Emulated NCT6798D"
+EMU="$(mktemp -d)"
+trap 'rm -rf "${EMU}"' EXIT
+EMU_HWMON="${EMU}/root/class/hwmon/hwmon3"
+# emu_scrape PORT: one GET /metrics against a local nct-exporter
+# The request goes out in one write: bash line-buffers printf, and the
+# exporter answers and closes after the first segment, so a second write
+# would die of SIGPIPE (the here-string supplies the final \n)
+emu_scrape() {
+    local req=$'GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r'
+    exec 3<>"/dev/tcp/127.0.0.1/$1" || return 1
+    cat <<<"${req}" >&3
+    cat <&3
+    exec 3<&-
+}
+run_test "emulator and emulated tools build" "tests/emu/nct-emu-build.sh '${EMU}'"
+run_test "nct-id --probe finds NCT6798D at 0x2E" "'${EMU}/nct-id' --probe | grep 'SIO at 0x2E: NCT6798D .*base=0x0290'"
+run_test "nct-id identifies the bound driver" "'${EMU}/run' '${EMU}/nct-id' | grep 'platform nct6775.656): NCT6798D'"
+run_test "nct-id --probe fails when ioperm is denied and WMI does not answer" "! NCT_EMU_IOPERM=deny NCT_EMU_WMI_METHOD=none '${EMU}/nct-id' --probe"
+run_test "nct-id --probe falls back to ASUS WMI when ioperm is denied" "NCT_EMU_IOPERM=deny '${EMU}/nct-id' --probe | grep 'SIO via ASUS WMI: NCT6798D .*base=0x0290'"
+run_test "nct-id --backend wmi finds the chip behind the second SIO port" "NCT_EMU_SIO_PORT=0x4E NCT_EMU_BASE=0x0A20 '${EMU}/nct-id' --backend wmi | grep 'SIO via ASUS WMI: NCT6798D .*base=0x0A20'"
+run_test "nct-id WMI and port dumps read the same registers" "'${EMU}/nct-id' --backend wmi --dump -o '${EMU}/w.img' && '${EMU}/nct-id' --dump --force -o '${EMU}/p.img' && cmp <(tail -c +33 '${EMU}/w.img') <(tail -c +33 '${EMU}/p.img')"
+run_test "nct-id --dump is refused while nct6775 is bound" "! '${EMU}/nct-id' --dump -o '${EMU}/a.img'"
+run_test "nct-id --dump image replays into the emulator" "'${EMU}/nct-id' --dump --force -o '${EMU}/a.img' && NCT_EMU_IMAGE='${EMU}/a.img' '${EMU}/nct-id' --dump --force -o '${EMU}/b.img' && cmp <(tail -c +33 '${EMU}/a.img') <(tail -c +33 '${EMU}/b.img')"
+run_test "isa and sysfs backends agree" "diff <('${EMU}/run' '${EMU}/nct-sampler' --count 1 2>/dev/null | sed -n 2p | cut -f2-37) <('${EMU}/nct-sampler' --backend isa --force --count 1 2>/dev/null | sed -n 2p | cut -f2-37)"
+run_test "pwm1 duty reads back at 0x001, not the 0x109 output register" "'${EMU}/nct-id' --dump --force -o '${EMU}/pwm.img' && test \"\$(tail -c +33 '${EMU}/pwm.img' | od -An -tu1 -j1 -N1 | tr -d ' ')\" = 128"
+run_test "sysfs rejects an invalid pwm_enable" "! printf 'pwm1_enable 3\n' | '${EMU}/run' '${EMU}/nct-fan' --apply - '${EMU_HWMON}' --direct"
+run_test "sysfs refuses writes to inputs" "! printf 'temp1_input 0\n' | '${EMU}/run' '${EMU}/nct-fan' --apply - '${EMU_HWMON}' --direct"
+run_test "nct-profile compiles the example profile" "'${EMU}/nct-profile' --compile examples/nct-fan-profile.conf.example -o '${EMU}/plan'"
+run_test "nct-fan --apply programs the chip" "'${EMU}/run' '${EMU}/nct-fan' --apply '${EMU}/plan' '${EMU_HWMON}' --direct"
+run_test "nct-fan --reconcile finds no drift" "'${EMU}/run' '${EMU}/nct-fan' --reconcile '${EMU}/plan' '${EMU_HWMON}' --direct 2>&1 | grep ' 0 drifted, 0 writes, 0 failures'"
+run_test "nct-fan --reconcile repairs drift" "echo 100 >'${EMU_HWMON}/pwm1_auto_point3_pwm' && '${EMU}/run' '${EMU}/nct-fan' --reconcile '${EMU}/plan' '${EMU_HWMON}' --direct 2>&1 | grep ' 1 drifted' && grep -qx 128 '${EMU_HWMON}/pwm1_auto_point3_pwm'"
+run_test "nct-fan --snapshot round-trips" "'${EMU}/run' '${EMU}/nct-fan' --snapshot '${EMU_HWMON}' >'${EMU}/snap' && '${EMU}/run' '${EMU}/nct-fan' --reconcile '${EMU}/snap' '${EMU_HWMON}' --direct 2>&1 | grep ' 0 drifted'"
+run_test "SmartFan duty follows the curve" "echo 70000 >'${EMU_HWMON}/temp1_input' && test \"\$('${EMU}/run' cat '${EMU_HWMON}/pwm1')\" = 192 && echo 34000 >'${EMU_HWMON}/temp1_input'"
+run_test "nct-sampler sysfs backend reads every channel" "'${EMU}/run' '${EMU}/nct-sampler' --count 10 --rate 50 --quiet --device all 2>&1 | grep 'read_errors=0'"
+run_test "nct-sampler isa backend is refused while nct6775 is bound" "! '${EMU}/nct-sampler' --backend isa --count 1 --quiet"
+run_test "nct-sampler isa backend reads every channel" "'${EMU}/nct-sampler' --backend isa --force --count 10 --rate 50 --quiet 2>&1 | grep 'read_errors=0'"
+printf 'interval 100\nfeedforward power=%s tau=5\npwm1 source=nct6798/temp1_input curve=40:60,85:255 ff_floor=200\n' "${EMU}/energy_uj" >"${EMU}/ff.conf"
+run_test "nct-fanctl feed-forward is idle at constant power" "echo 0 >'${EMU}/energy_uj' && '${EMU}/run' '${EMU}/nct-fanctl' --config '${EMU}/ff.conf' --hwmon '${EMU_HWMON}' --dry-run --count 5 2>&1 | grep 'boosted=0 '"
+run_test "nct-fanctl feed-forward raises the floor on a power step" "((for i in \$(seq 1 30); do echo \$((i * 10000000)) >'${EMU}/energy_uj'; sleep 0.05; done) & '${EMU}/run' '${EMU}/nct-fanctl' --config '${EMU}/ff.conf' --hwmon '${EMU_HWMON}' --dry-run --verbose --count 10 2>&1 | grep -E 'duty=1[0-9]{2} ff=0'; rc=\$?; wait; exit \$rc)"
+printf 'interval 100\npwm1 source=nct6798/temp1_input curve=40:60,85:255\n' >"${EMU}/ring.conf"
+run_test "nct-fanctl reads its sources from the sampler ring" "('${EMU}/run' '${EMU}/nct-sampler' --ring '${EMU}/ring' --rate 20 --count 60 --quiet & sleep 0.5; '${EMU}/run' '${EMU}/nct-fanctl' --config '${EMU}/ring.conf' --hwmon '${EMU_HWMON}' --ring '${EMU}/ring' --dry-run --count 5 2>&1 | grep -E 'failsafe=0 boosted=0 cached=5 '; rc=\$?; wait; exit \$rc)"
+run_test "nct-fanctl falls back to sysfs once the sampler has exited" "'${EMU}/run' '${EMU}/nct-fanctl' --config '${EMU}/ring.conf' --hwmon '${EMU_HWMON}' --ring '${EMU}/ring' --dry-run --count 3 2>&1 | grep 'failsafe=0 boosted=0 cached=0 '"
+run_test "nct-exporter reports the sampler down once it is killed" "('${EMU}/run' '${EMU}/nct-sampler' --ring '${EMU}/exp.ring' --rate 20 --quiet & spid=\$!; sleep 0.5; '${EMU}/nct-exporter' --ring '${EMU}/exp.ring' --listen 127.0.0.1:19798 & epid=\$!; sleep 0.5; kill -0 \$epid; emu_scrape 19798 | grep -x 'nct_sampler_up 1'; up=\$?; kill -9 \$spid; sleep 0.5; emu_scrape 19798 | grep -x 'nct_sampler_up 0'; down=\$?; kill \$epid; wait; test \$up = 0 && test \$down = 0)"
+run_test "nct-agent forwards an nct-alarm --exec transition to the collector" "(printf 'collector 127.0.0.1:19797\\nnode emu\\nbatch 5\\nring %s\\n' '${EMU}/agent.ring' >'${EMU}/agent.conf'; '${EMU}/run' '${EMU}/nct-sampler' --ring '${EMU}/agent.ring' --rate 10 --quiet </dev/null & spid=\$!; '${EMU}/nct-agent' --serve --listen 127.0.0.1:19797 --out '${EMU}/fleet.jsonl' </dev/null & cpid=\$!; sleep 0.5; NCT_AGENT_SOCKET='${EMU}/agent.sock' '${EMU}/nct-agent' --config '${EMU}/agent.conf' </dev/null & apid=\$!; sleep 1.5; NCT_AGENT_SOCKET='${EMU}/agent.sock' NCT_ALARM=temp1 NCT_ALARM_STATE=raised NCT_ALARM_LABEL=SYSTIN NCT_ALARM_VALUE=81000 '${EMU}/nct-agent' --alarm-event; sleep 6; kill \$apid \$cpid \$spid; wait; grep -F '\"event\":\"alarm_raised\",\"value\":81000,\"channel\":\"temp1_input\"' '${EMU}/fleet.jsonl')"
+# emu_broker NAME: start nct-broker on ${EMU}/NAME.sock (500 ms window), log in NAME.log
+emu_broker() {
+    "${EMU}/run" "${EMU}/nct-broker" --socket "${EMU}/$1.sock" --hwmon "${EMU_HWMON}" --window 500 \
+        2>"${EMU}/$1.log" </dev/null &
+    sleep 0.3
+}
+run_test "nct-broker merges two coalescing writers into one sysfs write" "(emu_broker co; bpid=\$!; '${EMU}/nct-emu-client' --socket '${EMU}/co.sock' --coalesce pwm2=100 pwm2=200 >'${EMU}/co.out'; rc=\$?; kill \$bpid; wait; test \$rc = 0 && grep -x 'pwm2=100 rc=0 source=merged' '${EMU}/co.out' && grep -x 'pwm2=200 rc=0 source=sysfs' '${EMU}/co.out' && grep 'writes=1 merged=1' '${EMU}/co.log' && grep -qx 200 '${EMU_HWMON}/pwm2')"
+run_test "nct-broker cancels the rest of a channel after a failed gate" "(mode=\$(cat '${EMU_HWMON}/pwm3_enable'); emu_broker gate; bpid=\$!; '${EMU}/nct-emu-client' --socket '${EMU}/gate.sock' '!pwm3_enable=3' pwm3=50 pwm3_enable=5 pwm4=60 >'${EMU}/gate.out'; rc=\$?; kill \$bpid; wait; test \$rc = 0 && diff - '${EMU}/gate.out' <<<\$'pwm3_enable=3 rc=EINVAL source=sysfs\npwm3=50 rc=ECANCELED source=sysfs\npwm3_enable=5 rc=ECANCELED source=sysfs\npwm4=60 rc=0 source=sysfs' && grep -qx \"\$mode\" '${EMU_HWMON}/pwm3_enable')"
+if [[ ${EUID} -eq 0 ]] && command -v setpriv &>/dev/null; then
+    run_test "nct-broker refuses writes from a non-root client" "(chmod o+x '${EMU}'; emu_broker perm; bpid=\$!; setpriv --reuid=65534 --regid=65534 --clear-groups '${EMU}/nct-emu-client' --socket '${EMU}/perm.sock' pwm2=10 >'${EMU}/perm.out'; wrc=\$?; setpriv --reuid=65534 --regid=65534 --clear-groups '${EMU}/nct-emu-client' --socket '${EMU}/perm.sock' pwm2 >>'${EMU}/perm.out'; rrc=\$?; kill \$bpid; wait; test \$wrc = 1 && test \$rrc = 0 && grep -x 'status=EPERM' '${EMU}/perm.out' && grep -E '^pwm2 rc=0 source=sysfs value=[0-9]+$' '${EMU}/perm.out')"
+else
+    log_warning "Not root (or no setpriv), skipping the nct-broker non-root client test..."
+fi
+run_test "nct-fan writes sysfs directly when the broker socket is absent or stale" "(NCT_BROKER_SOCKET='${EMU}/absent.sock' '${EMU}/run' '${EMU}/nct-fan' --apply - '${EMU_HWMON}' --verbose <<<'pwm4 70' 2>&1 | grep 'no broker at .*No such file or directory' && grep -qx 70 '${EMU_HWMON}/pwm4'; absent=\$?; emu_broker stale; kill -9 \$!; wait; test -S '${EMU}/stale.sock' && NCT_BROKER_SOCKET='${EMU}/stale.sock' '${EMU}/run' '${EMU}/nct-fan' --apply - '${EMU_HWMON}' --verbose <<<'pwm4 80' 2>&1 | grep 'no broker at .*Connection refused' && grep -qx 80 '${EMU_HWMON}/pwm4'; stale=\$?; test \$absent = 0 && test \$stale = 0)"
+printf '[pwm1]\nfan = 1\nconnected = yes\nresponds = yes\nstall_duty = 40\nstart_duty = 60\nmax_rpm = 1500\nrpm_down = 255:1500, 192:1200, 128:850, 64:420, 40:250~\n' >"${EMU}/fan.model"
+run_test "nct-sampler logs a heat-up for nct-tune" "((for t in 40 50 60 70 75 70 60 50; do echo \${t}000 >'${EMU_HWMON}/temp1_input'; sleep 0.25; done) & '${EMU}/run' '${EMU}/nct-sampler' --log '${EMU}/telemetry' --count 100 --rate 50 --quiet; rc=\$?; wait; echo 34000 >'${EMU_HWMON}/temp1_input'; exit \$rc)"
+run_test "nct-tune emits a profile nct-profile accepts" "'${EMU}/nct-tune' --model '${EMU}/fan.model' --target SYSTIN:80 --weight 1:SYSTIN --dir '${EMU}/telemetry' --from -1h --resolution 1 -o '${EMU}/tuned.conf' && grep '^curve = ' '${EMU}/tuned.conf' && '${EMU}/nct-profile' --check '${EMU}/tuned.conf'"
+run_test "nct-tune fails when no curve meets the ceiling" "'${EMU}/nct-tune' --model '${EMU}/fan.model' --target SYSTIN:55 --dir '${EMU}/telemetry' --from -1h --resolution 1 -o '${EMU}/none.conf'; test \$? = 1 && test ! -e '${EMU}/none.conf'"
+run_test "nct-bench skips the ports while nct6775 is bound" "'${EMU}/run' '${EMU}/nct-bench' --iterations 100 --script-runs 1 -o '${EMU}/bench.json' && grep '\"name\": \"hwm_dump\", \"skipped\": \"HWM ports owned by nct6775\"' '${EMU}/bench.json'"
+run_test "nct-bench emits a report" "'${EMU}/run' '${EMU}/nct-bench' --iterations 100 --write --force --script-runs 1 -o '${EMU}/bench.json' && grep '\"name\": \"hwm_dump\", \"ops\"' '${EMU}/bench.json'"
+echo ""
+
 # Summary
 echo "═══════════════════════════════════════════════════════════════"
 echo "  Test Results"